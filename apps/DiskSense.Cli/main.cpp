@@ -10,7 +10,16 @@
 #include "libs/utils/utils.h"
 #include "core/ops/secure_delete.h"
 #include "core/ops/cleanup.h"
+#include "libs/lsh/lsh.h"
+#include "libs/phash/phash_optimized.h"
+#include "libs/audfp/audfp.h"
+#include "libs/digest/digest.h"
+#include "libs/fuzzyhash/fuzzy_index.h"
 #include <fstream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <cstring>
 
 void printUsage(const char* programName) {
     std::cout << "DiskSense64 - Cross-Platform Disk Analysis Suite" << std::endl;
@@ -21,18 +30,44 @@ void printUsage(const char* programName) {
     std::cout << "Commands:" << std::endl;
     std::cout << "  scan     - Scan directory and build index" << std::endl;
     std::cout << "  dedupe   - Find and remove duplicates" << std::endl;
-    std::cout << "  similar  - Find similar files (images/audio)" << std::endl;
+    std::cout << "  similar  - Find similar files (images/audio/fuzzy hashes)" << std::endl;
+    std::cout << "  digest   - Hash files in one read (BLAKE3, SHA-256, entropy, type)" << std::endl;
     std::cout << "  cleanup  - Clean residue files" << std::endl;
     std::cout << "  treemap  - Generate treemap visualization (GUI only)" << std::endl;
     std::cout << std::endl;
+    std::cout << "Options for scan:" << std::endl;
+    std::cout << "  --entropy                                 Store a per-file entropy sketch (reads whole files)" << std::endl;
+    std::cout << "  --compressibility                         Estimate each file's compressed size from sampled blocks" << std::endl;
+    std::cout << "  --archives                                Also index archive members as \"archive!/member\" entries" << std::endl;
+    std::cout << "  --archive-depth=<n>                       Nested archive levels entered (default: 3)" << std::endl;
+    std::cout << "  --archive-threads=<n>                     Archives hashed at once (default: 0 = all cores)" << std::endl;
+    std::cout << std::endl;
     std::cout << "Options for dedupe:" << std::endl;
-    std::cout << "  --action=<simulate|hardlink|move|delete>  Action to perform (default: simulate)" << std::endl;
+    std::cout << "  --action=<simulate|hardlink|clone|move|delete>  Action to perform (default: simulate)" << std::endl;
+    std::cout << "  --min-size=<bytes>                        Minimum file size to consider (default: 1024)" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options for similar:" << std::endl;
+    std::cout << "  --distance=<0-64>                         Maximum pHash Hamming distance for images (default: 8)" << std::endl;
+    std::cout << "  --content                                 Near-duplicate content via MinHash/LSH over file chunks" << std::endl;
+    std::cout << "  --audio                                   Same recording via audio landmark fingerprints (WAV/FLAC)" << std::endl;
+    std::cout << "  --fuzzy                                   Variants of the same file via indexed ssdeep and TLSH" << std::endl;
+    std::cout << "  --min-score=<n>                           Minimum aligned landmarks for audio (default: 20) or ssdeep score (default: 60)" << std::endl;
+    std::cout << "  --tlsh-distance=<n>                       Maximum TLSH distance for --fuzzy (default: 50)" << std::endl;
+    std::cout << "  --threshold=<0.0-1.0>                     Minimum estimated Jaccard similarity (default: 0.5)" << std::endl;
+    std::cout << "  --bands=<b> --rows=<r>                    LSH banding, b*r permutations (default: 32x4)" << std::endl;
     std::cout << "  --min-size=<bytes>                        Minimum file size to consider (default: 1024)" << std::endl;
     std::cout << std::endl;
+    std::cout << "Options for digest:" << std::endl;
+    std::cout << "  --fuzzy                                   Also compute ssdeep and TLSH in the same pass" << std::endl;
+    std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  " << programName << " scan /home/user/Documents" << std::endl;
     std::cout << "  " << programName << " dedupe --action=hardlink /home/user/Downloads" << std::endl;
     std::cout << "  " << programName << " similar /home/user/Pictures" << std::endl;
+    std::cout << "  " << programName << " similar --content --threshold=0.7 /home/user/Documents" << std::endl;
+    std::cout << "  " << programName << " similar --audio /home/user/Music" << std::endl;
+    std::cout << "  " << programName << " similar --fuzzy --min-score=70 /srv/samples" << std::endl;
+    std::cout << "  " << programName << " digest /mnt/evidence" << std::endl;
 }
 
 std::string getIndexPath(const std::string& directory) {
@@ -59,6 +94,348 @@ std::string getIndexPath(const std::string& directory) {
     return FileUtils::join_paths(homeDir, ".disksense64");
 }
 
+// Near-duplicate content search: sketch every file with chunk-level MinHash,
+// band the signatures into an LSH table and verify only colliding pairs.
+int runContentSimilarity(const std::string& directory, const std::string& indexPath,
+                         double threshold, uint64_t minSize, const LshIndex::Parameters& lshParams) {
+    MinHasher hasher(lshParams.signature_length());
+    ContentSketcher sketcher(hasher);
+    LshIndex lsh(lshParams);
+
+    std::cout << "Content similarity threshold: " << threshold
+              << " (LSH " << lshParams.bands << "x" << lshParams.rows
+              << ", candidate threshold ~" << LshIndex::threshold_estimate(lshParams.bands, lshParams.rows)
+              << ")" << std::endl;
+
+    Scanner scanner;
+    ScanOptions options;
+    options.computeHeadTail = false;
+    options.computeFullHash = false;
+    options.minFileSize = minSize;
+
+    uint64_t file_count = 0;
+    scanner.scanVolume(directory, options,
+                      [&](const ScanEvent& event) {
+        if (event.type != ScanEventType::FileAdded) {
+            return;
+        }
+        ContentSketcher::Sketch sketch;
+        if (!sketcher.sketch_file(event.fileEntry.fullPath, sketch) || sketch.chunk_count == 0) {
+            return;
+        }
+        lsh.insert(event.fileEntry.fullPath, sketch.signature);
+        file_count++;
+        if (file_count % 1000 == 0) {
+            std::cout << "Sketched " << file_count << " files...\r" << std::flush;
+        }
+    });
+
+    FileUtils::create_directory(indexPath);
+    std::string lshPath = FileUtils::join_paths(indexPath, "content.lsh");
+    if (!lsh.save(lshPath)) {
+        std::cerr << "Warning: could not save LSH index to " << lshPath << std::endl;
+    }
+
+    auto pairs = lsh.find_similar_pairs(threshold);
+    auto stats = lsh.get_stats();
+
+    std::cout << "Sketched " << file_count << " files; verified " << stats.candidates_checked
+              << " candidate pairs." << std::endl;
+    std::cout << "Found " << pairs.size() << " near-duplicate pairs." << std::endl;
+    for (const auto& pair : pairs) {
+        std::cout << std::fixed << std::setprecision(1) << std::setw(6) << (pair.similarity * 100.0) << "%  "
+                  << lsh.get_key(pair.a) << "  <->  " << lsh.get_key(pair.b) << std::endl;
+    }
+    return 0;
+}
+
+// Perceptual image similarity: pHash every image, index the hashes with
+// multi-index hashing and join the index with itself within the radius.
+int runImageSimilarity(const std::string& directory, const std::string& indexPath,
+                       int maxDistance, uint64_t minSize) {
+    Scanner scanner;
+    ScanOptions options;
+    options.computeHeadTail = false;
+    options.computeFullHash = false;
+    options.minFileSize = minSize;
+
+    // Collect candidates first, then hash them in parallel batches
+    std::vector<std::string> candidates;
+    scanner.scanVolume(directory, options,
+                      [&](const ScanEvent& event) {
+        if (event.type == ScanEventType::FileAdded &&
+            PHashOptimized::is_supported_image(event.fileEntry.fullPath.c_str())) {
+            candidates.push_back(event.fileEntry.fullPath);
+        }
+    });
+
+    PHashOptimized hasher;
+    std::vector<std::string> paths;
+    PHashMultiIndex index;
+    const size_t batchSize = 1024;
+    std::vector<const char*> batchPaths;
+    std::vector<uint64_t> batchHashes(batchSize);
+    std::unique_ptr<bool[]> batchOk(new bool[batchSize]);
+    for (size_t start = 0; start < candidates.size(); start += batchSize) {
+        const size_t count = std::min(batchSize, candidates.size() - start);
+        batchPaths.clear();
+        for (size_t i = 0; i < count; ++i) {
+            batchPaths.push_back(candidates[start + i].c_str());
+        }
+        hasher.compute_phash_file_batch(batchPaths.data(), count, batchHashes.data(), batchOk.get());
+        for (size_t i = 0; i < count; ++i) {
+            if (batchOk[i]) {
+                index.add_hash(paths.size(), batchHashes[i]);
+                paths.push_back(candidates[start + i]);
+            }
+        }
+        std::cout << "Hashed " << paths.size() << " images...\r" << std::flush;
+    }
+
+    FileUtils::create_directory(indexPath);
+    std::string phashPath = FileUtils::join_paths(indexPath, "phash.idx");
+    if (!index.save_to_file(phashPath.c_str())) {
+        std::cerr << "Warning: could not save pHash index to " << phashPath << std::endl;
+    }
+
+    auto pairs = index.find_similar_pairs(maxDistance);
+
+    // Group transitively similar images (union-find over the joined pairs)
+    std::vector<size_t> parent(paths.size());
+    for (size_t i = 0; i < parent.size(); ++i) parent[i] = i;
+    auto find = [&parent](size_t x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    for (const auto& pair : pairs) {
+        size_t a = find(pair.image_id_a), b = find(pair.image_id_b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+    std::map<size_t, std::vector<size_t>> groups;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        groups[find(i)].push_back(i);
+    }
+
+    size_t groupCount = 0;
+    for (const auto& [root, members] : groups) {
+        if (members.size() < 2) continue;
+        groupCount++;
+        std::cout << "Group " << groupCount << " (" << members.size() << " images):" << std::endl;
+        for (size_t id : members) {
+            std::cout << "  " << paths[id] << std::endl;
+        }
+    }
+
+    std::cout << "Hashed " << paths.size() << " images; " << pairs.size()
+              << " pairs within distance " << maxDistance << " in "
+              << groupCount << " groups." << std::endl;
+    return 0;
+}
+
+// Audio similarity: fingerprint every WAV/FLAC file with spectral landmarks,
+// index them and report recordings whose landmarks align at a common offset.
+int runAudioSimilarity(const std::string& directory, const std::string& indexPath,
+                       uint32_t minScore, uint64_t minSize) {
+    Scanner scanner;
+    ScanOptions options;
+    options.computeHeadTail = false;
+    options.computeFullHash = false;
+    options.minFileSize = minSize;
+
+    std::vector<std::string> candidates;
+    scanner.scanVolume(directory, options,
+                      [&](const ScanEvent& event) {
+        if (event.type == ScanEventType::FileAdded &&
+            AudioFingerprinter::is_supported_audio(event.fileEntry.fullPath)) {
+            candidates.push_back(event.fileEntry.fullPath);
+        }
+    });
+
+    // Fingerprint in parallel batches; only one batch of landmark lists is
+    // held outside the index at a time
+    AudioFingerprinter fingerprinter;
+    AudioFingerprintIndex index;
+    const size_t batchSize = 64;
+    std::vector<AudioFingerprinter::Fingerprint> batch(batchSize);
+    std::unique_ptr<bool[]> batchOk(new bool[batchSize]);
+    for (size_t start = 0; start < candidates.size(); start += batchSize) {
+        const size_t count = std::min(batchSize, candidates.size() - start);
+        fingerprinter.fingerprint_files(candidates.data() + start, count, batch.data(), batchOk.get());
+        for (size_t i = 0; i < count; ++i) {
+            if (batchOk[i] && !batch[i].landmarks.empty()) {
+                index.add(candidates[start + i], batch[i]);
+            }
+            batch[i] = AudioFingerprinter::Fingerprint();
+        }
+        std::cout << "Fingerprinted " << index.size() << " audio files...\r" << std::flush;
+    }
+
+    FileUtils::create_directory(indexPath);
+    std::string audioPath = FileUtils::join_paths(indexPath, "audio.afi");
+    if (!index.save(audioPath)) {
+        std::cerr << "Warning: could not save audio index to " << audioPath << std::endl;
+    }
+
+    auto pairs = index.find_similar_pairs(minScore);
+
+    // Group transitively matching recordings (union-find over the pairs)
+    std::vector<size_t> parent(index.size());
+    for (size_t i = 0; i < parent.size(); ++i) parent[i] = i;
+    auto find = [&parent](size_t x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    for (const auto& pair : pairs) {
+        size_t a = find(pair.a), b = find(pair.b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+    std::map<size_t, std::vector<size_t>> groups;
+    for (size_t i = 0; i < index.size(); ++i) {
+        groups[find(i)].push_back(i);
+    }
+
+    size_t groupCount = 0;
+    for (const auto& [root, members] : groups) {
+        if (members.size() < 2) continue;
+        groupCount++;
+        std::cout << "Group " << groupCount << " (" << members.size() << " recordings):" << std::endl;
+        for (size_t id : members) {
+            const auto track = static_cast<AudioFingerprintIndex::TrackId>(id);
+            std::cout << "  " << std::setw(7) << std::fixed << std::setprecision(1)
+                      << (index.get_duration_ms(track) / 1000.0) << "s  " << index.get_key(track) << std::endl;
+        }
+    }
+
+    std::cout << "Fingerprinted " << index.size() << " audio files; " << pairs.size()
+              << " matching pairs in " << groupCount << " groups." << std::endl;
+    return 0;
+}
+
+// Fuzzy-hash similarity: ssdeep and TLSH every file in one read each, index
+// the digests and join through the index instead of comparing every pair.
+int runFuzzySimilarity(const std::string& directory, const std::string& indexPath,
+                       int minScore, int maxTlshDistance, uint64_t minSize) {
+    Scanner scanner;
+    ScanOptions options;
+    options.computeHeadTail = false;
+    options.computeFullHash = false;
+    options.minFileSize = minSize;
+
+    std::vector<std::string> candidates;
+    scanner.scanVolume(directory, options,
+                      [&](const ScanEvent& event) {
+        if (event.type == ScanEventType::FileAdded) {
+            candidates.push_back(event.fileEntry.fullPath);
+        }
+    });
+
+    DigestEngine::Parameters params;
+    params.digests = DigestEngine::SSDEEP | DigestEngine::TLSH;
+    DigestEngine engine(params);
+    FuzzyHashIndex index;
+    const size_t batchSize = 256;
+    std::vector<DigestRecord> batch(batchSize);
+    std::unique_ptr<bool[]> batchOk(new bool[batchSize]);
+    for (size_t start = 0; start < candidates.size(); start += batchSize) {
+        const size_t count = std::min(batchSize, candidates.size() - start);
+        engine.digest_files(candidates.data() + start, count, batch.data(), batchOk.get());
+        for (size_t i = 0; i < count; ++i) {
+            if (batchOk[i] && (!batch[i].ssdeep.empty() || !batch[i].tlsh.empty())) {
+                index.add(candidates[start + i], batch[i].ssdeep, batch[i].tlsh);
+            }
+            batch[i] = DigestRecord();
+        }
+        std::cout << "Hashed " << index.size() << " files...\r" << std::flush;
+    }
+
+    FileUtils::create_directory(indexPath);
+    std::string fuzzyPath = FileUtils::join_paths(indexPath, "fuzzy.fhi");
+    if (!index.save(fuzzyPath)) {
+        std::cerr << "Warning: could not save fuzzy hash index to " << fuzzyPath << std::endl;
+    }
+
+    // A pair matches if either digest says so
+    auto pairs = index.ssdeep_pairs(minScore);
+    const size_t ssdeepPairs = pairs.size();
+    auto tlshPairs = index.tlsh_pairs(maxTlshDistance);
+    pairs.insert(pairs.end(), tlshPairs.begin(), tlshPairs.end());
+    auto groups = FuzzyHashIndex::cluster(pairs, index.size());
+
+    size_t groupCount = 0;
+    for (const auto& members : groups) {
+        groupCount++;
+        std::cout << "Group " << groupCount << " (" << members.size() << " files):" << std::endl;
+        for (auto id : members) {
+            std::cout << "  " << index.get_key(id) << std::endl;
+        }
+    }
+
+    std::cout << "Hashed " << index.size() << " files; " << ssdeepPairs << " ssdeep pairs (score >= "
+              << minScore << "), " << tlshPairs.size() << " TLSH pairs (distance <= " << maxTlshDistance
+              << ") in " << groupCount << " groups; " << index.get_stats().comparisons
+              << " digest comparisons." << std::endl;
+    return 0;
+}
+
+int runDigest(const std::string& directory, uint64_t minSize, bool fuzzy) {
+    Scanner scanner;
+    ScanOptions options;
+    options.computeHeadTail = false;
+    options.computeFullHash = false;
+    options.minFileSize = minSize;
+
+    std::vector<std::string> files;
+    scanner.scanVolume(directory, options,
+                      [&](const ScanEvent& event) {
+        if (event.type == ScanEventType::FileAdded) {
+            files.push_back(event.fileEntry.fullPath);
+        }
+    });
+
+    // Every file is read once; all digests are fed from the same buffers
+    DigestEngine::Parameters params;
+    params.digests &= ~DigestEngine::ENTROPY_MAP;
+    if (!fuzzy) {
+        params.digests &= ~(DigestEngine::SSDEEP | DigestEngine::TLSH);
+    }
+    DigestEngine engine(params);
+    const size_t batchSize = 256;
+    std::vector<DigestRecord> batch(batchSize);
+    std::unique_ptr<bool[]> batchOk(new bool[batchSize]);
+    size_t digested = 0;
+    uint64_t bytes = 0;
+    for (size_t start = 0; start < files.size(); start += batchSize) {
+        const size_t count = std::min(batchSize, files.size() - start);
+        engine.digest_files(files.data() + start, count, batch.data(), batchOk.get());
+        for (size_t i = 0; i < count; ++i) {
+            if (!batchOk[i]) {
+                std::cerr << "Unreadable: " << files[start + i] << std::endl;
+                continue;
+            }
+            const DigestRecord& r = batch[i];
+            std::cout << DigestEngine::to_hex(r.blake3) << "  " << DigestEngine::to_hex(r.sha256) << "  "
+                      << std::fixed << std::setprecision(3) << r.entropy << "  "
+                      << std::setw(6) << std::left << (r.magic.empty() ? "-" : r.magic) << std::right << "  "
+                      << std::setw(12) << r.size << "  ";
+            if (fuzzy) {
+                std::cout << (r.ssdeep.empty() ? "-" : r.ssdeep) << "  " << (r.tlsh.empty() ? "-" : r.tlsh) << "  ";
+            }
+            std::cout << files[start + i] << std::endl;
+            ++digested;
+            bytes += r.size;
+        }
+    }
+
+    std::cout << "Digested " << digested << " files (" << (bytes / (1024.0 * 1024.0)) << " MB)." << std::endl;
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 3) {
         printUsage(argv[0]);
@@ -67,6 +444,13 @@ int main(int argc, char* argv[]) {
 
     std::string command(argv[1]);
     std::string path_str(argv[2]);
+    // Options may precede the directory ("similar --content <dir>")
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]).rfind("--", 0) != 0) {
+            path_str = argv[i];
+            break;
+        }
+    }
     
     // Convert to platform-specific path
     std::string platform_path = FileUtils::to_platform_path(path_str);
@@ -89,13 +473,54 @@ int main(int argc, char* argv[]) {
         ScanOptions options;
         options.computeHeadTail = true;
         options.computeFullHash = false;
+        for (int i = 2; i < argc; i++) {
+            std::string arg(argv[i]);
+            if (arg == "--entropy") {
+                options.computeEntropySketch = true;
+            } else if (arg == "--compressibility") {
+                options.computeCompressibility = true;
+            } else if (arg == "--archives") {
+                options.scanArchives = true;
+            } else if (arg.rfind("--archive-depth=", 0) == 0) {
+                try {
+                    options.archiveMaxDepth = std::max(0, std::stoi(arg.substr(16)));
+                } catch (...) {
+                    std::cerr << "Invalid archive-depth value: " << arg << std::endl;
+                    return 1;
+                }
+            } else if (arg.rfind("--archive-threads=", 0) == 0) {
+                try {
+                    options.archiveThreads = static_cast<unsigned>(std::max(0, std::stoi(arg.substr(18))));
+                } catch (...) {
+                    std::cerr << "Invalid archive-threads value: " << arg << std::endl;
+                    return 1;
+                }
+            }
+        }
         
         uint64_t file_count = 0;
+        uint64_t sketch_count = 0;
+        uint64_t member_count = 0;
+        uint64_t estimated_count = 0;
+        uint64_t estimated_bytes = 0;
+        double compressed_bytes = 0.0;
         scanner.scanVolume(platform_path, options, 
-                          [&index, &file_count](const ScanEvent& event) {
+                          [&](const ScanEvent& event) {
             if (event.type == ScanEventType::FileAdded) {
                 index.put(event.fileEntry);
                 file_count++;
+                if (event.fileEntry.entropySketch) {
+                    sketch_count++;
+                }
+                if (event.fileEntry.attributes.virtualFile) {
+                    member_count++;
+                }
+                if (event.fileEntry.compressedPermille) {
+                    estimated_count++;
+                    estimated_bytes += event.fileEntry.sizeLogical;
+                    compressed_bytes += static_cast<double>(event.fileEntry.sizeLogical) *
+                                        std::min<uint16_t>(*event.fileEntry.compressedPermille, 1000) / 1000.0;
+                }
                 
                 if (file_count % 1000 == 0) {
                     std::cout << "Processed " << file_count << " files...\r" << std::flush;
@@ -111,6 +536,21 @@ int main(int argc, char* argv[]) {
         
         std::cout << "Scan completed! Processed " << file_count << " files in " 
                   << duration.count() << " ms." << std::endl;
+        if (options.computeEntropySketch) {
+            std::cout << "Entropy sketches: " << sketch_count << " files" << std::endl;
+            // Same threshold the scanner uses to skip compressibility sampling
+            std::cout << "High-entropy files (encrypted or compressed): "
+                      << index.getHighEntropy(1, 0.9).size() << std::endl;
+        }
+        if (options.computeCompressibility) {
+            const double reclaimable = static_cast<double>(estimated_bytes) - compressed_bytes;
+            std::cout << "Compressibility estimates: " << estimated_count << " files, "
+                      << (reclaimable / (1024.0 * 1024.0)) << " of "
+                      << (estimated_bytes / (1024.0 * 1024.0)) << " MB reclaimable by compression" << std::endl;
+        }
+        if (options.scanArchives) {
+            std::cout << "Archive members: " << member_count << " (included in the file count)" << std::endl;
+        }
         std::cout << "Index saved to: " << index_path << std::endl;
     } 
     else if (command == "dedupe") {
@@ -124,18 +564,24 @@ int main(int argc, char* argv[]) {
         options.minFileSize = 1024; // 1KB minimum
         
         // Parse command line arguments for options
-        for (int i = 3; i < argc; i++) {
+        for (int i = 2; i < argc; i++) {
             std::string arg(argv[i]);
             if (arg == "--action=simulate") {
                 options.simulateOnly = true;
             } else if (arg == "--action=hardlink") {
                 options.simulateOnly = false;
                 options.useHardlinks = true;
+            } else if (arg == "--action=clone") {
+                options.simulateOnly = false;
+                options.useHardlinks = false;
+                options.useClone = true;
             } else if (arg == "--action=move") {
                 options.simulateOnly = false;
+                options.useHardlinks = false;
                 options.moveToRecycleBin = true;
             } else if (arg == "--action=delete") {
                 options.simulateOnly = false;
+                options.useHardlinks = false;
                 options.moveToRecycleBin = false;
             } else if (arg.rfind("--min-size=", 0) == 0) {
                 try {
@@ -150,6 +596,8 @@ int main(int argc, char* argv[]) {
         std::cout << "Finding duplicates with minimum size: " << options.minFileSize << " bytes" << std::endl;
         if (options.simulateOnly) {
             std::cout << "Running in simulation mode (no changes will be made)" << std::endl;
+        } else if (options.useClone) {
+            std::cout << "Will share extents between duplicates (FIDEDUPERANGE)" << std::endl;
         } else if (options.useHardlinks) {
             std::cout << "Will create hardlinks for duplicates" << std::endl;
         } else if (options.moveToRecycleBin) {
@@ -188,13 +636,99 @@ int main(int argc, char* argv[]) {
             if (finalStats.hardlinksCreated > 0) {
                 std::cout << "Hardlinks created: " << finalStats.hardlinksCreated << std::endl;
             }
+            if (options.useClone) {
+                std::cout << "Files cloned: " << finalStats.clonesCreated << std::endl;
+                if (finalStats.clonesAlreadyShared > 0) {
+                    std::cout << "Already sharing extents: " << finalStats.clonesAlreadyShared << std::endl;
+                }
+                std::cout << "Bytes shared: " << finalStats.bytesCloned << std::endl;
+                for (const auto& pair : finalStats.clonePairs) {
+                    if (pair.shared) continue;
+                    std::cout << "Not cloned: " << pair.destination << " (";
+                    if (pair.differs) {
+                        std::cout << "content differs from " << pair.source;
+                    } else if (pair.error != 0) {
+                        std::cout << std::strerror(pair.error);
+                    } else {
+                        std::cout << "shared " << pair.bytesShared << " bytes";
+                    }
+                    std::cout << ")" << std::endl;
+                }
+            }
         } else if (groups.empty()) {
             std::cout << "No duplicates found in the specified directory." << std::endl;
         }
     }
     else if (command == "similar") {
-        std::cout << "Similarity detection feature not yet implemented in this version." << std::endl;
-        std::cout << "This feature will be available in a future release." << std::endl;
+        bool contentMode = false;
+        bool audioMode = false;
+        bool fuzzyMode = false;
+        int minScore = -1;
+        int tlshDistance = 50;
+        double threshold = 0.5;
+        int maxDistance = 8;
+        uint64_t minSize = 1024;
+        LshIndex::Parameters lshParams;
+        for (int i = 2; i < argc; i++) {
+            std::string arg(argv[i]);
+            try {
+                if (arg == "--content") {
+                    contentMode = true;
+                } else if (arg == "--audio") {
+                    audioMode = true;
+                } else if (arg == "--fuzzy") {
+                    fuzzyMode = true;
+                } else if (arg.rfind("--min-score=", 0) == 0) {
+                    minScore = std::stoi(arg.substr(12));
+                } else if (arg.rfind("--tlsh-distance=", 0) == 0) {
+                    tlshDistance = std::stoi(arg.substr(16));
+                } else if (arg.rfind("--threshold=", 0) == 0) {
+                    threshold = std::stod(arg.substr(12));
+                } else if (arg.rfind("--distance=", 0) == 0) {
+                    maxDistance = std::stoi(arg.substr(11));
+                } else if (arg.rfind("--min-size=", 0) == 0) {
+                    minSize = std::stoull(arg.substr(11));
+                } else if (arg.rfind("--bands=", 0) == 0) {
+                    lshParams.bands = static_cast<uint32_t>(std::stoul(arg.substr(8)));
+                } else if (arg.rfind("--rows=", 0) == 0) {
+                    lshParams.rows = static_cast<uint32_t>(std::stoul(arg.substr(7)));
+                }
+            } catch (...) {
+                std::cerr << "Invalid value: " << arg << std::endl;
+                return 1;
+            }
+        }
+
+        if (contentMode) {
+            return runContentSimilarity(platform_path, index_path, threshold, minSize, lshParams);
+        }
+        if (audioMode) {
+            return runAudioSimilarity(platform_path, index_path,
+                                      static_cast<uint32_t>(minScore < 0 ? 20 : minScore), minSize);
+        }
+        if (fuzzyMode) {
+            return runFuzzySimilarity(platform_path, index_path, minScore < 0 ? 60 : minScore,
+                                      tlshDistance, minSize);
+        }
+        return runImageSimilarity(platform_path, index_path, maxDistance, minSize);
+    }
+    else if (command == "digest") {
+        uint64_t minSize = 0;
+        bool fuzzy = false;
+        for (int i = 2; i < argc; i++) {
+            std::string arg(argv[i]);
+            if (arg == "--fuzzy") {
+                fuzzy = true;
+            } else if (arg.rfind("--min-size=", 0) == 0) {
+                try {
+                    minSize = std::stoull(arg.substr(11));
+                } catch (...) {
+                    std::cerr << "Invalid min-size value: " << arg << std::endl;
+                    return 1;
+                }
+            }
+        }
+        return runDigest(platform_path, minSize, fuzzy);
     }
     else if (command == "cleanup") {
         // Residue cleanup
@@ -205,7 +739,7 @@ int main(int argc, char* argv[]) {
         copt.removeEmptyDirs = true;
         bool doUndo = false;
         std::string undoDir;
-        for (int i = 3; i < argc; i++) {
+        for (int i = 2; i < argc; i++) {
             std::string arg(argv[i]);
             if (arg.rfind("--simulate=", 0) == 0) {
                 copt.simulateOnly = (arg.substr(11) != "0");
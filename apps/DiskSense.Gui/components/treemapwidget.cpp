@@ -8,6 +8,7 @@
 #include <QDesktopServices>
 #include <QUrl>
 #include <cmath>
+#include <algorithm>
 #include "libs/utils/utils.h"
 
 TreemapWidget::TreemapWidget(QWidget *parent) 
@@ -15,6 +16,7 @@ TreemapWidget::TreemapWidget(QWidget *parent)
     , m_hoveredNode(nullptr)
     , m_zoomLevel(1.0)
     , m_isPanning(false)
+    , m_colorMode(ColorMode::Extension)
 {
     setMouseTracking(true);
 }
@@ -30,6 +32,11 @@ void TreemapWidget::setTreemap(std::unique_ptr<TreemapNode> root) {
     update();
 }
 
+void TreemapWidget::setColorMode(ColorMode mode) {
+    m_colorMode = mode;
+    update();
+}
+
 void TreemapWidget::clear() {
     m_root.reset();
     m_hoveredNode = nullptr;
@@ -65,6 +72,13 @@ void TreemapWidget::drawNode(QPainter& painter, const TreemapNode* node) {
     QColor fillColor = Qt::lightGray;
     if (node->isDirectory) {
         fillColor = Qt::darkGray;
+    } else if (m_colorMode == ColorMode::Compressibility) {
+        const auto& permille = node->fileEntry.compressedPermille;
+        if (permille) {
+            // Hue from green (compresses to nothing) to red (incompressible)
+            const int clamped = std::min<int>(*permille, 1000);
+            fillColor = QColor::fromHsv(120 - clamped * 120 / 1000, 200, 220);
+        }
     } else {
         QString extension = QString::fromStdString(FileUtils::get_file_extension(node->fileEntry.fullPath));
         if (extension == ".txt") {
@@ -13,7 +13,14 @@ public:
     explicit TreemapWidget(QWidget *parent = nullptr);
     ~TreemapWidget();
 
+    // What the fill color of a file shows
+    enum class ColorMode {
+        Extension,
+        Compressibility   // Green for compressible, red for incompressible, gray if not estimated
+    };
+
     void setTreemap(std::unique_ptr<TreemapNode> root);
+    void setColorMode(ColorMode mode);
     void clear();
 
 protected:
@@ -30,6 +37,7 @@ private:
     QPoint m_panOffset;
     QPoint m_lastMousePos;
     bool m_isPanning;
+    ColorMode m_colorMode;
     
     void drawNode(QPainter& painter, const TreemapNode* node);
     TreemapNode* hitTest(const TreemapNode* node, const QPoint& pos) const;
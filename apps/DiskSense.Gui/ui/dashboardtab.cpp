@@ -10,6 +10,7 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QProcess>
+#include <QLocale>
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -25,6 +26,7 @@ DashboardTab::DashboardTab(QWidget *parent)
     , m_systemInfoWidget(nullptr)
     , m_quickStatsWidget(nullptr)
     , m_recentScansWidget(nullptr)
+    , m_compressionSavingsWidget(nullptr)
     , m_quickAccessWidget(nullptr)
     , m_refreshTimer(nullptr)
 {
@@ -50,18 +52,21 @@ void DashboardTab::setupUI() {
     m_systemInfoWidget = new SystemInfoWidget();
     m_quickStatsWidget = new QuickStatsWidget();
     m_recentScansWidget = new RecentScansWidget();
+    m_compressionSavingsWidget = new CompressionSavingsWidget();
     m_quickAccessWidget = new QuickAccessWidget();
     
     // Add widgets to layout
     mainLayout->addWidget(m_systemInfoWidget);
     mainLayout->addWidget(m_quickStatsWidget);
     mainLayout->addWidget(m_recentScansWidget);
+    mainLayout->addWidget(m_compressionSavingsWidget);
     mainLayout->addWidget(m_quickAccessWidget);
     
     // Set stretch factors
     mainLayout->setStretchFactor(m_systemInfoWidget, 1);
     mainLayout->setStretchFactor(m_quickStatsWidget, 1);
     mainLayout->setStretchFactor(m_recentScansWidget, 2);
+    mainLayout->setStretchFactor(m_compressionSavingsWidget, 2);
     mainLayout->setStretchFactor(m_quickAccessWidget, 1);
 }
 
@@ -92,6 +97,10 @@ void DashboardTab::refreshAll() {
     refreshRecentScans();
 }
 
+void DashboardTab::setCompressionSavings(const std::vector<DirectorySavings>& savings) {
+    m_compressionSavingsWidget->updateSavings(savings);
+}
+
 // SystemInfoWidget implementation
 SystemInfoWidget::SystemInfoWidget(QWidget *parent)
     : QGroupBox("System Information", parent)
@@ -279,6 +288,54 @@ void RecentScansWidget::updateScans() {
     m_scansTable->resizeColumnsToContents();
 }
 
+// CompressionSavingsWidget implementation
+CompressionSavingsWidget::CompressionSavingsWidget(QWidget *parent)
+    : QGroupBox("Compression Savings", parent)
+{
+    setupUI();
+    updateSavings({});
+}
+
+void CompressionSavingsWidget::setupUI() {
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    
+    m_totalLabel = new QLabel();
+    
+    m_savingsTable = new QTableWidget(0, 4);
+    m_savingsTable->setHorizontalHeaderLabels(QStringList() << "Directory" << "Files" << "Estimated Ratio" << "Reclaimable");
+    m_savingsTable->horizontalHeader()->setStretchLastSection(true);
+    m_savingsTable->verticalHeader()->setVisible(false);
+    m_savingsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_savingsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    
+    layout->addWidget(m_totalLabel);
+    layout->addWidget(m_savingsTable);
+}
+
+void CompressionSavingsWidget::updateSavings(const std::vector<DirectorySavings>& savings) {
+    m_savingsTable->setRowCount(0);
+    
+    // Ranked by TreemapLayout::rankDirectoriesBySavings, largest first
+    uint64_t total = 0;
+    for (const auto& directory : savings) {
+        int row = m_savingsTable->rowCount();
+        m_savingsTable->insertRow(row);
+        
+        m_savingsTable->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(directory.path)));
+        m_savingsTable->setItem(row, 1, new QTableWidgetItem(QString::number(directory.files)));
+        m_savingsTable->setItem(row, 2, new QTableWidgetItem(QString("%1%").arg(directory.ratio * 100.0, 0, 'f', 1)));
+        m_savingsTable->setItem(row, 3, new QTableWidgetItem(QLocale().formattedDataSize(directory.reclaimable)));
+        total += directory.reclaimable;
+    }
+    
+    if (savings.empty()) {
+        m_totalLabel->setText("No compressibility estimates yet. Check \"Estimate Compressibility\" in the Dedup tab's scan options and scan again.");
+    } else {
+        m_totalLabel->setText(QString("Reclaimable by compression: %1").arg(QLocale().formattedDataSize(total)));
+    }
+    m_savingsTable->resizeColumnsToContents();
+}
+
 // QuickAccessWidget implementation
 QuickAccessWidget::QuickAccessWidget(QWidget *parent)
     : QGroupBox("Quick Access", parent)
@@ -14,10 +14,13 @@
 #include <QDateTime>
 #include <QTimer>
 #include <memory>
+#include <vector>
+#include "core/gfx/treemap.h"
 
 class SystemInfoWidget;
 class QuickStatsWidget;
 class RecentScansWidget;
+class CompressionSavingsWidget;
 class QuickAccessWidget;
 
 class DashboardTab : public QWidget {
@@ -32,6 +35,7 @@ public slots:
     void refreshQuickStats();
     void refreshRecentScans();
     void refreshAll();
+    void setCompressionSavings(const std::vector<DirectorySavings>& savings);
 
 signals:
     void scanRequested(const QString& path);
@@ -45,6 +49,7 @@ private:
     SystemInfoWidget* m_systemInfoWidget;
     QuickStatsWidget* m_quickStatsWidget;
     RecentScansWidget* m_recentScansWidget;
+    CompressionSavingsWidget* m_compressionSavingsWidget;
     QuickAccessWidget* m_quickAccessWidget;
     
     QTimer* m_refreshTimer;
@@ -101,6 +106,21 @@ private:
     QTableWidget* m_scansTable;
 };
 
+// Widget ranking directories by the space compression would reclaim
+class CompressionSavingsWidget : public QGroupBox {
+    Q_OBJECT
+
+public:
+    explicit CompressionSavingsWidget(QWidget *parent = nullptr);
+    void updateSavings(const std::vector<DirectorySavings>& savings);
+
+private:
+    void setupUI();
+    
+    QLabel* m_totalLabel;
+    QTableWidget* m_savingsTable;
+};
+
 // Widget for quick access buttons
 class QuickAccessWidget : public QGroupBox {
     Q_OBJECT
@@ -240,22 +240,41 @@ void MainWindow::setupUI() {
                     QMetaObject::invokeMethod(this, [this]() { m_securityResults->addMessage("Failed to load rules"); }, Qt::QueuedConnection);
                     return;
                 }
+                // All cores, whole tree; matches stream to the UI in batches
                 yara_options_t opt; yara_options_init(&opt);
-                yara_result_t res; int rc = yara_scan_directory(dir.toUtf8().constData(), &opt, &res);
-                size_t matchCount = res.count;
-                // Copy matches pointer for UI thread read (we will free after invoke)
-                yara_match_t* matchPtr = res.matches;
-                QMetaObject::invokeMethod(this, [this, rc, matchCount, matchPtr]() {
+                opt.recursive = 1;
+                struct Sink {
+                    MainWindow* window;
+                    QStringList pending;
+                    size_t count = 0;
+                    void flush() {
+                        if (pending.isEmpty()) return;
+                        QStringList lines; lines.swap(pending);
+                        MainWindow* w = window;
+                        QMetaObject::invokeMethod(w, [w, lines]() {
+                            for (const QString& line : lines) w->m_securityResults->addMessage(line);
+                        }, Qt::QueuedConnection);
+                    }
+                };
+                Sink sink{this, {}};
+                // Callbacks are serialized by the scanner, so the sink needs no lock
+                auto onMatch = [](const char* path, const yara_match_t* m, void* userData) -> int {
+                    Sink* s = static_cast<Sink*>(userData);
+                    s->count++;
+                    s->pending << QString("%1: Rule %2 [%3]: '%4' at %5 len %6 sev %7")
+                        .arg(QString::fromUtf8(path)).arg(m->rule_name).arg(m->rule_namespace).arg(m->matched_string)
+                        .arg((qulonglong)m->offset).arg((qulonglong)m->length).arg(m->severity);
+                    if (s->pending.size() >= 256) s->flush();
+                    return 0;
+                };
+                int rc = yara_scan_directory_stream(nullptr, dir.toUtf8().constData(), &opt, onMatch, &sink);
+                sink.flush();
+                size_t matchCount = sink.count;
+                QMetaObject::invokeMethod(this, [this, rc, matchCount]() {
                     if (rc != 0) { m_securityResults->addMessage("Scan failed."); return; }
                     if (matchCount == 0) { m_securityResults->addMessage("No matches."); return; }
                     m_securityResults->addMessage(QString("Matches: %1").arg(matchCount));
-                    for (size_t i=0;i<matchCount;i++) {
-                        auto& m = matchPtr[i];
-                        m_securityResults->addMessage(QString("Rule %1 [%2]: '%3' at %4 len %5 sev %6")
-                            .arg(m.rule_name).arg(m.rule_namespace).arg(m.matched_string).arg((qulonglong)m.offset).arg((qulonglong)m.length).arg(m.severity));
-                    }
                 }, Qt::QueuedConnection);
-                yara_result_free(&res);
             });
             connect(th, &QThread::finished, th, &QThread::deleteLater);
             th->start();
@@ -502,18 +521,21 @@ void MainWindow::onDashboardScanRequested(const QString& path) {
         if (!m_isScanning) {
             m_isScanning = true; statusBar()->showMessage("Scanning...");
             QString dirPath = path;
-            QThread* scanThread = QThread::create([this, dirPath, out]() {
+            const ScanOptions options = scanOptionsFromUi();
+            QThread* scanThread = QThread::create([this, dirPath, out, options]() {
                 try {
-                    ScanOptions options; options.computeHeadTail = true; options.computeFullHash = false; options.useMftReader = (m_useMftCheck && m_useMftCheck->isChecked());
                     std::string scanPath = FileUtils::to_platform_path(dirPath.toStdString());
                     size_t fileCount = 0;
                     m_scanner->scanVolume(scanPath, options, [this, &fileCount, out](const ScanEvent& event){
-                        if (event.type == ScanEventType::FileAdded) { m_index->put(event.fileEntry); fileCount++; }
+                        if (event.type == ScanEventType::FileAdded) {
+                            m_index->put(event.fileEntry); fileCount++;
+                        }
                         if (fileCount % 250 == 0 && out) {
                             QMetaObject::invokeMethod(out, "addMessage", Qt::QueuedConnection, Q_ARG(QString, QString("Processed %1 files...").arg(fileCount)));
                         }
                     });
                     m_index->flush();
+                    if (options.computeCompressibility) publishCompressionSavings(m_index->getByVolume(1));
                     if (out) QMetaObject::invokeMethod(out, "addMessage", Qt::QueuedConnection, Q_ARG(QString, QString("Scan complete. Files: %1").arg(fileCount)));
                 } catch (...) {}
                 QMetaObject::invokeMethod(this, [this](){ m_isScanning=false; statusBar()->showMessage("Ready"); }, Qt::QueuedConnection);
@@ -579,11 +601,35 @@ void MainWindow::setupDeduplicationTab() {
     QCheckBox* computeHeadTailCheck = new QCheckBox("Compute Head/Tail Signatures");
     computeHeadTailCheck->setChecked(true);
     m_dedupeFullHashCheck = new QCheckBox("Compute Full File Hash (Slow)");
+    m_entropySketchCheck = new QCheckBox("Compute Entropy Sketch (reads whole files)");
     
     optionsLayout->addWidget(m_useMftCheck);
     optionsLayout->addWidget(followLinksCheck);
     optionsLayout->addWidget(computeHeadTailCheck);
     optionsLayout->addWidget(m_dedupeFullHashCheck);
+    optionsLayout->addWidget(m_entropySketchCheck);
+    m_compressibilityCheck = new QCheckBox("Estimate Compressibility (samples 1% of each file)");
+    optionsLayout->addWidget(m_compressibilityCheck);
+    // Archive members are indexed as virtual "archive!/member" files
+    m_scanArchivesCheck = new QCheckBox("Index Archive Contents (zip, tar, 7z, ...)");
+    optionsLayout->addWidget(m_scanArchivesCheck);
+    QHBoxLayout* archiveLayout = new QHBoxLayout();
+    m_archiveDepthSpin = new QSpinBox();
+    m_archiveDepthSpin->setRange(0, 16);
+    m_archiveDepthSpin->setValue(3);
+    m_archiveThreadsSpin = new QSpinBox();
+    m_archiveThreadsSpin->setRange(0, 256);
+    m_archiveThreadsSpin->setValue(0);
+    m_archiveThreadsSpin->setSpecialValueText("Auto");
+    archiveLayout->addWidget(new QLabel("Nested depth:"));
+    archiveLayout->addWidget(m_archiveDepthSpin);
+    archiveLayout->addWidget(new QLabel("Threads:"));
+    archiveLayout->addWidget(m_archiveThreadsSpin);
+    optionsLayout->addLayout(archiveLayout);
+    m_archiveDepthSpin->setEnabled(false);
+    m_archiveThreadsSpin->setEnabled(false);
+    connect(m_scanArchivesCheck, &QCheckBox::toggled, m_archiveDepthSpin, &QSpinBox::setEnabled);
+    connect(m_scanArchivesCheck, &QCheckBox::toggled, m_archiveThreadsSpin, &QSpinBox::setEnabled);
     // Minimum file size (KB)
     QHBoxLayout* minSizeLayout = new QHBoxLayout();
     QLabel* minSizeLbl = new QLabel("Min size (KB):");
@@ -926,16 +972,9 @@ void MainWindow::onScanDirectory() {
     }
     
     // Start scan in a separate thread
-    QThread* scanThread = QThread::create([this, dirPath, currentResults]() {
+    const ScanOptions options = scanOptionsFromUi();
+    QThread* scanThread = QThread::create([this, dirPath, currentResults, options]() {
         try {
-            ScanOptions options;
-            options.computeHeadTail = true;
-            options.computeFullHash = false;
-            options.useMftReader = (m_useMftCheck && m_useMftCheck->isChecked());
-            options.minFileSize = 0;
-            options.maxFileSize = 0;
-            options.includeExtensions.clear();
-            
             std::string scanPath = FileUtils::to_platform_path(dirPath.toStdString());
             
             size_t fileCount = 0;
@@ -972,8 +1011,12 @@ void MainWindow::onScanDirectory() {
                                         Q_ARG(bool, false));
             }
             
-            // After scan, get all files from index and update treemap
+            // After scan, get all files from index and update treemap; the
+            // index entries carry the compressibility estimates
             std::vector<FileEntry> allFiles = m_index->getByVolume(1);
+            if (options.computeCompressibility) {
+                publishCompressionSavings(allFiles);
+            }
             
             if (!allFiles.empty()) {
                 // Limit to first 1000 files to avoid memory issues
@@ -994,7 +1037,10 @@ void MainWindow::onScanDirectory() {
                 
                 std::unique_ptr<TreemapNode> rootNode = TreemapLayout::createTreemap(limitedFiles, Rect(0, 0, 800, 600));
                 if (rootNode) {
-                    QMetaObject::invokeMethod(this, [this, rootNode = std::move(rootNode)]() mutable {
+                    const bool byCompressibility = options.computeCompressibility;
+                    QMetaObject::invokeMethod(this, [this, byCompressibility, rootNode = std::move(rootNode)]() mutable {
+                        m_treemapWidget->setColorMode(byCompressibility ? TreemapWidget::ColorMode::Compressibility
+                                                                        : TreemapWidget::ColorMode::Extension);
                         m_treemapWidget->setTreemap(std::move(rootNode));
                         onUpdateStatus("Visualization complete!");
                     }, Qt::QueuedConnection);
@@ -1254,6 +1300,26 @@ void MainWindow::onGenerateVisualization() {
     }
 }
 
+ScanOptions MainWindow::scanOptionsFromUi() const {
+    ScanOptions options;
+    options.computeHeadTail = true;
+    options.computeFullHash = false;
+    options.useMftReader = m_useMftCheck && m_useMftCheck->isChecked();
+    options.computeEntropySketch = m_entropySketchCheck && m_entropySketchCheck->isChecked();
+    options.computeCompressibility = m_compressibilityCheck && m_compressibilityCheck->isChecked();
+    options.scanArchives = m_scanArchivesCheck && m_scanArchivesCheck->isChecked();
+    if (m_archiveDepthSpin) options.archiveMaxDepth = m_archiveDepthSpin->value();
+    if (m_archiveThreadsSpin) options.archiveThreads = static_cast<unsigned>(m_archiveThreadsSpin->value());
+    return options;
+}
+
+void MainWindow::publishCompressionSavings(const std::vector<FileEntry>& files) {
+    std::vector<DirectorySavings> savings = TreemapLayout::rankDirectoriesBySavings(files, 50);
+    QMetaObject::invokeMethod(this, [this, savings = std::move(savings)]() {
+        if (m_dashboardTab) m_dashboardTab->setCompressionSavings(savings);
+    }, Qt::QueuedConnection);
+}
+
 void MainWindow::onFindDuplicates() {
     if (!m_index) return;
     m_dedupResults->clear();
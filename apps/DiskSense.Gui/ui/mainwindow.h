@@ -6,6 +6,7 @@
 #include <QVBoxLayout>
 #include <QWidget>
 #include <memory>
+#include <vector>
 #include "core/ops/cleanup.h"
 
 class Scanner;
@@ -20,6 +21,8 @@ class QSpinBox;
 class QRadioButton;
 class ChartWidget;
 struct SecureDeleteOptions;
+struct ScanOptions;
+struct FileEntry;
 class QTableWidget;
 class QDockWidget;
 
@@ -55,6 +58,10 @@ private:
     void setupVisualizationTab();
     void setupResidueTab();
     void setupSimilarityTab();
+    // Scan options from the Dedup tab checkboxes (call on the GUI thread)
+    ScanOptions scanOptionsFromUi() const;
+    // Rank the scanned files' compression savings into the dashboard (any thread)
+    void publishCompressionSavings(const std::vector<FileEntry>& files);
     
     QTabWidget* m_tabWidget;
     
@@ -94,6 +101,11 @@ private:
     QRadioButton* m_dedupeDeleteRadio;
     QLineEdit* m_dedupeDirEdit;
     QCheckBox* m_useMftCheck;
+    QCheckBox* m_entropySketchCheck;
+    QCheckBox* m_scanArchivesCheck;
+    QSpinBox* m_archiveDepthSpin;
+    QSpinBox* m_archiveThreadsSpin;
+    QCheckBox* m_compressibilityCheck;
     QCheckBox* m_liveMonitorCheck;
 
     // Monitor runtime
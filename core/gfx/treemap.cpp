@@ -23,6 +23,8 @@ std::unique_ptr<TreemapNode> TreemapLayout::createTreemap(const std::vector<File
         child->name = file.fullPath;
         child->isDirectory = file.attributes.directory;
         child->totalSize = file.sizeLogical;
+        child->reclaimable = reclaimableBytes(file);
+        root->reclaimable += child->reclaimable;
         root->children.push_back(std::move(child));
         root->totalSize += file.sizeLogical;
     }
@@ -141,6 +143,47 @@ std::vector<TreemapNode*> TreemapLayout::getPathToNode(TreemapNode& root, Treema
     return path;
 }
 
+uint64_t TreemapLayout::reclaimableBytes(const FileEntry& file) {
+    if (!file.compressedPermille || *file.compressedPermille >= 1000) {
+        return 0;
+    }
+    return file.sizeLogical / 1000 * (1000 - *file.compressedPermille) +
+           file.sizeLogical % 1000 * (1000 - *file.compressedPermille) / 1000;
+}
+
+std::vector<DirectorySavings> TreemapLayout::rankDirectoriesBySavings(const std::vector<FileEntry>& files,
+                                                                      size_t limit) {
+    std::map<std::string, DirectorySavings> byDirectory;
+    for (const auto& file : files) {
+        if (!file.compressedPermille || file.attributes.directory) {
+            continue;
+        }
+        const size_t slash = file.fullPath.find_last_of("/\\");
+        const std::string dir = slash == std::string::npos ? std::string() : file.fullPath.substr(0, slash);
+        DirectorySavings& savings = byDirectory[dir];
+        savings.path = dir;
+        savings.totalSize += file.sizeLogical;
+        savings.reclaimable += reclaimableBytes(file);
+        savings.files++;
+    }
+
+    std::vector<DirectorySavings> ranked;
+    ranked.reserve(byDirectory.size());
+    for (auto& [dir, savings] : byDirectory) {
+        if (savings.totalSize > 0) {
+            savings.ratio = 1.0 - static_cast<double>(savings.reclaimable) / static_cast<double>(savings.totalSize);
+        }
+        ranked.push_back(std::move(savings));
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const DirectorySavings& a, const DirectorySavings& b) {
+        return a.reclaimable != b.reclaimable ? a.reclaimable > b.reclaimable : a.path < b.path;
+    });
+    if (limit > 0 && ranked.size() > limit) {
+        ranked.resize(limit);
+    }
+    return ranked;
+}
+
 double TreemapLayout::worstAspectRatio(const std::vector<TreemapNode*>& row, double totalArea, double width) {
     if (row.empty() || width == 0 || totalArea == 0) return 0.0;
 
@@ -28,12 +28,24 @@ struct TreemapNode {
     std::vector<std::unique_ptr<TreemapNode>> children;
     bool isDirectory;
     uint64_t totalSize; // For directories, includes children
+    uint64_t reclaimable; // Estimated bytes saved by compression, includes children
     
-    TreemapNode() : isDirectory(false), totalSize(0) {}
+    TreemapNode() : isDirectory(false), totalSize(0), reclaimable(0) {}
     
     bool isLeaf() const { return children.empty(); }
 };
 
+// Estimated compression savings of the files directly in one directory
+struct DirectorySavings {
+    std::string path;
+    uint64_t totalSize;   // Bytes of the estimated files
+    uint64_t reclaimable; // Bytes saved if they were compressed
+    size_t files;
+    double ratio;         // Compressed over original size (1.0 = nothing to gain)
+
+    DirectorySavings() : totalSize(0), reclaimable(0), files(0), ratio(1.0) {}
+};
+
 // Treemap layout algorithm
 class TreemapLayout {
 public:
@@ -49,6 +61,15 @@ public:
     
     // Get path from root to node
     static std::vector<TreemapNode*> getPathToNode(TreemapNode& root, TreemapNode* target);
+
+    // Estimated bytes saved by compressing a file (0 if not estimated)
+    static uint64_t reclaimableBytes(const FileEntry& file);
+
+    // Directories ranked by reclaimable bytes, largest first; files without
+    // an estimate are left out
+    // limit: most directories returned (0 = all)
+    static std::vector<DirectorySavings> rankDirectoriesBySavings(const std::vector<FileEntry>& files,
+                                                                  size_t limit = 0);
     
 private:
     // Helper functions for squarified layout
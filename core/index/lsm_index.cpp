@@ -15,6 +15,7 @@
 #include <condition_variable>
 #include "libs/chash/sha256.h"
 #include "libs/chash/blake3.h"
+#include "libs/encryption/entropy.h"
 #include "libs/utils/utils.h"
 
 // LSMIndex implementation
@@ -48,6 +49,15 @@ std::vector<FileEntry> LSMIndex::getBySize(uint64_t size) const {
     return std::vector<FileEntry>();
 }
 
+std::vector<FileEntry> LSMIndex::getHighEntropy(VolumeId volumeId, double minFraction) const {
+    std::vector<FileEntry> files = m_impl->getByVolume(volumeId);
+    files.erase(std::remove_if(files.begin(), files.end(), [minFraction](const FileEntry& file) {
+        return !file.entropySketch || file.entropySketch->size() != ENCRYPTION_ENTROPY_SKETCH_SIZE ||
+               encryption_entropy_sketch_high_fraction(file.entropySketch->data()) < minFraction;
+    }), files.end());
+    return files;
+}
+
 void LSMIndex::flush() {
     m_impl->flush();
 }
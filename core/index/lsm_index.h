@@ -43,6 +43,10 @@ public:
     // Range query by size
     std::vector<FileEntry> getBySize(uint64_t size) const;
 
+    // Files of a volume whose entropy sketch has at least minFraction of its
+    // blocks in the high-entropy band (encrypted or already compressed)
+    std::vector<FileEntry> getHighEntropy(VolumeId volumeId, double minFraction) const;
+
     // Flush memtable to disk
     void flush();
 
@@ -58,8 +58,12 @@ struct FileEntry {
 
     // Signatures
     std::optional<std::vector<uint8_t>> headTail16;  // 16KB head + 16KB tail hash
-    std::optional<std::vector<uint8_t>> sha256;      // Full file SHA-256 hash
+    // Full content hash. Despite the name this is BLAKE3-256, for regular files
+    // and for archive members (attributes.virtualFile) alike
+    std::optional<std::vector<uint8_t>> sha256;
     std::optional<std::vector<uint8_t>> perceptualHash; // Image/audio perceptual hash
+    std::optional<std::vector<uint8_t>> entropySketch;  // 33-byte summary of the 4KB block entropy map
+    std::optional<uint16_t> compressedPermille;         // Estimated compressed size, in 1/1000 of sizeLogical
 
     // Media information
     std::optional<std::pair<uint32_t, uint32_t>> imageDimensions; // width x height
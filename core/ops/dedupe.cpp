@@ -2,11 +2,39 @@
 #include <iostream>
 #include <algorithm>
 #include <unordered_map>
+#include <atomic>
+#include <thread>
 #include "libs/chash/blake3.h"
 #include "libs/utils/utils.h"
 #include "core/safety/safety.h"
 #include "platform/util/trash.h"
 
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+
+namespace {
+
+// Files that exist on their own. Archive members only show where else the
+// content is kept; they are never linked, cloned, moved or deleted.
+std::vector<FileEntry> looseFiles(const std::vector<FileEntry>& files) {
+    std::vector<FileEntry> loose;
+    for (const auto& file : files) {
+        if (!file.attributes.virtualFile) {
+            loose.push_back(file);
+        }
+    }
+    return loose;
+}
+
+} // namespace
+
 Deduplicator::Deduplicator(LSMIndex& index) : m_index(index) {
 }
 
@@ -14,14 +42,26 @@ Deduplicator::~Deduplicator() {
 }
 
 std::vector<DuplicateGroup> Deduplicator::findDuplicates(const DedupeOptions& options) {
+    // Group files by size (first filter)
+    return findInSizeGroups(groupBySize(), options);
+}
+
+std::vector<DuplicateGroup> Deduplicator::findDuplicatesForTesting(const std::vector<FileEntry>& files,
+                                                                   const DedupeOptions& options) {
+    std::map<uint64_t, std::vector<FileEntry>> sizeGroups;
+    for (const auto& file : files) {
+        sizeGroups[file.sizeLogical].push_back(file);
+    }
+    return findInSizeGroups(sizeGroups, options);
+}
+
+std::vector<DuplicateGroup> Deduplicator::findInSizeGroups(
+    const std::map<uint64_t, std::vector<FileEntry>>& sizeGroups, const DedupeOptions& options) {
     std::vector<DuplicateGroup> groups;
     
     // Reset statistics
     m_stats = DedupeStats();
     
-    // Group files by size (first filter)
-    auto sizeGroups = groupBySize();
-    
     // Process each size group
     for (const auto& [size, files] : sizeGroups) {
         if (size < options.minFileSize) {
@@ -43,9 +83,16 @@ std::vector<DuplicateGroup> Deduplicator::findDuplicates(const DedupeOptions& op
             continue;
         }
         
-        // Compute full hashes if requested or if group is still large
+        // Archive members (and files hashed during the scan) are keyed by
+        // their full hash; the others need one too to be grouped with them
+        const bool anyFullHash = std::any_of(filteredFiles.begin(), filteredFiles.end(), [](const FileEntry& file) {
+            return file.attributes.virtualFile || (file.sha256.has_value() && !file.sha256->empty());
+        });
+        
+        // Compute full hashes if requested, if group is still large or if
+        // some candidates already carry one
         std::vector<FileEntry> hashVerifiedFiles;
-        if (options.computeFullHash || filteredFiles.size() > 10) {
+        if (options.computeFullHash || filteredFiles.size() > 10 || anyFullHash) {
             hashVerifiedFiles = computeFullHashes(filteredFiles);
         } else {
             hashVerifiedFiles = filteredFiles;
@@ -60,13 +107,16 @@ std::vector<DuplicateGroup> Deduplicator::findDuplicates(const DedupeOptions& op
                 continue;
             }
             
+            // Only loose copies beyond the first can be reclaimed
+            const size_t looseCount = looseFiles(groupFiles).size();
             DuplicateGroup group;
             group.files = groupFiles;
-            group.potentialSavings = (groupFiles.size() - 1) * size;
+            group.potentialSavings = looseCount > 1 ? (looseCount - 1) * size : 0;
             
             groups.push_back(group);
             m_stats.duplicateGroups++;
             m_stats.duplicateFiles += groupFiles.size();
+            m_stats.archivedCopies += groupFiles.size() - looseCount;
             m_stats.potentialSavings += group.potentialSavings;
         }
     }
@@ -78,10 +128,40 @@ DedupeStats Deduplicator::deduplicate(const std::vector<DuplicateGroup>& groups,
     // Reset actual savings counter
     m_stats.actualSavings = 0;
     m_stats.hardlinksCreated = 0;
+    m_stats.clonesCreated = 0;
+    m_stats.clonesAlreadyShared = 0;
+    m_stats.bytesCloned = 0;
+    m_stats.clonePairs.clear();
+    
+    // Extent sharing never removes or rewrites a file (the kernel compares the
+    // ranges itself), so it is allowed even when Safety Mode blocks deletions
+    if (options.useClone && !options.simulateOnly) {
+        std::vector<std::vector<ClonePairResult>> results;
+        cloneDuplicates(groups, options.cloneThreads, results);
+        for (auto& pairs : results) {
+            for (auto& pair : pairs) {
+                // The kernel reports ranges that already shared extents as
+                // deduped too; they free nothing
+                const uint64_t newlyShared = pair.bytesShared - pair.bytesAlreadyShared;
+                m_stats.bytesCloned += newlyShared;
+                if (pair.shared) {
+                    if (newlyShared > 0) {
+                        m_stats.clonesCreated++;
+                    } else {
+                        m_stats.clonesAlreadyShared++;
+                    }
+                }
+                m_stats.clonePairs.push_back(std::move(pair));
+            }
+        }
+        m_stats.actualSavings = m_stats.bytesCloned;
+        return m_stats;
+    }
     
     // Process each group
     for (const auto& group : groups) {
-        if (group.files.size() < 2) {
+        const std::vector<FileEntry> files = looseFiles(group.files);
+        if (files.size() < 2) {
             continue;
         }
         
@@ -94,21 +174,21 @@ DedupeStats Deduplicator::deduplicate(const std::vector<DuplicateGroup>& groups,
         }
         
         // Determine action based on options
-        if (options.useHardlinks && areOnSameVolume(group.files)) {
+        if (options.useHardlinks && areOnSameVolume(files)) {
             // Create hardlinks
-            if (createHardlinks(group.files)) {
+            if (createHardlinks(files)) {
                 m_stats.actualSavings += group.potentialSavings;
-                m_stats.hardlinksCreated += group.files.size() - 1;
+                m_stats.hardlinksCreated += files.size() - 1;
             }
         } else if (options.moveToRecycleBin) {
             // Move duplicates to recycle bin
-            if (moveToRecycleBin({group.files.begin() + 1, group.files.end()})) {
+            if (moveToRecycleBin({files.begin() + 1, files.end()})) {
                 m_stats.actualSavings += group.potentialSavings;
             }
         } else {
             // Delete duplicates (only if allowed by Safety Mode)
             if (!safety_blocks_delete) {
-                if (deleteFiles({group.files.begin() + 1, group.files.end()})) {
+                if (deleteFiles({files.begin() + 1, files.end()})) {
                     m_stats.actualSavings += group.potentialSavings;
                 }
             }
@@ -241,6 +321,269 @@ bool Deduplicator::createHardlinks(const std::vector<FileEntry>& group) {
     return success;
 }
 
+#ifdef __linux__
+namespace dedupe_detail {
+
+// The kernel rejects requests whose header plus info array exceeds a page,
+// and btrfs silently truncates each range to 16 MiB
+const size_t kMaxDedupeDests = (4096 - sizeof(file_dedupe_range)) / sizeof(file_dedupe_range_info);
+const uint64_t kDedupeChunk = 16ull * 1024 * 1024;
+
+int submitDedupe(int srcFd, file_dedupe_range* request) {
+    return ioctl(srcFd, FIDEDUPERANGE, request);
+}
+
+// Every chunk is submitted for all destinations of a batch still matching in
+// a single request; a destination drops out at its first differing or failed
+// range.
+void dedupeBatch(int srcFd, uint64_t size, const std::vector<int>& destFds,
+                 const DedupeSubmit& submit, ClonePairResult* results) {
+    std::vector<uint8_t> buf(sizeof(file_dedupe_range) +
+                             std::min(destFds.size(), kMaxDedupeDests) * sizeof(file_dedupe_range_info));
+    auto* req = reinterpret_cast<file_dedupe_range*>(buf.data());
+    std::vector<size_t> slot;      // info index -> destination
+
+    for (size_t first = 0; first < destFds.size(); first += kMaxDedupeDests) {
+        const size_t last = std::min(destFds.size(), first + kMaxDedupeDests);
+        std::vector<bool> alive(destFds.size(), false);
+        std::fill(alive.begin() + first, alive.begin() + last, true);
+        size_t remaining = last - first;
+
+        for (uint64_t offset = 0; offset < size && remaining > 0; ) {
+            uint64_t length = std::min(kDedupeChunk, size - offset);
+            std::fill(buf.begin(), buf.end(), 0);
+            req->src_offset = offset;
+            req->src_length = length;
+            slot.clear();
+            for (size_t d = first; d < last; d++) {
+                if (!alive[d]) continue;
+                file_dedupe_range_info& info = req->info[slot.size()];
+                info.dest_fd = destFds[d];
+                info.dest_offset = offset;
+                slot.push_back(d);
+            }
+            req->dest_count = static_cast<uint16_t>(slot.size());
+
+            if (submit(srcFd, req) != 0) {
+                // EOPNOTSUPP, EINVAL (unaligned/unsupported fs), EXDEV...
+                const int error = errno;
+                for (size_t d : slot) {
+                    results[d].error = error;
+                    alive[d] = false;
+                }
+                remaining = 0;
+                break;
+            }
+
+            // A filesystem may share less than asked; advance by the shortest
+            // result so no destination is counted twice for the same bytes
+            uint64_t advance = length;
+            for (size_t k = 0; k < slot.size(); k++) {
+                const file_dedupe_range_info& info = req->info[k];
+                ClonePairResult& result = results[slot[k]];
+                if (info.status == FILE_DEDUPE_RANGE_SAME && info.bytes_deduped > 0) {
+                    advance = std::min<uint64_t>(advance, info.bytes_deduped);
+                    continue;
+                }
+                if (info.status == FILE_DEDUPE_RANGE_DIFFERS) {
+                    result.differs = true;
+                } else if (info.status < 0) {
+                    result.error = -info.status;
+                }
+                alive[slot[k]] = false;
+                remaining--;
+            }
+            for (size_t d = first; d < last; d++) {
+                if (alive[d]) results[d].bytesShared += advance;
+            }
+            offset += advance;
+        }
+
+        for (size_t d = first; d < last; d++) {
+            if (alive[d]) results[d].shared = true;
+        }
+    }
+}
+
+bool fileExtents(int fd, std::vector<Extent>& extents) {
+    extents.clear();
+    const unsigned kBatch = 128;
+    std::vector<uint8_t> buf(sizeof(fiemap) + kBatch * sizeof(fiemap_extent));
+    auto* map = reinterpret_cast<fiemap*>(buf.data());
+    for (uint64_t start = 0; ; ) {
+        std::fill(buf.begin(), buf.end(), 0);
+        map->fm_start = start;
+        map->fm_length = FIEMAP_MAX_OFFSET - start;
+        map->fm_flags = FIEMAP_FLAG_SYNC;
+        map->fm_extent_count = kBatch;
+        if (ioctl(fd, FS_IOC_FIEMAP, map) != 0) return false;
+        if (map->fm_mapped_extents == 0) return true;
+        bool last = false;
+        for (unsigned i = 0; i < map->fm_mapped_extents; i++) {
+            const fiemap_extent& e = map->fm_extents[i];
+            last = last || (e.fe_flags & FIEMAP_EXTENT_LAST) != 0;
+            start = e.fe_logical + e.fe_length;
+            // Delayed, inline and tail-packed data has no blocks of its own
+            if (e.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC |
+                              FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_NOT_ALIGNED)) {
+                continue;
+            }
+            extents.push_back({e.fe_logical, e.fe_physical, e.fe_length,
+                               (e.fe_flags & FIEMAP_EXTENT_ENCODED) != 0});
+        }
+        if (last) return true;
+    }
+}
+
+uint64_t sharedBytes(const std::vector<Extent>& a, const std::vector<Extent>& b, uint64_t limit) {
+    uint64_t shared = 0;
+    for (size_t i = 0, j = 0; i < a.size() && j < b.size(); ) {
+        const Extent& x = a[i];
+        const Extent& y = b[j];
+        const uint64_t lo = std::max(x.logical, y.logical);
+        if (lo >= limit) break;
+        const uint64_t hi = std::min({x.logical + x.length, y.logical + y.length, limit});
+        if (lo < hi) {
+            // Encoded extents are shared whole or not at all
+            const bool same = (x.encoded || y.encoded)
+                ? x.logical == y.logical && x.physical == y.physical && x.length == y.length
+                : x.physical + (lo - x.logical) == y.physical + (lo - y.logical);
+            if (same) shared += hi - lo;
+        }
+        if (x.logical + x.length <= y.logical + y.length) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return shared;
+}
+
+} // namespace dedupe_detail
+#endif
+
+void Deduplicator::cloneDuplicates(const std::vector<DuplicateGroup>& groups, unsigned numThreads,
+                                   std::vector<std::vector<ClonePairResult>>& results) const {
+    results.assign(groups.size(), {});
+#ifdef __linux__
+    // Partition groups by the filesystem holding their source; destinations on
+    // another device cannot share its extents and are skipped
+    std::vector<std::vector<FileEntry>> loose(groups.size());
+    std::map<dev_t, std::vector<size_t>> byDevice;
+    for (size_t g = 0; g < groups.size(); g++) {
+        loose[g] = looseFiles(groups[g].files);
+        struct stat st;
+        if (loose[g].size() >= 2 && stat(loose[g][0].fullPath.c_str(), &st) == 0) {
+            byDevice[st.st_dev].push_back(g);
+        }
+    }
+    if (byDevice.empty()) return;
+
+    std::vector<const std::vector<size_t>*> work;
+    for (const auto& [dev, list] : byDevice) work.push_back(&list);
+
+    auto cloneGroup = [&](size_t g) {
+        const auto& files = loose[g];
+        const FileEntry& source = files[0];
+        int srcFd = open(source.fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (srcFd < 0) return;
+        struct stat srcSt;
+        if (fstat(srcFd, &srcSt) != 0 || !S_ISREG(srcSt.st_mode)) { close(srcFd); return; }
+        const uint64_t size = static_cast<uint64_t>(srcSt.st_size);
+        std::vector<dedupe_detail::Extent> srcExtents;
+        const bool srcMapped = dedupe_detail::fileExtents(srcFd, srcExtents);
+
+        // Destinations are opened one request's worth at a time
+        std::vector<int> destFds;
+        std::vector<ClonePairResult> batch;
+        std::vector<std::vector<dedupe_detail::Extent>> batchExtents;
+        auto flush = [&]() {
+            if (!destFds.empty()) {
+                dedupe_detail::dedupeBatch(srcFd, size, destFds, dedupe_detail::submitDedupe, batch.data());
+            }
+            for (int fd : destFds) close(fd);
+            destFds.clear();
+            for (size_t i = 0; i < batch.size(); i++) {
+                batch[i].bytesAlreadyShared =
+                    dedupe_detail::sharedBytes(srcExtents, batchExtents[i], batch[i].bytesShared);
+                results[g].push_back(std::move(batch[i]));
+            }
+            batch.clear();
+            batchExtents.clear();
+        };
+        for (size_t i = 1; i < files.size(); i++) {
+            ClonePairResult result;
+            result.source = source.fullPath;
+            result.destination = files[i].fullPath;
+            // Owners may dedupe into read-only descriptors (Linux >= 4.19);
+            // older kernels need the destination open for writing
+            int fd = open(files[i].fullPath.c_str(), O_RDWR | O_CLOEXEC);
+            if (fd < 0) fd = open(files[i].fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                result.error = errno;
+                results[g].push_back(std::move(result));
+                continue;
+            }
+            // The same inode (a hardlink) is not a pair
+            struct stat st;
+            if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_ino == srcSt.st_ino) {
+                close(fd);
+                continue;
+            }
+            if (st.st_dev != srcSt.st_dev || static_cast<uint64_t>(st.st_size) != size) {
+                if (st.st_dev != srcSt.st_dev) {
+                    result.error = EXDEV;
+                } else {
+                    result.differs = true;
+                }
+                results[g].push_back(std::move(result));
+                close(fd);
+                continue;
+            }
+            // A destination already using all of the source's blocks (a
+            // previous run, a reflink copy) is not submitted again
+            std::vector<dedupe_detail::Extent> extents;
+            if (srcMapped && !dedupe_detail::fileExtents(fd, extents)) extents.clear();
+            const uint64_t already = dedupe_detail::sharedBytes(srcExtents, extents, size);
+            if (size > 0 && already == size) {
+                result.bytesShared = size;
+                result.bytesAlreadyShared = size;
+                result.shared = true;
+                results[g].push_back(std::move(result));
+                close(fd);
+                continue;
+            }
+            destFds.push_back(fd);
+            batch.push_back(std::move(result));
+            batchExtents.push_back(std::move(extents));
+            if (destFds.size() == dedupe_detail::kMaxDedupeDests) flush();
+        }
+        flush();
+        close(srcFd);
+    };
+
+    unsigned threads = numThreads ? numThreads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, work.size()));
+
+    // One filesystem per worker at a time: parallel devices, sequential I/O within each
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t w; (w = next.fetch_add(1)) < work.size(); ) {
+            for (size_t g : *work[w]) cloneGroup(g);
+        }
+    };
+    if (threads <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; t++) pool.emplace_back(worker);
+        for (auto& th : pool) th.join();
+    }
+#else
+    (void)numThreads;
+#endif
+}
+
 bool Deduplicator::moveToRecycleBin(const std::vector<FileEntry>& files) {
     bool allOk = true;
     for (const auto& fe : files) {
@@ -11,12 +11,23 @@
 
 // Duplicate detection result
 struct DuplicateGroup {
-    std::vector<FileEntry> files;
+    std::vector<FileEntry> files;  // May include archive members (virtual files), which are never modified
     uint64_t potentialSavings; // Bytes that could be saved by deduplication
     
     DuplicateGroup() : potentialSavings(0) {}
 };
 
+// Outcome of sharing one duplicate's extents with its group's source
+struct ClonePairResult {
+    std::string source;
+    std::string destination;
+    uint64_t bytesShared = 0;  // Bytes the kernel verified identical and shared
+    uint64_t bytesAlreadyShared = 0; // Part of bytesShared that used the source's extents beforehand
+    bool shared = false;       // The whole file now shares the source's extents
+    bool differs = false;      // The kernel found differing content
+    int error = 0;             // errno that stopped it (EOPNOTSUPP, EINVAL, EXDEV...), 0 if none
+};
+
 // Deduplication statistics
 struct DedupeStats {
     uint64_t totalFiles;
@@ -25,15 +36,23 @@ struct DedupeStats {
     uint64_t potentialSavings; // Bytes
     uint64_t actualSavings;    // Bytes actually saved
     uint64_t hardlinksCreated;
+    uint64_t clonesCreated;    // Duplicates whose extents now fully share the source's
+    uint64_t clonesAlreadyShared; // Duplicates that fully shared the source's extents before the run
+    uint64_t bytesCloned;      // Bytes newly shared (ranges already sharing extents are not counted)
+    uint64_t archivedCopies;   // Duplicates that are archive members (virtual files)
+    std::vector<ClonePairResult> clonePairs; // One per duplicate submitted for extent sharing
     
     DedupeStats() : totalFiles(0), duplicateGroups(0), duplicateFiles(0),
-                    potentialSavings(0), actualSavings(0), hardlinksCreated(0) {}
+                    potentialSavings(0), actualSavings(0), hardlinksCreated(0),
+                    clonesCreated(0), clonesAlreadyShared(0), bytesCloned(0), archivedCopies(0) {}
 };
 
 // Deduplication options
 struct DedupeOptions {
     bool simulateOnly = true;          // Only simulate, don't actually deduplicate
     bool useHardlinks = false;         // Create hardlinks for duplicates on same volume
+    bool useClone = false;             // Share extents with FIDEDUPERANGE (Linux btrfs/XFS); files stay independent
+    unsigned cloneThreads = 0;         // Clone workers (one filesystem each); 0 = hardware threads
     bool moveToRecycleBin = false;     // Move duplicates to recycle bin instead of deleting
     bool computeFullHash = false;      // Compute full hash for all candidates (slower but more accurate)
     uint64_t minFileSize = 1024;       // Minimum file size to consider for deduplication
@@ -57,6 +76,9 @@ public:
     
     // Testing helper: compute full hashes for provided entries (returns entries with hashes set)
     std::vector<FileEntry> computeHashesForTesting(const std::vector<FileEntry>& candidates) const { return computeFullHashes(candidates); }
+    
+    // Testing helper: find duplicates among the provided entries instead of the index
+    std::vector<DuplicateGroup> findDuplicatesForTesting(const std::vector<FileEntry>& files, const DedupeOptions& options);
 
 private:
     LSMIndex& m_index;
@@ -65,6 +87,10 @@ private:
     // Group files by size
     std::map<uint64_t, std::vector<FileEntry>> groupBySize() const;
     
+    // Find duplicates within each size group
+    std::vector<DuplicateGroup> findInSizeGroups(const std::map<uint64_t, std::vector<FileEntry>>& sizeGroups,
+                                                 const DedupeOptions& options);
+    
     // Filter candidates using head/tail signatures
     std::vector<FileEntry> filterByHeadTail(const std::vector<FileEntry>& candidates) const;
     
@@ -77,6 +103,11 @@ private:
     // Create hardlinks for duplicates
     bool createHardlinks(const std::vector<FileEntry>& group);
     
+    // Share the first file's extents with the others (kernel-verified, non-destructive).
+    // Runs one worker per filesystem; results[g] receives group g's pairs.
+    void cloneDuplicates(const std::vector<DuplicateGroup>& groups, unsigned numThreads,
+                         std::vector<std::vector<ClonePairResult>>& results) const;
+    
     // Move files to recycle bin
     bool moveToRecycleBin(const std::vector<FileEntry>& files);
     
@@ -91,4 +122,47 @@ private:
                          const std::vector<FileEntry>& newFiles);
 };
 
+#ifdef __linux__
+#include <functional>
+
+struct file_dedupe_range;
+
+// FIDEDUPERANGE batching, exposed for testing
+namespace dedupe_detail {
+
+// Destinations per request (the kernel rejects requests larger than a page)
+extern const size_t kMaxDedupeDests;
+// Bytes per range (btrfs silently truncates longer ranges)
+extern const uint64_t kDedupeChunk;
+
+// Submits one request; returns 0, or -1 with errno set
+using DedupeSubmit = std::function<int(int srcFd, file_dedupe_range* request)>;
+
+// The FIDEDUPERANGE ioctl
+int submitDedupe(int srcFd, file_dedupe_range* request);
+
+// Dedupe one source against open destinations, kMaxDedupeDests per request
+// and kDedupeChunk bytes at a time. results[i] receives the outcome for
+// destFds[i]; its paths are left to the caller.
+void dedupeBatch(int srcFd, uint64_t size, const std::vector<int>& destFds,
+                 const DedupeSubmit& submit, ClonePairResult* results);
+
+// One mapped extent as reported by FS_IOC_FIEMAP
+struct Extent {
+    uint64_t logical;
+    uint64_t physical;
+    uint64_t length;
+    bool encoded;   // Compressed or encrypted: offsets inside it do not map linearly
+};
+
+// Mapped extents of an open file in logical order; false if the filesystem
+// cannot report them
+bool fileExtents(int fd, std::vector<Extent>& extents);
+
+// Bytes of [0, limit) that both files keep in the same physical blocks
+uint64_t sharedBytes(const std::vector<Extent>& a, const std::vector<Extent>& b, uint64_t limit);
+
+} // namespace dedupe_detail
+#endif
+
 #endif // CORE_OPS_DEDUPE_H
@@ -5,6 +5,11 @@
 #include <chrono>
 #include "libs/chash/sha256.h"
 #include "libs/chash/blake3.h"
+#include "libs/compression/archive_hash.h"
+#include "libs/compression/compressibility.h"
+#include "libs/digest/digest.h"
+#include "libs/encryption/entropy.h"
+#include "libs/phash/phash_optimized.h"
 #include "libs/utils/utils.h"
 #ifdef _WIN32
 #include "win_mft.h"
@@ -27,6 +32,7 @@ void Scanner::scanVolume(const std::string& volumePath,
     }
 
     m_cancelled = false;
+    m_archives.clear();
 
     // Windows fast path: MFT enumerator when requested
 #ifdef _WIN32
@@ -42,6 +48,10 @@ void Scanner::scanVolume(const std::string& volumePath,
     scanDirectory(volumePath, options, callback);
 #endif
 
+    if (options.scanArchives && !m_archives.empty()) {
+        indexArchiveMembers(options, callback);
+    }
+
     m_scanning = false;
 }
 
@@ -172,8 +182,19 @@ void Scanner::processFile(const std::string& path,
         entry.headTail16 = computeHeadTailSignature(path);
     }
 
-    if (options.computeFullHash && fileSize > 0) {
-        entry.sha256 = computeFullHash(path);
+    if ((options.computeFullHash || options.computeEntropySketch) && fileSize > 0) {
+        computeContentSignatures(path, options, entry);
+    }
+
+    if (options.computeCompressibility && fileSize > 0) {
+        entry.compressedPermille = computeCompressibility(path, entry);
+    }
+
+    if (options.computePerceptualHash && fileSize > 0) {
+        auto phash = computePerceptualHash(path);
+        if (!phash.empty()) {
+            entry.perceptualHash = std::move(phash);
+        }
     }
 
     // Extract file ID
@@ -182,6 +203,58 @@ void Scanner::processFile(const std::string& path,
     // Create scan event
     ScanEvent event(ScanEventType::FileAdded, entry);
     callback(event);
+
+    if (options.scanArchives && archive_hash_is_archive_file(path.c_str())) {
+        m_archives.push_back(path);
+    }
+}
+
+void Scanner::indexArchiveMembers(const ScanOptions& options,
+                                  std::function<void(const ScanEvent&)> callback) {
+    std::vector<const char*> paths;
+    paths.reserve(m_archives.size());
+    for (const auto& path : m_archives) {
+        paths.push_back(path.c_str());
+    }
+
+    archive_hash_options_t hashOptions;
+    archive_hash_options_init(&hashOptions);
+    hashOptions.max_depth = options.archiveMaxDepth;
+    hashOptions.num_threads = options.archiveThreads;
+
+    // Damaged archives still give the members read before the damage
+    archive_hash_result_t result;
+    archive_hash_files(paths.data(), paths.size(), &hashOptions, &result);
+
+    for (size_t i = 0; i < result.count && !m_cancelled; i++) {
+        const archive_member_hash_t& member = result.members[i];
+        if ((options.minFileSize > 0 && member.size < options.minFileSize) ||
+            (options.maxFileSize > 0 && member.size > options.maxFileSize) ||
+            !matchesExtension(member.path, options)) {
+            continue;
+        }
+
+        FileEntry entry;
+        entry.volumeId = 1;
+        entry.pathId = std::hash<std::string>{}(member.path);
+        entry.fileId = entry.pathId; // Members have no file ID of their own
+        entry.fullPath = member.path;
+        entry.sizeLogical = member.size;
+        entry.sizeOnDisk = 0;        // Stored inside the archive's clusters
+        entry.attributes.virtualFile = true;
+        entry.timestamps.lastWriteTime = member.mtime;
+        entry.timestamps.changeTime = member.mtime;
+
+        // The member cannot be read again later, so its full hash is always kept
+        if (options.computeHeadTail && member.size > 0) {
+            entry.headTail16 = std::vector<uint8_t>(member.head_tail, member.head_tail + BLAKE3_OUT_LEN);
+        }
+        entry.sha256 = std::vector<uint8_t>(member.blake3, member.blake3 + BLAKE3_OUT_LEN);
+
+        ScanEvent event(ScanEventType::FileAdded, entry);
+        callback(event);
+    }
+    archive_hash_result_free(&result);
 }
 
 std::vector<uint8_t> Scanner::computeHeadTailSignature(const std::string& path) {
@@ -225,34 +298,70 @@ std::vector<uint8_t> Scanner::computeHeadTailSignature(const std::string& path)
     return hash;
 }
 
-std::vector<uint8_t> Scanner::computeFullHash(const std::string& path) {
-    file_handle_t hFile = FileUtils::open_file(path, true);
-    if (!FileUtils::is_valid_handle(hFile)) {
-        return {};
+void Scanner::computeContentSignatures(const std::string& path, const ScanOptions& options,
+                                       FileEntry& entry) {
+    if (m_cancelled) {
+        return;
     }
 
-    BLAKE3_HASH_STATE blake3;
-    blake3_hash_init(&blake3);
+    DigestEngine::Parameters params;
+    params.digests = 0;
+    if (options.computeFullHash) params.digests |= DigestEngine::BLAKE3;
+    if (options.computeEntropySketch) params.digests |= DigestEngine::ENTROPY_MAP;
+    DigestEngine engine(params);
 
-    const size_t bufferSize = 64 * 1024; // 64KB buffer
-    std::vector<uint8_t> buffer(bufferSize);
+    DigestRecord record;
+    if (!engine.digest_file(path, record)) {
+        if (options.computeFullHash) entry.sha256 = std::vector<uint8_t>();
+        return;
+    }
+    if (options.computeFullHash) {
+        entry.sha256 = std::move(record.blake3);
+    }
+    if (options.computeEntropySketch && !record.entropy_map.empty()) {
+        std::vector<uint8_t> sketch(ENCRYPTION_ENTROPY_SKETCH_SIZE);
+        encryption_entropy_sketch(record.entropy_map.data(), record.entropy_map.size(), sketch.data());
+        entry.entropySketch = std::move(sketch);
+    }
+}
 
-    uint64_t offset = 0;
-    while (FileUtils::read_file_data(hFile, buffer.data(), bufferSize, offset)) {
-        if (m_cancelled) {
-            FileUtils::close_file(hFile);
-            return {};
-        }
-        blake3_hash_update(&blake3, buffer.data(), bufferSize);
-        offset += bufferSize;
+std::optional<uint16_t> Scanner::computeCompressibility(const std::string& path, const FileEntry& entry) {
+    // A file the entropy sketch already found random needs no samples
+    if (entry.entropySketch && entry.entropySketch->size() == ENCRYPTION_ENTROPY_SKETCH_SIZE &&
+        encryption_entropy_sketch_high_fraction(entry.entropySketch->data()) >= 0.9) {
+        return 1000;
     }
 
-    FileUtils::close_file(hFile);
+    // Scanners run on several threads; each keeps its own match finder
+    thread_local std::unique_ptr<compressibility_context_t, void (*)(compressibility_context_t*)> context(
+        compressibility_context_new(), compressibility_context_free);
+    if (!context) {
+        return std::nullopt;
+    }
+    compressibility_result_t result;
+    if (compressibility_estimate_file(context.get(), path.c_str(), nullptr, &result) != 0) {
+        return std::nullopt;
+    }
+    return static_cast<uint16_t>(std::min(1000.0, result.strong_ratio * 1000.0 + 0.5));
+}
 
-    std::vector<uint8_t> hash(BLAKE3_OUT_LEN);
-    blake3_hash_finalize(&blake3, hash.data(), BLAKE3_OUT_LEN);
+std::vector<uint8_t> Scanner::computePerceptualHash(const std::string& path) {
+    if (!PHashOptimized::is_supported_image(path.c_str())) {
+        return {};
+    }
 
-    return hash;
+    PHashOptimized hasher;
+    uint64_t hash = 0;
+    if (!hasher.compute_phash_file(path.c_str(), hash)) {
+        return {};
+    }
+
+    // Stored little-endian so the 8 bytes round-trip to the same 64-bit value
+    std::vector<uint8_t> bytes(sizeof(hash));
+    for (size_t i = 0; i < sizeof(hash); ++i) {
+        bytes[i] = static_cast<uint8_t>(hash >> (8 * i));
+    }
+    return bytes;
 }
 
 FileId Scanner::extractFileId(const std::string& path) {
@@ -30,6 +30,12 @@ struct ScanOptions {
     bool followReparsePoints = false; // Follow junctions and symlinks
     bool computeHeadTail = true;      // Compute head/tail signatures
     bool computeFullHash = false;     // Compute full file hash (expensive)
+    bool computePerceptualHash = false; // Compute 64-bit pHash for supported images
+    bool computeEntropySketch = false;  // Compute per-file entropy sketch (full read, shared with the hash)
+    bool computeCompressibility = false; // Estimate the compressed size from sampled blocks (at most 1% of each file)
+    bool scanArchives = false;        // Also index archive members as virtual files ("archive!/member"), hashed without extraction
+    int archiveMaxDepth = 3;          // Nested archive levels entered
+    unsigned archiveThreads = 0;      // Archives hashed at once (0 = hardware threads)
     std::vector<std::string> excludePaths; // Paths to exclude from scanning
     uint64_t minFileSize = 0;         // Minimum file size to scan
     uint64_t maxFileSize = 0;         // Maximum file size to scan (0 = unlimited)
@@ -57,6 +63,7 @@ public:
 private:
     std::atomic<bool> m_cancelled;
     std::atomic<bool> m_scanning;
+    std::vector<std::string> m_archives; // Archives found by the current scan
 
     // Process a directory recursively
     void scanDirectory(const std::string& path,
@@ -69,11 +76,21 @@ private:
                     const ScanOptions& options,
                     std::function<void(const ScanEvent&)> callback);
 
+    // Hash the members of the archives found, in parallel, and report them as virtual files
+    void indexArchiveMembers(const ScanOptions& options,
+                             std::function<void(const ScanEvent&)> callback);
+
     // Compute head/tail signature
     std::vector<uint8_t> computeHeadTailSignature(const std::string& path);
 
-    // Compute full file hash
-    std::vector<uint8_t> computeFullHash(const std::string& path);
+    // Compute the full hash and/or entropy sketch requested by options in one read
+    void computeContentSignatures(const std::string& path, const ScanOptions& options, FileEntry& entry);
+
+    // Estimate the compressed size of a file, in 1/1000 of its size
+    std::optional<uint16_t> computeCompressibility(const std::string& path, const FileEntry& entry);
+
+    // Compute perceptual hash (empty if the format is not supported)
+    std::vector<uint8_t> computePerceptualHash(const std::string& path);
 
     // Extract file ID from handle
     FileId extractFileId(const std::string& path);
@@ -1 +0,0 @@
-// Dummy file for lib_audfp library
@@ -0,0 +1,858 @@
+#include "audfp.h"
+#include "audfp_decode.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// Streaming band-limited resampler: windowed-sinc kernel sampled at a fixed
+// number of sub-sample phases. Holds only the last few input samples.
+class Resampler {
+public:
+    static constexpr int ZERO_CROSSINGS = 8;
+    static constexpr int PHASES = 256;
+
+    Resampler(uint32_t in_rate, uint32_t out_rate)
+        : m_in_rate(in_rate), m_out_rate(out_rate), m_half(0), m_base(0), m_next(0) {
+        if (in_rate == out_rate) {
+            return;
+        }
+        // Cut off just below the lower of the two Nyquist frequencies
+        const double cutoff = std::min(1.0, static_cast<double>(out_rate) / in_rate) * 0.95;
+        m_half = static_cast<int>(std::ceil(ZERO_CROSSINGS / cutoff));
+        const int taps = 2 * m_half;
+        m_kernel.resize(static_cast<size_t>(PHASES + 1) * taps);
+        for (int p = 0; p <= PHASES; ++p) {
+            const double frac = static_cast<double>(p) / PHASES;
+            float* row = m_kernel.data() + static_cast<size_t>(p) * taps;
+            double sum = 0.0;
+            for (int k = 0; k < taps; ++k) {
+                // Distance from the output instant to input sample (n0 - half + 1 + k)
+                const double d = k - m_half + 1 - frac;
+                const double x = d * cutoff;
+                const double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(PI * x) / (PI * x);
+                const double w = std::fabs(d) >= m_half ? 0.0
+                    : 0.42 + 0.5 * std::cos(PI * d / m_half) + 0.08 * std::cos(2.0 * PI * d / m_half);
+                row[k] = static_cast<float>(sinc * w);
+                sum += row[k];
+            }
+            for (int k = 0; k < taps; ++k) {
+                row[k] = static_cast<float>(row[k] / sum); // Unity DC gain
+            }
+        }
+        // Left context before the first sample is silence
+        m_history.assign(static_cast<size_t>(m_half), 0.0f);
+        m_base = -m_half;
+    }
+
+    // Append input and write every output sample that is now fully determined
+    void process(const float* in, size_t count, std::vector<float>& out) {
+        if (m_in_rate == m_out_rate) {
+            out.insert(out.end(), in, in + count);
+            return;
+        }
+        m_history.insert(m_history.end(), in, in + count);
+        produce(out);
+    }
+
+    // Flush the tail (right context is silence)
+    void finish(std::vector<float>& out) {
+        if (m_in_rate == m_out_rate) {
+            return;
+        }
+        m_history.insert(m_history.end(), static_cast<size_t>(m_half), 0.0f);
+        produce(out);
+    }
+
+private:
+    void produce(std::vector<float>& out) {
+        const int taps = 2 * m_half;
+        const int64_t end = m_base + static_cast<int64_t>(m_history.size());
+        for (;;) {
+            // Exact rational position of output m_next in input samples
+            const uint64_t num = m_next * m_in_rate;
+            const int64_t n0 = static_cast<int64_t>(num / m_out_rate);
+            if (n0 + m_half >= end) {
+                break;
+            }
+            const int phase = static_cast<int>(((num % m_out_rate) * PHASES + m_out_rate / 2) / m_out_rate);
+            const float* kernel = m_kernel.data() + static_cast<size_t>(phase) * taps;
+            const float* src = m_history.data() + (n0 - m_half + 1 - m_base);
+            float acc = 0.0f;
+            for (int k = 0; k < taps; ++k) {
+                acc += kernel[k] * src[k];
+            }
+            out.push_back(acc);
+            m_next++;
+        }
+
+        // Drop input no longer reachable by future outputs
+        const int64_t keep_from = static_cast<int64_t>(m_next * m_in_rate / m_out_rate) - m_half + 1;
+        if (keep_from > m_base) {
+            const size_t drop = static_cast<size_t>(std::min<int64_t>(keep_from - m_base, static_cast<int64_t>(m_history.size())));
+            m_history.erase(m_history.begin(), m_history.begin() + static_cast<std::ptrdiff_t>(drop));
+            m_base += static_cast<int64_t>(drop);
+        }
+    }
+
+    uint32_t m_in_rate;
+    uint32_t m_out_rate;
+    int m_half;                      // Taps on each side of the output instant
+    std::vector<float> m_kernel;     // (PHASES + 1) x (2 * m_half)
+    std::vector<float> m_history;
+    int64_t m_base;                  // Input index of m_history[0]
+    uint64_t m_next;                 // Index of the next output sample
+};
+
+// Real-input FFT of length n via a complex FFT of length n/2. Data is kept
+// in split real/imaginary arrays and every butterfly stage runs over
+// contiguous spans, so the inner loops vectorize.
+class RealFft {
+public:
+    explicit RealFft(size_t n) : m_n(n), m_half(n / 2) {
+        const size_t m = m_half;
+        int bits = 0;
+        while ((static_cast<size_t>(1) << bits) < m) ++bits;
+        m_bitrev.resize(m);
+        for (size_t i = 0; i < m; ++i) {
+            size_t r = 0;
+            for (int b = 0; b < bits; ++b) {
+                if (i & (static_cast<size_t>(1) << b)) r |= static_cast<size_t>(1) << (bits - 1 - b);
+            }
+            m_bitrev[i] = static_cast<uint32_t>(r);
+        }
+
+        // Stage twiddles stored back to back: stage with span h at offset h - 1
+        m_tw_re.resize(m);
+        m_tw_im.resize(m);
+        for (size_t h = 1; h < m; h <<= 1) {
+            for (size_t j = 0; j < h; ++j) {
+                const double angle = -PI * static_cast<double>(j) / static_cast<double>(h);
+                m_tw_re[h - 1 + j] = static_cast<float>(std::cos(angle));
+                m_tw_im[h - 1 + j] = static_cast<float>(std::sin(angle));
+            }
+        }
+
+        m_post_re.resize(m);
+        m_post_im.resize(m);
+        for (size_t k = 0; k < m; ++k) {
+            const double angle = -2.0 * PI * static_cast<double>(k) / static_cast<double>(n);
+            m_post_re[k] = static_cast<float>(std::cos(angle));
+            m_post_im[k] = static_cast<float>(std::sin(angle));
+        }
+
+        m_window.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * static_cast<double>(i) / static_cast<double>(n)));
+        }
+        m_re.resize(m);
+        m_im.resize(m);
+    }
+
+    size_t bins() const { return m_half; }
+
+    // Hann-windowed power spectrum of n samples into bins() values
+    void power(const float* in, float* out) {
+        const size_t m = m_half;
+        float* re = m_re.data();
+        float* im = m_im.data();
+        for (size_t i = 0; i < m; ++i) {
+            const size_t src = m_bitrev[i];
+            re[i] = in[2 * src] * m_window[2 * src];
+            im[i] = in[2 * src + 1] * m_window[2 * src + 1];
+        }
+
+        for (size_t h = 1; h < m; h <<= 1) {
+            const float* wr = m_tw_re.data() + h - 1;
+            const float* wi = m_tw_im.data() + h - 1;
+            for (size_t base = 0; base < m; base += 2 * h) {
+                float* ar = re + base;
+                float* ai = im + base;
+                float* br = re + base + h;
+                float* bi = im + base + h;
+                for (size_t j = 0; j < h; ++j) {
+                    const float tr = br[j] * wr[j] - bi[j] * wi[j];
+                    const float ti = br[j] * wi[j] + bi[j] * wr[j];
+                    br[j] = ar[j] - tr;
+                    bi[j] = ai[j] - ti;
+                    ar[j] += tr;
+                    ai[j] += ti;
+                }
+            }
+        }
+
+        // Split the packed transform into the spectrum of the real input
+        for (size_t k = 0; k < m; ++k) {
+            const size_t mk = k == 0 ? 0 : m - k;
+            const float zr = re[k], zi = im[k];
+            const float cr = re[mk], ci = -im[mk];
+            const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+            const float orr = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+            const float xr = er + m_post_re[k] * orr - m_post_im[k] * oi;
+            const float xi = ei + m_post_re[k] * oi + m_post_im[k] * orr;
+            out[k] = xr * xr + xi * xi;
+        }
+    }
+
+private:
+    size_t m_n;
+    size_t m_half;
+    std::vector<uint32_t> m_bitrev;
+    std::vector<float> m_tw_re, m_tw_im;
+    std::vector<float> m_post_re, m_post_im;
+    std::vector<float> m_window;
+    std::vector<float> m_re, m_im;
+};
+
+// Spectrogram peak picker. A bin is a peak if it is the maximum of a
+// (2 * TIME_RADIUS + 1) x (2 * FREQ_RADIUS + 1) neighbourhood; only a ring of
+// that many frames is kept.
+class PeakPicker {
+public:
+    static constexpr int TIME_RADIUS = 5;
+    static constexpr int FREQ_RADIUS = 6;
+    static constexpr size_t RING = 2 * TIME_RADIUS + 1;
+
+    struct Peak {
+        uint32_t bin;
+        float level;
+    };
+
+    PeakPicker(size_t bins, size_t min_bin, size_t max_bin, size_t peaks_per_frame)
+        : m_bins(bins), m_min_bin(min_bin), m_max_bin(max_bin), m_peaks_per_frame(peaks_per_frame),
+          m_frames(0), m_levels(RING * bins), m_fmax(RING * bins), m_means(RING) {}
+
+    // Add the power spectrum of the next frame; fn(frame, peaks) is called for
+    // the frame TIME_RADIUS behind once its neighbourhood is complete
+    template<typename Fn>
+    void push(const float* power, Fn&& fn) {
+        const size_t slot = m_frames % RING;
+        float* level = m_levels.data() + slot * m_bins;
+        float* fmax = m_fmax.data() + slot * m_bins;
+        double sum = 0.0;
+        for (size_t f = 0; f < m_bins; ++f) {
+            level[f] = std::log(power[f] + 1e-10f);
+        }
+        for (size_t f = m_min_bin; f <= m_max_bin; ++f) {
+            sum += level[f];
+        }
+        m_means[slot] = static_cast<float>(sum / static_cast<double>(m_max_bin - m_min_bin + 1));
+        for (size_t f = 0; f < m_bins; ++f) {
+            const size_t lo = f >= FREQ_RADIUS ? f - FREQ_RADIUS : 0;
+            const size_t hi = std::min(m_bins - 1, f + FREQ_RADIUS);
+            float best = level[lo];
+            for (size_t g = lo + 1; g <= hi; ++g) best = std::max(best, level[g]);
+            fmax[f] = best;
+        }
+        m_frames++;
+
+        if (m_frames > static_cast<size_t>(TIME_RADIUS)) {
+            evaluate(m_frames - 1 - TIME_RADIUS, fn);
+        }
+    }
+
+    // Evaluate the trailing frames whose future neighbours never arrived
+    template<typename Fn>
+    void finish(Fn&& fn) {
+        const size_t first = m_frames > static_cast<size_t>(TIME_RADIUS) ? m_frames - TIME_RADIUS : 0;
+        for (size_t frame = first; frame < m_frames; ++frame) {
+            evaluate(frame, fn);
+        }
+    }
+
+private:
+    // Levels below this are treated as digital silence
+    static constexpr float SILENCE = -13.8f; // ln(1e-6)
+    // A peak must stand this far (natural log units) above the frame mean
+    static constexpr float MIN_PROMINENCE = 4.0f; // ~17 dB
+
+    template<typename Fn>
+    void evaluate(size_t frame, Fn&& fn) {
+        const size_t slot = frame % RING;
+        const float* level = m_levels.data() + slot * m_bins;
+        const float* fmax = m_fmax.data() + slot * m_bins;
+        const float floor = std::max(SILENCE, m_means[slot] + MIN_PROMINENCE);
+
+        const size_t first = frame >= static_cast<size_t>(TIME_RADIUS) ? frame - TIME_RADIUS : 0;
+        const size_t last = std::min(m_frames - 1, frame + TIME_RADIUS);
+
+        m_candidates.clear();
+        for (size_t f = m_min_bin; f <= m_max_bin; ++f) {
+            const float v = level[f];
+            if (v < floor || v < fmax[f]) {
+                continue;
+            }
+            bool is_peak = true;
+            for (size_t t = first; t <= last && is_peak; ++t) {
+                if (t != frame && m_fmax[(t % RING) * m_bins + f] > v) {
+                    is_peak = false;
+                }
+            }
+            if (is_peak) {
+                m_candidates.push_back({static_cast<uint32_t>(f), v});
+            }
+        }
+
+        if (m_candidates.size() > m_peaks_per_frame) {
+            std::partial_sort(m_candidates.begin(), m_candidates.begin() + static_cast<std::ptrdiff_t>(m_peaks_per_frame),
+                              m_candidates.end(), [](const Peak& a, const Peak& b) {
+                                  return a.level > b.level || (a.level == b.level && a.bin < b.bin);
+                              });
+            m_candidates.resize(m_peaks_per_frame);
+        }
+        fn(static_cast<uint32_t>(frame), m_candidates);
+    }
+
+    size_t m_bins;
+    size_t m_min_bin;
+    size_t m_max_bin;
+    size_t m_peaks_per_frame;
+    size_t m_frames;
+    std::vector<float> m_levels;   // RING x bins log power
+    std::vector<float> m_fmax;     // RING x bins frequency-neighbourhood maxima
+    std::vector<float> m_means;
+    std::vector<Peak> m_candidates;
+};
+
+// Pairs each anchor peak with the first fan_out peaks in its target zone
+class LandmarkBuilder {
+public:
+    LandmarkBuilder(const AudioFingerprinter::Parameters& params, std::vector<AudioFingerprinter::Landmark>& out)
+        : m_fan_out(params.fan_out),
+          m_max_frames(std::min<uint32_t>(params.max_pair_frames, 63)),
+          m_max_bins(params.max_pair_bins), m_out(out) {}
+
+    void add_frame(uint32_t frame, const std::vector<PeakPicker::Peak>& peaks) {
+        // Retire anchors whose target zone has passed or that are exhausted
+        size_t keep = 0;
+        for (size_t i = 0; i < m_anchors.size(); ++i) {
+            if (frame - m_anchors[i].frame <= m_max_frames && m_anchors[i].emitted < m_fan_out) {
+                m_anchors[keep++] = m_anchors[i];
+            }
+        }
+        m_anchors.resize(keep);
+
+        for (auto& anchor : m_anchors) {
+            for (const auto& peak : peaks) {
+                if (anchor.emitted >= m_fan_out) break;
+                const uint32_t df = peak.bin > anchor.bin ? peak.bin - anchor.bin : anchor.bin - peak.bin;
+                if (df > m_max_bins) continue;
+                const uint32_t dt = frame - anchor.frame;
+                m_out.push_back({((anchor.bin & 0x1FF) << 15) | ((peak.bin & 0x1FF) << 6) | (dt & 0x3F),
+                                 anchor.frame});
+                anchor.emitted++;
+            }
+        }
+
+        for (const auto& peak : peaks) {
+            m_anchors.push_back({frame, peak.bin, 0});
+        }
+    }
+
+private:
+    struct Anchor {
+        uint32_t frame;
+        uint32_t bin;
+        size_t emitted;
+    };
+
+    size_t m_fan_out;
+    uint32_t m_max_frames;
+    uint32_t m_max_bins;
+    std::vector<Anchor> m_anchors;
+    std::vector<AudioFingerprinter::Landmark>& m_out;
+};
+
+// Streaming analysis pipeline: source-rate mono -> resample -> frames -> peaks -> landmarks
+class Analyzer {
+public:
+    Analyzer(const AudioFingerprinter::Parameters& params, uint32_t source_rate,
+             std::vector<AudioFingerprinter::Landmark>& out)
+        : m_params(params), m_resampler(source_rate, params.sample_rate), m_fft(params.fft_size),
+          m_picker(m_fft.bins(), band_bin(params, 100.0), band_bin(params, 5000.0), params.peaks_per_frame),
+          m_builder(params, out), m_analyzed(0), m_limit(0) {
+        m_power.resize(m_fft.bins());
+        if (params.max_seconds > 0.0) {
+            m_limit = static_cast<uint64_t>(params.max_seconds * params.sample_rate);
+        }
+    }
+
+    // Returns false once max_seconds of audio has been analyzed
+    bool push(const float* samples, size_t count) {
+        m_resampled.clear();
+        m_resampler.process(samples, count, m_resampled);
+        return analyze();
+    }
+
+    void finish() {
+        m_resampled.clear();
+        m_resampler.finish(m_resampled);
+        analyze();
+        m_picker.finish([this](uint32_t frame, const std::vector<PeakPicker::Peak>& peaks) {
+            m_builder.add_frame(frame, peaks);
+        });
+    }
+
+private:
+    static size_t band_bin(const AudioFingerprinter::Parameters& params, double hz) {
+        const size_t bins = params.fft_size / 2;
+        size_t bin = static_cast<size_t>(hz * static_cast<double>(params.fft_size) / params.sample_rate + 0.5);
+        // Landmarks store bins in 9 bits
+        return std::clamp<size_t>(bin, 1, std::min<size_t>(bins - 1, 511));
+    }
+
+    bool analyze() {
+        const size_t n = m_params.fft_size;
+        const size_t hop = m_params.hop_size;
+        m_frame.insert(m_frame.end(), m_resampled.begin(), m_resampled.end());
+        m_analyzed += m_resampled.size();
+
+        size_t start = 0;
+        while (m_frame.size() - start >= n) {
+            m_fft.power(m_frame.data() + start, m_power.data());
+            m_picker.push(m_power.data(), [this](uint32_t frame, const std::vector<PeakPicker::Peak>& peaks) {
+                m_builder.add_frame(frame, peaks);
+            });
+            start += hop;
+        }
+        m_frame.erase(m_frame.begin(), m_frame.begin() + static_cast<std::ptrdiff_t>(start));
+        return m_limit == 0 || m_analyzed < m_limit;
+    }
+
+    const AudioFingerprinter::Parameters& m_params;
+    Resampler m_resampler;
+    RealFft m_fft;
+    PeakPicker m_picker;
+    LandmarkBuilder m_builder;
+    std::vector<float> m_resampled;
+    std::vector<float> m_frame;
+    std::vector<float> m_power;
+    uint64_t m_analyzed;
+    uint64_t m_limit;
+};
+
+bool valid_params(const AudioFingerprinter::Parameters& params) {
+    const size_t n = params.fft_size;
+    return params.sample_rate >= 4000 && n >= 64 && n <= 8192 && (n & (n - 1)) == 0 &&
+           params.hop_size > 0 && params.hop_size <= n && params.peaks_per_frame > 0 && params.fan_out > 0;
+}
+
+void sort_landmarks(std::vector<AudioFingerprinter::Landmark>& landmarks) {
+    std::sort(landmarks.begin(), landmarks.end(),
+              [](const AudioFingerprinter::Landmark& a, const AudioFingerprinter::Landmark& b) {
+                  return a.time < b.time || (a.time == b.time && a.hash < b.hash);
+              });
+}
+
+// Run fn(i) for i in [0, count) across worker threads
+template<typename Fn>
+void parallel_for(size_t count, size_t num_threads, Fn fn) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, count);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (size_t t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                fn(i);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        const uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const uint8_t FP_FORMAT_VERSION = 1;
+const uint32_t AFI_FILE_MAGIC = 0x31494641; // "AFI1"
+const uint32_t AFI_FILE_VERSION = 1;
+
+// Very common landmarks (silence, hum) carry no identity; skip their postings
+const size_t MAX_POSTINGS_PER_HASH = 20000;
+
+template<typename T>
+void write_pod(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read_pod(std::ifstream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+} // namespace
+
+// AudioFingerprinter implementation
+AudioFingerprinter::AudioFingerprinter(const Parameters& params)
+    : m_params(params) {
+}
+
+bool AudioFingerprinter::fingerprint_file(const std::string& path, Fingerprint& out) const {
+    out = Fingerprint();
+    if (!valid_params(m_params)) {
+        return false;
+    }
+    auto decoder = AudioDecoder::open(path);
+    if (!decoder) {
+        return false;
+    }
+
+    const AudioFormat& format = decoder->format();
+    out.source_rate = format.sample_rate;
+    out.source_channels = format.channels;
+
+    Analyzer analyzer(m_params, format.sample_rate, out.landmarks);
+    std::vector<float> block(4096);
+    uint64_t decoded = 0;
+    for (;;) {
+        size_t n = decoder->read_mono(block.data(), block.size());
+        if (n == 0) {
+            break;
+        }
+        decoded += n;
+        if (!analyzer.push(block.data(), n)) {
+            break;
+        }
+    }
+    analyzer.finish();
+
+    const uint64_t frames = format.total_frames ? format.total_frames : decoded;
+    out.duration_ms = frames * 1000 / format.sample_rate;
+    sort_landmarks(out.landmarks);
+    return decoded > 0;
+}
+
+bool AudioFingerprinter::fingerprint_samples(const float* samples, size_t count, uint32_t sample_rate,
+                                             Fingerprint& out) const {
+    out = Fingerprint();
+    if (!samples || count == 0 || sample_rate == 0 || !valid_params(m_params)) {
+        return false;
+    }
+    out.source_rate = sample_rate;
+    out.source_channels = 1;
+    out.duration_ms = static_cast<uint64_t>(count) * 1000 / sample_rate;
+
+    Analyzer analyzer(m_params, sample_rate, out.landmarks);
+    const size_t block = 4096;
+    for (size_t offset = 0; offset < count; offset += block) {
+        if (!analyzer.push(samples + offset, std::min(block, count - offset))) {
+            break;
+        }
+    }
+    analyzer.finish();
+    sort_landmarks(out.landmarks);
+    return true;
+}
+
+size_t AudioFingerprinter::fingerprint_files(const std::string* paths, size_t count, Fingerprint* out,
+                                             bool* ok_out, size_t num_threads) const {
+    if (!paths || !out || count == 0) {
+        return 0;
+    }
+
+    std::atomic<size_t> success_count{0};
+    parallel_for(count, num_threads, [&](size_t i) {
+        const bool ok = fingerprint_file(paths[i], out[i]);
+        if (ok_out) ok_out[i] = ok;
+        if (ok) success_count.fetch_add(1, std::memory_order_relaxed);
+    });
+    return success_count.load();
+}
+
+bool AudioFingerprinter::is_supported_audio(const std::string& path) {
+    return AudioDecoder::is_supported_audio(path);
+}
+
+std::vector<uint8_t> AudioFingerprinter::serialize(const Fingerprint& fp) {
+    // version, rate, channels, duration, count, then (time delta, hash) varints;
+    // landmarks are sorted by time so deltas stay small
+    std::vector<uint8_t> out;
+    out.reserve(16 + fp.landmarks.size() * 4);
+    out.push_back(FP_FORMAT_VERSION);
+    put_varint(out, fp.source_rate);
+    put_varint(out, fp.source_channels);
+    put_varint(out, fp.duration_ms);
+    put_varint(out, fp.landmarks.size());
+    uint32_t prev = 0;
+    for (const auto& lm : fp.landmarks) {
+        put_varint(out, lm.time - prev);
+        put_varint(out, lm.hash);
+        prev = lm.time;
+    }
+    return out;
+}
+
+bool AudioFingerprinter::deserialize(const uint8_t* data, size_t len, Fingerprint& out) {
+    out = Fingerprint();
+    if (!data || len == 0 || data[0] != FP_FORMAT_VERSION) {
+        return false;
+    }
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + len;
+    uint64_t rate = 0, channels = 0, duration = 0, count = 0;
+    if (!get_varint(p, end, rate) || !get_varint(p, end, channels) ||
+        !get_varint(p, end, duration) || !get_varint(p, end, count) || count > len) {
+        return false;
+    }
+    out.source_rate = static_cast<uint32_t>(rate);
+    out.source_channels = static_cast<uint32_t>(channels);
+    out.duration_ms = duration;
+    out.landmarks.resize(static_cast<size_t>(count));
+    uint64_t time = 0;
+    for (auto& lm : out.landmarks) {
+        uint64_t delta = 0, hash = 0;
+        if (!get_varint(p, end, delta) || !get_varint(p, end, hash)) {
+            return false;
+        }
+        time += delta;
+        lm.time = static_cast<uint32_t>(time);
+        lm.hash = static_cast<uint32_t>(hash);
+    }
+    return p == end;
+}
+
+// AudioFingerprintIndex implementation
+AudioFingerprintIndex::AudioFingerprintIndex()
+    : m_track_offsets(1, 0), m_postings_scanned(0) {
+}
+
+AudioFingerprintIndex::TrackId AudioFingerprintIndex::add(const std::string& key,
+                                                          const AudioFingerprinter::Fingerprint& fp) {
+    const TrackId id = static_cast<TrackId>(m_keys.size());
+    m_keys.push_back(key);
+    m_durations.push_back(fp.duration_ms);
+    m_landmarks.insert(m_landmarks.end(), fp.landmarks.begin(), fp.landmarks.end());
+    m_track_offsets.push_back(m_landmarks.size());
+    for (const auto& lm : fp.landmarks) {
+        m_postings[lm.hash].push_back({id, lm.time});
+    }
+    return id;
+}
+
+std::vector<AudioFingerprintIndex::Match> AudioFingerprintIndex::match_landmarks(
+    const AudioFingerprinter::Landmark* landmarks, size_t count, uint32_t min_score,
+    TrackId exclude, uint64_t& scanned) const {
+    // (track, offset) -> aligned landmark count
+    std::unordered_map<uint64_t, uint32_t> histogram;
+    for (size_t i = 0; i < count; ++i) {
+        auto it = m_postings.find(landmarks[i].hash);
+        if (it == m_postings.end() || it->second.size() > MAX_POSTINGS_PER_HASH) {
+            continue;
+        }
+        scanned += it->second.size();
+        for (const Posting& posting : it->second) {
+            if (posting.track == exclude) {
+                continue;
+            }
+            const int32_t offset = static_cast<int32_t>(landmarks[i].time - posting.time);
+            histogram[(static_cast<uint64_t>(posting.track) << 32) | static_cast<uint32_t>(offset)]++;
+        }
+    }
+
+    // Recordings rarely share frame alignment, so a true offset straddles two
+    // adjacent bins; score each bin together with its right neighbour
+    std::unordered_map<TrackId, Match> best;
+    for (const auto& [key, hits] : histogram) {
+        const TrackId track = static_cast<TrackId>(key >> 32);
+        const int32_t offset = static_cast<int32_t>(static_cast<uint32_t>(key));
+        auto next = histogram.find((key & 0xFFFFFFFF00000000ULL) | static_cast<uint32_t>(offset + 1));
+        const uint32_t score = hits + (next != histogram.end() ? next->second : 0);
+        auto [entry, inserted] = best.try_emplace(track, Match{track, score, offset, 0.0});
+        if (!inserted && (score > entry->second.score ||
+                          (score == entry->second.score && offset < entry->second.offset))) {
+            entry->second.score = score;
+            entry->second.offset = offset;
+        }
+    }
+
+    std::vector<Match> matches;
+    for (auto& [track, match] : best) {
+        if (match.score < min_score) {
+            continue;
+        }
+        const size_t shorter = std::min(count, landmark_count(track));
+        match.similarity = shorter ? std::min(1.0, static_cast<double>(match.score) / static_cast<double>(shorter)) : 0.0;
+        matches.push_back(match);
+    }
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        return a.score > b.score || (a.score == b.score && a.track < b.track);
+    });
+    return matches;
+}
+
+std::vector<AudioFingerprintIndex::Match> AudioFingerprintIndex::query(const AudioFingerprinter::Fingerprint& fp,
+                                                                       uint32_t min_score, size_t max_results) const {
+    uint64_t scanned = 0;
+    auto matches = match_landmarks(fp.landmarks.data(), fp.landmarks.size(), std::max<uint32_t>(min_score, 1),
+                                   UINT32_MAX, scanned);
+    m_postings_scanned += scanned;
+    if (matches.size() > max_results) {
+        matches.resize(max_results);
+    }
+    return matches;
+}
+
+std::vector<AudioFingerprintIndex::Pair> AudioFingerprintIndex::find_similar_pairs(uint32_t min_score,
+                                                                                   double min_similarity,
+                                                                                   size_t num_threads) const {
+    const size_t n = m_keys.size();
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::max<size_t>(1, std::min(num_threads, n));
+
+    // Each track queries the index; a pair is kept from its lower id only.
+    // Tracks are split into contiguous shards so concatenation keeps (a, b) order.
+    std::vector<std::vector<Pair>> shards(num_threads);
+    std::vector<uint64_t> scanned(num_threads, 0);
+    auto work = [&](size_t shard) {
+        const size_t begin = n * shard / num_threads;
+        const size_t end = n * (shard + 1) / num_threads;
+        for (size_t a = begin; a < end; ++a) {
+            const TrackId id = static_cast<TrackId>(a);
+            auto matches = match_landmarks(m_landmarks.data() + m_track_offsets[a], landmark_count(id),
+                                           std::max<uint32_t>(min_score, 1), id, scanned[shard]);
+            std::sort(matches.begin(), matches.end(), [](const Match& x, const Match& y) { return x.track < y.track; });
+            for (const auto& match : matches) {
+                if (match.track > id && match.similarity >= min_similarity) {
+                    // Offset is reported as b relative to a
+                    shards[shard].push_back({id, match.track, match.score, match.offset, match.similarity});
+                }
+            }
+        }
+    };
+
+    if (num_threads == 1) {
+        work(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            workers.emplace_back(work, t);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    std::vector<Pair> pairs;
+    for (size_t t = 0; t < num_threads; ++t) {
+        pairs.insert(pairs.end(), shards[t].begin(), shards[t].end());
+        m_postings_scanned += scanned[t];
+    }
+    return pairs;
+}
+
+AudioFingerprintIndex::Stats AudioFingerprintIndex::get_stats() const {
+    Stats stats;
+    stats.tracks = m_keys.size();
+    stats.landmarks = m_landmarks.size();
+    stats.distinct_hashes = m_postings.size();
+    stats.postings_scanned = m_postings_scanned;
+    return stats;
+}
+
+void AudioFingerprintIndex::clear() {
+    m_postings.clear();
+    m_keys.clear();
+    m_durations.clear();
+    m_landmarks.clear();
+    m_track_offsets.assign(1, 0);
+    m_postings_scanned = 0;
+}
+
+bool AudioFingerprintIndex::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    // Header, then per track: key, duration, landmark count, landmarks.
+    // Postings are rebuilt from the landmarks on load.
+    write_pod(out, AFI_FILE_MAGIC);
+    write_pod(out, AFI_FILE_VERSION);
+    write_pod(out, static_cast<uint64_t>(m_keys.size()));
+    for (size_t id = 0; id < m_keys.size(); ++id) {
+        write_pod(out, static_cast<uint32_t>(m_keys[id].size()));
+        out.write(m_keys[id].data(), static_cast<std::streamsize>(m_keys[id].size()));
+        write_pod(out, m_durations[id]);
+        const uint64_t count = landmark_count(static_cast<TrackId>(id));
+        write_pod(out, count);
+        out.write(reinterpret_cast<const char*>(m_landmarks.data() + m_track_offsets[id]),
+                  static_cast<std::streamsize>(count * sizeof(AudioFingerprinter::Landmark)));
+    }
+    return static_cast<bool>(out);
+}
+
+bool AudioFingerprintIndex::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0;
+    uint64_t tracks = 0;
+    if (!read_pod(in, magic) || !read_pod(in, version) || !read_pod(in, tracks) ||
+        magic != AFI_FILE_MAGIC || version != AFI_FILE_VERSION || tracks >= UINT32_MAX) {
+        return false;
+    }
+
+    AudioFingerprintIndex loaded;
+    AudioFingerprinter::Fingerprint fp;
+    for (uint64_t id = 0; id < tracks; ++id) {
+        uint32_t key_len = 0;
+        uint64_t count = 0;
+        if (!read_pod(in, key_len)) {
+            return false;
+        }
+        std::string key(key_len, '\0');
+        in.read(key.data(), key_len);
+        if (!read_pod(in, fp.duration_ms) || !read_pod(in, count) || count > (1ULL << 32)) {
+            return false;
+        }
+        fp.landmarks.resize(static_cast<size_t>(count));
+        in.read(reinterpret_cast<char*>(fp.landmarks.data()),
+                static_cast<std::streamsize>(count * sizeof(AudioFingerprinter::Landmark)));
+        if (!in) {
+            return false;
+        }
+        loaded.add(key, fp);
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,162 @@
+#ifndef LIBS_AUDFP_AUDFP_H
+#define LIBS_AUDFP_AUDFP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Landmark-based audio fingerprinting. Decoded audio is downmixed,
+// resampled, turned into a log-magnitude spectrogram, and reduced to
+// sparse spectral peaks. Pairs of nearby peaks are hashed as
+// (f1, f2, dt) landmarks tagged with the anchor time. Two recordings of
+// the same audio share many landmarks at a constant time offset.
+class AudioFingerprinter {
+public:
+    struct Parameters {
+        uint32_t sample_rate;       // Analysis sample rate (Hz)
+        size_t fft_size;            // Window length (power of two)
+        size_t hop_size;            // Frame advance in samples
+        size_t peaks_per_frame;     // Strongest peaks kept per frame
+        size_t fan_out;             // Landmarks emitted per anchor peak
+        uint32_t max_pair_frames;   // Target zone length (frames, <= 63)
+        uint32_t max_pair_bins;     // Target zone half-height (bins)
+        double max_seconds;         // Stop after this much audio (0 = whole file)
+
+        Parameters()
+            : sample_rate(11025), fft_size(1024), hop_size(256),
+              peaks_per_frame(3), fan_out(3), max_pair_frames(32), max_pair_bins(96),
+              max_seconds(0.0) {}
+    };
+
+    struct Landmark {
+        uint32_t hash;  // f1 (9 bits) | f2 (9 bits) | dt (6 bits)
+        uint32_t time;  // Anchor frame
+    };
+
+    struct Fingerprint {
+        std::vector<Landmark> landmarks;
+        uint64_t duration_ms;       // Duration of the decoded stream
+        uint32_t source_rate;
+        uint32_t source_channels;
+
+        Fingerprint() : duration_ms(0), source_rate(0), source_channels(0) {}
+    };
+
+private:
+    Parameters m_params;
+
+public:
+    explicit AudioFingerprinter(const Parameters& params = Parameters());
+    ~AudioFingerprinter() = default;
+
+    const Parameters& get_parameters() const { return m_params; }
+
+    // Fingerprint a file by streaming it through the decoder (constant memory
+    // apart from the landmark list itself)
+    bool fingerprint_file(const std::string& path, Fingerprint& out) const;
+
+    // Fingerprint in-memory mono samples at the given rate
+    bool fingerprint_samples(const float* samples, size_t count, uint32_t sample_rate,
+                             Fingerprint& out) const;
+
+    // Fingerprint many files across worker threads; ok_out (optional) receives
+    // per-file success. num_threads = 0 uses all hardware threads.
+    size_t fingerprint_files(const std::string* paths, size_t count, Fingerprint* out,
+                             bool* ok_out = nullptr, size_t num_threads = 0) const;
+
+    // True if the extension names a decodable audio format
+    static bool is_supported_audio(const std::string& path);
+
+    // Compact byte encoding (for FileEntry/index storage) and its inverse
+    static std::vector<uint8_t> serialize(const Fingerprint& fp);
+    static bool deserialize(const uint8_t* data, size_t len, Fingerprint& out);
+};
+
+// Inverted index from landmark hash to (track, time) postings. A query
+// histograms the time offsets of matching postings per track; the height of
+// the tallest bin is the number of landmarks that line up.
+class AudioFingerprintIndex {
+public:
+    using TrackId = uint32_t;
+
+    struct Match {
+        TrackId track;
+        uint32_t score;       // Aligned landmarks
+        int32_t offset;       // Query time - track time (frames) of the best bin
+        double similarity;    // score / landmarks of the shorter fingerprint
+    };
+
+    struct Pair {
+        TrackId a;
+        TrackId b;
+        uint32_t score;
+        int32_t offset;
+        double similarity;
+    };
+
+    struct Stats {
+        uint64_t tracks;
+        uint64_t landmarks;
+        uint64_t distinct_hashes;
+        uint64_t postings_scanned;
+
+        Stats() : tracks(0), landmarks(0), distinct_hashes(0), postings_scanned(0) {}
+    };
+
+private:
+    struct Posting {
+        TrackId track;
+        uint32_t time;
+    };
+
+    std::unordered_map<uint32_t, std::vector<Posting>> m_postings;
+    std::vector<std::string> m_keys;
+    std::vector<uint64_t> m_durations;
+    std::vector<AudioFingerprinter::Landmark> m_landmarks; // All tracks, concatenated
+    std::vector<uint64_t> m_track_offsets;                 // size() + 1 entries into m_landmarks
+    mutable uint64_t m_postings_scanned;
+
+public:
+    AudioFingerprintIndex();
+    ~AudioFingerprintIndex() = default;
+
+    // Add a track; returns its id
+    TrackId add(const std::string& key, const AudioFingerprinter::Fingerprint& fp);
+
+    // Tracks with at least min_score aligned landmarks, best first
+    std::vector<Match> query(const AudioFingerprinter::Fingerprint& fp, uint32_t min_score = 10,
+                             size_t max_results = 10) const;
+
+    // Every indexed pair of tracks with at least min_score aligned landmarks
+    // and similarity >= min_similarity, ordered by (a, b).
+    // num_threads = 0 uses all hardware threads.
+    std::vector<Pair> find_similar_pairs(uint32_t min_score = 10, double min_similarity = 0.0,
+                                         size_t num_threads = 0) const;
+
+    // Accessors
+    size_t size() const { return m_keys.size(); }
+    const std::string& get_key(TrackId id) const { return m_keys[id]; }
+    uint64_t get_duration_ms(TrackId id) const { return m_durations[id]; }
+    Stats get_stats() const;
+
+    // Clear index
+    void clear();
+
+    // Persist tracks and postings
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+private:
+    size_t landmark_count(TrackId id) const {
+        return static_cast<size_t>(m_track_offsets[id + 1] - m_track_offsets[id]);
+    }
+
+    // Offset histogram query; exclude skips one track (self-join)
+    std::vector<Match> match_landmarks(const AudioFingerprinter::Landmark* landmarks, size_t count,
+                                       uint32_t min_score, TrackId exclude,
+                                       uint64_t& scanned) const;
+};
+
+#endif // LIBS_AUDFP_AUDFP_H
@@ -0,0 +1,630 @@
+#include "audfp_decode.h"
+#include "libs/utils/utils.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Sequential reader over a file with a fixed-size buffer
+class BufferedFile {
+public:
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+
+    BufferedFile() : m_handle(INVALID_FILE_HANDLE), m_size(0), m_offset(0), m_pos(0), m_len(0) {}
+    ~BufferedFile() {
+        if (FileUtils::is_valid_handle(m_handle)) {
+            FileUtils::close_file(m_handle);
+        }
+    }
+
+    BufferedFile(const BufferedFile&) = delete;
+    BufferedFile& operator=(const BufferedFile&) = delete;
+
+    bool open(const std::string& path) {
+        m_handle = FileUtils::open_file(path, true);
+        if (!FileUtils::is_valid_handle(m_handle)) {
+            return false;
+        }
+        m_size = FileUtils::get_file_size(m_handle);
+        m_buffer.resize(BUFFER_SIZE);
+        return true;
+    }
+
+    uint64_t size() const { return m_size; }
+    uint64_t tell() const { return m_offset + m_pos; }
+
+    // Next byte, or -1 at end of file
+    int get() {
+        if (m_pos == m_len && !fill()) {
+            return -1;
+        }
+        return m_buffer[m_pos++];
+    }
+
+    // Read up to len bytes; returns bytes read
+    size_t read(void* out, size_t len) {
+        uint8_t* dst = static_cast<uint8_t*>(out);
+        size_t done = 0;
+        while (done < len) {
+            if (m_pos == m_len && !fill()) {
+                break;
+            }
+            size_t n = std::min(len - done, m_len - m_pos);
+            memcpy(dst + done, m_buffer.data() + m_pos, n);
+            m_pos += n;
+            done += n;
+        }
+        return done;
+    }
+
+    bool skip(uint64_t len) {
+        uint64_t target = tell() + len;
+        if (target > m_size) {
+            return false;
+        }
+        if (target <= m_offset + m_len) {
+            m_pos = static_cast<size_t>(target - m_offset);
+        } else {
+            m_offset = target;
+            m_pos = m_len = 0;
+        }
+        return true;
+    }
+
+private:
+    bool fill() {
+        m_offset += m_len;
+        m_pos = m_len = 0;
+        if (m_offset >= m_size) {
+            return false;
+        }
+        size_t n = static_cast<size_t>(std::min<uint64_t>(m_buffer.size(), m_size - m_offset));
+        if (!FileUtils::read_file_data(m_handle, m_buffer.data(), n, m_offset)) {
+            return false;
+        }
+        m_len = n;
+        return true;
+    }
+
+    file_handle_t m_handle;
+    uint64_t m_size;
+    uint64_t m_offset;   // File offset of m_buffer[0]
+    size_t m_pos;
+    size_t m_len;
+    std::vector<uint8_t> m_buffer;
+};
+
+uint16_t read_le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t read_le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// RIFF/WAVE decoder
+class WavDecoder : public AudioDecoder {
+public:
+    static constexpr size_t BLOCK_FRAMES = 4096;
+
+    bool open(const std::string& path) {
+        if (!m_file.open(path)) {
+            return false;
+        }
+        uint8_t riff[12];
+        if (m_file.read(riff, 12) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+            return false;
+        }
+
+        bool have_fmt = false;
+        uint8_t chunk[8];
+        while (m_file.read(chunk, 8) == 8) {
+            uint64_t chunk_size = read_le32(chunk + 4);
+            if (memcmp(chunk, "fmt ", 4) == 0) {
+                uint8_t fmt[40] = {};
+                size_t want = static_cast<size_t>(std::min<uint64_t>(chunk_size, sizeof(fmt)));
+                if (chunk_size < 16 || m_file.read(fmt, want) != want ||
+                    !m_file.skip(chunk_size - want + (chunk_size & 1))) {
+                    return false;
+                }
+                uint16_t tag = read_le16(fmt);
+                if (tag == 0xFFFE && chunk_size >= 26) {
+                    tag = read_le16(fmt + 24); // WAVE_FORMAT_EXTENSIBLE sub-format GUID
+                }
+                m_format.channels = read_le16(fmt + 2);
+                m_format.sample_rate = read_le32(fmt + 4);
+                m_block_align = read_le16(fmt + 12);
+                m_format.bits_per_sample = read_le16(fmt + 14);
+                m_float = (tag == 3);
+                if ((tag != 1 && tag != 3) || m_format.channels == 0 || m_format.sample_rate == 0) {
+                    return false;
+                }
+                const uint32_t bits = m_format.bits_per_sample;
+                if (m_float ? (bits != 32 && bits != 64) : (bits == 0 || bits > 32)) {
+                    return false;
+                }
+                m_bytes_per_sample = (bits + 7) / 8;
+                if (m_block_align < m_bytes_per_sample * m_format.channels) {
+                    return false;
+                }
+                have_fmt = true;
+            } else if (memcmp(chunk, "data", 4) == 0) {
+                if (!have_fmt) {
+                    return false;
+                }
+                // Streams written without a final size carry 0 or 0xFFFFFFFF
+                uint64_t available = m_file.size() - m_file.tell();
+                if (chunk_size == 0 || chunk_size > available) {
+                    chunk_size = available;
+                }
+                m_remaining_frames = chunk_size / m_block_align;
+                m_format.total_frames = m_remaining_frames;
+                m_raw.resize(BLOCK_FRAMES * m_block_align);
+                return true;
+            } else if (!m_file.skip(chunk_size + (chunk_size & 1))) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    size_t read_mono(float* out, size_t max_frames) override {
+        size_t frames = static_cast<size_t>(std::min<uint64_t>({max_frames, m_remaining_frames, BLOCK_FRAMES}));
+        if (frames == 0) {
+            return 0;
+        }
+        size_t bytes = frames * m_block_align;
+        size_t got = m_file.read(m_raw.data(), bytes);
+        if (got != bytes) {
+            m_failed = true;
+            frames = got / m_block_align;
+            m_remaining_frames = 0;
+        } else {
+            m_remaining_frames -= frames;
+        }
+
+        const uint32_t channels = m_format.channels;
+        const float scale = 1.0f / static_cast<float>(channels);
+        for (size_t i = 0; i < frames; ++i) {
+            const uint8_t* frame = m_raw.data() + i * m_block_align;
+            float sum = 0.0f;
+            for (uint32_t c = 0; c < channels; ++c) {
+                sum += sample(frame + c * m_bytes_per_sample);
+            }
+            out[i] = sum * scale;
+        }
+        return frames;
+    }
+
+private:
+    float sample(const uint8_t* p) const {
+        if (m_float) {
+            if (m_bytes_per_sample == 4) {
+                float v;
+                memcpy(&v, p, sizeof(v));
+                return v;
+            }
+            double v;
+            memcpy(&v, p, sizeof(v));
+            return static_cast<float>(v);
+        }
+        switch (m_bytes_per_sample) {
+            case 1: return (static_cast<float>(p[0]) - 128.0f) * (1.0f / 128.0f); // 8-bit is unsigned
+            case 2: return static_cast<float>(static_cast<int16_t>(read_le16(p))) * (1.0f / 32768.0f);
+            case 3: {
+                int32_t v = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16) |
+                                                 (static_cast<uint32_t>(p[2]) << 24));
+                return static_cast<float>(v) * (1.0f / 2147483648.0f);
+            }
+            default:
+                return static_cast<float>(static_cast<int32_t>(read_le32(p))) * (1.0f / 2147483648.0f);
+        }
+    }
+
+    BufferedFile m_file;
+    uint32_t m_block_align = 0;
+    uint32_t m_bytes_per_sample = 0;
+    bool m_float = false;
+    uint64_t m_remaining_frames = 0;
+    std::vector<uint8_t> m_raw;
+};
+
+// MSB-first bit reader on top of BufferedFile
+class BitReader {
+public:
+    explicit BitReader(BufferedFile& file) : m_file(file), m_cache(0), m_bits(0), m_eof(false) {}
+
+    // Read n bits (n <= 32)
+    uint32_t read(int n) {
+        if (n == 0) return 0;
+        if (m_bits < n) refill();
+        if (m_bits < n) {
+            m_eof = true;
+            return 0;
+        }
+        uint32_t v = static_cast<uint32_t>(m_cache >> (64 - n));
+        m_cache <<= n;
+        m_bits -= n;
+        return v;
+    }
+
+    int32_t read_signed(int n) {
+        if (n == 0) return 0;
+        uint32_t v = read(n);
+        return static_cast<int32_t>(v << (32 - n)) >> (32 - n);
+    }
+
+    // Count zero bits up to the next one bit (consumed)
+    uint32_t read_unary() {
+        uint32_t count = 0;
+        for (;;) {
+            if (m_bits == 0) {
+                refill();
+                if (m_bits == 0) {
+                    m_eof = true;
+                    return count;
+                }
+            }
+            if (m_cache == 0) {
+                count += static_cast<uint32_t>(m_bits);
+                m_bits = 0;
+                continue;
+            }
+            int zeros = std::countl_zero(m_cache);
+            count += static_cast<uint32_t>(zeros);
+            m_cache <<= zeros + 1;
+            m_bits -= zeros + 1;
+            return count;
+        }
+    }
+
+    int32_t read_rice(int k) {
+        uint32_t q = read_unary();
+        uint32_t u = (q << k) | read(k);
+        return static_cast<int32_t>(u >> 1) ^ -static_cast<int32_t>(u & 1);
+    }
+
+    void align() {
+        int drop = m_bits & 7;
+        m_cache <<= drop;
+        m_bits -= drop;
+    }
+
+    bool eof() const { return m_eof; }
+    bool aligned_empty() const { return m_bits == 0; }
+
+private:
+    void refill() {
+        while (m_bits <= 56) {
+            int b = m_file.get();
+            if (b < 0) break;
+            m_cache |= static_cast<uint64_t>(b) << (56 - m_bits);
+            m_bits += 8;
+        }
+    }
+
+    BufferedFile& m_file;
+    uint64_t m_cache;   // Valid bits are the top m_bits
+    int m_bits;
+    bool m_eof;
+};
+
+// CRC-8 (poly 0x07) used by FLAC frame headers
+uint8_t crc8_update(uint8_t crc, uint8_t byte) {
+    crc ^= byte;
+    for (int i = 0; i < 8; ++i) {
+        crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1));
+    }
+    return crc;
+}
+
+// Native FLAC decoder (fixed and LPC predictors, Rice-coded residuals)
+class FlacDecoder : public AudioDecoder {
+public:
+    FlacDecoder() : m_bits(m_file) {}
+
+    bool open(const std::string& path) {
+        if (!m_file.open(path)) {
+            return false;
+        }
+
+        uint8_t magic[4];
+        if (m_file.read(magic, 4) != 4) {
+            return false;
+        }
+        if (memcmp(magic, "ID3", 3) == 0) {
+            // ID3v2 tag in front of the stream: 10-byte header with a syncsafe size
+            uint8_t rest[6];
+            if (m_file.read(rest, 6) != 6) return false;
+            uint64_t tag_size = (static_cast<uint64_t>(rest[2] & 0x7F) << 21) | ((rest[3] & 0x7F) << 14) |
+                                ((rest[4] & 0x7F) << 7) | (rest[5] & 0x7F);
+            if (!m_file.skip(tag_size) || m_file.read(magic, 4) != 4) return false;
+        }
+        if (memcmp(magic, "fLaC", 4) != 0) {
+            return false;
+        }
+
+        bool have_info = false;
+        bool last = false;
+        while (!last) {
+            uint8_t header[4];
+            if (m_file.read(header, 4) != 4) {
+                return false;
+            }
+            last = (header[0] & 0x80) != 0;
+            uint32_t type = header[0] & 0x7F;
+            uint32_t length = (static_cast<uint32_t>(header[1]) << 16) | (header[2] << 8) | header[3];
+            if (type == 0 && length >= 34) {
+                uint8_t info[34];
+                if (m_file.read(info, 34) != 34 || !m_file.skip(length - 34)) {
+                    return false;
+                }
+                m_max_block = (info[2] << 8) | info[3];
+                m_format.sample_rate = (static_cast<uint32_t>(info[10]) << 12) | (info[11] << 4) | (info[12] >> 4);
+                m_format.channels = ((info[12] >> 1) & 0x07) + 1;
+                m_format.bits_per_sample = (((info[12] & 0x01) << 4) | (info[13] >> 4)) + 1;
+                m_format.total_frames = (static_cast<uint64_t>(info[13] & 0x0F) << 32) |
+                                        (static_cast<uint64_t>(info[14]) << 24) | (info[15] << 16) |
+                                        (info[16] << 8) | info[17];
+                have_info = true;
+            } else if (!m_file.skip(length)) {
+                return false;
+            }
+        }
+
+        if (!have_info || m_format.sample_rate == 0 || m_format.bits_per_sample < 4 || m_format.bits_per_sample > 32) {
+            return false;
+        }
+        if (m_max_block < 16) {
+            m_max_block = 65535;
+        }
+        m_channels.assign(m_format.channels, std::vector<int32_t>(m_max_block));
+        m_mono.resize(m_max_block);
+        return true;
+    }
+
+    size_t read_mono(float* out, size_t max_frames) override {
+        size_t written = 0;
+        while (written < max_frames) {
+            if (m_mono_pos == m_mono_len) {
+                if (m_done || !decode_frame()) {
+                    m_done = true;
+                    break;
+                }
+            }
+            size_t n = std::min(max_frames - written, m_mono_len - m_mono_pos);
+            memcpy(out + written, m_mono.data() + m_mono_pos, n * sizeof(float));
+            m_mono_pos += n;
+            written += n;
+        }
+        return written;
+    }
+
+private:
+    static constexpr int MAX_RESYNC_BYTES = 1 << 20;
+
+    // Parse the next frame header; scans forward to the next sync code if needed
+    bool read_frame_header(uint32_t& block_size, uint32_t& assignment, uint32_t& bps) {
+        for (int attempt = 0; attempt < MAX_RESYNC_BYTES; ++attempt) {
+            uint32_t b0 = m_bits.read(8);
+            if (m_bits.eof()) return false;
+            if (b0 != 0xFF) continue;
+            uint32_t b1 = m_bits.read(8);
+            if (m_bits.eof()) return false;
+            if ((b1 & 0xFE) != 0xF8) continue;
+
+            uint8_t crc = crc8_update(crc8_update(0, 0xFF), static_cast<uint8_t>(b1));
+            auto next = [&]() {
+                uint32_t v = m_bits.read(8);
+                crc = crc8_update(crc, static_cast<uint8_t>(v));
+                return v;
+            };
+
+            uint32_t b2 = next();
+            uint32_t b3 = next();
+            uint32_t bs_code = b2 >> 4;
+            uint32_t sr_code = b2 & 0x0F;
+            assignment = b3 >> 4;
+            uint32_t ss_code = (b3 >> 1) & 0x07;
+            if (bs_code == 0 || sr_code == 15 || assignment > 10 || ss_code == 3 || ss_code == 7 || (b3 & 1)) {
+                continue;
+            }
+
+            // UTF-8 style coded frame/sample number
+            uint32_t lead = next();
+            int extra = 0;
+            while (extra < 7 && (lead & (0x80u >> extra))) ++extra;
+            if (extra == 1 || extra == 7) continue;
+            for (int i = 1; i < extra; ++i) next();
+
+            if (bs_code == 1) block_size = 192;
+            else if (bs_code <= 5) block_size = 576u << (bs_code - 2);
+            else if (bs_code == 6) block_size = next() + 1;
+            else if (bs_code == 7) { block_size = next() << 8; block_size = (block_size | next()) + 1; }
+            else block_size = 256u << (bs_code - 8);
+
+            if (sr_code == 12) next();
+            else if (sr_code == 13 || sr_code == 14) { next(); next(); }
+
+            static const uint32_t sizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+            bps = ss_code ? sizes[ss_code] : m_format.bits_per_sample;
+
+            uint32_t expected = m_bits.read(8);
+            if (m_bits.eof()) return false;
+            uint32_t channels = assignment < 8 ? assignment + 1 : 2;
+            if (expected != crc || block_size > m_max_block || channels != m_format.channels) {
+                continue;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool decode_residual(int32_t* out, uint32_t block_size, uint32_t order) {
+        uint32_t method = m_bits.read(2);
+        if (method > 1) return false;
+        const int param_bits = method == 0 ? 4 : 5;
+        const uint32_t escape = method == 0 ? 15 : 31;
+        uint32_t partition_order = m_bits.read(4);
+        uint32_t partitions = 1u << partition_order;
+        uint32_t per_partition = block_size >> partition_order;
+        if (per_partition < order || (per_partition << partition_order) != block_size) return false;
+
+        uint32_t i = order;
+        for (uint32_t p = 0; p < partitions; ++p) {
+            uint32_t count = (p == 0) ? per_partition - order : per_partition;
+            uint32_t k = m_bits.read(param_bits);
+            if (k == escape) {
+                int raw = static_cast<int>(m_bits.read(5));
+                for (uint32_t n = 0; n < count; ++n) out[i++] = m_bits.read_signed(raw);
+            } else {
+                for (uint32_t n = 0; n < count; ++n) out[i++] = m_bits.read_rice(static_cast<int>(k));
+            }
+            if (m_bits.eof()) return false;
+        }
+        return true;
+    }
+
+    bool decode_subframe(int32_t* out, uint32_t block_size, uint32_t bps) {
+        if (m_bits.read(1) != 0) return false;
+        uint32_t type = m_bits.read(6);
+        uint32_t wasted = 0;
+        if (m_bits.read(1)) {
+            wasted = m_bits.read_unary() + 1;
+            if (wasted >= bps) return false;
+            bps -= wasted;
+        }
+        if (bps > 32) return false;
+
+        if (type == 0) {
+            int32_t v = m_bits.read_signed(static_cast<int>(bps));
+            std::fill(out, out + block_size, v);
+        } else if (type == 1) {
+            for (uint32_t i = 0; i < block_size; ++i) out[i] = m_bits.read_signed(static_cast<int>(bps));
+        } else if (type >= 8 && type <= 12) {
+            uint32_t order = type - 8;
+            if (order > block_size) return false;
+            for (uint32_t i = 0; i < order; ++i) out[i] = m_bits.read_signed(static_cast<int>(bps));
+            if (!decode_residual(out, block_size, order)) return false;
+            for (uint32_t i = order; i < block_size; ++i) {
+                int64_t pred = 0;
+                switch (order) {
+                    case 1: pred = out[i - 1]; break;
+                    case 2: pred = 2LL * out[i - 1] - out[i - 2]; break;
+                    case 3: pred = 3LL * out[i - 1] - 3LL * out[i - 2] + out[i - 3]; break;
+                    case 4: pred = 4LL * out[i - 1] - 6LL * out[i - 2] + 4LL * out[i - 3] - out[i - 4]; break;
+                    default: break;
+                }
+                out[i] = static_cast<int32_t>(out[i] + pred);
+            }
+        } else if (type >= 32) {
+            uint32_t order = type - 31;
+            if (order > block_size) return false;
+            for (uint32_t i = 0; i < order; ++i) out[i] = m_bits.read_signed(static_cast<int>(bps));
+            int precision = static_cast<int>(m_bits.read(4)) + 1;
+            int shift = m_bits.read_signed(5);
+            if (precision == 16 || shift < 0) return false;
+            int32_t coefs[32];
+            for (uint32_t i = 0; i < order; ++i) coefs[i] = m_bits.read_signed(precision);
+            if (!decode_residual(out, block_size, order)) return false;
+            for (uint32_t i = order; i < block_size; ++i) {
+                int64_t sum = 0;
+                for (uint32_t j = 0; j < order; ++j) sum += static_cast<int64_t>(coefs[j]) * out[i - 1 - j];
+                out[i] = static_cast<int32_t>(out[i] + (sum >> shift));
+            }
+        } else {
+            return false;
+        }
+
+        if (wasted) {
+            for (uint32_t i = 0; i < block_size; ++i) out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i]) << wasted);
+        }
+        return !m_bits.eof();
+    }
+
+    bool decode_frame() {
+        m_mono_pos = m_mono_len = 0;
+        for (;;) {
+            uint32_t block_size = 0, assignment = 0, bps = 0;
+            if (!read_frame_header(block_size, assignment, bps)) {
+                return false;
+            }
+
+            bool ok = true;
+            for (uint32_t c = 0; c < m_format.channels && ok; ++c) {
+                // The side channel carries one extra bit
+                uint32_t channel_bps = bps;
+                if ((assignment == 8 && c == 1) || (assignment == 9 && c == 0) || (assignment == 10 && c == 1)) {
+                    channel_bps++;
+                }
+                ok = decode_subframe(m_channels[c].data(), block_size, channel_bps);
+            }
+            m_bits.align();
+            m_bits.read(16); // Frame CRC-16 (header CRC-8 already validated)
+            if (!ok) {
+                if (m_bits.eof()) return false;
+                m_failed = true;
+                continue; // Corrupt frame: resync on the next header
+            }
+
+            int32_t* a = m_channels[0].data();
+            int32_t* b = m_format.channels > 1 ? m_channels[1].data() : nullptr;
+            for (uint32_t i = 0; b && i < block_size; ++i) {
+                if (assignment == 8) {          // left/side
+                    b[i] = a[i] - b[i];
+                } else if (assignment == 9) {   // side/right
+                    a[i] = a[i] + b[i];
+                } else if (assignment == 10) {  // mid/side
+                    int64_t side = b[i];
+                    int64_t mid = (static_cast<int64_t>(a[i]) << 1) | (side & 1);
+                    a[i] = static_cast<int32_t>((mid + side) >> 1);
+                    b[i] = static_cast<int32_t>((mid - side) >> 1);
+                }
+            }
+
+            const float scale = 1.0f / (static_cast<float>(1ULL << (bps - 1)) * static_cast<float>(m_format.channels));
+            for (uint32_t i = 0; i < block_size; ++i) {
+                int64_t sum = 0;
+                for (uint32_t c = 0; c < m_format.channels; ++c) sum += m_channels[c][i];
+                m_mono[i] = static_cast<float>(sum) * scale;
+            }
+            m_mono_len = block_size;
+            return true;
+        }
+    }
+
+    BufferedFile m_file;
+    BitReader m_bits;
+    uint32_t m_max_block = 0;
+    std::vector<std::vector<int32_t>> m_channels;
+    std::vector<float> m_mono;
+    size_t m_mono_pos = 0;
+    size_t m_mono_len = 0;
+    bool m_done = false;
+};
+
+} // namespace
+
+std::unique_ptr<AudioDecoder> AudioDecoder::open(const std::string& path) {
+    uint8_t magic[4] = {0, 0, 0, 0};
+    {
+        BufferedFile probe;
+        if (!probe.open(path) || probe.read(magic, 4) != 4) {
+            return nullptr;
+        }
+    }
+
+    if (memcmp(magic, "RIFF", 4) == 0) {
+        auto decoder = std::make_unique<WavDecoder>();
+        if (decoder->open(path)) return decoder;
+    } else if (memcmp(magic, "fLaC", 4) == 0 || memcmp(magic, "ID3", 3) == 0) {
+        auto decoder = std::make_unique<FlacDecoder>();
+        if (decoder->open(path)) return decoder;
+    }
+    return nullptr;
+}
+
+bool AudioDecoder::is_supported_audio(const std::string& path) {
+    std::string extension = StringUtils::to_lower(FileUtils::get_file_extension(path));
+    return extension == ".wav" || extension == ".wave" || extension == ".flac";
+}
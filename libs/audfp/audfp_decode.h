@@ -0,0 +1,53 @@
+#ifndef LIBS_AUDFP_AUDFP_DECODE_H
+#define LIBS_AUDFP_AUDFP_DECODE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Stream parameters reported by a decoder
+struct AudioFormat {
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t bits_per_sample;
+    uint64_t total_frames;      // 0 if unknown
+
+    AudioFormat() : sample_rate(0), channels(0), bits_per_sample(0), total_frames(0) {}
+
+    uint64_t duration_ms() const {
+        return sample_rate ? total_frames * 1000 / sample_rate : 0;
+    }
+};
+
+// Streaming PCM decoder. Samples are produced in small blocks and downmixed
+// to mono on the fly, so memory stays constant regardless of file length.
+// Supported containers: RIFF/WAVE (integer PCM 8-32 bit, IEEE float) and
+// native FLAC.
+class AudioDecoder {
+public:
+    virtual ~AudioDecoder() = default;
+
+    // Open a file, choosing the decoder from its magic bytes; nullptr if unsupported
+    static std::unique_ptr<AudioDecoder> open(const std::string& path);
+
+    // True if the extension names a format open() can decode
+    static bool is_supported_audio(const std::string& path);
+
+    const AudioFormat& format() const { return m_format; }
+
+    // Decode up to max_frames frames as mono samples in [-1, 1].
+    // Returns the number of frames written; 0 at end of stream or on error.
+    virtual size_t read_mono(float* out, size_t max_frames) = 0;
+
+    // True if decoding stopped because the stream was corrupt
+    bool failed() const { return m_failed; }
+
+protected:
+    AudioDecoder() : m_failed(false) {}
+
+    AudioFormat m_format;
+    bool m_failed;
+};
+
+#endif // LIBS_AUDFP_AUDFP_DECODE_H
@@ -1,12 +1,22 @@
+// copy_file_range
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "carving.h"
 #include "signatures.h"
+#include "matcher.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 // Helper function to duplicate memory
 static void* memdup(const void* src, size_t size) {
@@ -60,7 +70,8 @@ int carving_result_add_file(carving_result_t* result, const carved_file_t* file)
     new_file->extension = strdup_safe(file->extension);
     new_file->data = (uint8_t*)memdup(file->data, file->size);
     
-    if (!new_file->path || !new_file->extension || (!new_file->data && file->size > 0)) {
+    if ((file->path && !new_file->path) || !new_file->extension ||
+        (file->data && !new_file->data && file->size > 0)) {
         // Clean up on failure
         free(new_file->path);
         free(new_file->extension);
@@ -88,47 +99,134 @@ void carving_result_free(carving_result_t* result) {
     }
 }
 
-// Find signature in data
-static const uint8_t* find_signature(const uint8_t* data, size_t data_size, 
-                                    const uint8_t* signature, size_t signature_size) {
-    if (!data || !signature || data_size < signature_size) {
-        return NULL;
+// Turns a stream of header/footer hits into carved files. Hits arrive window
+// by window; a header is decided once every footer that could end it has
+// been scanned, and decided hits are dropped, so only the hits of the last
+// max_size bytes or so are held.
+typedef void (*carve_emit_fn)(void* ctx, uint64_t offset, uint64_t size, const file_signature_t* sig);
+
+typedef struct {
+    const file_signature_t* signatures;
+    size_t signature_count;
+    uint64_t input_size;
+    size_t max_pattern;         // Hits starting this close to the scan position may still be missing
+    carving_hits_t pending;     // Undecided hits (unsorted between resolves)
+    uint64_t next_offset;       // End of the last accepted file
+    size_t* cursor;             // Per-signature footer search position in pending
+} carving_resolver_t;
+
+static int resolver_init(carving_resolver_t* r, const file_signature_t* signatures, size_t count,
+                         uint64_t input_size, size_t max_pattern) {
+    r->signatures = signatures;
+    r->signature_count = count;
+    r->input_size = input_size;
+    r->max_pattern = max_pattern;
+    carving_hits_init(&r->pending);
+    r->next_offset = 0;
+    r->cursor = (size_t*)calloc(count, sizeof(size_t));
+    return r->cursor ? 0 : -1;
+}
+
+static void resolver_free(carving_resolver_t* r) {
+    carving_hits_free(&r->pending);
+    free(r->cursor);
+    r->cursor = NULL;
+}
+
+// First footer of a signature at or after offset; cursors only move forward
+// because headers are visited in offset order
+static uint64_t resolver_next_footer(carving_resolver_t* r, uint32_t signature, uint64_t offset) {
+    const carving_hits_t* p = &r->pending;
+    size_t i = r->cursor[signature];
+    while (i < p->count && (p->hits[i].offset < offset || !p->hits[i].is_footer ||
+                            p->hits[i].signature != signature)) {
+        i++;
+    }
+    r->cursor[signature] = i;
+    return i < p->count ? p->hits[i].offset : UINT64_MAX;
+}
+
+// Decide every header that can be decided with input scanned up to
+// `scanned` (all of it if at_end), then drop the decided hits
+static void resolver_run(carving_resolver_t* r, uint64_t scanned, int at_end,
+                         carve_emit_fn emit, void* ctx) {
+    carving_hits_sort(&r->pending);
+    for (size_t s = 0; s < r->signature_count; s++) {
+        r->cursor[s] = 0;
+    }
+    
+    // Every hit starting before `complete` has been reported
+    uint64_t complete = UINT64_MAX;
+    if (!at_end) {
+        complete = (scanned + 1 > r->max_pattern) ? scanned + 1 - r->max_pattern : 0;
     }
     
-    for (size_t i = 0; i <= data_size - signature_size; i++) {
-        if (memcmp(data + i, signature, signature_size) == 0) {
-            return data + i;
+    size_t h = 0;
+    for (; h < r->pending.count; h++) {
+        const carving_hit_t* hit = &r->pending.hits[h];
+        if (hit->offset >= complete) {
+            break;
+        }
+        if (hit->is_footer || hit->offset < r->next_offset) {
+            continue;
+        }
+        
+        const file_signature_t* sig = &r->signatures[hit->signature];
+        const uint64_t remaining = r->input_size - hit->offset;
+        uint64_t file_size = (sig->max_size > 0 && sig->max_size < remaining) ? sig->max_size : remaining;
+        
+        if (sig->footer_signature && sig->footer_signature_length > 0 &&
+            file_size >= sig->footer_signature_length) {
+            // Footers that could end this file must start by last_footer
+            const uint64_t last_footer = hit->offset + file_size - sig->footer_signature_length;
+            if (last_footer >= complete) {
+                break; // Wait for more input
+            }
+            uint64_t footer = resolver_next_footer(r, hit->signature, hit->offset);
+            if (footer <= last_footer) {
+                // Include footer in file size
+                file_size = footer - hit->offset + sig->footer_signature_length;
+            }
+        }
+        
+        // Validate file size
+        if (file_size > 0 && (sig->min_size == 0 || file_size >= sig->min_size)) {
+            emit(ctx, hit->offset, file_size, sig);
+            
+            // Move past this file
+            r->next_offset = hit->offset + file_size;
         }
     }
     
-    return NULL;
+    // Hits before h cannot end or start a later file
+    if (h > 0) {
+        memmove(r->pending.hits, r->pending.hits + h, (r->pending.count - h) * sizeof(carving_hit_t));
+        r->pending.count -= h;
+    }
 }
 
-// Find file end based on footer signature or size constraints
-static size_t find_file_end(const uint8_t* data, size_t data_size, size_t start_offset,
-                           const file_signature_t* signature) {
-    // First try to find footer signature
-    if (signature->footer_signature && signature->footer_signature_length > 0) {
-        const uint8_t* footer = find_signature(data + start_offset, 
-                                              data_size - start_offset,
-                                              signature->footer_signature,
-                                              signature->footer_signature_length);
-        if (footer) {
-            // Include footer in file size
-            return (footer - data) + signature->footer_signature_length - start_offset;
-        }
-    }
+typedef struct {
+    carving_result_t* result;
+    const uint8_t* data;        // In-memory input, or NULL
+    const char* image_path;     // Image the references point into
+} carve_sink_t;
+
+static void carve_emit(void* ctx, uint64_t offset, uint64_t size, const file_signature_t* sig) {
+    carve_sink_t* sink = (carve_sink_t*)ctx;
     
-    // If no footer or not found, use size constraints
-    size_t max_size = signature->max_size > 0 ? signature->max_size : data_size - start_offset;
-    size_t min_size = signature->min_size > 0 ? signature->min_size : 0;
+    // Create carved file entry
+    carved_file_t file;
+    file.path = (char*)sink->image_path;
+    file.offset = offset;
+    file.size = (size_t)size;
+    file.extension = (char*)sig->extension;
+    file.data = sink->data ? (uint8_t*)(sink->data + offset) : NULL;
     
-    // Return a reasonable size based on constraints
-    if (max_size > data_size - start_offset) {
-        max_size = data_size - start_offset;
+    // Add to results (copies path, extension and in-memory data)
+    if (carving_result_add_file(sink->result, &file) == 0) {
+        printf("Found %s file at offset %llu, size %llu\n",
+               sig->extension, (unsigned long long)offset, (unsigned long long)size);
     }
-    
-    return (max_size >= min_size) ? max_size : min_size;
 }
 
 int carving_carve_data(const uint8_t* data, size_t size, carving_result_t* result) {
@@ -146,113 +244,550 @@ int carving_carve_data(const uint8_t* data, size_t size, carving_result_t* resul
         return -1;
     }
     
-    // Search for file signatures in data
-    for (size_t i = 0; i < size; ) {
-        int found = 0;
-        
-        // Check each signature
-        for (size_t s = 0; s < signature_count; s++) {
-            const file_signature_t* sig = &signatures[s];
-            
-            // Check if we have enough data left for the header signature
-            if (i + sig->header_signature_length > size) {
-                continue;
+    // One pass finds every header and footer
+    carving_matcher_t* matcher = carving_matcher_create(signatures, signature_count);
+    carving_resolver_t resolver;
+    if (!matcher || resolver_init(&resolver, signatures, signature_count, size,
+                                  carving_matcher_max_pattern_length(matcher)) != 0) {
+        carving_matcher_free(matcher);
+        return -1;
+    }
+    carving_scan_state_t state;
+    carving_scan_state_init(&state, 0);
+    int ret = carving_matcher_scan(matcher, &state, data, size, &resolver.pending);
+    carving_matcher_free(matcher);
+    
+    if (ret == 0) {
+        carve_sink_t sink = {result, data, NULL};
+        resolver_run(&resolver, size, 1, carve_emit, &sink);
+    }
+    resolver_free(&resolver);
+    return ret == 0 ? 0 : -1;
+}
+
+// Size of a regular file or block device
+static int input_size(int fd, uint64_t* size) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return -1;
+    }
+    if (S_ISREG(st.st_mode)) {
+        *size = (uint64_t)st.st_size;
+        return 0;
+    }
+    off_t end = lseek(fd, 0, SEEK_END);
+    if (end < 0 || lseek(fd, 0, SEEK_SET) < 0) {
+        return -1;
+    }
+    *size = (uint64_t)end;
+    return 0;
+}
+
+// Read exactly size bytes at offset
+static int read_fully(int fd, uint8_t* buffer, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, buffer + done, size - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+// Scan [begin, end) of fd window by window, continuing from state.
+// begin must be page aligned; *buffer is allocated on first use when a
+// window cannot be mapped (pipes, some devices).
+static int scan_range(int fd, const carving_matcher_t* matcher, carving_scan_state_t* state,
+                      uint64_t begin, uint64_t end, size_t window_size, uint8_t** buffer,
+                      carving_hits_t* hits) {
+    for (uint64_t offset = begin; offset < end; offset += window_size) {
+        size_t len = (end - offset < window_size) ? (size_t)(end - offset) : window_size;
+        const uint8_t* window = NULL;
+        void* mapped = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, (off_t)offset);
+        if (mapped != MAP_FAILED) {
+            posix_madvise(mapped, len, POSIX_MADV_SEQUENTIAL);
+            window = (const uint8_t*)mapped;
+        } else {
+            if (!*buffer && !(*buffer = (uint8_t*)malloc(window_size))) {
+                return -1;
             }
-            
-            // Check for header signature match
-            if (memcmp(data + i, sig->header_signature, sig->header_signature_length) == 0) {
-                // Found a potential file, determine its end
-                size_t file_size = find_file_end(data, size, i, sig);
-                
-                // Validate file size
-                if (file_size > 0 && 
-                    (sig->min_size == 0 || file_size >= sig->min_size) &&
-                    (sig->max_size == 0 || file_size <= sig->max_size)) {
-                    
-                    // Create carved file entry
-                    carved_file_t file;
-                    file.path = NULL; // Will be set when saving
-                    file.offset = i;
-                    file.size = file_size;
-                    file.extension = strdup_safe(sig->extension);
-                    file.data = (uint8_t*)memdup(data + i, file_size);
-                    
-                    if (file.extension && (file.data || file_size == 0)) {
-                        // Add to results
-                        if (carving_result_add_file(result, &file) == 0) {
-                            printf("Found %s file at offset %lu, size %lu\n", 
-                                   sig->extension, (unsigned long)i, (unsigned long)file_size);
-                        }
-                    }
-                    
-                    // Clean up temporary file data
-                    free(file.extension);
-                    free(file.data);
-                    
-                    // Move past this file
-                    i += file_size;
-                    found = 1;
-                    break;
-                }
+            if (read_fully(fd, *buffer, len, offset) != 0) {
+                return -1;
             }
+            window = *buffer;
         }
         
-        // If no file found at this position, move to next byte
-        if (!found) {
-            i++;
+        int ret = carving_matcher_scan(matcher, state, window, len, hits);
+        if (mapped != MAP_FAILED) {
+            munmap(mapped, len);
+        }
+        if (ret != 0) {
+            return -1;
         }
     }
-    
     return 0;
 }
 
+static size_t round_to_pages(size_t bytes) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t page_size = page > 0 ? (size_t)page : 4096;
+    if (bytes < page_size) {
+        bytes = page_size;
+    }
+    return (bytes + page_size - 1) / page_size * page_size;
+}
+
 int carving_carve_file(const char* path, carving_result_t* result) {
+    return carving_carve_file_parallel(path, 0, 0, result);
+}
+
+int carving_carve_file_windowed(const char* path, size_t window_size, carving_result_t* result) {
     if (!path || !result) {
         return -1;
     }
     
+    carving_result_init(result);
+    
+    size_t signature_count;
+    const file_signature_t* signatures = carving_get_signatures(&signature_count);
+    if (!signatures || signature_count == 0) {
+        return -1;
+    }
+    
     // Open file
     int fd = open(path, O_RDONLY);
     if (fd < 0) {
         return -1;
     }
+    uint64_t size = 0;
+    if (input_size(fd, &size) != 0) {
+        close(fd);
+        return -1;
+    }
     
-    // Get file size
-    struct stat st;
-    if (fstat(fd, &st) != 0) {
+    // Windows start on page boundaries so they can be mapped
+    window_size = round_to_pages(window_size);
+    
+    carving_matcher_t* matcher = carving_matcher_create(signatures, signature_count);
+    carving_resolver_t resolver;
+    if (!matcher || resolver_init(&resolver, signatures, signature_count, size,
+                                  carving_matcher_max_pattern_length(matcher)) != 0) {
+        carving_matcher_free(matcher);
         close(fd);
         return -1;
     }
     
-    // For very large files, we might want to process in chunks
-    // For now, load entire file into memory
-    if (st.st_size > 1024 * 1024 * 100) { // 100MB limit
-        printf("Warning: File is very large (%ld bytes), this might use a lot of memory\n", (long)st.st_size);
+    // The scan state carries partial matches from one window into the next,
+    // so windows need no overlap and every byte is scanned once
+    carving_scan_state_t state;
+    carving_scan_state_init(&state, 0);
+    carve_sink_t sink = {result, NULL, path};
+    uint8_t* buffer = NULL;
+    int ret = 0;
+    for (uint64_t offset = 0; offset < size && ret == 0; offset += window_size) {
+        uint64_t end = (size - offset < window_size) ? size : offset + window_size;
+        ret = scan_range(fd, matcher, &state, offset, end, window_size, &buffer, &resolver.pending);
+        if (ret == 0) {
+            resolver_run(&resolver, end, 0, carve_emit, &sink);
+        }
+    }
+    if (ret == 0) {
+        resolver_run(&resolver, size, 1, carve_emit, &sink);
     }
     
-    // Allocate buffer
-    uint8_t* buffer = (uint8_t*)malloc(st.st_size);
-    if (!buffer) {
+    free(buffer);
+    resolver_free(&resolver);
+    carving_matcher_free(matcher);
+    close(fd);
+    return ret == 0 ? 0 : -1;
+}
+
+int carving_carve_ranges(const char* path, const carving_range_t* ranges, size_t count, size_t window_size,
+                         carving_result_t* result) {
+    if (!path || (!ranges && count > 0) || !result) {
+        return -1;
+    }
+    
+    carving_result_init(result);
+    
+    size_t signature_count;
+    const file_signature_t* signatures = carving_get_signatures(&signature_count);
+    if (!signatures || signature_count == 0) {
+        return -1;
+    }
+    if (window_size == 0) {
+        window_size = CARVING_DEFAULT_WINDOW;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    carving_matcher_t* matcher = carving_matcher_create(signatures, signature_count);
+    if (!matcher) {
         close(fd);
         return -1;
     }
     
-    // Read file
-    ssize_t bytes_read = read(fd, buffer, st.st_size);
+    // Ranges need not be page aligned, so they are read rather than mapped
+    carve_sink_t sink = {result, NULL, path};
+    uint8_t* buffer = NULL;
+    int ret = 0;
+    for (size_t r = 0; r < count && ret == 0; r++) {
+        const uint64_t begin = ranges[r].offset;
+        const uint64_t end = begin + ranges[r].length;
+        if (end <= begin) {
+            continue;
+        }
+        // The resolver ends files at input_size: here the end of the range
+        carving_resolver_t resolver;
+        if (resolver_init(&resolver, signatures, signature_count, end,
+                          carving_matcher_max_pattern_length(matcher)) != 0) {
+            ret = -1;
+            break;
+        }
+        carving_scan_state_t state;
+        carving_scan_state_init(&state, begin);
+        for (uint64_t offset = begin; offset < end && ret == 0; offset += window_size) {
+            const size_t len = (end - offset < window_size) ? (size_t)(end - offset) : window_size;
+            if (!buffer && !(buffer = (uint8_t*)malloc(window_size))) {
+                ret = -1;
+            } else if (read_fully(fd, buffer, len, offset) != 0 ||
+                       carving_matcher_scan(matcher, &state, buffer, len, &resolver.pending) != 0) {
+                ret = -1;
+            } else {
+                resolver_run(&resolver, offset + len, 0, carve_emit, &sink);
+            }
+        }
+        if (ret == 0) {
+            resolver_run(&resolver, end, 1, carve_emit, &sink);
+        }
+        resolver_free(&resolver);
+    }
+    
+    free(buffer);
+    carving_matcher_free(matcher);
     close(fd);
+    return ret == 0 ? 0 : -1;
+}
+
+// Segments finished by the workers, waiting to be merged in order
+typedef struct {
+    carving_hits_t hits;
+    int done;
+    int failed;
+} carve_segment_t;
+
+typedef struct {
+    int fd;
+    uint64_t size;
+    uint64_t segment_size;
+    uint64_t segment_count;
+    size_t window_size;
+    size_t margin;              // Longest pattern - 1: lets a segment finish matches it started
+    const carving_matcher_t* matcher;
     
-    if (bytes_read != st.st_size) {
-        free(buffer);
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint64_t next_segment;      // Next segment to claim
+    uint64_t merged;            // Segments consumed by the merger
+    size_t slot_count;          // Segments in flight; segment k uses slot k % slot_count
+    carve_segment_t* slots;
+    int stop;
+} carve_pool_t;
+
+// Scan one segment plus the margin from a fresh state and keep the hits
+// that start inside it. A match starting in the segment is complete by the
+// end of the margin, and one starting earlier belongs to the previous
+// segment, so the segments' hits together are exactly the serial hits.
+static int scan_segment(carve_pool_t* pool, uint64_t k, uint8_t** buffer, carving_hits_t* hits) {
+    const uint64_t begin = k * pool->segment_size;
+    const uint64_t end = (pool->size - begin < pool->segment_size) ? pool->size : begin + pool->segment_size;
+    const uint64_t scan_end = (pool->size - end < pool->margin) ? pool->size : end + pool->margin;
+    
+    carving_scan_state_t state;
+    carving_scan_state_init(&state, begin);
+    if (scan_range(pool->fd, pool->matcher, &state, begin, scan_end, pool->window_size, buffer, hits) != 0) {
         return -1;
     }
+    size_t kept = 0;
+    for (size_t i = 0; i < hits->count; i++) {
+        if (hits->hits[i].offset < end) {
+            hits->hits[kept++] = hits->hits[i];
+        }
+    }
+    hits->count = kept;
+    return 0;
+}
+
+static void* carve_worker(void* arg) {
+    carve_pool_t* pool = (carve_pool_t*)arg;
+    uint8_t* buffer = NULL;
+    
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        // Stay at most slot_count segments ahead of the merger
+        while (!pool->stop && pool->next_segment < pool->segment_count &&
+               pool->next_segment >= pool->merged + pool->slot_count) {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+        if (pool->stop || pool->next_segment >= pool->segment_count) {
+            break;
+        }
+        const uint64_t k = pool->next_segment++;
+        pthread_mutex_unlock(&pool->mutex);
+        
+        carving_hits_t hits;
+        carving_hits_init(&hits);
+        int failed = scan_segment(pool, k, &buffer, &hits) != 0;
+        
+        pthread_mutex_lock(&pool->mutex);
+        carve_segment_t* slot = &pool->slots[k % pool->slot_count];
+        slot->hits = hits;
+        slot->failed = failed;
+        slot->done = 1;
+        pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
     
-    // Carve files from data
-    int ret = carving_carve_data(buffer, bytes_read, result);
     free(buffer);
+    return NULL;
+}
+
+int carving_carve_file_parallel(const char* path, size_t num_threads, size_t segment_size,
+                                carving_result_t* result) {
+    if (!path || !result) {
+        return -1;
+    }
+    
+    carving_result_init(result);
+    
+    size_t signature_count;
+    const file_signature_t* signatures = carving_get_signatures(&signature_count);
+    if (!signatures || signature_count == 0) {
+        return -1;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    uint64_t size = 0;
+    if (input_size(fd, &size) != 0) {
+        close(fd);
+        return -1;
+    }
+    
+    if (num_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (segment_size == 0) {
+        // Enough segments to balance the workers, large enough to stream
+        segment_size = CARVING_DEFAULT_SEGMENT;
+        uint64_t per_thread = size / num_threads + 1;
+        if (per_thread < segment_size) {
+            segment_size = (size_t)per_thread;
+        }
+    }
+    
+    carve_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.fd = fd;
+    pool.size = size;
+    pool.segment_size = round_to_pages(segment_size);
+    pool.segment_count = (size + pool.segment_size - 1) / pool.segment_size;
+    pool.window_size = pool.segment_size < CARVING_DEFAULT_WINDOW ? pool.segment_size : CARVING_DEFAULT_WINDOW;
+    pool.slot_count = num_threads * 2;
+    if (num_threads > pool.segment_count) {
+        num_threads = pool.segment_count > 0 ? (size_t)pool.segment_count : 1;
+    }
+    
+    carving_matcher_t* matcher = carving_matcher_create(signatures, signature_count);
+    carving_resolver_t resolver;
+    if (!matcher || resolver_init(&resolver, signatures, signature_count, size,
+                                  carving_matcher_max_pattern_length(matcher)) != 0) {
+        carving_matcher_free(matcher);
+        close(fd);
+        return -1;
+    }
+    pool.matcher = matcher;
+    pool.margin = carving_matcher_max_pattern_length(matcher) - 1;
+    pool.slots = (carve_segment_t*)calloc(pool.slot_count, sizeof(carve_segment_t));
+    pthread_t* threads = (pthread_t*)calloc(num_threads, sizeof(pthread_t));
+    if (!pool.slots || !threads) {
+        free(pool.slots);
+        free(threads);
+        resolver_free(&resolver);
+        carving_matcher_free(matcher);
+        close(fd);
+        return -1;
+    }
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.cond, NULL);
+    
+    size_t started = 0;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&threads[started], NULL, carve_worker, &pool) != 0) {
+            break;
+        }
+    }
+    
+    // Merge segments in order: each one completes every hit before its end,
+    // so the resolver can join headers with footers from later segments
+    // exactly as the serial scan does
+    carve_sink_t sink = {result, NULL, path};
+    int ret = started > 0 ? 0 : -1;
+    for (uint64_t k = 0; k < pool.segment_count && ret == 0; k++) {
+        carve_segment_t* slot = &pool.slots[k % pool.slot_count];
+        pthread_mutex_lock(&pool.mutex);
+        while (!slot->done) {
+            pthread_cond_wait(&pool.cond, &pool.mutex);
+        }
+        carving_hits_t hits = slot->hits;
+        int failed = slot->failed;
+        carving_hits_init(&slot->hits);
+        slot->done = 0;
+        pool.merged = k + 1;
+        pthread_cond_broadcast(&pool.cond);
+        pthread_mutex_unlock(&pool.mutex);
+        
+        if (failed) {
+            ret = -1;
+        } else {
+            // Hits are appended in segment order; the resolver sorts what it holds
+            for (size_t i = 0; i < hits.count && ret == 0; i++) {
+                if (resolver.pending.count >= resolver.pending.capacity) {
+                    size_t new_capacity = resolver.pending.capacity + hits.count;
+                    carving_hit_t* grown = (carving_hit_t*)realloc(resolver.pending.hits,
+                                                                   new_capacity * sizeof(carving_hit_t));
+                    if (!grown) {
+                        ret = -1;
+                        break;
+                    }
+                    resolver.pending.hits = grown;
+                    resolver.pending.capacity = new_capacity;
+                }
+                resolver.pending.hits[resolver.pending.count++] = hits.hits[i];
+            }
+            const uint64_t end = (k + 1 == pool.segment_count) ? size : (k + 1) * pool.segment_size;
+            if (ret == 0) {
+                resolver_run(&resolver, end + pool.margin, 0, carve_emit, &sink);
+            }
+        }
+        carving_hits_free(&hits);
+    }
+    if (ret == 0) {
+        resolver_run(&resolver, size, 1, carve_emit, &sink);
+    }
+    
+    pthread_mutex_lock(&pool.mutex);
+    pool.stop = 1;
+    pthread_cond_broadcast(&pool.cond);
+    pthread_mutex_unlock(&pool.mutex);
+    for (size_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    for (size_t i = 0; i < pool.slot_count; i++) {
+        carving_hits_free(&pool.slots[i].hits);
+    }
     
+    pthread_cond_destroy(&pool.cond);
+    pthread_mutex_destroy(&pool.mutex);
+    free(pool.slots);
+    free(threads);
+    resolver_free(&resolver);
+    carving_matcher_free(matcher);
+    close(fd);
     return ret;
 }
 
+// Copy size bytes at offset of in_fd to the current position of out_fd
+// without passing them through user space where the kernel allows it
+static int copy_image_range(int in_fd, uint64_t offset, uint64_t size, int out_fd) {
+#ifdef __linux__
+    // Same filesystem: may share extents or copy on the server
+    loff_t in_offset = (loff_t)offset;
+    while (size > 0) {
+        size_t chunk = size > (1u << 30) ? (1u << 30) : (size_t)size;
+        ssize_t n = copy_file_range(in_fd, &in_offset, out_fd, NULL, chunk, 0);
+        if (n > 0) {
+            size -= (uint64_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0) {
+            return -1; // Source ended early
+        }
+        if (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP) {
+            return -1;
+        }
+        break; // Not supported here (e.g. across filesystems, block device source)
+    }
+    
+    // Any source to a file, still inside the kernel
+    off_t send_offset = (off_t)in_offset;
+    while (size > 0) {
+        size_t chunk = size > (1u << 30) ? (1u << 30) : (size_t)size;
+        ssize_t n = sendfile(out_fd, in_fd, &send_offset, chunk);
+        if (n > 0) {
+            size -= (uint64_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0) {
+            return -1;
+        }
+        if (errno != EINVAL && errno != ENOSYS) {
+            return -1;
+        }
+        break;
+    }
+    offset = (uint64_t)send_offset;
+#endif
+    
+    // Portable fallback through a bounded buffer
+    if (size > 0) {
+        const size_t buffer_size = 1024 * 1024;
+        uint8_t* buffer = (uint8_t*)malloc(buffer_size);
+        if (!buffer) {
+            return -1;
+        }
+        while (size > 0) {
+            size_t chunk = size > buffer_size ? buffer_size : (size_t)size;
+            if (read_fully(in_fd, buffer, chunk, offset) != 0) {
+                free(buffer);
+                return -1;
+            }
+            size_t written = 0;
+            while (written < chunk) {
+                ssize_t n = write(out_fd, buffer + written, chunk - written);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    free(buffer);
+                    return -1;
+                }
+                written += (size_t)n;
+            }
+            offset += chunk;
+            size -= chunk;
+        }
+        free(buffer);
+    }
+    return 0;
+}
+
 int carving_save_files(const carving_result_t* result, const char* output_directory) {
     if (!result || !output_directory) {
         return -1;
@@ -276,34 +811,60 @@ int carving_save_files(const carving_result_t* result, const char* output_direct
         return -1;
     }
     
-    // Save each carved file
+    // Save each carved file; references keep their image open across files
+    const char* source_path = NULL;
+    int source_fd = -1;
     for (size_t i = 0; i < result->count; i++) {
         const carved_file_t* file = &result->files[i];
         
         // Generate filename
         char filename[1024];
-        snprintf(filename, sizeof(filename), "%s/carved_%08lx_%08lx.%s", 
-                 output_directory, (unsigned long)file->offset, (unsigned long)file->size,
+        snprintf(filename, sizeof(filename), "%s/carved_%08llx_%08lx.%s", 
+                 output_directory, (unsigned long long)file->offset, (unsigned long)file->size,
                  file->extension ? file->extension : "dat");
         
         // Open output file
-        FILE* out_file = fopen(filename, "wb");
-        if (!out_file) {
+        int out_fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+        if (out_fd < 0) {
             printf("Failed to create output file: %s\n", filename);
             continue;
         }
         
         // Write data
+        int ok = 1;
         if (file->data && file->size > 0) {
-            size_t written = fwrite(file->data, 1, file->size, out_file);
-            if (written != file->size) {
-                printf("Failed to write complete file: %s\n", filename);
+            size_t written = 0;
+            while (ok && written < file->size) {
+                ssize_t n = write(out_fd, file->data + written, file->size - written);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    ok = 0;
+                } else {
+                    written += (size_t)n;
+                }
+            }
+        } else if (file->path && file->size > 0) {
+            if (!source_path || strcmp(source_path, file->path) != 0) {
+                if (source_fd >= 0) {
+                    close(source_fd);
+                }
+                source_path = file->path;
+                source_fd = open(file->path, O_RDONLY);
             }
+            ok = source_fd >= 0 && copy_image_range(source_fd, file->offset, file->size, out_fd) == 0;
+        }
+        if (!ok) {
+            printf("Failed to write complete file: %s\n", filename);
         }
         
-        fclose(out_file);
+        close(out_fd);
         printf("Saved carved file: %s\n", filename);
     }
+    if (source_fd >= 0) {
+        close(source_fd);
+    }
     
     return 0;
-}
\ No newline at end of file
+}
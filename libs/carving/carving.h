@@ -19,7 +19,9 @@ typedef struct {
     size_t max_size;
 } file_signature_t;
 
-// Carved file information
+// Carved file information. Files carved from memory own a copy of their
+// bytes in data; files carved from an image are references: data is NULL and
+// the bytes are [offset, offset + size) of the image at path.
 typedef struct {
     char* path;
     uint64_t offset;
@@ -44,6 +46,11 @@ int carving_result_add_file(carving_result_t* result, const carved_file_t* file)
 // Free carving result
 void carving_result_free(carving_result_t* result);
 
+// Carved file boundaries: a file ends at the first footer within max_size of
+// its header, otherwise after max_size bytes (or at the end of the input).
+// Headers inside an accepted file are skipped; at one offset the signature
+// table order decides.
+
 // Carve files from raw data
 // data: pointer to raw data
 // size: size of data in bytes
@@ -51,13 +58,45 @@ void carving_result_free(carving_result_t* result);
 // Returns 0 on success, non-zero on error
 int carving_carve_data(const uint8_t* data, size_t size, carving_result_t* result);
 
-// Carve files from a file/device
+// Carve files from a file/device, streaming it through mapped windows on all
+// hardware threads. Memory use depends on the window and the largest
+// max_size, not on the image; the result holds references into the image
+// rather than copies.
 // path: path to the file or device
 // result: output carving result (must be freed with carving_result_free)
 // Returns 0 on success, non-zero on error
 int carving_carve_file(const char* path, carving_result_t* result);
 
-// Save carved files to disk
+// As carving_carve_file with an explicit window size in bytes (rounded up to
+// the page size); carving_carve_file uses CARVING_DEFAULT_WINDOW
+#define CARVING_DEFAULT_WINDOW (64u * 1024 * 1024)
+int carving_carve_file_windowed(const char* path, size_t window_size, carving_result_t* result);
+
+// Carve a file/device with a pool of workers, each scanning one segment at a
+// time. The result is identical to the serial one, in the same order.
+// num_threads: 0 = hardware threads; segment_size: 0 = CARVING_DEFAULT_SEGMENT,
+// reduced for small images so every worker gets a segment
+#define CARVING_DEFAULT_SEGMENT (256u * 1024 * 1024)
+int carving_carve_file_parallel(const char* path, size_t num_threads, size_t segment_size,
+                                carving_result_t* result);
+
+// Byte range of a file/device
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+} carving_range_t;
+
+// Carve only some ranges of a file/device, such as its unallocated space.
+// Each range is carved on its own, from the start of the range: a carved
+// file ends at the end of its range at the latest. The result holds
+// references into the image, in the order of the ranges.
+// window_size: bytes read at a time (0 = CARVING_DEFAULT_WINDOW)
+// Returns 0 on success, non-zero on error
+int carving_carve_ranges(const char* path, const carving_range_t* ranges, size_t count, size_t window_size,
+                         carving_result_t* result);
+
+// Save carved files to disk. References are copied from the image inside the
+// kernel (copy_file_range, then sendfile) where available.
 // result: carving result containing files to save
 // output_directory: directory to save files to
 // Returns 0 on success, non-zero on error
@@ -0,0 +1,338 @@
+#include "matcher.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CARVING_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Pattern ending at a state
+typedef struct {
+    uint32_t signature;
+    uint16_t is_footer;
+    uint16_t length;
+} carving_output_t;
+
+struct carving_matcher {
+    uint16_t* delta;            // state * 256 + byte -> next state
+    uint32_t state_count;
+    uint32_t* out_begin;        // Outputs of state s: outputs[out_begin[s] .. out_begin[s + 1])
+    carving_output_t* outputs;
+    uint8_t is_start[256];      // Bytes that leave the root state
+    uint8_t start_bytes[256];
+    size_t start_count;
+    size_t max_length;
+};
+
+// Trie construction scratch: goto table plus per-node pattern lists
+typedef struct {
+    int32_t* next;              // node * 256 + byte, -1 if absent
+    int32_t* first_pattern;     // Head of the node's pattern list, -1 if none
+    int32_t* pattern_next;      // Next pattern ending at the same node
+    carving_output_t* patterns;
+    size_t node_count;
+    size_t pattern_count;
+} carving_trie_t;
+
+static void trie_add(carving_trie_t* trie, const uint8_t* bytes, size_t length,
+                     uint32_t signature, uint16_t is_footer) {
+    int32_t node = 0;
+    for (size_t i = 0; i < length; i++) {
+        int32_t* slot = &trie->next[(size_t)node * 256 + bytes[i]];
+        if (*slot < 0) {
+            *slot = (int32_t)trie->node_count++;
+        }
+        node = *slot;
+    }
+    carving_output_t* p = &trie->patterns[trie->pattern_count];
+    p->signature = signature;
+    p->is_footer = is_footer;
+    p->length = (uint16_t)length;
+    trie->pattern_next[trie->pattern_count] = trie->first_pattern[node];
+    trie->first_pattern[node] = (int32_t)trie->pattern_count;
+    trie->pattern_count++;
+}
+
+carving_matcher_t* carving_matcher_create(const file_signature_t* signatures, size_t count) {
+    if (!signatures || count == 0) {
+        return NULL;
+    }
+
+    // Size the trie: one node per pattern byte at most
+    size_t total_bytes = 0, pattern_count = 0;
+    for (size_t s = 0; s < count; s++) {
+        if (signatures[s].header_signature && signatures[s].header_signature_length > 0) {
+            total_bytes += signatures[s].header_signature_length;
+            pattern_count++;
+        }
+        if (signatures[s].footer_signature && signatures[s].footer_signature_length > 0) {
+            total_bytes += signatures[s].footer_signature_length;
+            pattern_count++;
+        }
+    }
+    const size_t max_nodes = total_bytes + 1;
+    if (pattern_count == 0 || max_nodes > UINT16_MAX) {
+        return NULL;
+    }
+
+    carving_matcher_t* m = (carving_matcher_t*)calloc(1, sizeof(carving_matcher_t));
+    carving_trie_t trie;
+    memset(&trie, 0, sizeof(trie));
+    trie.next = (int32_t*)malloc(max_nodes * 256 * sizeof(int32_t));
+    trie.first_pattern = (int32_t*)malloc(max_nodes * sizeof(int32_t));
+    trie.pattern_next = (int32_t*)malloc(pattern_count * sizeof(int32_t));
+    trie.patterns = (carving_output_t*)malloc(pattern_count * sizeof(carving_output_t));
+    int32_t* fail = (int32_t*)malloc(max_nodes * sizeof(int32_t));
+    int32_t* queue = (int32_t*)malloc(max_nodes * sizeof(int32_t));
+    uint32_t* out_count = (uint32_t*)calloc(max_nodes, sizeof(uint32_t));
+    if (!m || !trie.next || !trie.first_pattern || !trie.pattern_next || !trie.patterns ||
+        !fail || !queue || !out_count) {
+        goto error;
+    }
+    memset(trie.next, 0xFF, max_nodes * 256 * sizeof(int32_t));
+    memset(trie.first_pattern, 0xFF, max_nodes * sizeof(int32_t));
+    trie.node_count = 1;
+
+    for (size_t s = 0; s < count; s++) {
+        const file_signature_t* sig = &signatures[s];
+        if (sig->header_signature && sig->header_signature_length > 0) {
+            trie_add(&trie, sig->header_signature, sig->header_signature_length, (uint32_t)s, 0);
+        }
+        if (sig->footer_signature && sig->footer_signature_length > 0) {
+            trie_add(&trie, sig->footer_signature, sig->footer_signature_length, (uint32_t)s, 1);
+        }
+        if (sig->header_signature_length > m->max_length) m->max_length = sig->header_signature_length;
+        if (sig->footer_signature_length > m->max_length) m->max_length = sig->footer_signature_length;
+    }
+
+    m->state_count = (uint32_t)trie.node_count;
+    m->delta = (uint16_t*)malloc((size_t)m->state_count * 256 * sizeof(uint16_t));
+    m->out_begin = (uint32_t*)malloc(((size_t)m->state_count + 1) * sizeof(uint32_t));
+    if (!m->delta || !m->out_begin) {
+        goto error;
+    }
+
+    // Breadth-first: fail links point to shallower states, so their
+    // transitions and output counts are final by the time they are used
+    size_t head = 0, tail = 0;
+    fail[0] = 0;
+    for (int c = 0; c < 256; c++) {
+        int32_t child = trie.next[c];
+        if (child < 0) {
+            m->delta[c] = 0;
+        } else {
+            m->delta[c] = (uint16_t)child;
+            fail[child] = 0;
+            queue[tail++] = child;
+            m->is_start[c] = 1;
+            m->start_bytes[m->start_count++] = (uint8_t)c;
+        }
+    }
+    while (head < tail) {
+        const int32_t u = queue[head++];
+        for (int c = 0; c < 256; c++) {
+            const int32_t v = trie.next[(size_t)u * 256 + c];
+            const uint16_t via_fail = m->delta[(size_t)fail[u] * 256 + c];
+            if (v < 0) {
+                m->delta[(size_t)u * 256 + c] = via_fail;
+            } else {
+                m->delta[(size_t)u * 256 + c] = (uint16_t)v;
+                fail[v] = via_fail;
+                queue[tail++] = v;
+            }
+        }
+    }
+
+    // A state reports its own patterns plus everything its fail link reports
+    for (size_t q = 0; q < tail; q++) {
+        const int32_t u = queue[q];
+        uint32_t own = 0;
+        for (int32_t p = trie.first_pattern[u]; p >= 0; p = trie.pattern_next[p]) own++;
+        out_count[u] = own + out_count[fail[u]];
+    }
+    m->out_begin[0] = 0;
+    for (uint32_t s = 0; s < m->state_count; s++) {
+        m->out_begin[s + 1] = m->out_begin[s] + out_count[s];
+    }
+    m->outputs = (carving_output_t*)malloc((m->out_begin[m->state_count] + 1) * sizeof(carving_output_t));
+    if (!m->outputs) {
+        goto error;
+    }
+    for (size_t q = 0; q < tail; q++) {
+        const int32_t u = queue[q];
+        carving_output_t* dst = m->outputs + m->out_begin[u];
+        for (int32_t p = trie.first_pattern[u]; p >= 0; p = trie.pattern_next[p]) {
+            *dst++ = trie.patterns[p];
+        }
+        const int32_t f = fail[u];
+        memcpy(dst, m->outputs + m->out_begin[f], out_count[f] * sizeof(carving_output_t));
+    }
+
+    free(trie.next);
+    free(trie.first_pattern);
+    free(trie.pattern_next);
+    free(trie.patterns);
+    free(fail);
+    free(queue);
+    free(out_count);
+    return m;
+
+error:
+    free(trie.next);
+    free(trie.first_pattern);
+    free(trie.pattern_next);
+    free(trie.patterns);
+    free(fail);
+    free(queue);
+    free(out_count);
+    carving_matcher_free(m);
+    return NULL;
+}
+
+void carving_matcher_free(carving_matcher_t* matcher) {
+    if (matcher) {
+        free(matcher->delta);
+        free(matcher->out_begin);
+        free(matcher->outputs);
+        free(matcher);
+    }
+}
+
+size_t carving_matcher_max_pattern_length(const carving_matcher_t* matcher) {
+    return matcher ? matcher->max_length : 0;
+}
+
+void carving_hits_init(carving_hits_t* hits) {
+    if (hits) {
+        hits->hits = NULL;
+        hits->count = 0;
+        hits->capacity = 0;
+    }
+}
+
+void carving_hits_free(carving_hits_t* hits) {
+    if (hits) {
+        free(hits->hits);
+        carving_hits_init(hits);
+    }
+}
+
+static int hits_push(carving_hits_t* hits, uint64_t offset, const carving_output_t* out) {
+    if (hits->count >= hits->capacity) {
+        size_t new_capacity = (hits->capacity == 0) ? 256 : hits->capacity * 2;
+        carving_hit_t* new_hits = (carving_hit_t*)realloc(hits->hits, new_capacity * sizeof(carving_hit_t));
+        if (!new_hits) {
+            return -1;
+        }
+        hits->hits = new_hits;
+        hits->capacity = new_capacity;
+    }
+    carving_hit_t* hit = &hits->hits[hits->count++];
+    hit->offset = offset;
+    hit->signature = out->signature;
+    hit->is_footer = out->is_footer;
+    return 0;
+}
+
+static int compare_hits(const void* a, const void* b) {
+    const carving_hit_t* x = (const carving_hit_t*)a;
+    const carving_hit_t* y = (const carving_hit_t*)b;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    if (x->signature != y->signature) return x->signature < y->signature ? -1 : 1;
+    return (int)x->is_footer - (int)y->is_footer;
+}
+
+void carving_hits_sort(carving_hits_t* hits) {
+    if (hits && hits->count > 1) {
+        qsort(hits->hits, hits->count, sizeof(carving_hit_t), compare_hits);
+    }
+}
+
+void carving_scan_state_init(carving_scan_state_t* state, uint64_t position) {
+    if (state) {
+        state->state = 0;
+        state->position = position;
+    }
+}
+
+static unsigned first_set_bit(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#endif
+}
+
+int carving_matcher_scan(const carving_matcher_t* matcher, carving_scan_state_t* state,
+                         const uint8_t* data, size_t size, carving_hits_t* hits) {
+    if (!matcher || !state || (!data && size > 0) || !hits) {
+        return -1;
+    }
+
+    const uint16_t* delta = matcher->delta;
+    const uint32_t* out_begin = matcher->out_begin;
+    const uint8_t* is_start = matcher->is_start;
+    uint32_t s = state->state;
+    const uint64_t base = state->position;
+
+#ifdef CARVING_SSE2
+    // One comparison per distinct first byte; with more than 16 the table
+    // loop is just as fast
+    __m128i starts[16];
+    const size_t start_count = matcher->start_count <= 16 ? matcher->start_count : 0;
+    for (size_t k = 0; k < start_count; k++) {
+        starts[k] = _mm_set1_epi8((char)matcher->start_bytes[k]);
+    }
+#endif
+
+    size_t i = 0;
+    while (i < size) {
+        if (s == 0) {
+            // In the root state only a start byte can lead anywhere
+#ifdef CARVING_SSE2
+            if (start_count > 0) {
+                for (; i + 16 <= size; i += 16) {
+                    const __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+                    __m128i any = _mm_cmpeq_epi8(v, starts[0]);
+                    for (size_t k = 1; k < start_count; k++) {
+                        any = _mm_or_si128(any, _mm_cmpeq_epi8(v, starts[k]));
+                    }
+                    const unsigned mask = (unsigned)_mm_movemask_epi8(any);
+                    if (mask) {
+                        i += first_set_bit(mask);
+                        break;
+                    }
+                }
+            }
+#endif
+            while (i < size && !is_start[data[i]]) {
+                i++;
+            }
+            if (i >= size) {
+                break;
+            }
+        }
+
+        s = delta[(size_t)s * 256 + data[i]];
+        const uint32_t first = out_begin[s], last = out_begin[s + 1];
+        for (uint32_t o = first; o < last; o++) {
+            const carving_output_t* out = &matcher->outputs[o];
+            if (hits_push(hits, base + i + 1 - out->length, out) != 0) {
+                state->state = s;
+                state->position = base + i + 1;
+                return -1;
+            }
+        }
+        i++;
+    }
+
+    state->state = s;
+    state->position = base + size;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef LIBS_CARVING_MATCHER_H
+#define LIBS_CARVING_MATCHER_H
+
+#include "carving.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Multi-pattern matcher compiled once from a signature table. Every header
+// and footer is added to one Aho-Corasick automaton, flattened into a full
+// transition table, so a scan reports all of them in a single pass. Runs of
+// bytes that cannot begin any pattern are skipped 16 at a time.
+typedef struct carving_matcher carving_matcher_t;
+
+// One pattern occurrence
+typedef struct {
+    uint64_t offset;        // Offset of the first pattern byte
+    uint32_t signature;     // Index into the signature table
+    uint32_t is_footer;     // 0 = header, 1 = footer
+} carving_hit_t;
+
+// Growable hit list
+typedef struct {
+    carving_hit_t* hits;
+    size_t count;
+    size_t capacity;
+} carving_hits_t;
+
+// Scan position; carries partial matches from one buffer to the next
+typedef struct {
+    uint32_t state;
+    uint64_t position;      // Stream offset of the next byte
+} carving_scan_state_t;
+
+// Compile a matcher; returns NULL on allocation failure or an empty table
+carving_matcher_t* carving_matcher_create(const file_signature_t* signatures, size_t count);
+
+// Free a matcher
+void carving_matcher_free(carving_matcher_t* matcher);
+
+// Longest header or footer, i.e. how far a match can reach back across a
+// buffer boundary
+size_t carving_matcher_max_pattern_length(const carving_matcher_t* matcher);
+
+void carving_hits_init(carving_hits_t* hits);
+void carving_hits_free(carving_hits_t* hits);
+
+// Sort hits by offset, then signature index, then header before footer
+void carving_hits_sort(carving_hits_t* hits);
+
+void carving_scan_state_init(carving_scan_state_t* state, uint64_t position);
+
+// Append every match ending in data[0..size) to hits. Consecutive calls with
+// the same state behave like one call over the concatenated buffers, so a
+// pattern split across two buffers is still found. Hits are appended in
+// order of their last byte.
+// Returns 0 on success, non-zero on allocation failure
+int carving_matcher_scan(const carving_matcher_t* matcher, carving_scan_state_t* state,
+                         const uint8_t* data, size_t size, carving_hits_t* hits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_CARVING_MATCHER_H
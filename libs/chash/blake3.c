@@ -43,10 +43,17 @@ static const uint8_t R2[16] = {16, 12, 8, 7, 16, 12, 8, 7, 16, 12, 8, 7, 16, 12,
         b = (b >> r2) | (b << (32 - r2)); \
     } while (0)
 
+// State words mixed together: the four columns, then the four diagonals
+static const uint8_t LANES[8][4] = {
+    {0, 4, 8, 12}, {1, 5, 9, 13}, {2, 6, 10, 14}, {3, 7, 11, 15},
+    {0, 5, 10, 15}, {1, 6, 11, 12}, {2, 7, 8, 13}, {3, 4, 9, 14}
+};
+
 // Round function
 static void blake3_round(uint32_t* v, const uint32_t* m, const uint8_t* sigma) {
     for (int i = 0; i < 16; i += 2) {
-        G(v[sigma[i]], v[sigma[i + 1]], v[sigma[i] + 8], v[sigma[i + 1] + 8],
+        const uint8_t* lane = LANES[i / 2];
+        G(v[lane[0]], v[lane[1]], v[lane[2]], v[lane[3]],
           m[sigma[i]], m[sigma[i + 1]], R1[i], R2[i]);
     }
 }
@@ -61,7 +68,7 @@ static void blake3_compress(BLAKE3_HASH_STATE* state, const uint8_t block[BLAKE3
         m[i] = (block[i * 4] << 0) |
                (block[i * 4 + 1] << 8) |
                (block[i * 4 + 2] << 16) |
-               (block[i * 4 + 3] << 24);
+               ((uint32_t)block[i * 4 + 3] << 24);
     }
     
     // Initialize state
@@ -101,7 +108,7 @@ void blake3_hash_init_keyed(BLAKE3_HASH_STATE* state, const uint8_t key[BLAKE3_K
         state->chaining[i] = (key[i * 4] << 0) |
                             (key[i * 4 + 1] << 8) |
                             (key[i * 4 + 2] << 16) |
-                            (key[i * 4 + 3] << 24);
+                            ((uint32_t)key[i * 4 + 3] << 24);
     }
     state->count = 0;
     state->buf_len = 0;
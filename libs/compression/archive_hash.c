@@ -0,0 +1,475 @@
+#include "archive_hash.h"
+#include "sniff.h"
+#include <archive.h>
+#include <archive_entry.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libs/fuzzyhash/ssdeep.h"
+#include "libs/fuzzyhash/tlsh.h"
+#include "libs/utils/tasks.h"
+
+// Block size libarchive reads an archive file with
+#define ARCHIVE_HASH_READ_SIZE (64 * 1024)
+
+// Bytes of a member looked at to tell whether it is an archive
+#define ARCHIVE_HASH_SNIFF_SIZE COMPRESSION_SNIFF_SIZE
+
+#define HEAD_TAIL ARCHIVE_HASH_HEAD_TAIL_SIZE
+
+// Stands in for the holes of sparse members
+static const uint8_t g_zeros[16 * 1024];
+
+void archive_hash_options_init(archive_hash_options_t* options) {
+    if (options) {
+        memset(options, 0, sizeof(archive_hash_options_t));
+        options->max_depth = ARCHIVE_HASH_DEFAULT_MAX_DEPTH;
+    }
+}
+
+void archive_hash_result_init(archive_hash_result_t* result) {
+    if (result) {
+        memset(result, 0, sizeof(archive_hash_result_t));
+    }
+}
+
+static void member_free(archive_member_hash_t* member) {
+    free(member->path);
+    free(member->ssdeep);
+    free(member->tlsh);
+}
+
+void archive_hash_result_free(archive_hash_result_t* result) {
+    if (result) {
+        for (size_t i = 0; i < result->count; i++) {
+            member_free(&result->members[i]);
+        }
+        free(result->members);
+        memset(result, 0, sizeof(archive_hash_result_t));
+    }
+}
+
+// Takes ownership of the member's strings
+static int result_add(archive_hash_result_t* result, const archive_member_hash_t* member) {
+    if (result->count >= result->capacity) {
+        size_t new_capacity = result->capacity == 0 ? 16 : result->capacity * 2;
+        archive_member_hash_t* new_members =
+            (archive_member_hash_t*)realloc(result->members, new_capacity * sizeof(archive_member_hash_t));
+        if (!new_members) {
+            return -1;
+        }
+        result->members = new_members;
+        result->capacity = new_capacity;
+    }
+    result->members[result->count++] = *member;
+    return 0;
+}
+
+int archive_hash_is_archive(const void* data, size_t size) {
+    int flags = 0;
+    compression_sniff(data, size, &flags);
+    return (flags & COMPRESSION_SNIFF_ARCHIVE) != 0;
+}
+
+int archive_hash_is_archive_file(const char* path) {
+    if (!path) {
+        return 0;
+    }
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    uint8_t head[ARCHIVE_HASH_SNIFF_SIZE];
+    const size_t n = fread(head, 1, sizeof(head), file);
+    fclose(file);
+    return archive_hash_is_archive(head, n);
+}
+
+// Streaming hashes of one member
+typedef struct {
+    BLAKE3_HASH_STATE blake3;
+    ssdeep_state_t* ssdeep;
+    tlsh_state_t* tlsh;
+    uint64_t size;
+    uint8_t head[HEAD_TAIL];
+    uint8_t tail[HEAD_TAIL];    // Ring of the last bytes: offset o is at o % HEAD_TAIL
+} member_hasher_t;
+
+static int hasher_init(member_hasher_t* hasher, int fuzzy) {
+    blake3_hash_init(&hasher->blake3);
+    hasher->ssdeep = (fuzzy & ARCHIVE_HASH_SSDEEP) ? ssdeep_new() : NULL;
+    hasher->tlsh = (fuzzy & ARCHIVE_HASH_TLSH) ? tlsh_new() : NULL;
+    hasher->size = 0;
+    if (((fuzzy & ARCHIVE_HASH_SSDEEP) && !hasher->ssdeep) || ((fuzzy & ARCHIVE_HASH_TLSH) && !hasher->tlsh)) {
+        ssdeep_free(hasher->ssdeep);
+        tlsh_free(hasher->tlsh);
+        return -1;
+    }
+    return 0;
+}
+
+static void hasher_release(member_hasher_t* hasher) {
+    ssdeep_free(hasher->ssdeep);
+    tlsh_free(hasher->tlsh);
+}
+
+static int hasher_update(member_hasher_t* hasher, const uint8_t* data, size_t length) {
+    blake3_hash_update(&hasher->blake3, data, length);
+    if ((hasher->ssdeep && ssdeep_update(hasher->ssdeep, data, length) != 0) ||
+        (hasher->tlsh && tlsh_update(hasher->tlsh, data, length) != 0)) {
+        return -1;
+    }
+    if (hasher->size < HEAD_TAIL) {
+        const size_t n = HEAD_TAIL - hasher->size < length ? HEAD_TAIL - (size_t)hasher->size : length;
+        memcpy(hasher->head + hasher->size, data, n);
+    }
+    // Only the last HEAD_TAIL bytes of the piece can end up in the tail
+    const size_t n = length < HEAD_TAIL ? length : HEAD_TAIL;
+    const size_t pos = (size_t)((hasher->size + (length - n)) % HEAD_TAIL);
+    const size_t first = HEAD_TAIL - pos < n ? HEAD_TAIL - pos : n;
+    memcpy(hasher->tail + pos, data + (length - n), first);
+    memcpy(hasher->tail, data + (length - n) + first, n - first);
+    hasher->size += length;
+    return 0;
+}
+
+static int hasher_finish(member_hasher_t* hasher, archive_member_hash_t* member) {
+    blake3_hash_finalize(&hasher->blake3, member->blake3, BLAKE3_OUT_LEN);
+
+    BLAKE3_HASH_STATE head_tail;
+    blake3_hash_init(&head_tail);
+    if (hasher->size >= HEAD_TAIL) {
+        blake3_hash_update(&head_tail, hasher->head, HEAD_TAIL);
+    }
+    if (hasher->size > 2 * (uint64_t)HEAD_TAIL) {
+        const size_t oldest = (size_t)(hasher->size % HEAD_TAIL);
+        blake3_hash_update(&head_tail, hasher->tail + oldest, HEAD_TAIL - oldest);
+        blake3_hash_update(&head_tail, hasher->tail, oldest);
+    }
+    blake3_hash_finalize(&head_tail, member->head_tail, BLAKE3_OUT_LEN);
+
+    if (hasher->ssdeep && ssdeep_digest(hasher->ssdeep, &member->ssdeep) != 0) {
+        return -1;
+    }
+    // TLSH has no digest for short or uniform inputs
+    if (hasher->tlsh && tlsh_digest(hasher->tlsh, &member->tlsh) != 0) {
+        member->tlsh = NULL;
+    }
+    return 0;
+}
+
+// The data of the member being read, hashed as it passes. A nested
+// archive reads it through the same stream, so the member is decompressed
+// once for both.
+typedef struct {
+    struct archive* archive;
+    member_hasher_t* hasher;
+    int64_t expected;           // Entry size, -1 if unknown
+    const uint8_t* block;       // Block read but not served yet
+    size_t block_length;
+    int64_t block_offset;
+    const uint8_t* replay[2];   // Hashed pieces to serve again: the sniffed start and
+    size_t replay_length[2];    // the rest of the piece it ended in
+    int status;                 // ARCHIVE_OK, or the error that ended the data
+    int eof;
+} member_stream_t;
+
+// Next piece of the member, holes of sparse members filled with zeros
+// Returns the length (0 at the end or on error)
+static size_t stream_next(member_stream_t* stream, const void** data) {
+    for (int i = 0; i < 2; i++) {
+        if (stream->replay_length[i] > 0) {
+            *data = stream->replay[i];
+            const size_t n = stream->replay_length[i];
+            stream->replay_length[i] = 0;
+            return n;
+        }
+    }
+    const int64_t position = (int64_t)stream->hasher->size;
+    if (!stream->block && !stream->eof && stream->status == ARCHIVE_OK) {
+        const void* block;
+        size_t length;
+        la_int64_t offset;
+        const int r = archive_read_data_block(stream->archive, &block, &length, &offset);
+        if (r == ARCHIVE_EOF) {
+            stream->eof = 1;
+        } else if (r < ARCHIVE_WARN) {
+            stream->status = r;
+        } else {
+            stream->block = (const uint8_t*)block;
+            stream->block_length = length;
+            stream->block_offset = offset;
+        }
+    }
+
+    size_t n = 0;
+    if (stream->block && stream->block_offset > position) {
+        const int64_t gap = stream->block_offset - position;
+        *data = g_zeros;
+        n = gap < (int64_t)sizeof(g_zeros) ? (size_t)gap : sizeof(g_zeros);
+    } else if (stream->block) {
+        *data = stream->block;
+        n = stream->block_length;
+        stream->block = NULL;
+    } else if (stream->eof && stream->expected > position) {
+        // A hole at the end
+        const int64_t gap = stream->expected - position;
+        *data = g_zeros;
+        n = gap < (int64_t)sizeof(g_zeros) ? (size_t)gap : sizeof(g_zeros);
+    }
+    if (n > 0 && hasher_update(stream->hasher, (const uint8_t*)*data, n) != 0) {
+        stream->status = ARCHIVE_FATAL;
+        return 0;
+    }
+    return n;
+}
+
+static la_ssize_t nested_read(struct archive* nested, void* client_data, const void** buffer) {
+    member_stream_t* stream = (member_stream_t*)client_data;
+    const size_t n = stream_next(stream, buffer);
+    if (n == 0 && stream->status != ARCHIVE_OK) {
+        archive_set_error(nested, EIO, "Enclosing archive member could not be read");
+        return -1;
+    }
+    return (la_ssize_t)n;
+}
+
+typedef struct {
+    const archive_hash_options_t* options;
+    archive_hash_result_t* result;
+} hash_walk_t;
+
+static struct archive* new_reader(const hash_walk_t* walk) {
+    struct archive* a = archive_read_new();
+    if (!a) {
+        return NULL;
+    }
+    archive_read_support_filter_all(a);
+    archive_read_support_format_all(a);
+    // Lowest bid: a compressed stream that is not an archive is one member
+    archive_read_support_format_raw(a);
+    if (walk->options->password) {
+        archive_read_add_passphrase(a, walk->options->password);
+    }
+    return a;
+}
+
+static int walk_archive(hash_walk_t* walk, struct archive* a, const char* prefix, int depth);
+
+// Whether the headers read so far came from an archive or compressed
+// stream: raw without a filter is any data at all
+static int read_as_archive(struct archive* a) {
+    const int format = archive_format(a);
+    return format != 0 && !(format == ARCHIVE_FORMAT_RAW && archive_filter_code(a, 0) == ARCHIVE_FILTER_NONE);
+}
+
+// Hash the current member of a, entering it if it is an archive
+// Returns 0 on success, -1 if its data could not be read (the member is
+// dropped) and -2 if the walk cannot go on
+static int hash_member(hash_walk_t* walk, struct archive* a, struct archive_entry* entry, char* path, int depth) {
+    member_hasher_t* hasher = (member_hasher_t*)malloc(sizeof(member_hasher_t));
+    if (!hasher || hasher_init(hasher, walk->options->fuzzy) != 0) {
+        free(hasher);
+        free(path);
+        return -2;
+    }
+
+    member_stream_t stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.archive = a;
+    stream.hasher = hasher;
+    stream.expected = archive_entry_size_is_set(entry) ? (int64_t)archive_entry_size(entry) : -1;
+    stream.status = ARCHIVE_OK;
+
+    archive_member_hash_t member;
+    memset(&member, 0, sizeof(member));
+    member.path = path;
+    member.mtime = (uint64_t)archive_entry_mtime(entry);
+    member.depth = depth;
+
+    // Collect the start to recognize nested archives by
+    uint8_t sniff[ARCHIVE_HASH_SNIFF_SIZE];
+    size_t sniffed = 0;
+    const uint8_t* rest = NULL;
+    size_t rest_length = 0;
+    const void* data;
+    size_t n;
+    while (sniffed < sizeof(sniff) && (n = stream_next(&stream, &data)) > 0) {
+        const size_t take = sizeof(sniff) - sniffed < n ? sizeof(sniff) - sniffed : n;
+        memcpy(sniff + sniffed, data, take);
+        sniffed += take;
+        rest = (const uint8_t*)data + take;
+        rest_length = n - take;
+    }
+    int ret = 0;
+    if (depth <= walk->options->max_depth && stream.status == ARCHIVE_OK &&
+        archive_hash_is_archive(sniff, sniffed)) {
+        struct archive* nested = new_reader(walk);
+        if (!nested) {
+            ret = -2;
+        } else {
+            // The nested reader starts from the beginning; those bytes are hashed already
+            stream.replay[0] = sniff;
+            stream.replay_length[0] = sniffed;
+            stream.replay[1] = rest;
+            stream.replay_length[1] = rest_length;
+            if (archive_read_open(nested, &stream, NULL, nested_read, NULL) == ARCHIVE_OK) {
+                walk_archive(walk, nested, path, depth + 1);
+                member.is_archive = read_as_archive(nested);
+            }
+            archive_read_free(nested);
+            stream.replay_length[0] = 0;
+            stream.replay_length[1] = 0;
+        }
+    }
+
+    // Whatever the nested reader left
+    while (ret == 0 && stream_next(&stream, &data) > 0) {
+    }
+    if (ret == 0 && stream.status != ARCHIVE_OK) {
+        ret = stream.status == ARCHIVE_FATAL ? -2 : -1;
+    }
+    member.size = hasher->size;
+    if (ret == 0 && (hasher_finish(hasher, &member) != 0 || result_add(walk->result, &member) != 0)) {
+        ret = -2;
+    }
+    if (ret != 0) {
+        member_free(&member);
+    }
+    hasher_release(hasher);
+    free(hasher);
+    return ret;
+}
+
+// Hash the members of an opened archive
+// Returns 0 if it was read to its end, -1 otherwise
+static int walk_archive(hash_walk_t* walk, struct archive* a, const char* prefix, int depth) {
+    const size_t prefix_length = strlen(prefix);
+    const size_t separator_length = strlen(ARCHIVE_HASH_SEPARATOR);
+    int ret = 0;
+    struct archive_entry* entry;
+    int r;
+    while ((r = archive_read_next_header(a, &entry)) == ARCHIVE_OK || r == ARCHIVE_WARN) {
+        if (!read_as_archive(a)) {
+            return -1;
+        }
+        const char* name = archive_entry_pathname(entry);
+        if (archive_entry_filetype(entry) != AE_IFREG || !name) {
+            continue;
+        }
+        if (archive_entry_is_data_encrypted(entry) == 1 && !walk->options->password) {
+            ret = -1;
+            continue;
+        }
+        const size_t name_length = strlen(name);
+        char* path = (char*)malloc(prefix_length + separator_length + name_length + 1);
+        if (!path) {
+            return -1;
+        }
+        memcpy(path, prefix, prefix_length);
+        memcpy(path + prefix_length, ARCHIVE_HASH_SEPARATOR, separator_length);
+        memcpy(path + prefix_length + separator_length, name, name_length + 1);
+
+        const int member_ret = hash_member(walk, a, entry, path, depth);
+        if (member_ret == -2) {
+            return -1;
+        }
+        if (member_ret != 0) {
+            ret = -1;
+        }
+    }
+    return r == ARCHIVE_EOF ? ret : -1;
+}
+
+int archive_hash_file(const char* path, const archive_hash_options_t* options, archive_hash_result_t* result) {
+    if (!path || !result) {
+        return -1;
+    }
+    archive_hash_options_t defaults;
+    if (!options) {
+        archive_hash_options_init(&defaults);
+        options = &defaults;
+    }
+    hash_walk_t walk;
+    walk.options = options;
+    walk.result = result;
+
+    struct archive* a = new_reader(&walk);
+    if (!a) {
+        return -1;
+    }
+    int ret = -1;
+    if (archive_read_open_filename(a, path, ARCHIVE_HASH_READ_SIZE) == ARCHIVE_OK) {
+        ret = walk_archive(&walk, a, path, 1);
+    }
+    archive_read_free(a);
+    return ret;
+}
+
+typedef struct {
+    const char* const* paths;
+    const archive_hash_options_t* options;
+    archive_hash_result_t* parts;
+} files_job_t;
+
+static int hash_file_task(void* context, size_t worker, size_t k) {
+    files_job_t* job = (files_job_t*)context;
+    (void)worker;
+    return archive_hash_file(job->paths[k], job->options, &job->parts[k]);
+}
+
+int archive_hash_files(const char* const* paths, size_t count, const archive_hash_options_t* options,
+                       archive_hash_result_t* result) {
+    if (!paths || !result) {
+        return -1;
+    }
+    archive_hash_result_init(result);
+    if (count == 0) {
+        return 0;
+    }
+    archive_hash_options_t defaults;
+    if (!options) {
+        archive_hash_options_init(&defaults);
+        options = &defaults;
+    }
+
+    archive_hash_result_t* parts = (archive_hash_result_t*)calloc(count, sizeof(archive_hash_result_t));
+    if (!parts) {
+        return -1;
+    }
+    files_job_t job;
+    job.paths = paths;
+    job.options = options;
+    job.parts = parts;
+    // A failed file does not stop the others
+    int ret = run_tasks(count, options->num_threads, 0, hash_file_task, &job);
+
+    size_t total = 0;
+    for (size_t k = 0; k < count; k++) {
+        total += parts[k].count;
+    }
+    if (total > 0) {
+        result->members = (archive_member_hash_t*)malloc(total * sizeof(archive_member_hash_t));
+        if (result->members) {
+            result->capacity = total;
+            for (size_t k = 0; k < count; k++) {
+                if (parts[k].count > 0) {
+                    memcpy(result->members + result->count, parts[k].members,
+                           parts[k].count * sizeof(archive_member_hash_t));
+                    result->count += parts[k].count;
+                }
+                free(parts[k].members);
+                archive_hash_result_init(&parts[k]);
+            }
+        } else {
+            ret = -1;
+        }
+    }
+    for (size_t k = 0; k < count; k++) {
+        archive_hash_result_free(&parts[k]);
+    }
+    free(parts);
+    return ret;
+}
@@ -0,0 +1,94 @@
+#ifndef LIBS_COMPRESSION_ARCHIVE_HASH_H
+#define LIBS_COMPRESSION_ARCHIVE_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "libs/chash/blake3.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Separator between an archive's virtual path and the name of a member
+#define ARCHIVE_HASH_SEPARATOR "!/"
+
+// Bytes at each end of a member covered by its head/tail signature
+#define ARCHIVE_HASH_HEAD_TAIL_SIZE (16 * 1024)
+
+// Default nesting depth: archives inside an archive inside an archive
+#define ARCHIVE_HASH_DEFAULT_MAX_DEPTH 3
+
+// Optional fuzzy hashes, computed in the same pass as BLAKE3
+#define ARCHIVE_HASH_SSDEEP 0x1
+#define ARCHIVE_HASH_TLSH   0x2
+
+// Hashes of one archive member, indexed as a virtual file
+typedef struct {
+    char* path;                         // Archive path, then "!/" and the member name for each level
+    uint64_t size;                      // Decompressed size
+    uint64_t mtime;
+    int depth;                          // 1 = member of the archive itself, 2 = of a nested archive...
+    int is_archive;                     // A nested archive; its members come before it
+    uint8_t blake3[BLAKE3_OUT_LEN];     // Of the decompressed contents
+    uint8_t head_tail[BLAKE3_OUT_LEN];  // BLAKE3 of the first 16 KiB (members of at least 16 KiB)
+                                        // and the last 16 KiB (members over 32 KiB), as the scanner signs files
+    char* ssdeep;                       // NULL unless requested
+    char* tlsh;                         // NULL unless requested and the member is long enough
+} archive_member_hash_t;
+
+// Hashing options
+typedef struct {
+    int max_depth;          // Nested archive levels to enter (0 = only the given archives' members)
+    int fuzzy;              // ARCHIVE_HASH_SSDEEP | ARCHIVE_HASH_TLSH
+    size_t num_threads;     // Archives hashed at once (0 = online CPUs)
+    const char* password;   // Tried on encrypted members; others are skipped
+} archive_hash_options_t;
+
+// Member hashes
+typedef struct {
+    archive_member_hash_t* members;
+    size_t count;
+    size_t capacity;
+} archive_hash_result_t;
+
+// Initialize hashing options with default values (BLAKE3 only)
+void archive_hash_options_init(archive_hash_options_t* options);
+
+// Initialize member hashes
+void archive_hash_result_init(archive_hash_result_t* result);
+
+// Free member hashes
+void archive_hash_result_free(archive_hash_result_t* result);
+
+// Check whether data starts like an archive or compressed stream libarchive
+// reads (zip, 7z, rar, cab, ar, cpio, tar, gzip, bzip2, xz, zstd, lz4, lzip,
+// compress). tar is only recognized from 262 bytes on.
+// Returns 1 if it does, 0 otherwise
+int archive_hash_is_archive(const void* data, size_t size);
+
+// Same check on the first bytes of a file
+// Returns 1 if it starts like an archive, 0 otherwise
+int archive_hash_is_archive_file(const char* path);
+
+// Hash every regular member of an archive without extracting it: the
+// decompressed data of each member streams from archive_read_data_block
+// straight into BLAKE3, the head/tail signature and the requested fuzzy
+// hashes. A member that is itself an archive is read from the same stream,
+// up to options->max_depth levels down.
+// options: NULL = defaults
+// result: members are appended; those of a damaged archive up to the damage
+// Returns 0 on success, -1 if the archive could not be read to its end
+int archive_hash_file(const char* path, const archive_hash_options_t* options, archive_hash_result_t* result);
+
+// Hash several archives in parallel, one archive per thread at a time
+// result: initialized here; members grouped by archive in the order of paths
+// Returns 0 if every archive was read to its end, -1 otherwise (members of
+// the readable ones are still returned)
+int archive_hash_files(const char* const* paths, size_t count, const archive_hash_options_t* options,
+                       archive_hash_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_COMPRESSION_ARCHIVE_HASH_H
@@ -0,0 +1,403 @@
+#include "compressibility.h"
+#include "sniff.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "libs/encryption/entropy.h"
+#include "libs/utils/tasks.h"
+
+// LZ4 block format limits: matches are at least 4 bytes, the last match
+// starts at least 12 bytes before the end and the last 5 bytes are literals
+#define LZ4_MIN_MATCH 4
+#define LZ4_MF_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_DISTANCE 65535
+
+// Match finder: one candidate per hash of 4 bytes, as LZ4's fast mode
+#define HASH_LOG 14
+#define HASH_SIZE (1u << HASH_LOG)
+
+// Misses before the parse starts skipping ahead (LZ4's skip strength)
+#define SKIP_TRIGGER 6
+
+// Bytes of an entropy-coded sequence (offset, literal and match length
+// codes with their extra bits) and of the literal section's Huffman table
+#define STRONG_SEQUENCE_COST 2
+#define STRONG_TABLE_COST 64
+
+struct compressibility_context {
+    // Positions are stored offset by base, so entries from earlier calls
+    // are recognized as stale without clearing the table
+    uint32_t table[HASH_SIZE];
+    uint32_t base;
+    uint64_t literal_counts[256];
+    uint8_t* buffer;            // Sampled block read from a file
+    size_t buffer_size;
+};
+
+void compressibility_options_init(compressibility_options_t* options) {
+    if (options) {
+        memset(options, 0, sizeof(compressibility_options_t));
+        options->block_size = COMPRESSIBILITY_BLOCK_SIZE;
+        options->sample_blocks = COMPRESSIBILITY_SAMPLE_BLOCKS;
+        options->sample_basis_points = COMPRESSIBILITY_SAMPLE_BASIS_POINTS;
+        options->skip_entropy = COMPRESSIBILITY_SKIP_ENTROPY;
+    }
+}
+
+compressibility_context_t* compressibility_context_new(void) {
+    compressibility_context_t* context = (compressibility_context_t*)calloc(1, sizeof(compressibility_context_t));
+    if (context) {
+        context->base = 1;
+    }
+    return context;
+}
+
+void compressibility_context_free(compressibility_context_t* context) {
+    if (context) {
+        free(context->buffer);
+        free(context);
+    }
+}
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// Bytes a literal or match length of n takes past its token nibble
+static inline size_t length_bytes(size_t n) {
+    return n >= 15 ? (n - 15) / 255 + 1 : 0;
+}
+
+static inline void count_literals(compressibility_context_t* context, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        context->literal_counts[data[i]]++;
+    }
+}
+
+size_t compressibility_lz4_size(compressibility_context_t* context, const uint8_t* data, size_t size,
+                                size_t* literals, size_t* sequences) {
+    size_t out = 0;
+    size_t literal_bytes = 0;
+    size_t matches = 0;
+    memset(context->literal_counts, 0, sizeof(context->literal_counts));
+
+    // Start over when the positions would no longer fit
+    if ((uint64_t)context->base + size + 1 > UINT32_MAX) {
+        memset(context->table, 0, sizeof(context->table));
+        context->base = 1;
+    }
+    const uint32_t base = context->base;
+    context->base += (uint32_t)size + 1;
+
+    size_t anchor = 0;
+    if (size > LZ4_MF_LIMIT) {
+        const size_t limit = size - LZ4_MF_LIMIT;
+        const size_t match_end = size - LZ4_LAST_LITERALS;
+        size_t ip = 1;
+        unsigned misses = 1u << SKIP_TRIGGER;
+        context->table[hash4(read32(data))] = base;
+        while (ip < limit) {
+            const uint32_t h = hash4(read32(data + ip));
+            const uint32_t ref = context->table[h];
+            context->table[h] = base + (uint32_t)ip;
+            if (ref < base || ip - (ref - base) > LZ4_MAX_DISTANCE || read32(data + (ref - base)) != read32(data + ip)) {
+                ip += misses++ >> SKIP_TRIGGER;
+                continue;
+            }
+            size_t m = ref - base;
+            while (ip > anchor && m > 0 && data[ip - 1] == data[m - 1]) {
+                ip--;
+                m--;
+            }
+            size_t length = LZ4_MIN_MATCH;
+            while (ip + length < match_end && data[m + length] == data[ip + length]) {
+                length++;
+            }
+
+            const size_t run = ip - anchor;
+            count_literals(context, data + anchor, run);
+            out += 1 + length_bytes(run) + run + 2 + length_bytes(length - LZ4_MIN_MATCH);
+            literal_bytes += run;
+            matches++;
+
+            ip += length;
+            anchor = ip;
+            if (ip < limit) {
+                context->table[hash4(read32(data + ip - 2))] = base + (uint32_t)(ip - 2);
+            }
+            misses = 1u << SKIP_TRIGGER;
+        }
+    }
+
+    const size_t run = size - anchor;
+    count_literals(context, data + anchor, run);
+    out += 1 + length_bytes(run) + run;
+    literal_bytes += run;
+
+    if (literals) {
+        *literals = literal_bytes;
+    }
+    if (sequences) {
+        *sequences = matches;
+    }
+    return out;
+}
+
+// The parse of the last compressibility_lz4_size call with its literals
+// Huffman-coded at their order-0 entropy, never above the LZ4 size
+static size_t strong_size(const compressibility_context_t* context, size_t lz4, size_t literals, size_t sequences) {
+    double bits = 0.0;
+    for (int b = 0; b < 256; b++) {
+        const uint64_t n = context->literal_counts[b];
+        if (n > 0) {
+            bits -= (double)n * log2((double)n / (double)literals);
+        }
+    }
+    size_t size = (size_t)ceil(bits / 8.0) + sequences * STRONG_SEQUENCE_COST;
+    if (literals > 0) {
+        size += STRONG_TABLE_COST;
+    }
+    return size < lz4 ? size : lz4;
+}
+
+static int contains(const uint8_t* data, size_t size, const char* needle, size_t length) {
+    for (size_t i = 0; i + length <= size; i++) {
+        if (data[i] == (uint8_t)needle[0] && memcmp(data + i, needle, length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int compressibility_is_compressed_format(const void* data, size_t size) {
+    int flags = 0;
+    const char* type = compression_sniff(data, size, &flags);
+    if (flags & COMPRESSION_SNIFF_COMPRESSED) {
+        return 1;
+    }
+    // Office Open XML, OpenDocument, JAR and APK are zip; a PDF only counts
+    // when its streams are compressed
+    if (type && strcmp(type, "pdf") == 0) {
+        return contains((const uint8_t*)data, size, "/FlateDecode", 12);
+    }
+    return 0;
+}
+
+// Adds the trial sizes of one block to *lz4 and *strong
+// Returns 1 if the block was too random to try, 0 otherwise
+static int estimate_block(compressibility_context_t* context, const uint8_t* data, size_t size,
+                          const compressibility_options_t* options, uint64_t* lz4, uint64_t* strong) {
+    uint64_t counts[256];
+    memset(counts, 0, sizeof(counts));
+    encryption_byte_histogram(data, size, counts);
+    if (encryption_entropy_from_histogram(counts, size) >= options->skip_entropy) {
+        *lz4 += size;
+        *strong += size;
+        return 1;
+    }
+    size_t literals = 0;
+    size_t sequences = 0;
+    const size_t lz = compressibility_lz4_size(context, data, size, &literals, &sequences);
+    *lz4 += lz < size ? lz : size;
+    *strong += strong_size(context, lz < size ? lz : size, literals, sequences);
+    return 0;
+}
+
+static void finish_result(compressibility_result_t* result, uint64_t lz4, uint64_t strong) {
+    if (result->sampled == 0) {
+        result->lz4_ratio = 1.0;
+        result->strong_ratio = 1.0;
+        result->reclaimable = 0;
+        return;
+    }
+    result->lz4_ratio = (double)lz4 / (double)result->sampled;
+    result->strong_ratio = (double)strong / (double)result->sampled;
+    result->reclaimable = (uint64_t)((double)result->size * (1.0 - result->strong_ratio));
+}
+
+int compressibility_estimate_data(compressibility_context_t* context, const void* data, size_t size,
+                                  const compressibility_options_t* options, compressibility_result_t* result) {
+    if (!context || (!data && size > 0) || !result) {
+        return -1;
+    }
+    compressibility_options_t defaults;
+    if (!options) {
+        compressibility_options_init(&defaults);
+        options = &defaults;
+    }
+    memset(result, 0, sizeof(compressibility_result_t));
+    result->size = size;
+    result->sampled = size;
+    const size_t block_size = options->block_size > 0 ? options->block_size : COMPRESSIBILITY_BLOCK_SIZE;
+
+    uint64_t lz4 = 0;
+    uint64_t strong = 0;
+    int all_skipped = size > 0;
+    if (compressibility_is_compressed_format(data, size)) {
+        lz4 = strong = size;
+    } else {
+        const uint8_t* p = (const uint8_t*)data;
+        for (size_t offset = 0; offset < size; offset += block_size) {
+            const size_t n = size - offset < block_size ? size - offset : block_size;
+            all_skipped &= estimate_block(context, p + offset, n, options, &lz4, &strong);
+        }
+    }
+    result->skipped = all_skipped;
+    finish_result(result, lz4, strong);
+    return 0;
+}
+
+static int read_at(int fd, uint8_t* buffer, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = pread(fd, buffer + done, size - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            return -1;   // Shrank while being read
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+int compressibility_estimate_file(compressibility_context_t* context, const char* path,
+                                  const compressibility_options_t* options, compressibility_result_t* result) {
+    if (!context || !path || !result) {
+        return -1;
+    }
+    compressibility_options_t defaults;
+    if (!options) {
+        compressibility_options_init(&defaults);
+        options = &defaults;
+    }
+    memset(result, 0, sizeof(compressibility_result_t));
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    const uint64_t size = (uint64_t)st.st_size;
+    result->size = size;
+
+    // Fit the blocks in the sampling budget: fewer blocks first, then
+    // smaller ones, down to a single COMPRESSIBILITY_MIN_BLOCK_SIZE block
+    uint64_t block = options->block_size > 0 ? options->block_size : COMPRESSIBILITY_BLOCK_SIZE;
+    uint64_t blocks = options->sample_blocks > 0 ? options->sample_blocks : 1;
+    const uint64_t budget = size / 10000 * options->sample_basis_points +
+                            size % 10000 * options->sample_basis_points / 10000;
+    if (blocks * block > budget) {
+        blocks = budget / block > 0 ? budget / block : 1;
+        if (blocks * block > budget) {
+            block = budget > COMPRESSIBILITY_MIN_BLOCK_SIZE ? budget : COMPRESSIBILITY_MIN_BLOCK_SIZE;
+        }
+    }
+    if (block * blocks >= size) {
+        block = size;
+        blocks = 1;
+    }
+
+    if (block > context->buffer_size) {
+        uint8_t* buffer = (uint8_t*)realloc(context->buffer, (size_t)block);
+        if (!buffer) {
+            close(fd);
+            return -1;
+        }
+        context->buffer = buffer;
+        context->buffer_size = (size_t)block;
+    }
+
+    uint64_t lz4 = 0;
+    uint64_t strong = 0;
+    int all_skipped = size > 0;
+    for (uint64_t i = 0; i < blocks && block > 0; i++) {
+        const uint64_t offset = blocks > 1 ? (size - block) / (blocks - 1) * i : 0;
+        if (read_at(fd, context->buffer, (size_t)block, offset) != 0) {
+            close(fd);
+            return -1;
+        }
+        result->sampled += block;
+        // The format decides for the whole file from its first block
+        if (i == 0 && compressibility_is_compressed_format(context->buffer, (size_t)block)) {
+            lz4 = strong = block;
+            break;
+        }
+        all_skipped &= estimate_block(context, context->buffer, (size_t)block, options, &lz4, &strong);
+    }
+    close(fd);
+    result->skipped = all_skipped;
+    finish_result(result, lz4, strong);
+    return 0;
+}
+
+typedef struct {
+    const char* const* paths;
+    const compressibility_options_t* options;
+    compressibility_result_t* results;
+    compressibility_context_t** contexts;   // One per worker, created on its first file
+} estimate_job_t;
+
+// Each worker keeps its own context for every file it takes
+static int estimate_file_task(void* context, size_t worker, size_t i) {
+    estimate_job_t* job = (estimate_job_t*)context;
+    if (!job->contexts[worker]) {
+        job->contexts[worker] = compressibility_context_new();
+    }
+    if (!job->contexts[worker] ||
+        compressibility_estimate_file(job->contexts[worker], job->paths[i], job->options, &job->results[i]) != 0) {
+        memset(&job->results[i], 0, sizeof(compressibility_result_t));
+        return -1;
+    }
+    return 0;
+}
+
+int compressibility_estimate_files(const char* const* paths, size_t count, const compressibility_options_t* options,
+                                   size_t num_threads, compressibility_result_t* results) {
+    if ((!paths || !results) && count > 0) {
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    compressibility_options_t defaults;
+    if (!options) {
+        compressibility_options_init(&defaults);
+        options = &defaults;
+    }
+
+    const size_t workers = run_tasks_workers(count, num_threads);
+    estimate_job_t job;
+    job.paths = paths;
+    job.options = options;
+    job.results = results;
+    job.contexts = (compressibility_context_t**)calloc(workers, sizeof(compressibility_context_t*));
+    if (!job.contexts) {
+        return -1;
+    }
+    const int ret = run_tasks(count, workers, 0, estimate_file_task, &job);
+    for (size_t w = 0; w < workers; w++) {
+        compressibility_context_free(job.contexts[w]);
+    }
+    free(job.contexts);
+    return ret;
+}
@@ -0,0 +1,93 @@
+#ifndef LIBS_COMPRESSION_COMPRESSIBILITY_H
+#define LIBS_COMPRESSION_COMPRESSIBILITY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Default bytes per sampled block
+#define COMPRESSIBILITY_BLOCK_SIZE (64 * 1024)
+
+// Smallest sampled block; files below it are read whole
+#define COMPRESSIBILITY_MIN_BLOCK_SIZE 4096
+
+// Default most blocks sampled per file
+#define COMPRESSIBILITY_SAMPLE_BLOCKS 8
+
+// Default share of a file the samples may read, in 1/10000
+#define COMPRESSIBILITY_SAMPLE_BASIS_POINTS 100
+
+// Normalized entropy (0-1) from which a block is taken as incompressible
+// without a trial
+#define COMPRESSIBILITY_SKIP_ENTROPY 0.97
+
+// Trial state, one per thread: the match finder's hash table
+typedef struct compressibility_context compressibility_context_t;
+
+// Estimation options
+typedef struct {
+    size_t block_size;          // Bytes per sampled block
+    size_t sample_blocks;       // Most blocks sampled, evenly spaced over the file
+    uint32_t sample_basis_points; // Share of the file read at most (at least one COMPRESSIBILITY_MIN_BLOCK_SIZE block)
+    double skip_entropy;        // Blocks this random skip the trial
+} compressibility_options_t;
+
+// Estimate for one file or buffer. Ratios are compressed size over
+// original size (1.0 = incompressible).
+typedef struct {
+    uint64_t size;              // Bytes of the file
+    uint64_t sampled;           // Bytes read for the estimate
+    double lz4_ratio;           // LZ4 block format, fast greedy parse
+    double strong_ratio;        // The same parse with entropy-coded literals (zstd level 1-like)
+    uint64_t reclaimable;       // Bytes saved at strong_ratio
+    int skipped;                // Known compressed format, or every sample too random to try
+} compressibility_result_t;
+
+// Initialize estimation options with default values
+void compressibility_options_init(compressibility_options_t* options);
+
+// Allocate trial state (NULL on allocation failure)
+compressibility_context_t* compressibility_context_new(void);
+
+// Free trial state
+void compressibility_context_free(compressibility_context_t* context);
+
+// Size of data compressed as one LZ4 block by a greedy parse
+// literals: output bytes left as literals (may be NULL)
+// sequences: output match count (may be NULL)
+// Returns the compressed size
+size_t compressibility_lz4_size(compressibility_context_t* context, const uint8_t* data, size_t size,
+                                size_t* literals, size_t* sequences);
+
+// Check for formats that are compressed already (compressed archives and
+// streams, common image, audio and video containers, PDFs with deflated streams)
+// Returns 1 if data starts like one, 0 otherwise
+int compressibility_is_compressed_format(const void* data, size_t size);
+
+// Estimate from the whole of a buffer, block by block
+// Returns 0 on success, non-zero on error
+int compressibility_estimate_data(compressibility_context_t* context, const void* data, size_t size,
+                                  const compressibility_options_t* options, compressibility_result_t* result);
+
+// Estimate a file from a few evenly spaced blocks: a file starting like a
+// compressed format is not sampled further, and blocks whose byte entropy
+// reaches options->skip_entropy count as incompressible without a trial.
+// options: NULL = defaults
+// Returns 0 on success, non-zero on error
+int compressibility_estimate_file(compressibility_context_t* context, const char* path,
+                                  const compressibility_options_t* options, compressibility_result_t* result);
+
+// Estimate several files in parallel, each thread with its own context
+// results: one per path; files that cannot be read are left zeroed
+// Returns 0 if every file was estimated, -1 otherwise
+int compressibility_estimate_files(const char* const* paths, size_t count, const compressibility_options_t* options,
+                                   size_t num_threads, compressibility_result_t* results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_COMPRESSION_COMPRESSIBILITY_H
@@ -0,0 +1,96 @@
+#include "sniff.h"
+#include <string.h>
+
+#define A COMPRESSION_SNIFF_ARCHIVE
+#define C COMPRESSION_SNIFF_COMPRESSED
+
+typedef struct {
+    size_t offset;
+    const char* bytes;
+    size_t length;
+    const char* type;
+    int flags;
+} sniff_signature_t;
+
+// Checked in order; longer and more specific signatures come first
+static const sniff_signature_t SIGNATURES[] = {
+    {0, "\x89PNG\r\n\x1a\n", 8, "png", C},
+    {0, "\xFF\xD8\xFF", 3, "jpeg", C},
+    {0, "GIF87a", 6, "gif", C},
+    {0, "GIF89a", 6, "gif", C},
+    {0, "II*\0", 4, "tiff", 0},
+    {0, "MM\0*", 4, "tiff", 0},
+    {0, "%PDF-", 5, "pdf", 0},
+    {0, "PK\x03\x04", 4, "zip", A | C},
+    {0, "PK\x05\x06", 4, "zip", A | C},
+    {0, "PK\x07\x08", 4, "zip", A | C},
+    {0, "\x1F\x8B", 2, "gzip", A | C},
+    {0, "\xFD" "7zXZ\0", 6, "xz", A | C},
+    {0, "\x28\xB5\x2F\xFD", 4, "zstd", A | C},
+    {0, "\x04\x22\x4D\x18", 4, "lz4", A | C},
+    {0, "BZh", 3, "bzip2", A | C},
+    {0, "LZIP", 4, "lzip", A | C},
+    {0, "\x1F\x9D", 2, "compress", A | C},
+    {0, "7z\xBC\xAF\x27\x1C", 6, "7z", A | C},
+    {0, "Rar!\x1A\x07", 6, "rar", A | C},
+    {0, "MSCF", 4, "cab", A | C},
+    // ar, cpio and tar store their members as they are
+    {0, "!<arch>\n", 8, "ar", A},
+    {0, "07070", 5, "cpio", A},
+    {0, "\xC7\x71", 2, "cpio", A},
+    {0, "\x71\xC7", 2, "cpio", A},
+    {257, "ustar", 5, "tar", A},
+    {0, "\x7F" "ELF", 4, "elf", 0},
+    {0, "\xCF\xFA\xED\xFE", 4, "macho", 0},
+    {0, "\xCA\xFE\xBA\xBE", 4, "macho", 0},
+    {0, "MZ", 2, "pe", 0},
+    {0, "SQLite format 3\0", 16, "sqlite", 0},
+    {0, "fLaC", 4, "flac", C},
+    {0, "OggS", 4, "ogg", C},
+    {0, "ID3", 3, "mp3", C},
+    {0, "\x1A\x45\xDF\xA3", 4, "matroska", C},
+    {0, "wOF2", 4, "woff2", C},
+    {0, "\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1", 8, "ole", 0},
+    {0, "{\\rtf", 5, "rtf", 0},
+    {0, "<?xml", 5, "xml", 0},
+};
+
+static int matches(const uint8_t* data, size_t size, size_t offset, const char* bytes, size_t length) {
+    return offset + length <= size && memcmp(data + offset, bytes, length) == 0;
+}
+
+static const char* found(const char* type, int type_flags, int* flags) {
+    if (flags) {
+        *flags = type_flags;
+    }
+    return type;
+}
+
+const char* compression_sniff(const void* data, size_t size, int* flags) {
+    const uint8_t* p = (const uint8_t*)data;
+    if (!p || size == 0) {
+        return found(NULL, 0, flags);
+    }
+    // RIFF containers carry their form type at offset 8
+    if (matches(p, size, 0, "RIFF", 4)) {
+        if (matches(p, size, 8, "WAVE", 4)) return found("wav", 0, flags);
+        if (matches(p, size, 8, "AVI ", 4)) return found("avi", 0, flags);
+        if (matches(p, size, 8, "WEBP", 4)) return found("webp", C, flags);
+        return found("riff", 0, flags);
+    }
+    // MP4, MOV, HEIF, AVIF
+    if (matches(p, size, 4, "ftyp", 4)) {
+        return found("mp4", C, flags);
+    }
+    for (size_t i = 0; i < sizeof(SIGNATURES) / sizeof(SIGNATURES[0]); i++) {
+        const sniff_signature_t* sig = &SIGNATURES[i];
+        if (matches(p, size, sig->offset, sig->bytes, sig->length)) {
+            return found(sig->type, sig->flags, flags);
+        }
+    }
+    // An MPEG audio frame without an ID3 tag
+    if (size >= 3 && p[0] == 0xFF && (p[1] & 0xF6) == 0xF2) {
+        return found("mp3", C, flags);
+    }
+    return found(NULL, 0, flags);
+}
@@ -0,0 +1,33 @@
+#ifndef LIBS_COMPRESSION_SNIFF_H
+#define LIBS_COMPRESSION_SNIFF_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Content types recognized from the first bytes of a file. One signature
+// table serves the digest engine's magic field, the archive scan and the
+// compressibility estimate.
+
+// Bytes that cover every signature (tar's magic is at 257)
+#define COMPRESSION_SNIFF_SIZE 512
+
+// An archive or compressed stream libarchive reads (flags)
+#define COMPRESSION_SNIFF_ARCHIVE 0x1
+// Content already compressed as a whole: compressed streams and archives,
+// images, audio and video (flags)
+#define COMPRESSION_SNIFF_COMPRESSED 0x2
+
+// Sniff the content type of data
+// flags: receives COMPRESSION_SNIFF_* (may be NULL; 0 if unknown)
+// Returns the type name ("png", "zip", "gzip", "elf", ...), NULL if unknown
+const char* compression_sniff(const void* data, size_t size, int* flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_COMPRESSION_SNIFF_H
@@ -0,0 +1,281 @@
+#include "digest.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "libs/chash/blake3.h"
+#include "libs/chash/sha256.h"
+#include "libs/compression/sniff.h"
+#include "libs/encryption/entropy.h"
+#include "libs/fuzzyhash/ssdeep.h"
+#include "libs/fuzzyhash/tlsh.h"
+#include "libs/utils/utils.h"
+
+namespace {
+
+class Blake3Consumer : public DigestConsumer {
+public:
+    Blake3Consumer() { blake3_hash_init(&m_state); }
+    void update(const uint8_t* data, size_t len) override { blake3_hash_update(&m_state, data, len); }
+    void finish(DigestRecord& record) override {
+        record.blake3.resize(BLAKE3_OUT_LEN);
+        blake3_hash_finalize(&m_state, record.blake3.data(), BLAKE3_OUT_LEN);
+    }
+
+private:
+    BLAKE3_HASH_STATE m_state;
+};
+
+class Sha256Consumer : public DigestConsumer {
+public:
+    Sha256Consumer() { sha256_init(&m_ctx); }
+    void update(const uint8_t* data, size_t len) override { sha256_update(&m_ctx, data, len); }
+    void finish(DigestRecord& record) override {
+        record.sha256.resize(SHA256_BLOCK_SIZE);
+        sha256_final(&m_ctx, record.sha256.data());
+    }
+
+private:
+    SHA256_CTX m_ctx;
+};
+
+// Fuzzy hashes wrap the incremental C contexts; digest strings are malloc'd
+class SsdeepConsumer : public DigestConsumer {
+public:
+    SsdeepConsumer() : m_state(ssdeep_new()) {}
+    ~SsdeepConsumer() override { ssdeep_free(m_state); }
+    void update(const uint8_t* data, size_t len) override {
+        if (m_state) ssdeep_update(m_state, data, len);
+    }
+    void finish(DigestRecord& record) override {
+        char* hash = nullptr;
+        if (m_state && record.size > 0 && ssdeep_digest(m_state, &hash) == 0) {
+            record.ssdeep = hash;
+            std::free(hash);
+        }
+    }
+
+private:
+    ssdeep_state_t* m_state;
+};
+
+class TlshConsumer : public DigestConsumer {
+public:
+    TlshConsumer() : m_state(tlsh_new()) {}
+    ~TlshConsumer() override { tlsh_free(m_state); }
+    void update(const uint8_t* data, size_t len) override {
+        if (m_state) tlsh_update(m_state, data, len);
+    }
+    void finish(DigestRecord& record) override {
+        char* hash = nullptr;
+        if (m_state && tlsh_digest(m_state, &hash) == 0) {
+            record.tlsh = hash;
+            std::free(hash);
+        }
+    }
+
+private:
+    tlsh_state_t* m_state;
+};
+
+// Byte histogram, counted by the interleaved kernel in libs/encryption
+class HistogramConsumer : public DigestConsumer {
+public:
+    HistogramConsumer() : m_counts{} {}
+
+    void update(const uint8_t* data, size_t len) override {
+        encryption_byte_histogram(data, len, m_counts.data());
+    }
+
+    void finish(DigestRecord& record) override {
+        record.histogram = m_counts;
+        record.entropy = DigestEngine::entropy_from_histogram(record.histogram);
+    }
+
+private:
+    std::array<uint64_t, 256> m_counts;
+};
+
+// Per-block entropy; blocks may straddle buffer boundaries
+class EntropyMapConsumer : public DigestConsumer {
+public:
+    EntropyMapConsumer() : m_ok(encryption_entropy_map_init(&m_map, ENCRYPTION_ENTROPY_BLOCK_SIZE) == 0) {}
+    ~EntropyMapConsumer() override { encryption_entropy_map_free(&m_map); }
+
+    void update(const uint8_t* data, size_t len) override {
+        if (m_ok) m_ok = encryption_entropy_map_update(&m_map, data, len) == 0;
+    }
+
+    void finish(DigestRecord& record) override {
+        if (m_ok && encryption_entropy_map_finish(&m_map) == 0) {
+            record.entropy_map.assign(m_map.values, m_map.values + m_map.count);
+        }
+    }
+
+private:
+    encryption_entropy_map_t m_map;
+    bool m_ok;
+};
+
+// Keeps only the first few bytes; the type is decided at the end
+class MagicConsumer : public DigestConsumer {
+public:
+    static constexpr size_t HEAD_SIZE = COMPRESSION_SNIFF_SIZE;
+
+    MagicConsumer() : m_len(0) {}
+
+    void update(const uint8_t* data, size_t len) override {
+        const size_t take = std::min(len, HEAD_SIZE - m_len);
+        std::memcpy(m_head + m_len, data, take);
+        m_len += take;
+    }
+
+    void finish(DigestRecord& record) override {
+        record.magic = DigestEngine::sniff_magic(m_head, m_len);
+    }
+
+private:
+    uint8_t m_head[HEAD_SIZE];
+    size_t m_len;
+};
+
+template <typename Fn>
+void parallel_for(size_t count, size_t num_threads, Fn fn) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, count);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (size_t t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                fn(i);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+DigestEngine::DigestEngine(const Parameters& params) : m_params(params) {
+    m_params.buffer_size = std::max<size_t>(m_params.buffer_size, 4096);
+}
+
+void DigestEngine::add_consumer(ConsumerFactory factory) {
+    if (factory) {
+        m_factories.push_back(std::move(factory));
+    }
+}
+
+std::vector<std::unique_ptr<DigestConsumer>> DigestEngine::make_consumers() const {
+    std::vector<std::unique_ptr<DigestConsumer>> consumers;
+    if (m_params.digests & BLAKE3) consumers.push_back(std::make_unique<Blake3Consumer>());
+    if (m_params.digests & SHA256) consumers.push_back(std::make_unique<Sha256Consumer>());
+    if (m_params.digests & HISTOGRAM) consumers.push_back(std::make_unique<HistogramConsumer>());
+    if (m_params.digests & MAGIC) consumers.push_back(std::make_unique<MagicConsumer>());
+    if (m_params.digests & SSDEEP) consumers.push_back(std::make_unique<SsdeepConsumer>());
+    if (m_params.digests & TLSH) consumers.push_back(std::make_unique<TlshConsumer>());
+    if (m_params.digests & ENTROPY_MAP) consumers.push_back(std::make_unique<EntropyMapConsumer>());
+    for (const auto& factory : m_factories) {
+        if (auto consumer = factory()) consumers.push_back(std::move(consumer));
+    }
+    return consumers;
+}
+
+bool DigestEngine::digest_file(const std::string& path, DigestRecord& out) const {
+    std::vector<uint8_t> buffer(m_params.buffer_size);
+    return digest_file(path, out, buffer);
+}
+
+bool DigestEngine::digest_file(const std::string& path, DigestRecord& out,
+                               std::vector<uint8_t>& buffer) const {
+    out = DigestRecord();
+    file_handle_t fh = FileUtils::open_file(path, /*read_only*/ true);
+    if (!FileUtils::is_valid_handle(fh)) {
+        return false;
+    }
+
+    const uint64_t size = FileUtils::get_file_size(fh);
+    auto consumers = make_consumers();
+    for (auto& c : consumers) c->begin(size);
+
+    uint64_t offset = 0;
+    while (offset < size) {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(buffer.size(), size - offset));
+        if (!FileUtils::read_file_data(fh, buffer.data(), n, offset)) {
+            FileUtils::close_file(fh);
+            return false;
+        }
+        for (auto& c : consumers) c->update(buffer.data(), n);
+        offset += n;
+    }
+    FileUtils::close_file(fh);
+
+    out.size = offset;
+    for (auto& c : consumers) c->finish(out);
+    return true;
+}
+
+void DigestEngine::digest_data(const void* data, size_t size, DigestRecord& out) const {
+    out = DigestRecord();
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    auto consumers = make_consumers();
+    for (auto& c : consumers) c->begin(size);
+    for (size_t offset = 0; offset < size; offset += m_params.buffer_size) {
+        const size_t n = std::min(m_params.buffer_size, size - offset);
+        for (auto& c : consumers) c->update(bytes + offset, n);
+    }
+    out.size = size;
+    for (auto& c : consumers) c->finish(out);
+}
+
+size_t DigestEngine::digest_files(const std::string* paths, size_t count, DigestRecord* out,
+                                  bool* ok_out, size_t num_threads) const {
+    if (!paths || !out || count == 0) {
+        return 0;
+    }
+
+    std::atomic<size_t> success_count{0};
+    parallel_for(count, num_threads, [&](size_t i) {
+        // One buffer per worker thread, reused across its files
+        thread_local std::vector<uint8_t> buffer;
+        if (buffer.size() != m_params.buffer_size) buffer.assign(m_params.buffer_size, 0);
+        const bool ok = digest_file(paths[i], out[i], buffer);
+        if (ok_out) ok_out[i] = ok;
+        if (ok) success_count.fetch_add(1, std::memory_order_relaxed);
+    });
+    return success_count.load();
+}
+
+double DigestEngine::entropy_from_histogram(const std::array<uint64_t, 256>& histogram) {
+    uint64_t total = 0;
+    for (uint64_t c : histogram) total += c;
+    return encryption_entropy_from_histogram(histogram.data(), total) * 8.0;
+}
+
+std::string DigestEngine::sniff_magic(const uint8_t* data, size_t len) {
+    const char* type = compression_sniff(data, len, nullptr);
+    return type ? type : std::string();
+}
+
+std::string DigestEngine::to_hex(const std::vector<uint8_t>& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (uint8_t b : bytes) {
+        hex.push_back(digits[b >> 4]);
+        hex.push_back(digits[b & 0xF]);
+    }
+    return hex;
+}
@@ -0,0 +1,105 @@
+#ifndef LIBS_DIGEST_DIGEST_H
+#define LIBS_DIGEST_DIGEST_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Combined result of one pass over a file. Fields belonging to digests that
+// were not requested are left empty.
+struct DigestRecord {
+    uint64_t size;                      // Bytes consumed
+    std::vector<uint8_t> blake3;        // 32 bytes
+    std::vector<uint8_t> sha256;        // 32 bytes
+    std::string ssdeep;                 // Empty for empty input
+    std::string tlsh;                   // Empty if the input is too short or uniform
+    std::array<uint64_t, 256> histogram;
+    double entropy;                     // Shannon entropy, bits per byte (0-8)
+    std::string magic;                  // Sniffed content type ("png", "elf", ...), empty if unknown
+    std::vector<uint8_t> entropy_map;   // Entropy of each 4 KiB block, quantized to 0-255
+    std::map<std::string, std::string> extra; // Results of custom consumers, keyed by consumer name
+
+    DigestRecord() : size(0), histogram{}, entropy(0.0) {}
+};
+
+// A digest fed incrementally. One instance is created per file, receives
+// every buffer in order, and writes its result into the record at the end.
+class DigestConsumer {
+public:
+    virtual ~DigestConsumer() = default;
+
+    // Called once before the first buffer; size is the file length (0 if unknown)
+    virtual void begin(uint64_t size) { (void)size; }
+    virtual void update(const uint8_t* data, size_t len) = 0;
+    virtual void finish(DigestRecord& record) = 0;
+};
+
+// Reads each file once in fixed-size buffers and fans every buffer out to
+// the selected digests, so memory is bounded by the buffer and not by the
+// file. Safe to share between threads once configured.
+class DigestEngine {
+public:
+    enum Digest : uint32_t {
+        BLAKE3    = 1u << 0,
+        SHA256    = 1u << 1,
+        HISTOGRAM = 1u << 2,  // Byte histogram and entropy
+        MAGIC     = 1u << 3,
+        SSDEEP    = 1u << 4,
+        TLSH      = 1u << 5,
+        ENTROPY_MAP = 1u << 6,
+        ALL       = BLAKE3 | SHA256 | HISTOGRAM | MAGIC | SSDEEP | TLSH | ENTROPY_MAP
+    };
+
+    using ConsumerFactory = std::function<std::unique_ptr<DigestConsumer>()>;
+
+    struct Parameters {
+        uint32_t digests;       // Digest bit mask
+        size_t buffer_size;     // Read buffer per worker (bytes)
+
+        Parameters() : digests(ALL), buffer_size(256 * 1024) {}
+    };
+
+private:
+    Parameters m_params;
+    std::vector<ConsumerFactory> m_factories;
+
+public:
+    explicit DigestEngine(const Parameters& params = Parameters());
+    ~DigestEngine() = default;
+
+    const Parameters& get_parameters() const { return m_params; }
+
+    // Register an additional consumer; the factory is called once per file
+    void add_consumer(ConsumerFactory factory);
+
+    // Digest one file in a single sequential read
+    bool digest_file(const std::string& path, DigestRecord& out) const;
+
+    // Digest an in-memory buffer (fed to the consumers in buffer_size pieces)
+    void digest_data(const void* data, size_t size, DigestRecord& out) const;
+
+    // Digest many files across worker threads; ok_out (optional) receives
+    // per-file success. num_threads = 0 uses all hardware threads.
+    size_t digest_files(const std::string* paths, size_t count, DigestRecord* out,
+                        bool* ok_out = nullptr, size_t num_threads = 0) const;
+
+    // Shannon entropy (bits per byte) of a byte histogram
+    static double entropy_from_histogram(const std::array<uint64_t, 256>& histogram);
+
+    // Content type from the leading bytes of a file; empty if unrecognized
+    static std::string sniff_magic(const uint8_t* data, size_t len);
+
+    // Lowercase hex encoding for digests
+    static std::string to_hex(const std::vector<uint8_t>& bytes);
+
+private:
+    std::vector<std::unique_ptr<DigestConsumer>> make_consumers() const;
+    bool digest_file(const std::string& path, DigestRecord& out, std::vector<uint8_t>& buffer) const;
+};
+
+#endif // LIBS_DIGEST_DIGEST_H
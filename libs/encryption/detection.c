@@ -1,4 +1,6 @@
 #include "detection.h"
+#include "entropy.h"
+#include "repeats.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -23,23 +25,21 @@ static int detect_cipher_mode(const uint8_t* data, size_t size, char** mode, dou
     *mode = NULL;
     *confidence = 0.0;
     
-    // Check for ECB mode patterns (repeated blocks)
-    if (size >= 32) {
-        int repeated_blocks = 0;
-        for (size_t i = 0; i <= size - 32; i += 16) {
-            for (size_t j = i + 16; j <= size - 16; j += 16) {
-                if (memcmp(data + i, data + j, 16) == 0) {
-                    repeated_blocks++;
-                }
-            }
-        }
-        
-        // If we find many repeated blocks, it's likely ECB
-        if (repeated_blocks > (int)(size / 64)) {
-            *mode = strdup_safe("ECB");
-            *confidence = 0.8;
-            return 0;
-        }
+    // Check for ECB mode patterns (repeated blocks), one hashed pass
+    encryption_repeat_options_t options;
+    encryption_repeat_options_init(&options);
+    options.max_positions = 0;
+    encryption_repeat_report_t report;
+    if (encryption_repeat_analyze(data, size, &options, &report) != 0) {
+        return -1;
+    }
+    int ecb = encryption_repeats_indicate_ecb(&report);
+    encryption_repeat_report_free(&report);
+
+    if (ecb) {
+        *mode = strdup_safe("ECB");
+        *confidence = 0.8;
+        return 0;
     }
     
     // Default to CBC or unknown
@@ -48,6 +48,15 @@ static int detect_cipher_mode(const uint8_t* data, size_t size, char** mode, dou
     return 0;
 }
 
+int encryption_repeats_indicate_ecb(const encryption_repeat_report_t* report) {
+    // Either 64-bit or 128-bit cipher blocks; a 128-bit repeat is also
+    // a pair of 64-bit repeats, so either ratio alone decides
+    const encryption_block_repeats_t* b8 = encryption_repeat_report_get(report, 8);
+    const encryption_block_repeats_t* b16 = encryption_repeat_report_get(report, 16);
+    return (b16 && b16->duplicate_ratio >= ENCRYPTION_ECB_DUPLICATE_RATIO) ||
+           (b8 && b8->duplicate_ratio >= ENCRYPTION_ECB_DUPLICATE_RATIO);
+}
+
 int encryption_detect_cipher_internal(const uint8_t* data, size_t size, char** cipher_name, double* confidence) {
     if (!data || size == 0 || !cipher_name || !confidence) {
         return -1;
@@ -59,19 +68,7 @@ int encryption_detect_cipher_internal(const uint8_t* data, size_t size, char** c
     // Analyze data for cipher characteristics
     if (size >= 16) {
         // Check entropy - high entropy suggests strong encryption
-        double entropy = 0.0;
-        int freq[256] = {0};
-        for (size_t i = 0; i < size; i++) {
-            freq[data[i]]++;
-        }
-        
-        for (int i = 0; i < 256; i++) {
-            if (freq[i] > 0) {
-                double p = (double)freq[i] / size;
-                entropy -= p * log2(p);
-            }
-        }
-        entropy /= 8.0; // Normalize to 0-1
+        double entropy = encryption_calculate_entropy_internal(data, size);
         
         // High entropy suggests AES or similar strong cipher
         if (entropy > 0.9) {
@@ -181,20 +178,8 @@ int encryption_detect_algorithm_internal(const uint8_t* data, size_t size, char*
     }
     
     // Analyze entropy for encryption detection
-    double entropy = 0.0;
-    int freq[256] = {0};
-    for (size_t i = 0; i < size && i < 4096; i++) {
-        freq[data[i]]++;
-    }
-    
     size_t sample_size = size > 4096 ? 4096 : size;
-    for (int i = 0; i < 256; i++) {
-        if (freq[i] > 0) {
-            double p = (double)freq[i] / sample_size;
-            entropy -= p * log2(p);
-        }
-    }
-    entropy /= 8.0; // Normalize to 0-1
+    double entropy = encryption_calculate_entropy_internal(data, sample_size);
     
     if (entropy > 0.85) {
         *algorithm_name = strdup_safe("Symmetric Encryption");
@@ -2,6 +2,7 @@
 #define LIBS_ENCRYPTION_DETECTION_H
 
 #include "encryption.h"
+#include "repeats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,6 +14,9 @@ int encryption_detect_cipher_internal(const uint8_t* data, size_t size, char** c
 // Detect encryption algorithm from data
 int encryption_detect_algorithm_internal(const uint8_t* data, size_t size, char** algorithm_name, double* confidence);
 
+// Whether a repeated-block report of high-entropy data looks like ECB mode
+int encryption_repeats_indicate_ecb(const encryption_repeat_report_t* report);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,6 +2,7 @@
 #include "detection.h"
 #include "ciphers.h"
 #include "entropy.h"
+#include "repeats.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -71,6 +72,55 @@ void cipher_info_free(cipher_info_t* info) {
     }
 }
 
+// Deep analysis: one sequential read feeds the entropy histogram and the
+// repeated-block analyzer, replacing the sample-based entropy
+static int analyze_whole_file(FILE* file, const encryption_options_t* options, encryption_result_t* result) {
+    const size_t buffer_size = 1024 * 1024;
+    uint8_t* buffer = (uint8_t*)malloc(buffer_size);
+    encryption_repeat_options_t repeat_options;
+    encryption_repeat_options_init(&repeat_options);
+    repeat_options.max_positions = 0;
+    encryption_repeat_analyzer_t* repeats = encryption_repeat_analyzer_create(&repeat_options);
+    if (!buffer || !repeats || fseek(file, 0, SEEK_SET) != 0) {
+        free(buffer);
+        encryption_repeat_analyzer_free(repeats);
+        return -1;
+    }
+
+    uint64_t counts[256] = {0};
+    uint64_t total = 0;
+    size_t n;
+    int ret = 0;
+    while ((n = fread(buffer, 1, buffer_size, file)) > 0) {
+        encryption_byte_histogram(buffer, n, counts);
+        if (encryption_repeat_analyzer_update(repeats, buffer, n) != 0) {
+            ret = -1;
+            break;
+        }
+        total += n;
+    }
+    free(buffer);
+
+    encryption_repeat_report_t report;
+    if (ret == 0 && !ferror(file) && encryption_repeat_analyzer_report(repeats, &report) == 0) {
+        result->entropy = encryption_entropy_from_histogram(counts, total);
+        if (result->entropy >= options->entropy_threshold) {
+            result->is_encrypted = 1;
+        }
+        const encryption_block_repeats_t* b16 = encryption_repeat_report_get(&report, 16);
+        result->duplicate_block_ratio = b16 ? b16->duplicate_ratio : 0.0;
+        if (result->entropy > 0.9 && encryption_repeats_indicate_ecb(&report)) {
+            free(result->mode_of_operation);
+            result->mode_of_operation = strdup_safe("ECB");
+        }
+        encryption_repeat_report_free(&report);
+    } else {
+        ret = -1;
+    }
+    encryption_repeat_analyzer_free(repeats);
+    return ret;
+}
+
 int encryption_analyze_file(const char* file_path,
                           const encryption_options_t* options,
                           encryption_result_t* result) {
@@ -112,9 +162,9 @@ int encryption_analyze_file(const char* file_path,
     
     // Read file data
     size_t bytes_read = fread(buffer, 1, sample_size, file);
-    fclose(file);
     
     if (bytes_read == 0) {
+        fclose(file);
         free(buffer);
         return -1;
     }
@@ -125,8 +175,13 @@ int encryption_analyze_file(const char* file_path,
     
     // Analyze data
     int ret = encryption_analyze_data(buffer, bytes_read, options, result);
-    
     free(buffer);
+
+    if (ret == 0 && options && options->deep_analysis) {
+        ret = analyze_whole_file(file, options, result);
+    }
+    
+    fclose(file);
     return ret;
 }
 
@@ -273,30 +328,6 @@ int encryption_analyze_directory(const char* directory_path,
     return 0;
 }
 
-double encryption_calculate_entropy(const uint8_t* data, size_t size) {
-    if (!data || size == 0) {
-        return 0.0;
-    }
-    
-    // Count byte frequencies
-    size_t frequency[256] = {0};
-    for (size_t i = 0; i < size; i++) {
-        frequency[data[i]]++;
-    }
-    
-    // Calculate entropy
-    double entropy = 0.0;
-    for (int i = 0; i < 256; i++) {
-        if (frequency[i] > 0) {
-            double p = (double)frequency[i] / size;
-            entropy -= p * log2(p);
-        }
-    }
-    
-    // Normalize to 0-1 range (max entropy for 8-bit data is 8)
-    return entropy / 8.0;
-}
-
 int encryption_is_compressed(const uint8_t* data, size_t size, int* is_compressed) {
     if (!data || size == 0 || !is_compressed) {
         return -1;
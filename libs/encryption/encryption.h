@@ -20,6 +20,7 @@ typedef struct {
     char* mode_of_operation;
     int is_password_protected;
     double confidence;
+    double duplicate_block_ratio;  // Repeated 16-byte blocks over the whole file (deep analysis only)
 } encryption_result_t;
 
 // Cipher information
@@ -39,7 +40,7 @@ typedef struct {
     int detect_ciphers;        // Detect specific ciphers
     int detect_compression;    // Detect compression
     int check_headers;         // Check file headers
-    int deep_analysis;         // Perform deep analysis
+    int deep_analysis;         // Perform deep analysis (whole-file entropy and repeated blocks)
     double entropy_threshold;  // Entropy threshold for detection (0.0-1.0)
     size_t sample_size;        // Sample size for analysis in bytes
     char* password;            // Password for testing decryption
@@ -1,31 +1,218 @@
 #include "entropy.h"
 #include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 
-double encryption_calculate_entropy_internal(const uint8_t* data, size_t size) {
-    if (!data || size == 0) {
-        return 0.0;
-    }
-    
-    // Count byte frequencies
-    size_t frequency[256] = {0};
-    for (size_t i = 0; i < size; i++) {
-        frequency[data[i]]++;
+// c * log2(c) for every count a default-size block can hold
+#define LOG_TABLE_SIZE (ENCRYPTION_ENTROPY_BLOCK_SIZE + 1)
+static double g_clog2c[LOG_TABLE_SIZE];
+static pthread_once_t g_log_table_once = PTHREAD_ONCE_INIT;
+
+static void init_log_table(void) {
+    g_clog2c[0] = 0.0;
+    for (size_t c = 1; c < LOG_TABLE_SIZE; c++) {
+        g_clog2c[c] = (double)c * log2((double)c);
     }
-    
-    // Calculate entropy
-    double entropy = 0.0;
+}
+
+static double clog2c(uint64_t c) {
+    return c < LOG_TABLE_SIZE ? g_clog2c[c] : (double)c * log2((double)c);
+}
+
+// Entropy in bits per byte: H = log2(n) - sum(c * log2(c)) / n
+static double entropy_bits(const uint64_t counts[256], uint64_t total) {
+    pthread_once(&g_log_table_once, init_log_table);
+    double sum = 0.0;
     for (int i = 0; i < 256; i++) {
-        if (frequency[i] > 0) {
-            double p = (double)frequency[i] / size;
-            entropy -= p * log2(p);
+        sum += clog2c(counts[i]);
+    }
+    double bits = log2((double)total) - sum / (double)total;
+    return bits > 0.0 ? bits : 0.0;
+}
+
+// Count bytes into four interleaved sub-histograms, one 8-byte load per
+// eight counts, so runs of equal bytes do not serialize on one counter
+#define COUNT_INTERLEAVED(sub, data, n)                                     \
+    do {                                                                    \
+        size_t i_ = 0;                                                      \
+        for (; i_ + 8 <= (n); i_ += 8) {                                    \
+            uint64_t w_;                                                    \
+            memcpy(&w_, (data) + i_, sizeof(w_));                           \
+            (sub)[0][w_ & 0xFF]++;                                          \
+            (sub)[1][(w_ >> 8) & 0xFF]++;                                   \
+            (sub)[2][(w_ >> 16) & 0xFF]++;                                  \
+            (sub)[3][(w_ >> 24) & 0xFF]++;                                  \
+            (sub)[0][(w_ >> 32) & 0xFF]++;                                  \
+            (sub)[1][(w_ >> 40) & 0xFF]++;                                  \
+            (sub)[2][(w_ >> 48) & 0xFF]++;                                  \
+            (sub)[3][w_ >> 56]++;                                           \
+        }                                                                   \
+        for (; i_ < (n); i_++) {                                            \
+            (sub)[0][(data)[i_]]++;                                         \
+        }                                                                   \
+    } while (0)
+
+void encryption_byte_histogram(const uint8_t* data, size_t size, uint64_t counts[256]) {
+    if (!data || !counts) {
+        return;
+    }
+
+    // 32-bit sub-counters, flushed before they can overflow
+    const size_t flush_every = (size_t)1 << 30;
+    uint32_t sub[4][256];
+    while (size > 0) {
+        size_t n = size < flush_every ? size : flush_every;
+        memset(sub, 0, sizeof(sub));
+        COUNT_INTERLEAVED(sub, data, n);
+        for (int b = 0; b < 256; b++) {
+            counts[b] += (uint64_t)sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
         }
+        data += n;
+        size -= n;
+    }
+}
+
+double encryption_entropy_from_histogram(const uint64_t counts[256], uint64_t total) {
+    if (!counts || total == 0) {
+        return 0.0;
     }
-    
     // Normalize to 0-1 range (max entropy for 8-bit data is 8)
-    return entropy / 8.0;
+    return entropy_bits(counts, total) / 8.0;
+}
+
+double encryption_calculate_entropy_internal(const uint8_t* data, size_t size) {
+    if (!data || size == 0) {
+        return 0.0;
+    }
+
+    uint64_t counts[256] = {0};
+    encryption_byte_histogram(data, size, counts);
+    return encryption_entropy_from_histogram(counts, size);
 }
 
 // Public interface function
 double encryption_calculate_entropy(const uint8_t* data, size_t size) {
     return encryption_calculate_entropy_internal(data, size);
-}
\ No newline at end of file
+}
+
+int encryption_entropy_map_init(encryption_entropy_map_t* map, uint32_t block_size) {
+    if (!map || block_size == 0 || block_size > ENCRYPTION_ENTROPY_MAX_BLOCK_SIZE) {
+        return -1;
+    }
+    memset(map->counts, 0, sizeof(map->counts));
+    map->block_size = block_size;
+    map->filled = 0;
+    map->values = NULL;
+    map->count = 0;
+    map->capacity = 0;
+    return 0;
+}
+
+// Close the current block: merge the sub-histograms, append its entropy
+static int map_emit_block(encryption_entropy_map_t* map) {
+    if (map->count >= map->capacity) {
+        size_t new_capacity = (map->capacity == 0) ? 256 : map->capacity * 2;
+        uint8_t* new_values = (uint8_t*)realloc(map->values, new_capacity);
+        if (!new_values) {
+            return -1;
+        }
+        map->values = new_values;
+        map->capacity = new_capacity;
+    }
+
+    uint64_t merged[256];
+    for (int b = 0; b < 256; b++) {
+        merged[b] = (uint64_t)map->counts[0][b] + map->counts[1][b] + map->counts[2][b] + map->counts[3][b];
+    }
+    double bits = entropy_bits(merged, map->filled);
+    long q = lround(bits * (255.0 / 8.0));
+    map->values[map->count++] = (uint8_t)(q > 255 ? 255 : q);
+
+    memset(map->counts, 0, sizeof(map->counts));
+    map->filled = 0;
+    return 0;
+}
+
+int encryption_entropy_map_update(encryption_entropy_map_t* map, const uint8_t* data, size_t size) {
+    if (!map || (!data && size > 0)) {
+        return -1;
+    }
+
+    while (size > 0) {
+        size_t room = map->block_size - map->filled;
+        size_t n = size < room ? size : room;
+        COUNT_INTERLEAVED(map->counts, data, n);
+        map->filled += (uint32_t)n;
+        data += n;
+        size -= n;
+
+        if (map->filled == map->block_size && map_emit_block(map) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int encryption_entropy_map_finish(encryption_entropy_map_t* map) {
+    if (!map) {
+        return -1;
+    }
+    return map->filled > 0 ? map_emit_block(map) : 0;
+}
+
+void encryption_entropy_map_free(encryption_entropy_map_t* map) {
+    if (map) {
+        free(map->values);
+        map->values = NULL;
+        map->count = 0;
+        map->capacity = 0;
+        map->filled = 0;
+    }
+}
+
+int encryption_entropy_map_compute(const uint8_t* data, size_t size, uint32_t block_size,
+                                   encryption_entropy_map_t* map) {
+    if (encryption_entropy_map_init(map, block_size) != 0) {
+        return -1;
+    }
+    if (encryption_entropy_map_update(map, data, size) != 0 || encryption_entropy_map_finish(map) != 0) {
+        encryption_entropy_map_free(map);
+        return -1;
+    }
+    return 0;
+}
+
+void encryption_entropy_sketch(const uint8_t* values, size_t count, uint8_t* sketch) {
+    if (!sketch) {
+        return;
+    }
+    memset(sketch, 0, ENCRYPTION_ENTROPY_SKETCH_SIZE);
+    if (!values || count == 0) {
+        return;
+    }
+
+    size_t high = 0;
+    for (size_t i = 0; i < count; i++) {
+        high += values[i] >= ENCRYPTION_HIGH_ENTROPY_LEVEL;
+    }
+    sketch[0] = (uint8_t)((high * 255 + count / 2) / count);
+
+    // Maximum over each span, so a small encrypted region is not averaged away
+    for (size_t cell = 0; cell < ENCRYPTION_ENTROPY_SKETCH_CELLS; cell++) {
+        size_t begin = cell * count / ENCRYPTION_ENTROPY_SKETCH_CELLS;
+        size_t end = (cell + 1) * count / ENCRYPTION_ENTROPY_SKETCH_CELLS;
+        if (end <= begin) {
+            end = begin + 1;
+        }
+        uint8_t peak = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (values[i] > peak) peak = values[i];
+        }
+        sketch[1 + cell] = peak;
+    }
+}
+
+double encryption_entropy_sketch_high_fraction(const uint8_t* sketch) {
+    return sketch ? sketch[0] / 255.0 : 0.0;
+}
@@ -8,11 +8,63 @@
 extern "C" {
 #endif
 
+// Default entropy map granularity
+#define ENCRYPTION_ENTROPY_BLOCK_SIZE 4096
+
+// Largest block size the map accepts (bounds the per-block counters)
+#define ENCRYPTION_ENTROPY_MAX_BLOCK_SIZE 32768
+
+// Sketch layout: byte 0 is the fraction of high-entropy blocks (0-255),
+// bytes 1..32 are the highest block entropy within each 1/32 of the file
+#define ENCRYPTION_ENTROPY_SKETCH_CELLS 32
+#define ENCRYPTION_ENTROPY_SKETCH_SIZE (1 + ENCRYPTION_ENTROPY_SKETCH_CELLS)
+
+// Quantized block entropy at or above which a block counts as high entropy
+// (0.9 of the 8 bits per byte maximum, as with the detection threshold)
+#define ENCRYPTION_HIGH_ENTROPY_LEVEL 230
+
+// Per-block entropy of a byte stream. Each value is the block's Shannon
+// entropy quantized to 0-255 (255 = 8 bits per byte); the last block may be
+// partial.
+typedef struct {
+    uint32_t block_size;
+    uint32_t filled;                // Bytes counted into the current block
+    uint16_t counts[4][256];        // Interleaved sub-histograms of the current block
+    uint8_t* values;
+    size_t count;
+    size_t capacity;
+} encryption_entropy_map_t;
+
 // Calculate entropy of data
 double encryption_calculate_entropy_internal(const uint8_t* data, size_t size);
 
+// Add the byte counts of data to counts. Four interleaved sub-histograms keep
+// consecutive equal bytes from serializing on one counter.
+void encryption_byte_histogram(const uint8_t* data, size_t size, uint64_t counts[256]);
+
+// Normalized entropy (0.0-1.0) of a byte histogram over total bytes
+double encryption_entropy_from_histogram(const uint64_t counts[256], uint64_t total);
+
+// Streaming entropy map
+// block_size: bytes per block (1..ENCRYPTION_ENTROPY_MAX_BLOCK_SIZE)
+// Returns 0 on success, non-zero on invalid arguments
+int encryption_entropy_map_init(encryption_entropy_map_t* map, uint32_t block_size);
+int encryption_entropy_map_update(encryption_entropy_map_t* map, const uint8_t* data, size_t size);
+int encryption_entropy_map_finish(encryption_entropy_map_t* map);   // Flushes a partial last block
+void encryption_entropy_map_free(encryption_entropy_map_t* map);
+
+// One-shot entropy map of a buffer (must be freed with encryption_entropy_map_free)
+int encryption_entropy_map_compute(const uint8_t* data, size_t size, uint32_t block_size,
+                                   encryption_entropy_map_t* map);
+
+// Summarize a map into an ENCRYPTION_ENTROPY_SKETCH_SIZE byte sketch
+void encryption_entropy_sketch(const uint8_t* values, size_t count, uint8_t* sketch);
+
+// Fraction of high-entropy blocks recorded in a sketch (0.0-1.0)
+double encryption_entropy_sketch_high_fraction(const uint8_t* sketch);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif // LIBS_ENCRYPTION_ENTROPY_H
\ No newline at end of file
+#endif // LIBS_ENCRYPTION_ENTROPY_H
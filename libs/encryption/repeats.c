@@ -0,0 +1,349 @@
+#include "repeats.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t g_block_sizes[ENCRYPTION_REPEAT_SIZE_COUNT] = {8, 16, 32};
+
+#define REPEAT_INITIAL_SLOTS 1024
+#define REPEAT_MAX_BLOCK 32
+
+// Distinct block content; count == 0 marks an empty slot
+typedef struct {
+    uint64_t key;
+    uint64_t first_offset;
+    uint64_t count;
+} repeat_slot_t;
+
+// Open-addressing table of the examined blocks of one size
+typedef struct {
+    uint32_t block_size;
+    uint32_t shift;             // Sampling level
+    repeat_slot_t* slots;
+    size_t capacity;            // Power of two, at most half full
+    uint32_t capacity_bits;
+    size_t used;
+    uint64_t total_blocks;
+    uint64_t examined;
+    encryption_repeat_position_t* positions;
+    uint64_t* position_keys;    // Key of each position, for resampling
+    size_t position_count;
+    uint64_t next_offset;       // Stream offset of the next block
+    uint8_t carry[REPEAT_MAX_BLOCK];
+    size_t carry_len;
+} repeat_table_t;
+
+struct encryption_repeat_analyzer {
+    encryption_repeat_options_t options;
+    uint64_t size;
+    repeat_table_t tables[ENCRYPTION_REPEAT_SIZE_COUNT];
+};
+
+// Bijective 64-bit finalizer (splitmix64)
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// 8-byte blocks are their own key; longer blocks are hashed to 64 bits
+static uint64_t block_key(const uint8_t* p, uint32_t block_size) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    if (block_size == 8) {
+        return w;
+    }
+    uint64_t h = mix64(w);
+    for (uint32_t i = 8; i < block_size; i += 8) {
+        memcpy(&w, p + i, sizeof(w));
+        h = mix64(h ^ (w + 0x9e3779b97f4a7c15ULL * i));
+    }
+    return h;
+}
+
+void encryption_repeat_options_init(encryption_repeat_options_t* options) {
+    if (options) {
+        options->max_positions = ENCRYPTION_REPEAT_DEFAULT_POSITIONS;
+        options->max_entries = ENCRYPTION_REPEAT_DEFAULT_ENTRIES;
+        options->sample_shift = 0;
+    }
+}
+
+static uint64_t sample_mask(uint32_t shift) {
+    return shift >= 64 ? ~0ULL : ((1ULL << shift) - 1);
+}
+
+// Place a slot in a table known to have room
+static void table_place(repeat_slot_t* slots, size_t capacity, uint32_t bits, const repeat_slot_t* slot) {
+    size_t i = (size_t)(mix64(slot->key) >> (64 - bits));
+    while (slots[i].count != 0) {
+        i = (i + 1) & (capacity - 1);
+    }
+    slots[i] = *slot;
+}
+
+static int table_rehash(repeat_table_t* t, size_t capacity, uint32_t bits) {
+    repeat_slot_t* slots = (repeat_slot_t*)calloc(capacity, sizeof(repeat_slot_t));
+    if (!slots) {
+        return -1;
+    }
+    const uint64_t mask = sample_mask(t->shift);
+    size_t used = 0;
+    for (size_t i = 0; i < t->capacity; i++) {
+        const repeat_slot_t* s = &t->slots[i];
+        if (s->count == 0) {
+            continue;
+        }
+        if (mix64(s->key) & mask) {
+            t->examined -= s->count;    // Dropped from the sample
+            continue;
+        }
+        table_place(slots, capacity, bits, s);
+        used++;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->capacity = capacity;
+    t->capacity_bits = bits;
+    t->used = used;
+    return 0;
+}
+
+// Halve the sample: drop every content outside the new mask
+static int table_resample(repeat_table_t* t) {
+    t->shift++;
+    const uint64_t mask = sample_mask(t->shift);
+    size_t kept = 0;
+    for (size_t i = 0; i < t->position_count; i++) {
+        if ((mix64(t->position_keys[i]) & mask) == 0) {
+            t->positions[kept] = t->positions[i];
+            t->position_keys[kept] = t->position_keys[i];
+            kept++;
+        }
+    }
+    t->position_count = kept;
+    return table_rehash(t, t->capacity, t->capacity_bits);
+}
+
+static int table_init(repeat_table_t* t, uint32_t block_size, const encryption_repeat_options_t* options) {
+    memset(t, 0, sizeof(*t));
+    t->block_size = block_size;
+    t->shift = options->sample_shift;
+    t->capacity = REPEAT_INITIAL_SLOTS;
+    t->capacity_bits = 10;
+    t->slots = (repeat_slot_t*)calloc(t->capacity, sizeof(repeat_slot_t));
+    if (options->max_positions > 0) {
+        t->positions = (encryption_repeat_position_t*)malloc(options->max_positions * sizeof(encryption_repeat_position_t));
+        t->position_keys = (uint64_t*)malloc(options->max_positions * sizeof(uint64_t));
+    }
+    if (!t->slots || (options->max_positions > 0 && (!t->positions || !t->position_keys))) {
+        return -1;
+    }
+    return 0;
+}
+
+static void table_free(repeat_table_t* t) {
+    free(t->slots);
+    free(t->positions);
+    free(t->position_keys);
+    memset(t, 0, sizeof(*t));
+}
+
+static int table_add(repeat_table_t* t, const encryption_repeat_options_t* options,
+                     const uint8_t* block, uint64_t offset) {
+    t->total_blocks++;
+    const uint64_t key = block_key(block, t->block_size);
+    const uint64_t h = mix64(key);
+    if (h & sample_mask(t->shift)) {
+        return 0;
+    }
+
+    size_t i = (size_t)(h >> (64 - t->capacity_bits));
+    while (t->slots[i].count != 0) {
+        repeat_slot_t* s = &t->slots[i];
+        if (s->key == key) {
+            s->count++;
+            t->examined++;
+            if (t->position_count < options->max_positions) {
+                t->positions[t->position_count].offset = offset;
+                t->positions[t->position_count].first_offset = s->first_offset;
+                t->position_keys[t->position_count] = key;
+                t->position_count++;
+            }
+            return 0;
+        }
+        i = (i + 1) & (t->capacity - 1);
+    }
+
+    // New content: make room first, which may push it out of the sample
+    if (options->max_entries > 0 && t->used >= options->max_entries) {
+        while (t->used >= options->max_entries) {
+            if (table_resample(t) != 0) {
+                return -1;
+            }
+        }
+        if (h & sample_mask(t->shift)) {
+            return 0;
+        }
+    }
+    if ((t->used + 1) * 2 > t->capacity && table_rehash(t, t->capacity * 2, t->capacity_bits + 1) != 0) {
+        return -1;
+    }
+
+    repeat_slot_t slot;
+    slot.key = key;
+    slot.first_offset = offset;
+    slot.count = 1;
+    table_place(t->slots, t->capacity, t->capacity_bits, &slot);
+    t->used++;
+    t->examined++;
+    return 0;
+}
+
+static int table_update(repeat_table_t* t, const encryption_repeat_options_t* options,
+                        const uint8_t* data, size_t size) {
+    const size_t bs = t->block_size;
+
+    // Complete a block split by the previous buffer
+    if (t->carry_len > 0) {
+        size_t take = bs - t->carry_len;
+        if (take > size) take = size;
+        memcpy(t->carry + t->carry_len, data, take);
+        t->carry_len += take;
+        data += take;
+        size -= take;
+        if (t->carry_len < bs) {
+            return 0;
+        }
+        if (table_add(t, options, t->carry, t->next_offset) != 0) {
+            return -1;
+        }
+        t->next_offset += bs;
+        t->carry_len = 0;
+    }
+
+    for (; size >= bs; data += bs, size -= bs) {
+        if (table_add(t, options, data, t->next_offset) != 0) {
+            return -1;
+        }
+        t->next_offset += bs;
+    }
+
+    memcpy(t->carry, data, size);
+    t->carry_len = size;
+    return 0;
+}
+
+encryption_repeat_analyzer_t* encryption_repeat_analyzer_create(const encryption_repeat_options_t* options) {
+    encryption_repeat_analyzer_t* a = (encryption_repeat_analyzer_t*)calloc(1, sizeof(encryption_repeat_analyzer_t));
+    if (!a) {
+        return NULL;
+    }
+    if (options) {
+        a->options = *options;
+    } else {
+        encryption_repeat_options_init(&a->options);
+    }
+    for (int k = 0; k < ENCRYPTION_REPEAT_SIZE_COUNT; k++) {
+        if (table_init(&a->tables[k], g_block_sizes[k], &a->options) != 0) {
+            encryption_repeat_analyzer_free(a);
+            return NULL;
+        }
+    }
+    return a;
+}
+
+int encryption_repeat_analyzer_update(encryption_repeat_analyzer_t* analyzer, const uint8_t* data, size_t size) {
+    if (!analyzer || (!data && size > 0)) {
+        return -1;
+    }
+    for (int k = 0; k < ENCRYPTION_REPEAT_SIZE_COUNT; k++) {
+        if (table_update(&analyzer->tables[k], &analyzer->options, data, size) != 0) {
+            return -1;
+        }
+    }
+    analyzer->size += size;
+    return 0;
+}
+
+int encryption_repeat_analyzer_report(const encryption_repeat_analyzer_t* analyzer,
+                                      encryption_repeat_report_t* report) {
+    if (!analyzer || !report) {
+        return -1;
+    }
+    memset(report, 0, sizeof(*report));
+    report->size = analyzer->size;
+
+    for (int k = 0; k < ENCRYPTION_REPEAT_SIZE_COUNT; k++) {
+        const repeat_table_t* t = &analyzer->tables[k];
+        encryption_block_repeats_t* r = &report->sizes[k];
+        r->block_size = t->block_size;
+        r->sample_shift = t->shift;
+        r->total_blocks = t->total_blocks;
+        r->examined_blocks = t->examined;
+        r->distinct_blocks = t->used;
+        r->repeated_blocks = t->examined - t->used;
+        r->duplicate_ratio = t->examined > 0 ? (double)r->repeated_blocks / (double)t->examined : 0.0;
+        if (t->position_count > 0) {
+            r->positions = (encryption_repeat_position_t*)malloc(t->position_count * sizeof(encryption_repeat_position_t));
+            if (!r->positions) {
+                encryption_repeat_report_free(report);
+                return -1;
+            }
+            memcpy(r->positions, t->positions, t->position_count * sizeof(encryption_repeat_position_t));
+            r->position_count = t->position_count;
+        }
+    }
+    return 0;
+}
+
+void encryption_repeat_analyzer_free(encryption_repeat_analyzer_t* analyzer) {
+    if (analyzer) {
+        for (int k = 0; k < ENCRYPTION_REPEAT_SIZE_COUNT; k++) {
+            table_free(&analyzer->tables[k]);
+        }
+        free(analyzer);
+    }
+}
+
+int encryption_repeat_analyze(const uint8_t* data, size_t size,
+                              const encryption_repeat_options_t* options,
+                              encryption_repeat_report_t* report) {
+    if (!report) {
+        return -1;
+    }
+    encryption_repeat_analyzer_t* a = encryption_repeat_analyzer_create(options);
+    if (!a) {
+        return -1;
+    }
+    int ret = encryption_repeat_analyzer_update(a, data, size);
+    if (ret == 0) {
+        ret = encryption_repeat_analyzer_report(a, report);
+    }
+    encryption_repeat_analyzer_free(a);
+    return ret;
+}
+
+void encryption_repeat_report_free(encryption_repeat_report_t* report) {
+    if (report) {
+        for (int k = 0; k < ENCRYPTION_REPEAT_SIZE_COUNT; k++) {
+            free(report->sizes[k].positions);
+        }
+        memset(report, 0, sizeof(*report));
+    }
+}
+
+const encryption_block_repeats_t* encryption_repeat_report_get(const encryption_repeat_report_t* report,
+                                                               uint32_t block_size) {
+    if (!report) {
+        return NULL;
+    }
+    for (int k = 0; k < ENCRYPTION_REPEAT_SIZE_COUNT; k++) {
+        if (report->sizes[k].block_size == block_size) {
+            return &report->sizes[k];
+        }
+    }
+    return NULL;
+}
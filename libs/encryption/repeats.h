@@ -0,0 +1,92 @@
+#ifndef LIBS_ENCRYPTION_REPEATS_H
+#define LIBS_ENCRYPTION_REPEATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Block sizes analyzed in every pass: 64-bit (DES, Blowfish), 128-bit (AES)
+// and 256-bit blocks
+#define ENCRYPTION_REPEAT_SIZE_COUNT 3
+#define ENCRYPTION_REPEAT_DEFAULT_POSITIONS 64
+#define ENCRYPTION_REPEAT_DEFAULT_ENTRIES (1u << 18)
+
+// A repeated 16-byte block ratio at or above this in high-entropy data is
+// read as ECB; random data repeats a 128-bit block with negligible probability
+#define ENCRYPTION_ECB_DUPLICATE_RATIO 0.01
+
+// Repeated-block analysis options
+typedef struct {
+    size_t max_positions;   // Repeated-block positions kept per block size
+    size_t max_entries;     // Distinct blocks tracked per block size before the
+                            // sample is halved (0 = unlimited)
+    uint32_t sample_shift;  // Examine only blocks whose content hash has the low
+                            // sample_shift bits clear (0 = every block)
+} encryption_repeat_options_t;
+
+// A block equal to an earlier examined block
+typedef struct {
+    uint64_t offset;
+    uint64_t first_offset;  // Earliest examined block with the same content
+} encryption_repeat_position_t;
+
+// Statistics for one block size. Blocks are aligned to the start of the
+// stream. Sampling is by content, so both copies of a repeated block are
+// either examined or skipped and the ratio stays an unbiased estimate.
+typedef struct {
+    uint32_t block_size;
+    uint32_t sample_shift;          // Final sampling level (1 in 2^shift contents)
+    uint64_t total_blocks;          // Complete blocks in the stream
+    uint64_t examined_blocks;       // Blocks in the sample
+    uint64_t distinct_blocks;       // Distinct contents among them
+    uint64_t repeated_blocks;       // examined_blocks - distinct_blocks
+    double duplicate_ratio;         // repeated_blocks / examined_blocks
+    encryption_repeat_position_t* positions;   // In stream order
+    size_t position_count;
+} encryption_block_repeats_t;
+
+typedef struct {
+    uint64_t size;                  // Bytes consumed
+    encryption_block_repeats_t sizes[ENCRYPTION_REPEAT_SIZE_COUNT];    // 8, 16, 32 bytes
+} encryption_repeat_report_t;
+
+// Streaming analyzer; buffers may split blocks anywhere
+typedef struct encryption_repeat_analyzer encryption_repeat_analyzer_t;
+
+// Initialize options with default values
+void encryption_repeat_options_init(encryption_repeat_options_t* options);
+
+// Create an analyzer (options may be NULL for defaults); NULL on allocation failure
+encryption_repeat_analyzer_t* encryption_repeat_analyzer_create(const encryption_repeat_options_t* options);
+
+// Feed the next buffer
+// Returns 0 on success, non-zero on allocation failure
+int encryption_repeat_analyzer_update(encryption_repeat_analyzer_t* analyzer, const uint8_t* data, size_t size);
+
+// Produce the report for everything fed so far (must be freed with
+// encryption_repeat_report_free); the analyzer can keep being fed
+// Returns 0 on success, non-zero on error
+int encryption_repeat_analyzer_report(const encryption_repeat_analyzer_t* analyzer,
+                                      encryption_repeat_report_t* report);
+
+void encryption_repeat_analyzer_free(encryption_repeat_analyzer_t* analyzer);
+
+// One-shot analysis of a buffer
+int encryption_repeat_analyze(const uint8_t* data, size_t size,
+                              const encryption_repeat_options_t* options,
+                              encryption_repeat_report_t* report);
+
+void encryption_repeat_report_free(encryption_repeat_report_t* report);
+
+// Statistics for one block size, or NULL if it is not analyzed
+const encryption_block_repeats_t* encryption_repeat_report_get(const encryption_repeat_report_t* report,
+                                                               uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_ENCRYPTION_REPEATS_H
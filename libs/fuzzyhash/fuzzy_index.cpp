@@ -0,0 +1,475 @@
+#include "fuzzy_index.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+const uint32_t FHI_FILE_MAGIC = 0x31494846; // "FHI1"
+const uint32_t FHI_FILE_VERSION = 1;
+const size_t GRAM_LENGTH = 7;
+
+// Base64 alphabet position of each signature character
+constexpr std::array<uint8_t, 256> make_b64_values() {
+    std::array<uint8_t, 256> values{};
+    const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (uint8_t i = 0; i < 64; ++i) {
+        values[static_cast<uint8_t>(alphabet[i])] = i;
+    }
+    return values;
+}
+constexpr std::array<uint8_t, 256> B64_VALUES = make_b64_values();
+
+// L1 distance between two bytes of TLSH bucket codes (four 2-bit codes each)
+constexpr std::array<uint8_t, 256 * 256> make_l1_table() {
+    std::array<uint8_t, 256 * 256> table{};
+    for (int x = 0; x < 256; ++x) {
+        for (int y = 0; y < 256; ++y) {
+            int d = 0;
+            for (int j = 0; j < 4; ++j) {
+                const int a = (x >> (2 * j)) & 3, b = (y >> (2 * j)) & 3;
+                d += a > b ? a - b : b - a;
+            }
+            table[x * 256 + y] = static_cast<uint8_t>(d);
+        }
+    }
+    return table;
+}
+const std::array<uint8_t, 256 * 256> L1_TABLE = make_l1_table();
+
+uint32_t code_l1(const tlsh_digest_t& a, const tlsh_digest_t& b) {
+    uint32_t d = 0;
+    for (size_t i = 0; i < sizeof(a.code); ++i) {
+        d += L1_TABLE[a.code[i] * 256 + b.code[i]];
+    }
+    return d;
+}
+
+// Gram key: 42 bits for seven base64 characters, 22 bits for the blocksize
+uint64_t gram_key(uint32_t blocksize, const char* gram) {
+    uint64_t key = (static_cast<uint64_t>(blocksize * 2654435761u) >> 10) << 42;
+    uint64_t packed = 0;
+    for (size_t i = 0; i < GRAM_LENGTH; ++i) {
+        packed = (packed << 6) | B64_VALUES[static_cast<uint8_t>(gram[i])];
+    }
+    return key | packed;
+}
+
+void append_grams(uint32_t blocksize, const char* sig, size_t len, std::vector<uint64_t>& keys) {
+    for (size_t i = 0; i + GRAM_LENGTH <= len; ++i) {
+        keys.push_back(gram_key(blocksize, sig + i));
+    }
+}
+
+std::vector<uint64_t> digest_grams(const ssdeep_digest_t& d) {
+    std::vector<uint64_t> keys;
+    append_grams(d.blocksize, d.sig1, d.len1, keys);
+    append_grams(d.blocksize * 2, d.sig2, d.len2, keys);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+template <typename Fn>
+void parallel_for(size_t count, size_t num_threads, Fn fn) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, count);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (size_t t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                fn(i);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+template<typename T>
+void write_pod(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read_pod(std::ifstream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+void write_string(std::ofstream& out, const std::string& s) {
+    write_pod(out, static_cast<uint32_t>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+bool read_string(std::ifstream& in, std::string& s) {
+    uint32_t len = 0;
+    if (!read_pod(in, len) || len > (1u << 24)) {
+        return false;
+    }
+    s.assign(len, '\0');
+    in.read(s.data(), len);
+    return static_cast<bool>(in);
+}
+
+bool better_ssdeep(const FuzzyHashIndex::Match& a, const FuzzyHashIndex::Match& b) {
+    return a.score != b.score ? a.score > b.score : a.id < b.id;
+}
+
+bool better_tlsh(const FuzzyHashIndex::Match& a, const FuzzyHashIndex::Match& b) {
+    return a.score != b.score ? a.score < b.score : a.id < b.id;
+}
+
+} // namespace
+
+FuzzyHashIndex::FuzzyHashIndex() : m_root(-1), m_tree_dirty(false), m_comparisons(0) {
+}
+
+FuzzyHashIndex::ItemId FuzzyHashIndex::add(const std::string& key, const std::string& ssdeep,
+                                           const std::string& tlsh) {
+    Item item;
+    item.key = key;
+    item.has_ssdeep = !ssdeep.empty() && ssdeep_parse(ssdeep.c_str(), &item.ssdeep_digest) == 0;
+    item.has_tlsh = !tlsh.empty() && tlsh_parse(tlsh.c_str(), &item.tlsh_digest) == 0;
+    if (item.has_ssdeep) item.ssdeep = ssdeep;
+    if (item.has_tlsh) item.tlsh = tlsh;
+
+    const ItemId id = static_cast<ItemId>(m_items.size());
+    m_items.push_back(std::move(item));
+    if (m_items.back().has_ssdeep) {
+        index_grams(id);
+    }
+    if (m_items.back().has_tlsh) {
+        std::lock_guard<std::mutex> lock(m_tree_mutex);
+        m_tree_dirty = true;
+    }
+    return id;
+}
+
+void FuzzyHashIndex::index_grams(ItemId id) {
+    for (uint64_t key : digest_grams(m_items[id].ssdeep_digest)) {
+        m_grams[key].push_back(id);
+    }
+}
+
+std::vector<FuzzyHashIndex::Match> FuzzyHashIndex::ssdeep_candidates(const ssdeep_digest_t& digest,
+                                                                     int min_score, ItemId min_id,
+                                                                     uint64_t& comparisons) const {
+    // Postings are in id order, so each list is cut at min_id by binary search
+    std::vector<ItemId> candidates;
+    for (uint64_t key : digest_grams(digest)) {
+        auto it = m_grams.find(key);
+        if (it == m_grams.end()) continue;
+        auto first = std::lower_bound(it->second.begin(), it->second.end(), min_id);
+        candidates.insert(candidates.end(), first, it->second.end());
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<Match> matches;
+    for (ItemId id : candidates) {
+        const int score = ssdeep_digest_compare(&digest, &m_items[id].ssdeep_digest);
+        ++comparisons;
+        if (score >= min_score && score > 0) {
+            matches.push_back({id, score});
+        }
+    }
+    return matches;
+}
+
+std::vector<FuzzyHashIndex::Match> FuzzyHashIndex::query_ssdeep(const std::string& ssdeep, int min_score,
+                                                                size_t max_results) const {
+    ssdeep_digest_t digest;
+    if (ssdeep_parse(ssdeep.c_str(), &digest) != 0) {
+        return {};
+    }
+    uint64_t comparisons = 0;
+    auto matches = ssdeep_candidates(digest, min_score, 0, comparisons);
+    {
+        std::lock_guard<std::mutex> lock(m_tree_mutex);
+        m_comparisons += comparisons;
+    }
+    std::sort(matches.begin(), matches.end(), better_ssdeep);
+    if (matches.size() > max_results) {
+        matches.resize(max_results);
+    }
+    return matches;
+}
+
+void FuzzyHashIndex::ensure_tree() const {
+    std::lock_guard<std::mutex> lock(m_tree_mutex);
+    if (!m_tree_dirty) {
+        return;
+    }
+    std::vector<ItemId> ids;
+    for (size_t i = 0; i < m_items.size(); ++i) {
+        if (m_items[i].has_tlsh) ids.push_back(static_cast<ItemId>(i));
+    }
+    m_tree.clear();
+    m_tree.reserve(ids.size());
+    m_root = build_tree(ids, 0, ids.size());
+    m_tree_dirty = false;
+}
+
+int32_t FuzzyHashIndex::build_tree(std::vector<ItemId>& ids, size_t begin, size_t end) const {
+    if (begin >= end) {
+        return -1;
+    }
+    // Deterministic pseudo-random vantage point
+    const size_t pick = begin + (static_cast<size_t>(begin * 2654435761u + end) % (end - begin));
+    std::swap(ids[begin], ids[pick]);
+    const tlsh_digest_t& vantage = m_items[ids[begin]].tlsh_digest;
+
+    const int32_t node = static_cast<int32_t>(m_tree.size());
+    m_tree.push_back({ids[begin], 0, -1, -1});
+    if (end - begin == 1) {
+        return node;
+    }
+
+    // Median split of the rest by distance to the vantage point
+    std::vector<std::pair<uint32_t, ItemId>> dist;
+    dist.reserve(end - begin - 1);
+    for (size_t i = begin + 1; i < end; ++i) {
+        dist.emplace_back(code_l1(vantage, m_items[ids[i]].tlsh_digest), ids[i]);
+    }
+    const size_t mid = dist.size() / 2;
+    std::nth_element(dist.begin(), dist.begin() + mid, dist.end());
+    for (size_t i = 0; i < dist.size(); ++i) {
+        ids[begin + 1 + i] = dist[i].second;
+    }
+    m_tree[node].radius = dist[mid].first;
+
+    // Inner: [begin+1, begin+1+mid] (<= radius), outer: the rest (>= radius)
+    const size_t split = begin + 1 + mid + 1;
+    const int32_t inner = build_tree(ids, begin + 1, split);
+    const int32_t outer = build_tree(ids, split, end);
+    m_tree[node].inner = inner;
+    m_tree[node].outer = outer;
+    return node;
+}
+
+std::vector<FuzzyHashIndex::Match> FuzzyHashIndex::tlsh_search(const tlsh_digest_t& digest, int max_distance,
+                                                               size_t max_results, ItemId min_id,
+                                                               uint64_t& comparisons) const {
+    // Max-heap of the best results so far; once full, its worst distance
+    // tightens the search radius
+    auto worse = [](const Match& a, const Match& b) { return better_tlsh(a, b); };
+    std::priority_queue<Match, std::vector<Match>, decltype(worse)> best(worse);
+    int64_t tau = max_distance;
+
+    // Explicit stack; the tree is balanced, so depth stays logarithmic
+    std::vector<int32_t> stack;
+    if (m_root >= 0) stack.push_back(m_root);
+    while (!stack.empty()) {
+        const VpNode& node = m_tree[stack.back()];
+        stack.pop_back();
+
+        const Item& item = m_items[node.item];
+        const int64_t d = code_l1(digest, item.tlsh_digest);
+        if (d <= tau && node.item >= min_id) {
+            const int real = tlsh_digest_distance(&digest, &item.tlsh_digest, 1);
+            ++comparisons;
+            if (real <= tau) {
+                best.push({node.item, real});
+                if (best.size() > max_results) best.pop();
+                if (best.size() == max_results) tau = std::min<int64_t>(tau, best.top().score);
+            }
+        }
+
+        // Push the farther side first so the nearer one is explored first
+        const bool go_inner = node.inner >= 0 && d - tau <= node.radius;
+        const bool go_outer = node.outer >= 0 && d + tau >= node.radius;
+        if (d <= node.radius) {
+            if (go_outer) stack.push_back(node.outer);
+            if (go_inner) stack.push_back(node.inner);
+        } else {
+            if (go_inner) stack.push_back(node.inner);
+            if (go_outer) stack.push_back(node.outer);
+        }
+    }
+
+    std::vector<Match> matches;
+    matches.reserve(best.size());
+    while (!best.empty()) {
+        matches.push_back(best.top());
+        best.pop();
+    }
+    std::sort(matches.begin(), matches.end(), better_tlsh);
+    return matches;
+}
+
+std::vector<FuzzyHashIndex::Match> FuzzyHashIndex::query_tlsh(const std::string& tlsh, int max_distance,
+                                                              size_t max_results) const {
+    tlsh_digest_t digest;
+    if (max_results == 0 || tlsh_parse(tlsh.c_str(), &digest) != 0) {
+        return {};
+    }
+    ensure_tree();
+    uint64_t comparisons = 0;
+    auto matches = tlsh_search(digest, max_distance, max_results, 0, comparisons);
+    std::lock_guard<std::mutex> lock(m_tree_mutex);
+    m_comparisons += comparisons;
+    return matches;
+}
+
+std::vector<FuzzyHashIndex::Pair> FuzzyHashIndex::ssdeep_pairs(int min_score, size_t num_threads) const {
+    std::vector<std::vector<Pair>> per_item(m_items.size());
+    std::atomic<uint64_t> comparisons{0};
+    parallel_for(m_items.size(), num_threads, [&](size_t i) {
+        if (!m_items[i].has_ssdeep) return;
+        uint64_t local = 0;
+        for (const Match& m : ssdeep_candidates(m_items[i].ssdeep_digest, min_score,
+                                                static_cast<ItemId>(i + 1), local)) {
+            per_item[i].push_back({static_cast<ItemId>(i), m.id, m.score});
+        }
+        comparisons.fetch_add(local, std::memory_order_relaxed);
+    });
+
+    std::vector<Pair> pairs;
+    for (auto& list : per_item) pairs.insert(pairs.end(), list.begin(), list.end());
+    std::lock_guard<std::mutex> lock(m_tree_mutex);
+    m_comparisons += comparisons.load();
+    return pairs;
+}
+
+std::vector<FuzzyHashIndex::Pair> FuzzyHashIndex::tlsh_pairs(int max_distance, size_t num_threads) const {
+    ensure_tree();
+    std::vector<std::vector<Pair>> per_item(m_items.size());
+    std::atomic<uint64_t> comparisons{0};
+    parallel_for(m_items.size(), num_threads, [&](size_t i) {
+        if (!m_items[i].has_tlsh) return;
+        uint64_t local = 0;
+        auto matches = tlsh_search(m_items[i].tlsh_digest, max_distance, SIZE_MAX,
+                                   static_cast<ItemId>(i + 1), local);
+        std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.id < b.id; });
+        for (const Match& m : matches) {
+            per_item[i].push_back({static_cast<ItemId>(i), m.id, m.score});
+        }
+        comparisons.fetch_add(local, std::memory_order_relaxed);
+    });
+
+    std::vector<Pair> pairs;
+    for (auto& list : per_item) pairs.insert(pairs.end(), list.begin(), list.end());
+    std::lock_guard<std::mutex> lock(m_tree_mutex);
+    m_comparisons += comparisons.load();
+    return pairs;
+}
+
+std::vector<std::vector<FuzzyHashIndex::ItemId>> FuzzyHashIndex::cluster(const std::vector<Pair>& pairs,
+                                                                         size_t item_count) {
+    std::vector<ItemId> parent(item_count);
+    for (size_t i = 0; i < item_count; ++i) parent[i] = static_cast<ItemId>(i);
+    auto find = [&](ItemId x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    for (const Pair& p : pairs) {
+        if (p.a >= item_count || p.b >= item_count) continue;
+        const ItemId ra = find(p.a), rb = find(p.b);
+        if (ra != rb) parent[std::max(ra, rb)] = std::min(ra, rb);
+    }
+
+    std::unordered_map<ItemId, std::vector<ItemId>> groups;
+    for (size_t i = 0; i < item_count; ++i) {
+        groups[find(static_cast<ItemId>(i))].push_back(static_cast<ItemId>(i));
+    }
+    std::vector<std::vector<ItemId>> clusters;
+    for (auto& [root, members] : groups) {
+        if (members.size() >= 2) clusters.push_back(std::move(members));
+    }
+    std::sort(clusters.begin(), clusters.end(), [](const auto& a, const auto& b) {
+        return a.size() != b.size() ? a.size() > b.size() : a.front() < b.front();
+    });
+    return clusters;
+}
+
+FuzzyHashIndex::Stats FuzzyHashIndex::get_stats() const {
+    Stats stats;
+    stats.items = m_items.size();
+    for (const Item& item : m_items) {
+        stats.ssdeep_items += item.has_ssdeep;
+        stats.tlsh_items += item.has_tlsh;
+    }
+    stats.distinct_grams = m_grams.size();
+    for (const auto& [key, ids] : m_grams) stats.gram_postings += ids.size();
+    std::lock_guard<std::mutex> lock(m_tree_mutex);
+    stats.comparisons = m_comparisons;
+    return stats;
+}
+
+void FuzzyHashIndex::clear() {
+    m_items.clear();
+    m_grams.clear();
+    std::lock_guard<std::mutex> lock(m_tree_mutex);
+    m_tree.clear();
+    m_root = -1;
+    m_tree_dirty = false;
+    m_comparisons = 0;
+}
+
+bool FuzzyHashIndex::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    // Header, then per item: key, ssdeep, TLSH (strings)
+    write_pod(out, FHI_FILE_MAGIC);
+    write_pod(out, FHI_FILE_VERSION);
+    write_pod(out, static_cast<uint64_t>(m_items.size()));
+    for (const Item& item : m_items) {
+        write_string(out, item.key);
+        write_string(out, item.ssdeep);
+        write_string(out, item.tlsh);
+    }
+    return static_cast<bool>(out);
+}
+
+bool FuzzyHashIndex::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0;
+    uint64_t count = 0;
+    if (!read_pod(in, magic) || !read_pod(in, version) || !read_pod(in, count) ||
+        magic != FHI_FILE_MAGIC || version != FHI_FILE_VERSION || count >= UINT32_MAX) {
+        return false;
+    }
+
+    std::vector<std::tuple<std::string, std::string, std::string>> items;
+    items.reserve(static_cast<size_t>(std::min<uint64_t>(count, 1u << 20)));
+    for (uint64_t i = 0; i < count; ++i) {
+        std::string key, ssdeep, tlsh;
+        if (!read_string(in, key) || !read_string(in, ssdeep) || !read_string(in, tlsh)) {
+            return false;
+        }
+        items.emplace_back(std::move(key), std::move(ssdeep), std::move(tlsh));
+    }
+
+    clear();
+    for (const auto& [key, ssdeep, tlsh] : items) {
+        add(key, ssdeep, tlsh);
+    }
+    return true;
+}
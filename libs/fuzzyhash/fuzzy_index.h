@@ -0,0 +1,129 @@
+#ifndef LIBS_FUZZYHASH_FUZZY_INDEX_H
+#define LIBS_FUZZYHASH_FUZZY_INDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ssdeep.h"
+#include "tlsh.h"
+
+// Similarity search over ssdeep and TLSH digests without pairwise scans.
+//
+// ssdeep: every 7-character substring of each signature is posted under
+// (signature blocksize, gram). ssdeep only scores signatures at the same
+// blocksize that share a 7-gram, so the postings yield exactly the
+// candidates that can score above zero.
+//
+// TLSH: a vantage-point tree under the L1 distance of the 2-bit bucket codes.
+// That is a metric and a lower bound of the TLSH distance, so range and
+// top-k searches prune exactly and are then verified with the full distance.
+class FuzzyHashIndex {
+public:
+    using ItemId = uint32_t;
+
+    struct Match {
+        ItemId id;
+        int score;      // ssdeep: similarity 0-100; TLSH: distance
+    };
+
+    struct Pair {
+        ItemId a;
+        ItemId b;
+        int score;
+    };
+
+    struct Stats {
+        uint64_t items;
+        uint64_t ssdeep_items;
+        uint64_t tlsh_items;
+        uint64_t distinct_grams;
+        uint64_t gram_postings;
+        uint64_t comparisons;       // Full digest comparisons performed by queries
+
+        Stats() : items(0), ssdeep_items(0), tlsh_items(0), distinct_grams(0),
+                  gram_postings(0), comparisons(0) {}
+    };
+
+private:
+    struct Item {
+        std::string key;
+        std::string ssdeep;
+        std::string tlsh;
+        bool has_ssdeep;
+        bool has_tlsh;
+        ssdeep_digest_t ssdeep_digest;
+        tlsh_digest_t tlsh_digest;
+    };
+
+    struct VpNode {
+        ItemId item;
+        uint32_t radius;    // Inner subtree: L1 <= radius; outer: L1 >= radius
+        int32_t inner;
+        int32_t outer;
+    };
+
+    std::vector<Item> m_items;
+    std::unordered_map<uint64_t, std::vector<ItemId>> m_grams;
+
+    // VP tree over items with a TLSH digest, rebuilt lazily after additions
+    mutable std::mutex m_tree_mutex;
+    mutable std::vector<VpNode> m_tree;
+    mutable int32_t m_root;
+    mutable bool m_tree_dirty;
+    mutable uint64_t m_comparisons;
+
+public:
+    FuzzyHashIndex();
+    ~FuzzyHashIndex() = default;
+
+    // Add an item; either digest may be empty. Returns its id.
+    ItemId add(const std::string& key, const std::string& ssdeep, const std::string& tlsh);
+
+    // Up to max_results items scoring at least min_score against an ssdeep
+    // digest, best first
+    std::vector<Match> query_ssdeep(const std::string& ssdeep, int min_score = 1,
+                                    size_t max_results = 10) const;
+
+    // Up to max_results items within max_distance of a TLSH digest, nearest first
+    std::vector<Match> query_tlsh(const std::string& tlsh, int max_distance = 100,
+                                  size_t max_results = 10) const;
+
+    // All pairs scoring at least min_score / within max_distance, ordered by (a, b).
+    // num_threads = 0 uses all hardware threads.
+    std::vector<Pair> ssdeep_pairs(int min_score, size_t num_threads = 0) const;
+    std::vector<Pair> tlsh_pairs(int max_distance, size_t num_threads = 0) const;
+
+    // Connected components of the pairs graph (single linkage); groups of
+    // two or more, largest first
+    static std::vector<std::vector<ItemId>> cluster(const std::vector<Pair>& pairs, size_t item_count);
+
+    // Accessors
+    size_t size() const { return m_items.size(); }
+    const std::string& get_key(ItemId id) const { return m_items[id].key; }
+    const std::string& get_ssdeep(ItemId id) const { return m_items[id].ssdeep; }
+    const std::string& get_tlsh(ItemId id) const { return m_items[id].tlsh; }
+    Stats get_stats() const;
+
+    // Clear index
+    void clear();
+
+    // Persist items; gram postings and the tree are rebuilt on load
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+private:
+    void index_grams(ItemId id);
+    void ensure_tree() const;
+    int32_t build_tree(std::vector<ItemId>& ids, size_t begin, size_t end) const;
+
+    // Only items with id >= min_id are returned (pair enumeration passes i + 1)
+    std::vector<Match> ssdeep_candidates(const ssdeep_digest_t& digest, int min_score, ItemId min_id,
+                                         uint64_t& comparisons) const;
+    std::vector<Match> tlsh_search(const tlsh_digest_t& digest, int max_distance, size_t max_results,
+                                   ItemId min_id, uint64_t& comparisons) const;
+};
+
+#endif // LIBS_FUZZYHASH_FUZZY_INDEX_H
@@ -6,129 +6,227 @@
 
 // SSDeep constants
 #define SSDEEP_BLOCKSIZE_MIN 3
-#define SSDEEP_BLOCKSIZE_MAX 4096
 #define SSDEEP_SPAMSUM_LENGTH 64
-#define SSDEEP_CHUNK_SIZE 64
+#define SSDEEP_NUM_BLOCKHASHES 31
+#define SSDEEP_ROLLING_WINDOW 7
+#define SSDEEP_HASH_PRIME 0x01000193u
+#define SSDEEP_HASH_INIT 0x28021967u
+#define SSDEEP_MAX_RESULT (2 * SSDEEP_SPAMSUM_LENGTH + 20)
+#define SSDEEP_FILE_BUFFER (64 * 1024)
 
-// SSDeep hash structure
-typedef struct {
-    uint32_t blocksize;
-    char hash1[SSDEEP_SPAMSUM_LENGTH + 1];
-    char hash2[SSDEEP_SPAMSUM_LENGTH + 1];
-} ssdeep_hash_t;
+#define SSDEEP_BS(index) (((uint32_t)SSDEEP_BLOCKSIZE_MIN) << (index))
 
-// Rolling hash context
+// Rolling hash over the last 7 bytes; its value decides chunk boundaries
 typedef struct {
-    uint32_t window[7];
+    uint8_t window[SSDEEP_ROLLING_WINDOW];
     uint32_t h1, h2, h3;
     uint32_t n;
 } rolling_state_t;
 
+// Digest under construction for one candidate blocksize
+typedef struct {
+    uint32_t h;            // FNV hash of the current chunk
+    uint32_t halfh;        // Same, for the truncated second signature
+    char digest[SSDEEP_SPAMSUM_LENGTH];   // digest[dlen] is '\0' until the signature is full
+    char halfdigest;
+    uint32_t dlen;
+} blockhash_t;
+
+struct ssdeep_state {
+    uint64_t total_size;
+    uint32_t bhstart;      // Smallest blocksize still in the running
+    uint32_t bhend;        // One past the largest blocksize started
+    int need_lasth;
+    uint32_t lasth;        // Chunk hash beyond the largest blocksize
+    blockhash_t bh[SSDEEP_NUM_BLOCKHASHES];
+    rolling_state_t roll;
+};
+
 // Base64-like encoding for SSDeep
 static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-// Rolling hash functions
-static void roll_init(rolling_state_t* state) {
-    memset(state, 0, sizeof(rolling_state_t));
-}
+static void roll_hash(rolling_state_t* state, uint8_t c) {
+    state->h2 -= state->h1;
+    state->h2 += SSDEEP_ROLLING_WINDOW * (uint32_t)c;
 
-static uint32_t roll_hash(rolling_state_t* state, uint8_t c) {
-    state->h1 = (state->h1 << 4) | (state->h1 >> 28);
     state->h1 += c;
-    state->h2 += c;
-    state->h2 += state->h1;
-    state->h3 <<= 1;
-    state->h3 += c;
-    
-    state->window[state->n % 7] = c;
-    state->n++;
-    
+    state->h1 -= state->window[state->n];
+
+    state->window[state->n] = c;
+    if (++state->n == SSDEEP_ROLLING_WINDOW) {
+        state->n = 0;
+    }
+
+    state->h3 <<= 5;
+    state->h3 ^= c;
+}
+
+static uint32_t roll_sum(const rolling_state_t* state) {
     return state->h1 + state->h2 + state->h3;
 }
 
-// Sum hash function
-static uint32_t sum_hash(uint32_t blocksize, const uint8_t* data, size_t len) {
-    uint32_t hash = 0;
-    for (size_t i = 0; i < len; i++) {
-        hash = (hash * 256 + data[i]) % blocksize;
+static uint32_t sum_hash(uint8_t c, uint32_t h) {
+    return (h * SSDEEP_HASH_PRIME) ^ c;
+}
+
+// Start tracking the next larger blocksize, seeded with the current chunk
+static void try_fork_blockhash(ssdeep_state_t* state) {
+    blockhash_t* obh = &state->bh[state->bhend - 1];
+    if (state->bhend < SSDEEP_NUM_BLOCKHASHES) {
+        blockhash_t* nbh = obh + 1;
+        nbh->h = obh->h;
+        nbh->halfh = obh->halfh;
+        nbh->digest[0] = '\0';
+        nbh->halfdigest = '\0';
+        nbh->dlen = 0;
+        ++state->bhend;
+    } else if (!state->need_lasth) {
+        state->need_lasth = 1;
+        state->lasth = obh->h;
     }
-    return hash;
 }
 
-// Get base64 character
-static char get_b64_char(uint32_t value) {
-    return b64[value % 64];
+// Drop the smallest blocksize once it can no longer be the one reported
+static void try_reduce_blockhash(ssdeep_state_t* state) {
+    if (state->bhend - state->bhstart < 2) {
+        return;
+    }
+    // The input is still short enough for this blocksize to be chosen
+    if ((uint64_t)SSDEEP_BS(state->bhstart) * SSDEEP_SPAMSUM_LENGTH >= state->total_size) {
+        return;
+    }
+    // The next blocksize would not yield a long enough signature yet
+    if (state->bh[state->bhstart + 1].dlen < SSDEEP_SPAMSUM_LENGTH / 2) {
+        return;
+    }
+    ++state->bhstart;
 }
 
-// Process data for SSDeep hash
-static int ssdeep_process_data(const uint8_t* data, size_t len, ssdeep_hash_t* result) {
-    rolling_state_t roll_state;
-    roll_init(&roll_state);
-    
-    // Initialize result
-    memset(result, 0, sizeof(ssdeep_hash_t));
-    
-    // Find optimal block size
-    uint32_t blocksize = SSDEEP_BLOCKSIZE_MIN;
-    while (blocksize * SSDEEP_SPAMSUM_LENGTH < len) {
-        blocksize *= 2;
+static void engine_step(ssdeep_state_t* state, uint8_t c) {
+    roll_hash(&state->roll, c);
+    const uint32_t h = roll_sum(&state->roll);
+
+    for (uint32_t i = state->bhstart; i < state->bhend; ++i) {
+        state->bh[i].h = sum_hash(c, state->bh[i].h);
+        state->bh[i].halfh = sum_hash(c, state->bh[i].halfh);
     }
-    
-    // Cap blocksize to maximum
-    if (blocksize > SSDEEP_BLOCKSIZE_MAX) {
-        blocksize = SSDEEP_BLOCKSIZE_MAX;
+    if (state->need_lasth) {
+        state->lasth = sum_hash(c, state->lasth);
     }
-    
-    result->blocksize = blocksize;
-    
-    // Process data in chunks
-    uint32_t sum1 = 0, sum2 = 0;
-    size_t hash1_len = 0, hash2_len = 0;
-    
-    for (size_t i = 0; i < len && hash1_len < SSDEEP_SPAMSUM_LENGTH; i++) {
-        uint32_t rh = roll_hash(&roll_state, data[i]);
-        
-        // Check for block boundary in first hash
-        if ((rh % blocksize) == (blocksize - 1) && hash1_len < SSDEEP_SPAMSUM_LENGTH - 1) {
-            result->hash1[hash1_len++] = get_b64_char(sum1);
-            sum1 = 0;
+
+    // Blocksizes are powers of two times 3, so a trigger for blocksize i+1
+    // implies one for i; stop at the first blocksize that does not trigger
+    for (uint32_t i = state->bhstart; i < state->bhend; ++i) {
+        const uint32_t bs = SSDEEP_BS(i);
+        if (h % bs != bs - 1) {
+            break;
         }
-        
-        // Check for block boundary in second hash
-        if ((rh % (blocksize * 2)) == (blocksize * 2 - 1) && hash2_len < SSDEEP_SPAMSUM_LENGTH - 1) {
-            result->hash2[hash2_len++] = get_b64_char(sum2);
-            sum2 = 0;
+        blockhash_t* bh = &state->bh[i];
+        if (bh->dlen == 0) {
+            try_fork_blockhash(state);
+        }
+        bh->digest[bh->dlen] = b64[bh->h % 64];
+        bh->halfdigest = b64[bh->halfh % 64];
+        if (bh->dlen < SSDEEP_SPAMSUM_LENGTH - 1) {
+            // The last character keeps absorbing until the end of input
+            bh->digest[++bh->dlen] = '\0';
+            bh->h = SSDEEP_HASH_INIT;
+            if (bh->dlen < SSDEEP_SPAMSUM_LENGTH / 2) {
+                bh->halfh = SSDEEP_HASH_INIT;
+                bh->halfdigest = '\0';
+            }
+        } else {
+            try_reduce_blockhash(state);
         }
-        
-        // Update sums
-        sum1 = (sum1 * 256 + data[i]) % 0xFFFFFFFF;
-        sum2 = (sum2 * 256 + data[i]) % 0xFFFFFFFF;
     }
-    
-    // Add final characters if needed
-    if (hash1_len < SSDEEP_SPAMSUM_LENGTH && sum1 != 0) {
-        result->hash1[hash1_len++] = get_b64_char(sum1);
+}
+
+ssdeep_state_t* ssdeep_new(void) {
+    ssdeep_state_t* state = (ssdeep_state_t*)calloc(1, sizeof(ssdeep_state_t));
+    if (!state) {
+        return NULL;
     }
-    
-    if (hash2_len < SSDEEP_SPAMSUM_LENGTH && sum2 != 0) {
-        result->hash2[hash2_len++] = get_b64_char(sum2);
+    state->bhend = 1;
+    state->bh[0].h = SSDEEP_HASH_INIT;
+    state->bh[0].halfh = SSDEEP_HASH_INIT;
+    return state;
+}
+
+int ssdeep_update(ssdeep_state_t* state, const void* data, size_t len) {
+    if (!state || (!data && len > 0)) {
+        return -1;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    state->total_size += len;
+    for (size_t i = 0; i < len; i++) {
+        engine_step(state, p[i]);
     }
-    
-    // Null terminate
-    result->hash1[hash1_len] = '\0';
-    result->hash2[hash2_len] = '\0';
-    
     return 0;
 }
 
-// Format SSDeep hash as string
-static char* format_ssdeep_hash(const ssdeep_hash_t* hash) {
-    size_t len = snprintf(NULL, 0, "%u:%s:%s", hash->blocksize, hash->hash1, hash->hash2);
-    char* result = (char*)malloc(len + 1);
-    if (result) {
-        snprintf(result, len + 1, "%u:%s:%s", hash->blocksize, hash->hash1, hash->hash2);
+int ssdeep_digest(const ssdeep_state_t* state, char** hash) {
+    if (!state || !hash) {
+        return -1;
+    }
+
+    // Smallest blocksize whose 64-character budget covers the input...
+    uint32_t bi = state->bhstart;
+    while ((uint64_t)SSDEEP_BS(bi) * SSDEEP_SPAMSUM_LENGTH < state->total_size) {
+        if (++bi >= SSDEEP_NUM_BLOCKHASHES) {
+            return -1; // Input too large for any blocksize
+        }
+    }
+    if (bi >= state->bhend) {
+        bi = state->bhend - 1;
+    }
+    // ...halved while that leaves too short a signature
+    while (bi > state->bhstart && state->bh[bi].dlen < SSDEEP_SPAMSUM_LENGTH / 2) {
+        --bi;
+    }
+
+    const uint32_t h = roll_sum(&state->roll);
+    char* result = (char*)malloc(SSDEEP_MAX_RESULT);
+    if (!result) {
+        return -1;
+    }
+    int pos = snprintf(result, SSDEEP_MAX_RESULT, "%u:", SSDEEP_BS(bi));
+
+    // First signature: blocksize bi, full length, plus the pending chunk
+    const blockhash_t* bh = &state->bh[bi];
+    memcpy(result + pos, bh->digest, bh->dlen);
+    pos += (int)bh->dlen;
+    if (h != 0) {
+        result[pos++] = b64[bh->h % 64];
+    } else if (bh->digest[bh->dlen] != '\0') {
+        result[pos++] = bh->digest[bh->dlen];
+    }
+    result[pos++] = ':';
+
+    // Second signature: blocksize 2*bi, truncated to half length
+    if (bi < state->bhend - 1) {
+        bh = &state->bh[bi + 1];
+        uint32_t len = bh->dlen;
+        if (len > SSDEEP_SPAMSUM_LENGTH / 2 - 1) {
+            len = SSDEEP_SPAMSUM_LENGTH / 2 - 1;
+        }
+        memcpy(result + pos, bh->digest, len);
+        pos += (int)len;
+        if (h != 0) {
+            result[pos++] = b64[bh->halfh % 64];
+        } else if (bh->halfdigest != '\0') {
+            result[pos++] = bh->halfdigest;
+        }
+    } else if (h != 0) {
+        result[pos++] = (bi == 0) ? b64[state->bh[bi].h % 64] : b64[state->lasth % 64];
     }
-    return result;
+    result[pos] = '\0';
+
+    *hash = result;
+    return 0;
+}
+
+void ssdeep_free(ssdeep_state_t* state) {
+    free(state);
 }
 
 int ssdeep_hash_file(const char* path, char** hash) {
@@ -140,45 +238,33 @@ int ssdeep_hash_file(const char* path, char** hash) {
     if (!file) {
         return -1;
     }
-    
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    if (file_size <= 0) {
+
+    ssdeep_state_t* state = ssdeep_new();
+    uint8_t* buffer = (uint8_t*)malloc(SSDEEP_FILE_BUFFER);
+    if (!state || !buffer) {
+        ssdeep_free(state);
+        free(buffer);
         fclose(file);
         return -1;
     }
-    
-    // Allocate buffer
-    uint8_t* buffer = (uint8_t*)malloc(file_size);
-    if (!buffer) {
-        fclose(file);
-        return -1;
+
+    // Constant memory regardless of file size
+    size_t n;
+    while ((n = fread(buffer, 1, SSDEEP_FILE_BUFFER, file)) > 0) {
+        ssdeep_update(state, buffer, n);
     }
-    
-    // Read file
-    size_t bytes_read = fread(buffer, 1, file_size, file);
+    int ret = ferror(file) ? -1 : 0;
     fclose(file);
-    
-    if (bytes_read != (size_t)file_size) {
-        free(buffer);
-        return -1;
-    }
-    
-    // Compute hash
-    ssdeep_hash_t ssdeep_result;
-    int ret = ssdeep_process_data(buffer, bytes_read, &ssdeep_result);
     free(buffer);
-    
-    if (ret != 0) {
-        return -1;
+
+    if (ret == 0 && state->total_size == 0) {
+        ret = -1;
     }
-    
-    // Format result
-    *hash = format_ssdeep_hash(&ssdeep_result);
-    return (*hash) ? 0 : -1;
+    if (ret == 0) {
+        ret = ssdeep_digest(state, hash);
+    }
+    ssdeep_free(state);
+    return ret;
 }
 
 int ssdeep_hash_data(const void* data, size_t size, char** hash) {
@@ -186,40 +272,140 @@ int ssdeep_hash_data(const void* data, size_t size, char** hash) {
         return -1;
     }
     
-    // Compute hash
-    ssdeep_hash_t ssdeep_result;
-    int ret = ssdeep_process_data((const uint8_t*)data, size, &ssdeep_result);
-    
-    if (ret != 0) {
+    ssdeep_state_t* state = ssdeep_new();
+    if (!state) {
         return -1;
     }
-    
-    // Format result
-    *hash = format_ssdeep_hash(&ssdeep_result);
-    return (*hash) ? 0 : -1;
+    ssdeep_update(state, data, size);
+    int ret = ssdeep_digest(state, hash);
+    ssdeep_free(state);
+    return ret;
 }
 
-// Simplified comparison function
-int ssdeep_compare(const char* hash1, const char* hash2) {
-    if (!hash1 || !hash2) {
+// Copy a signature, keeping at most three of any run of identical characters
+static uint8_t eliminate_sequences(const char* src, size_t len, char* dst) {
+    size_t n = 0;
+    for (size_t i = 0; i < len && n < SSDEEP_SPAMSUM_LENGTH; i++) {
+        if (i >= 3 && src[i] == src[i - 1] && src[i] == src[i - 2] && src[i] == src[i - 3]) {
+            continue;
+        }
+        dst[n++] = src[i];
+    }
+    dst[n] = '\0';
+    return (uint8_t)n;
+}
+
+int ssdeep_parse(const char* hash, ssdeep_digest_t* out) {
+    if (!hash || !out) {
+        return -1;
+    }
+    char* end = NULL;
+    unsigned long bs = strtoul(hash, &end, 10);
+    if (end == hash || *end != ':' || bs < SSDEEP_BLOCKSIZE_MIN || bs > 0xFFFFFFFFul) {
+        return -1;
+    }
+    const char* s1 = end + 1;
+    const char* colon = strchr(s1, ':');
+    if (!colon) {
+        return -1;
+    }
+    const char* s2 = colon + 1;
+    size_t len1 = (size_t)(colon - s1);
+    size_t len2 = strcspn(s2, ",");   // ssdeep files may append ,"filename"
+    if (len1 > SSDEEP_SPAMSUM_LENGTH || len2 > SSDEEP_SPAMSUM_LENGTH) {
+        return -1;
+    }
+    out->blocksize = (uint32_t)bs;
+    out->len1 = eliminate_sequences(s1, len1, out->sig1);
+    out->len2 = eliminate_sequences(s2, len2, out->sig2);
+    return 0;
+}
+
+// Any substring of ROLLING_WINDOW characters in common
+static int has_common_substring(const char* a, size_t alen, const char* b, size_t blen) {
+    if (alen < SSDEEP_ROLLING_WINDOW || blen < SSDEEP_ROLLING_WINDOW) {
         return 0;
     }
-    
-    // For now, return a simple string comparison score
-    // In a full implementation, this would parse the hashes and compute
-    // a proper similarity score based on the SSDeep algorithm
-    if (strcmp(hash1, hash2) == 0) {
-        return 100;
+    for (size_t i = 0; i + SSDEEP_ROLLING_WINDOW <= alen; i++) {
+        for (size_t j = 0; j + SSDEEP_ROLLING_WINDOW <= blen; j++) {
+            if (a[i] == b[j] && memcmp(a + i, b + j, SSDEEP_ROLLING_WINDOW) == 0) {
+                return 1;
+            }
+        }
     }
-    
-    // Simple heuristic: if they start with the same blocksize, they might be similar
-    unsigned int blocksize1, blocksize2;
-    if (sscanf(hash1, "%u:", &blocksize1) == 1 && 
-        sscanf(hash2, "%u:", &blocksize2) == 1) {
-        if (blocksize1 == blocksize2) {
-            return 50; // Moderate similarity
+    return 0;
+}
+
+// Edit distance with insert/delete cost 1 and substitution cost 2
+static uint32_t edit_distance(const char* a, size_t alen, const char* b, size_t blen) {
+    uint32_t row[SSDEEP_SPAMSUM_LENGTH + 1];
+    for (size_t j = 0; j <= blen; j++) {
+        row[j] = (uint32_t)j;
+    }
+    for (size_t i = 1; i <= alen; i++) {
+        uint32_t diag = row[0];
+        row[0] = (uint32_t)i;
+        for (size_t j = 1; j <= blen; j++) {
+            const uint32_t up = row[j];
+            uint32_t best = diag + (a[i - 1] == b[j - 1] ? 0 : 2);
+            if (up + 1 < best) best = up + 1;
+            if (row[j - 1] + 1 < best) best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
         }
     }
-    
-    return 0; // No similarity
-}
\ No newline at end of file
+    return row[blen];
+}
+
+static int score_strings(const char* a, size_t alen, const char* b, size_t blen, uint32_t blocksize) {
+    if (!has_common_substring(a, alen, b, blen)) {
+        return 0;
+    }
+    uint32_t score = edit_distance(a, alen, b, blen);
+    score = (uint32_t)((score * SSDEEP_SPAMSUM_LENGTH) / (alen + blen));
+    score = (100 * score) / SSDEEP_SPAMSUM_LENGTH;
+    if (score >= 100) {
+        return 0;
+    }
+    score = 100 - score;
+
+    // Small blocksizes: short signatures cannot justify a high score
+    if (blocksize < (99 + SSDEEP_ROLLING_WINDOW) / SSDEEP_ROLLING_WINDOW * SSDEEP_BLOCKSIZE_MIN) {
+        const uint32_t cap = blocksize / SSDEEP_BLOCKSIZE_MIN * (uint32_t)(alen < blen ? alen : blen);
+        if (score > cap) {
+            score = cap;
+        }
+    }
+    return (int)score;
+}
+
+int ssdeep_digest_compare(const ssdeep_digest_t* a, const ssdeep_digest_t* b) {
+    if (!a || !b) {
+        return 0;
+    }
+    const uint32_t bs1 = a->blocksize, bs2 = b->blocksize;
+    if (bs1 != bs2 && bs1 != 2 * bs2 && bs2 != 2 * bs1) {
+        return 0;
+    }
+    if (bs1 == bs2 && a->len1 == b->len1 && a->len2 == b->len2 &&
+        memcmp(a->sig1, b->sig1, a->len1) == 0 && memcmp(a->sig2, b->sig2, a->len2) == 0) {
+        return 100;
+    }
+    if (bs1 == bs2) {
+        int s1 = score_strings(a->sig1, a->len1, b->sig1, b->len1, bs1);
+        int s2 = score_strings(a->sig2, a->len2, b->sig2, b->len2, 2 * bs1);
+        return s1 > s2 ? s1 : s2;
+    }
+    if (bs1 == 2 * bs2) {
+        return score_strings(a->sig1, a->len1, b->sig2, b->len2, bs1);
+    }
+    return score_strings(a->sig2, a->len2, b->sig1, b->len1, bs2);
+}
+
+int ssdeep_compare(const char* hash1, const char* hash2) {
+    ssdeep_digest_t a, b;
+    if (ssdeep_parse(hash1, &a) != 0 || ssdeep_parse(hash2, &b) != 0) {
+        return 0;
+    }
+    return ssdeep_digest_compare(&a, &b);
+}
@@ -8,7 +8,27 @@
 extern "C" {
 #endif
 
-// Compute SSDeep hash for a file
+// Incremental SSDeep (spamsum) context. Candidate blocksizes are tracked
+// side by side as data arrives, so the digest needs neither the input length
+// up front nor a second pass.
+typedef struct ssdeep_state ssdeep_state_t;
+
+// Allocate a fresh context (NULL on allocation failure)
+ssdeep_state_t* ssdeep_new(void);
+
+// Feed the next len bytes
+// Returns 0 on success, non-zero on error
+int ssdeep_update(ssdeep_state_t* state, const void* data, size_t len);
+
+// Produce the digest of everything fed so far; the context stays usable
+// hash: output hash string (must be freed by caller)
+// Returns 0 on success, non-zero on error
+int ssdeep_digest(const ssdeep_state_t* state, char** hash);
+
+// Release a context
+void ssdeep_free(ssdeep_state_t* state);
+
+// Compute SSDeep hash for a file (streamed in fixed-size buffers)
 // path: path to the file
 // hash: output hash string (must be freed by caller)
 // Returns 0 on success, non-zero on error
@@ -21,6 +41,24 @@ int ssdeep_hash_file(const char* path, char** hash);
 // Returns 0 on success, non-zero on error
 int ssdeep_hash_data(const void* data, size_t size, char** hash);
 
+// Parsed SSDeep hash with runs of more than three identical characters
+// collapsed, the form in which signatures are compared
+typedef struct {
+    uint32_t blocksize;
+    char sig1[65];          // Chunks at blocksize
+    char sig2[65];          // Chunks at 2 * blocksize
+    uint8_t len1;
+    uint8_t len2;
+} ssdeep_digest_t;
+
+// Parse a "blocksize:sig1:sig2" string
+// Returns 0 on success, non-zero if malformed
+int ssdeep_parse(const char* hash, ssdeep_digest_t* out);
+
+// Score two parsed hashes (0-100). Only signatures at the same blocksize are
+// compared, and they must share a 7-character substring to score above 0.
+int ssdeep_digest_compare(const ssdeep_digest_t* a, const ssdeep_digest_t* b);
+
 // Compare two SSDeep hashes
 // hash1: first hash
 // hash2: second hash
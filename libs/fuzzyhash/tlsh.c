@@ -3,132 +3,173 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
 
 // TLSH constants
-#define TLSH_CHECKSUM_LEN 1
-#define TLSH_BUCKET_COUNT 128
-#define TLSH_QRATIO_COUNT 16
-#define TLSH_CODE_SIZE 32
-
-// TLSH hash structure
-typedef struct {
-    uint8_t checksum[TLSH_CHECKSUM_LEN];
-    uint8_t l_value;
-    uint8_t q_ratios[TLSH_QRATIO_COUNT];
-    uint8_t buckets[TLSH_BUCKET_COUNT];
-} tlsh_hash_t;
-
-// TLSH implementation
-static uint8_t log_table[] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
-    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
-    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
-    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
-    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
-    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
-    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7
+#define TLSH_BUCKET_COUNT 256       // Pearson hash range
+#define TLSH_EFF_BUCKETS 128        // Buckets that enter the digest
+#define TLSH_CODE_SIZE 32           // 2 bits per effective bucket
+#define TLSH_WINDOW 5
+#define TLSH_MIN_DATA_LENGTH 50
+#define TLSH_HASH_LEN (2 + 2 * (3 + TLSH_CODE_SIZE)) // "T1" + checksum, L, Q, body
+#define TLSH_FILE_BUFFER (64 * 1024)
+
+struct tlsh_state {
+    uint32_t buckets[TLSH_BUCKET_COUNT];
+    uint8_t window[TLSH_WINDOW];    // Ring of the last bytes seen
+    uint8_t checksum;
+    uint64_t data_len;
 };
 
-// Process data for TLSH hash
-static int tlsh_process_data(const uint8_t* data, size_t len, tlsh_hash_t* result) {
-    // Initialize result
-    memset(result, 0, sizeof(tlsh_hash_t));
-    
-    if (len < 50 || len > 4294967295UL) {
+// Pearson permutation table
+static const uint8_t v_table[256] = {
+    1, 87, 49, 12, 176, 178, 102, 166, 121, 193, 6, 84, 249, 230, 44, 163,
+    14, 197, 213, 181, 161, 85, 218, 80, 64, 239, 24, 226, 236, 142, 38, 200,
+    110, 177, 104, 103, 141, 253, 255, 50, 77, 101, 81, 18, 45, 96, 31, 222,
+    25, 107, 190, 70, 86, 237, 240, 34, 72, 242, 20, 214, 244, 227, 149, 235,
+    97, 234, 57, 22, 60, 250, 82, 175, 208, 5, 127, 199, 111, 62, 135, 248,
+    174, 169, 211, 58, 66, 154, 106, 195, 245, 171, 17, 187, 182, 179, 0, 243,
+    132, 56, 148, 75, 128, 133, 158, 100, 130, 126, 91, 13, 153, 246, 216, 219,
+    119, 68, 223, 78, 83, 88, 201, 99, 122, 11, 92, 32, 136, 114, 52, 10,
+    138, 30, 48, 183, 156, 35, 61, 26, 143, 74, 251, 94, 129, 162, 63, 152,
+    170, 7, 115, 167, 241, 206, 3, 150, 55, 59, 151, 220, 90, 53, 23, 131,
+    125, 173, 15, 238, 79, 95, 89, 16, 105, 137, 225, 224, 217, 160, 37, 123,
+    118, 73, 2, 157, 46, 116, 9, 145, 134, 228, 207, 212, 202, 215, 69, 229,
+    27, 188, 67, 124, 168, 252, 42, 4, 29, 108, 21, 247, 19, 205, 39, 203,
+    233, 40, 186, 147, 198, 192, 155, 33, 164, 191, 98, 204, 165, 180, 117, 76,
+    140, 36, 210, 172, 41, 54, 159, 8, 185, 232, 113, 196, 231, 47, 146, 120,
+    51, 65, 28, 144, 254, 221, 93, 189, 194, 139, 112, 43, 71, 109, 184, 209
+};
+
+static uint8_t b_mapping(uint8_t salt, uint8_t i, uint8_t j, uint8_t k) {
+    uint8_t h = v_table[salt];
+    h = v_table[h ^ i];
+    h = v_table[h ^ j];
+    h = v_table[h ^ k];
+    return h;
+}
+
+// Logarithmic length code
+static uint8_t l_capturing(uint64_t len) {
+    int i;
+    if (len <= 656) {
+        i = (int)floor(log((double)len) / log(1.5));
+    } else if (len <= 3199) {
+        i = (int)floor(log((double)len) / log(1.3) - 8.72777);
+    } else {
+        i = (int)floor(log((double)len) / log(1.1) - 62.5472);
+    }
+    return (uint8_t)(i & 0xFF);
+}
+
+static uint8_t swap_byte(uint8_t b) {
+    return (uint8_t)((b << 4) | (b >> 4));
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+tlsh_state_t* tlsh_new(void) {
+    return (tlsh_state_t*)calloc(1, sizeof(tlsh_state_t));
+}
+
+int tlsh_update(tlsh_state_t* state, const void* data, size_t len) {
+    if (!state || (!data && len > 0)) {
+        return -1;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t n = state->data_len;
+    for (size_t idx = 0; idx < len; idx++, n++) {
+        const uint8_t c0 = p[idx];
+        state->window[n % TLSH_WINDOW] = c0;
+        if (n < TLSH_WINDOW - 1) {
+            continue;
+        }
+        // c1..c4 are the four bytes before c0
+        const uint8_t c1 = state->window[(n - 1) % TLSH_WINDOW];
+        const uint8_t c2 = state->window[(n - 2) % TLSH_WINDOW];
+        const uint8_t c3 = state->window[(n - 3) % TLSH_WINDOW];
+        const uint8_t c4 = state->window[(n - 4) % TLSH_WINDOW];
+
+        state->checksum = b_mapping(0, c0, c1, state->checksum);
+        state->buckets[b_mapping(2, c0, c1, c2)]++;
+        state->buckets[b_mapping(3, c0, c1, c3)]++;
+        state->buckets[b_mapping(5, c0, c2, c3)]++;
+        state->buckets[b_mapping(7, c0, c2, c4)]++;
+        state->buckets[b_mapping(11, c0, c1, c4)]++;
+        state->buckets[b_mapping(13, c0, c3, c4)]++;
+    }
+    state->data_len = n;
+    return 0;
+}
+
+int tlsh_digest(const tlsh_state_t* state, char** hash) {
+    if (!state || !hash) {
+        return -1;
+    }
+    if (state->data_len < TLSH_MIN_DATA_LENGTH || state->data_len > 4294967295ULL) {
         // TLSH requires at least 50 bytes and has a maximum size
         return -1;
     }
-    
-    // Simple bucket counting (simplified TLSH implementation)
-    uint32_t buckets[TLSH_BUCKET_COUNT] = {0};
-    
-    // Process data in 512-byte chunks
-    for (size_t i = 0; i < len; i++) {
-        uint8_t byte = data[i];
-        // Simple bucket assignment based on byte value
-        uint8_t bucket_idx = byte % TLSH_BUCKET_COUNT;
-        buckets[bucket_idx]++;
+
+    // Quartile boundaries of the effective bucket counts
+    uint32_t sorted[TLSH_EFF_BUCKETS];
+    memcpy(sorted, state->buckets, sizeof(sorted));
+    qsort(sorted, TLSH_EFF_BUCKETS, sizeof(uint32_t), compare_u32);
+    const uint32_t q1 = sorted[TLSH_EFF_BUCKETS / 4 - 1];
+    const uint32_t q2 = sorted[TLSH_EFF_BUCKETS / 2 - 1];
+    const uint32_t q3 = sorted[3 * TLSH_EFF_BUCKETS / 4 - 1];
+    if (q3 == 0) {
+        return -1;
     }
-    
-    // Convert counts to TLSH bucket values (simplified)
-    for (int i = 0; i < TLSH_BUCKET_COUNT; i++) {
-        if (buckets[i] > 255) {
-            result->buckets[i] = 255;
-        } else {
-            result->buckets[i] = (uint8_t)buckets[i];
-        }
+
+    // Too few distinct triplets for a meaningful distribution
+    int nonzero = 0;
+    for (int i = 0; i < TLSH_EFF_BUCKETS; i++) {
+        if (state->buckets[i] > 0) nonzero++;
     }
-    
-    // Set L value based on data length (simplified)
-    if (len <= 256) {
-        result->l_value = 0;
-    } else if (len <= 1024) {
-        result->l_value = 1;
-    } else if (len <= 4096) {
-        result->l_value = 2;
-    } else if (len <= 16384) {
-        result->l_value = 3;
-    } else if (len <= 65536) {
-        result->l_value = 4;
-    } else if (len <= 262144) {
-        result->l_value = 5;
-    } else if (len <= 1048576) {
-        result->l_value = 6;
-    } else {
-        result->l_value = 7;
+    if (nonzero <= 4 * TLSH_CODE_SIZE / 2) {
+        return -1;
     }
-    
-    // Set checksum (simplified)
-    result->checksum[0] = (uint8_t)(len % 256);
-    
-    // Set Q ratios (simplified)
-    for (int i = 0; i < TLSH_QRATIO_COUNT; i++) {
-        result->q_ratios[i] = (uint8_t)(i % 4);
+
+    uint8_t code[TLSH_CODE_SIZE];
+    for (int i = 0; i < TLSH_CODE_SIZE; i++) {
+        uint8_t h = 0;
+        for (int j = 0; j < 4; j++) {
+            const uint32_t k = state->buckets[4 * i + j];
+            if (q3 < k) {
+                h += (uint8_t)(3 << (j * 2));
+            } else if (q2 < k) {
+                h += (uint8_t)(2 << (j * 2));
+            } else if (q1 < k) {
+                h += (uint8_t)(1 << (j * 2));
+            }
+        }
+        code[i] = h;
     }
-    
-    return 0;
-}
 
-// Format TLSH hash as string (simplified hex representation)
-static char* format_tlsh_hash(const tlsh_hash_t* hash) {
-    // TLSH hashes are typically 70 hex characters + null terminator
-    char* result = (char*)malloc(71);
+    const uint8_t lvalue = l_capturing(state->data_len);
+    const uint8_t q1ratio = (uint8_t)((uint32_t)((float)(q1 * 100.0f) / (float)q3) % 16);
+    const uint8_t q2ratio = (uint8_t)((uint32_t)((float)(q2 * 100.0f) / (float)q3) % 16);
+
+    char* result = (char*)malloc(TLSH_HASH_LEN + 1);
     if (!result) {
-        return NULL;
-    }
-    
-    // Format simplified TLSH hash
-    int pos = 0;
-    
-    // Checksum
-    pos += sprintf(result + pos, "%02x", hash->checksum[0]);
-    
-    // L value
-    pos += sprintf(result + pos, "%01x", hash->l_value);
-    
-    // Q ratios (simplified)
-    for (int i = 0; i < 4 && pos < 60; i++) {
-        pos += sprintf(result + pos, "%01x", hash->q_ratios[i]);
+        return -1;
     }
-    
-    // Buckets (simplified - first 8 buckets)
-    for (int i = 0; i < 8 && pos < 70; i++) {
-        pos += sprintf(result + pos, "%02x", hash->buckets[i]);
+    int pos = snprintf(result, TLSH_HASH_LEN + 1, "T1%02X%02X%01X%01X",
+                       swap_byte(state->checksum), swap_byte(lvalue), q1ratio, q2ratio);
+    for (int i = TLSH_CODE_SIZE - 1; i >= 0; i--) {
+        pos += snprintf(result + pos, TLSH_HASH_LEN + 1 - pos, "%02X", code[i]);
     }
-    
-    // Null terminate
-    result[pos] = '\0';
-    
-    return result;
+
+    *hash = result;
+    return 0;
+}
+
+void tlsh_free(tlsh_state_t* state) {
+    free(state);
 }
 
 int tlsh_hash_file(const char* path, char** hash) {
@@ -140,45 +181,30 @@ int tlsh_hash_file(const char* path, char** hash) {
     if (!file) {
         return -1;
     }
-    
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    if (file_size <= 0) {
+
+    tlsh_state_t* state = tlsh_new();
+    uint8_t* buffer = (uint8_t*)malloc(TLSH_FILE_BUFFER);
+    if (!state || !buffer) {
+        tlsh_free(state);
+        free(buffer);
         fclose(file);
         return -1;
     }
-    
-    // Allocate buffer
-    uint8_t* buffer = (uint8_t*)malloc(file_size);
-    if (!buffer) {
-        fclose(file);
-        return -1;
+
+    // Constant memory regardless of file size
+    size_t n;
+    while ((n = fread(buffer, 1, TLSH_FILE_BUFFER, file)) > 0) {
+        tlsh_update(state, buffer, n);
     }
-    
-    // Read file
-    size_t bytes_read = fread(buffer, 1, file_size, file);
+    int ret = ferror(file) ? -1 : 0;
     fclose(file);
-    
-    if (bytes_read != (size_t)file_size) {
-        free(buffer);
-        return -1;
-    }
-    
-    // Compute hash
-    tlsh_hash_t tlsh_result;
-    int ret = tlsh_process_data(buffer, bytes_read, &tlsh_result);
     free(buffer);
-    
-    if (ret != 0) {
-        return -1;
+
+    if (ret == 0) {
+        ret = tlsh_digest(state, hash);
     }
-    
-    // Format result
-    *hash = format_tlsh_hash(&tlsh_result);
-    return (*hash) ? 0 : -1;
+    tlsh_free(state);
+    return ret;
 }
 
 int tlsh_hash_data(const void* data, size_t size, char** hash) {
@@ -186,48 +212,120 @@ int tlsh_hash_data(const void* data, size_t size, char** hash) {
         return -1;
     }
     
-    // Compute hash
-    tlsh_hash_t tlsh_result;
-    int ret = tlsh_process_data((const uint8_t*)data, size, &tlsh_result);
-    
-    if (ret != 0) {
+    tlsh_state_t* state = tlsh_new();
+    if (!state) {
         return -1;
     }
-    
-    // Format result
-    *hash = format_tlsh_hash(&tlsh_result);
-    return (*hash) ? 0 : -1;
+    tlsh_update(state, data, size);
+    int ret = tlsh_digest(state, hash);
+    tlsh_free(state);
+    return ret;
 }
 
-// Simplified comparison function
-int tlsh_compare(const char* hash1, const char* hash2) {
-    if (!hash1 || !hash2) {
-        return 0;
-    }
-    
-    // For now, return a simple string comparison score
-    // In a full implementation, this would parse the hashes and compute
-    // a proper distance metric
-    if (strcmp(hash1, hash2) == 0) {
-        return 100; // Identical
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int tlsh_parse(const char* hash, tlsh_digest_t* out) {
+    if (!hash || !out) {
+        return -1;
     }
-    
-    // Simple similarity check based on length and common characters
-    size_t len1 = strlen(hash1);
-    size_t len2 = strlen(hash2);
-    
-    if (len1 != len2) {
-        return 0; // Different lengths
+    if (hash[0] == 'T' && hash[1] == '1') {
+        hash += 2;
     }
-    
-    // Count matching characters
-    int matches = 0;
-    for (size_t i = 0; i < len1; i++) {
-        if (hash1[i] == hash2[i]) {
-            matches++;
+    uint8_t bytes[3 + TLSH_CODE_SIZE];
+    for (int i = 0; i < 3 + TLSH_CODE_SIZE; i++) {
+        int hi = hex_value(hash[2 * i]);
+        int lo = (hi < 0) ? -1 : hex_value(hash[2 * i + 1]);
+        if (lo < 0) {
+            return -1;
         }
+        bytes[i] = (uint8_t)((hi << 4) | lo);
     }
-    
-    // Return percentage similarity
-    return (matches * 100) / len1;
-}
\ No newline at end of file
+    out->checksum = swap_byte(bytes[0]);
+    out->lvalue = swap_byte(bytes[1]);
+    out->q1ratio = bytes[2] >> 4;
+    out->q2ratio = bytes[2] & 0x0F;
+    for (int i = 0; i < TLSH_CODE_SIZE; i++) {
+        out->code[i] = bytes[3 + TLSH_CODE_SIZE - 1 - i];
+    }
+    return 0;
+}
+
+static int mod_diff(int x, int y, int range) {
+    int dl, dr;
+    if (y > x) {
+        dl = y - x;
+        dr = x + range - y;
+    } else {
+        dl = x - y;
+        dr = y + range - x;
+    }
+    return dl < dr ? dl : dr;
+}
+
+// Distance between two nibbles (two 2-bit bucket codes each): |x - y| per
+// code, with the opposite-quartile case (|x - y| = 3) weighted as 6
+static const uint8_t nibble_diff[16][16] = {
+    {0, 1, 2, 6, 1, 2, 3, 7, 2, 3, 4, 8, 6, 7, 8, 12},
+    {1, 0, 1, 2, 2, 1, 2, 3, 3, 2, 3, 4, 7, 6, 7, 8},
+    {2, 1, 0, 1, 3, 2, 1, 2, 4, 3, 2, 3, 8, 7, 6, 7},
+    {6, 2, 1, 0, 7, 3, 2, 1, 8, 4, 3, 2, 12, 8, 7, 6},
+    {1, 2, 3, 7, 0, 1, 2, 6, 1, 2, 3, 7, 2, 3, 4, 8},
+    {2, 1, 2, 3, 1, 0, 1, 2, 2, 1, 2, 3, 3, 2, 3, 4},
+    {3, 2, 1, 2, 2, 1, 0, 1, 3, 2, 1, 2, 4, 3, 2, 3},
+    {7, 3, 2, 1, 6, 2, 1, 0, 7, 3, 2, 1, 8, 4, 3, 2},
+    {2, 3, 4, 8, 1, 2, 3, 7, 0, 1, 2, 6, 1, 2, 3, 7},
+    {3, 2, 3, 4, 2, 1, 2, 3, 1, 0, 1, 2, 2, 1, 2, 3},
+    {4, 3, 2, 3, 3, 2, 1, 2, 2, 1, 0, 1, 3, 2, 1, 2},
+    {8, 4, 3, 2, 7, 3, 2, 1, 6, 2, 1, 0, 7, 3, 2, 1},
+    {6, 7, 8, 12, 2, 3, 4, 8, 1, 2, 3, 7, 0, 1, 2, 6},
+    {7, 6, 7, 8, 3, 2, 3, 4, 2, 1, 2, 3, 1, 0, 1, 2},
+    {8, 7, 6, 7, 4, 3, 2, 3, 3, 2, 1, 2, 2, 1, 0, 1},
+    {12, 8, 7, 6, 8, 4, 3, 2, 7, 3, 2, 1, 6, 2, 1, 0}
+};
+
+static int byte_diff(uint8_t x, uint8_t y) {
+    return nibble_diff[x & 0x0F][y & 0x0F] + nibble_diff[x >> 4][y >> 4];
+}
+
+int tlsh_digest_distance(const tlsh_digest_t* a, const tlsh_digest_t* b, int len_diff) {
+    if (!a || !b) {
+        return -1;
+    }
+    int diff = 0;
+    if (len_diff) {
+        int ldiff = mod_diff(a->lvalue, b->lvalue, 256);
+        diff += (ldiff <= 1) ? ldiff : ldiff * 12;
+    }
+    int q1diff = mod_diff(a->q1ratio, b->q1ratio, 16);
+    diff += (q1diff <= 1) ? q1diff : (q1diff - 1) * 12;
+    int q2diff = mod_diff(a->q2ratio, b->q2ratio, 16);
+    diff += (q2diff <= 1) ? q2diff : (q2diff - 1) * 12;
+    if (a->checksum != b->checksum) {
+        diff += 1;
+    }
+    for (int i = 0; i < TLSH_CODE_SIZE; i++) {
+        diff += byte_diff(a->code[i], b->code[i]);
+    }
+    return diff;
+}
+
+int tlsh_distance(const char* hash1, const char* hash2) {
+    tlsh_digest_t a, b;
+    if (tlsh_parse(hash1, &a) != 0 || tlsh_parse(hash2, &b) != 0) {
+        return -1;
+    }
+    return tlsh_digest_distance(&a, &b, 1);
+}
+
+int tlsh_compare(const char* hash1, const char* hash2) {
+    int distance = tlsh_distance(hash1, hash2);
+    if (distance < 0 || distance >= 300) {
+        return 0;
+    }
+    return 100 - distance / 3;
+}
@@ -8,7 +8,26 @@
 extern "C" {
 #endif
 
-// Compute TLSH hash for a file
+// Incremental TLSH context: a 5-byte sliding window feeding 128 Pearson-hashed
+// buckets, so memory is constant regardless of input length.
+typedef struct tlsh_state tlsh_state_t;
+
+// Allocate a fresh context (NULL on allocation failure)
+tlsh_state_t* tlsh_new(void);
+
+// Feed the next len bytes
+// Returns 0 on success, non-zero on error
+int tlsh_update(tlsh_state_t* state, const void* data, size_t len);
+
+// Produce the digest of everything fed so far; the context stays usable
+// hash: output hash string (must be freed by caller)
+// Returns 0 on success, non-zero if the input is too short or too uniform
+int tlsh_digest(const tlsh_state_t* state, char** hash);
+
+// Release a context
+void tlsh_free(tlsh_state_t* state);
+
+// Compute TLSH hash for a file (streamed in fixed-size buffers)
 // path: path to the file
 // hash: output hash string (must be freed by caller)
 // Returns 0 on success, non-zero on error
@@ -21,10 +40,31 @@ int tlsh_hash_file(const char* path, char** hash);
 // Returns 0 on success, non-zero on error
 int tlsh_hash_data(const void* data, size_t size, char** hash);
 
+// Parsed TLSH hash
+typedef struct {
+    uint8_t checksum;
+    uint8_t lvalue;         // Log-scaled input length
+    uint8_t q1ratio;        // Quartile ratios (4 bits each)
+    uint8_t q2ratio;
+    uint8_t code[32];       // 2 bits per bucket
+} tlsh_digest_t;
+
+// Parse a "T1" + 70 hex digit string
+// Returns 0 on success, non-zero if malformed
+int tlsh_parse(const char* hash, tlsh_digest_t* out);
+
+// TLSH distance between parsed hashes: 0 for identical, below ~50 for close
+// variants, over ~200 for unrelated inputs. len_diff = 0 ignores the length term.
+int tlsh_digest_distance(const tlsh_digest_t* a, const tlsh_digest_t* b, int len_diff);
+
+// Distance between two TLSH strings; negative if either is malformed
+int tlsh_distance(const char* hash1, const char* hash2);
+
 // Compare two TLSH hashes
 // hash1: first hash
 // hash2: second hash
-// Returns similarity score (0-100, higher means more similar)
+// Returns similarity score (0-100, higher means more similar), derived from
+// tlsh_distance as max(0, 100 - distance / 3)
 int tlsh_compare(const char* hash1, const char* hash2);
 
 #ifdef __cplusplus
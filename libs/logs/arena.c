@@ -0,0 +1,121 @@
+#include "arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16
+
+struct log_arena_block {
+    log_arena_block_t* next;
+    size_t size;
+};
+
+// Header size rounded up so block memory starts aligned
+#define ARENA_HEADER ((sizeof(log_arena_block_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+void log_arena_init(log_arena_t* arena) {
+    if (arena) {
+        memset(arena, 0, sizeof(log_arena_t));
+    }
+}
+
+static int arena_grow(log_arena_t* arena, size_t size) {
+    // Large requests get a block of their own
+    size_t block_size = size > LOG_ARENA_BLOCK_SIZE / 4 ? size : LOG_ARENA_BLOCK_SIZE;
+    log_arena_block_t* block = (log_arena_block_t*)malloc(ARENA_HEADER + block_size);
+    if (!block) {
+        return -1;
+    }
+    block->size = block_size;
+    if (block_size == size && arena->blocks) {
+        // Keep filling the current block afterwards
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+        return 1;
+    }
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->cursor = (char*)block + ARENA_HEADER;
+    arena->remaining = block_size;
+    return 0;
+}
+
+void* log_arena_alloc(log_arena_t* arena, size_t size) {
+    if (!arena || size > SIZE_MAX - 2 * ARENA_ALIGN) {
+        return NULL;
+    }
+    size_t padded = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    // Strings may have left the cursor unaligned
+    size_t skip = (size_t)(-(uintptr_t)arena->cursor) & (ARENA_ALIGN - 1);
+    if (skip + padded > arena->remaining) {
+        const int grown = arena_grow(arena, padded);
+        if (grown < 0) {
+            return NULL;
+        }
+        if (grown > 0) {
+            arena->used += padded;
+            return (char*)arena->blocks->next + ARENA_HEADER;
+        }
+        skip = 0;
+    }
+    void* p = arena->cursor + skip;
+    arena->cursor += skip + padded;
+    arena->remaining -= skip + padded;
+    arena->used += padded;
+    return p;
+}
+
+char* log_arena_strndup(log_arena_t* arena, const char* str, size_t length) {
+    if (!arena || (!str && length > 0)) {
+        return NULL;
+    }
+    // Strings need no alignment: bump by the exact size when it fits
+    char* copy;
+    if (length + 1 <= arena->remaining) {
+        copy = arena->cursor;
+        arena->cursor += length + 1;
+        arena->remaining -= length + 1;
+        arena->used += length + 1;
+    } else {
+        copy = (char*)log_arena_alloc(arena, length + 1);
+        if (!copy) {
+            return NULL;
+        }
+    }
+    if (length > 0) {
+        memcpy(copy, str, length);
+    }
+    copy[length] = '\0';
+    return copy;
+}
+
+void log_arena_adopt(log_arena_t* dst, log_arena_t* src) {
+    if (!dst || !src || !src->blocks) {
+        return;
+    }
+    if (!dst->blocks) {
+        *dst = *src;
+    } else {
+        // Behind dst's current block, which keeps serving allocations
+        log_arena_block_t* last = src->blocks;
+        while (last->next) {
+            last = last->next;
+        }
+        last->next = dst->blocks->next;
+        dst->blocks->next = src->blocks;
+        dst->used += src->used;
+    }
+    memset(src, 0, sizeof(log_arena_t));
+}
+
+void log_arena_free(log_arena_t* arena) {
+    if (arena) {
+        log_arena_block_t* block = arena->blocks;
+        while (block) {
+            log_arena_block_t* next = block->next;
+            free(block);
+            block = next;
+        }
+        memset(arena, 0, sizeof(log_arena_t));
+    }
+}
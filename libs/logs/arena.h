@@ -0,0 +1,44 @@
+#ifndef LIBS_LOGS_ARENA_H
+#define LIBS_LOGS_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_ARENA_BLOCK_SIZE (256 * 1024)
+
+typedef struct log_arena_block log_arena_block_t;
+
+// Bump allocator for the strings of parsed entries. Allocation is a pointer
+// increment; everything is released at once by log_arena_free.
+typedef struct {
+    log_arena_block_t* blocks;  // Most recent block first
+    char* cursor;
+    size_t remaining;
+    size_t used;                // Bytes handed out
+} log_arena_t;
+
+// Initialize an empty arena (allocates nothing)
+void log_arena_init(log_arena_t* arena);
+
+// Allocate size bytes aligned for any type
+// Returns the memory, or NULL on error
+void* log_arena_alloc(log_arena_t* arena, size_t size);
+
+// Copy length bytes and a terminating NUL into the arena
+// Returns the copy, or NULL on error
+char* log_arena_strndup(log_arena_t* arena, const char* str, size_t length);
+
+// Move every allocation of src into dst without copying; src is left empty
+void log_arena_adopt(log_arena_t* dst, log_arena_t* src);
+
+// Free every allocation of the arena and reset it to empty
+void log_arena_free(log_arena_t* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_LOGS_ARENA_H
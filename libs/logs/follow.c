@@ -0,0 +1,324 @@
+#include "follow.h"
+#include "parsers.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+struct log_follower {
+    char* path;
+    log_follow_options_t options;
+    int fd;
+    dev_t dev;                  // Identity of the file being read
+    ino_t ino;
+    uint64_t offset;            // Bytes read from it
+    int at_start;               // The next line is the first of the file
+    char* buffer;               // Unparsed bytes: at most a partial line between polls
+    size_t length;
+    size_t capacity;
+    log_statistics_t stats;
+    int notify_fd;              // inotify on the file's directory, -1 if unavailable
+};
+
+void log_follow_options_init(log_follow_options_t* options) {
+    if (options) {
+        memset(options, 0, sizeof(log_follow_options_t));
+        options->format = LOG_FORMAT_SYSLOG;
+        options->poll_interval_ms = LOG_FOLLOW_DEFAULT_INTERVAL_MS;
+    }
+}
+
+static int add_to_batch(const log_entry_view_t* view, void* user_data) {
+    return log_result_add_view((log_result_t*)user_data, view) != 0 ? -1 : 0;
+}
+
+// Parse the complete lines of the buffer (every byte if flush) and keep
+// the rest. Each entry updates the statistics and, if it passes the
+// filter, goes to the callback.
+// Returns the number of entries, or -1 on error
+static long parse_buffer(log_follower_t* follower, int flush) {
+    size_t end = follower->length;
+    if (!flush) {
+        while (end > 0 && follower->buffer[end - 1] != '\n') {
+            end--;
+        }
+    }
+    if (end == 0) {
+        return 0;
+    }
+
+    log_parse_context_t context;
+    log_parse_context_init(&context, time(NULL));
+    if (follower->options.json_mapping &&
+        log_parse_context_set_json_mapping(&context, follower->options.json_mapping) != 0) {
+        return -1;
+    }
+    log_result_t batch;
+    log_result_init(&batch);
+    int ret = log_parse_chunk(&context, follower->buffer, end, follower->options.format, follower->at_start,
+                              add_to_batch, &batch);
+    follower->at_start = 0;
+
+    const log_follow_options_t* options = &follower->options;
+    for (size_t i = 0; ret == 0 && i < batch.count; i++) {
+        const log_entry_t* entry = &batch.entries[i];
+        ret = log_statistics_add_entry(&follower->stats, entry);
+        if (ret == 0 && options->callback && (!options->filter || log_filter_match(options->filter, entry))) {
+            options->callback(entry, options->user_data);
+        }
+    }
+    const long count = (long)batch.count;
+    log_result_free(&batch);
+
+    memmove(follower->buffer, follower->buffer + end, follower->length - end);
+    follower->length -= end;
+    return ret == 0 ? count : -1;
+}
+
+// Read to the end of the current file, parsing as the lines complete
+static long read_new(log_follower_t* follower) {
+    long total = 0;
+    for (;;) {
+        if (follower->length + LOG_FOLLOW_READ_SIZE > follower->capacity) {
+            size_t new_capacity = follower->capacity ? follower->capacity * 2 : 2 * LOG_FOLLOW_READ_SIZE;
+            while (new_capacity < follower->length + LOG_FOLLOW_READ_SIZE) {
+                new_capacity *= 2;
+            }
+            char* new_buffer = (char*)realloc(follower->buffer, new_capacity);
+            if (!new_buffer) {
+                return -1;
+            }
+            follower->buffer = new_buffer;
+            follower->capacity = new_capacity;
+        }
+        const ssize_t n = read(follower->fd, follower->buffer + follower->length, LOG_FOLLOW_READ_SIZE);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            return total;
+        }
+        follower->length += (size_t)n;
+        follower->offset += (uint64_t)n;
+        const long count = parse_buffer(follower, 0);
+        if (count < 0) {
+            return -1;
+        }
+        total += count;
+    }
+}
+
+static int open_file(log_follower_t* follower, int at_end) {
+    const int fd = open(follower->path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (at_end && lseek(fd, st.st_size, SEEK_SET) < 0)) {
+        close(fd);
+        return -1;
+    }
+    if (follower->fd >= 0) {
+        close(follower->fd);
+    }
+    follower->fd = fd;
+    follower->dev = st.st_dev;
+    follower->ino = st.st_ino;
+    follower->offset = at_end ? (uint64_t)st.st_size : 0;
+    follower->at_start = follower->offset == 0;
+    follower->length = 0;
+    return 0;
+}
+
+// Handle rotation and truncation, then read what is new
+static long follower_check(log_follower_t* follower) {
+    long total = 0;
+    struct stat st;
+    if (stat(follower->path, &st) == 0 && (st.st_dev != follower->dev || st.st_ino != follower->ino)) {
+        // Rotated: finish the old file, including a last line without a
+        // newline, then start on the new one
+        long count = read_new(follower);
+        if (count < 0) {
+            return -1;
+        }
+        total += count;
+        count = parse_buffer(follower, 1);
+        if (count < 0) {
+            return -1;
+        }
+        total += count;
+        if (open_file(follower, 0) != 0) {
+            return total;   // Replaced again before it could be opened; retry next time
+        }
+    } else if (fstat(follower->fd, &st) == 0 && (uint64_t)st.st_size < follower->offset) {
+        // Truncated in place: the old partial line is gone
+        if (lseek(follower->fd, 0, SEEK_SET) < 0) {
+            return -1;
+        }
+        follower->offset = 0;
+        follower->length = 0;
+        follower->at_start = 1;
+    }
+    const long count = read_new(follower);
+    return count < 0 ? -1 : total + count;
+}
+
+static void watch_directory(log_follower_t* follower) {
+    follower->notify_fd = -1;
+#ifdef __linux__
+    const char* slash = strrchr(follower->path, '/');
+    char* dir = slash ? strndup(follower->path, slash == follower->path ? 1 : (size_t)(slash - follower->path))
+                      : strdup(".");
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // The directory sees writes to the file and the renames and creations
+    // of rotation
+    if (dir && fd >= 0 &&
+        inotify_add_watch(fd, dir, IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) >= 0) {
+        follower->notify_fd = fd;
+    } else if (fd >= 0) {
+        close(fd);
+    }
+    free(dir);
+#endif
+}
+
+log_follower_t* log_follower_open(const char* path, const log_follow_options_t* options) {
+    if (!path) {
+        return NULL;
+    }
+    log_follower_t* follower = (log_follower_t*)calloc(1, sizeof(log_follower_t));
+    if (!follower) {
+        return NULL;
+    }
+    follower->fd = -1;
+    follower->notify_fd = -1;
+    if (options) {
+        follower->options = *options;
+    } else {
+        log_follow_options_init(&follower->options);
+    }
+    if (follower->options.poll_interval_ms <= 0) {
+        follower->options.poll_interval_ms = LOG_FOLLOW_DEFAULT_INTERVAL_MS;
+    }
+    log_statistics_init(&follower->stats);
+    follower->path = strdup(path);
+    if (!follower->path || open_file(follower, !follower->options.from_start) != 0) {
+        log_follower_close(follower);
+        return NULL;
+    }
+    watch_directory(follower);
+    return follower;
+}
+
+static long elapsed_ms(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)(now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+// Sleep until the directory changes or timeout_ms pass
+static void follower_wait(log_follower_t* follower, int timeout_ms) {
+#ifdef __linux__
+    if (follower->notify_fd >= 0) {
+        struct pollfd pfd;
+        pfd.fd = follower->notify_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout_ms) > 0) {
+            // Only the wake-up matters; drain the events
+            char events[4096];
+            while (read(follower->notify_fd, events, sizeof(events)) > 0) {
+            }
+        }
+        return;
+    }
+#endif
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+long log_follower_poll(log_follower_t* follower, int timeout_ms) {
+    if (!follower) {
+        return -1;
+    }
+    long count = follower_check(follower);
+    if (count != 0 || timeout_ms <= 0) {
+        return count;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        const long remaining = timeout_ms - elapsed_ms(&start);
+        if (remaining <= 0) {
+            return 0;
+        }
+        follower_wait(follower, remaining < follower->options.poll_interval_ms ? (int)remaining
+                                                                              : follower->options.poll_interval_ms);
+        count = follower_check(follower);
+        if (count != 0) {
+            return count;
+        }
+    }
+}
+
+int log_follower_get_statistics(const log_follower_t* follower, log_statistics_t* stats) {
+    if (!follower || !stats) {
+        return -1;
+    }
+    log_statistics_init(stats);
+    const log_statistics_t* own = &follower->stats;
+    stats->total_entries = own->total_entries;
+    stats->error_count = own->error_count;
+    stats->warning_count = own->warning_count;
+    stats->info_count = own->info_count;
+    stats->debug_count = own->debug_count;
+    stats->first_timestamp = own->first_timestamp;
+    stats->last_timestamp = own->last_timestamp;
+    if (own->source_count > 0) {
+        stats->top_sources = (char**)calloc(LOG_STATS_MAX_SOURCES, sizeof(char*));
+        if (!stats->top_sources) {
+            return -1;
+        }
+        for (size_t j = 0; j < own->source_count; j++) {
+            stats->top_sources[j] = strdup(own->top_sources[j]);
+            if (!stats->top_sources[j]) {
+                log_statistics_free(stats);
+                return -1;
+            }
+            stats->source_count++;
+        }
+    }
+    return 0;
+}
+
+uint64_t log_follower_offset(const log_follower_t* follower) {
+    return follower ? follower->offset - follower->length : 0;
+}
+
+void log_follower_close(log_follower_t* follower) {
+    if (follower) {
+        if (follower->fd >= 0) {
+            close(follower->fd);
+        }
+        if (follower->notify_fd >= 0) {
+            close(follower->notify_fd);
+        }
+        log_statistics_free(&follower->stats);
+        free(follower->buffer);
+        free(follower->path);
+        free(follower);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef LIBS_LOGS_FOLLOW_H
+#define LIBS_LOGS_FOLLOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "logs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bytes read from the followed file at a time
+#define LOG_FOLLOW_READ_SIZE (64 * 1024)
+
+// Default longest wait between checks of the file
+#define LOG_FOLLOW_DEFAULT_INTERVAL_MS 1000
+
+typedef struct log_follower log_follower_t;
+
+// Receives each new entry that passes the filter; the entry is only valid
+// during the call
+typedef void (*log_follow_callback_t)(const log_entry_t* entry, void* user_data);
+
+// Follow options
+typedef struct {
+    log_format_t format;
+    const log_json_mapping_t* json_mapping; // JSON lines (NULL = defaults)
+    const log_filter_t* filter;             // Entries the callback receives (NULL = all)
+    log_follow_callback_t callback;         // May be NULL
+    void* user_data;
+    int from_start;                         // Parse the existing contents first; otherwise start at the end
+    int poll_interval_ms;                   // Longest wait between checks; inotify wakes earlier on Linux
+} log_follow_options_t;
+
+// Initialize follow options with default values (syslog, from the end)
+void log_follow_options_init(log_follow_options_t* options);
+
+// Start following a growing log file, like tail -F. Only complete lines
+// are parsed; a partial last line waits for its newline.
+// options: follow options; the filter and mapping must outlive the follower
+// Returns the follower, or NULL on error
+log_follower_t* log_follower_open(const char* path, const log_follow_options_t* options);
+
+// Parse the lines appended since the last call, waiting up to timeout_ms
+// for some if there are none yet. When the path names a new file
+// (rotation), the rest of the old one is read first and the new one is
+// then followed from its start; a file that shrank (truncation) is
+// followed from its start again.
+// Returns the number of new entries, or negative on error
+long log_follower_poll(log_follower_t* follower, int timeout_ms);
+
+// Statistics of every entry read so far, filtered or not; kept up to
+// date entry by entry
+// stats: output statistics (must be freed with log_statistics_free)
+// Returns 0 on success, non-zero on error
+int log_follower_get_statistics(const log_follower_t* follower, log_statistics_t* stats);
+
+// Offset in the current file up to which lines have been parsed
+uint64_t log_follower_offset(const log_follower_t* follower);
+
+// Stop following and free the follower
+void log_follower_close(log_follower_t* follower);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_LOGS_FOLLOW_H
@@ -0,0 +1,655 @@
+#include "json.h"
+#include <limits.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__PCLMUL__)
+#define JSON_CLMUL 1
+#include <wmmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define JSON_BLOCK 64
+#define JSON_END (-1L)
+
+static unsigned first_set_bit64(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(mask);
+#else
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (unsigned)index;
+#endif
+}
+
+void log_json_mapping_init(log_json_mapping_t* mapping) {
+    if (mapping) {
+        mapping->timestamp = "timestamp,time,@timestamp,ts,date";
+        mapping->level = "level,severity,lvl,loglevel";
+        mapping->message = "message,msg,log,textPayload,jsonPayload.message,@message";
+        mapping->host = "host,hostname,host.name,resource.labels.instance_id";
+        mapping->process = "process,logger,service,app,process.name,logName";
+        mapping->pid = "pid,process.pid";
+        mapping->source = NULL;
+    }
+}
+
+int log_json_keys_compile(const log_json_mapping_t* mapping, log_json_keys_t* keys) {
+    if (!keys) {
+        return -1;
+    }
+    log_json_mapping_t defaults;
+    if (!mapping) {
+        log_json_mapping_init(&defaults);
+        mapping = &defaults;
+    }
+    const char* lists[LOG_JSON_FIELD_COUNT];
+    lists[LOG_JSON_TIMESTAMP] = mapping->timestamp;
+    lists[LOG_JSON_LEVEL] = mapping->level;
+    lists[LOG_JSON_MESSAGE] = mapping->message;
+    lists[LOG_JSON_HOST] = mapping->host;
+    lists[LOG_JSON_PROCESS] = mapping->process;
+    lists[LOG_JSON_PID] = mapping->pid;
+    lists[LOG_JSON_SOURCE] = mapping->source;
+
+    keys->count = 0;
+    for (int f = 0; f < LOG_JSON_FIELD_COUNT; f++) {
+        const char* p = lists[f];
+        int priority = 0;
+        while (p && *p) {
+            const char* end = strchr(p, ',');
+            if (!end) {
+                end = p + strlen(p);
+            }
+            const char* start = p;
+            const char* stop = end;
+            while (start < stop && isspace((unsigned char)*start)) start++;
+            while (stop > start && isspace((unsigned char)stop[-1])) stop--;
+            if (stop > start) {
+                if (keys->count >= LOG_JSON_MAX_KEYS) {
+                    return -1;
+                }
+                log_json_key_t* key = &keys->keys[keys->count++];
+                key->path = start;
+                key->length = (size_t)(stop - start);
+                key->field = (log_json_field_t)f;
+                key->priority = priority++;
+            }
+            p = *end ? end + 1 : end;
+        }
+    }
+    return 0;
+}
+
+// --- Structural index ---
+
+// Character classes of 64 bytes
+static void classify_block(const char* p, uint64_t* quote, uint64_t* backslash, uint64_t* structural) {
+    uint64_t q = 0, b = 0, s = 0;
+#ifdef JSON_SSE2
+    const __m128i quote_char = _mm_set1_epi8('"');
+    const __m128i backslash_char = _mm_set1_epi8('\\');
+    const __m128i fold = _mm_set1_epi8(0x20);   // '[' | 0x20 == '{', ']' | 0x20 == '}'
+    const __m128i open_char = _mm_set1_epi8('{');
+    const __m128i close_char = _mm_set1_epi8('}');
+    const __m128i colon_char = _mm_set1_epi8(':');
+    const __m128i comma_char = _mm_set1_epi8(',');
+    for (int i = 0; i < JSON_BLOCK; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        const __m128i folded = _mm_or_si128(v, fold);
+        const __m128i ops = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open_char), _mm_cmpeq_epi8(folded, close_char)),
+                                         _mm_or_si128(_mm_cmpeq_epi8(v, colon_char), _mm_cmpeq_epi8(v, comma_char)));
+        q |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote_char)) << i;
+        b |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash_char)) << i;
+        s |= (uint64_t)(unsigned)_mm_movemask_epi8(ops) << i;
+    }
+#else
+    for (int i = 0; i < JSON_BLOCK; i++) {
+        const char c = p[i];
+        const char folded = (char)(c | 0x20);
+        q |= (uint64_t)(c == '"') << i;
+        b |= (uint64_t)(c == '\\') << i;
+        s |= (uint64_t)(folded == '{' || folded == '}' || c == ':' || c == ',') << i;
+    }
+#endif
+    *quote = q;
+    *backslash = b;
+    *structural = s;
+}
+
+// Bits of the characters escaped by a backslash (simdjson's branchless
+// odd-sequence trick); *carry holds whether the next block starts escaped
+static uint64_t find_escaped(uint64_t backslash, uint64_t* carry) {
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    backslash &= ~*carry;
+    const uint64_t follows_escape = backslash << 1 | *carry;
+    const uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+    const uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    *carry = sequences_starting_on_even_bits < backslash;
+    const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+// Bit i is the XOR of bits 0..i: set inside strings, given the quotes
+static uint64_t prefix_xor(uint64_t x) {
+#ifdef JSON_CLMUL
+    const __m128i all_ones = _mm_set1_epi8((char)0xFF);
+    const __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)x), all_ones, 0);
+    return (uint64_t)_mm_cvtsi128_si64(product);
+#else
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+#endif
+}
+
+// Structural characters of a line in order: { } [ ] : , outside strings
+// and the opening quote of every string
+typedef struct {
+    const char* data;
+    size_t length;
+    size_t block;           // Offset of the block described by mask
+    size_t next_block;
+    uint64_t mask;          // Structurals of the block not yet returned
+    uint64_t in_string;     // All ones if the last block ended inside a string
+    uint64_t escaped;       // 1 if the last block ended with an unpaired backslash
+} json_index_t;
+
+static void index_init(json_index_t* index, const char* data, size_t length) {
+    memset(index, 0, sizeof(*index));
+    index->data = data;
+    index->length = length;
+}
+
+static uint64_t index_block(json_index_t* index, const char* p) {
+    uint64_t quote, backslash, structural;
+    classify_block(p, &quote, &backslash, &structural);
+    quote &= ~find_escaped(backslash, &index->escaped);
+    const uint64_t in_string = prefix_xor(quote) ^ index->in_string;
+    index->in_string = (uint64_t)((int64_t)in_string >> 63);
+    return (structural & ~in_string) | (quote & in_string);
+}
+
+// Offset of the next structural, or JSON_END
+static long index_next(json_index_t* index) {
+    while (index->mask == 0) {
+        if (index->next_block >= index->length) {
+            return JSON_END;
+        }
+        const size_t remaining = index->length - index->next_block;
+        index->block = index->next_block;
+        if (remaining >= JSON_BLOCK) {
+            index->mask = index_block(index, index->data + index->block);
+        } else {
+            char tail[JSON_BLOCK];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, index->data + index->block, remaining);
+            index->mask = index_block(index, tail);
+        }
+        index->next_block += JSON_BLOCK;
+    }
+    const size_t pos = index->block + first_set_bit64(index->mask);
+    index->mask &= index->mask - 1;
+    return (long)pos;
+}
+
+// Skip the rest of an object or array whose opener was just returned
+// Returns the offset of its closer, or JSON_END
+static long index_skip(json_index_t* index) {
+    int depth = 1;
+    for (;;) {
+        const long pos = index_next(index);
+        if (pos == JSON_END) {
+            return JSON_END;
+        }
+        const char c = (char)(index->data[pos] | 0x20);
+        if (c == '{') {
+            depth++;
+        } else if (c == '}' && --depth == 0) {
+            return pos;
+        }
+    }
+}
+
+// --- On-demand walk ---
+
+typedef struct {
+    const char* ptr;
+    size_t length;
+    int is_string;
+} json_value_t;
+
+typedef struct {
+    json_index_t index;
+    const log_json_keys_t* keys;
+    json_value_t values[LOG_JSON_FIELD_COUNT];
+    int priority[LOG_JSON_FIELD_COUNT];     // INT_MAX = not found yet
+    char path[LOG_JSON_MAX_PATH];
+} json_walk_t;
+
+// Closing quote of a string whose body starts at p, given the next
+// structural: only whitespace may separate them
+static const char* string_close(const char* p, const char* next) {
+    while (next > p && isspace((unsigned char)next[-1])) {
+        next--;
+    }
+    return next > p && next[-1] == '"' ? next - 1 : NULL;
+}
+
+// Store a value for every field mapped to the path
+static void walk_assign(json_walk_t* walk, size_t path_length, const json_value_t* value) {
+    for (size_t k = 0; k < walk->keys->count; k++) {
+        const log_json_key_t* key = &walk->keys->keys[k];
+        if (key->length == path_length && key->priority < walk->priority[key->field] &&
+            memcmp(key->path, walk->path, path_length) == 0) {
+            walk->values[key->field] = *value;
+            walk->priority[key->field] = key->priority;
+        }
+    }
+}
+
+// Does a mapped path continue inside the object at the path?
+static int walk_descends(const json_walk_t* walk, size_t path_length) {
+    for (size_t k = 0; k < walk->keys->count; k++) {
+        const log_json_key_t* key = &walk->keys->keys[k];
+        if (key->length > path_length && key->path[path_length] == '.' &&
+            memcmp(key->path, walk->path, path_length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Walk the members of an object whose '{' was just returned. prefix is
+// the length of its path in walk->path (0 at the top, SIZE_MAX if too
+// long to match anything).
+// Returns 0 at the closing '}', -1 if the line is not well-formed
+static int walk_object(json_walk_t* walk, size_t prefix, int depth) {
+    const char* s = walk->index.data;
+    long pos = index_next(&walk->index);
+    if (pos != JSON_END && s[pos] == '}') {
+        return 0;
+    }
+    for (;;) {
+        if (pos == JSON_END || s[pos] != '"') {
+            return -1;
+        }
+        const long colon = index_next(&walk->index);
+        if (colon == JSON_END || s[colon] != ':') {
+            return -1;
+        }
+        const char* key = s + pos + 1;
+        const char* key_end = string_close(key, s + colon);
+        if (!key_end) {
+            return -1;
+        }
+
+        // Path of the member: prefix "." key
+        const size_t key_length = (size_t)(key_end - key);
+        size_t path_length = SIZE_MAX;
+        if (prefix != SIZE_MAX) {
+            const size_t dot = prefix > 0 ? 1 : 0;
+            if (prefix + dot + key_length <= LOG_JSON_MAX_PATH) {
+                if (dot) {
+                    walk->path[prefix] = '.';
+                }
+                memcpy(walk->path + prefix + dot, key, key_length);
+                path_length = prefix + dot + key_length;
+            }
+        }
+
+        const long value = index_next(&walk->index);
+        if (value == JSON_END) {
+            return -1;
+        }
+        long after;
+        json_value_t found;
+        found.ptr = NULL;
+        if (s[value] == '"') {
+            after = index_next(&walk->index);
+            const char* close = after != JSON_END ? string_close(s + value + 1, s + after) : NULL;
+            if (!close) {
+                return -1;
+            }
+            found.ptr = s + value + 1;
+            found.length = (size_t)(close - found.ptr);
+            found.is_string = 1;
+        } else if (s[value] == '{' || s[value] == '[') {
+            if (s[value] == '{' && path_length != SIZE_MAX && depth < LOG_JSON_MAX_DEPTH &&
+                walk_descends(walk, path_length)) {
+                if (walk_object(walk, path_length, depth + 1) != 0) {
+                    return -1;
+                }
+            } else if (index_skip(&walk->index) == JSON_END) {
+                return -1;
+            }
+            after = index_next(&walk->index);
+        } else {
+            // Scalar: the text between the colon and the next structural
+            after = value;
+            const char* start = s + colon + 1;
+            const char* stop = s + value;
+            while (start < stop && isspace((unsigned char)*start)) start++;
+            while (stop > start && isspace((unsigned char)stop[-1])) stop--;
+            if (stop > start && !(stop - start == 4 && memcmp(start, "null", 4) == 0)) {
+                found.ptr = start;
+                found.length = (size_t)(stop - start);
+                found.is_string = 0;
+            }
+        }
+        if (found.ptr && path_length != SIZE_MAX) {
+            walk_assign(walk, path_length, &found);
+        }
+
+        if (after == JSON_END) {
+            return -1;
+        }
+        if (s[after] == '}') {
+            return 0;
+        }
+        if (s[after] != ',') {
+            return -1;
+        }
+        pos = index_next(&walk->index);
+    }
+}
+
+// --- Field conversion ---
+
+static int two_digits(const char* p) {
+    if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') {
+        return -1;
+    }
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+// Days from 1970-01-01 to a civil date (month 1-12)
+static long days_from_civil(long year, int month, int day) {
+    year -= month <= 2;
+    const long era = (year >= 0 ? year : year - 399) / 400;
+    const long yoe = year - era * 400;
+    const long mp = (month + 9) % 12;
+    const long doy = (153 * mp + 2) / 5 + day - 1;
+    const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// "2023-11-14T22:13:20.123+01:00"; no zone means UTC
+static int parse_iso_time(const char* p, const char* end, time_t* timestamp) {
+    const size_t length = (size_t)(end - p);
+    if (length < 10 || p[4] != '-' || p[7] != '-') {
+        return -1;
+    }
+    const int century = two_digits(p), year_low = two_digits(p + 2);
+    const int month = two_digits(p + 5), day = two_digits(p + 8);
+    if (century < 0 || year_low < 0 || month < 1 || month > 12 || day < 1 || day > 31) {
+        return -1;
+    }
+    long long t = (long long)days_from_civil(century * 100 + year_low, month, day) * 86400;
+    const char* q = p + 10;
+    if (q < end && (*q == 'T' || *q == 't' || *q == ' ')) {
+        if (end - q < 9) {
+            return -1;
+        }
+        const int h = two_digits(q + 1), m = two_digits(q + 4), sec = two_digits(q + 7);
+        if (h < 0 || m < 0 || sec < 0 || q[3] != ':' || q[6] != ':' || h > 23 || m > 59 || sec > 60) {
+            return -1;
+        }
+        t += h * 3600L + m * 60L + sec;
+        q += 9;
+        if (q < end && (*q == '.' || *q == ',')) {
+            q++;
+            while (q < end && *q >= '0' && *q <= '9') q++;
+        }
+        if (q < end && (*q == '+' || *q == '-')) {
+            const int sign = *q == '-' ? -1 : 1;
+            if (end - q < 3) {
+                return -1;
+            }
+            const int zone_h = two_digits(q + 1);
+            const char* zm = q + 3;
+            if (zm < end && *zm == ':') zm++;
+            const int zone_m = end - zm >= 2 ? two_digits(zm) : 0;
+            if (zone_h < 0 || zone_m < 0) {
+                return -1;
+            }
+            t -= sign * (zone_h * 3600L + zone_m * 60L);
+        }
+    }
+    *timestamp = (time_t)t;
+    return 0;
+}
+
+// Epoch time as a number or a numeric string; seconds, milliseconds,
+// microseconds and nanoseconds are told apart by magnitude
+static int parse_epoch_time(const char* p, const char* end, time_t* timestamp) {
+    int negative = 0;
+    if (p < end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return -1;
+    }
+    unsigned long long value = 0;
+    int digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (++digits > 19) {
+            return -1;
+        }
+        value = value * 10 + (unsigned long long)(*p - '0');
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+    if (p != end) {
+        return -1;
+    }
+    if (value >= 100000000000000000ULL) {
+        value /= 1000000000ULL;
+    } else if (value >= 100000000000000ULL) {
+        value /= 1000000ULL;
+    } else if (value >= 100000000000ULL) {
+        value /= 1000ULL;
+    }
+    *timestamp = negative ? -(time_t)value : (time_t)value;
+    return 0;
+}
+
+static int parse_json_time(const json_value_t* value, time_t* timestamp) {
+    const char* end = value->ptr + value->length;
+    if (parse_epoch_time(value->ptr, end, timestamp) == 0) {
+        return 0;
+    }
+    return value->is_string ? parse_iso_time(value->ptr, end, timestamp) : -1;
+}
+
+// Numeric levels: syslog severities (0-7) and pino/bunyan levels (10-60)
+static const char* numeric_level(const json_value_t* value) {
+    static const char* const syslog_names[] = {"fatal", "fatal", "fatal", "error", "warning", "notice", "info", "debug"};
+    long level = 0;
+    for (size_t i = 0; i < value->length; i++) {
+        const char c = value->ptr[i];
+        if (c < '0' || c > '9' || level > 1000) {
+            return NULL;
+        }
+        level = level * 10 + (c - '0');
+    }
+    if (value->length == 0) {
+        return NULL;
+    }
+    if (level < 8) {
+        return syslog_names[level];
+    }
+    return level <= 10 ? "trace" : level <= 20 ? "debug" : level <= 30 ? "info"
+         : level <= 40 ? "warning" : level <= 50 ? "error" : "fatal";
+}
+
+static int value_atoi(const json_value_t* value) {
+    const char* p = value->ptr;
+    const char* end = p + value->length;
+    int negative = 0;
+    if (p < end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+    long result = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        result = result * 10 + (*p - '0');
+        if (result > INT_MAX) break;
+    }
+    return (int)(negative ? -result : result);
+}
+
+// Set a string field; escaped strings are flagged for decoding on copy
+static void set_string(log_entry_view_t* view, log_slice_t* slice, unsigned flag, const json_value_t* value) {
+    slice->ptr = value->ptr;
+    slice->length = value->length;
+    if (value->is_string && memchr(value->ptr, '\\', value->length)) {
+        view->escaped |= flag;
+    } else {
+        view->escaped &= ~flag;
+    }
+}
+
+int log_json_parse_line(const log_json_keys_t* keys, const char* line, size_t length, log_entry_view_t* view) {
+    if (!keys || !line || !view) {
+        return -1;
+    }
+
+    json_walk_t walk;
+    index_init(&walk.index, line, length);
+    walk.keys = keys;
+    for (int f = 0; f < LOG_JSON_FIELD_COUNT; f++) {
+        walk.priority[f] = INT_MAX;
+    }
+    const long open = index_next(&walk.index);
+    if (open == JSON_END || line[open] != '{' || walk_object(&walk, 0, 1) != 0) {
+        return -1;
+    }
+
+    const json_value_t* values = walk.values;
+    if (walk.priority[LOG_JSON_TIMESTAMP] != INT_MAX) {
+        parse_json_time(&values[LOG_JSON_TIMESTAMP], &view->timestamp);
+    }
+    if (walk.priority[LOG_JSON_LEVEL] != INT_MAX) {
+        const char* name = values[LOG_JSON_LEVEL].is_string ? NULL : numeric_level(&values[LOG_JSON_LEVEL]);
+        if (name) {
+            view->level.ptr = name;
+            view->level.length = strlen(name);
+            view->escaped &= ~LOG_ESCAPED_LEVEL;
+        } else {
+            set_string(view, &view->level, LOG_ESCAPED_LEVEL, &values[LOG_JSON_LEVEL]);
+        }
+    }
+    if (walk.priority[LOG_JSON_MESSAGE] != INT_MAX) {
+        set_string(view, &view->message, LOG_ESCAPED_MESSAGE, &values[LOG_JSON_MESSAGE]);
+    }
+    if (walk.priority[LOG_JSON_HOST] != INT_MAX) {
+        set_string(view, &view->host, LOG_ESCAPED_HOST, &values[LOG_JSON_HOST]);
+    }
+    if (walk.priority[LOG_JSON_PROCESS] != INT_MAX) {
+        set_string(view, &view->process, LOG_ESCAPED_PROCESS, &values[LOG_JSON_PROCESS]);
+    }
+    if (walk.priority[LOG_JSON_SOURCE] != INT_MAX) {
+        set_string(view, &view->source, LOG_ESCAPED_SOURCE, &values[LOG_JSON_SOURCE]);
+    }
+    if (walk.priority[LOG_JSON_PID] != INT_MAX) {
+        view->pid = value_atoi(&values[LOG_JSON_PID]);
+    }
+    return 0;
+}
+
+// --- Escapes ---
+
+static int hex4(const char* p, uint32_t* value) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        const char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= (uint32_t)(c - 'A' + 10);
+        else return -1;
+    }
+    *value = v;
+    return 0;
+}
+
+static size_t utf8_encode(uint32_t cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    } else if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    } else if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+size_t log_json_unescape(const char* src, size_t length, char* dst) {
+    size_t out = 0;
+    size_t i = 0;
+    while (i < length) {
+        const char c = src[i];
+        if (c != '\\' || i + 1 >= length) {
+            dst[out++] = c;
+            i++;
+            continue;
+        }
+        const char e = src[i + 1];
+        uint32_t cp, low;
+        switch (e) {
+            case 'b': dst[out++] = '\b'; i += 2; break;
+            case 'f': dst[out++] = '\f'; i += 2; break;
+            case 'n': dst[out++] = '\n'; i += 2; break;
+            case 'r': dst[out++] = '\r'; i += 2; break;
+            case 't': dst[out++] = '\t'; i += 2; break;
+            case 'u':
+                if (i + 6 > length || hex4(src + i + 2, &cp) != 0) {
+                    dst[out++] = c;
+                    i++;
+                    break;
+                }
+                i += 6;
+                if (cp >= 0xD800 && cp < 0xDC00 && i + 6 <= length && src[i] == '\\' && src[i + 1] == 'u' &&
+                    hex4(src + i + 2, &low) == 0 && low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                } else if (cp >= 0xD800 && cp < 0xE000) {
+                    cp = 0xFFFD;    // Unpaired surrogate
+                } else if (cp == 0) {
+                    cp = ' ';       // Entry strings are NUL-terminated
+                }
+                out += utf8_encode(cp, dst + out);
+                break;
+            default:
+                // \" \\ \/ and anything unknown: the character itself
+                dst[out++] = e;
+                i += 2;
+                break;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,71 @@
+#ifndef LIBS_LOGS_JSON_H
+#define LIBS_LOGS_JSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "logs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Most key paths a mapping can hold, over all fields
+#define LOG_JSON_MAX_KEYS 32
+
+// Deepest object the walk descends into for a mapped path
+#define LOG_JSON_MAX_DEPTH 16
+
+// Longest dotted key path that can match
+#define LOG_JSON_MAX_PATH 256
+
+typedef enum {
+    LOG_JSON_TIMESTAMP = 0,
+    LOG_JSON_LEVEL,
+    LOG_JSON_MESSAGE,
+    LOG_JSON_HOST,
+    LOG_JSON_PROCESS,
+    LOG_JSON_PID,
+    LOG_JSON_SOURCE,
+    LOG_JSON_FIELD_COUNT
+} log_json_field_t;
+
+// One key path of a compiled mapping
+typedef struct {
+    const char* path;       // Dotted path in the mapping's strings (not NUL-terminated)
+    size_t length;
+    log_json_field_t field;
+    int priority;           // Position among the field's alternatives; lower wins
+} log_json_key_t;
+
+// Mapping split into key paths
+typedef struct {
+    log_json_key_t keys[LOG_JSON_MAX_KEYS];
+    size_t count;
+} log_json_keys_t;
+
+// Split a mapping into key paths; the paths point into the mapping's strings
+// mapping: NULL = log_json_mapping_init defaults
+// Returns 0 on success, -1 if the mapping has more than LOG_JSON_MAX_KEYS keys
+int log_json_keys_compile(const log_json_mapping_t* mapping, log_json_keys_t* keys);
+
+// Parse one JSON-lines record. The line is indexed for unescaped quotes
+// and structural characters outside strings (simdjson's first stage, 64
+// bytes at a time), and the index is then walked on demand: values of
+// unmapped keys are skipped over without being looked at, and objects are
+// only entered when a mapped path continues inside them. String values
+// are slices of the line; ones containing escapes are flagged in
+// view->escaped. Fields not found, and every field of a line that is not
+// a well-formed object, keep the values the view already holds.
+// Returns 0 if the line is a well-formed object, -1 otherwise
+int log_json_parse_line(const log_json_keys_t* keys, const char* line, size_t length, log_entry_view_t* view);
+
+// Decode the escape sequences of a JSON string body. dst needs length
+// bytes and may be src (decoding never lengthens the text).
+// Returns the decoded length
+size_t log_json_unescape(const char* src, size_t length, char* dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_LOGS_JSON_H
@@ -4,11 +4,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
 #include <ctype.h>
 #include <time.h>
+#include "libs/utils/tasks.h"
 
 // Helper function to duplicate string
 static char* strdup_safe(const char* str) {
@@ -20,68 +23,95 @@ static char* strdup_safe(const char* str) {
     return dup;
 }
 
-// Helper function to duplicate memory
-static void* memdup(const void* src, size_t size) {
-    if (!src || size == 0) return NULL;
-    void* dst = malloc(size);
-    if (dst) {
-        memcpy(dst, src, size);
-    }
-    return dst;
-}
-
-// Helper function to convert string to lowercase
-static void strtolower(char* str) {
-    if (!str) return;
-    for (int i = 0; str[i] != '\0'; i++) {
-        str[i] = tolower(str[i]);
-    }
-}
-
 void log_result_init(log_result_t* result) {
     if (result) {
         result->entries = NULL;
         result->count = 0;
         result->capacity = 0;
+        log_arena_init(&result->arena);
     }
 }
 
-int log_result_add_entry(log_result_t* result, const log_entry_t* entry) {
-    if (!result || !entry) {
-        return -1;
-    }
-    
+static log_entry_t* result_next_entry(log_result_t* result) {
     // Reallocate if needed
     if (result->count >= result->capacity) {
         size_t new_capacity = (result->capacity == 0) ? 16 : result->capacity * 2;
         log_entry_t* new_entries = (log_entry_t*)realloc(result->entries, new_capacity * sizeof(log_entry_t));
         if (!new_entries) {
-            return -1;
+            return NULL;
         }
         result->entries = new_entries;
         result->capacity = new_capacity;
     }
+    return &result->entries[result->count];
+}
+
+// Copy a string into the result's arena; NULL stays NULL
+static int arena_copy(log_arena_t* arena, const char* str, size_t length, char** out) {
+    if (!str) {
+        *out = NULL;
+        return 0;
+    }
+    *out = log_arena_strndup(arena, str, length);
+    return *out ? 0 : -1;
+}
+
+int log_result_add_entry(log_result_t* result, const log_entry_t* entry) {
+    if (!result || !entry) {
+        return -1;
+    }
+    
+    log_entry_t* new_entry = result_next_entry(result);
+    if (!new_entry) {
+        return -1;
+    }
     
     // Copy entry data
-    log_entry_t* new_entry = &result->entries[result->count];
+    log_arena_t* arena = &result->arena;
     new_entry->timestamp = entry->timestamp;
-    new_entry->source = strdup_safe(entry->source);
-    new_entry->level = strdup_safe(entry->level);
-    new_entry->message = strdup_safe(entry->message);
-    new_entry->host = strdup_safe(entry->host);
-    new_entry->process = strdup_safe(entry->process);
     new_entry->pid = entry->pid;
+    if (arena_copy(arena, entry->source, entry->source ? strlen(entry->source) : 0, &new_entry->source) != 0 ||
+        arena_copy(arena, entry->level, entry->level ? strlen(entry->level) : 0, &new_entry->level) != 0 ||
+        arena_copy(arena, entry->message, entry->message ? strlen(entry->message) : 0, &new_entry->message) != 0 ||
+        arena_copy(arena, entry->host, entry->host ? strlen(entry->host) : 0, &new_entry->host) != 0 ||
+        arena_copy(arena, entry->process, entry->process ? strlen(entry->process) : 0, &new_entry->process) != 0) {
+        return -1;
+    }
+    
+    result->count++;
+    return 0;
+}
+
+// Copy a view slice, decoding JSON escapes if it is flagged
+static int arena_copy_slice(log_arena_t* arena, const log_slice_t* slice, int escaped, char** out) {
+    if (arena_copy(arena, slice->ptr, slice->length, out) != 0) {
+        return -1;
+    }
+    if (escaped && *out) {
+        (*out)[log_json_unescape(*out, slice->length, *out)] = '\0';
+    }
+    return 0;
+}
+
+int log_result_add_view(log_result_t* result, const log_entry_view_t* view) {
+    if (!result || !view) {
+        return -1;
+    }
     
-    if ((!new_entry->source || !new_entry->level || !new_entry->message || 
-         !new_entry->host || !new_entry->process) && 
-        (entry->source || entry->level || entry->message || 
-         entry->host || entry->process)) {
-        // Clean up on failure
-        free(new_entry->source);
-        free(new_entry->level);
-        free(new_entry->message);
-        free(new_entry->host);
-        free(new_entry->process);
+    log_entry_t* new_entry = result_next_entry(result);
+    if (!new_entry) {
+        return -1;
+    }
+    
+    log_arena_t* arena = &result->arena;
+    const unsigned escaped = view->escaped;
+    new_entry->timestamp = view->timestamp;
+    new_entry->pid = view->pid;
+    if (arena_copy_slice(arena, &view->source, escaped & LOG_ESCAPED_SOURCE, &new_entry->source) != 0 ||
+        arena_copy_slice(arena, &view->level, escaped & LOG_ESCAPED_LEVEL, &new_entry->level) != 0 ||
+        arena_copy_slice(arena, &view->message, escaped & LOG_ESCAPED_MESSAGE, &new_entry->message) != 0 ||
+        arena_copy_slice(arena, &view->host, escaped & LOG_ESCAPED_HOST, &new_entry->host) != 0 ||
+        arena_copy_slice(arena, &view->process, escaped & LOG_ESCAPED_PROCESS, &new_entry->process) != 0) {
         return -1;
     }
     
@@ -91,16 +121,8 @@ int log_result_add_entry(log_result_t* result, const log_entry_t* entry) {
 
 void log_result_free(log_result_t* result) {
     if (result) {
-        if (result->entries) {
-            for (size_t i = 0; i < result->count; i++) {
-                free(result->entries[i].source);
-                free(result->entries[i].level);
-                free(result->entries[i].message);
-                free(result->entries[i].host);
-                free(result->entries[i].process);
-            }
-            free(result->entries);
-        }
+        free(result->entries);
+        log_arena_free(&result->arena);
         result->entries = NULL;
         result->count = 0;
         result->capacity = 0;
@@ -148,6 +170,36 @@ void log_statistics_free(log_statistics_t* stats) {
     }
 }
 
+// Map a whole file read-only; the mapping is read front to back
+static int map_file(const char* path, void** mapping, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    *mapping = map;
+    *size = (size_t)st.st_size;
+    return 0;
+}
+
+static size_t hardware_threads(size_t num_threads) {
+    if (num_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    return num_threads;
+}
+
 int log_parse_file(const char* path, log_format_t format, log_result_t* result) {
     if (!path || !result) {
         return -1;
@@ -155,89 +207,476 @@ int log_parse_file(const char* path, log_format_t format, log_result_t* result)
     
     log_result_init(result);
     
-    // Open file
-    FILE* file = fopen(path, "r");
-    if (!file) {
+    // Parse straight from the mapping: only entry strings are copied
+    void* map = NULL;
+    size_t size = 0;
+    if (map_file(path, &map, &size) != 0) {
         return -1;
     }
+    int ret = size >= LOG_PARALLEL_MIN_SIZE ? log_parse_data_parallel(map, size, format, 0, result)
+                                            : log_parse_data(map, size, format, result);
+    munmap(map, size);
     
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    return ret;
+}
+
+static int add_to_result(const log_entry_view_t* view, void* user_data) {
+    return log_result_add_view((log_result_t*)user_data, view) != 0 ? -1 : 0;
+}
+
+int log_parse_data(const void* data, size_t size, log_format_t format, log_result_t* result) {
+    if (!data || !result) {
+        return -1;
+    }
     
-    if (file_size <= 0) {
-        fclose(file);
+    log_result_init(result);
+    
+    return log_parse_lines((const char*)data, size, format, add_to_result, result) == 0 ? 0 : -1;
+}
+
+// Append parts[0..count) to result in order; the parts are emptied and
+// their arenas move into the result
+static int join_results(log_result_t* result, log_result_t* parts, size_t count) {
+    size_t total = result->count;
+    for (size_t k = 0; k < count; k++) {
+        total += parts[k].count;
+    }
+    if (total > result->capacity) {
+        log_entry_t* entries = (log_entry_t*)realloc(result->entries, total * sizeof(log_entry_t));
+        if (!entries) {
+            return -1;
+        }
+        result->entries = entries;
+        result->capacity = total;
+    }
+    for (size_t k = 0; k < count; k++) {
+        if (parts[k].count > 0) {
+            memcpy(result->entries + result->count, parts[k].entries, parts[k].count * sizeof(log_entry_t));
+            result->count += parts[k].count;
+        }
+        log_arena_adopt(&result->arena, &parts[k].arena);
+        log_result_free(&parts[k]);
+    }
+    return 0;
+}
+
+typedef struct {
+    const char* data;
+    log_format_t format;
+    const log_json_mapping_t* json_mapping;
+    time_t now;
+    const size_t* bounds;       // Chunk k is data[bounds[k] .. bounds[k + 1])
+    log_result_t* parts;
+} parse_job_t;
+
+static int parse_chunk_task(void* context, size_t worker, size_t k) {
+    parse_job_t* job = (parse_job_t*)context;
+    (void)worker;
+    log_parse_context_t parse_context;
+    log_parse_context_init(&parse_context, job->now);
+    if (job->json_mapping && log_parse_context_set_json_mapping(&parse_context, job->json_mapping) != 0) {
         return -1;
     }
+    return log_parse_chunk(&parse_context, job->data + job->bounds[k], job->bounds[k + 1] - job->bounds[k],
+                           job->format, k == 0, add_to_result, &job->parts[k]) == 0 ? 0 : -1;
+}
+
+static int parse_data_parallel(const char* text, size_t size, log_format_t format,
+                               const log_json_mapping_t* json_mapping, size_t num_threads, log_result_t* result) {
+    log_result_init(result);
+    num_threads = hardware_threads(num_threads);
     
-    // Allocate buffer
-    char* buffer = (char*)malloc(file_size + 1);
-    if (!buffer) {
-        fclose(file);
+    // A few chunks per thread balance uneven lines; each starts after a newline
+    size_t chunk_count = num_threads * 4;
+    if (chunk_count > size / LOG_MIN_CHUNK_SIZE) {
+        chunk_count = size / LOG_MIN_CHUNK_SIZE;
+    }
+    if (chunk_count <= 1) {
+        log_parse_context_t parse_context;
+        log_parse_context_init(&parse_context, time(NULL));
+        if (json_mapping && log_parse_context_set_json_mapping(&parse_context, json_mapping) != 0) {
+            return -1;
+        }
+        return log_parse_chunk(&parse_context, text, size, format, 1, add_to_result, result) == 0 ? 0 : -1;
+    }
+    
+    size_t* bounds = (size_t*)malloc((chunk_count + 1) * sizeof(size_t));
+    log_result_t* parts = (log_result_t*)calloc(chunk_count, sizeof(log_result_t));
+    if (!bounds || !parts) {
+        free(bounds);
+        free(parts);
         return -1;
     }
+    bounds[0] = 0;
+    for (size_t k = 1; k < chunk_count; k++) {
+        size_t target = size / chunk_count * k;
+        if (target < bounds[k - 1]) {
+            target = bounds[k - 1];
+        }
+        const char* nl = (const char*)memchr(text + target, '\n', size - target);
+        bounds[k] = nl ? (size_t)(nl - text) + 1 : size;
+    }
+    bounds[chunk_count] = size;
+    for (size_t k = 0; k < chunk_count; k++) {
+        log_result_init(&parts[k]);
+    }
     
-    // Read file
-    size_t bytes_read = fread(buffer, 1, file_size, file);
-    fclose(file);
+    parse_job_t job;
+    job.data = text;
+    job.format = format;
+    job.json_mapping = json_mapping;
+    job.now = time(NULL);
+    job.bounds = bounds;
+    job.parts = parts;
+    int ret = run_tasks(chunk_count, num_threads, RUN_TASKS_STOP_ON_FAILURE, parse_chunk_task, &job);
+    if (ret == 0) {
+        ret = join_results(result, parts, chunk_count);
+    }
     
-    if (bytes_read != (size_t)file_size) {
-        free(buffer);
+    for (size_t k = 0; k < chunk_count; k++) {
+        log_result_free(&parts[k]);
+    }
+    free(parts);
+    free(bounds);
+    return ret;
+}
+
+int log_parse_data_parallel(const void* data, size_t size, log_format_t format, size_t num_threads,
+                            log_result_t* result) {
+    if (!data || !result) {
         return -1;
     }
     
-    // Null terminate
-    buffer[bytes_read] = '\0';
+    return parse_data_parallel((const char*)data, size, format, NULL, num_threads, result);
+}
+
+int log_parse_file_parallel(const char* path, log_format_t format, size_t num_threads, log_result_t* result) {
+    if (!path || !result) {
+        return -1;
+    }
     
-    // Parse data
-    int ret = log_parse_data(buffer, bytes_read, format, result);
-    free(buffer);
+    log_result_init(result);
     
+    void* map = NULL;
+    size_t size = 0;
+    if (map_file(path, &map, &size) != 0) {
+        return -1;
+    }
+    int ret = log_parse_data_parallel(map, size, format, num_threads, result);
+    munmap(map, size);
     return ret;
 }
 
-int log_parse_data(const void* data, size_t size, log_format_t format, log_result_t* result) {
+int log_parse_json_data(const void* data, size_t size, const log_json_mapping_t* mapping, size_t num_threads,
+                        log_result_t* result) {
     if (!data || !result) {
         return -1;
     }
     
+    return parse_data_parallel((const char*)data, size, LOG_FORMAT_JSON, mapping, num_threads, result);
+}
+
+int log_parse_json_file(const char* path, const log_json_mapping_t* mapping, size_t num_threads,
+                        log_result_t* result) {
+    if (!path || !result) {
+        return -1;
+    }
+    
     log_result_init(result);
     
-    // Convert data to string
-    char* str_data = (char*)memdup(data, size);
-    if (!str_data) {
+    void* map = NULL;
+    size_t size = 0;
+    if (map_file(path, &map, &size) != 0) {
+        return -1;
+    }
+    int ret = log_parse_json_data(map, size, mapping, num_threads, result);
+    munmap(map, size);
+    return ret;
+}
+
+// Stable sort by timestamp (bottom-up merge sort); logs are usually in
+// order already, so check first
+static int sort_by_time(log_entry_t* entries, size_t count) {
+    size_t i = 1;
+    while (i < count && entries[i - 1].timestamp <= entries[i].timestamp) {
+        i++;
+    }
+    if (i >= count) {
+        return 0;
+    }
+    log_entry_t* buffer = (log_entry_t*)malloc(count * sizeof(log_entry_t));
+    if (!buffer) {
+        return -1;
+    }
+    log_entry_t* src = entries;
+    log_entry_t* dst = buffer;
+    for (size_t width = 1; width < count; width *= 2) {
+        for (size_t lo = 0; lo < count; lo += 2 * width) {
+            const size_t mid = lo + width < count ? lo + width : count;
+            const size_t hi = lo + 2 * width < count ? lo + 2 * width : count;
+            size_t a = lo, b = mid, out = lo;
+            while (a < mid && b < hi) {
+                dst[out++] = src[b].timestamp < src[a].timestamp ? src[b++] : src[a++];
+            }
+            while (a < mid) dst[out++] = src[a++];
+            while (b < hi) dst[out++] = src[b++];
+        }
+        log_entry_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != entries) {
+        memcpy(entries, src, count * sizeof(log_entry_t));
+    }
+    free(buffer);
+    return 0;
+}
+
+typedef struct {
+    const char* const* paths;
+    log_format_t format;
+    size_t threads_per_file;
+    log_result_t* parts;
+} files_job_t;
+
+static int parse_file_task(void* context, size_t worker, size_t k) {
+    files_job_t* job = (files_job_t*)context;
+    (void)worker;
+    if (log_parse_file_parallel(job->paths[k], job->format, job->threads_per_file, &job->parts[k]) != 0) {
+        return -1;
+    }
+    return sort_by_time(job->parts[k].entries, job->parts[k].count);
+}
+
+// Heap of the next entry of each file, earliest first (then lowest file)
+typedef struct {
+    time_t timestamp;
+    size_t file;
+} merge_head_t;
+
+static int head_before(const merge_head_t* a, const merge_head_t* b) {
+    return a->timestamp < b->timestamp || (a->timestamp == b->timestamp && a->file < b->file);
+}
+
+static void heap_sift_down(merge_head_t* heap, size_t count, size_t i) {
+    for (;;) {
+        size_t smallest = i;
+        const size_t left = 2 * i + 1, right = 2 * i + 2;
+        if (left < count && head_before(&heap[left], &heap[smallest])) smallest = left;
+        if (right < count && head_before(&heap[right], &heap[smallest])) smallest = right;
+        if (smallest == i) {
+            return;
+        }
+        merge_head_t swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+int log_parse_files(const char* const* paths, size_t count, log_format_t format, size_t num_threads,
+                    log_result_t* result) {
+    if (!paths || !result) {
         return -1;
     }
-    str_data[size] = '\0';
     
-    // Parse based on format
-    int ret = -1;
-    switch (format) {
-        case LOG_FORMAT_SYSLOG:
-            ret = log_parse_syslog(str_data, result);
-            break;
-        case LOG_FORMAT_APACHE:
-            ret = log_parse_apache(str_data, result);
-            break;
-        case LOG_FORMAT_NGINX:
-            ret = log_parse_nginx(str_data, result);
-            break;
-        case LOG_FORMAT_JSON:
-            ret = log_parse_json(str_data, result);
-            break;
-        case LOG_FORMAT_CSV:
-            ret = log_parse_csv(str_data, result);
-            break;
-        default:
-            ret = log_parse_custom(str_data, result);
-            break;
+    log_result_init(result);
+    if (count == 0) {
+        return 0;
+    }
+    num_threads = hardware_threads(num_threads);
+    
+    log_result_t* parts = (log_result_t*)calloc(count, sizeof(log_result_t));
+    size_t* positions = (size_t*)calloc(count, sizeof(size_t));
+    merge_head_t* heap = (merge_head_t*)malloc(count * sizeof(merge_head_t));
+    if (!parts || !positions || !heap) {
+        free(parts);
+        free(positions);
+        free(heap);
+        return -1;
+    }
+    for (size_t k = 0; k < count; k++) {
+        log_result_init(&parts[k]);
+    }
+    
+    // Files in parallel, and the threads left over inside each file
+    files_job_t job;
+    job.paths = paths;
+    job.format = format;
+    job.threads_per_file = num_threads > count ? num_threads / count : 1;
+    job.parts = parts;
+    int ret = run_tasks(count, num_threads, RUN_TASKS_STOP_ON_FAILURE, parse_file_task, &job);
+    
+    size_t total = 0;
+    for (size_t k = 0; k < count; k++) {
+        total += parts[k].count;
+    }
+    if (ret == 0 && total > 0) {
+        result->entries = (log_entry_t*)malloc(total * sizeof(log_entry_t));
+        ret = result->entries ? 0 : -1;
+    }
+    if (ret == 0 && total > 0) {
+        result->capacity = total;
+        
+        size_t heap_count = 0;
+        for (size_t k = 0; k < count; k++) {
+            if (parts[k].count > 0) {
+                heap[heap_count].timestamp = parts[k].entries[0].timestamp;
+                heap[heap_count].file = k;
+                heap_count++;
+            }
+        }
+        for (size_t i = heap_count; i-- > 0;) {
+            heap_sift_down(heap, heap_count, i);
+        }
+        while (heap_count > 0) {
+            const size_t k = heap[0].file;
+            result->entries[result->count++] = parts[k].entries[positions[k]++];
+            if (positions[k] < parts[k].count) {
+                heap[0].timestamp = parts[k].entries[positions[k]].timestamp;
+            } else {
+                heap[0] = heap[--heap_count];
+            }
+            heap_sift_down(heap, heap_count, 0);
+        }
     }
     
-    free(str_data);
+    // Entry strings stay where they are: the result takes the arenas
+    for (size_t k = 0; k < count; k++) {
+        if (ret == 0) {
+            log_arena_adopt(&result->arena, &parts[k].arena);
+        }
+        log_result_free(&parts[k]);
+    }
+    free(parts);
+    free(positions);
+    free(heap);
+    if (ret != 0) {
+        log_result_free(result);
+    }
     return ret;
 }
 
+void log_view_init(log_view_t* view) {
+    if (view) {
+        memset(view, 0, sizeof(log_view_t));
+    }
+}
+
+static int add_to_view(const log_entry_view_t* entry, void* user_data) {
+    log_view_t* view = (log_view_t*)user_data;
+    if (view->count >= view->capacity) {
+        size_t new_capacity = (view->capacity == 0) ? 1024 : view->capacity * 2;
+        log_entry_view_t* new_entries = (log_entry_view_t*)realloc(view->entries, new_capacity * sizeof(log_entry_view_t));
+        if (!new_entries) {
+            return -1;
+        }
+        view->entries = new_entries;
+        view->capacity = new_capacity;
+    }
+    view->entries[view->count++] = *entry;
+    return 0;
+}
+
+int log_view_parse_data(const void* data, size_t size, log_format_t format, log_view_t* view) {
+    if (!data || !view) {
+        return -1;
+    }
+    
+    log_view_init(view);
+    view->data = (const char*)data;
+    view->size = size;
+    if (log_parse_lines(view->data, size, format, add_to_view, view) != 0) {
+        log_view_free(view);
+        return -1;
+    }
+    return 0;
+}
+
+int log_view_parse_file(const char* path, log_format_t format, log_view_t* view) {
+    if (!path || !view) {
+        return -1;
+    }
+    
+    log_view_init(view);
+    void* map = NULL;
+    size_t size = 0;
+    if (map_file(path, &map, &size) != 0) {
+        return -1;
+    }
+    if (log_view_parse_data(map, size, format, view) != 0) {
+        munmap(map, size);
+        return -1;
+    }
+    view->mapping = map;
+    view->mapping_size = size;
+    return 0;
+}
+
+void log_view_free(log_view_t* view) {
+    if (view) {
+        free(view->entries);
+        if (view->mapping) {
+            munmap(view->mapping, view->mapping_size);
+        }
+        memset(view, 0, sizeof(log_view_t));
+    }
+}
+
+// Case-insensitive substring test
+static int contains_nocase(const char* haystack, const char* needle) {
+    const size_t n = strlen(needle);
+    for (;; haystack++) {
+        size_t k = 0;
+        while (k < n && haystack[k] && tolower((unsigned char)haystack[k]) == tolower((unsigned char)needle[k])) {
+            k++;
+        }
+        if (k == n) {
+            return 1;
+        }
+        if (!*haystack) {
+            return 0;
+        }
+    }
+}
+
+int log_filter_match(const log_filter_t* filter, const log_entry_t* entry) {
+    if (!filter || !entry) {
+        return 0;
+    }
+    
+    // Time filter
+    if (filter->start_time > 0 && entry->timestamp < filter->start_time) {
+        return 0;
+    }
+    if (filter->end_time > 0 && entry->timestamp > filter->end_time) {
+        return 0;
+    }
+    
+    // Field filters; entries without the field pass
+    if ((filter->source_filter && entry->source && !contains_nocase(entry->source, filter->source_filter)) ||
+        (filter->level_filter && entry->level && !contains_nocase(entry->level, filter->level_filter)) ||
+        (filter->host_filter && entry->host && !contains_nocase(entry->host, filter->host_filter)) ||
+        (filter->process_filter && entry->process && !contains_nocase(entry->process, filter->process_filter)) ||
+        (filter->keyword_filter && entry->message && !contains_nocase(entry->message, filter->keyword_filter))) {
+        return 0;
+    }
+    
+    // Level type filters
+    if (entry->level) {
+        if (contains_nocase(entry->level, "error") || contains_nocase(entry->level, "fatal")) {
+            return filter->include_errors;
+        } else if (contains_nocase(entry->level, "warn")) {
+            return filter->include_warnings;
+        } else if (contains_nocase(entry->level, "info")) {
+            return filter->include_info;
+        } else if (contains_nocase(entry->level, "debug")) {
+            return filter->include_debug;
+        }
+    }
+    return 1;
+}
+
 int log_filter_entries(const log_result_t* input, const log_filter_t* filter, log_result_t* output) {
     if (!input || !filter || !output) {
         return -1;
@@ -247,132 +686,104 @@ int log_filter_entries(const log_result_t* input, const log_filter_t* filter, lo
     
     // Apply filter to each entry
     for (size_t i = 0; i < input->count; i++) {
-        const log_entry_t* entry = &input->entries[i];
-        int include = 1;
-        
-        // Time filter
-        if (filter->start_time > 0 && entry->timestamp < filter->start_time) {
-            include = 0;
+        if (log_filter_match(filter, &input->entries[i])) {
+            log_result_add_entry(output, &input->entries[i]);
         }
-        if (filter->end_time > 0 && entry->timestamp > filter->end_time) {
-            include = 0;
-        }
-        
-        // Source filter
-        if (include && filter->source_filter && entry->source) {
-            char* entry_source = strdup_safe(entry->source);
-            if (entry_source) {
-                strtolower(entry_source);
-                char* filter_source = strdup_safe(filter->source_filter);
-                if (filter_source) {
-                    strtolower(filter_source);
-                    if (strstr(entry_source, filter_source) == NULL) {
-                        include = 0;
-                    }
-                    free(filter_source);
-                }
-                free(entry_source);
-            }
+    }
+    
+    return 0;
+}
+
+// Case-insensitive substring test; needle must be lower case
+static int contains_lower(const char* haystack, const char* needle) {
+    const size_t n = strlen(needle);
+    for (; *haystack; haystack++) {
+        size_t k = 0;
+        while (k < n && haystack[k] && tolower((unsigned char)haystack[k]) == needle[k]) {
+            k++;
         }
-        
-        // Level filter
-        if (include && filter->level_filter && entry->level) {
-            char* entry_level = strdup_safe(entry->level);
-            if (entry_level) {
-                strtolower(entry_level);
-                char* filter_level = strdup_safe(filter->level_filter);
-                if (filter_level) {
-                    strtolower(filter_level);
-                    if (strstr(entry_level, filter_level) == NULL) {
-                        include = 0;
-                    }
-                    free(filter_level);
-                }
-                free(entry_level);
-            }
+        if (k == n) {
+            return 1;
         }
-        
-        // Host filter
-        if (include && filter->host_filter && entry->host) {
-            char* entry_host = strdup_safe(entry->host);
-            if (entry_host) {
-                strtolower(entry_host);
-                char* filter_host = strdup_safe(filter->host_filter);
-                if (filter_host) {
-                    strtolower(filter_host);
-                    if (strstr(entry_host, filter_host) == NULL) {
-                        include = 0;
-                    }
-                    free(filter_host);
-                }
-                free(entry_host);
-            }
+    }
+    return 0;
+}
+
+// Statistics of a range of entries; sources point into the result
+typedef struct {
+    size_t error_count;
+    size_t warning_count;
+    size_t info_count;
+    size_t debug_count;
+    time_t first_timestamp;
+    time_t last_timestamp;
+    const char* sources[LOG_STATS_MAX_SOURCES];
+    size_t source_count;
+} stats_partial_t;
+
+// Add a source unless it is known or the list is full
+static void partial_add_source(stats_partial_t* partial, const char* source) {
+    if (partial->source_count >= LOG_STATS_MAX_SOURCES) {
+        return;
+    }
+    for (size_t j = 0; j < partial->source_count; j++) {
+        if (strcmp(partial->sources[j], source) == 0) {
+            return;
         }
+    }
+    partial->sources[partial->source_count++] = source;
+}
+
+typedef struct {
+    const log_result_t* result;
+    size_t range_size;
+    stats_partial_t* partials;
+} stats_job_t;
+
+static int stats_task(void* context, size_t worker, size_t k) {
+    stats_job_t* job = (stats_job_t*)context;
+    (void)worker;
+    stats_partial_t* partial = &job->partials[k];
+    memset(partial, 0, sizeof(*partial));
+    partial->first_timestamp = -1;
+    partial->last_timestamp = -1;
+    
+    const size_t begin = k * job->range_size;
+    const size_t end = begin + job->range_size < job->result->count ? begin + job->range_size : job->result->count;
+    for (size_t i = begin; i < end; i++) {
+        const log_entry_t* entry = &job->result->entries[i];
         
-        // Process filter
-        if (include && filter->process_filter && entry->process) {
-            char* entry_process = strdup_safe(entry->process);
-            if (entry_process) {
-                strtolower(entry_process);
-                char* filter_process = strdup_safe(filter->process_filter);
-                if (filter_process) {
-                    strtolower(filter_process);
-                    if (strstr(entry_process, filter_process) == NULL) {
-                        include = 0;
-                    }
-                    free(filter_process);
-                }
-                free(entry_process);
-            }
+        // Update timestamps
+        if (partial->first_timestamp == -1 || entry->timestamp < partial->first_timestamp) {
+            partial->first_timestamp = entry->timestamp;
         }
-        
-        // Keyword filter
-        if (include && filter->keyword_filter && entry->message) {
-            char* entry_message = strdup_safe(entry->message);
-            if (entry_message) {
-                strtolower(entry_message);
-                char* filter_keyword = strdup_safe(filter->keyword_filter);
-                if (filter_keyword) {
-                    strtolower(filter_keyword);
-                    if (strstr(entry_message, filter_keyword) == NULL) {
-                        include = 0;
-                    }
-                    free(filter_keyword);
-                }
-                free(entry_message);
-            }
+        if (partial->last_timestamp == -1 || entry->timestamp > partial->last_timestamp) {
+            partial->last_timestamp = entry->timestamp;
         }
         
-        // Level type filters
-        if (include && entry->level) {
-            char* level = strdup_safe(entry->level);
-            if (level) {
-                strtolower(level);
-                
-                if (strstr(level, "error") || strstr(level, "fatal")) {
-                    include = filter->include_errors;
-                } else if (strstr(level, "warn")) {
-                    include = filter->include_warnings;
-                } else if (strstr(level, "info")) {
-                    include = filter->include_info;
-                } else if (strstr(level, "debug")) {
-                    include = filter->include_debug;
-                }
-                
-                free(level);
+        // Count by level
+        if (entry->level) {
+            if (contains_lower(entry->level, "error") || contains_lower(entry->level, "fatal")) {
+                partial->error_count++;
+            } else if (contains_lower(entry->level, "warn")) {
+                partial->warning_count++;
+            } else if (contains_lower(entry->level, "info")) {
+                partial->info_count++;
+            } else if (contains_lower(entry->level, "debug")) {
+                partial->debug_count++;
             }
         }
         
-        // Add to output if included
-        if (include) {
-            log_result_add_entry(output, entry);
+        // A range's first sources include every source among the overall
+        // first ones that first appears in it, so the reduction is exact
+        if (entry->source) {
+            partial_add_source(partial, entry->source);
         }
     }
-    
     return 0;
 }
 
-int log_get_statistics(const log_result_t* result, log_statistics_t* stats) {
+int log_get_statistics_parallel(const log_result_t* result, size_t num_threads, log_statistics_t* stats) {
     if (!result || !stats) {
         return -1;
     }
@@ -380,62 +791,119 @@ int log_get_statistics(const log_result_t* result, log_statistics_t* stats) {
     log_statistics_init(stats);
     
     stats->total_entries = result->count;
+    if (result->count == 0) {
+        return 0;
+    }
     
-    // Process each entry
-    for (size_t i = 0; i < result->count; i++) {
-        const log_entry_t* entry = &result->entries[i];
-        
-        // Update timestamps
-        if (stats->first_timestamp == -1 || entry->timestamp < stats->first_timestamp) {
-            stats->first_timestamp = entry->timestamp;
+    num_threads = hardware_threads(num_threads);
+    size_t range_count = num_threads * 4 < result->count ? num_threads * 4 : result->count;
+    stats_job_t job;
+    job.result = result;
+    job.range_size = (result->count + range_count - 1) / range_count;
+    range_count = (result->count + job.range_size - 1) / job.range_size;
+    job.partials = (stats_partial_t*)malloc(range_count * sizeof(stats_partial_t));
+    if (!job.partials) {
+        return -1;
+    }
+    run_tasks(range_count, num_threads, RUN_TASKS_STOP_ON_FAILURE, stats_task, &job);
+    
+    // Reduce in order
+    stats_partial_t total;
+    memset(&total, 0, sizeof(total));
+    total.first_timestamp = -1;
+    total.last_timestamp = -1;
+    for (size_t k = 0; k < range_count; k++) {
+        const stats_partial_t* partial = &job.partials[k];
+        total.error_count += partial->error_count;
+        total.warning_count += partial->warning_count;
+        total.info_count += partial->info_count;
+        total.debug_count += partial->debug_count;
+        if (partial->first_timestamp != -1 &&
+            (total.first_timestamp == -1 || partial->first_timestamp < total.first_timestamp)) {
+            total.first_timestamp = partial->first_timestamp;
         }
-        if (stats->last_timestamp == -1 || entry->timestamp > stats->last_timestamp) {
-            stats->last_timestamp = entry->timestamp;
+        if (partial->last_timestamp != -1 &&
+            (total.last_timestamp == -1 || partial->last_timestamp > total.last_timestamp)) {
+            total.last_timestamp = partial->last_timestamp;
         }
-        
-        // Count by level
-        if (entry->level) {
-            char* level = strdup_safe(entry->level);
-            if (level) {
-                strtolower(level);
-                
-                if (strstr(level, "error") || strstr(level, "fatal")) {
-                    stats->error_count++;
-                } else if (strstr(level, "warn")) {
-                    stats->warning_count++;
-                } else if (strstr(level, "info")) {
-                    stats->info_count++;
-                } else if (strstr(level, "debug")) {
-                    stats->debug_count++;
-                }
-                
-                free(level);
+        for (size_t j = 0; j < partial->source_count; j++) {
+            partial_add_source(&total, partial->sources[j]);
+        }
+    }
+    free(job.partials);
+    
+    stats->error_count = total.error_count;
+    stats->warning_count = total.warning_count;
+    stats->info_count = total.info_count;
+    stats->debug_count = total.debug_count;
+    stats->first_timestamp = total.first_timestamp;
+    stats->last_timestamp = total.last_timestamp;
+    if (total.source_count > 0) {
+        stats->top_sources = (char**)calloc(LOG_STATS_MAX_SOURCES, sizeof(char*));
+        if (!stats->top_sources) {
+            return -1;
+        }
+        for (size_t j = 0; j < total.source_count; j++) {
+            stats->top_sources[stats->source_count] = strdup_safe(total.sources[j]);
+            if (stats->top_sources[stats->source_count]) {
+                stats->source_count++;
             }
         }
-        
-        // Track sources (simplified - in a real implementation, this would be more sophisticated)
-        if (entry->source && stats->source_count < 10) { // Limit to 10 sources for simplicity
-            int found = 0;
-            for (size_t j = 0; j < stats->source_count; j++) {
-                if (strcmp(stats->top_sources[j], entry->source) == 0) {
-                    found = 1;
-                    break;
-                }
+    }
+    
+    return 0;
+}
+
+int log_get_statistics(const log_result_t* result, log_statistics_t* stats) {
+    if (!result) {
+        return -1;
+    }
+    return log_get_statistics_parallel(result, result->count >= LOG_PARALLEL_MIN_ENTRIES ? 0 : 1, stats);
+}
+
+int log_statistics_add_entry(log_statistics_t* stats, const log_entry_t* entry) {
+    if (!stats || !entry) {
+        return -1;
+    }
+    
+    stats->total_entries++;
+    if (stats->first_timestamp == -1 || entry->timestamp < stats->first_timestamp) {
+        stats->first_timestamp = entry->timestamp;
+    }
+    if (stats->last_timestamp == -1 || entry->timestamp > stats->last_timestamp) {
+        stats->last_timestamp = entry->timestamp;
+    }
+    
+    if (entry->level) {
+        if (contains_lower(entry->level, "error") || contains_lower(entry->level, "fatal")) {
+            stats->error_count++;
+        } else if (contains_lower(entry->level, "warn")) {
+            stats->warning_count++;
+        } else if (contains_lower(entry->level, "info")) {
+            stats->info_count++;
+        } else if (contains_lower(entry->level, "debug")) {
+            stats->debug_count++;
+        }
+    }
+    
+    if (entry->source && stats->source_count < LOG_STATS_MAX_SOURCES) {
+        for (size_t j = 0; j < stats->source_count; j++) {
+            if (strcmp(stats->top_sources[j], entry->source) == 0) {
+                return 0;
             }
-            
-            if (!found) {
-                char** new_sources = (char**)realloc(stats->top_sources, (stats->source_count + 1) * sizeof(char*));
-                if (new_sources) {
-                    stats->top_sources = new_sources;
-                    stats->top_sources[stats->source_count] = strdup_safe(entry->source);
-                    if (stats->top_sources[stats->source_count]) {
-                        stats->source_count++;
-                    }
-                }
+        }
+        if (!stats->top_sources) {
+            stats->top_sources = (char**)calloc(LOG_STATS_MAX_SOURCES, sizeof(char*));
+            if (!stats->top_sources) {
+                return -1;
             }
         }
+        stats->top_sources[stats->source_count] = strdup_safe(entry->source);
+        if (!stats->top_sources[stats->source_count]) {
+            return -1;
+        }
+        stats->source_count++;
     }
-    
     return 0;
 }
 
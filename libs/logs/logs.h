@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <time.h>
+#include "arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,13 +21,66 @@ typedef struct {
     int pid;
 } log_entry_t;
 
-// Log analysis result
+// Log analysis result. Entry strings live in the arena and are released
+// together by log_result_free.
 typedef struct {
     log_entry_t* entries;
     size_t count;
     size_t capacity;
+    log_arena_t arena;
 } log_result_t;
 
+// Files at least this large are parsed on all hardware threads by log_parse_file
+#define LOG_PARALLEL_MIN_SIZE (8 * 1024 * 1024)
+
+// Smallest newline-aligned chunk handed to one thread
+#define LOG_MIN_CHUNK_SIZE (1024 * 1024)
+
+// Results at least this large get statistics on all hardware threads
+#define LOG_PARALLEL_MIN_ENTRIES (256 * 1024)
+
+// Statistics keep the first sources seen, in order
+#define LOG_STATS_MAX_SOURCES 10
+
+// Borrowed run of bytes (not NUL-terminated)
+typedef struct {
+    const char* ptr;
+    size_t length;
+} log_slice_t;
+
+// log_entry_view_t.escaped bits: the slice is the body of a JSON string
+// whose escape sequences are still encoded
+#define LOG_ESCAPED_SOURCE 0x01
+#define LOG_ESCAPED_LEVEL 0x02
+#define LOG_ESCAPED_MESSAGE 0x04
+#define LOG_ESCAPED_HOST 0x08
+#define LOG_ESCAPED_PROCESS 0x10
+
+// Log entry whose strings are slices of the parsed text (or of static
+// strings for fields a format does not carry)
+typedef struct {
+    time_t timestamp;
+    log_slice_t source;
+    log_slice_t level;
+    log_slice_t message;
+    log_slice_t host;
+    log_slice_t process;
+    int pid;
+    unsigned escaped;       // LOG_ESCAPED_* bits; decoded when copied into a result
+} log_entry_view_t;
+
+// Zero-copy parse: entries are slices into the parsed text, which is a
+// read-only mapping of the file or the caller's buffer
+typedef struct {
+    log_entry_view_t* entries;
+    size_t count;
+    size_t capacity;
+    const char* data;       // Text the slices point into
+    size_t size;
+    void* mapping;          // Mapped file (NULL for borrowed data)
+    size_t mapping_size;
+} log_view_t;
+
 // Log filter criteria
 typedef struct {
     time_t start_time;
@@ -42,6 +96,20 @@ typedef struct {
     int include_debug;       // Include DEBUG logs
 } log_filter_t;
 
+// Keys of the JSON fields that make up a log entry. Each is a
+// comma-separated list of alternatives, the first one present winning;
+// dots descend into nested objects ("jsonPayload.message"). NULL or ""
+// leaves the field at its default.
+typedef struct {
+    const char* timestamp;  // Epoch seconds/ms/us/ns, or an ISO 8601 string
+    const char* level;      // Numeric (pino/bunyan) levels are named
+    const char* message;    // Default: the whole line
+    const char* host;
+    const char* process;
+    const char* pid;
+    const char* source;
+} log_json_mapping_t;
+
 // Log statistics
 typedef struct {
     size_t total_entries;
@@ -74,6 +142,9 @@ int log_result_add_entry(log_result_t* result, const log_entry_t* entry);
 // Free log result
 void log_result_free(log_result_t* result);
 
+// Copy a view entry into the result (strings go to the result's arena)
+int log_result_add_view(log_result_t* result, const log_entry_view_t* view);
+
 // Initialize log filter with default values
 void log_filter_init(log_filter_t* filter);
 
@@ -86,13 +157,37 @@ void log_statistics_init(log_statistics_t* stats);
 // Free log statistics
 void log_statistics_free(log_statistics_t* stats);
 
-// Parse log file
+// Parse log file (memory-mapped; large files are parsed in parallel)
 // path: path to the log file
 // format: log format
 // result: output log result (must be freed with log_result_free)
 // Returns 0 on success, non-zero on error
 int log_parse_file(const char* path, log_format_t format, log_result_t* result);
 
+// Parse log data on a pool of threads. The data is split into
+// newline-aligned chunks; each thread parses chunks into its own result,
+// and the results are joined in order, so the entries are the same as a
+// serial parse.
+// num_threads: 0 = hardware threads
+// Returns 0 on success, non-zero on error
+int log_parse_data_parallel(const void* data, size_t size, log_format_t format, size_t num_threads,
+                            log_result_t* result);
+
+// Parse a memory-mapped log file on a pool of threads (see log_parse_data_parallel)
+// Returns 0 on success, non-zero on error
+int log_parse_file_parallel(const char* path, log_format_t format, size_t num_threads, log_result_t* result);
+
+// Parse several log files of one format and merge them by timestamp. Each
+// file is parsed in parallel and brought into time order (stably) if it
+// is not already; the files are then merged k-way, ties going to the
+// earlier file.
+// paths: files to parse (all must parse)
+// num_threads: 0 = hardware threads
+// result: output log result (must be freed with log_result_free)
+// Returns 0 on success, non-zero on error
+int log_parse_files(const char* const* paths, size_t count, log_format_t format, size_t num_threads,
+                    log_result_t* result);
+
 // Parse log data from memory
 // data: pointer to log data
 // size: size of log data in bytes
@@ -101,6 +196,49 @@ int log_parse_file(const char* path, log_format_t format, log_result_t* result);
 // Returns 0 on success, non-zero on error
 int log_parse_data(const void* data, size_t size, log_format_t format, log_result_t* result);
 
+// Initialize a JSON mapping with the keys common in application and
+// cloud-exported logs
+void log_json_mapping_init(log_json_mapping_t* mapping);
+
+// Parse JSON-lines (NDJSON) data with a field mapping. Each line is
+// indexed 64 bytes at a time for quotes and structural characters, and
+// only the mapped fields are extracted; lines that are not JSON objects
+// become entries whose message is the whole line.
+// mapping: field mapping (NULL = log_json_mapping_init defaults); its
+//          strings must outlive the call
+// num_threads: 0 = hardware threads, 1 = parse serially
+// result: output log result (must be freed with log_result_free)
+// Returns 0 on success, non-zero on error
+int log_parse_json_data(const void* data, size_t size, const log_json_mapping_t* mapping, size_t num_threads,
+                        log_result_t* result);
+
+// Parse a memory-mapped JSON-lines file (see log_parse_json_data)
+// Returns 0 on success, non-zero on error
+int log_parse_json_file(const char* path, const log_json_mapping_t* mapping, size_t num_threads,
+                        log_result_t* result);
+
+// Initialize log view
+void log_view_init(log_view_t* view);
+
+// Parse log file without copying it: the file is memory-mapped and the
+// entries are slices of the mapping, valid until log_view_free
+// path: path to the log file
+// format: log format
+// view: output log view (must be freed with log_view_free)
+// Returns 0 on success, non-zero on error
+int log_view_parse_file(const char* path, log_format_t format, log_view_t* view);
+
+// Parse log data from memory without copying it; data must outlive the view
+// Returns 0 on success, non-zero on error
+int log_view_parse_data(const void* data, size_t size, log_format_t format, log_view_t* view);
+
+// Free log view (and unmap its file)
+void log_view_free(log_view_t* view);
+
+// Test one entry against a filter, as log_filter_entries does
+// Returns 1 if the entry passes, 0 otherwise
+int log_filter_match(const log_filter_t* filter, const log_entry_t* entry);
+
 // Filter log entries
 // input: input log result
 // filter: filter criteria
@@ -108,12 +246,25 @@ int log_parse_data(const void* data, size_t size, log_format_t format, log_resul
 // Returns 0 on success, non-zero on error
 int log_filter_entries(const log_result_t* input, const log_filter_t* filter, log_result_t* output);
 
-// Get log statistics
+// Get log statistics (in parallel for large results)
 // result: log result to analyze
 // stats: output log statistics (must be freed with log_statistics_free)
 // Returns 0 on success, non-zero on error
 int log_get_statistics(const log_result_t* result, log_statistics_t* stats);
 
+// Get log statistics on a pool of threads: each computes a partial over a
+// range of entries and the partials are reduced in order, which gives the
+// same statistics as log_get_statistics
+// num_threads: 0 = hardware threads
+// Returns 0 on success, non-zero on error
+int log_get_statistics_parallel(const log_result_t* result, size_t num_threads, log_statistics_t* stats);
+
+// Add one entry to statistics. Adding the entries of a result in order
+// gives the statistics log_get_statistics computes for it.
+// stats: statistics from log_statistics_init or log_get_statistics
+// Returns 0 on success, non-zero on error
+int log_statistics_add_entry(log_statistics_t* stats, const log_entry_t* entry);
+
 // Search for keywords in log entries
 // result: log result to search
 // keyword: keyword to search for
@@ -4,362 +4,439 @@
 #include <stdio.h>
 #include <time.h>
 #include <ctype.h>
+#include <pthread.h>
 
-// Parse a single syslog line
-static int parse_syslog_line(const char* line, log_entry_t* entry) {
-    if (!line || !entry) {
-        return -1;
-    }
-    
-    // Initialize entry
-    memset(entry, 0, sizeof(log_entry_t));
-    
-    // Example syslog format: "Jan  1 00:00:00 hostname process[pid]: message"
-    // This is a simplified parser
-    
-    // Parse timestamp (first 15 characters)
-    char timestamp_str[16];
-    strncpy(timestamp_str, line, 15);
-    timestamp_str[15] = '\0';
-    
-    // For simplicity, we'll just set current time
-    entry->timestamp = time(NULL);
-    
-    // Parse hostname (after timestamp)
-    const char* hostname_start = line + 16;
-    const char* hostname_end = strchr(hostname_start, ' ');
-    if (hostname_end) {
-        size_t hostname_len = hostname_end - hostname_start;
-        entry->host = (char*)malloc(hostname_len + 1);
-        if (entry->host) {
-            strncpy(entry->host, hostname_start, hostname_len);
-            entry->host[hostname_len] = '\0';
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOGS_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define SCAN_BLOCK 64
+
+static unsigned first_set_bit64(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(mask);
+#else
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (unsigned)index;
+#endif
+}
+
+// Bit i set where p[i] is a newline, for i < length (at most 64)
+static uint64_t newline_mask(const char* p, size_t length) {
+    uint64_t mask = 0;
+    size_t i = 0;
+#ifdef LOGS_SSE2
+    if (length == SCAN_BLOCK) {
+        const __m128i nl = _mm_set1_epi8('\n');
+        for (; i < SCAN_BLOCK; i += 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            mask |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) << i;
         }
-        
-        // Parse process name and PID
-        const char* process_start = hostname_end + 1;
-        const char* process_end = strchr(process_start, ':');
-        if (process_end) {
-            size_t process_len = process_end - process_start;
-            entry->process = (char*)malloc(process_len + 1);
-            if (entry->process) {
-                strncpy(entry->process, process_start, process_len);
-                entry->process[process_len] = '\0';
-                
-                // Try to extract PID from process[pid] format
-                char* pid_start = strchr(entry->process, '[');
-                if (pid_start) {
-                    char* pid_end = strchr(pid_start, ']');
-                    if (pid_end) {
-                        *pid_end = '\0';
-                        entry->pid = atoi(pid_start + 1);
-                        *pid_start = '\0'; // Truncate process name
-                    }
-                }
+        return mask;
+    }
+#endif
+    for (; i < length; i++) {
+        mask |= (uint64_t)(p[i] == '\n') << i;
+    }
+    return mask;
+}
+
+void log_line_scanner_init(log_line_scanner_t* scanner, const char* data, size_t size) {
+    if (scanner) {
+        memset(scanner, 0, sizeof(log_line_scanner_t));
+        scanner->data = data;
+        scanner->size = data ? size : 0;
+    }
+}
+
+int log_line_scanner_next(log_line_scanner_t* scanner, log_slice_t* line) {
+    if (!scanner || !line) {
+        return 0;
+    }
+    while (scanner->mask == 0) {
+        if (scanner->next_block >= scanner->size) {
+            // Last line without a newline
+            if (scanner->pos < scanner->size) {
+                line->ptr = scanner->data + scanner->pos;
+                line->length = scanner->size - scanner->pos;
+                scanner->pos = scanner->size;
+                return 1;
             }
-            
-            // Parse message
-            const char* message_start = process_end + 2; // Skip ": "
-            entry->message = strdup(message_start);
+            return 0;
         }
+        const size_t remaining = scanner->size - scanner->next_block;
+        scanner->block = scanner->next_block;
+        scanner->mask = newline_mask(scanner->data + scanner->block,
+                                     remaining < SCAN_BLOCK ? remaining : SCAN_BLOCK);
+        scanner->next_block += SCAN_BLOCK;
     }
-    
-    // Set defaults
-    entry->source = strdup("syslog");
-    entry->level = strdup("info");
-    
-    return 0;
+    const size_t newline = scanner->block + first_set_bit64(scanner->mask);
+    scanner->mask &= scanner->mask - 1;
+    line->ptr = scanner->data + scanner->pos;
+    line->length = newline - scanner->pos;
+    scanner->pos = newline + 1;
+    return 1;
 }
 
-int log_parse_syslog(const char* data, log_result_t* result) {
-    if (!data || !result) {
+static log_slice_t slice(const char* ptr, size_t length) {
+    log_slice_t s;
+    s.ptr = ptr;
+    s.length = length;
+    return s;
+}
+
+static log_slice_t literal(const char* str) {
+    return slice(str, strlen(str));
+}
+
+static const char* find_byte(const char* p, const char* end, char c) {
+    return p < end ? (const char*)memchr(p, c, (size_t)(end - p)) : NULL;
+}
+
+// atoi over a slice: optional whitespace and sign, then digits
+static int slice_atoi(const char* p, const char* end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    long value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        value = value * 10 + (*p - '0');
+        if (value > 2147483647L) break;
+    }
+    return (int)(negative ? -value : value);
+}
+
+void log_parse_context_init(log_parse_context_t* context, time_t now) {
+    if (context) {
+        memset(context, 0, sizeof(log_parse_context_t));
+        context->now = now;
+        struct tm tm_now;
+        context->year = localtime_r(&now, &tm_now) ? tm_now.tm_year + 1900 : 1970;
+        context->day_key = -1;
+        log_json_keys_compile(NULL, &context->json_keys);
+    }
+}
+
+int log_parse_context_set_json_mapping(log_parse_context_t* context, const log_json_mapping_t* mapping) {
+    if (!context) {
         return -1;
     }
-    
-    log_result_init(result);
-    
-    // Parse line by line
-    const char* line_start = data;
-    const char* line_end = strchr(line_start, '\n');
-    
-    while (line_start && *line_start) {
-        size_t line_len = line_end ? (line_end - line_start) : strlen(line_start);
-        
-        // Skip empty lines
-        if (line_len > 0) {
-            // Create a copy of the line
-            char* line = (char*)malloc(line_len + 1);
-            if (line) {
-                strncpy(line, line_start, line_len);
-                line[line_len] = '\0';
-                
-                // Parse the line
-                log_entry_t entry;
-                if (parse_syslog_line(line, &entry) == 0) {
-                    log_result_add_entry(result, &entry);
-                }
-                
-                // Clean up entry
-                free(entry.source);
-                free(entry.level);
-                free(entry.message);
-                free(entry.host);
-                free(entry.process);
-                
-                free(line);
-            }
+    return log_json_keys_compile(mapping, &context->json_keys);
+}
+
+// Month number (0-11) of a three-letter English abbreviation, or -1
+static int parse_month(const char* p) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    for (int m = 0; m < 12; m++) {
+        if (p[0] == months[3 * m] && p[1] == months[3 * m + 1] && p[2] == months[3 * m + 2]) {
+            return m;
         }
-        
-        // Move to next line
-        line_start = line_end ? line_end + 1 : NULL;
-        line_end = line_start ? strchr(line_start, '\n') : NULL;
     }
-    
-    return 0;
+    return -1;
 }
 
-int log_parse_apache(const char* data, log_result_t* result) {
-    if (!data || !result) {
+// Value of two digits, or -1
+static int two_digits(const char* p) {
+    if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') {
         return -1;
     }
-    
-    log_result_init(result);
-    
-    // Parse Apache Common Log Format:
-    // 127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] "GET /apache_pb.gif HTTP/1.0" 200 2326
-    
-    const char* line_start = data;
-    const char* line_end = strchr(line_start, '\n');
-    
-    while (line_start && *line_start) {
-        size_t line_len = line_end ? (line_end - line_start) : strlen(line_start);
-        
-        // Skip empty lines
-        if (line_len > 0) {
-            // Create a copy of the line
-            char* line = (char*)malloc(line_len + 1);
-            if (line) {
-                strncpy(line, line_start, line_len);
-                line[line_len] = '\0';
-                
-                // Parse the line
-                log_entry_t entry;
-                memset(&entry, 0, sizeof(log_entry_t));
-                entry.timestamp = time(NULL); // Simplified
-                entry.source = strdup("apache");
-                entry.level = strdup("info");
-                
-                // Extract IP address (first field)
-                char* ip_end = strchr(line, ' ');
-                if (ip_end) {
-                    *ip_end = '\0';
-                    entry.host = strdup(line);
-                    *ip_end = ' ';
-                    
-                    // Extract request (between quotes)
-                    char* request_start = strchr(line, '"');
-                    if (request_start) {
-                        char* request_end = strchr(request_start + 1, '"');
-                        if (request_end) {
-                            *request_end = '\0';
-                            entry.message = strdup(request_start + 1);
-                            *request_end = '"';
-                        }
-                    }
-                }
-                
-                entry.process = strdup("apache");
-                
-                log_result_add_entry(result, &entry);
-                
-                // Clean up entry
-                free(entry.source);
-                free(entry.level);
-                free(entry.message);
-                free(entry.host);
-                free(entry.process);
-                
-                free(line);
-            }
-        }
-        
-        // Move to next line
-        line_start = line_end ? line_end + 1 : NULL;
-        line_end = line_start ? strchr(line_start, '\n') : NULL;
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+// "HH:MM:SS" in seconds, or -1
+static long parse_clock(const char* p) {
+    const int h = two_digits(p), m = two_digits(p + 3), s = two_digits(p + 6);
+    if (h < 0 || m < 0 || s < 0 || p[2] != ':' || p[5] != ':' || h > 23 || m > 59 || s > 60) {
+        return -1;
     }
-    
+    return h * 3600L + m * 60L + s;
+}
+
+// Days from 1970-01-01 to a civil date (month 0-11)
+static long days_from_civil(long year, int month, int day) {
+    year -= month < 2;
+    const long era = (year >= 0 ? year : year - 399) / 400;
+    const long yoe = year - era * 400;
+    const long mp = (month + 10) % 12;
+    const long doy = (153 * mp + 2) / 5 + day - 1;
+    const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// mktime reloads the time zone state, which is not safe to race on
+static pthread_mutex_t g_mktime_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Local midnight of a day, cached because consecutive lines share it
+static time_t local_day_start(log_parse_context_t* context, int year, int month, int day) {
+    const int key = (year * 12 + month) * 32 + day;
+    if (key != context->day_key) {
+        struct tm tm_day;
+        memset(&tm_day, 0, sizeof(tm_day));
+        tm_day.tm_year = year - 1900;
+        tm_day.tm_mon = month;
+        tm_day.tm_mday = day;
+        tm_day.tm_isdst = -1;
+        pthread_mutex_lock(&g_mktime_mutex);
+        context->day_start = mktime(&tm_day);
+        pthread_mutex_unlock(&g_mktime_mutex);
+        context->day_key = key;
+    }
+    return context->day_start;
+}
+
+// "Jan  1 00:00:00" in local time. The year is the current one unless
+// that puts the entry more than a day in the future (a log from last
+// December read in January).
+static int parse_syslog_time(log_parse_context_t* context, const char* p, time_t* timestamp) {
+    const int month = parse_month(p);
+    // The day is padded with a space or a zero
+    const int day = p[4] != ' ' ? two_digits(p + 4) : (p[5] >= '0' && p[5] <= '9') ? p[5] - '0' : -1;
+    const long clock = parse_clock(p + 7);
+    if (month < 0 || p[3] != ' ' || day < 1 || day > 31 || p[6] != ' ' || clock < 0) {
+        return -1;
+    }
+    time_t t = local_day_start(context, context->year, month, day) + clock;
+    if (t > context->now + 86400) {
+        t = local_day_start(context, context->year - 1, month, day) + clock;
+    }
+    *timestamp = t;
     return 0;
 }
 
-int log_parse_nginx(const char* data, log_result_t* result) {
-    // For simplicity, we'll use the same parser as Apache
-    return log_parse_apache(data, result);
+// "10/Oct/2000:13:55:36 -0700"
+static int parse_apache_time(const char* p, const char* end, time_t* timestamp) {
+    if (end - p < 26) {
+        return -1;
+    }
+    const int day = two_digits(p);
+    const int month = parse_month(p + 3);
+    const int century = two_digits(p + 7), year_low = two_digits(p + 9);
+    const long clock = parse_clock(p + 12);
+    const int zone_h = two_digits(p + 22), zone_m = two_digits(p + 24);
+    if (day < 1 || month < 0 || century < 0 || year_low < 0 || clock < 0 || zone_h < 0 || zone_m < 0 ||
+        p[2] != '/' || p[6] != '/' || p[11] != ':' || p[20] != ' ' || (p[21] != '+' && p[21] != '-')) {
+        return -1;
+    }
+    const long zone = (zone_h * 3600L + zone_m * 60L) * (p[21] == '-' ? -1 : 1);
+    *timestamp = (time_t)(days_from_civil(century * 100 + year_low, month, day) * 86400L + clock - zone);
+    return 0;
 }
 
-int log_parse_json(const char* data, log_result_t* result) {
-    if (!data || !result) {
+// "Jan  1 00:00:00 hostname process[pid]: message"
+static int parse_syslog_line(log_parse_context_t* context, const char* line, size_t length,
+                             log_entry_view_t* view) {
+    const char* end = line + length;
+    view->source = literal("syslog");
+    view->level = literal("info");
+
+    // Hostname follows the 15-character timestamp; lines without the host,
+    // process and message fields are not entries
+    if (length <= 16) {
         return -1;
     }
-    
-    log_result_init(result);
-    
-    // Simplified JSON parser - in a real implementation, this would use a proper JSON library
-    
-    // Parse line by line (assuming one JSON object per line)
-    const char* line_start = data;
-    const char* line_end = strchr(line_start, '\n');
-    
-    while (line_start && *line_start) {
-        size_t line_len = line_end ? (line_end - line_start) : strlen(line_start);
-        
-        // Skip empty lines
-        if (line_len > 0) {
-            // Create a copy of the line
-            char* line = (char*)malloc(line_len + 1);
-            if (line) {
-                strncpy(line, line_start, line_len);
-                line[line_len] = '\0';
-                
-                // Parse the line as JSON (simplified)
-                log_entry_t entry;
-                memset(&entry, 0, sizeof(log_entry_t));
-                entry.timestamp = time(NULL); // Simplified
-                entry.source = strdup("json");
-                entry.level = strdup("info");
-                entry.message = strdup(line);
-                entry.host = strdup("localhost");
-                entry.process = strdup("json_parser");
-                
-                log_result_add_entry(result, &entry);
-                
-                // Clean up entry
-                free(entry.source);
-                free(entry.level);
-                free(entry.message);
-                free(entry.host);
-                free(entry.process);
-                
-                free(line);
-            }
+    const char* hostname_start = line + 16;
+    const char* hostname_end = find_byte(hostname_start, end, ' ');
+    if (!hostname_end) {
+        return -1;
+    }
+    view->host = slice(hostname_start, (size_t)(hostname_end - hostname_start));
+    parse_syslog_time(context, line, &view->timestamp);
+
+    // Process name and PID
+    const char* process_start = hostname_end + 1;
+    const char* process_end = find_byte(process_start, end, ':');
+    if (!process_end) {
+        return -1;
+    }
+    view->process = slice(process_start, (size_t)(process_end - process_start));
+
+    // Try to extract PID from process[pid] format
+    const char* pid_start = find_byte(process_start, process_end, '[');
+    if (pid_start) {
+        const char* pid_end = find_byte(pid_start, process_end, ']');
+        if (pid_end) {
+            view->pid = slice_atoi(pid_start + 1, pid_end);
+            view->process.length = (size_t)(pid_start - process_start); // Truncate process name
         }
-        
-        // Move to next line
-        line_start = line_end ? line_end + 1 : NULL;
-        line_end = line_start ? strchr(line_start, '\n') : NULL;
     }
-    
+
+    // Message after ": "
+    const char* message_start = process_end + 2 <= end ? process_end + 2 : end;
+    view->message = slice(message_start, (size_t)(end - message_start));
     return 0;
 }
 
-int log_parse_csv(const char* data, log_result_t* result) {
-    if (!data || !result) {
+// 127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] "GET /apache_pb.gif HTTP/1.0" 200 2326
+static int parse_apache_line(log_parse_context_t* context, const char* line, size_t length,
+                             log_entry_view_t* view) {
+    (void)context;
+    const char* end = line + length;
+    view->source = literal("apache");
+    view->level = literal("info");
+    view->process = literal("apache");
+
+    // IP address (first field), then the request between quotes; lines
+    // without both are not entries
+    const char* ip_end = find_byte(line, end, ' ');
+    if (!ip_end) {
         return -1;
     }
-    
-    log_result_init(result);
-    
-    // Parse CSV format (assuming standard format with header)
-    const char* line_start = data;
-    const char* line_end = strchr(line_start, '\n');
-    int first_line = 1; // Skip header
-    
-    while (line_start && *line_start) {
-        size_t line_len = line_end ? (line_end - line_start) : strlen(line_start);
-        
-        // Skip empty lines
-        if (line_len > 0 && !first_line) {
-            // Create a copy of the line
-            char* line = (char*)malloc(line_len + 1);
-            if (line) {
-                strncpy(line, line_start, line_len);
-                line[line_len] = '\0';
-                
-                // Parse the line as CSV (simplified)
-                log_entry_t entry;
-                memset(&entry, 0, sizeof(log_entry_t));
-                entry.timestamp = time(NULL); // Simplified
-                entry.source = strdup("csv");
-                entry.level = strdup("info");
-                entry.message = strdup(line);
-                entry.host = strdup("localhost");
-                entry.process = strdup("csv_parser");
-                
-                log_result_add_entry(result, &entry);
-                
-                // Clean up entry
-                free(entry.source);
-                free(entry.level);
-                free(entry.message);
-                free(entry.host);
-                free(entry.process);
-                
-                free(line);
-            }
-        }
-        
-        first_line = 0;
-        
-        // Move to next line
-        line_start = line_end ? line_end + 1 : NULL;
-        line_end = line_start ? strchr(line_start, '\n') : NULL;
+    view->host = slice(line, (size_t)(ip_end - line));
+    const char* request_start = find_byte(line, end, '"');
+    const char* request_end = request_start ? find_byte(request_start + 1, end, '"') : NULL;
+    if (!request_end) {
+        return -1;
+    }
+    view->message = slice(request_start + 1, (size_t)(request_end - request_start - 1));
+
+    // Time between the brackets before the request
+    const char* time_start = find_byte(ip_end, request_start, '[');
+    if (time_start) {
+        parse_apache_time(time_start + 1, request_start, &view->timestamp);
     }
-    
     return 0;
 }
 
-int log_parse_custom(const char* data, log_result_t* result) {
-    if (!data || !result) {
+// One JSON object per line; lines that are not keep the whole line as
+// the message
+static int parse_json_line(log_parse_context_t* context, const char* line, size_t length,
+                           log_entry_view_t* view) {
+    view->source = literal("json");
+    view->level = literal("info");
+    view->message = slice(line, length);
+    view->host = literal("localhost");
+    view->process = literal("json_parser");
+    log_json_parse_line(&context->json_keys, line, length, view);
+    return 0;
+}
+
+// Formats without field parsing yet keep the whole line as the message
+static int parse_csv_line(log_parse_context_t* context, const char* line, size_t length,
+                          log_entry_view_t* view) {
+    (void)context;
+    view->source = literal("csv");
+    view->level = literal("info");
+    view->message = slice(line, length);
+    view->host = literal("localhost");
+    view->process = literal("csv_parser");
+    return 0;
+}
+
+static int parse_custom_line(log_parse_context_t* context, const char* line, size_t length,
+                             log_entry_view_t* view) {
+    (void)context;
+    view->source = literal("custom");
+    view->level = literal("info");
+    view->message = slice(line, length);
+    view->host = literal("localhost");
+    view->process = literal("custom_parser");
+    return 0;
+}
+
+log_line_parser_t log_get_line_parser(log_format_t format) {
+    switch (format) {
+        case LOG_FORMAT_SYSLOG:
+            return parse_syslog_line;
+        case LOG_FORMAT_APACHE:
+        case LOG_FORMAT_NGINX:
+            // For simplicity, Nginx uses the Apache parser
+            return parse_apache_line;
+        case LOG_FORMAT_JSON:
+            return parse_json_line;
+        case LOG_FORMAT_CSV:
+            return parse_csv_line;
+        default:
+            return parse_custom_line;
+    }
+}
+
+int log_parse_chunk(log_parse_context_t* context, const char* data, size_t size, log_format_t format,
+                    int first_chunk, log_view_callback_t callback, void* user_data) {
+    if (!context || (!data && size > 0) || !callback) {
         return -1;
     }
-    
-    log_result_init(result);
-    
-    // Parse custom format (treat each line as a separate message)
-    const char* line_start = data;
-    const char* line_end = strchr(line_start, '\n');
-    
-    while (line_start && *line_start) {
-        size_t line_len = line_end ? (line_end - line_start) : strlen(line_start);
-        
+
+    const log_line_parser_t parse = log_get_line_parser(format);
+    log_line_scanner_t scanner;
+    log_line_scanner_init(&scanner, data, size);
+    log_slice_t line;
+
+    // CSV starts with a header line
+    if (format == LOG_FORMAT_CSV && first_chunk && !log_line_scanner_next(&scanner, &line)) {
+        return 0;
+    }
+
+    while (log_line_scanner_next(&scanner, &line)) {
         // Skip empty lines
-        if (line_len > 0) {
-            // Create a copy of the line
-            char* line = (char*)malloc(line_len + 1);
-            if (line) {
-                strncpy(line, line_start, line_len);
-                line[line_len] = '\0';
-                
-                // Parse the line
-                log_entry_t entry;
-                memset(&entry, 0, sizeof(log_entry_t));
-                entry.timestamp = time(NULL); // Simplified
-                entry.source = strdup("custom");
-                entry.level = strdup("info");
-                entry.message = strdup(line);
-                entry.host = strdup("localhost");
-                entry.process = strdup("custom_parser");
-                
-                log_result_add_entry(result, &entry);
-                
-                // Clean up entry
-                free(entry.source);
-                free(entry.level);
-                free(entry.message);
-                free(entry.host);
-                free(entry.process);
-                
-                free(line);
-            }
+        if (line.length == 0) {
+            continue;
+        }
+        log_entry_view_t view;
+        memset(&view, 0, sizeof(view));
+        view.timestamp = context->now;
+        if (parse(context, line.ptr, line.length, &view) != 0) {
+            continue;
+        }
+        const int ret = callback(&view, user_data);
+        if (ret != 0) {
+            return ret;
         }
-        
-        // Move to next line
-        line_start = line_end ? line_end + 1 : NULL;
-        line_end = line_start ? strchr(line_start, '\n') : NULL;
     }
-    
     return 0;
 }
 
+int log_parse_lines(const char* data, size_t size, log_format_t format,
+                    log_view_callback_t callback, void* user_data) {
+    log_parse_context_t context;
+    log_parse_context_init(&context, time(NULL));
+    return log_parse_chunk(&context, data, size, format, 1, callback, user_data);
+}
+
+static int add_to_result(const log_entry_view_t* view, void* user_data) {
+    return log_result_add_view((log_result_t*)user_data, view) != 0 ? -1 : 0;
+}
+
+static int parse_string(const char* data, log_format_t format, log_result_t* result) {
+    if (!data || !result) {
+        return -1;
+    }
+    log_result_init(result);
+    return log_parse_lines(data, strlen(data), format, add_to_result, result) == 0 ? 0 : -1;
+}
+
+int log_parse_syslog(const char* data, log_result_t* result) {
+    return parse_string(data, LOG_FORMAT_SYSLOG, result);
+}
+
+int log_parse_apache(const char* data, log_result_t* result) {
+    return parse_string(data, LOG_FORMAT_APACHE, result);
+}
+
+int log_parse_nginx(const char* data, log_result_t* result) {
+    // For simplicity, we'll use the same parser as Apache
+    return log_parse_apache(data, result);
+}
+
+int log_parse_json(const char* data, log_result_t* result) {
+    return parse_string(data, LOG_FORMAT_JSON, result);
+}
+
+int log_parse_csv(const char* data, log_result_t* result) {
+    return parse_string(data, LOG_FORMAT_CSV, result);
+}
+
+int log_parse_custom(const char* data, log_result_t* result) {
+    return parse_string(data, LOG_FORMAT_CUSTOM, result);
+}
+
 int log_export_syslog(const log_result_t* result, FILE* file) {
     if (!result || !file) {
         return -1;
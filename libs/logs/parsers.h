@@ -3,12 +3,72 @@
 #ifndef LIBS_LOGS_PARSERS_H
 #define LIBS_LOGS_PARSERS_H
 
+#include <stdint.h>
 #include "logs.h"
+#include "json.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Splits text into lines. Newlines are located 64 bytes at a time into a
+// bit mask (SSE2 where available), so each line costs a few instructions
+// rather than a call and a byte loop.
+typedef struct {
+    const char* data;
+    size_t size;
+    size_t pos;             // Start of the next line
+    size_t block;           // Offset of the block described by mask
+    size_t next_block;      // Offset of the first unscanned byte
+    uint64_t mask;          // Newlines of the block not yet returned
+} log_line_scanner_t;
+
+// Initialize a scanner over data
+void log_line_scanner_init(log_line_scanner_t* scanner, const char* data, size_t size);
+
+// Get the next line (without its newline); the last line may lack one
+// Returns 1 if a line was returned, 0 at the end of the data
+int log_line_scanner_next(log_line_scanner_t* scanner, log_slice_t* line);
+
+// State shared by the lines of one parse
+typedef struct {
+    time_t now;             // Timestamp of entries that carry none
+    int year;               // Local year of now; syslog omits the year
+    int day_key;            // Last syslog day converted (year, month, day)
+    time_t day_start;       // Its local midnight
+    log_json_keys_t json_keys;  // Field mapping of JSON lines
+} log_parse_context_t;
+
+// Initialize a parse context for parsing at time now (JSON lines use the
+// default field mapping)
+void log_parse_context_init(log_parse_context_t* context, time_t now);
+
+// Use a field mapping for JSON lines; its strings must outlive the parse
+// Returns 0 on success, -1 if the mapping has too many keys
+int log_parse_context_set_json_mapping(log_parse_context_t* context, const log_json_mapping_t* mapping);
+
+// Parse one non-empty line into a view whose timestamp is preset to now
+// Returns 0 if the line holds an entry, non-zero otherwise
+typedef int (*log_line_parser_t)(log_parse_context_t* context, const char* line, size_t length,
+                                 log_entry_view_t* view);
+
+// Get the line parser of a format
+log_line_parser_t log_get_line_parser(log_format_t format);
+
+// Receives each parsed entry; returns 0 to continue, non-zero to stop
+typedef int (*log_view_callback_t)(const log_entry_view_t* view, void* user_data);
+
+// Parse text line by line without copying it
+// Returns 0 on success, or the callback's non-zero value if it stopped
+int log_parse_lines(const char* data, size_t size, log_format_t format,
+                    log_view_callback_t callback, void* user_data);
+
+// Parse a newline-aligned chunk of a larger text. Only the chunk at the
+// start of the text has the CSV header.
+// Returns 0 on success, or the callback's non-zero value if it stopped
+int log_parse_chunk(log_parse_context_t* context, const char* data, size_t size, log_format_t format,
+                    int first_chunk, log_view_callback_t callback, void* user_data);
+
 // Parse syslog format
 int log_parse_syslog(const char* data, log_result_t* result);
 
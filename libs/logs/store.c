@@ -0,0 +1,933 @@
+#include "store.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define STORE_INITIAL_SLOTS 64
+#define STORE_COLUMN_COUNT 4
+
+// Dictionary-encoded fields, in log_filter_t order
+enum {
+    COLUMN_SOURCE = 0,
+    COLUMN_LEVEL = 1,
+    COLUMN_HOST = 2,
+    COLUMN_PROCESS = 3
+};
+
+// Level categories of log_filter_entries
+#define LEVEL_ERROR 1
+#define LEVEL_WARNING 2
+#define LEVEL_INFO 4
+#define LEVEL_DEBUG 8
+
+// Distinct values of one field; code 0 is the absent (NULL) value
+typedef struct {
+    uint32_t* codes;            // Per row
+    const char** values;        // Per code, in the store's arena
+    size_t value_count;
+    size_t value_capacity;
+    uint32_t* slots;            // Hash of the values: code, 0 = empty
+    size_t slot_capacity;       // Power of two, at most half full
+    uint64_t* block_codes;      // Per block: bit (code % 64) of every code present
+} store_column_t;
+
+// Lower-case message token. Its posting list holds the rows that contain
+// it as varint deltas; while building, each list grows in its own buffer,
+// and the lists are then packed into one.
+typedef struct {
+    const char* text;
+    size_t length;
+    uint32_t row_count;
+    uint32_t last_row;
+    size_t offset;              // Into the packed postings
+    size_t size;
+    size_t capacity;
+    uint8_t* building;
+} store_token_t;
+
+struct log_store {
+    size_t row_count;
+    time_t* timestamps;         // Ascending
+    time_t* block_max;          // Last timestamp of each block
+    size_t block_count;
+    size_t* source_index;
+    int* pids;
+    const char** messages;
+    store_column_t columns[STORE_COLUMN_COUNT];
+    uint8_t* level_category;    // Per level code
+
+    store_token_t* tokens;
+    size_t token_count;
+    size_t token_capacity;
+    uint32_t* token_slots;      // Hash of the tokens: index + 1, 0 = empty
+    size_t token_slot_capacity;
+    uint8_t* postings;
+    uint32_t* null_messages;    // Rows without a message pass keyword filters
+    size_t null_message_count;
+
+    log_arena_t arena;
+};
+
+// Token bytes: letters, digits, '_' and anything outside ASCII
+static int is_token_byte(unsigned char c) {
+    return isalnum(c) || c == '_' || c >= 0x80;
+}
+
+// FNV-1a
+static uint64_t hash_bytes(const char* p, size_t length) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+// Case-insensitive substring test; needle must be lower case
+static int contains_lower(const char* haystack, const char* needle) {
+    const size_t n = strlen(needle);
+    for (; *haystack; haystack++) {
+        size_t k = 0;
+        while (k < n && haystack[k] && tolower((unsigned char)haystack[k]) == needle[k]) {
+            k++;
+        }
+        if (k == n) {
+            return 1;
+        }
+    }
+    return n == 0;
+}
+
+static int contains_bytes(const char* haystack, size_t length, const char* needle, size_t n) {
+    if (n == 0) {
+        return 1;
+    }
+    const char* end = haystack + length;
+    while ((size_t)(end - haystack) >= n) {
+        const char* p = (const char*)memchr(haystack, needle[0], (size_t)(end - haystack) - n + 1);
+        if (!p) {
+            return 0;
+        }
+        if (memcmp(p, needle, n) == 0) {
+            return 1;
+        }
+        haystack = p + 1;
+    }
+    return 0;
+}
+
+static char* lower_copy(const char* str) {
+    const size_t length = strlen(str);
+    char* copy = (char*)malloc(length + 1);
+    if (copy) {
+        for (size_t i = 0; i <= length; i++) {
+            copy[i] = (char)tolower((unsigned char)str[i]);
+        }
+    }
+    return copy;
+}
+
+static int level_category(const char* level) {
+    if (contains_lower(level, "error") || contains_lower(level, "fatal")) {
+        return LEVEL_ERROR;
+    } else if (contains_lower(level, "warn")) {
+        return LEVEL_WARNING;
+    } else if (contains_lower(level, "info")) {
+        return LEVEL_INFO;
+    } else if (contains_lower(level, "debug")) {
+        return LEVEL_DEBUG;
+    }
+    return 0;
+}
+
+// Grow an open-addressing table of 1-based references
+static int slots_grow(uint32_t** slots, size_t* capacity, size_t count,
+                      uint64_t (*hash_of)(const log_store_t*, const void*, uint32_t),
+                      const log_store_t* store, const void* owner) {
+    size_t new_capacity = *capacity ? *capacity : STORE_INITIAL_SLOTS;
+    while ((count + 1) * 2 > new_capacity) {
+        new_capacity *= 2;
+    }
+    if (new_capacity == *capacity) {
+        return 0;
+    }
+    uint32_t* new_slots = (uint32_t*)calloc(new_capacity, sizeof(uint32_t));
+    if (!new_slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < *capacity; i++) {
+        const uint32_t ref = (*slots)[i];
+        if (ref == 0) {
+            continue;
+        }
+        size_t j = (size_t)hash_of(store, owner, ref) & (new_capacity - 1);
+        while (new_slots[j] != 0) {
+            j = (j + 1) & (new_capacity - 1);
+        }
+        new_slots[j] = ref;
+    }
+    free(*slots);
+    *slots = new_slots;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static uint64_t value_hash(const log_store_t* store, const void* owner, uint32_t code) {
+    (void)store;
+    const char* value = ((const store_column_t*)owner)->values[code];
+    return hash_bytes(value, strlen(value));
+}
+
+static uint64_t token_hash(const log_store_t* store, const void* owner, uint32_t ref) {
+    (void)owner;
+    const store_token_t* token = &store->tokens[ref - 1];
+    return hash_bytes(token->text, token->length);
+}
+
+// Code of a value, adding it to the dictionary if it is new
+static int column_code(log_store_t* store, store_column_t* column, const char* value, uint32_t* code) {
+    if (!value) {
+        *code = 0;
+        return 0;
+    }
+    const size_t length = strlen(value);
+    if (slots_grow(&column->slots, &column->slot_capacity, column->value_count, value_hash, store, column) != 0) {
+        return -1;
+    }
+    size_t i = (size_t)hash_bytes(value, length) & (column->slot_capacity - 1);
+    while (column->slots[i] != 0) {
+        const uint32_t c = column->slots[i];
+        if (strcmp(column->values[c], value) == 0) {
+            *code = c;
+            return 0;
+        }
+        i = (i + 1) & (column->slot_capacity - 1);
+    }
+
+    if (column->value_count >= column->value_capacity) {
+        size_t new_capacity = column->value_capacity * 2;
+        const char** new_values = (const char**)realloc((void*)column->values, new_capacity * sizeof(char*));
+        if (!new_values) {
+            return -1;
+        }
+        column->values = new_values;
+        column->value_capacity = new_capacity;
+    }
+    char* copy = log_arena_strndup(&store->arena, value, length);
+    if (!copy) {
+        return -1;
+    }
+    const uint32_t c = (uint32_t)column->value_count++;
+    column->values[c] = copy;
+    column->slots[i] = c;
+    *code = c;
+    return 0;
+}
+
+// Index of a lower-case token, or -1 if it is not in the index
+static long find_token(const log_store_t* store, const char* text, size_t length, size_t* slot) {
+    size_t i = (size_t)hash_bytes(text, length) & (store->token_slot_capacity - 1);
+    while (store->token_slots[i] != 0) {
+        const store_token_t* token = &store->tokens[store->token_slots[i] - 1];
+        if (token->length == length && memcmp(token->text, text, length) == 0) {
+            return (long)store->token_slots[i] - 1;
+        }
+        i = (i + 1) & (store->token_slot_capacity - 1);
+    }
+    if (slot) {
+        *slot = i;
+    }
+    return -1;
+}
+
+static int posting_append(store_token_t* token, uint32_t row) {
+    if (token->size + 5 > token->capacity) {
+        size_t new_capacity = token->capacity ? token->capacity * 2 : 8;
+        uint8_t* new_building = (uint8_t*)realloc(token->building, new_capacity);
+        if (!new_building) {
+            return -1;
+        }
+        token->building = new_building;
+        token->capacity = new_capacity;
+    }
+    uint32_t delta = token->row_count > 0 ? row - token->last_row : row;
+    while (delta >= 0x80) {
+        token->building[token->size++] = (uint8_t)(delta | 0x80);
+        delta >>= 7;
+    }
+    token->building[token->size++] = (uint8_t)delta;
+    token->row_count++;
+    token->last_row = row;
+    return 0;
+}
+
+// Record that row contains a lower-case token
+static int index_token(log_store_t* store, const char* text, size_t length, uint32_t row) {
+    if (slots_grow(&store->token_slots, &store->token_slot_capacity, store->token_count, token_hash, store, NULL) != 0) {
+        return -1;
+    }
+    size_t slot = 0;
+    long index = find_token(store, text, length, &slot);
+    if (index < 0) {
+        if (store->token_count >= store->token_capacity) {
+            size_t new_capacity = store->token_capacity ? store->token_capacity * 2 : 256;
+            store_token_t* new_tokens = (store_token_t*)realloc(store->tokens, new_capacity * sizeof(store_token_t));
+            if (!new_tokens) {
+                return -1;
+            }
+            store->tokens = new_tokens;
+            store->token_capacity = new_capacity;
+        }
+        store_token_t* token = &store->tokens[store->token_count];
+        memset(token, 0, sizeof(*token));
+        token->text = log_arena_strndup(&store->arena, text, length);
+        if (!token->text) {
+            return -1;
+        }
+        token->length = length;
+        index = (long)store->token_count++;
+        store->token_slots[slot] = (uint32_t)index + 1;
+    }
+    store_token_t* token = &store->tokens[index];
+    if (token->row_count > 0 && token->last_row == row) {
+        return 0;
+    }
+    return posting_append(token, row);
+}
+
+static int index_message(log_store_t* store, const char* message, uint32_t row, char** scratch, size_t* scratch_size) {
+    const unsigned char* p = (const unsigned char*)message;
+    while (*p) {
+        if (!is_token_byte(*p)) {
+            p++;
+            continue;
+        }
+        const unsigned char* start = p;
+        while (*p && is_token_byte(*p)) {
+            p++;
+        }
+        const size_t length = (size_t)(p - start);
+        if (length > *scratch_size) {
+            char* grown = (char*)realloc(*scratch, length);
+            if (!grown) {
+                return -1;
+            }
+            *scratch = grown;
+            *scratch_size = length;
+        }
+        for (size_t i = 0; i < length; i++) {
+            (*scratch)[i] = (char)tolower(start[i]);
+        }
+        if (index_token(store, *scratch, length, row) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Pack every posting list into one buffer
+static int pack_postings(log_store_t* store) {
+    size_t total = 0;
+    for (size_t t = 0; t < store->token_count; t++) {
+        total += store->tokens[t].size;
+    }
+    store->postings = (uint8_t*)malloc(total ? total : 1);
+    if (!store->postings) {
+        return -1;
+    }
+    size_t offset = 0;
+    for (size_t t = 0; t < store->token_count; t++) {
+        store_token_t* token = &store->tokens[t];
+        memcpy(store->postings + offset, token->building, token->size);
+        token->offset = offset;
+        offset += token->size;
+        free(token->building);
+        token->building = NULL;
+        token->capacity = 0;
+    }
+    return 0;
+}
+
+typedef struct {
+    time_t timestamp;
+    size_t index;
+} store_order_t;
+
+static int compare_order(const void* a, const void* b) {
+    const store_order_t* x = (const store_order_t*)a;
+    const store_order_t* y = (const store_order_t*)b;
+    if (x->timestamp != y->timestamp) {
+        return x->timestamp < y->timestamp ? -1 : 1;
+    }
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+static int store_allocate(log_store_t* store, size_t rows) {
+    const size_t n = rows ? rows : 1;
+    store->block_count = (rows + LOG_STORE_BLOCK_ROWS - 1) / LOG_STORE_BLOCK_ROWS;
+    const size_t blocks = store->block_count ? store->block_count : 1;
+    store->timestamps = (time_t*)malloc(n * sizeof(time_t));
+    store->block_max = (time_t*)malloc(blocks * sizeof(time_t));
+    store->source_index = (size_t*)malloc(n * sizeof(size_t));
+    store->pids = (int*)malloc(n * sizeof(int));
+    store->messages = (const char**)malloc(n * sizeof(char*));
+    if (!store->timestamps || !store->block_max || !store->source_index || !store->pids || !store->messages) {
+        return -1;
+    }
+    for (int c = 0; c < STORE_COLUMN_COUNT; c++) {
+        store_column_t* column = &store->columns[c];
+        column->codes = (uint32_t*)malloc(n * sizeof(uint32_t));
+        column->block_codes = (uint64_t*)calloc(blocks, sizeof(uint64_t));
+        column->value_capacity = 16;
+        column->values = (const char**)malloc(column->value_capacity * sizeof(char*));
+        if (!column->codes || !column->block_codes || !column->values) {
+            return -1;
+        }
+        column->values[0] = NULL;
+        column->value_count = 1;
+    }
+    return 0;
+}
+
+static int store_add_row(log_store_t* store, const log_entry_t* entry, size_t index, uint32_t row,
+                         char** scratch, size_t* scratch_size) {
+    store->timestamps[row] = entry->timestamp;
+    store->source_index[row] = index;
+    store->pids[row] = entry->pid;
+
+    const char* fields[STORE_COLUMN_COUNT];
+    fields[COLUMN_SOURCE] = entry->source;
+    fields[COLUMN_LEVEL] = entry->level;
+    fields[COLUMN_HOST] = entry->host;
+    fields[COLUMN_PROCESS] = entry->process;
+    for (int c = 0; c < STORE_COLUMN_COUNT; c++) {
+        store_column_t* column = &store->columns[c];
+        uint32_t code;
+        if (column_code(store, column, fields[c], &code) != 0) {
+            return -1;
+        }
+        column->codes[row] = code;
+        column->block_codes[row / LOG_STORE_BLOCK_ROWS] |= 1ULL << (code & 63);
+    }
+
+    if (!entry->message) {
+        store->messages[row] = NULL;
+        store->null_messages[store->null_message_count++] = row;
+        return 0;
+    }
+    store->messages[row] = log_arena_strndup(&store->arena, entry->message, strlen(entry->message));
+    if (!store->messages[row]) {
+        return -1;
+    }
+    return index_message(store, entry->message, row, scratch, scratch_size);
+}
+
+log_store_t* log_store_create(const log_result_t* result) {
+    if (!result || (result->count > 0 && !result->entries) || result->count >= UINT32_MAX) {
+        return NULL;
+    }
+    log_store_t* store = (log_store_t*)calloc(1, sizeof(log_store_t));
+    if (!store) {
+        return NULL;
+    }
+    log_arena_init(&store->arena);
+
+    const size_t rows = result->count;
+    store->row_count = rows;
+    store_order_t* order = (store_order_t*)malloc((rows ? rows : 1) * sizeof(store_order_t));
+    store->null_messages = (uint32_t*)malloc((rows ? rows : 1) * sizeof(uint32_t));
+    if (!order || !store->null_messages || store_allocate(store, rows) != 0) {
+        free(order);
+        log_store_free(store);
+        return NULL;
+    }
+
+    // Stable sort by time, skipped when the entries are already in order
+    int sorted = 1;
+    for (size_t i = 0; i < rows; i++) {
+        order[i].timestamp = result->entries[i].timestamp;
+        order[i].index = i;
+        if (i > 0 && order[i].timestamp < order[i - 1].timestamp) {
+            sorted = 0;
+        }
+    }
+    if (!sorted) {
+        qsort(order, rows, sizeof(store_order_t), compare_order);
+    }
+
+    char* scratch = NULL;
+    size_t scratch_size = 0;
+    int ret = 0;
+    for (size_t r = 0; r < rows && ret == 0; r++) {
+        ret = store_add_row(store, &result->entries[order[r].index], order[r].index, (uint32_t)r,
+                            &scratch, &scratch_size);
+    }
+    free(scratch);
+    free(order);
+
+    if (ret == 0) {
+        for (size_t b = 0; b < store->block_count; b++) {
+            size_t last = (b + 1) * LOG_STORE_BLOCK_ROWS;
+            store->block_max[b] = store->timestamps[(last < rows ? last : rows) - 1];
+        }
+        const store_column_t* levels = &store->columns[COLUMN_LEVEL];
+        store->level_category = (uint8_t*)calloc(levels->value_count, 1);
+        if (!store->level_category) {
+            ret = -1;
+        } else {
+            for (size_t c = 1; c < levels->value_count; c++) {
+                store->level_category[c] = (uint8_t)level_category(levels->values[c]);
+            }
+        }
+    }
+    if (ret == 0) {
+        ret = pack_postings(store);
+    }
+    if (ret != 0) {
+        log_store_free(store);
+        return NULL;
+    }
+    return store;
+}
+
+void log_store_free(log_store_t* store) {
+    if (!store) {
+        return;
+    }
+    free(store->timestamps);
+    free(store->block_max);
+    free(store->source_index);
+    free(store->pids);
+    free((void*)store->messages);
+    for (int c = 0; c < STORE_COLUMN_COUNT; c++) {
+        store_column_t* column = &store->columns[c];
+        free(column->codes);
+        free((void*)column->values);
+        free(column->slots);
+        free(column->block_codes);
+    }
+    free(store->level_category);
+    for (size_t t = 0; t < store->token_count; t++) {
+        free(store->tokens[t].building);
+    }
+    free(store->tokens);
+    free(store->token_slots);
+    free(store->postings);
+    free(store->null_messages);
+    log_arena_free(&store->arena);
+    free(store);
+}
+
+size_t log_store_count(const log_store_t* store) {
+    return store ? store->row_count : 0;
+}
+
+int log_store_get_entry(const log_store_t* store, size_t row, log_entry_t* entry) {
+    if (!store || !entry || row >= store->row_count) {
+        return -1;
+    }
+    entry->timestamp = store->timestamps[row];
+    entry->source = (char*)store->columns[COLUMN_SOURCE].values[store->columns[COLUMN_SOURCE].codes[row]];
+    entry->level = (char*)store->columns[COLUMN_LEVEL].values[store->columns[COLUMN_LEVEL].codes[row]];
+    entry->message = (char*)store->messages[row];
+    entry->host = (char*)store->columns[COLUMN_HOST].values[store->columns[COLUMN_HOST].codes[row]];
+    entry->process = (char*)store->columns[COLUMN_PROCESS].values[store->columns[COLUMN_PROCESS].codes[row]];
+    entry->pid = store->pids[row];
+    return 0;
+}
+
+size_t log_store_source_index(const log_store_t* store, size_t row) {
+    if (!store || row >= store->row_count) {
+        return (size_t)-1;
+    }
+    return store->source_index[row];
+}
+
+void log_store_selection_init(log_store_selection_t* selection) {
+    if (selection) {
+        selection->rows = NULL;
+        selection->count = 0;
+        selection->capacity = 0;
+    }
+}
+
+void log_store_selection_free(log_store_selection_t* selection) {
+    if (selection) {
+        free(selection->rows);
+        log_store_selection_init(selection);
+    }
+}
+
+static int selection_add(log_store_selection_t* selection, size_t row) {
+    if (selection->count >= selection->capacity) {
+        size_t new_capacity = selection->capacity ? selection->capacity * 2 : 64;
+        size_t* new_rows = (size_t*)realloc(selection->rows, new_capacity * sizeof(size_t));
+        if (!new_rows) {
+            return -1;
+        }
+        selection->rows = new_rows;
+        selection->capacity = new_capacity;
+    }
+    selection->rows[selection->count++] = row;
+    return 0;
+}
+
+// First row whose timestamp is >= t (after = 0) or > t (after = 1): a
+// binary search over the block maxima, then inside one block
+static size_t time_bound(const log_store_t* store, time_t t, int after) {
+    size_t lo = 0, hi = store->block_count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        const time_t m = store->block_max[mid];
+        if (after ? m > t : m >= t) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    if (lo == store->block_count) {
+        return store->row_count;
+    }
+    hi = (lo + 1) * LOG_STORE_BLOCK_ROWS;
+    if (hi > store->row_count) {
+        hi = store->row_count;
+    }
+    lo *= LOG_STORE_BLOCK_ROWS;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        const time_t m = store->timestamps[mid];
+        if (after ? m > t : m >= t) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Does a token contain a keyword run? A run that is preceded (followed)
+// by a non-token byte in the keyword must start (end) the token.
+static int token_matches(const store_token_t* token, const char* run, size_t length, int at_start, int at_end) {
+    if (token->length < length) {
+        return 0;
+    }
+    if (at_start && at_end) {
+        return token->length == length && memcmp(token->text, run, length) == 0;
+    } else if (at_start) {
+        return memcmp(token->text, run, length) == 0;
+    } else if (at_end) {
+        return memcmp(token->text + token->length - length, run, length) == 0;
+    }
+    return contains_bytes(token->text, token->length, run, length);
+}
+
+static void posting_mark(const log_store_t* store, const store_token_t* token, uint64_t* bitmap) {
+    const uint8_t* p = store->postings + token->offset;
+    uint32_t row = 0;
+    for (uint32_t n = 0; n < token->row_count; n++) {
+        uint32_t delta = 0;
+        int shift = 0;
+        while (*p & 0x80) {
+            delta |= (uint32_t)(*p++ & 0x7f) << shift;
+            shift += 7;
+        }
+        delta |= (uint32_t)(*p++) << shift;
+        row = n > 0 ? row + delta : delta;
+        bitmap[row >> 6] |= 1ULL << (row & 63);
+    }
+}
+
+// Rows that may contain a lower-case keyword: any occurrence puts each
+// token run of the keyword inside one message token, so the rows of the
+// tokens matching the most selective run are a superset of the matches.
+// Rows without a message are included. *bitmap stays NULL when the
+// keyword has no token bytes and every row must be examined.
+static int keyword_candidates(const log_store_t* store, const char* keyword, uint64_t** bitmap) {
+    *bitmap = NULL;
+    const size_t keyword_length = strlen(keyword);
+    const char* best = NULL;
+    size_t best_length = 0;
+    int best_start = 0, best_end = 0;
+    uint64_t best_rows = 0;
+
+    size_t i = 0;
+    while (i < keyword_length) {
+        if (!is_token_byte((unsigned char)keyword[i])) {
+            i++;
+            continue;
+        }
+        const size_t start = i;
+        while (i < keyword_length && is_token_byte((unsigned char)keyword[i])) {
+            i++;
+        }
+        const char* run = keyword + start;
+        const size_t length = i - start;
+        const int at_start = start > 0;
+        const int at_end = i < keyword_length;
+
+        uint64_t rows = 0;
+        if (at_start && at_end) {
+            long t = store->token_count ? find_token(store, run, length, NULL) : -1;
+            rows = t >= 0 ? store->tokens[t].row_count : 0;
+        } else {
+            for (size_t t = 0; t < store->token_count; t++) {
+                if (token_matches(&store->tokens[t], run, length, at_start, at_end)) {
+                    rows += store->tokens[t].row_count;
+                }
+            }
+        }
+        if (!best || rows < best_rows) {
+            best = run;
+            best_length = length;
+            best_start = at_start;
+            best_end = at_end;
+            best_rows = rows;
+        }
+    }
+    if (!best) {
+        return 0;
+    }
+
+    *bitmap = (uint64_t*)calloc((store->row_count + 63) / 64 + 1, sizeof(uint64_t));
+    if (!*bitmap) {
+        return -1;
+    }
+    if (best_start && best_end) {
+        long t = store->token_count ? find_token(store, best, best_length, NULL) : -1;
+        if (t >= 0) {
+            posting_mark(store, &store->tokens[t], *bitmap);
+        }
+    } else if (best_rows > 0) {
+        for (size_t t = 0; t < store->token_count; t++) {
+            if (token_matches(&store->tokens[t], best, best_length, best_start, best_end)) {
+                posting_mark(store, &store->tokens[t], *bitmap);
+            }
+        }
+    }
+    for (size_t n = 0; n < store->null_message_count; n++) {
+        const uint32_t row = store->null_messages[n];
+        (*bitmap)[row >> 6] |= 1ULL << (row & 63);
+    }
+    return 0;
+}
+
+// Compiled filter: accepted codes of the filtered columns and the lower-case keyword
+typedef struct {
+    uint8_t* accept[STORE_COLUMN_COUNT];    // NULL = column not filtered
+    uint64_t signature[STORE_COLUMN_COUNT]; // Bits of the accepted codes
+    char* keyword;
+    uint64_t* candidates;
+} store_query_t;
+
+static void query_free(store_query_t* query) {
+    for (int c = 0; c < STORE_COLUMN_COUNT; c++) {
+        free(query->accept[c]);
+    }
+    free(query->keyword);
+    free(query->candidates);
+}
+
+static int query_compile(const log_store_t* store, const log_filter_t* filter, store_query_t* query) {
+    memset(query, 0, sizeof(*query));
+    const char* patterns[STORE_COLUMN_COUNT];
+    patterns[COLUMN_SOURCE] = filter->source_filter;
+    patterns[COLUMN_LEVEL] = filter->level_filter;
+    patterns[COLUMN_HOST] = filter->host_filter;
+    patterns[COLUMN_PROCESS] = filter->process_filter;
+    int allowed = 0;
+    allowed |= filter->include_errors ? LEVEL_ERROR : 0;
+    allowed |= filter->include_warnings ? LEVEL_WARNING : 0;
+    allowed |= filter->include_info ? LEVEL_INFO : 0;
+    allowed |= filter->include_debug ? LEVEL_DEBUG : 0;
+    const int all_levels = LEVEL_ERROR | LEVEL_WARNING | LEVEL_INFO | LEVEL_DEBUG;
+
+    for (int c = 0; c < STORE_COLUMN_COUNT; c++) {
+        const int by_category = c == COLUMN_LEVEL && allowed != all_levels;
+        if (!patterns[c] && !by_category) {
+            continue;
+        }
+        const store_column_t* column = &store->columns[c];
+        char* pattern = patterns[c] ? lower_copy(patterns[c]) : NULL;
+        query->accept[c] = (uint8_t*)malloc(column->value_count);
+        if ((patterns[c] && !pattern) || !query->accept[c]) {
+            free(pattern);
+            return -1;
+        }
+        // Absent fields pass, as in log_filter_entries
+        query->accept[c][0] = 1;
+        query->signature[c] = 1;
+        for (size_t code = 1; code < column->value_count; code++) {
+            int pass = !pattern || contains_lower(column->values[code], pattern);
+            if (pass && c == COLUMN_LEVEL && store->level_category[code] != 0) {
+                pass = (store->level_category[code] & allowed) != 0;
+            }
+            query->accept[c][code] = (uint8_t)pass;
+            if (pass) {
+                query->signature[c] |= 1ULL << (code & 63);
+            }
+        }
+        free(pattern);
+    }
+
+    if (filter->keyword_filter) {
+        query->keyword = lower_copy(filter->keyword_filter);
+        if (!query->keyword || keyword_candidates(store, query->keyword, &query->candidates) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int row_passes(const log_store_t* store, const store_query_t* query, size_t row) {
+    for (int c = 0; c < STORE_COLUMN_COUNT; c++) {
+        if (query->accept[c] && !query->accept[c][store->columns[c].codes[row]]) {
+            return 0;
+        }
+    }
+    if (query->keyword && store->messages[row]) {
+        return contains_lower(store->messages[row], query->keyword);
+    }
+    return 1;
+}
+
+static int block_may_pass(const log_store_t* store, const store_query_t* query, size_t block) {
+    for (int c = 0; c < STORE_COLUMN_COUNT; c++) {
+        if (query->accept[c] && (store->columns[c].block_codes[block] & query->signature[c]) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int log_store_select(const log_store_t* store, const log_filter_t* filter, log_store_selection_t* selection) {
+    if (!store || !filter || !selection) {
+        return -1;
+    }
+
+    log_store_selection_init(selection);
+
+    const size_t lo = filter->start_time > 0 ? time_bound(store, filter->start_time, 0) : 0;
+    const size_t hi = filter->end_time > 0 ? time_bound(store, filter->end_time, 1) : store->row_count;
+    if (lo >= hi) {
+        return 0;
+    }
+
+    store_query_t query;
+    if (query_compile(store, filter, &query) != 0) {
+        query_free(&query);
+        return -1;
+    }
+
+    int ret = 0;
+    for (size_t block = lo / LOG_STORE_BLOCK_ROWS; block * LOG_STORE_BLOCK_ROWS < hi && ret == 0; block++) {
+        if (!block_may_pass(store, &query, block)) {
+            continue;
+        }
+        size_t first = block * LOG_STORE_BLOCK_ROWS;
+        size_t last = first + LOG_STORE_BLOCK_ROWS;
+        first = first < lo ? lo : first;
+        last = last > hi ? hi : last;
+        for (size_t row = first; row < last && ret == 0; row++) {
+            if (query.candidates) {
+                // Skip to the next candidate
+                uint64_t word = query.candidates[row >> 6] >> (row & 63);
+                if (word == 0) {
+                    row = (row | 63);
+                    continue;
+                }
+                while ((word & 1) == 0) {
+                    word >>= 1;
+                    row++;
+                }
+                if (row >= last) {
+                    break;
+                }
+            }
+            if (row_passes(store, &query, row)) {
+                ret = selection_add(selection, row);
+            }
+        }
+    }
+
+    query_free(&query);
+    if (ret != 0) {
+        log_store_selection_free(selection);
+    }
+    return ret;
+}
+
+int log_store_query(const log_store_t* store, const log_filter_t* filter, log_result_t* output) {
+    if (!store || !filter || !output) {
+        return -1;
+    }
+
+    log_result_init(output);
+
+    log_store_selection_t selection;
+    if (log_store_select(store, filter, &selection) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < selection.count; i++) {
+        log_entry_t entry;
+        log_store_get_entry(store, selection.rows[i], &entry);
+        if (log_result_add_entry(output, &entry) != 0) {
+            log_store_selection_free(&selection);
+            log_result_free(output);
+            return -1;
+        }
+    }
+    log_store_selection_free(&selection);
+    return 0;
+}
+
+// Occurrences of keyword in message, overlapping ones included
+static long count_occurrences(const char* message, const char* keyword, size_t keyword_length, int case_sensitive) {
+    const size_t length = strlen(message);
+    if (keyword_length > length) {
+        return 0;
+    }
+    long count = 0;
+    for (size_t j = 0; j <= length - keyword_length; j++) {
+        size_t k = 0;
+        if (case_sensitive) {
+            while (k < keyword_length && message[j + k] == keyword[k]) {
+                k++;
+            }
+        } else {
+            while (k < keyword_length && tolower((unsigned char)message[j + k]) == keyword[k]) {
+                k++;
+            }
+        }
+        count += k == keyword_length;
+    }
+    return count;
+}
+
+long log_store_search(const log_store_t* store, const char* keyword, int case_sensitive) {
+    if (!store || !keyword) {
+        return -1;
+    }
+
+    char* lowered = lower_copy(keyword);
+    uint64_t* candidates = NULL;
+    if (!lowered || keyword_candidates(store, lowered, &candidates) != 0) {
+        free(lowered);
+        return -1;
+    }
+
+    const size_t keyword_length = strlen(keyword);
+    const char* needle = case_sensitive ? keyword : lowered;
+    long total = 0;
+    for (size_t row = 0; row < store->row_count; row++) {
+        if (candidates && (candidates[row >> 6] & (1ULL << (row & 63))) == 0) {
+            continue;
+        }
+        if (store->messages[row]) {
+            total += count_occurrences(store->messages[row], needle, keyword_length, case_sensitive);
+        }
+    }
+
+    free(candidates);
+    free(lowered);
+    return total;
+}
@@ -0,0 +1,75 @@
+#ifndef LIBS_LOGS_STORE_H
+#define LIBS_LOGS_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "logs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Rows per block of the timestamp and dictionary columns
+#define LOG_STORE_BLOCK_ROWS 1024
+
+typedef struct log_store log_store_t;
+
+// Query result: store rows (in time order) that matched
+typedef struct {
+    size_t* rows;
+    size_t count;
+    size_t capacity;
+} log_store_selection_t;
+
+// Build a queryable store from parsed entries. The entries are copied, so
+// the store does not depend on the result afterwards. Rows are sorted by
+// timestamp (stably, so a time-ordered result keeps its order); level,
+// host, process and source are dictionary-encoded, and every message
+// token goes into an inverted index with compressed posting lists.
+// Build once and query many times.
+// Returns the store, or NULL on error
+log_store_t* log_store_create(const log_result_t* result);
+
+// Free the store
+void log_store_free(log_store_t* store);
+
+// Number of rows in the store
+size_t log_store_count(const log_store_t* store);
+
+// Get a row; the strings belong to the store
+// Returns 0 on success, non-zero on error
+int log_store_get_entry(const log_store_t* store, size_t row, log_entry_t* entry);
+
+// Index of a row's entry in the result the store was built from
+// Returns the index, or (size_t)-1 for an invalid row
+size_t log_store_source_index(const log_store_t* store, size_t row);
+
+// Initialize selection
+void log_store_selection_init(log_store_selection_t* selection);
+
+// Free selection
+void log_store_selection_free(log_store_selection_t* selection);
+
+// Select the rows that log_filter_entries would keep, in time order. The
+// time range is a binary search, blocks whose dictionary codes cannot
+// pass the filter are skipped, and a keyword only examines the rows that
+// the inverted index lists for it.
+// selection: output rows (must be freed with log_store_selection_free)
+// Returns 0 on success, non-zero on error
+int log_store_select(const log_store_t* store, const log_filter_t* filter, log_store_selection_t* selection);
+
+// Filter into a result, like log_filter_entries but in time order
+// output: output filtered log result (must be freed with log_result_free)
+// Returns 0 on success, non-zero on error
+int log_store_query(const log_store_t* store, const log_filter_t* filter, log_result_t* output);
+
+// Count keyword occurrences in messages, as log_search_entries does, but
+// only in the rows the inverted index lists for the keyword
+// Returns number of matches found, negative on error
+long log_store_search(const log_store_t* store, const char* keyword, int case_sensitive);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_LOGS_STORE_H
@@ -1 +1,499 @@
-// Dummy file for lib_lsh library
+#include "lsh.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <cmath>
+#include <unordered_set>
+#include "libs/chash/blake3.h"
+#include "libs/utils/utils.h"
+
+namespace {
+
+// SplitMix64 step, used to derive permutation and gear constants
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Finalizer from MurmurHash3; spreads digest bits before permuting
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Gear table for content-defined chunking
+struct GearTable {
+    uint64_t values[256];
+
+    GearTable() {
+        uint64_t state = 0x4745415254424C45ULL;
+        for (auto& v : values) {
+            v = splitmix64(state);
+        }
+    }
+};
+
+const GearTable& gear_table() {
+    static const GearTable table;
+    return table;
+}
+
+// Round down to a power of two (>= 1)
+size_t floor_pow2(size_t v) {
+    size_t p = 1;
+    while (p <= v / 2) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Incremental chunker state shared by sketch_data and sketch_file
+class ChunkStream {
+public:
+    ChunkStream(const MinHasher& hasher, const ContentSketcher::Parameters& params,
+                ContentSketcher::Sketch& sketch)
+        : m_hasher(hasher), m_params(params), m_sketch(sketch),
+          m_mask(floor_pow2(std::max<size_t>(params.avg_chunk_size, 2)) - 1),
+          m_gear(0), m_chunk_len(0) {
+        blake3_hash_init(&m_state);
+        m_sketch.signature = hasher.empty_signature();
+        m_sketch.chunk_count = 0;
+        m_sketch.bytes_processed = 0;
+    }
+
+    void feed(const uint8_t* data, size_t len) {
+        const uint64_t* gear = gear_table().values;
+        size_t start = 0;
+        for (size_t i = 0; i < len; ++i) {
+            m_gear = (m_gear << 1) + gear[data[i]];
+            m_chunk_len++;
+            if ((m_chunk_len >= m_params.min_chunk_size && (m_gear & m_mask) == 0) ||
+                m_chunk_len >= m_params.max_chunk_size) {
+                blake3_hash_update(&m_state, data + start, i + 1 - start);
+                emit();
+                start = i + 1;
+            }
+        }
+        if (start < len) {
+            blake3_hash_update(&m_state, data + start, len - start);
+        }
+        m_sketch.bytes_processed += len;
+    }
+
+    void finish() {
+        if (m_chunk_len > 0) {
+            emit();
+        }
+    }
+
+private:
+    void emit() {
+        uint8_t digest[8];
+        blake3_hash_finalize(&m_state, digest, sizeof(digest));
+        uint64_t value;
+        memcpy(&value, digest, sizeof(value));
+        m_hasher.update(m_sketch.signature, value);
+        m_sketch.chunk_count++;
+
+        blake3_hash_init(&m_state);
+        m_gear = 0;
+        m_chunk_len = 0;
+    }
+
+    const MinHasher& m_hasher;
+    const ContentSketcher::Parameters& m_params;
+    ContentSketcher::Sketch& m_sketch;
+    uint64_t m_mask;
+    uint64_t m_gear;
+    size_t m_chunk_len;
+    BLAKE3_HASH_STATE m_state;
+};
+
+const uint32_t LSH_FILE_MAGIC = 0x3148534C; // "LSH1"
+const uint32_t LSH_FILE_VERSION = 1;
+
+template<typename T>
+void write_pod(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read_pod(std::ifstream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+} // namespace
+
+// MinHasher implementation
+MinHasher::MinHasher(size_t num_permutations, uint64_t seed) {
+    if (num_permutations == 0) {
+        num_permutations = 1;
+    }
+    m_mul.resize(num_permutations);
+    m_add.resize(num_permutations);
+
+    uint64_t state = seed;
+    for (size_t i = 0; i < num_permutations; ++i) {
+        m_mul[i] = splitmix64(state) | 1; // Odd multiplier keeps the map a bijection
+        m_add[i] = splitmix64(state);
+    }
+}
+
+std::vector<uint64_t> MinHasher::empty_signature() const {
+    return std::vector<uint64_t>(m_mul.size(), UINT64_MAX);
+}
+
+void MinHasher::update(std::vector<uint64_t>& signature, uint64_t digest) const {
+    if (signature.size() != m_mul.size()) {
+        signature = empty_signature();
+    }
+
+    const uint64_t x = mix64(digest);
+    const size_t k = m_mul.size();
+    uint64_t* sig = signature.data();
+    for (size_t i = 0; i < k; ++i) {
+        uint64_t h = x * m_mul[i] + m_add[i];
+        h ^= h >> 29;
+        sig[i] = std::min(sig[i], h);
+    }
+}
+
+std::vector<uint64_t> MinHasher::compute(const uint64_t* digests, size_t count) const {
+    std::vector<uint64_t> signature = empty_signature();
+    for (size_t i = 0; i < count; ++i) {
+        update(signature, digests[i]);
+    }
+    return signature;
+}
+
+double MinHasher::estimate_similarity(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+    if (a.empty() || a.size() != b.size()) {
+        return 0.0;
+    }
+
+    size_t matches = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i] == b[i]) {
+            matches++;
+        }
+    }
+
+    return static_cast<double>(matches) / static_cast<double>(a.size());
+}
+
+// ContentSketcher implementation
+ContentSketcher::ContentSketcher(const MinHasher& hasher, const Parameters& params)
+    : m_params(params), m_hasher(hasher) {
+    if (m_params.min_chunk_size == 0) {
+        m_params.min_chunk_size = 1;
+    }
+    if (m_params.max_chunk_size < m_params.min_chunk_size) {
+        m_params.max_chunk_size = m_params.min_chunk_size;
+    }
+    if (m_params.read_buffer_size == 0) {
+        m_params.read_buffer_size = 64 * 1024;
+    }
+}
+
+ContentSketcher::Sketch ContentSketcher::sketch_data(const void* data, size_t len) const {
+    Sketch sketch;
+    ChunkStream stream(m_hasher, m_params, sketch);
+    if (data && len > 0) {
+        stream.feed(static_cast<const uint8_t*>(data), len);
+    }
+    stream.finish();
+    return sketch;
+}
+
+bool ContentSketcher::sketch_file(const std::string& path, Sketch& out) const {
+    file_handle_t fh = FileUtils::open_file(path, true);
+    if (!FileUtils::is_valid_handle(fh)) {
+        return false;
+    }
+
+    const uint64_t file_size = FileUtils::get_file_size(fh);
+    std::vector<uint8_t> buffer(m_params.read_buffer_size);
+
+    ChunkStream stream(m_hasher, m_params, out);
+    uint64_t offset = 0;
+    bool ok = true;
+    while (offset < file_size) {
+        size_t to_read = static_cast<size_t>(std::min<uint64_t>(buffer.size(), file_size - offset));
+        if (!FileUtils::read_file_data(fh, buffer.data(), to_read, offset)) {
+            ok = false;
+            break;
+        }
+        stream.feed(buffer.data(), to_read);
+        offset += to_read;
+    }
+    FileUtils::close_file(fh);
+
+    if (!ok) {
+        return false;
+    }
+    stream.finish();
+    return true;
+}
+
+// LshIndex implementation
+LshIndex::LshIndex(const Parameters& params)
+    : m_params(params), m_candidates_checked(0) {
+    if (m_params.bands == 0) {
+        m_params.bands = 1;
+    }
+    if (m_params.rows == 0) {
+        m_params.rows = 1;
+    }
+    m_bands.resize(m_params.bands);
+}
+
+uint64_t LshIndex::band_hash(const uint64_t* signature, uint32_t band) const {
+    const uint64_t* rows = signature + static_cast<size_t>(band) * m_params.rows;
+    uint64_t h = 0x84222325CBF29CE4ULL ^ band;
+    for (uint32_t r = 0; r < m_params.rows; ++r) {
+        h = mix64(h ^ rows[r]);
+    }
+    return h;
+}
+
+double LshIndex::similarity(const uint64_t* a, const uint64_t* b) const {
+    const size_t k = m_params.signature_length();
+    size_t matches = 0;
+    for (size_t i = 0; i < k; ++i) {
+        matches += (a[i] == b[i]) ? 1 : 0;
+    }
+    return static_cast<double>(matches) / static_cast<double>(k);
+}
+
+LshIndex::DocId LshIndex::insert(const std::string& key, const std::vector<uint64_t>& signature) {
+    if (signature.size() != m_params.signature_length() || m_keys.size() >= UINT32_MAX) {
+        return UINT32_MAX;
+    }
+
+    const DocId id = static_cast<DocId>(m_keys.size());
+    m_keys.push_back(key);
+    m_signatures.insert(m_signatures.end(), signature.begin(), signature.end());
+
+    for (uint32_t band = 0; band < m_params.bands; ++band) {
+        m_bands[band][band_hash(signature.data(), band)].push_back(id);
+    }
+
+    return id;
+}
+
+std::vector<LshIndex::Match> LshIndex::query(const std::vector<uint64_t>& signature, double threshold,
+                                             size_t max_results) const {
+    std::vector<Match> matches;
+    if (signature.size() != m_params.signature_length()) {
+        return matches;
+    }
+
+    std::unordered_set<DocId> seen;
+    for (uint32_t band = 0; band < m_params.bands; ++band) {
+        auto it = m_bands[band].find(band_hash(signature.data(), band));
+        if (it == m_bands[band].end()) {
+            continue;
+        }
+        for (DocId id : it->second) {
+            if (!seen.insert(id).second) {
+                continue;
+            }
+            m_candidates_checked++;
+            double sim = similarity(signature.data(), signature_ptr(id));
+            if (sim >= threshold) {
+                matches.push_back({id, sim});
+            }
+        }
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const Match& x, const Match& y) {
+        return x.similarity != y.similarity ? x.similarity > y.similarity : x.id < y.id;
+    });
+    if (matches.size() > max_results) {
+        matches.resize(max_results);
+    }
+    return matches;
+}
+
+std::vector<LshIndex::Pair> LshIndex::find_similar_pairs(double threshold) const {
+    std::vector<Pair> pairs;
+    std::unordered_set<uint64_t> seen;
+
+    for (uint32_t band = 0; band < m_params.bands; ++band) {
+        for (const auto& [hash, ids] : m_bands[band]) {
+            if (ids.size() < 2) {
+                continue;
+            }
+            for (size_t i = 0; i < ids.size(); ++i) {
+                for (size_t j = i + 1; j < ids.size(); ++j) {
+                    DocId a = std::min(ids[i], ids[j]);
+                    DocId b = std::max(ids[i], ids[j]);
+                    if (!seen.insert((static_cast<uint64_t>(a) << 32) | b).second) {
+                        continue;
+                    }
+                    m_candidates_checked++;
+                    double sim = similarity(signature_ptr(a), signature_ptr(b));
+                    if (sim >= threshold) {
+                        pairs.push_back({a, b, sim});
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& x, const Pair& y) {
+        if (x.a != y.a) return x.a < y.a;
+        return x.b < y.b;
+    });
+    return pairs;
+}
+
+std::vector<uint64_t> LshIndex::get_signature(DocId id) const {
+    if (id >= m_keys.size()) {
+        return {};
+    }
+    const uint64_t* sig = signature_ptr(id);
+    return std::vector<uint64_t>(sig, sig + m_params.signature_length());
+}
+
+LshIndex::Stats LshIndex::get_stats() const {
+    Stats stats;
+    stats.documents = m_keys.size();
+    stats.candidates_checked = m_candidates_checked;
+    for (const auto& table : m_bands) {
+        stats.buckets += table.size();
+        for (const auto& [hash, ids] : table) {
+            stats.largest_bucket = std::max<uint64_t>(stats.largest_bucket, ids.size());
+        }
+    }
+    return stats;
+}
+
+void LshIndex::clear() {
+    m_keys.clear();
+    m_signatures.clear();
+    for (auto& table : m_bands) {
+        table.clear();
+    }
+    m_candidates_checked = 0;
+}
+
+bool LshIndex::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    // Header
+    write_pod(out, LSH_FILE_MAGIC);
+    write_pod(out, LSH_FILE_VERSION);
+    write_pod(out, m_params.bands);
+    write_pod(out, m_params.rows);
+    write_pod(out, static_cast<uint64_t>(m_keys.size()));
+
+    // Documents: key length, key bytes, signature
+    const size_t k = m_params.signature_length();
+    for (size_t id = 0; id < m_keys.size(); ++id) {
+        write_pod(out, static_cast<uint32_t>(m_keys[id].size()));
+        out.write(m_keys[id].data(), static_cast<std::streamsize>(m_keys[id].size()));
+        out.write(reinterpret_cast<const char*>(signature_ptr(static_cast<DocId>(id))),
+                  static_cast<std::streamsize>(k * sizeof(uint64_t)));
+    }
+
+    // Bucket tables: per band, bucket count then (hash, posting count, ids)
+    for (const auto& table : m_bands) {
+        write_pod(out, static_cast<uint64_t>(table.size()));
+        for (const auto& [hash, ids] : table) {
+            write_pod(out, hash);
+            write_pod(out, static_cast<uint32_t>(ids.size()));
+            out.write(reinterpret_cast<const char*>(ids.data()),
+                      static_cast<std::streamsize>(ids.size() * sizeof(DocId)));
+        }
+    }
+
+    return static_cast<bool>(out);
+}
+
+bool LshIndex::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0;
+    Parameters params;
+    uint64_t count = 0;
+    if (!read_pod(in, magic) || !read_pod(in, version) ||
+        !read_pod(in, params.bands) || !read_pod(in, params.rows) || !read_pod(in, count)) {
+        return false;
+    }
+    if (magic != LSH_FILE_MAGIC || version != LSH_FILE_VERSION ||
+        params.bands == 0 || params.rows == 0 || count >= UINT32_MAX) {
+        return false;
+    }
+
+    const size_t k = params.signature_length();
+    std::vector<std::string> keys(static_cast<size_t>(count));
+    std::vector<uint64_t> signatures(static_cast<size_t>(count) * k);
+    for (size_t id = 0; id < keys.size(); ++id) {
+        uint32_t key_len = 0;
+        if (!read_pod(in, key_len)) {
+            return false;
+        }
+        keys[id].resize(key_len);
+        in.read(keys[id].data(), key_len);
+        in.read(reinterpret_cast<char*>(signatures.data() + id * k),
+                static_cast<std::streamsize>(k * sizeof(uint64_t)));
+        if (!in) {
+            return false;
+        }
+    }
+
+    std::vector<std::unordered_map<uint64_t, std::vector<DocId>>> bands(params.bands);
+    for (auto& table : bands) {
+        uint64_t buckets = 0;
+        if (!read_pod(in, buckets)) {
+            return false;
+        }
+        table.reserve(static_cast<size_t>(buckets));
+        for (uint64_t b = 0; b < buckets; ++b) {
+            uint64_t hash = 0;
+            uint32_t n = 0;
+            if (!read_pod(in, hash) || !read_pod(in, n) || n > count) {
+                return false;
+            }
+            std::vector<DocId> ids(n);
+            in.read(reinterpret_cast<char*>(ids.data()), static_cast<std::streamsize>(n * sizeof(DocId)));
+            if (!in) {
+                return false;
+            }
+            for (DocId id : ids) {
+                if (id >= count) {
+                    return false;
+                }
+            }
+            table.emplace(hash, std::move(ids));
+        }
+    }
+
+    m_params = params;
+    m_keys = std::move(keys);
+    m_signatures = std::move(signatures);
+    m_bands = std::move(bands);
+    m_candidates_checked = 0;
+    return true;
+}
+
+double LshIndex::threshold_estimate(uint32_t bands, uint32_t rows) {
+    if (bands == 0 || rows == 0) {
+        return 1.0;
+    }
+    return std::pow(1.0 / static_cast<double>(bands), 1.0 / static_cast<double>(rows));
+}
@@ -0,0 +1,164 @@
+#ifndef LIBS_LSH_LSH_H
+#define LIBS_LSH_LSH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// k-permutation MinHash over 64-bit chunk digests
+class MinHasher {
+public:
+    static constexpr size_t DEFAULT_PERMUTATIONS = 128;
+
+private:
+    std::vector<uint64_t> m_mul; // Odd multipliers, one per permutation
+    std::vector<uint64_t> m_add; // Additive offsets, one per permutation
+
+public:
+    explicit MinHasher(size_t num_permutations = DEFAULT_PERMUTATIONS, uint64_t seed = 0x6C736864736B3634ULL);
+    ~MinHasher() = default;
+
+    // Number of hash functions (signature length)
+    size_t get_num_permutations() const { return m_mul.size(); }
+
+    // Create an empty signature (all slots at UINT64_MAX)
+    std::vector<uint64_t> empty_signature() const;
+
+    // Fold one chunk digest into a signature (streaming use)
+    void update(std::vector<uint64_t>& signature, uint64_t digest) const;
+
+    // One-shot signature over a set of digests
+    std::vector<uint64_t> compute(const uint64_t* digests, size_t count) const;
+
+    // Estimated Jaccard similarity: fraction of equal slots (0.0 to 1.0)
+    static double estimate_similarity(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b);
+};
+
+// Content-defined chunking + MinHash of a file, in constant memory
+class ContentSketcher {
+public:
+    struct Parameters {
+        size_t min_chunk_size;    // No cut point before this many bytes
+        size_t avg_chunk_size;    // Expected chunk size (power of two)
+        size_t max_chunk_size;    // Forced cut point
+        size_t read_buffer_size;  // Streaming read size
+
+        Parameters()
+            : min_chunk_size(2 * 1024),
+              avg_chunk_size(8 * 1024),
+              max_chunk_size(64 * 1024),
+              read_buffer_size(1024 * 1024) {}
+    };
+
+    struct Sketch {
+        std::vector<uint64_t> signature;
+        uint64_t chunk_count;
+        uint64_t bytes_processed;
+
+        Sketch() : chunk_count(0), bytes_processed(0) {}
+    };
+
+private:
+    Parameters m_params;
+    const MinHasher& m_hasher;
+
+public:
+    ContentSketcher(const MinHasher& hasher, const Parameters& params = Parameters());
+    ~ContentSketcher() = default;
+
+    // Sketch an in-memory buffer
+    Sketch sketch_data(const void* data, size_t len) const;
+
+    // Sketch a file by streaming it through a fixed-size buffer
+    bool sketch_file(const std::string& path, Sketch& out) const;
+
+    const Parameters& get_parameters() const { return m_params; }
+};
+
+// Banded LSH index over MinHash signatures (b bands x r rows)
+class LshIndex {
+public:
+    using DocId = uint32_t;
+
+    struct Parameters {
+        uint32_t bands;
+        uint32_t rows;
+
+        Parameters() : bands(32), rows(4) {} // 128 permutations, ~0.42 threshold
+
+        size_t signature_length() const { return static_cast<size_t>(bands) * rows; }
+    };
+
+    struct Match {
+        DocId id;
+        double similarity;
+    };
+
+    struct Pair {
+        DocId a;
+        DocId b;
+        double similarity;
+    };
+
+    struct Stats {
+        uint64_t documents;
+        uint64_t buckets;
+        uint64_t candidates_checked;
+        uint64_t largest_bucket;
+
+        Stats() : documents(0), buckets(0), candidates_checked(0), largest_bucket(0) {}
+    };
+
+private:
+    Parameters m_params;
+    std::vector<std::string> m_keys;
+    std::vector<uint64_t> m_signatures; // Flattened, signature_length() per document
+    std::vector<std::unordered_map<uint64_t, std::vector<DocId>>> m_bands;
+    mutable uint64_t m_candidates_checked;
+
+public:
+    explicit LshIndex(const Parameters& params = Parameters());
+    ~LshIndex() = default;
+
+    const Parameters& get_parameters() const { return m_params; }
+
+    // Add a document; returns its id, or UINT32_MAX if the signature length is wrong
+    DocId insert(const std::string& key, const std::vector<uint64_t>& signature);
+
+    // Documents whose estimated Jaccard similarity is >= threshold, best first
+    std::vector<Match> query(const std::vector<uint64_t>& signature, double threshold,
+                             size_t max_results = 100) const;
+
+    // All pairs sharing at least one band bucket and verified >= threshold
+    std::vector<Pair> find_similar_pairs(double threshold) const;
+
+    // Accessors
+    size_t size() const { return m_keys.size(); }
+    const std::string& get_key(DocId id) const { return m_keys[id]; }
+    std::vector<uint64_t> get_signature(DocId id) const;
+    Stats get_stats() const;
+
+    // Clear index
+    void clear();
+
+    // Persist bucket tables and signatures
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    // Similarity at which a pair has a 50% chance of becoming a candidate: (1/b)^(1/r)
+    static double threshold_estimate(uint32_t bands, uint32_t rows);
+
+private:
+    // Hash of rows [band*r, band*r + r) of a signature
+    uint64_t band_hash(const uint64_t* signature, uint32_t band) const;
+
+    const uint64_t* signature_ptr(DocId id) const {
+        return m_signatures.data() + static_cast<size_t>(id) * m_params.signature_length();
+    }
+
+    double similarity(const uint64_t* a, const uint64_t* b) const;
+};
+
+#endif // LIBS_LSH_LSH_H
@@ -1,4 +1,7 @@
 #include "analysis.h"
+#include "memstrings.h"
+#include "processes.h"
+#include "network.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -228,124 +231,43 @@ int memory_extract_and_analyze_strings(const char* dump_path, size_t min_length,
     
     printf("Extracting and analyzing strings from: %s\n", dump_path);
     
-    // Open memory dump file
-    FILE* file = fopen(dump_path, "rb");
-    if (!file) {
-        perror("Failed to open memory dump file");
-        return -1;
-    }
-    
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    if (file_size <= 0) {
-        fclose(file);
-        return -1;
-    }
-    
-    // Allocate buffer for reading
-    size_t buffer_size = 1024 * 1024; // 1MB buffer
-    char* buffer = (char*)malloc(buffer_size);
-    if (!buffer) {
-        fclose(file);
+    // Extract into an arena, then copy out one owned string per entry
+    memory_strings_options_t options;
+    memory_strings_options_init(&options);
+    options.min_length = min_length;
+    memory_strings_t extracted;
+    if (memory_strings_extract_file(dump_path, &options, &extracted) != 0) {
+        fprintf(stderr, "Failed to extract strings from memory dump\n");
         return -1;
     }
     
-    // Allocate initial array for strings
-    size_t string_capacity = 1000;
-    *strings = (memory_string_t*)malloc(string_capacity * sizeof(memory_string_t));
-    if (!*strings) {
-        free(buffer);
-        fclose(file);
-        return -1;
-    }
-    
-    // Read file in chunks and extract strings
-    long position = 0;
-    while (position < file_size) {
-        size_t bytes_to_read = (file_size - position > (long)buffer_size) ? buffer_size : (file_size - position);
-        size_t bytes_read = fread(buffer, 1, bytes_to_read, file);
-        
-        if (bytes_read == 0) {
-            break;
+    if (extracted.count > 0) {
+        *strings = (memory_string_t*)calloc(extracted.count, sizeof(memory_string_t));
+        if (!*strings) {
+            memory_strings_free(&extracted);
+            return -1;
         }
-        
-        // Extract ASCII strings from buffer
-        for (size_t i = 0; i < bytes_read; i++) {
-            if (buffer[i] >= 32 && buffer[i] <= 126) { // Printable ASCII
-                // Start of potential string
-                size_t string_start = i;
-                size_t string_length = 0;
-                
-                // Count consecutive printable characters
-                while (i < bytes_read && buffer[i] >= 32 && buffer[i] <= 126) {
-                    string_length++;
-                    i++;
-                }
-                
-                // Check if string meets minimum length requirement
-                if (string_length >= min_length) {
-                    // Reallocate if needed
-                    if (*count >= string_capacity) {
-                        string_capacity *= 2;
-                        memory_string_t* new_strings = (memory_string_t*)realloc(*strings, string_capacity * sizeof(memory_string_t));
-                        if (!new_strings) {
-                            // Clean up and return error
-                            for (size_t j = 0; j < *count; j++) {
-                                memory_string_free(&(*strings)[j]);
-                            }
-                            free(*strings);
-                            free(buffer);
-                            fclose(file);
-                            return -1;
-                        }
-                        *strings = new_strings;
-                    }
-                    
-                    // Initialize and populate string structure
-                    memory_string_init(&(*strings)[*count]);
-                    (*strings)[*count].string_value = (char*)malloc(string_length + 1);
-                    if ((*strings)[*count].string_value) {
-                        strncpy((*strings)[*count].string_value, &buffer[string_start], string_length);
-                        (*strings)[*count].string_value[string_length] = '\0';
-                        (*strings)[*count].address = position + string_start;
-                        (*strings)[*count].length = string_length;
-                        
-                        // Analyze string for suspicious content
-                        const char* suspicious_keywords[] = {
-                            "malware", "trojan", "virus", "backdoor", 
-                            "keylog", "ransom", "exploit", "shellcode"
-                        };
-                        
-                        int num_keywords = sizeof(suspicious_keywords) / sizeof(suspicious_keywords[0]);
-                        (*strings)[*count].is_suspicious = 0;
-                        
-                        for (int j = 0; j < num_keywords; j++) {
-                            if (strstr((*strings)[*count].string_value, suspicious_keywords[j]) != NULL) {
-                                (*strings)[*count].is_suspicious = 1;
-                                (*strings)[*count].context = strdup("Suspicious keyword detected");
-                                break;
-                            }
-                        }
-                        
-                        if (!(*strings)[*count].is_suspicious) {
-                            (*strings)[*count].context = strdup("Normal string");
-                        }
-                        
-                        (*count)++;
-                    }
-                }
+    }
+    for (size_t i = 0; i < extracted.count; i++) {
+        const memory_string_entry_t* entry = &extracted.entries[i];
+        memory_string_t* string = &(*strings)[i];
+        string->string_value = strdup(memory_strings_text(&extracted, i));
+        string->address = entry->address;
+        string->length = (size_t)entry->length;
+        string->is_suspicious = entry->keyword >= 0;
+        string->context = strdup(string->is_suspicious ? "Suspicious keyword detected" : "Normal string");
+        if (!string->string_value || !string->context) {
+            for (size_t j = 0; j <= i; j++) {
+                memory_string_free(&(*strings)[j]);
             }
+            free(*strings);
+            *strings = NULL;
+            memory_strings_free(&extracted);
+            return -1;
         }
-        
-        position += bytes_read;
-        fseek(file, position, SEEK_SET);
     }
-    
-    free(buffer);
-    fclose(file);
+    *count = extracted.count;
+    memory_strings_free(&extracted);
     
     printf("Extracted %lu strings\n", (unsigned long)*count);
     return 0;
@@ -16,7 +16,8 @@ int memory_detect_injected_code_internal(const char* dump_path, const memory_pro
 // Detect rootkit activity in memory
 int memory_detect_rootkit_activity_internal(const char* dump_path, const memory_analysis_result_t* result, int* is_rootkit_detected);
 
-// Extract and analyze strings from memory
+// Extract and analyze strings from memory: each string is flagged if it
+// contains a suspicious keyword (see memstrings.h)
 int memory_extract_and_analyze_strings(const char* dump_path, size_t min_length, memory_string_t** strings, size_t* count);
 
 // Analyze memory regions for suspicious characteristics
@@ -563,40 +563,7 @@ int memory_extract_strings(const char* dump_path, size_t min_length,
         return -1;
     }
     
-    *strings = NULL;
-    *count = 0;
-    
-    // In a real implementation, this would extract strings from the memory dump
-    // For now, we'll create some dummy strings
-    
-    size_t max_strings = 50;
-    *strings = (memory_string_t*)malloc(max_strings * sizeof(memory_string_t));
-    if (!*strings) {
-        return -1;
-    }
-    
-    // Create dummy strings
-    const char* sample_strings[] = {
-        "Hello World", "C:\\Windows\\System32\\", "http://example.com",
-        "malware.exe", "cmd.exe", "C:\\Users\\Admin\\", "password123",
-        "kernel32.dll", "user32.dll", "ntdll.dll"
-    };
-    
-    for (size_t i = 0; i < max_strings && i < 10; i++) {
-        memory_string_init(&(*strings)[i]);
-        (*strings)[i].string_value = strdup_safe(sample_strings[i]);
-        (*strings)[i].address = 0x100000 + i * 0x1000;
-        (*strings)[i].length = strlen(sample_strings[i]);
-        (*strings)[i].context = strdup_safe("Process memory");
-        
-        // Mark some strings as suspicious
-        if (i == 3 || i == 6) {
-            (*strings)[i].is_suspicious = 1;
-        }
-    }
-    
-    *count = (max_strings < 10) ? max_strings : 10;
-    return 0;
+    return memory_extract_and_analyze_strings(dump_path, min_length, strings, count);
 }
 
 int memory_detect_suspicious_processes(const memory_process_t* processes, size_t count, size_t* suspicious_count) {
@@ -189,7 +189,8 @@ int memory_extract_connections(const char* dump_path, const memory_options_t* op
 int memory_extract_regions(const char* dump_path, const memory_options_t* options,
                          memory_region_t** regions, size_t* count);
 
-// Extract strings from memory dump
+// Extract strings from memory dump (ASCII and UTF-16LE; memstrings.h keeps
+// them in one arena without a copy per string)
 // dump_path: path to the memory dump file
 // min_length: minimum string length to extract
 // strings: output array of strings (must be freed)
@@ -0,0 +1,600 @@
+#include "memstrings.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MEMORY_STRINGS_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// LiME range header: magic, version, first and last physical address, reserved
+#define LIME_MAGIC 0x4C694D45u
+#define AVML_MAGIC 0x4C4D5641u
+#define LIME_HEADER_SIZE 32
+
+static const char* const default_keywords[] = {
+    "malware", "trojan", "virus", "backdoor",
+    "keylog", "ransom", "exploit", "shellcode"
+};
+
+void memory_strings_options_init(memory_strings_options_t* options) {
+    if (options) {
+        memset(options, 0, sizeof(memory_strings_options_t));
+        options->min_length = MEMORY_STRINGS_MIN_LENGTH;
+        options->encodings = MEMORY_STRINGS_ASCII | MEMORY_STRINGS_UTF16LE;
+        options->read_size = MEMORY_STRINGS_READ_SIZE;
+    }
+}
+
+void memory_strings_init(memory_strings_t* strings) {
+    if (strings) {
+        memset(strings, 0, sizeof(memory_strings_t));
+    }
+}
+
+void memory_strings_free(memory_strings_t* strings) {
+    if (strings) {
+        free(strings->arena);
+        free(strings->entries);
+        memory_strings_init(strings);
+    }
+}
+
+const char* memory_strings_text(const memory_strings_t* strings, size_t index) {
+    if (!strings || index >= strings->count) {
+        return NULL;
+    }
+    return strings->arena + strings->entries[index].offset;
+}
+
+static unsigned first_set_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Keyword screening
+// ---------------------------------------------------------------------------
+
+// Keywords in one automaton over lower-cased text; first[s] is the lowest
+// keyword index ending at state s or any of its suffixes, -1 if none
+typedef struct {
+    uint16_t* delta;            // state * 256 + byte -> next state
+    int32_t* first;
+    size_t state_count;
+} keyword_matcher_t;
+
+static void keyword_matcher_free(keyword_matcher_t* m) {
+    free(m->delta);
+    free(m->first);
+    memset(m, 0, sizeof(keyword_matcher_t));
+}
+
+static int keyword_matcher_build(keyword_matcher_t* m, const char* const* keywords, size_t count) {
+    memset(m, 0, sizeof(keyword_matcher_t));
+    size_t max_states = 1;
+    for (size_t k = 0; k < count; k++) {
+        max_states += keywords[k] ? strlen(keywords[k]) : 0;
+    }
+    if (max_states > UINT16_MAX) {
+        return -1;
+    }
+    int32_t* next = (int32_t*)malloc(max_states * 256 * sizeof(int32_t));
+    int32_t* fail = (int32_t*)malloc(max_states * sizeof(int32_t));
+    int32_t* queue = (int32_t*)malloc(max_states * sizeof(int32_t));
+    m->first = (int32_t*)malloc(max_states * sizeof(int32_t));
+    int ret = -1;
+    if (!next || !fail || !queue || !m->first) {
+        goto done;
+    }
+    memset(next, 0xFF, max_states * 256 * sizeof(int32_t));
+    memset(m->first, 0xFF, max_states * sizeof(int32_t));
+
+    // Trie of the lower-cased keywords; the first keyword to end at a node wins
+    size_t nodes = 1;
+    for (size_t k = 0; k < count; k++) {
+        const unsigned char* word = (const unsigned char*)keywords[k];
+        if (!word || !word[0]) {
+            continue;
+        }
+        int32_t node = 0;
+        for (size_t i = 0; word[i]; i++) {
+            int32_t* slot = &next[(size_t)node * 256 + (unsigned char)tolower(word[i])];
+            if (*slot < 0) {
+                *slot = (int32_t)nodes++;
+            }
+            node = *slot;
+        }
+        if (m->first[node] < 0) {
+            m->first[node] = (int32_t)k;
+        }
+    }
+
+    m->state_count = nodes;
+    m->delta = (uint16_t*)malloc(nodes * 256 * sizeof(uint16_t));
+    if (!m->delta) {
+        goto done;
+    }
+    size_t head = 0, tail = 0;
+    for (int c = 0; c < 256; c++) {
+        const int32_t child = next[c];
+        m->delta[c] = child < 0 ? 0 : (uint16_t)child;
+        if (child >= 0) {
+            fail[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        const int32_t u = queue[head++];
+        // The fail link is shallower, so its keyword is final already
+        const int32_t inherited = m->first[fail[u]];
+        if (inherited >= 0 && (m->first[u] < 0 || inherited < m->first[u])) {
+            m->first[u] = inherited;
+        }
+        for (int c = 0; c < 256; c++) {
+            const int32_t v = next[(size_t)u * 256 + c];
+            const uint16_t via_fail = m->delta[(size_t)fail[u] * 256 + c];
+            if (v < 0) {
+                m->delta[(size_t)u * 256 + c] = via_fail;
+            } else {
+                m->delta[(size_t)u * 256 + c] = (uint16_t)v;
+                fail[v] = via_fail;
+                queue[tail++] = v;
+            }
+        }
+    }
+    ret = 0;
+
+done:
+    free(next);
+    free(fail);
+    free(queue);
+    if (ret != 0) {
+        keyword_matcher_free(m);
+    }
+    return ret;
+}
+
+// Returns the lowest-indexed keyword found first in text, -1 if none
+static int32_t keyword_matcher_find(const keyword_matcher_t* m, const char* text, size_t length) {
+    uint32_t state = 0;
+    for (size_t i = 0; i < length; i++) {
+        state = m->delta[(size_t)state * 256 + (unsigned char)tolower((unsigned char)text[i])];
+        if (m->first[state] >= 0) {
+            return m->first[state];
+        }
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Scanning
+// ---------------------------------------------------------------------------
+
+// A run of printable characters in progress. The characters it had in
+// earlier buffers wait in its carry until the run ends.
+typedef struct {
+    int active;
+    uint64_t start;             // Address of the first byte
+    char* carry;
+    uint64_t carried;           // Characters in carry
+    uint64_t carry_capacity;
+} string_run_t;
+
+typedef struct {
+    const memory_strings_options_t* options;
+    memory_strings_t* out;
+    keyword_matcher_t keywords;
+    string_run_t ascii;
+    string_run_t wide[2];       // UTF-16LE runs starting at even and odd addresses
+    const uint8_t* data;        // Current buffer
+    uint64_t address;           // Address of data[0]
+    int failed;
+} strings_scan_t;
+
+static int arena_reserve(memory_strings_t* out, uint64_t extra) {
+    if (out->arena_size + extra <= out->arena_capacity) {
+        return 0;
+    }
+    uint64_t new_capacity = out->arena_capacity == 0 ? 64 * 1024 : out->arena_capacity;
+    while (new_capacity < out->arena_size + extra) {
+        new_capacity *= 2;
+    }
+    char* arena = (char*)realloc(out->arena, (size_t)new_capacity);
+    if (!arena) {
+        return -1;
+    }
+    out->arena = arena;
+    out->arena_capacity = new_capacity;
+    return 0;
+}
+
+// Copy the characters of run r in the current buffer, from its first
+// uncopied one up to address end, to dst; returns the count
+static uint64_t copy_chars(const strings_scan_t* sc, const string_run_t* r, uint64_t end, size_t step, char* dst) {
+    const uint64_t from = r->start + r->carried * step;
+    if (end <= from) {
+        return 0;
+    }
+    const uint64_t chars = (end - from + step - 1) / step;
+    const uint8_t* src = sc->data + (from - sc->address);
+    if (step == 1) {
+        memcpy(dst, src, (size_t)chars);
+    } else {
+        for (uint64_t c = 0; c < chars; c++) {
+            dst[c] = (char)src[2 * c];
+        }
+    }
+    return chars;
+}
+
+// Keep the characters of run r up to address end (the end of the buffer)
+static int run_suspend(strings_scan_t* sc, string_run_t* r, uint64_t end, size_t step) {
+    const uint64_t total = (end - r->start + step - 1) / step;
+    if (total > r->carry_capacity) {
+        uint64_t new_capacity = r->carry_capacity == 0 ? 256 : r->carry_capacity;
+        while (new_capacity < total) {
+            new_capacity *= 2;
+        }
+        char* carry = (char*)realloc(r->carry, (size_t)new_capacity);
+        if (!carry) {
+            return -1;
+        }
+        r->carry = carry;
+        r->carry_capacity = new_capacity;
+    }
+    r->carried += copy_chars(sc, r, end, step, r->carry + r->carried);
+    return 0;
+}
+
+static int add_entry(memory_strings_t* out, const memory_string_entry_t* entry) {
+    if (out->count >= out->capacity) {
+        size_t new_capacity = (out->capacity == 0) ? 1024 : out->capacity * 2;
+        memory_string_entry_t* new_entries = (memory_string_entry_t*)realloc(out->entries,
+                                                                             new_capacity * sizeof(memory_string_entry_t));
+        if (!new_entries) {
+            return -1;
+        }
+        out->entries = new_entries;
+        out->capacity = new_capacity;
+    }
+    out->entries[out->count++] = *entry;
+    return 0;
+}
+
+// End run r at address end (its first non-character)
+static void run_close(strings_scan_t* sc, string_run_t* r, uint64_t end, size_t step) {
+    r->active = 0;
+    memory_strings_t* out = sc->out;
+    const uint64_t length = (end - r->start) / step;
+    if (length < sc->options->min_length || sc->failed) {
+        r->carried = 0;
+        return;
+    }
+    if (arena_reserve(out, length + 1) != 0) {
+        sc->failed = 1;
+        return;
+    }
+    char* text = out->arena + out->arena_size;
+    if (r->carried > 0) {
+        memcpy(text, r->carry, (size_t)r->carried);
+    }
+    copy_chars(sc, r, end, step, text + r->carried);
+    r->carried = 0;
+    text[length] = '\0';
+
+    memory_string_entry_t entry;
+    entry.address = r->start;
+    entry.offset = out->arena_size;
+    entry.length = length;
+    entry.encoding = step == 1 ? MEMORY_STRING_ASCII : MEMORY_STRING_UTF16LE;
+    entry.keyword = keyword_matcher_find(&sc->keywords, text, (size_t)length);
+    if (entry.keyword < 0 && sc->options->suspicious_only) {
+        return;
+    }
+    if (add_entry(out, &entry) != 0) {
+        sc->failed = 1;
+        return;
+    }
+    out->arena_size += length + 1;
+    if (entry.keyword >= 0) {
+        out->suspicious_count++;
+    }
+}
+
+// Follow run r over the lanes of a block: mask has a bit for every lane
+// holding a character; a run continues while consecutive lanes are set
+static void scan_lanes(strings_scan_t* sc, string_run_t* r, uint32_t mask, uint32_t lanes, uint64_t block,
+                       size_t step) {
+    uint32_t from = lanes;
+    for (;;) {
+        if (r->active) {
+            const uint32_t gaps = from & ~mask;
+            if (!gaps) {
+                return;
+            }
+            const unsigned end = first_set_bit(gaps);
+            run_close(sc, r, block + end, step);
+            from &= ~((2u << end) - 1);
+        } else {
+            const uint32_t starts = from & mask;
+            if (!starts) {
+                return;
+            }
+            const unsigned start = first_set_bit(starts);
+            r->active = 1;
+            r->start = block + start;
+            from &= ~((2u << start) - 1);
+        }
+    }
+}
+
+static int is_printable(uint8_t b) {
+    return b >= 32 && b <= 126;
+}
+
+// Masks of positions [i, i + n) of data[0 .. size): printable bytes, and
+// printable bytes followed by a zero byte (UTF-16LE characters)
+static void block_masks(const uint8_t* data, size_t size, size_t i, size_t n, uint32_t* print, uint32_t* wide) {
+#ifdef MEMORY_STRINGS_SSE2
+    if (n == 16 && i + 17 <= size) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        const __m128i next = _mm_loadu_si128((const __m128i*)(data + i + 1));
+        // 0x20..0x7E shifted to the bottom of the signed range
+        const __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(0x60));
+        const uint32_t p = (uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 0x5F)));
+        const uint32_t z = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(next, _mm_setzero_si128()));
+        *print = p;
+        *wide = p & z;
+        return;
+    }
+#endif
+    uint32_t p = 0, w = 0;
+    for (size_t j = 0; j < n; j++) {
+        if (is_printable(data[i + j])) {
+            p |= 1u << j;
+            if (i + j + 1 < size && data[i + j + 1] == 0) {
+                w |= 1u << j;
+            }
+        }
+    }
+    *print = p;
+    *wide = w;
+}
+
+// Scan positions [0, n) of data; a UTF-16LE character at n - 1 needs
+// data[n], so a buffer that is not the last one leaves its last byte to
+// the next
+static void scan_positions(strings_scan_t* sc, size_t size, size_t n) {
+    const int ascii = (sc->options->encodings & MEMORY_STRINGS_ASCII) != 0;
+    const int utf16 = (sc->options->encodings & MEMORY_STRINGS_UTF16LE) != 0;
+    const uint8_t* data = sc->data;
+    for (size_t i = 0; i < n && !sc->failed; i += 16) {
+        const size_t count = n - i < 16 ? n - i : 16;
+        const uint32_t lanes = count == 16 ? 0xFFFFu : (1u << count) - 1;
+        uint32_t print, wide;
+        block_masks(data, size, i, count, &print, &wide);
+        const uint64_t block = sc->address + i;
+        if (ascii) {
+            // Whole blocks inside or outside a run need no work
+            if (sc->ascii.active ? print != lanes : print != 0) {
+                scan_lanes(sc, &sc->ascii, print, lanes, block, 1);
+            }
+        }
+        if (utf16) {
+            const uint32_t even = (block & 1) ? 0xAAAAu : 0x5555u;
+            for (int parity = 0; parity < 2; parity++) {
+                string_run_t* r = &sc->wide[parity];
+                const uint32_t parity_lanes = lanes & (parity ? ~even : even);
+                if (r->active ? (wide & parity_lanes) != parity_lanes : (wide & parity_lanes) != 0) {
+                    scan_lanes(sc, r, wide & parity_lanes, parity_lanes, block, 2);
+                }
+            }
+        }
+    }
+}
+
+// Scan one buffer of a range; data continues from the previous buffer
+// Returns the bytes consumed (all with final, else all but the last)
+static size_t scan_buffer(strings_scan_t* sc, const uint8_t* data, size_t size, uint64_t address, int final) {
+    sc->data = data;
+    sc->address = address;
+    const size_t n = final || size == 0 ? size : size - 1;
+    scan_positions(sc, size, n);
+    const uint64_t end = address + n;
+    string_run_t* runs[3] = {&sc->ascii, &sc->wide[0], &sc->wide[1]};
+    for (int k = 0; k < 3 && !sc->failed; k++) {
+        const size_t step = k == 0 ? 1 : 2;
+        if (!runs[k]->active) {
+            continue;
+        }
+        if (final) {
+            run_close(sc, runs[k], k == 0 ? end : end + ((end - runs[k]->start) & 1), step);
+        } else if (run_suspend(sc, runs[k], end, step) != 0) {
+            sc->failed = 1;
+        }
+    }
+    return n;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    const memory_string_entry_t* x = (const memory_string_entry_t*)a;
+    const memory_string_entry_t* y = (const memory_string_entry_t*)b;
+    if (x->address != y->address) return x->address < y->address ? -1 : 1;
+    return (int)x->encoding - (int)y->encoding;
+}
+
+static int scan_begin(strings_scan_t* sc, const memory_strings_options_t* options, memory_strings_t* out) {
+    memset(sc, 0, sizeof(strings_scan_t));
+    sc->options = options;
+    sc->out = out;
+    const char* const* keywords = options->keywords ? options->keywords : default_keywords;
+    const size_t keyword_count = options->keywords ? options->keyword_count
+                                                   : sizeof(default_keywords) / sizeof(default_keywords[0]);
+    return keyword_matcher_build(&sc->keywords, keywords, keyword_count);
+}
+
+static int scan_end(strings_scan_t* sc, size_t first_entry) {
+    keyword_matcher_free(&sc->keywords);
+    free(sc->ascii.carry);
+    free(sc->wide[0].carry);
+    free(sc->wide[1].carry);
+    if (sc->failed) {
+        return -1;
+    }
+    if (sc->out->count - first_entry > 1) {
+        qsort(sc->out->entries + first_entry, sc->out->count - first_entry, sizeof(memory_string_entry_t),
+              compare_entries);
+    }
+    return 0;
+}
+
+int memory_strings_extract_data(const void* data, size_t size, uint64_t address,
+                                const memory_strings_options_t* options, memory_strings_t* strings) {
+    if ((!data && size > 0) || !strings) {
+        return -1;
+    }
+    memory_strings_options_t defaults;
+    if (!options) {
+        memory_strings_options_init(&defaults);
+        options = &defaults;
+    }
+    strings_scan_t sc;
+    const size_t first_entry = strings->count;
+    if (scan_begin(&sc, options, strings) != 0) {
+        return -1;
+    }
+    scan_buffer(&sc, (const uint8_t*)data, size, address, 1);
+    return scan_end(&sc, first_entry);
+}
+
+static int read_fully(int fd, void* buffer, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, (uint8_t*)buffer + done, size - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+static uint32_t le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t le64(const uint8_t* p) {
+    return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32);
+}
+
+// Stream bytes [offset, offset + length) of the file as one range starting
+// at address; the byte held back from each buffer leads the next one
+static int scan_range(strings_scan_t* sc, int fd, uint8_t* buffer, size_t read_size, uint64_t offset,
+                      uint64_t length, uint64_t address) {
+    size_t held = 0;
+    uint64_t done = 0;
+    while (done < length && !sc->failed) {
+        size_t chunk = read_size - held;
+        if (chunk > length - done) {
+            chunk = (size_t)(length - done);
+        }
+        if (read_fully(fd, buffer + held, chunk, offset + done) != 0) {
+            return -1;
+        }
+        done += chunk;
+        const size_t size = held + chunk;
+        const uint64_t buffer_address = address + done - size;
+        const size_t consumed = scan_buffer(sc, buffer, size, buffer_address, done == length);
+        held = size - consumed;
+        if (held > 0) {
+            memmove(buffer, buffer + consumed, held);
+        }
+    }
+    return sc->failed ? -1 : 0;
+}
+
+int memory_strings_extract_file(const char* dump_path, const memory_strings_options_t* options,
+                                memory_strings_t* strings) {
+    if (!dump_path || !strings) {
+        return -1;
+    }
+    memory_strings_init(strings);
+    memory_strings_options_t defaults;
+    if (!options) {
+        memory_strings_options_init(&defaults);
+        options = &defaults;
+    }
+    size_t read_size = options->read_size ? options->read_size : MEMORY_STRINGS_READ_SIZE;
+    if (read_size < 4096) {
+        read_size = 4096;
+    }
+
+    int fd = open(dump_path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    const off_t file_size = lseek(fd, 0, SEEK_END);
+    uint8_t* buffer = (uint8_t*)malloc(read_size);
+    strings_scan_t sc;
+    if (file_size < 0 || !buffer || scan_begin(&sc, options, strings) != 0) {
+        free(buffer);
+        close(fd);
+        return -1;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // LiME: a header before every range of physical memory
+    uint8_t header[LIME_HEADER_SIZE];
+    int ret = 0;
+    const int is_lime = (uint64_t)file_size >= LIME_HEADER_SIZE && read_fully(fd, header, LIME_HEADER_SIZE, 0) == 0 &&
+                        (le32(header) == LIME_MAGIC || le32(header) == AVML_MAGIC);
+    if (!is_lime) {
+        ret = scan_range(&sc, fd, buffer, read_size, 0, (uint64_t)file_size, 0);
+    } else {
+        uint64_t offset = 0;
+        while (ret == 0 && offset + LIME_HEADER_SIZE <= (uint64_t)file_size) {
+            if (read_fully(fd, header, LIME_HEADER_SIZE, offset) != 0) {
+                ret = -1;
+                break;
+            }
+            const uint32_t magic = le32(header);
+            const uint64_t first = le64(header + 8);
+            const uint64_t last = le64(header + 16);
+            // Only version 1 ranges are stored uncompressed
+            if ((magic != LIME_MAGIC && magic != AVML_MAGIC) || le32(header + 4) != 1 || last < first ||
+                last - first + 1 > (uint64_t)file_size - offset - LIME_HEADER_SIZE) {
+                ret = -1;
+                break;
+            }
+            const uint64_t length = last - first + 1;
+            ret = scan_range(&sc, fd, buffer, read_size, offset + LIME_HEADER_SIZE, length, first);
+            offset += LIME_HEADER_SIZE + length;
+        }
+    }
+
+    free(buffer);
+    close(fd);
+    if (scan_end(&sc, 0) != 0 || ret != 0) {
+        memory_strings_free(strings);
+        return -1;
+    }
+    return 0;
+}
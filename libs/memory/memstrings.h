@@ -0,0 +1,97 @@
+#ifndef LIBS_MEMORY_MEMSTRINGS_H
+#define LIBS_MEMORY_MEMSTRINGS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// String extraction from memory dumps. Printable ASCII runs and UTF-16LE
+// runs (printable ASCII code units, at either byte alignment) are found in
+// one pass that classifies 16 bytes at a time, reading the dump in large
+// blocks with the scan state carried from block to block. The text of all
+// strings is kept in one arena with a table of offsets, and every string is
+// screened against the suspicious keywords with one Aho-Corasick automaton.
+// LiME dumps (and uncompressed AVML dumps) are read range by range with
+// physical addresses; anything else is treated as raw memory.
+
+// Encodings extracted
+#define MEMORY_STRINGS_ASCII 0x1
+#define MEMORY_STRINGS_UTF16LE 0x2
+
+// Default shortest string, in characters
+#define MEMORY_STRINGS_MIN_LENGTH 4
+
+// Default bytes read at a time
+#define MEMORY_STRINGS_READ_SIZE (16 * 1024 * 1024)
+
+// Encoding of a string
+#define MEMORY_STRING_ASCII 0
+#define MEMORY_STRING_UTF16LE 1
+
+// One string; its text is arena + offset, NUL-terminated (UTF-16LE strings
+// are narrowed to their ASCII code units)
+typedef struct {
+    uint64_t address;           // Physical address (LiME) or dump offset of the first byte
+    uint64_t offset;            // Offset of the text in the arena
+    uint64_t length;            // Characters
+    uint32_t encoding;          // MEMORY_STRING_ASCII or MEMORY_STRING_UTF16LE
+    int32_t keyword;            // Index of a suspicious keyword it contains, -1 if none
+} memory_string_entry_t;
+
+// Extracted strings
+typedef struct {
+    char* arena;
+    uint64_t arena_size;
+    uint64_t arena_capacity;
+    memory_string_entry_t* entries;
+    size_t count;
+    size_t capacity;
+    size_t suspicious_count;    // Entries with a keyword
+} memory_strings_t;
+
+// Extraction options
+typedef struct {
+    size_t min_length;          // Shortest string kept, in characters
+    int encodings;              // MEMORY_STRINGS_ASCII and/or MEMORY_STRINGS_UTF16LE
+    const char* const* keywords; // Suspicious keywords, matched ignoring case (NULL = built-in list)
+    size_t keyword_count;
+    int suspicious_only;        // Keep only strings containing a keyword
+    size_t read_size;           // Bytes read at a time (0 = MEMORY_STRINGS_READ_SIZE)
+} memory_strings_options_t;
+
+// Initialize extraction options with default values
+void memory_strings_options_init(memory_strings_options_t* options);
+
+// Initialize extracted strings
+void memory_strings_init(memory_strings_t* strings);
+
+// Free extracted strings
+void memory_strings_free(memory_strings_t* strings);
+
+// Text of string index (NULL if out of range)
+const char* memory_strings_text(const memory_strings_t* strings, size_t index);
+
+// Extract strings from a buffer; the new entries are appended in address
+// order
+// address: address of data[0]
+// options: NULL = defaults
+// Returns 0 on success, non-zero on error
+int memory_strings_extract_data(const void* data, size_t size, uint64_t address,
+                                const memory_strings_options_t* options, memory_strings_t* strings);
+
+// Extract strings from a memory dump. No string spans two LiME ranges.
+// Compressed AVML dumps are not supported.
+// strings: output (must be freed with memory_strings_free)
+// options: NULL = defaults
+// Returns 0 on success, non-zero on error
+int memory_strings_extract_file(const char* dump_path, const memory_strings_options_t* options,
+                                memory_strings_t* strings);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_MEMORY_MEMSTRINGS_H
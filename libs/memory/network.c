@@ -7,6 +7,16 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 
+// Helper function to duplicate string
+static char* strdup_safe(const char* str) {
+    if (!str) return NULL;
+    char* dup = (char*)malloc(strlen(str) + 1);
+    if (dup) {
+        strcpy(dup, str);
+    }
+    return dup;
+}
+
 int memory_extract_connections_internal(const char* dump_path, const memory_options_t* options,
                                        memory_connection_t** connections, size_t* count) {
     if (!dump_path || !connections || !count) {
@@ -3,6 +3,16 @@
 #include <string.h>
 #include <stdio.h>
 
+// Helper function to duplicate string
+static char* strdup_safe(const char* str) {
+    if (!str) return NULL;
+    char* dup = (char*)malloc(strlen(str) + 1);
+    if (dup) {
+        strcpy(dup, str);
+    }
+    return dup;
+}
+
 int memory_extract_processes_internal(const char* dump_path, const memory_options_t* options, 
                                     memory_process_t** processes, size_t* count) {
     if (!dump_path || !processes || !count) {
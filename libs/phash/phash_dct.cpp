@@ -0,0 +1,226 @@
+#include "phash_dct.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHASH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace phash_detail {
+
+namespace {
+
+// dst[i] += a * src[i]
+void axpy_scalar(float* dst, const float* src, float a, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] += a * src[i];
+    }
+}
+
+#ifdef PHASH_X86
+void axpy_sse2(float* dst, const float* src, float a, size_t n) {
+    const __m128 va = _mm_set1_ps(a);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 d = _mm_loadu_ps(dst + i);
+        d = _mm_add_ps(d, _mm_mul_ps(va, _mm_loadu_ps(src + i)));
+        _mm_storeu_ps(dst + i, d);
+    }
+    axpy_scalar(dst + i, src + i, a, n - i);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx2,fma")))
+#endif
+void axpy_avx2(float* dst, const float* src, float a, size_t n) {
+    const __m256 va = _mm256_set1_ps(a);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_loadu_ps(dst + i);
+        d = _mm256_fmadd_ps(va, _mm256_loadu_ps(src + i), d);
+        _mm256_storeu_ps(dst + i, d);
+    }
+    for (; i < n; ++i) {
+        dst[i] += a * src[i];
+    }
+}
+#endif
+
+using AxpyFn = void (*)(float*, const float*, float, size_t);
+
+AxpyFn select_axpy(Kernel kernel) {
+#ifdef PHASH_X86
+    switch (kernel) {
+        case Kernel::AVX2: return axpy_avx2;
+        case Kernel::SSE2: return axpy_sse2;
+        default: break;
+    }
+#else
+    (void)kernel;
+#endif
+    return axpy_scalar;
+}
+
+// Sum of bytes in [begin, end)
+inline float range_sum(const uint8_t* row, uint32_t begin, uint32_t end) {
+    uint32_t sum = 0;
+    for (uint32_t x = begin; x < end; ++x) {
+        sum += row[x];
+    }
+    return static_cast<float>(sum);
+}
+
+// Split [0, src) into `size` ranges; every range holds at least one element
+void build_ranges(size_t src, size_t size, std::vector<uint32_t>& begin, std::vector<uint32_t>& end) {
+    begin.resize(size);
+    end.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        size_t b = i * src / size;
+        size_t e = std::max((i + 1) * src / size, b + 1);
+        begin[i] = static_cast<uint32_t>(std::min(b, src - 1));
+        end[i] = static_cast<uint32_t>(std::min(e, src));
+    }
+}
+
+} // namespace
+
+// ScanlineDownscaler implementation
+ScanlineDownscaler::ScanlineDownscaler()
+    : m_src_width(0), m_src_height(0), m_size(0), m_next_row(0) {
+}
+
+void ScanlineDownscaler::reset(size_t src_width, size_t src_height, size_t size) {
+    m_src_width = src_width;
+    m_src_height = src_height;
+    m_size = size;
+    m_next_row = 0;
+    if (src_width == 0 || src_height == 0 || size == 0) {
+        return;
+    }
+
+    build_ranges(src_width, size, m_col_begin, m_col_end);
+    build_ranges(src_height, size, m_row_begin, m_row_end);
+    m_row_sums.assign(size, 0.0f);
+    m_acc.assign(size * size, 0.0f);
+    m_luma.resize(src_width);
+}
+
+void ScanlineDownscaler::add_gray_row(const uint8_t* row) {
+    if (!row || m_next_row >= m_src_height || m_size == 0) {
+        return;
+    }
+    const uint32_t y = static_cast<uint32_t>(m_next_row++);
+
+    for (size_t c = 0; c < m_size; ++c) {
+        m_row_sums[c] = range_sum(row, m_col_begin[c], m_col_end[c]);
+    }
+
+    // Cell rows are monotonic in y; find the ones whose range holds this row
+    size_t r = static_cast<size_t>(y) * m_size / m_src_height;
+    while (r > 0 && m_row_end[r - 1] > y) {
+        --r;
+    }
+    for (; r < m_size && m_row_begin[r] <= y; ++r) {
+        if (y < m_row_end[r]) {
+            float* acc = m_acc.data() + r * m_size;
+            for (size_t c = 0; c < m_size; ++c) {
+                acc[c] += m_row_sums[c];
+            }
+        }
+    }
+}
+
+void ScanlineDownscaler::add_color_row(const uint8_t* row, int channels) {
+    if (!row || channels <= 1) {
+        add_gray_row(row);
+        return;
+    }
+
+    uint8_t* luma = m_luma.data();
+    if (channels == 2) {
+        // Gray + alpha
+        for (size_t x = 0; x < m_src_width; ++x) {
+            luma[x] = row[x * 2];
+        }
+        add_gray_row(luma);
+        return;
+    }
+
+    // ITU-R BT.601 luma in 8-bit fixed point (77 + 150 + 29 = 256)
+    for (size_t x = 0; x < m_src_width; ++x) {
+        const uint8_t* px = row + x * static_cast<size_t>(channels);
+        luma[x] = static_cast<uint8_t>((77u * px[0] + 150u * px[1] + 29u * px[2]) >> 8);
+    }
+    add_gray_row(luma);
+}
+
+bool ScanlineDownscaler::finish(float* cells) const {
+    if (!cells || m_size == 0 || m_next_row != m_src_height) {
+        return false;
+    }
+
+    for (size_t r = 0; r < m_size; ++r) {
+        const float rows = static_cast<float>(m_row_end[r] - m_row_begin[r]);
+        for (size_t c = 0; c < m_size; ++c) {
+            const float cols = static_cast<float>(m_col_end[c] - m_col_begin[c]);
+            cells[r * m_size + c] = m_acc[r * m_size + c] / (rows * cols);
+        }
+    }
+    return true;
+}
+
+// LowFreqDct implementation
+LowFreqDct::LowFreqDct() : m_n(0), m_low(0), m_low_padded(0) {
+}
+
+void LowFreqDct::init(size_t n, size_t low) {
+    if (n == m_n && low == m_low) {
+        return;
+    }
+    m_n = n;
+    m_low = std::min(low, n);
+    m_low_padded = (m_low + 7) & ~static_cast<size_t>(7);
+
+    const double pi = 3.14159265358979323846;
+    m_rows.assign(m_low * n, 0.0f);
+    m_cols.assign(n * m_low_padded, 0.0f);
+    for (size_t u = 0; u < m_low; ++u) {
+        const double alpha = (u == 0) ? std::sqrt(1.0 / n) : std::sqrt(2.0 / n);
+        for (size_t x = 0; x < n; ++x) {
+            const float c = static_cast<float>(
+                alpha * std::cos(pi * static_cast<double>(u) * (2.0 * x + 1.0) / (2.0 * n)));
+            m_rows[u * n + x] = c;
+            m_cols[x * m_low_padded + u] = c;
+        }
+    }
+}
+
+void LowFreqDct::compute(const float* in, float* out, float* tmp, Kernel kernel) const {
+    const AxpyFn axpy = select_axpy(kernel);
+    const size_t n = m_n;
+
+    // Pass 1 (columns): tmp[v][x] = sum_y C[v][y] * in[y][x]
+    for (size_t v = 0; v < m_low; ++v) {
+        float* dst = tmp + v * n;
+        std::memset(dst, 0, n * sizeof(float));
+        const float* coeffs = m_rows.data() + v * n;
+        for (size_t y = 0; y < n; ++y) {
+            axpy(dst, in + y * n, coeffs[y], n);
+        }
+    }
+
+    // Pass 2 (rows): out[v][u] = sum_x tmp[v][x] * C[u][x], vectorized over u
+    float row[64];
+    for (size_t v = 0; v < m_low; ++v) {
+        std::memset(row, 0, m_low_padded * sizeof(float));
+        const float* src = tmp + v * n;
+        for (size_t x = 0; x < n; ++x) {
+            axpy(row, m_cols.data() + x * m_low_padded, src[x], m_low_padded);
+        }
+        std::memcpy(out + v * m_low, row, m_low * sizeof(float));
+    }
+}
+
+} // namespace phash_detail
@@ -0,0 +1,79 @@
+#ifndef LIBS_PHASH_PHASH_DCT_H
+#define LIBS_PHASH_PHASH_DCT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Internal building blocks of the PHashOptimized pipeline: a streaming
+// downscaler that consumes decoded scanlines and a low-frequency DCT.
+namespace phash_detail {
+
+enum class Kernel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// Area-averaging downscaler to a size x size grid of luminance cells.
+// Rows are fed in order as they are decoded, so the full-size image is
+// never materialized (only one converted row is held at a time).
+class ScanlineDownscaler {
+private:
+    size_t m_src_width;
+    size_t m_src_height;
+    size_t m_size;
+    size_t m_next_row;
+    std::vector<uint32_t> m_col_begin;   // Source column range per cell column
+    std::vector<uint32_t> m_col_end;
+    std::vector<uint32_t> m_row_begin;   // Source row range per cell row
+    std::vector<uint32_t> m_row_end;
+    std::vector<float> m_row_sums;       // Per-column sums of the current row
+    std::vector<float> m_acc;            // size x size accumulators
+    std::vector<uint8_t> m_luma;         // Converted luminance row
+
+public:
+    ScanlineDownscaler();
+
+    // Prepare for a new image; reuses previously allocated storage
+    void reset(size_t src_width, size_t src_height, size_t size);
+
+    // Feed the next grayscale row (src_width bytes)
+    void add_gray_row(const uint8_t* row);
+
+    // Feed the next interleaved row (1 gray, 2 gray+alpha, >= 3 R, G, B first)
+    void add_color_row(const uint8_t* row, int channels);
+
+    // Rows consumed so far
+    size_t rows_added() const { return m_next_row; }
+
+    // Write the averaged cells; false if not all rows were fed
+    bool finish(float* cells) const;
+};
+
+// Orthonormal 2D DCT-II restricted to the low x low top-left coefficients
+// of an n x n block, computed separably as (C_low * X) * C_low^T.
+class LowFreqDct {
+private:
+    size_t m_n;
+    size_t m_low;
+    size_t m_low_padded;             // low rounded up to the widest vector
+    std::vector<float> m_rows;       // low x n cosine rows
+    std::vector<float> m_cols;       // n x low_padded transposed cosines
+
+public:
+    LowFreqDct();
+
+    void init(size_t n, size_t low);
+    size_t size() const { return m_n; }
+    size_t low() const { return m_low; }
+
+    // tmp must hold low * max(n, low_padded) floats; out receives low x low
+    void compute(const float* in, float* out, float* tmp, Kernel kernel) const;
+
+    size_t scratch_size() const { return m_low * (m_n > m_low_padded ? m_n : m_low_padded); }
+};
+
+} // namespace phash_detail
+
+#endif // LIBS_PHASH_PHASH_DCT_H
@@ -1,360 +1,667 @@
 #include "phash_optimized.h"
+#include "phash_dct.h"
 #include <cstring>
+#include <cstdio>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
-#include <immintrin.h>
+#include <cctype>
+#include <bit>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#ifdef PHASH_HAVE_JPEG
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
 
 // Implementation details
 struct PHashOptimized::Impl {
     SimdLevel simd_level;
+    phash_detail::Kernel kernel;
     
-    Impl() : simd_level(detect_simd()) {}
+    Impl();
 };
 
-struct LSHIndex::Impl {
-    // Implementation details would go here
+struct PHashMultiIndex::Impl {
+    Parameters params;
+    
+    // Dense slots; removed slots stay as tombstones until the next rebuild
+    std::vector<uint64_t> hashes;
+    std::vector<size_t> image_ids;
+    std::vector<uint8_t> removed;
+    std::unordered_map<size_t, uint32_t> slot_of;
+    
+    // One exact-match table per substring, stored as direct-addressed buckets:
+    // offsets[key]..offsets[key + 1] index into slots/bucket_hashes, which are
+    // grouped by key so candidate checks read contiguous memory.
+    struct Table {
+        uint32_t shift;
+        uint32_t width;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> slots;
+        std::vector<uint64_t> bucket_hashes;
+    };
+    std::vector<Table> tables;
+    bool dirty;
+    
+    Impl() : dirty(true) {}
+    
+    static uint32_t substring(uint64_t hash, const Table& table) {
+        return static_cast<uint32_t>((hash >> table.shift) & ((1ULL << table.width) - 1));
+    }
+    
+    size_t live_count() const { return slot_of.size(); }
+    
+    void rebuild();
+    
+    // Visit every live slot within radius of query (each exactly once)
+    template<typename Visitor>
+    void probe(uint64_t query, int radius, Visitor visit) const;
 };
 
-// PHashOptimized implementation
-PHashOptimized::PHashOptimized()
-    : m_impl(std::make_unique<Impl>()) {
-}
+namespace {
 
-PHashOptimized::~PHashOptimized() = default;
+// Largest substring width; bounds the offsets array to 2^24 + 1 entries
+const uint32_t MAX_SUBSTRING_BITS = 24;
 
-bool PHashOptimized::compute_phash(const uint8_t* image_data, 
-                                  size_t width, size_t height,
-                                  uint64_t& hash_out) {
-    if (!image_data || width == 0 || height == 0) {
-        return false;
+// Enumerate every value within `remaining` bit flips of key, flipping bits >= first
+template<typename Fn>
+void enumerate_neighbors(uint32_t key, uint32_t width, uint32_t first, int remaining, Fn& fn) {
+    fn(key);
+    if (remaining <= 0) {
+        return;
+    }
+    for (uint32_t bit = first; bit < width; ++bit) {
+        enumerate_neighbors(key ^ (1u << bit), width, bit + 1, remaining - 1, fn);
     }
-    
-    Parameters params;
-    return compute_phash_with_params(image_data, width, height, params, hash_out);
 }
 
-bool PHashOptimized::compute_phash_file(const char* image_path, uint64_t& hash_out) {
-    // This would require an image loading library
-    // For now, return false to indicate not implemented
-    return false;
+// Number of keys within Hamming distance s of a width-bit key
+double neighborhood_size(uint32_t width, int s) {
+    double total = 0.0, term = 1.0;
+    for (int k = 0; k <= s && k <= static_cast<int>(width); ++k) {
+        total += term;
+        term = term * (width - k) / (k + 1);
+    }
+    return total;
 }
 
-bool PHashOptimized::compute_phash_with_params(const uint8_t* image_data,
-                                               size_t width, size_t height,
-                                               const Parameters& params,
-                                               uint64_t& hash_out) {
-    if (!image_data || width == 0 || height == 0) {
-        return false;
-    }
-    
-    // Resize image to DCT size
-    std::vector<uint8_t> resized_image(params.dct_size * params.dct_size);
-    if (!resize_image(image_data, width, height, 
-                     resized_image.data(), params.dct_size, params.dct_size)) {
-        return false;
+const uint32_t PHASH_INDEX_MAGIC = 0x31494850; // "PHI1"
+
+} // namespace
+
+void PHashMultiIndex::Impl::rebuild() {
+    // Compact tombstones
+    if (live_count() != hashes.size()) {
+        std::vector<uint64_t> live_hashes;
+        std::vector<size_t> live_ids;
+        live_hashes.reserve(live_count());
+        live_ids.reserve(live_count());
+        slot_of.clear();
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            if (removed[i]) continue;
+            slot_of[image_ids[i]] = static_cast<uint32_t>(live_hashes.size());
+            live_hashes.push_back(hashes[i]);
+            live_ids.push_back(image_ids[i]);
+        }
+        hashes.swap(live_hashes);
+        image_ids.swap(live_ids);
+        removed.assign(hashes.size(), 0);
     }
     
-    // Normalize image if requested
-    if (params.normalize_brightness || params.normalize_contrast) {
-        normalize_image(resized_image.data(), params.dct_size, params.dct_size);
+    // Substring count: ~64 / log2(n) keeps buckets near one entry on average
+    size_t m = params.num_hash_tables;
+    if (m == 0) {
+        double bits = std::log2(static_cast<double>(std::max<size_t>(hashes.size(), 2)));
+        m = static_cast<size_t>(std::lround(64.0 / bits));
     }
-    
-    // Compute DCT
-    std::vector<double> dct_coefficients(params.dct_size * params.dct_size);
-    if (!compute_dct(resized_image.data(), params.dct_size, params.dct_size,
-                    dct_coefficients.data())) {
-        return false;
+    m = std::clamp<size_t>(m, (64 + MAX_SUBSTRING_BITS - 1) / MAX_SUBSTRING_BITS, 8);
+    
+    tables.assign(m, Table());
+    uint32_t shift = 0;
+    for (size_t t = 0; t < m; ++t) {
+        Table& table = tables[t];
+        table.width = static_cast<uint32_t>(64 / m + (t < 64 % m ? 1 : 0));
+        table.shift = shift;
+        shift += table.width;
+        
+        // Counting sort of slots by substring value
+        table.offsets.assign((static_cast<size_t>(1) << table.width) + 1, 0);
+        for (uint64_t h : hashes) {
+            table.offsets[substring(h, table) + 1]++;
+        }
+        for (size_t k = 1; k < table.offsets.size(); ++k) {
+            table.offsets[k] += table.offsets[k - 1];
+        }
+        table.slots.resize(hashes.size());
+        table.bucket_hashes.resize(hashes.size());
+        std::vector<uint32_t> cursor(table.offsets.begin(), table.offsets.end() - 1);
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            uint32_t pos = cursor[substring(hashes[i], table)]++;
+            table.slots[pos] = static_cast<uint32_t>(i);
+            table.bucket_hashes[pos] = hashes[i];
+        }
     }
     
-    // Extract hash from DCT
-    return extract_hash_from_dct(dct_coefficients.data(), params.dct_size,
-                                 params.low_freq_size, hash_out);
+    dirty = false;
 }
 
-size_t PHashOptimized::compute_phash_batch(const ImageBatch* images, size_t count) {
-    if (!images || count == 0) {
-        return 0;
+template<typename Visitor>
+void PHashMultiIndex::Impl::probe(uint64_t query, int radius, Visitor visit) const {
+    if (hashes.empty() || radius < 0) {
+        return;
+    }
+    radius = std::min(radius, 64);
+    
+    // Pigeonhole with r = m*s + a: a match is within s bits on one of the first
+    // a + 1 substrings or within s - 1 bits on one of the others.
+    const int m = static_cast<int>(tables.size());
+    const int s = radius / m;
+    const int a = radius - m * s;
+    int table_radius[8];
+    double probes = 0.0;
+    for (int t = 0; t < m; ++t) {
+        table_radius[t] = (t <= a) ? s : s - 1;
+        probes += neighborhood_size(tables[t].width, table_radius[t]);
     }
     
-    size_t success_count = 0;
-    for (size_t i = 0; i < count; ++i) {
-        if (compute_phash(images[i].image_data, images[i].width, images[i].height,
-                         *images[i].hash_out)) {
-            success_count++;
+    // A linear scan is cheaper once the neighbourhoods approach the index size
+    if (probes * 16.0 >= static_cast<double>(hashes.size())) {
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            if (removed[i]) continue;
+            int d = std::popcount(hashes[i] ^ query);
+            if (d <= radius) {
+                visit(static_cast<uint32_t>(i), d);
+            }
         }
+        return;
     }
     
-    return success_count;
+    for (int t = 0; t < m; ++t) {
+        if (table_radius[t] < 0) {
+            continue;
+        }
+        const Table& table = tables[t];
+        auto lookup = [&](uint32_t key) {
+            const uint32_t end = table.offsets[key + 1];
+            for (uint32_t pos = table.offsets[key]; pos < end; ++pos) {
+                const uint64_t h = table.bucket_hashes[pos];
+                const int d = std::popcount(h ^ query);
+                if (d > radius) continue;
+                
+                // Report each slot only from the first table that can reach it
+                bool seen_earlier = false;
+                for (int u = 0; u < t && !seen_earlier; ++u) {
+                    seen_earlier = std::popcount(substring(h, tables[u]) ^ substring(query, tables[u])) <= table_radius[u];
+                }
+                const uint32_t slot = table.slots[pos];
+                if (!seen_earlier && !removed[slot]) {
+                    visit(slot, d);
+                }
+            }
+        };
+        enumerate_neighbors(substring(query, table), table.width, 0, table_radius[t], lookup);
+    }
 }
 
-int PHashOptimized::compare_hashes(uint64_t hash1, uint64_t hash2) {
-    // Calculate Hamming distance
-    uint64_t xor_result = hash1 ^ hash2;
-    
-    // Count number of set bits (population count)
-    int distance = 0;
-    while (xor_result) {
-        distance += xor_result & 1;
-        xor_result >>= 1;
+// PHashOptimized implementation
+namespace {
+
+using phash_detail::Kernel;
+using phash_detail::LowFreqDct;
+using phash_detail::ScanlineDownscaler;
+
+// Per-thread working memory, reused across images so the hot path never allocates
+struct Scratch {
+    ScanlineDownscaler downscaler;
+    LowFreqDct dct;
+    std::vector<float> cells;
+    std::vector<float> tmp;
+    std::vector<float> coeffs;
+    std::vector<float> sorted;
+    std::vector<uint8_t> row;
+};
+
+Scratch& thread_scratch() {
+    thread_local Scratch scratch;
+    return scratch;
+}
+
+Kernel kernel_for(PHashOptimized::SimdLevel level) {
+    switch (level) {
+        case PHashOptimized::SimdLevel::AVX512:
+        case PHashOptimized::SimdLevel::AVX2: return Kernel::AVX2;
+        case PHashOptimized::SimdLevel::SSE2: return Kernel::SSE2;
+        default: return Kernel::SCALAR;
     }
-    
-    return distance;
 }
 
-bool PHashOptimized::is_similar(uint64_t hash1, uint64_t hash2, int threshold) {
-    return compare_hashes(hash1, hash2) <= threshold;
+bool valid_params(const PHashOptimized::Parameters& params) {
+    return params.dct_size >= 2 && params.dct_size <= 256 &&
+           params.low_freq_size >= 1 && params.low_freq_size <= params.dct_size &&
+           params.low_freq_size <= 64;
 }
 
-PHashOptimized::SimdLevel PHashOptimized::get_simd_level() const {
-    return m_impl ? m_impl->simd_level : SimdLevel::NONE;
+// Start streaming a width x height image into the scratch downscaler
+void begin_image(Scratch& scratch, size_t width, size_t height, const PHashOptimized::Parameters& params) {
+    scratch.downscaler.reset(width, height, params.dct_size);
 }
 
-PHashOptimized::SimdLevel PHashOptimized::detect_simd() {
-    // Check for AVX-512
-    #ifdef __AVX512F__
-    {
-        int cpu_info[4];
-        __cpuid(cpu_info, 7);
-        if ((cpu_info[1] & (1 << 16)) != 0) { // AVX512F bit
-            return SimdLevel::AVX512;
+// DCT the downscaled cells and threshold the low frequencies against their median
+bool finish_image(Scratch& scratch, const PHashOptimized::Parameters& params, Kernel kernel,
+                  uint64_t& hash_out) {
+    const size_t n = params.dct_size;
+    const size_t low = params.low_freq_size;
+    scratch.cells.resize(n * n);
+    if (!scratch.downscaler.finish(scratch.cells.data())) {
+        return false;
+    }
+
+    float* cells = scratch.cells.data();
+    const size_t total = n * n;
+    if (params.normalize_brightness || params.normalize_contrast) {
+        double sum = 0.0, sum_sq = 0.0;
+        for (size_t i = 0; i < total; ++i) {
+            sum += cells[i];
+            sum_sq += static_cast<double>(cells[i]) * cells[i];
+        }
+        const double mean = sum / static_cast<double>(total);
+        const double variance = std::max(0.0, sum_sq / static_cast<double>(total) - mean * mean);
+        const double std_dev = std::sqrt(variance);
+        const float shift = params.normalize_brightness ? static_cast<float>(mean) : 128.0f;
+        const float scale = (params.normalize_contrast && std_dev > 1e-6) ? static_cast<float>(1.0 / std_dev) : 1.0f;
+        for (size_t i = 0; i < total; ++i) {
+            cells[i] = (cells[i] - shift) * scale;
         }
     }
-    #endif
-    
-    // Check for AVX2
-    #ifdef __AVX2__
-    {
-        int cpu_info[4];
-        __cpuid(cpu_info, 7);
-        if ((cpu_info[1] & (1 << 5)) != 0) { // AVX2 bit
-            return SimdLevel::AVX2;
+
+    scratch.dct.init(n, low);
+    scratch.tmp.resize(scratch.dct.scratch_size());
+    scratch.coeffs.resize(low * low);
+    scratch.dct.compute(cells, scratch.coeffs.data(), scratch.tmp.data(), kernel);
+
+    // Low frequency values in row-major order, skipping the DC component
+    const size_t count = std::min(low * low - 1, PHashOptimized::HASH_SIZE);
+    hash_out = 0;
+    if (count == 0) {
+        return true;
+    }
+    const float* values = scratch.coeffs.data() + 1;
+    scratch.sorted.assign(values, values + low * low - 1);
+    auto mid = scratch.sorted.begin() + static_cast<std::ptrdiff_t>(scratch.sorted.size() / 2);
+    std::nth_element(scratch.sorted.begin(), mid, scratch.sorted.end());
+    const float median = *mid;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (values[i] > median) {
+            hash_out |= (1ULL << i);
         }
     }
-    #endif
-    
-    // Check for SSE2
-    #ifdef __SSE2__
-    {
-        int cpu_info[4];
-        __cpuid(cpu_info, 1);
-        if ((cpu_info[3] & (1 << 26)) != 0) { // SSE2 bit
-            return SimdLevel::SSE2;
+    return true;
+}
+
+bool hash_pixels(const uint8_t* image_data, size_t width, size_t height, int channels,
+                 const PHashOptimized::Parameters& params, Kernel kernel, uint64_t& hash_out) {
+    if (!image_data || width == 0 || height == 0 || channels < 1 || !valid_params(params)) {
+        return false;
+    }
+
+    Scratch& scratch = thread_scratch();
+    begin_image(scratch, width, height, params);
+    const size_t stride = width * static_cast<size_t>(channels);
+    for (size_t y = 0; y < height; ++y) {
+        scratch.downscaler.add_color_row(image_data + y * stride, channels);
+    }
+    return finish_image(scratch, params, kernel, hash_out);
+}
+
+// Read one whitespace/comment-delimited integer from a netpbm header
+bool read_pnm_value(std::ifstream& in, size_t& value) {
+    int c = in.get();
+    while (c != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') c = in.get();
+        } else if (!std::isspace(c)) {
+            break;
         }
+        c = in.get();
     }
-    #endif
-    
-    return SimdLevel::NONE;
+    if (c == EOF || !std::isdigit(c)) {
+        return false;
+    }
+    value = 0;
+    while (c != EOF && std::isdigit(c)) {
+        value = value * 10 + static_cast<size_t>(c - '0');
+        if (value > (1u << 20)) return false;
+        c = in.get();
+    }
+    return true; // The single whitespace after the value has been consumed
 }
 
-bool PHashOptimized::resize_image(const uint8_t* src_data, size_t src_width, size_t src_height,
-                                  uint8_t* dst_data, size_t dst_width, size_t dst_height) {
-    if (!src_data || !dst_data || src_width == 0 || src_height == 0 || 
-        dst_width == 0 || dst_height == 0) {
+// Binary netpbm (P5 grayscale / P6 RGB), streamed one row at a time
+bool decode_pnm(const char* path, Scratch& scratch, const PHashOptimized::Parameters& params) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[2] = {0, 0};
+    if (!in.read(magic, 2) || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6')) {
         return false;
     }
-    
-    // Simple bilinear interpolation resize
-    for (size_t y = 0; y < dst_height; ++y) {
-        double src_y = static_cast<double>(y) * static_cast<double>(src_height) / static_cast<double>(dst_height);
-        size_t src_y_int = static_cast<size_t>(src_y);
-        double y_frac = src_y - src_y_int;
-        
-        for (size_t x = 0; x < dst_width; ++x) {
-            double src_x = static_cast<double>(x) * static_cast<double>(src_width) / static_cast<double>(dst_width);
-            size_t src_x_int = static_cast<size_t>(src_x);
-            double x_frac = src_x - src_x_int;
-            
-            // Bilinear interpolation
-            uint8_t p00 = src_data[std::min(src_y_int, src_height - 1) * src_width + std::min(src_x_int, src_width - 1)];
-            uint8_t p10 = src_data[std::min(src_y_int, src_height - 1) * src_width + std::min(src_x_int + 1, src_width - 1)];
-            uint8_t p01 = src_data[std::min(src_y_int + 1, src_height - 1) * src_width + std::min(src_x_int, src_width - 1)];
-            uint8_t p11 = src_data[std::min(src_y_int + 1, src_height - 1) * src_width + std::min(src_x_int + 1, src_width - 1)];
-            
-            double interpolated = p00 * (1 - x_frac) * (1 - y_frac) +
-                                p10 * x_frac * (1 - y_frac) +
-                                p01 * (1 - x_frac) * y_frac +
-                                p11 * x_frac * y_frac;
-            
-            dst_data[y * dst_width + x] = static_cast<uint8_t>(std::round(interpolated));
+
+    size_t width = 0, height = 0, maxval = 0;
+    if (!read_pnm_value(in, width) || !read_pnm_value(in, height) || !read_pnm_value(in, maxval) ||
+        width == 0 || height == 0 || maxval == 0 || maxval > 255) {
+        return false;
+    }
+
+    const int channels = (magic[1] == '6') ? 3 : 1;
+    begin_image(scratch, width, height, params);
+    scratch.row.resize(width * channels);
+    for (size_t y = 0; y < height; ++y) {
+        if (!in.read(reinterpret_cast<char*>(scratch.row.data()), static_cast<std::streamsize>(scratch.row.size()))) {
+            return false;
         }
+        scratch.downscaler.add_color_row(scratch.row.data(), channels);
     }
-    
     return true;
 }
 
-bool PHashOptimized::convert_to_grayscale(const uint8_t* src_data, size_t width, size_t height,
-                                        int channels, uint8_t* gray_data) {
-    if (!src_data || !gray_data || width == 0 || height == 0 || channels < 1) {
+#ifdef PHASH_HAVE_JPEG
+struct JpegErrorManager {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+void jpeg_error_exit(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<JpegErrorManager*>(cinfo->err)->jump, 1);
+}
+
+void jpeg_silent_message(j_common_ptr, int) {
+}
+
+// JPEG decoded straight to luminance at the smallest DCT scale that still
+// leaves at least 2x the hash grid, so a 24 MP photo decodes at 1/8 size
+bool decode_jpeg(const char* path, Scratch& scratch, const PHashOptimized::Parameters& params) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
         return false;
     }
-    
-    if (channels == 1) {
-        // Already grayscale
-        memcpy(gray_data, src_data, width * height);
-        return true;
+
+    jpeg_decompress_struct cinfo;
+    JpegErrorManager jerr;
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpeg_error_exit;
+    jerr.pub.emit_message = jpeg_silent_message;
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        std::fclose(file);
+        return false;
     }
-    
-    // Convert to grayscale using luminance formula
-    for (size_t i = 0; i < width * height; ++i) {
-        uint8_t r = src_data[i * channels];
-        uint8_t g = src_data[i * channels + 1];
-        uint8_t b = src_data[i * channels + 2];
-        
-        // Standard luminance formula
-        gray_data[i] = static_cast<uint8_t>(0.299 * r + 0.587 * g + 0.114 * b);
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    jpeg_read_header(&cinfo, TRUE);
+
+    if (cinfo.jpeg_color_space != JCS_GRAYSCALE && cinfo.jpeg_color_space != JCS_YCbCr &&
+        cinfo.jpeg_color_space != JCS_RGB) {
+        jpeg_destroy_decompress(&cinfo);
+        std::fclose(file);
+        return false;
     }
-    
+    cinfo.out_color_space = JCS_GRAYSCALE;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.do_block_smoothing = FALSE;
+
+    const JDIMENSION target = static_cast<JDIMENSION>(2 * params.dct_size);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 8;
+    jpeg_calc_output_dimensions(&cinfo);
+    while (cinfo.scale_denom > 1 && (cinfo.output_width < target || cinfo.output_height < target)) {
+        cinfo.scale_denom /= 2;
+        jpeg_calc_output_dimensions(&cinfo);
+    }
+
+    jpeg_start_decompress(&cinfo);
+    begin_image(scratch, cinfo.output_width, cinfo.output_height, params);
+    // Row buffer owned by libjpeg so a longjmp cannot leak it
+    JSAMPARRAY row = (*cinfo.mem->alloc_sarray)(reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE,
+                                                cinfo.output_width * cinfo.output_components, 1);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        jpeg_read_scanlines(&cinfo, row, 1);
+        scratch.downscaler.add_color_row(row[0], cinfo.output_components);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    std::fclose(file);
     return true;
 }
+#endif
 
-void PHashOptimized::normalize_image(uint8_t* image_data, size_t width, size_t height) {
-    if (!image_data || width == 0 || height == 0) {
-        return;
+// Run fn(i) for i in [0, count) across worker threads
+template<typename Fn>
+void parallel_for(size_t count, size_t num_threads, Fn fn) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
     }
-    
-    size_t total_pixels = width * height;
-    
-    // Calculate mean
-    uint64_t sum = 0;
-    for (size_t i = 0; i < total_pixels; ++i) {
-        sum += image_data[i];
+    num_threads = std::min(num_threads, count);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
     }
-    double mean = static_cast<double>(sum) / static_cast<double>(total_pixels);
-    
-    // Calculate standard deviation
-    double sum_sq_diff = 0.0;
-    for (size_t i = 0; i < total_pixels; ++i) {
-        double diff = static_cast<double>(image_data[i]) - mean;
-        sum_sq_diff += diff * diff;
+
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (size_t t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                fn(i);
+            }
+        });
     }
-    double std_dev = std::sqrt(sum_sq_diff / static_cast<double>(total_pixels));
-    
-    // Normalize to zero mean and unit variance
-    const double epsilon = 1e-8;
-    if (std_dev > epsilon) {
-        for (size_t i = 0; i < total_pixels; ++i) {
-            double normalized = ((static_cast<double>(image_data[i]) - mean) / std_dev) * 128.0 + 128.0;
-            image_data[i] = static_cast<uint8_t>(std::clamp(normalized, 0.0, 255.0));
-        }
+    for (auto& worker : workers) {
+        worker.join();
     }
 }
 
-bool PHashOptimized::compute_dct(const uint8_t* image_data, size_t width, size_t height,
-                                 double* dct_coefficients) {
-    if (!image_data || !dct_coefficients || width == 0 || height == 0) {
+} // namespace
+
+PHashOptimized::Impl::Impl()
+    : simd_level(detect_simd()), kernel(kernel_for(simd_level)) {
+}
+
+PHashOptimized::PHashOptimized()
+    : m_impl(std::make_unique<Impl>()) {
+}
+
+PHashOptimized::~PHashOptimized() = default;
+
+bool PHashOptimized::compute_phash(const uint8_t* image_data, 
+                                  size_t width, size_t height,
+                                  uint64_t& hash_out) {
+    if (!image_data || width == 0 || height == 0) {
         return false;
     }
     
-    // Simple 2D DCT implementation
-    const size_t N = width; // Assuming square for simplicity
-    
-    // Convert to double and center around 0
-    std::vector<double> centered_image(N * N);
-    for (size_t i = 0; i < N * N; ++i) {
-        centered_image[i] = static_cast<double>(image_data[i]) - 128.0;
+    Parameters params;
+    return compute_phash_with_params(image_data, width, height, params, hash_out);
+}
+
+bool PHashOptimized::compute_phash_file(const char* image_path, uint64_t& hash_out) {
+    if (!image_path) {
+        return false;
     }
     
-    // Precompute cosine values for efficiency
-    std::vector<std::vector<double>> cosines(N, std::vector<double>(N));
-    for (size_t u = 0; u < N; ++u) {
-        for (size_t x = 0; x < N; ++x) {
-            cosines[u][x] = std::cos(M_PI * static_cast<double>(u) * (2.0 * static_cast<double>(x) + 1.0) / (2.0 * static_cast<double>(N)));
+    unsigned char magic[2] = {0, 0};
+    {
+        std::ifstream in(image_path, std::ios::binary);
+        if (!in.read(reinterpret_cast<char*>(magic), 2)) {
+            return false;
         }
     }
     
-    // Compute 2D DCT using separable property
-    std::vector<double> temp(N * N);
-    
-    // Row-wise DCT
-    for (size_t y = 0; y < N; ++y) {
-        for (size_t u = 0; u < N; ++u) {
-            double sum = 0.0;
-            double cu = (u == 0) ? std::sqrt(0.5) : 1.0;
-            
-            for (size_t x = 0; x < N; ++x) {
-                sum += centered_image[y * N + x] * cosines[u][x];
-            }
-            
-            temp[y * N + u] = cu * sum * std::sqrt(2.0 / static_cast<double>(N));
-        }
+    Parameters params;
+    Scratch& scratch = thread_scratch();
+    bool decoded = false;
+    if (magic[0] == 'P') {
+        decoded = decode_pnm(image_path, scratch, params);
     }
-    
-    // Column-wise DCT
-    for (size_t u = 0; u < N; ++u) {
-        for (size_t v = 0; v < N; ++v) {
-            double sum = 0.0;
-            double cv = (v == 0) ? std::sqrt(0.5) : 1.0;
-            
-            for (size_t y = 0; y < N; ++y) {
-                sum += temp[y * N + u] * cosines[v][y];
-            }
-            
-            dct_coefficients[v * N + u] = cv * sum * std::sqrt(2.0 / static_cast<double>(N));
-        }
+#ifdef PHASH_HAVE_JPEG
+    else if (magic[0] == 0xFF && magic[1] == 0xD8) {
+        decoded = decode_jpeg(image_path, scratch, params);
     }
+#endif
     
-    return true;
+    return decoded && finish_image(scratch, params, m_impl->kernel, hash_out);
 }
 
-bool PHashOptimized::extract_hash_from_dct(const double* dct_coefficients, 
-                                          size_t dct_size,
-                                          size_t low_freq_size,
-                                          uint64_t& hash_out) {
-    if (!dct_coefficients || dct_size == 0 || low_freq_size == 0 || low_freq_size > dct_size) {
+bool PHashOptimized::is_supported_image(const char* image_path) {
+    if (!image_path) {
         return false;
     }
+    const char* dot = std::strrchr(image_path, '.');
+    if (!dot) {
+        return false;
+    }
+    std::string extension(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == "pgm" || extension == "ppm" || extension == "pnm") {
+        return true;
+    }
+#ifdef PHASH_HAVE_JPEG
+    if (extension == "jpg" || extension == "jpeg" || extension == "jpe") {
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool PHashOptimized::compute_phash_with_params(const uint8_t* image_data,
+                                               size_t width, size_t height,
+                                               const Parameters& params,
+                                               uint64_t& hash_out) {
+    return hash_pixels(image_data, width, height, 1, params, m_impl->kernel, hash_out);
+}
+
+size_t PHashOptimized::compute_phash_batch(const ImageBatch* images, size_t count, size_t num_threads) {
+    if (!images || count == 0) {
+        return 0;
+    }
     
-    // Extract low frequency components (skip DC component at [0,0])
-    std::vector<double> low_freq_values;
-    low_freq_values.reserve(low_freq_size * low_freq_size - 1); // -1 to skip DC
-    
-    for (size_t y = 0; y < low_freq_size && y < dct_size; ++y) {
-        for (size_t x = 0; x < low_freq_size && x < dct_size; ++x) {
-            // Skip DC component
-            if (x == 0 && y == 0) continue;
-            
-            low_freq_values.push_back(dct_coefficients[y * dct_size + x]);
+    const Parameters params;
+    const Kernel kernel = m_impl->kernel;
+    std::atomic<size_t> success_count{0};
+    parallel_for(count, num_threads, [&](size_t i) {
+        const ImageBatch& image = images[i];
+        if (image.hash_out &&
+            hash_pixels(image.image_data, image.width, image.height, image.channels, params, kernel, *image.hash_out)) {
+            success_count.fetch_add(1, std::memory_order_relaxed);
         }
-    }
+    });
     
-    if (low_freq_values.empty()) {
-        hash_out = 0;
-        return true;
+    return success_count.load();
+}
+
+size_t PHashOptimized::compute_phash_file_batch(const char* const* image_paths, size_t count,
+                                                uint64_t* hashes_out, bool* ok_out, size_t num_threads) {
+    if (!image_paths || !hashes_out || count == 0) {
+        return 0;
     }
     
-    // Calculate median
-    std::vector<double> sorted_values = low_freq_values;
-    std::sort(sorted_values.begin(), sorted_values.end());
-    double median = sorted_values[sorted_values.size() / 2];
+    std::atomic<size_t> success_count{0};
+    parallel_for(count, num_threads, [&](size_t i) {
+        hashes_out[i] = 0;
+        const bool ok = compute_phash_file(image_paths[i], hashes_out[i]);
+        if (ok_out) ok_out[i] = ok;
+        if (ok) success_count.fetch_add(1, std::memory_order_relaxed);
+    });
     
-    // Generate hash: bit set if coefficient > median
-    hash_out = 0;
-    for (size_t i = 0; i < std::min(low_freq_values.size(), static_cast<size_t>(64)); ++i) {
-        if (low_freq_values[i] > median) {
-            hash_out |= (1ULL << i);
-        }
+    return success_count.load();
+}
+
+int PHashOptimized::compare_hashes(uint64_t hash1, uint64_t hash2) {
+    // Hamming distance via population count
+    return std::popcount(hash1 ^ hash2);
+}
+
+bool PHashOptimized::is_similar(uint64_t hash1, uint64_t hash2, int threshold) {
+    return compare_hashes(hash1, hash2) <= threshold;
+}
+
+PHashOptimized::SimdLevel PHashOptimized::get_simd_level() const {
+    return m_impl ? m_impl->simd_level : SimdLevel::NONE;
+}
+
+PHashOptimized::SimdLevel PHashOptimized::detect_simd() {
+#if defined(_MSC_VER)
+    int cpu_info[4];
+    __cpuidex(cpu_info, 7, 0);
+    if ((cpu_info[1] & (1 << 16)) != 0) { // AVX512F bit
+        return SimdLevel::AVX512;
+    }
+    if ((cpu_info[1] & (1 << 5)) != 0) { // AVX2 bit
+        return SimdLevel::AVX2;
     }
+    __cpuid(cpu_info, 1);
+    if ((cpu_info[3] & (1 << 26)) != 0) { // SSE2 bit
+        return SimdLevel::SSE2;
+    }
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE2;
+    }
+#endif
     
-    return true;
+    return SimdLevel::NONE;
 }
 
-// LSHIndex implementation
-LSHIndex::LSHIndex(const Parameters& params) 
+// PHashMultiIndex implementation
+PHashMultiIndex::PHashMultiIndex(const Parameters& params) 
     : m_impl(std::make_unique<Impl>()) {
+    m_impl->params = params;
 }
 
-LSHIndex::~LSHIndex() = default;
+PHashMultiIndex::~PHashMultiIndex() = default;
 
-bool LSHIndex::add_hash(size_t image_id, uint64_t hash) {
-    // Implementation would add hash to LSH index
+bool PHashMultiIndex::add_hash(size_t image_id, uint64_t hash) {
+    auto it = m_impl->slot_of.find(image_id);
+    if (it != m_impl->slot_of.end()) {
+        m_impl->removed[it->second] = 1;
+        m_impl->slot_of.erase(it);
+    }
+    if (m_impl->hashes.size() >= UINT32_MAX) {
+        return false;
+    }
+    
+    m_impl->slot_of[image_id] = static_cast<uint32_t>(m_impl->hashes.size());
+    m_impl->hashes.push_back(hash);
+    m_impl->image_ids.push_back(image_id);
+    m_impl->removed.push_back(0);
+    m_impl->dirty = true;
     return true;
 }
 
-bool LSHIndex::add_hashes(const size_t* image_ids, const uint64_t* hashes, size_t count) {
+bool PHashMultiIndex::add_hashes(const size_t* image_ids, const uint64_t* hashes, size_t count) {
     if (!image_ids || !hashes || count == 0) {
         return false;
     }
     
+    m_impl->hashes.reserve(m_impl->hashes.size() + count);
+    m_impl->image_ids.reserve(m_impl->image_ids.size() + count);
+    m_impl->removed.reserve(m_impl->removed.size() + count);
+    
     bool success = true;
     for (size_t i = 0; i < count; ++i) {
         success &= add_hash(image_ids[i], hashes[i]);
@@ -363,38 +670,178 @@ bool LSHIndex::add_hashes(const size_t* image_ids, const uint64_t* hashes, size_
     return success;
 }
 
-size_t LSHIndex::query_similar(uint64_t query_hash, Candidate* candidates, size_t max_candidates) {
-    // Implementation would query LSH index for similar hashes
-    return 0;
+size_t PHashMultiIndex::query_similar(uint64_t query_hash, Candidate* candidates, size_t max_candidates) {
+    return query_similar_with_threshold(query_hash, m_impl->params.similarity_threshold,
+                                        candidates, max_candidates);
 }
 
-size_t LSHIndex::query_similar_with_threshold(uint64_t query_hash, int threshold,
+size_t PHashMultiIndex::query_similar_with_threshold(uint64_t query_hash, int threshold,
                                               Candidate* candidates, size_t max_candidates) {
-    // Implementation would query with custom threshold
-    return 0;
+    if (!candidates || max_candidates == 0) {
+        return 0;
+    }
+    if (m_impl->dirty) {
+        m_impl->rebuild();
+    }
+    
+    std::vector<Candidate> found;
+    m_impl->probe(query_hash, threshold, [&](uint32_t slot, int distance) {
+        found.push_back({m_impl->image_ids[slot], m_impl->hashes[slot], distance,
+                         1.0 - static_cast<double>(distance) / 64.0});
+    });
+    
+    std::sort(found.begin(), found.end(), [](const Candidate& a, const Candidate& b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.image_id < b.image_id;
+    });
+    
+    size_t n = std::min(found.size(), max_candidates);
+    std::copy(found.begin(), found.begin() + static_cast<std::ptrdiff_t>(n), candidates);
+    return n;
+}
+
+std::vector<PHashMultiIndex::Pair> PHashMultiIndex::find_similar_pairs(int threshold, size_t num_threads) {
+    if (m_impl->dirty) {
+        m_impl->rebuild();
+    }
+    
+    const size_t n = m_impl->hashes.size();
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::max<size_t>(1, std::min(num_threads, n / 1024 + 1));
+    
+    // Each worker joins a contiguous slot range; results concatenate in slot order
+    const Impl& impl = *m_impl;
+    std::vector<std::vector<Pair>> partial(num_threads);
+    auto worker = [&impl, &partial, threshold, n, num_threads](size_t w) {
+        const size_t begin = n * w / num_threads;
+        const size_t end = n * (w + 1) / num_threads;
+        std::vector<std::pair<uint32_t, int>> hits;
+        for (size_t i = begin; i < end; ++i) {
+            hits.clear();
+            impl.probe(impl.hashes[i], threshold, [&](uint32_t slot, int distance) {
+                if (slot > i) {
+                    hits.emplace_back(slot, distance);
+                }
+            });
+            std::sort(hits.begin(), hits.end());
+            for (const auto& [slot, distance] : hits) {
+                partial[w].push_back({impl.image_ids[i], impl.image_ids[slot], distance});
+            }
+        }
+    };
+    
+    if (num_threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t w = 0; w < num_threads; ++w) {
+            threads.emplace_back(worker, w);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+    
+    std::vector<Pair> pairs;
+    for (auto& p : partial) {
+        pairs.insert(pairs.end(), p.begin(), p.end());
+    }
+    return pairs;
 }
 
-bool LSHIndex::remove_hash(size_t image_id) {
-    // Implementation would remove hash from index
+bool PHashMultiIndex::remove_hash(size_t image_id) {
+    auto it = m_impl->slot_of.find(image_id);
+    if (it == m_impl->slot_of.end()) {
+        return false;
+    }
+    
+    // Tombstone; the slot is dropped on the next rebuild
+    m_impl->removed[it->second] = 1;
+    m_impl->slot_of.erase(it);
     return true;
 }
 
-void LSHIndex::clear() {
-    // Implementation would clear index
+void PHashMultiIndex::clear() {
+    Parameters params = m_impl->params;
+    m_impl = std::make_unique<Impl>();
+    m_impl->params = params;
 }
 
-LSHIndex::Statistics LSHIndex::get_statistics() const {
-    Statistics stats = {0};
-    // Implementation would populate statistics
+PHashMultiIndex::Statistics PHashMultiIndex::get_statistics() const {
+    Statistics stats = {0, 0, 0, 0.0};
+    stats.total_images = m_impl->live_count();
+    
+    if (!m_impl->dirty) {
+        size_t entries = 0;
+        for (const auto& table : m_impl->tables) {
+            for (size_t k = 0; k + 1 < table.offsets.size(); ++k) {
+                if (table.offsets[k + 1] != table.offsets[k]) {
+                    stats.total_buckets++;
+                }
+            }
+            entries += table.slots.size();
+        }
+        if (stats.total_buckets > 0) {
+            stats.average_bucket_size = entries / stats.total_buckets;
+            stats.load_factor = static_cast<double>(entries) / static_cast<double>(stats.total_buckets);
+        }
+    }
     return stats;
 }
 
-bool LSHIndex::save_to_file(const char* filepath) const {
-    // Implementation would save index to file
-    return true;
+bool PHashMultiIndex::save_to_file(const char* filepath) const {
+    if (!filepath) {
+        return false;
+    }
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    
+    // Tables are rebuilt on load; only (image id, hash) pairs are persisted
+    uint32_t magic = PHASH_INDEX_MAGIC;
+    uint64_t count = m_impl->live_count();
+    out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (size_t i = 0; i < m_impl->hashes.size(); ++i) {
+        if (m_impl->removed[i]) continue;
+        uint64_t id = m_impl->image_ids[i];
+        out.write(reinterpret_cast<const char*>(&id), sizeof(id));
+        out.write(reinterpret_cast<const char*>(&m_impl->hashes[i]), sizeof(uint64_t));
+    }
+    return static_cast<bool>(out);
 }
 
-bool LSHIndex::load_from_file(const char* filepath) {
-    // Implementation would load index from file
-    return true;
-}
\ No newline at end of file
+bool PHashMultiIndex::load_from_file(const char* filepath) {
+    if (!filepath) {
+        return false;
+    }
+    std::ifstream in(filepath, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    
+    uint32_t magic = 0;
+    uint64_t count = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || magic != PHASH_INDEX_MAGIC || count >= UINT32_MAX) {
+        return false;
+    }
+    
+    std::vector<size_t> ids(static_cast<size_t>(count));
+    std::vector<uint64_t> hashes(static_cast<size_t>(count));
+    for (size_t i = 0; i < ids.size(); ++i) {
+        uint64_t id = 0;
+        in.read(reinterpret_cast<char*>(&id), sizeof(id));
+        in.read(reinterpret_cast<char*>(&hashes[i]), sizeof(uint64_t));
+        ids[i] = static_cast<size_t>(id);
+    }
+    if (!in) {
+        return false;
+    }
+    
+    clear();
+    return count == 0 || add_hashes(ids.data(), hashes.data(), ids.size());
+}
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <cstddef>
 #include <memory>
+#include <vector>
 
 // Optimized perceptual hash for images
 class PHashOptimized {
@@ -32,9 +33,13 @@ public:
                        size_t width, size_t height,
                        uint64_t& hash_out);
     
-    // Compute pHash for image file
+    // Compute pHash for image file. Rows are streamed into the downscaler as
+    // they are decoded; JPEG is decoded at reduced DCT scale when available.
     bool compute_phash_file(const char* image_path, uint64_t& hash_out);
     
+    // True if compute_phash_file can decode this file type (by extension)
+    static bool is_supported_image(const char* image_path);
+    
     // Compute pHash with custom parameters
     struct Parameters {
         size_t dct_size;           // DCT size (16, 32, 64)
@@ -52,15 +57,22 @@ public:
                                    const Parameters& params,
                                    uint64_t& hash_out);
     
-    // Batch computation for multiple images
+    // Batch computation for multiple images; each worker thread keeps its own
+    // scratch arena. num_threads = 0 uses all hardware threads.
     struct ImageBatch {
         const uint8_t* image_data;
         size_t width;
         size_t height;
         uint64_t* hash_out; // Output hash
+        int channels = 1;   // 1 = grayscale, 3/4 = interleaved RGB(A)
     };
     
-    size_t compute_phash_batch(const ImageBatch* images, size_t count);
+    size_t compute_phash_batch(const ImageBatch* images, size_t count, size_t num_threads = 0);
+    
+    // Hash count files; ok_out (optional) receives per-file success
+    size_t compute_phash_file_batch(const char* const* image_paths, size_t count,
+                                    uint64_t* hashes_out, bool* ok_out = nullptr,
+                                    size_t num_threads = 0);
     
     // Compare two hashes (Hamming distance)
     static int compare_hashes(uint64_t hash1, uint64_t hash2);
@@ -74,36 +86,26 @@ public:
 private:
     // Detect available SIMD instructions
     static SimdLevel detect_simd();
-    
-    // Resize image to target size
-    static bool resize_image(const uint8_t* src_data, size_t src_width, size_t src_height,
-                           uint8_t* dst_data, size_t dst_width, size_t dst_height);
-    
-    // Convert to grayscale if needed
-    static bool convert_to_grayscale(const uint8_t* src_data, size_t width, size_t height,
-                                   int channels, uint8_t* gray_data);
-    
-    // Normalize image brightness and contrast
-    static void normalize_image(uint8_t* image_data, size_t width, size_t height);
-    
-    // Compute 2D DCT
-    static bool compute_dct(const uint8_t* image_data, size_t width, size_t height,
-                          double* dct_coefficients);
-    
-    // Extract low frequency components and compute hash
-    static bool extract_hash_from_dct(const double* dct_coefficients, 
-                                     size_t dct_size,
-                                     size_t low_freq_size,
-                                     uint64_t& hash_out);
 };
 
-// Locality Sensitive Hashing for perceptual similarity
-class LSHIndex {
+// Hamming-space index for 64-bit perceptual hashes (multi-index hashing).
+// Each hash is split into m disjoint substrings with one exact-match table per
+// substring. By the pigeonhole principle two hashes within distance r agree to
+// within floor(r/m) bits on at least one substring, so a radius query only
+// probes the small substring neighbourhoods instead of scanning every hash.
+class PHashMultiIndex {
 public:
     struct Candidate {
         size_t image_id;
         uint64_t hash;
-        double similarity_score;
+        int distance;             // Hamming distance to the query
+        double similarity_score;  // 1.0 - distance / 64
+    };
+    
+    struct Pair {
+        size_t image_id_a;
+        size_t image_id_b;
+        int distance;
     };
     
 private:
@@ -111,34 +113,35 @@ private:
     std::unique_ptr<Impl> m_impl;
     
 public:
-    // LSH parameters
+    // Index parameters
     struct Parameters {
-        size_t num_hash_tables;    // Number of hash tables
-        size_t num_hash_functions; // Number of hash functions per table
-        size_t bucket_size;        // Maximum items per bucket
-        int similarity_threshold;  // Hamming distance threshold
+        size_t num_hash_tables;    // Substrings per hash (2-8, 0 = pick from index size)
+        int similarity_threshold;  // Default Hamming radius for query_similar
         
         Parameters()
-            : num_hash_tables(16), num_hash_functions(8),
-              bucket_size(100), similarity_threshold(5) {}
+            : num_hash_tables(0), similarity_threshold(5) {}
     };
     
-    LSHIndex(const Parameters& params = Parameters());
-    ~LSHIndex();
+    PHashMultiIndex(const Parameters& params = Parameters());
+    ~PHashMultiIndex();
     
-    // Add image hash to index
+    // Add image hash to index (replaces an existing entry with the same id)
     bool add_hash(size_t image_id, uint64_t hash);
     
     // Add multiple hashes
     bool add_hashes(const size_t* image_ids, const uint64_t* hashes, size_t count);
     
-    // Query similar images
+    // Query similar images (default threshold), nearest first
     size_t query_similar(uint64_t query_hash, Candidate* candidates, size_t max_candidates);
     
-    // Query similar images with custom threshold
+    // Query similar images with custom threshold, nearest first
     size_t query_similar_with_threshold(uint64_t query_hash, int threshold,
                                       Candidate* candidates, size_t max_candidates);
     
+    // All pairs within threshold (self-join), ordered by (a, b) insertion order.
+    // num_threads = 0 uses all hardware threads.
+    std::vector<Pair> find_similar_pairs(int threshold, size_t num_threads = 0);
+    
     // Remove image from index
     bool remove_hash(size_t image_id);
     
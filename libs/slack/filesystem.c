@@ -1,4 +1,277 @@
 #include "filesystem.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-// This is a placeholder for more detailed filesystem analysis
-// In a full implementation, this would contain detailed filesystem-specific code
\ No newline at end of file
+// ext2/3/4 on-disk layout (all fields little-endian)
+#define EXT_SUPERBLOCK_OFFSET 1024
+#define EXT_SUPERBLOCK_SIZE 1024
+#define EXT_MAGIC 0xEF53
+
+#define EXT_FEATURE_COMPAT_HAS_JOURNAL 0x0004
+#define EXT_FEATURE_INCOMPAT_META_BG 0x0010
+#define EXT_FEATURE_INCOMPAT_EXTENTS 0x0040
+#define EXT_FEATURE_INCOMPAT_64BIT 0x0080
+#define EXT_FEATURE_INCOMPAT_FLEX_BG 0x0200
+#define EXT_FEATURE_RO_COMPAT_SPARSE_SUPER 0x0001
+
+#define EXT_BG_BLOCK_UNINIT 0x0002
+
+struct slack_fs {
+    int fd;
+    const char* type;
+    uint64_t block_size;
+    uint64_t blocks_count;
+    uint64_t free_blocks;
+    uint64_t first_data_block;
+    uint64_t blocks_per_group;
+    uint64_t group_count;
+    uint64_t inode_table_blocks;    // Per group
+    uint64_t gdt_blocks;            // Group descriptor table, without the reserved blocks
+    uint32_t reserved_gdt_blocks;
+    uint32_t desc_size;
+    int sparse_super;
+    uint8_t* descriptors;           // group_count * desc_size bytes
+    uint8_t* bitmap;                // One block
+};
+
+static uint16_t le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int read_fully(int fd, void* buffer, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, (uint8_t*)buffer + done, size - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+slack_fs_t* slack_fs_open(const char* device_path) {
+    if (!device_path) {
+        return NULL;
+    }
+    int fd = open(device_path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    uint8_t sb[EXT_SUPERBLOCK_SIZE];
+    if (read_fully(fd, sb, sizeof(sb), EXT_SUPERBLOCK_OFFSET) != 0 || le16(sb + 0x38) != EXT_MAGIC) {
+        close(fd);
+        return NULL;
+    }
+
+    slack_fs_t* fs = (slack_fs_t*)calloc(1, sizeof(slack_fs_t));
+    if (!fs) {
+        close(fd);
+        return NULL;
+    }
+    fs->fd = fd;
+
+    const uint32_t compat = le32(sb + 0x5C);
+    const uint32_t incompat = le32(sb + 0x60);
+    const uint32_t ro_compat = le32(sb + 0x64);
+    const uint32_t log_block_size = le32(sb + 0x18);
+    const int is_64bit = (incompat & EXT_FEATURE_INCOMPAT_64BIT) != 0;
+
+    fs->block_size = log_block_size <= 6 ? (uint64_t)1024 << log_block_size : 0;
+    fs->blocks_count = le32(sb + 0x04) | (is_64bit ? (uint64_t)le32(sb + 0x150) << 32 : 0);
+    fs->free_blocks = le32(sb + 0x0C) | (is_64bit ? (uint64_t)le32(sb + 0x158) << 32 : 0);
+    fs->first_data_block = le32(sb + 0x14);
+    fs->blocks_per_group = le32(sb + 0x20);
+    fs->desc_size = is_64bit ? le16(sb + 0xFE) : 32;
+    fs->reserved_gdt_blocks = le16(sb + 0xCE);
+    fs->sparse_super = (ro_compat & EXT_FEATURE_RO_COMPAT_SPARSE_SUPER) != 0;
+    const uint32_t inodes_per_group = le32(sb + 0x28);
+    const uint32_t inode_size = le32(sb + 0x4C) >= 1 ? le16(sb + 0x58) : 128;   // Revision 0 has 128-byte inodes
+
+    if (incompat & (EXT_FEATURE_INCOMPAT_EXTENTS | EXT_FEATURE_INCOMPAT_64BIT | EXT_FEATURE_INCOMPAT_FLEX_BG)) {
+        fs->type = "ext4";
+    } else if (compat & EXT_FEATURE_COMPAT_HAS_JOURNAL) {
+        fs->type = "ext3";
+    } else {
+        fs->type = "ext2";
+    }
+
+    // meta_bg spreads the descriptors over the groups; not read here
+    if (fs->block_size == 0 || fs->blocks_per_group == 0 || fs->blocks_count <= fs->first_data_block ||
+        fs->desc_size < 32 || (incompat & EXT_FEATURE_INCOMPAT_META_BG)) {
+        slack_fs_close(fs);
+        errno = ENOTSUP;
+        return NULL;
+    }
+    fs->group_count = (fs->blocks_count - fs->first_data_block + fs->blocks_per_group - 1) / fs->blocks_per_group;
+    fs->inode_table_blocks = ((uint64_t)inodes_per_group * inode_size + fs->block_size - 1) / fs->block_size;
+    const uint64_t table_size = fs->group_count * fs->desc_size;
+    fs->gdt_blocks = (table_size + fs->block_size - 1) / fs->block_size;
+
+    // The descriptor table follows the superblock's block
+    fs->descriptors = (uint8_t*)malloc((size_t)table_size);
+    fs->bitmap = (uint8_t*)malloc((size_t)fs->block_size);
+    if (!fs->descriptors || !fs->bitmap ||
+        read_fully(fd, fs->descriptors, (size_t)table_size, (fs->first_data_block + 1) * fs->block_size) != 0) {
+        slack_fs_close(fs);
+        return NULL;
+    }
+    return fs;
+}
+
+void slack_fs_close(slack_fs_t* fs) {
+    if (fs) {
+        if (fs->fd >= 0) {
+            close(fs->fd);
+        }
+        free(fs->descriptors);
+        free(fs->bitmap);
+        free(fs);
+    }
+}
+
+uint64_t slack_fs_block_size(const slack_fs_t* fs) {
+    return fs ? fs->block_size : 0;
+}
+
+int slack_fs_get_info(const slack_fs_t* fs, filesystem_info_t* info) {
+    if (!fs || !info) {
+        return -1;
+    }
+    memset(info, 0, sizeof(filesystem_info_t));
+    info->filesystem_type = strdup(fs->type);
+    if (!info->filesystem_type) {
+        return -1;
+    }
+    info->block_size = fs->block_size;
+    info->cluster_size = fs->block_size;
+    info->total_clusters = fs->blocks_count;
+    info->free_clusters = fs->free_blocks;
+    info->used_clusters = fs->blocks_count - fs->free_blocks;
+    return 0;
+}
+
+// Whether a group holds a backup of the superblock and descriptors
+static int group_has_super(const slack_fs_t* fs, uint64_t group) {
+    if (!fs->sparse_super || group <= 1) {
+        return 1;
+    }
+    static const uint64_t bases[] = {3, 5, 7};
+    for (size_t b = 0; b < 3; b++) {
+        uint64_t power = bases[b];
+        while (power < group) {
+            power *= bases[b];
+        }
+        if (power == group) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void mark_used(uint8_t* bitmap, uint64_t group_start, uint64_t group_blocks, uint64_t block, uint64_t count) {
+    for (uint64_t b = block; b < block + count; b++) {
+        if (b >= group_start && b < group_start + group_blocks) {
+            const uint64_t bit = b - group_start;
+            bitmap[bit / 8] |= (uint8_t)(1u << (bit % 8));
+        }
+    }
+}
+
+// The bitmap the kernel derives for a group whose bitmap is uninitialized:
+// its superblock backup, descriptors and own bitmaps and inode table
+static void uninit_bitmap(const slack_fs_t* fs, uint64_t group, const uint8_t* desc, uint64_t group_start,
+                          uint64_t group_blocks) {
+    memset(fs->bitmap, 0, (size_t)fs->block_size);
+    if (group_has_super(fs, group)) {
+        mark_used(fs->bitmap, group_start, group_blocks, group_start, 1 + fs->gdt_blocks + fs->reserved_gdt_blocks);
+    }
+    const int wide = fs->desc_size >= 64;
+    const uint64_t block_bitmap = le32(desc + 0x00) | (wide ? (uint64_t)le32(desc + 0x20) << 32 : 0);
+    const uint64_t inode_bitmap = le32(desc + 0x04) | (wide ? (uint64_t)le32(desc + 0x24) << 32 : 0);
+    const uint64_t inode_table = le32(desc + 0x08) | (wide ? (uint64_t)le32(desc + 0x28) << 32 : 0);
+    mark_used(fs->bitmap, group_start, group_blocks, block_bitmap, 1);
+    mark_used(fs->bitmap, group_start, group_blocks, inode_bitmap, 1);
+    mark_used(fs->bitmap, group_start, group_blocks, inode_table, fs->inode_table_blocks);
+}
+
+int slack_fs_free_runs(slack_fs_t* fs, slack_fs_run_fn callback, void* user_data) {
+    if (!fs || !callback) {
+        return -1;
+    }
+    // A run stays open across groups until a used block ends it
+    uint64_t run_start = 0;
+    uint64_t run_length = 0;
+    for (uint64_t g = 0; g < fs->group_count; g++) {
+        const uint8_t* desc = fs->descriptors + g * fs->desc_size;
+        const uint64_t group_start = fs->first_data_block + g * fs->blocks_per_group;
+        uint64_t group_blocks = fs->blocks_count - group_start;
+        if (group_blocks > fs->blocks_per_group) {
+            group_blocks = fs->blocks_per_group;
+        }
+        if (group_blocks > fs->block_size * 8) {
+            return -1;   // More blocks than one bitmap block describes
+        }
+
+        if (le16(desc + 0x12) & EXT_BG_BLOCK_UNINIT) {
+            uninit_bitmap(fs, g, desc, group_start, group_blocks);
+        } else {
+            const uint64_t bitmap_block = le32(desc + 0x00) |
+                                          (fs->desc_size >= 64 ? (uint64_t)le32(desc + 0x20) << 32 : 0);
+            if (bitmap_block >= fs->blocks_count ||
+                read_fully(fs->fd, fs->bitmap, (size_t)fs->block_size, bitmap_block * fs->block_size) != 0) {
+                return -1;
+            }
+        }
+
+        uint64_t bit = 0;
+        while (bit < group_blocks) {
+            // Whole bytes of free or used blocks at a time
+            if (bit % 8 == 0 && bit + 8 <= group_blocks) {
+                const uint8_t byte = fs->bitmap[bit / 8];
+                if (byte == 0x00) {
+                    if (run_length == 0) {
+                        run_start = group_start + bit;
+                    }
+                    run_length += 8;
+                    bit += 8;
+                    continue;
+                }
+                if (byte == 0xFF) {
+                    if (run_length > 0 && callback(run_start, run_length, user_data) != 0) {
+                        return 0;
+                    }
+                    run_length = 0;
+                    bit += 8;
+                    continue;
+                }
+            }
+            if (fs->bitmap[bit / 8] & (1u << (bit % 8))) {
+                if (run_length > 0 && callback(run_start, run_length, user_data) != 0) {
+                    return 0;
+                }
+                run_length = 0;
+            } else {
+                if (run_length == 0) {
+                    run_start = group_start + bit;
+                }
+                run_length++;
+            }
+            bit++;
+        }
+    }
+    if (run_length > 0) {
+        callback(run_start, run_length, user_data);
+    }
+    return 0;
+}
@@ -1,15 +1,47 @@
 #ifndef LIBS_SLACK_FILESYSTEM_H
 #define LIBS_SLACK_FILESYSTEM_H
 
+#include <stdint.h>
+#include <stddef.h>
+#include "slack.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// This is a placeholder for more detailed filesystem analysis
-// In a full implementation, this would contain detailed filesystem-specific code
+// Allocation state of a filesystem read straight from its raw device or
+// image, without mounting it. ext2, ext3 and ext4 are read from their block
+// group descriptors and block bitmaps (not with meta_bg).
+typedef struct slack_fs slack_fs_t;
+
+// Called for each run of free blocks, in block order
+// Returns 0 to go on, non-zero to stop
+typedef int (*slack_fs_run_fn)(uint64_t first_block, uint64_t block_count, void* user_data);
+
+// Open a raw device or image
+// Returns NULL if it cannot be read or holds no supported filesystem
+slack_fs_t* slack_fs_open(const char* device_path);
+
+// Close a filesystem opened with slack_fs_open
+void slack_fs_close(slack_fs_t* fs);
+
+// Bytes per block (cluster)
+uint64_t slack_fs_block_size(const slack_fs_t* fs);
+
+// Geometry and free space as recorded in the superblock
+// info: output (must be freed with filesystem_info_free)
+// Returns 0 on success, non-zero on error
+int slack_fs_get_info(const slack_fs_t* fs, filesystem_info_t* info);
+
+// Walk the block bitmaps group by group and report each run of free
+// blocks; a run continuing into the next group is reported once. Groups
+// whose bitmap was never initialized are free but for their metadata.
+// Returns 0 on success (or when stopped by the callback), non-zero on a
+// read error
+int slack_fs_free_runs(slack_fs_t* fs, slack_fs_run_fn callback, void* user_data);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif // LIBS_SLACK_FILESYSTEM_H
\ No newline at end of file
+#endif // LIBS_SLACK_FILESYSTEM_H
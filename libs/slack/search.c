@@ -0,0 +1,1100 @@
+#include "search.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <unistd.h>
+
+// Characters in an atom
+#define SEARCH_ATOM_MAX 4
+// Byte combinations an atom may stand for (one automaton entry each)
+#define SEARCH_ATOM_VARIANTS 16
+// Backtracking steps allowed for one match attempt
+#define SEARCH_MATCH_BUDGET 100000
+
+// One pattern element: a byte class repeated min to max times
+typedef struct {
+    uint8_t set[32];
+    uint32_t min;
+    uint32_t max;
+} search_item_t;
+
+// A pattern in one encoding
+typedef struct {
+    uint32_t pattern;
+    uint32_t encoding;
+    size_t max_bytes;           // Longest match
+    size_t atom_offset;         // Bytes from the match start to the atom
+    size_t atom_length;         // Atom bytes; 0 = tried at every offset
+} search_variant_t;
+
+struct slack_searcher {
+    search_item_t* items;
+    size_t* item_begin;         // Items of pattern p: items[item_begin[p] .. item_begin[p + 1])
+    size_t pattern_count;
+    search_variant_t* variants;
+    size_t variant_count;
+    uint32_t* unanchored;       // Variants without an atom
+    size_t unanchored_count;
+    size_t max_bytes;           // Longest match of any variant
+    uint8_t fold[256];          // Automaton input mapping (lower case with SLACK_SEARCH_NOCASE)
+
+    uint16_t* delta;            // state * 256 + byte -> next state
+    uint32_t state_count;
+    uint32_t* out_begin;        // Variants ending at state s: outputs[out_begin[s] .. out_begin[s + 1])
+    uint32_t* outputs;
+    uint8_t is_start[256];      // Bytes that leave the root state
+};
+
+static int in_set(const uint8_t* set, uint8_t b) {
+    return (set[b >> 3] >> (b & 7)) & 1;
+}
+
+static void set_add(uint8_t* set, uint8_t b) {
+    set[b >> 3] |= (uint8_t)(1u << (b & 7));
+}
+
+static size_t set_count(const uint8_t* set) {
+    size_t n = 0;
+    for (int b = 0; b < 256; b++) {
+        n += (size_t)in_set(set, (uint8_t)b);
+    }
+    return n;
+}
+
+static void search_error(char* error, size_t error_size, size_t pattern, const char* message) {
+    if (error && error_size > 0) {
+        snprintf(error, error_size, "pattern %lu: %s", (unsigned long)pattern, message);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Pattern parsing
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    search_item_t* items;
+    size_t count;
+    size_t capacity;
+} item_list_t;
+
+static search_item_t* item_push(item_list_t* list) {
+    if (list->count >= list->capacity) {
+        size_t new_capacity = (list->capacity == 0) ? 16 : list->capacity * 2;
+        search_item_t* new_items = (search_item_t*)realloc(list->items, new_capacity * sizeof(search_item_t));
+        if (!new_items) {
+            return NULL;
+        }
+        list->items = new_items;
+        list->capacity = new_capacity;
+    }
+    search_item_t* item = &list->items[list->count++];
+    memset(item, 0, sizeof(search_item_t));
+    item->min = 1;
+    item->max = 1;
+    return item;
+}
+
+static int hex_digit(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// \d \w \s and their negations
+static int class_escape(int c, uint8_t* set) {
+    const int lower = tolower(c);
+    if (lower != 'd' && lower != 'w' && lower != 's') {
+        return 0;
+    }
+    uint8_t members[32];
+    memset(members, 0, sizeof(members));
+    for (int b = 0; b < 256; b++) {
+        int member = lower == 'd' ? (b >= '0' && b <= '9')
+                   : lower == 'w' ? (b < 128 && (isalnum(b) || b == '_'))
+                   : (b == ' ' || (b >= '\t' && b <= '\r'));
+        if (member != (c != lower)) {
+            set_add(members, (uint8_t)b);
+        }
+    }
+    for (int i = 0; i < 32; i++) {
+        set[i] |= members[i];
+    }
+    return 1;
+}
+
+// A single-byte escape after the backslash at text[*i]; advances *i
+// Returns the byte, or -1 if malformed
+static int byte_escape(const unsigned char* text, size_t* i) {
+    const int c = text[*i];
+    if (c == '\0') {
+        return -1;
+    }
+    (*i)++;
+    switch (c) {
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 't': return '\t';
+        case '0': return 0;
+        case 'x': {
+            const int high = hex_digit(text[*i]);
+            const int low = high < 0 ? -1 : hex_digit(text[*i + 1]);
+            if (low < 0) {
+                return -1;
+            }
+            *i += 2;
+            return high * 16 + low;
+        }
+        default:
+            return isalnum(c) ? -1 : c;   // Escaped punctuation stands for itself
+    }
+}
+
+static const char* parse_class(const unsigned char* text, size_t* i, uint8_t* set) {
+    int negate = 0;
+    if (text[*i] == '^') {
+        negate = 1;
+        (*i)++;
+    }
+    int first = 1;
+    while (text[*i] != ']' || first) {
+        if (text[*i] == '\0') {
+            return "unterminated character class";
+        }
+        first = 0;
+        int low;
+        if (text[*i] == '\\') {
+            (*i)++;
+            if (class_escape(text[*i], set)) {
+                (*i)++;
+                continue;
+            }
+            low = byte_escape(text, i);
+        } else {
+            low = text[(*i)++];
+        }
+        if (low < 0) {
+            return "bad escape";
+        }
+        int high = low;
+        if (text[*i] == '-' && text[*i + 1] != ']' && text[*i + 1] != '\0') {
+            (*i)++;
+            if (text[*i] == '\\') {
+                (*i)++;
+                high = byte_escape(text, i);
+            } else {
+                high = text[(*i)++];
+            }
+            if (high < low) {
+                return "bad range in character class";
+            }
+        }
+        for (int b = low; b <= high; b++) {
+            set_add(set, (uint8_t)b);
+        }
+    }
+    (*i)++;
+    if (negate) {
+        for (int k = 0; k < 32; k++) {
+            set[k] = (uint8_t)~set[k];
+        }
+    }
+    return NULL;
+}
+
+static int parse_number(const unsigned char* text, size_t* i, uint32_t* value) {
+    if (!isdigit(text[*i])) {
+        return -1;
+    }
+    uint32_t v = 0;
+    while (isdigit(text[*i])) {
+        v = v * 10 + (uint32_t)(text[(*i)++] - '0');
+        if (v > SLACK_SEARCH_MAX_REPEAT) {
+            return -1;
+        }
+    }
+    *value = v;
+    return 0;
+}
+
+static const char* parse_quantifier(const unsigned char* text, size_t* i, search_item_t* item) {
+    switch (text[*i]) {
+        case '?': item->min = 0; item->max = 1; (*i)++; break;
+        case '*': item->min = 0; item->max = SLACK_SEARCH_MAX_REPEAT; (*i)++; break;
+        case '+': item->min = 1; item->max = SLACK_SEARCH_MAX_REPEAT; (*i)++; break;
+        case '{':
+            (*i)++;
+            if (parse_number(text, i, &item->min) != 0) {
+                return "bad repeat count";
+            }
+            item->max = item->min;
+            if (text[*i] == ',') {
+                (*i)++;
+                item->max = SLACK_SEARCH_MAX_REPEAT;
+                if (text[*i] != '}' && (parse_number(text, i, &item->max) != 0 || item->max < item->min)) {
+                    return "bad repeat count";
+                }
+            }
+            if (text[*i] != '}') {
+                return "bad repeat count";
+            }
+            (*i)++;
+            break;
+        default:
+            return NULL;
+    }
+    if (text[*i] == '?' || text[*i] == '*' || text[*i] == '+' || text[*i] == '{') {
+        return "repeated quantifier";
+    }
+    return NULL;
+}
+
+static const char* parse_pattern(const slack_pattern_t* pattern, item_list_t* list) {
+    const unsigned char* text = (const unsigned char*)pattern->text;
+    size_t i = 0;
+    while (text[i] != '\0') {
+        search_item_t* item = item_push(list);
+        if (!item) {
+            return "out of memory";
+        }
+        const int c = text[i++];
+        if (!pattern->regex) {
+            set_add(item->set, (uint8_t)c);
+            continue;
+        }
+        if (c == '.') {
+            memset(item->set, 0xFF, sizeof(item->set));
+        } else if (c == '[') {
+            const char* message = parse_class(text, &i, item->set);
+            if (message) {
+                return message;
+            }
+        } else if (c == '\\') {
+            if (!class_escape(text[i], item->set)) {
+                const int b = byte_escape(text, &i);
+                if (b < 0) {
+                    return "bad escape";
+                }
+                set_add(item->set, (uint8_t)b);
+            } else {
+                i++;
+            }
+        } else if (c == '?' || c == '*' || c == '+' || c == '{') {
+            return "quantifier without an element";
+        } else if (c == '(' || c == ')' || c == '|' || c == '^' || c == '$') {
+            return "groups, alternation and anchors are not supported";
+        } else {
+            set_add(item->set, (uint8_t)c);
+        }
+        const char* message = parse_quantifier(text, &i, item);
+        if (message) {
+            return message;
+        }
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Atoms and automaton
+// ---------------------------------------------------------------------------
+
+// Byte classes of the characters at a fixed distance from the match start:
+// the items up to and including the first one of variable length (of which
+// only the mandatory repeats count)
+static size_t fixed_prefix(const search_item_t* items, size_t count, const uint8_t** sets, size_t limit) {
+    size_t n = 0;
+    for (size_t k = 0; k < count && n < limit; k++) {
+        for (uint32_t r = 0; r < items[k].min && n < limit; r++) {
+            sets[n++] = items[k].set;
+        }
+        if (items[k].min != items[k].max) {
+            break;
+        }
+    }
+    return n;
+}
+
+// Bytes an atom character stands for: one per case pair with NOCASE
+static size_t atom_members(const uint8_t* set, const uint8_t* fold, uint8_t* members) {
+    size_t n = 0;
+    for (int b = 0; b < 256; b++) {
+        if (in_set(set, (uint8_t)b) && fold[b] == b) {
+            members[n++] = (uint8_t)b;
+        }
+    }
+    return n;
+}
+
+static int char_quality(const uint8_t* members, size_t count) {
+    if (count == 1) {
+        const uint8_t b = members[0];
+        return (b == 0x00 || b == 0xFF || b == ' ') ? 4 : 10;
+    }
+    return count <= 4 ? 6 : 3;
+}
+
+// Best window of fixed characters: the highest summed quality, then the
+// fewest variants. Returns its length (0 = none usable).
+static size_t choose_atom(const uint8_t** sets, size_t n, const uint8_t* fold, size_t* start) {
+    size_t best_length = 0;
+    int best_score = 0;
+    size_t best_variants = 0;
+    uint8_t members[256];
+    for (size_t s = 0; s < n; s++) {
+        int score = 0;
+        size_t variants = 1;
+        for (size_t l = 1; l <= SEARCH_ATOM_MAX && s + l <= n; l++) {
+            const size_t count = atom_members(sets[s + l - 1], fold, members);
+            variants *= count;
+            if (count == 0 || variants > SEARCH_ATOM_VARIANTS) {
+                break;
+            }
+            score += char_quality(members, count);
+            if (score > best_score || (score == best_score && variants < best_variants)) {
+                best_score = score;
+                best_variants = variants;
+                best_length = l;
+                *start = s;
+            }
+        }
+    }
+    return best_length;
+}
+
+// Trie construction scratch: goto table plus per-node output lists
+typedef struct {
+    int32_t* next;              // node * 256 + byte, -1 if absent
+    int32_t* first_output;      // Head of the node's output list, -1 if none
+    size_t node_count;
+    size_t node_capacity;
+    int32_t* output_next;       // Next output ending at the same node
+    uint32_t* output_variant;
+    size_t output_count;
+    size_t output_capacity;
+} search_trie_t;
+
+static int trie_add(search_trie_t* trie, const uint8_t* bytes, size_t length, uint32_t variant) {
+    int32_t node = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (trie->next[(size_t)node * 256 + bytes[i]] < 0) {
+            if (trie->node_count >= UINT16_MAX) {
+                return -1;
+            }
+            if (trie->node_count >= trie->node_capacity) {
+                const size_t new_capacity = trie->node_capacity * 2;
+                int32_t* next = (int32_t*)realloc(trie->next, new_capacity * 256 * sizeof(int32_t));
+                if (!next) {
+                    return -1;
+                }
+                trie->next = next;
+                int32_t* first = (int32_t*)realloc(trie->first_output, new_capacity * sizeof(int32_t));
+                if (!first) {
+                    return -1;
+                }
+                trie->first_output = first;
+                memset(trie->next + trie->node_capacity * 256, 0xFF,
+                       (new_capacity - trie->node_capacity) * 256 * sizeof(int32_t));
+                memset(trie->first_output + trie->node_capacity, 0xFF,
+                       (new_capacity - trie->node_capacity) * sizeof(int32_t));
+                trie->node_capacity = new_capacity;
+            }
+            trie->next[(size_t)node * 256 + bytes[i]] = (int32_t)trie->node_count++;
+        }
+        node = trie->next[(size_t)node * 256 + bytes[i]];
+    }
+    // The variants of one atom differ in their bytes, so a variant ends at a
+    // node at most once per atom byte string
+    if (trie->output_count >= trie->output_capacity) {
+        const size_t new_capacity = trie->output_capacity * 2;
+        int32_t* next = (int32_t*)realloc(trie->output_next, new_capacity * sizeof(int32_t));
+        if (!next) {
+            return -1;
+        }
+        trie->output_next = next;
+        uint32_t* variants = (uint32_t*)realloc(trie->output_variant, new_capacity * sizeof(uint32_t));
+        if (!variants) {
+            return -1;
+        }
+        trie->output_variant = variants;
+        trie->output_capacity = new_capacity;
+    }
+    trie->output_variant[trie->output_count] = variant;
+    trie->output_next[trie->output_count] = trie->first_output[node];
+    trie->first_output[node] = (int32_t)trie->output_count;
+    trie->output_count++;
+    return 0;
+}
+
+// Add every byte combination of the atom of variant v
+static int add_atom(search_trie_t* trie, const uint8_t** sets, size_t start, size_t length, int wide,
+                    const uint8_t* fold, uint32_t v) {
+    uint8_t members[SEARCH_ATOM_MAX][256];
+    size_t counts[SEARCH_ATOM_MAX];
+    size_t index[SEARCH_ATOM_MAX];
+    for (size_t c = 0; c < length; c++) {
+        counts[c] = atom_members(sets[start + c], fold, members[c]);
+        index[c] = 0;
+    }
+    for (;;) {
+        uint8_t bytes[2 * SEARCH_ATOM_MAX];
+        size_t n = 0;
+        for (size_t c = 0; c < length; c++) {
+            bytes[n++] = members[c][index[c]];
+            if (wide) {
+                bytes[n++] = 0;
+            }
+        }
+        if (trie_add(trie, bytes, n, v) != 0) {
+            return -1;
+        }
+        size_t c = 0;
+        while (c < length && ++index[c] == counts[c]) {
+            index[c++] = 0;
+        }
+        if (c == length) {
+            return 0;
+        }
+    }
+}
+
+static int build_automaton(slack_searcher_t* s, search_trie_t* trie) {
+    s->state_count = (uint32_t)trie->node_count;
+    s->delta = (uint16_t*)malloc((size_t)s->state_count * 256 * sizeof(uint16_t));
+    s->out_begin = (uint32_t*)malloc(((size_t)s->state_count + 1) * sizeof(uint32_t));
+    int32_t* fail = (int32_t*)malloc(trie->node_count * sizeof(int32_t));
+    int32_t* queue = (int32_t*)malloc(trie->node_count * sizeof(int32_t));
+    uint32_t* out_count = (uint32_t*)calloc(trie->node_count, sizeof(uint32_t));
+    int ret = -1;
+    if (!s->delta || !s->out_begin || !fail || !queue || !out_count) {
+        goto done;
+    }
+
+    // Breadth-first, so fail links point to finished shallower states
+    size_t head = 0, tail = 0;
+    fail[0] = 0;
+    for (int c = 0; c < 256; c++) {
+        const int32_t child = trie->next[c];
+        s->delta[c] = child < 0 ? 0 : (uint16_t)child;
+        if (child >= 0) {
+            fail[child] = 0;
+            queue[tail++] = child;
+            s->is_start[c] = 1;
+        }
+    }
+    while (head < tail) {
+        const int32_t u = queue[head++];
+        for (int c = 0; c < 256; c++) {
+            const int32_t v = trie->next[(size_t)u * 256 + c];
+            const uint16_t via_fail = s->delta[(size_t)fail[u] * 256 + c];
+            if (v < 0) {
+                s->delta[(size_t)u * 256 + c] = via_fail;
+            } else {
+                s->delta[(size_t)u * 256 + c] = (uint16_t)v;
+                fail[v] = via_fail;
+                queue[tail++] = v;
+            }
+        }
+    }
+
+    // A state reports its own atoms plus everything its fail link reports
+    for (size_t q = 0; q < tail; q++) {
+        const int32_t u = queue[q];
+        uint32_t own = 0;
+        for (int32_t o = trie->first_output[u]; o >= 0; o = trie->output_next[o]) own++;
+        out_count[u] = own + out_count[fail[u]];
+    }
+    s->out_begin[0] = 0;
+    for (uint32_t q = 0; q < s->state_count; q++) {
+        s->out_begin[q + 1] = s->out_begin[q] + out_count[q];
+    }
+    s->outputs = (uint32_t*)malloc((s->out_begin[s->state_count] + 1) * sizeof(uint32_t));
+    if (!s->outputs) {
+        goto done;
+    }
+    for (size_t q = 0; q < tail; q++) {
+        const int32_t u = queue[q];
+        uint32_t* dst = s->outputs + s->out_begin[u];
+        for (int32_t o = trie->first_output[u]; o >= 0; o = trie->output_next[o]) {
+            *dst++ = trie->output_variant[o];
+        }
+        memcpy(dst, s->outputs + s->out_begin[fail[u]], out_count[fail[u]] * sizeof(uint32_t));
+    }
+    ret = 0;
+
+done:
+    free(fail);
+    free(queue);
+    free(out_count);
+    return ret;
+}
+
+slack_searcher_t* slack_searcher_create(const slack_pattern_t* patterns, size_t count, int flags,
+                                        char* error, size_t error_size) {
+    if (error && error_size > 0) {
+        error[0] = '\0';
+    }
+    if (!patterns || count == 0) {
+        search_error(error, error_size, 0, "no patterns");
+        return NULL;
+    }
+    if (!(flags & (SLACK_SEARCH_ASCII | SLACK_SEARCH_UTF16LE))) {
+        flags |= SLACK_SEARCH_ASCII;
+    }
+    const int nocase = (flags & SLACK_SEARCH_NOCASE) != 0;
+
+    slack_searcher_t* s = (slack_searcher_t*)calloc(1, sizeof(slack_searcher_t));
+    item_list_t list;
+    memset(&list, 0, sizeof(list));
+    search_trie_t trie;
+    memset(&trie, 0, sizeof(trie));
+    const size_t encodings = ((flags & SLACK_SEARCH_ASCII) ? 1 : 0) + ((flags & SLACK_SEARCH_UTF16LE) ? 1 : 0);
+    if (!s) {
+        goto error;
+    }
+    s->pattern_count = count;
+    s->item_begin = (size_t*)malloc((count + 1) * sizeof(size_t));
+    s->variants = (search_variant_t*)calloc(count * encodings, sizeof(search_variant_t));
+    s->unanchored = (uint32_t*)malloc(count * encodings * sizeof(uint32_t));
+    trie.node_capacity = 256;
+    trie.next = (int32_t*)malloc(trie.node_capacity * 256 * sizeof(int32_t));
+    trie.first_output = (int32_t*)malloc(trie.node_capacity * sizeof(int32_t));
+    trie.output_capacity = 256;
+    trie.output_next = (int32_t*)malloc(trie.output_capacity * sizeof(int32_t));
+    trie.output_variant = (uint32_t*)malloc(trie.output_capacity * sizeof(uint32_t));
+    if (!s->item_begin || !s->variants || !s->unanchored || !trie.next || !trie.first_output ||
+        !trie.output_next || !trie.output_variant) {
+        search_error(error, error_size, 0, "out of memory");
+        goto error;
+    }
+    memset(trie.next, 0xFF, trie.node_capacity * 256 * sizeof(int32_t));
+    memset(trie.first_output, 0xFF, trie.node_capacity * sizeof(int32_t));
+    trie.node_count = 1;
+    for (int b = 0; b < 256; b++) {
+        s->fold[b] = (uint8_t)(nocase ? tolower(b) : b);
+    }
+
+    for (size_t p = 0; p < count; p++) {
+        s->item_begin[p] = list.count;
+        if (!patterns[p].text || patterns[p].text[0] == '\0') {
+            search_error(error, error_size, p, "empty pattern");
+            goto error;
+        }
+        const char* message = parse_pattern(&patterns[p], &list);
+        if (message) {
+            search_error(error, error_size, p, message);
+            goto error;
+        }
+        uint64_t min_chars = 0, max_chars = 0;
+        for (size_t k = s->item_begin[p]; k < list.count; k++) {
+            search_item_t* item = &list.items[k];
+            if (nocase) {
+                for (int b = 'a'; b <= 'z'; b++) {
+                    if (in_set(item->set, (uint8_t)b) || in_set(item->set, (uint8_t)toupper(b))) {
+                        set_add(item->set, (uint8_t)b);
+                        set_add(item->set, (uint8_t)toupper(b));
+                    }
+                }
+            }
+            if (set_count(item->set) == 0) {
+                search_error(error, error_size, p, "empty character class");
+                goto error;
+            }
+            min_chars += item->min;
+            max_chars += item->max;
+        }
+        if (min_chars == 0) {
+            search_error(error, error_size, p, "pattern can match an empty string");
+            goto error;
+        }
+        if (max_chars > SLACK_SEARCH_MAX_LENGTH) {
+            search_error(error, error_size, p, "pattern can match too many characters");
+            goto error;
+        }
+
+        const search_item_t* items = list.items + s->item_begin[p];
+        const size_t item_count = list.count - s->item_begin[p];
+        const uint8_t* sets[SLACK_SEARCH_MAX_LENGTH];
+        const size_t fixed = fixed_prefix(items, item_count, sets, SLACK_SEARCH_MAX_LENGTH);
+        size_t atom_start = 0;
+        const size_t atom_chars = choose_atom(sets, fixed, s->fold, &atom_start);
+        for (uint32_t e = 0; e < 2; e++) {
+            if (!(flags & (e == SLACK_ENCODING_ASCII ? SLACK_SEARCH_ASCII : SLACK_SEARCH_UTF16LE))) {
+                continue;
+            }
+            const uint32_t v = (uint32_t)s->variant_count++;
+            const size_t step = e == SLACK_ENCODING_UTF16LE ? 2 : 1;
+            search_variant_t* variant = &s->variants[v];
+            variant->pattern = (uint32_t)p;
+            variant->encoding = e;
+            variant->max_bytes = (size_t)max_chars * step;
+            variant->atom_offset = atom_start * step;
+            variant->atom_length = atom_chars * step;
+            if (variant->max_bytes > s->max_bytes) {
+                s->max_bytes = variant->max_bytes;
+            }
+            if (atom_chars == 0) {
+                s->unanchored[s->unanchored_count++] = v;
+            } else if (add_atom(&trie, sets, atom_start, atom_chars, step == 2, s->fold, v) != 0) {
+                search_error(error, error_size, p, "too many patterns");
+                goto error;
+            }
+        }
+    }
+    s->item_begin[count] = list.count;
+    s->items = list.items;
+    list.items = NULL;
+
+    if (build_automaton(s, &trie) != 0) {
+        search_error(error, error_size, 0, "out of memory");
+        goto error;
+    }
+    free(trie.next);
+    free(trie.first_output);
+    free(trie.output_next);
+    free(trie.output_variant);
+    return s;
+
+error:
+    free(list.items);
+    free(trie.next);
+    free(trie.first_output);
+    free(trie.output_next);
+    free(trie.output_variant);
+    slack_searcher_free(s);
+    return NULL;
+}
+
+void slack_searcher_free(slack_searcher_t* searcher) {
+    if (searcher) {
+        free(searcher->items);
+        free(searcher->item_begin);
+        free(searcher->variants);
+        free(searcher->unanchored);
+        free(searcher->delta);
+        free(searcher->out_begin);
+        free(searcher->outputs);
+        free(searcher);
+    }
+}
+
+void slack_hits_init(slack_hits_t* hits) {
+    if (hits) {
+        hits->hits = NULL;
+        hits->count = 0;
+        hits->capacity = 0;
+    }
+}
+
+void slack_hits_free(slack_hits_t* hits) {
+    if (hits) {
+        free(hits->hits);
+        slack_hits_init(hits);
+    }
+}
+
+static int compare_hits(const void* a, const void* b) {
+    const slack_hit_t* x = (const slack_hit_t*)a;
+    const slack_hit_t* y = (const slack_hit_t*)b;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    if (x->pattern != y->pattern) return x->pattern < y->pattern ? -1 : 1;
+    return (int)x->encoding - (int)y->encoding;
+}
+
+void slack_hits_sort(slack_hits_t* hits) {
+    if (hits && hits->count > 1) {
+        qsort(hits->hits, hits->count, sizeof(slack_hit_t), compare_hits);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Matching
+// ---------------------------------------------------------------------------
+
+// Greedy match of items[k..] at data[pos]; returns the end, or -1
+static long match_items(const search_item_t* items, size_t count, size_t k, const uint8_t* data, size_t size,
+                        size_t pos, size_t step, size_t* budget) {
+    if (k == count) {
+        return (long)pos;
+    }
+    if (*budget == 0) {
+        return -1;
+    }
+    (*budget)--;
+    const search_item_t* item = &items[k];
+    uint32_t n = 0;
+    while (n < item->max) {
+        const size_t at = pos + (size_t)n * step;
+        if (at + step > size || !in_set(item->set, data[at]) || (step == 2 && data[at + 1] != 0)) {
+            break;
+        }
+        n++;
+    }
+    if (n < item->min) {
+        return -1;
+    }
+    for (uint32_t c = n;; c--) {
+        const long end = match_items(items, count, k + 1, data, size, pos + (size_t)c * step, step, budget);
+        if (end >= 0) {
+            return end;
+        }
+        if (c == item->min) {
+            return -1;
+        }
+    }
+}
+
+static int hits_push(slack_hits_t* hits, const slack_hit_t* hit) {
+    if (hits->count >= hits->capacity) {
+        size_t new_capacity = (hits->capacity == 0) ? 16 : hits->capacity * 2;
+        slack_hit_t* new_hits = (slack_hit_t*)realloc(hits->hits, new_capacity * sizeof(slack_hit_t));
+        if (!new_hits) {
+            return -1;
+        }
+        hits->hits = new_hits;
+        hits->capacity = new_capacity;
+    }
+    hits->hits[hits->count++] = *hit;
+    return 0;
+}
+
+// A candidate whose match could run past the data seen so far
+typedef struct {
+    uint64_t start;
+    uint32_t variant;
+} search_candidate_t;
+
+// Search state of one range fed in consecutive pieces. The last max_bytes
+// bytes are carried over; a candidate is confirmed once max_bytes bytes from
+// its start are available, or at the end of the range.
+typedef struct {
+    const slack_searcher_t* searcher;
+    slack_hits_t* hits;
+    size_t range;
+    int active;
+    uint64_t origin;            // Offset of the range start
+    uint64_t next;              // Offset of the next byte expected
+    uint32_t state;
+    uint8_t* carry;             // The bytes before next: carry[0 .. carried)
+    size_t carried;
+    uint8_t* seam;              // Carried bytes followed by the head of the piece
+    size_t seam_size;
+    const uint8_t* piece;
+    size_t piece_size;
+    search_candidate_t* pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    uint64_t* next_allowed;     // Per variant: matches do not overlap
+    uint64_t* next_start;       // Per variant: next offset of an unanchored variant
+} search_stream_t;
+
+static int stream_init(search_stream_t* st, const slack_searcher_t* searcher, slack_hits_t* hits) {
+    memset(st, 0, sizeof(search_stream_t));
+    st->searcher = searcher;
+    st->hits = hits;
+    st->carry = (uint8_t*)malloc(searcher->max_bytes);
+    st->seam = (uint8_t*)malloc(2 * searcher->max_bytes);
+    st->next_allowed = (uint64_t*)malloc(searcher->variant_count * sizeof(uint64_t));
+    st->next_start = (uint64_t*)malloc(searcher->variant_count * sizeof(uint64_t));
+    return st->carry && st->seam && st->next_allowed && st->next_start ? 0 : -1;
+}
+
+static void stream_free(search_stream_t* st) {
+    free(st->carry);
+    free(st->seam);
+    free(st->pending);
+    free(st->next_allowed);
+    free(st->next_start);
+}
+
+static void stream_begin(search_stream_t* st, size_t range, uint64_t offset) {
+    st->range = range;
+    st->active = 1;
+    st->origin = offset;
+    st->next = offset;
+    st->state = 0;
+    st->carried = 0;
+    st->pending_count = 0;
+    for (size_t v = 0; v < st->searcher->variant_count; v++) {
+        st->next_allowed[v] = offset;
+        st->next_start[v] = offset;
+    }
+}
+
+static int verify(search_stream_t* st, uint32_t v, uint64_t start) {
+    if (start < st->next_allowed[v]) {
+        return 0;
+    }
+    const slack_searcher_t* s = st->searcher;
+    const search_variant_t* variant = &s->variants[v];
+    const uint64_t piece_offset = st->next;
+    const uint8_t* data;
+    size_t size, pos;
+    if (start >= piece_offset) {
+        data = st->piece;
+        size = st->piece_size;
+        pos = (size_t)(start - piece_offset);
+    } else {
+        data = st->seam;
+        size = st->seam_size;
+        pos = (size_t)(start - (piece_offset - st->carried));
+    }
+    const size_t first = s->item_begin[variant->pattern];
+    const size_t count = s->item_begin[variant->pattern + 1] - first;
+    size_t budget = SEARCH_MATCH_BUDGET;
+    const long end = match_items(s->items + first, count, 0, data, size, pos,
+                                 variant->encoding == SLACK_ENCODING_UTF16LE ? 2 : 1, &budget);
+    if (end <= (long)pos) {
+        return 0;
+    }
+    slack_hit_t hit;
+    hit.offset = start;
+    hit.length = (uint32_t)(end - (long)pos);
+    hit.pattern = variant->pattern;
+    hit.encoding = variant->encoding;
+    hit.range = st->range;
+    st->next_allowed[v] = start + hit.length;
+    return hits_push(st->hits, &hit);
+}
+
+static int defer(search_stream_t* st, uint32_t v, uint64_t start) {
+    if (st->pending_count >= st->pending_capacity) {
+        size_t new_capacity = (st->pending_capacity == 0) ? 16 : st->pending_capacity * 2;
+        search_candidate_t* pending = (search_candidate_t*)realloc(st->pending,
+                                                                   new_capacity * sizeof(search_candidate_t));
+        if (!pending) {
+            return -1;
+        }
+        st->pending = pending;
+        st->pending_capacity = new_capacity;
+    }
+    st->pending[st->pending_count].start = start;
+    st->pending[st->pending_count].variant = v;
+    st->pending_count++;
+    return 0;
+}
+
+// Search the next piece of the range; final ends the range
+static int stream_feed(search_stream_t* st, const uint8_t* data, size_t size, int final) {
+    const slack_searcher_t* s = st->searcher;
+    const uint64_t piece_offset = st->next;
+    const uint64_t piece_end = piece_offset + size;
+    const size_t head = size < s->max_bytes ? size : s->max_bytes;
+    if (st->carried > 0) {
+        memcpy(st->seam, st->carry, st->carried);
+    }
+    if (head > 0) {
+        memcpy(st->seam + st->carried, data, head);
+    }
+    st->seam_size = st->carried + head;
+    st->piece = data;
+    st->piece_size = size;
+
+    // Candidates held back from earlier pieces, in order
+    size_t kept = 0;
+    for (size_t i = 0; i < st->pending_count; i++) {
+        const search_candidate_t c = st->pending[i];
+        if (!final && c.start + s->variants[c.variant].max_bytes > piece_end) {
+            st->pending[kept++] = c;
+        } else if (verify(st, c.variant, c.start) != 0) {
+            return -1;
+        }
+    }
+    st->pending_count = kept;
+
+    // Atoms ending in this piece
+    const uint16_t* delta = s->delta;
+    const uint8_t* fold = s->fold;
+    uint32_t state = st->state;
+    for (size_t i = 0; i < size; i++) {
+        if (state == 0) {
+            // In the root state only a start byte can lead anywhere
+            while (i < size && !s->is_start[fold[data[i]]]) {
+                i++;
+            }
+            if (i == size) {
+                break;
+            }
+        }
+        state = delta[(size_t)state * 256 + fold[data[i]]];
+        for (uint32_t o = s->out_begin[state]; o < s->out_begin[state + 1]; o++) {
+            const uint32_t v = s->outputs[o];
+            const search_variant_t* variant = &s->variants[v];
+            const uint64_t atom_end = piece_offset + i + 1;
+            if (atom_end < st->origin + variant->atom_offset + variant->atom_length) {
+                continue;   // Would start before the range
+            }
+            const uint64_t start = atom_end - variant->atom_length - variant->atom_offset;
+            const int ret = (!final && start + variant->max_bytes > piece_end) ? defer(st, v, start)
+                                                                                : verify(st, v, start);
+            if (ret != 0) {
+                return -1;
+            }
+        }
+    }
+    st->state = state;
+
+    // Patterns without an atom, at every offset
+    for (size_t u = 0; u < s->unanchored_count; u++) {
+        const uint32_t v = s->unanchored[u];
+        const search_variant_t* variant = &s->variants[v];
+        const uint8_t* first_set = s->items[s->item_begin[variant->pattern]].set;
+        uint64_t start = st->next_start[v];
+        for (; final ? start < piece_end : start + variant->max_bytes <= piece_end; start++) {
+            if (start < st->next_allowed[v]) {
+                start = st->next_allowed[v] - 1;
+                continue;
+            }
+            const uint8_t b = start >= piece_offset ? data[start - piece_offset]
+                                                    : st->seam[start - (piece_offset - st->carried)];
+            if (in_set(first_set, b) || s->items[s->item_begin[variant->pattern]].min == 0) {
+                if (verify(st, v, start) != 0) {
+                    return -1;
+                }
+            }
+        }
+        st->next_start[v] = start;
+    }
+
+    // Keep the bytes a later match could start in
+    const size_t keep = s->max_bytes;
+    if (size >= keep) {
+        memcpy(st->carry, data + size - keep, keep);
+        st->carried = keep;
+    } else {
+        const size_t drop = st->carried + size > keep ? st->carried + size - keep : 0;
+        memmove(st->carry, st->carry + drop, st->carried - drop);
+        if (size > 0) {
+            memcpy(st->carry + st->carried - drop, data, size);
+        }
+        st->carried = st->carried - drop + size;
+    }
+    st->next = piece_end;
+    if (final) {
+        st->active = 0;
+    }
+    return 0;
+}
+
+static int stream_finish(search_stream_t* st) {
+    return st->active ? stream_feed(st, NULL, 0, 1) : 0;
+}
+
+int slack_search_buffer(const slack_searcher_t* searcher, const uint8_t* data, size_t size, uint64_t offset,
+                        size_t range, slack_hits_t* hits) {
+    if (!searcher || (!data && size > 0) || !hits) {
+        return -1;
+    }
+    search_stream_t st;
+    int ret = stream_init(&st, searcher, hits);
+    if (ret == 0) {
+        stream_begin(&st, range, offset);
+        ret = stream_feed(&st, data, size, 1);
+    }
+    stream_free(&st);
+    return ret;
+}
+
+typedef struct {
+    search_stream_t stream;
+    int failed;
+} range_search_t;
+
+static int search_piece(size_t range, uint64_t offset, const uint8_t* data, size_t size, void* user_data) {
+    range_search_t* search = (range_search_t*)user_data;
+    search_stream_t* st = &search->stream;
+    if (!st->active || range != st->range || offset != st->next) {
+        if (stream_finish(st) != 0) {
+            search->failed = 1;
+            return -1;
+        }
+        stream_begin(st, range, offset);
+    }
+    if (stream_feed(st, data, size, 0) != 0) {
+        search->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+int slack_search_ranges(const slack_searcher_t* searcher, const char* device_path, const slack_range_t* ranges,
+                        size_t count, size_t read_size, slack_hits_t* hits) {
+    if (!searcher || !device_path || (!ranges && count > 0) || !hits) {
+        return -1;
+    }
+    range_search_t search;
+    search.failed = 0;
+    int ret = stream_init(&search.stream, searcher, hits);
+    if (ret == 0) {
+        ret = slack_read_ranges(device_path, ranges, count, read_size, search_piece, &search);
+        if (ret == 0 && (search.failed || stream_finish(&search.stream) != 0)) {
+            ret = -1;
+        }
+    }
+    stream_free(&search.stream);
+    return ret;
+}
+
+int slack_search_slack_patterns(const slack_searcher_t* searcher, const slack_analysis_result_t* result,
+                                size_t read_size, slack_hits_t* hits) {
+    if (!searcher || !result || !hits) {
+        return -1;
+    }
+    slack_range_t* ranges = (slack_range_t*)calloc(result->file_count ? result->file_count : 1,
+                                                   sizeof(slack_range_t));
+    if (!ranges) {
+        return -1;
+    }
+    int ret = 0;
+    size_t streamed = 0;
+    for (size_t i = 0; i < result->file_count && ret == 0; i++) {
+        const slack_file_result_t* file = &result->files[i];
+        if (file->slack_data && file->slack_data_size > 0) {
+            ret = slack_search_buffer(searcher, file->slack_data, file->slack_data_size, file->physical_offset, i,
+                                      hits);
+        } else if (file->physical_offset > 0 && file->slack_size > 0) {
+            ranges[i].offset = file->physical_offset;
+            ranges[i].length = file->slack_size;
+            streamed++;
+        }
+    }
+    if (ret == 0 && streamed > 0 && result->device_path && access(result->device_path, R_OK) == 0) {
+        ret = slack_search_ranges(searcher, result->device_path, ranges, result->file_count, read_size, hits);
+    }
+    free(ranges);
+    slack_hits_sort(hits);
+    return ret;
+}
+
+int slack_search_unallocated_patterns(const slack_searcher_t* searcher, const unallocated_analysis_result_t* result,
+                                      size_t read_size, slack_hits_t* hits) {
+    if (!searcher || !result || !hits) {
+        return -1;
+    }
+    slack_range_t* ranges = (slack_range_t*)calloc(result->cluster_count ? result->cluster_count : 1,
+                                                   sizeof(slack_range_t));
+    if (!ranges) {
+        return -1;
+    }
+    int ret = 0;
+    size_t streamed = 0;
+    for (size_t i = 0; i < result->cluster_count && ret == 0; i++) {
+        const unallocated_cluster_result_t* cluster = &result->clusters[i];
+        if (cluster->cluster_data && cluster->cluster_data_size > 0) {
+            ret = slack_search_buffer(searcher, cluster->cluster_data, cluster->cluster_data_size,
+                                      cluster->cluster_offset, i, hits);
+        } else {
+            ranges[i].offset = cluster->cluster_offset;
+            ranges[i].length = cluster->cluster_size;
+            streamed++;
+        }
+    }
+    if (ret == 0 && streamed > 0) {
+        ret = result->device_path ? slack_search_ranges(searcher, result->device_path, ranges, result->cluster_count,
+                                                        read_size, hits)
+                                  : -1;
+    }
+    free(ranges);
+    slack_hits_sort(hits);
+    return ret;
+}
@@ -0,0 +1,116 @@
+#ifndef LIBS_SLACK_SEARCH_H
+#define LIBS_SLACK_SEARCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "slack.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Multi-pattern search over slack and unallocated space. Keywords and
+// regex-lite patterns are compiled together: every pattern contributes an
+// atom (up to four characters at a fixed distance from the match start, in
+// each encoding searched) to one Aho-Corasick automaton, and a match is
+// confirmed where its atom is found. One pass over the data serves every
+// pattern, however many there are.
+//
+// Regex-lite syntax: literal bytes; '.' (any byte); classes such as
+// [a-z0-9_] and [^...]; the escapes \d \w \s \D \W \S \xHH \n \r \t \0 and
+// escaped metacharacters; the quantifiers ? * + {n} {n,} {n,m}, which are
+// greedy. Groups, alternation and anchors are not supported. A pattern
+// whose first character class is too broad for an atom (e.g. \w+) is tried
+// at every offset.
+
+// Encodings searched (flags)
+#define SLACK_SEARCH_ASCII 0x1
+#define SLACK_SEARCH_UTF16LE 0x2
+// Case-insensitive matching of ASCII letters (flags)
+#define SLACK_SEARCH_NOCASE 0x4
+
+// Bound of the unbounded quantifiers * + {n,}
+#define SLACK_SEARCH_MAX_REPEAT 256
+
+// Most characters a pattern can match
+#define SLACK_SEARCH_MAX_LENGTH 1024
+
+// Encoding of a hit
+#define SLACK_ENCODING_ASCII 0
+#define SLACK_ENCODING_UTF16LE 1
+
+// A pattern to search for
+typedef struct {
+    const char* text;
+    int regex;                  // 0 = keyword taken literally, 1 = regex-lite
+} slack_pattern_t;
+
+// One match
+typedef struct {
+    uint64_t offset;            // Device offset of the first byte (see the search functions)
+    uint32_t length;            // Bytes matched
+    uint32_t pattern;           // Index into the pattern list
+    uint32_t encoding;          // SLACK_ENCODING_ASCII or SLACK_ENCODING_UTF16LE
+    size_t range;               // File (slack) or run (unallocated) the match is in
+} slack_hit_t;
+
+// Growable hit list
+typedef struct {
+    slack_hit_t* hits;
+    size_t count;
+    size_t capacity;
+} slack_hits_t;
+
+// Compiled patterns; read-only once created, so one searcher can serve any
+// number of threads
+typedef struct slack_searcher slack_searcher_t;
+
+// Compile patterns
+// flags: SLACK_SEARCH_* (no encoding = SLACK_SEARCH_ASCII)
+// error: receives a message naming the pattern on failure (may be NULL)
+// Returns the searcher (free with slack_searcher_free), or NULL on error
+slack_searcher_t* slack_searcher_create(const slack_pattern_t* patterns, size_t count, int flags,
+                                        char* error, size_t error_size);
+
+// Free a searcher
+void slack_searcher_free(slack_searcher_t* searcher);
+
+void slack_hits_init(slack_hits_t* hits);
+void slack_hits_free(slack_hits_t* hits);
+
+// Sort hits by offset, then pattern, then encoding
+void slack_hits_sort(slack_hits_t* hits);
+
+// Search one buffer. Matches of a pattern in one encoding do not overlap.
+// offset: device offset of data[0]; range: recorded in each hit
+// Returns 0 on success, non-zero on error
+int slack_search_buffer(const slack_searcher_t* searcher, const uint8_t* data, size_t size, uint64_t offset,
+                        size_t range, slack_hits_t* hits);
+
+// Search ranges of a device, streamed with slack_read_ranges. Each range is
+// searched on its own: no match spans two ranges, even adjacent ones.
+// read_size: bytes read at a time (0 = SLACK_DEFAULT_READ_SIZE)
+// Returns 0 on success, non-zero on error
+int slack_search_ranges(const slack_searcher_t* searcher, const char* device_path, const slack_range_t* ranges,
+                        size_t count, size_t read_size, slack_hits_t* hits);
+
+// Search the slack of every file of an analysis: slack held in slack_data
+// is searched in memory, other located slack is streamed from
+// result->device_path when it can be read. Hit offsets are the file's
+// physical_offset plus the offset within its slack; range is the file index.
+// Returns 0 on success, non-zero on error (hits are sorted)
+int slack_search_slack_patterns(const slack_searcher_t* searcher, const slack_analysis_result_t* result,
+                                size_t read_size, slack_hits_t* hits);
+
+// Search the free runs of an analysis: runs holding cluster_data are searched
+// in memory, the others streamed from result->device_path. Hit offsets are
+// device offsets; range is the run index.
+// Returns 0 on success, non-zero on error (hits are sorted)
+int slack_search_unallocated_patterns(const slack_searcher_t* searcher, const unallocated_analysis_result_t* result,
+                                      size_t read_size, slack_hits_t* hits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_SLACK_SEARCH_H
@@ -1,5 +1,6 @@
 #include "slack.h"
 #include "filesystem.h"
+#include "search.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -7,9 +8,20 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <math.h>
 #include <ctype.h>
 #include <sys/statvfs.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <sys/vfs.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+
+// Reads are aligned to this many bytes
+#define SLACK_READ_ALIGNMENT 4096
 
 // Helper function to duplicate string
 static char* strdup_safe(const char* str) {
@@ -31,6 +43,13 @@ static void* memdup(const void* src, size_t size) {
     return dst;
 }
 
+void slack_options_init(slack_options_t* options) {
+    if (options) {
+        memset(options, 0, sizeof(slack_options_t));
+        options->read_size = SLACK_DEFAULT_READ_SIZE;
+    }
+}
+
 void slack_analysis_result_init(slack_analysis_result_t* result) {
     if (result) {
         memset(result, 0, sizeof(slack_analysis_result_t));
@@ -59,11 +78,12 @@ int slack_analysis_result_add_file(slack_analysis_result_t* result, const slack_
     new_file->file_size = file->file_size;
     new_file->allocated_size = file->allocated_size;
     new_file->slack_size = file->slack_size;
+    new_file->physical_offset = file->physical_offset;
     new_file->slack_data = (uint8_t*)memdup(file->slack_data, file->slack_data_size);
     new_file->slack_data_size = file->slack_data_size;
     
-    if ((!new_file->file_path || !new_file->slack_data) && 
-        (file->file_path || (file->slack_data && file->slack_data_size > 0))) {
+    if ((!new_file->file_path && file->file_path) ||
+        (!new_file->slack_data && file->slack_data && file->slack_data_size > 0)) {
         // Clean up on failure
         free(new_file->file_path);
         free(new_file->slack_data);
@@ -83,6 +103,8 @@ void slack_analysis_result_free(slack_analysis_result_t* result) {
             }
             free(result->files);
         }
+        free(result->device_path);
+        result->device_path = NULL;
         result->files = NULL;
         result->file_count = 0;
         result->file_capacity = 0;
@@ -135,6 +157,10 @@ void unallocated_analysis_result_free(unallocated_analysis_result_t* result) {
             }
             free(result->clusters);
         }
+        free(result->device_path);
+        result->device_path = NULL;
+        result->cluster_size = 0;
+        result->free_bytes = 0;
         result->clusters = NULL;
         result->cluster_count = 0;
         result->cluster_capacity = 0;
@@ -148,6 +174,26 @@ void filesystem_info_free(filesystem_info_t* info) {
     }
 }
 
+
+#ifdef __linux__
+// Name of a filesystem from its statfs magic number
+static const char* filesystem_type_name(long magic) {
+    switch ((unsigned long)magic) {
+    case 0xEF53: return "ext4";         // ext2, ext3 and ext4 share it
+    case 0x58465342: return "xfs";
+    case 0x9123683E: return "btrfs";
+    case 0x5346544E: return "ntfs";
+    case 0x4D44: return "vfat";
+    case 0x2011BAB0: return "exfat";
+    case 0xF2F52010: return "f2fs";
+    case 0x01021994: return "tmpfs";
+    case 0x794C7630: return "overlay";
+    case 0x2FC12FC1: return "zfs";
+    default: return "unknown";
+    }
+}
+#endif
+
 int slack_get_filesystem_info(const char* path, filesystem_info_t* info) {
     if (!path || !info) {
         return -1;
@@ -162,75 +208,105 @@ int slack_get_filesystem_info(const char* path, filesystem_info_t* info) {
         return -1;
     }
     
-    // Fill in filesystem information
-    info->filesystem_type = strdup_safe("ext4"); // Simplified - would detect real type in full implementation
+#ifdef __linux__
+    struct statfs fs_buf;
+    info->filesystem_type = strdup_safe(statfs(path, &fs_buf) == 0 ? filesystem_type_name((long)fs_buf.f_type)
+                                                                  : "unknown");
+#else
+    info->filesystem_type = strdup_safe("unknown");
+#endif
+    // f_frsize is the allocation unit; f_bsize only the preferred I/O size
+    const uint64_t fragment = stat_buf.f_frsize ? stat_buf.f_frsize : stat_buf.f_bsize;
     info->block_size = stat_buf.f_bsize;
-    info->cluster_size = stat_buf.f_bsize; // Simplified - assuming block size equals cluster size
+    info->cluster_size = fragment;
     info->total_clusters = stat_buf.f_blocks;
-    info->free_clusters = stat_buf.f_bavail;
+    info->free_clusters = stat_buf.f_bfree;
     info->used_clusters = stat_buf.f_blocks - stat_buf.f_bfree;
     
     return 0;
 }
 
+#ifdef __linux__
+// Locate the slack of a file on its device: the extent holding the last
+// byte gives the device offset just past EOF, and the slack runs to the end
+// of that block (never past the extent). Extents whose device bytes are not
+// the file's bytes as stored (inline, encrypted, compressed, not yet
+// allocated) have no readable slack.
+// Returns 0 on success, -1 if the file has no such extent or FIEMAP fails
+static int file_slack_extent(int fd, uint64_t size, uint64_t cluster_size, uint64_t* physical, uint64_t* length) {
+    union {
+        struct fiemap map;
+        uint8_t bytes[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.map.fm_start = size - 1;
+    request.map.fm_length = 1;
+    request.map.fm_flags = FIEMAP_FLAG_SYNC;
+    request.map.fm_extent_count = 1;
+    if (ioctl(fd, FS_IOC_FIEMAP, &request.map) != 0 || request.map.fm_mapped_extents == 0) {
+        return -1;
+    }
+    const struct fiemap_extent* extent = &request.map.fm_extents[0];
+    const uint32_t unreadable = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_ENCODED |
+                                FIEMAP_EXTENT_DATA_ENCRYPTED | FIEMAP_EXTENT_NOT_ALIGNED |
+                                FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL;
+    if ((extent->fe_flags & unreadable) || size <= extent->fe_logical ||
+        size > extent->fe_logical + extent->fe_length) {
+        return -1;
+    }
+    const uint64_t block_end = (size + cluster_size - 1) / cluster_size * cluster_size;
+    const uint64_t extent_end = extent->fe_logical + extent->fe_length;
+    *physical = extent->fe_physical + (size - extent->fe_logical);
+    *length = (block_end < extent_end ? block_end : extent_end) - size;
+    return 0;
+}
+#endif
+
 // Calculate slack space for a file
-static int calculate_slack_space(const char* file_path, slack_file_result_t* result) {
+static int calculate_slack_space(const char* file_path, uint64_t cluster_size, slack_file_result_t* result) {
     if (!file_path || !result) {
         return -1;
     }
     
-    // Get file statistics
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
     struct stat st;
-    if (stat(file_path, &st) != 0) {
+    if (fstat(fd, &st) != 0) {
+        close(fd);
         return -1;
     }
     
     // Initialize result
     memset(result, 0, sizeof(slack_file_result_t));
-    result->file_path = strdup_safe(file_path);
-    result->file_size = st.st_size;
-    
-    // Calculate allocated size (rounded up to nearest block/cluster)
-    // Simplified implementation - in a real forensic tool, this would be more precise
-    filesystem_info_t fs_info;
-    if (slack_get_filesystem_info(file_path, &fs_info) == 0) {
-        result->allocated_size = ((st.st_size + fs_info.cluster_size - 1) / fs_info.cluster_size) * fs_info.cluster_size;
-        result->slack_size = result->allocated_size - st.st_size;
-        filesystem_info_free(&fs_info);
-    } else {
-        // Fallback to default cluster size
-        const uint64_t default_cluster_size = 4096;
-        result->allocated_size = ((st.st_size + default_cluster_size - 1) / default_cluster_size) * default_cluster_size;
-        result->slack_size = result->allocated_size - st.st_size;
-    }
-    
-    // Read slack space data if there is any
-    if (result->slack_size > 0) {
-        // Limit slack data to a reasonable size for analysis
-        size_t read_size = (result->slack_size > 4096) ? 4096 : result->slack_size;
-        result->slack_data = (uint8_t*)malloc(read_size);
-        if (result->slack_data) {
-            FILE* file = fopen(file_path, "rb");
-            if (file) {
-                // Seek to end of actual file data
-                if (fseek(file, st.st_size, SEEK_SET) == 0) {
-                    result->slack_data_size = fread(result->slack_data, 1, read_size, file);
-                }
-                fclose(file);
-            }
-        }
+    result->file_size = (uint64_t)st.st_size;
+    
+    uint64_t physical = 0;
+    uint64_t slack = 0;
+    int located = -1;
+#ifdef __linux__
+    if (result->file_size > 0) {
+        located = file_slack_extent(fd, result->file_size, cluster_size, &physical, &slack);
     }
+#endif
+    close(fd);
+    if (located != 0) {
+        // Size only: the end of the last cluster
+        slack = result->file_size > 0 ? (cluster_size - result->file_size % cluster_size) % cluster_size : 0;
+        physical = 0;
+    }
+    result->slack_size = slack;
+    result->allocated_size = result->file_size + slack;
+    result->physical_offset = physical;
     
-    return 0;
+    result->file_path = strdup_safe(file_path);
+    return result->file_path ? 0 : -1;
 }
 
-int slack_analyze_directory(const char* path, slack_analysis_result_t* result) {
-    if (!path || !result) {
-        return -1;
-    }
-    
-    slack_analysis_result_init(result);
-    
+// Add the slack of every regular file under path on the filesystem dev
+static int collect_slack(const char* path, dev_t dev, int recursive, uint64_t cluster_size,
+                         slack_analysis_result_t* result) {
     // Open directory
     DIR* dir = opendir(path);
     if (!dir) {
@@ -238,8 +314,9 @@ int slack_analyze_directory(const char* path, slack_analysis_result_t* result) {
     }
     
     // Process directory entries
+    int ret = 0;
     struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
+    while (ret == 0 && (entry = readdir(dir)) != NULL) {
         // Skip current and parent directory
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
             continue;
@@ -250,27 +327,27 @@ int slack_analyze_directory(const char* path, slack_analysis_result_t* result) {
         size_t name_len = strlen(entry->d_name);
         char* full_path = (char*)malloc(path_len + name_len + 2);
         if (!full_path) {
-            continue;
+            ret = -1;
+            break;
         }
         
         sprintf(full_path, "%s/%s", path, entry->d_name);
         
-        // Check if it's a regular file
+        // Regular files of this filesystem only: others are on another device
         struct stat st;
-        if (stat(full_path, &st) == 0 && S_ISREG(st.st_mode)) {
-            // Calculate slack space for this file
-            slack_file_result_t file_result;
-            if (calculate_slack_space(full_path, &file_result) == 0) {
-                // Add to results if there's slack space
-                if (file_result.slack_size > 0) {
-                    slack_analysis_result_add_file(result, &file_result);
-                    printf("File %s has %lu bytes of slack space\n", 
-                           file_result.file_path, (unsigned long)file_result.slack_size);
+        if (lstat(full_path, &st) == 0 && st.st_dev == dev) {
+            if (S_ISREG(st.st_mode)) {
+                slack_file_result_t file_result;
+                if (calculate_slack_space(full_path, cluster_size, &file_result) == 0) {
+                    // Add to results if there's slack space
+                    if (file_result.slack_size > 0) {
+                        ret = slack_analysis_result_add_file(result, &file_result);
+                    }
+                    free(file_result.file_path);
                 }
-                
-                // Clean up
-                free(file_result.file_path);
-                free(file_result.slack_data);
+            } else if (S_ISDIR(st.st_mode) && recursive) {
+                // Unreadable subdirectories are skipped
+                collect_slack(full_path, dev, recursive, cluster_size, result);
             }
         }
         
@@ -278,7 +355,120 @@ int slack_analyze_directory(const char* path, slack_analysis_result_t* result) {
     }
     
     closedir(dir);
+    return ret;
+}
+
+// The slack of file i lands in its own buffer
+static int store_slack(size_t range, uint64_t offset, const uint8_t* data, size_t size, void* user_data) {
+    slack_analysis_result_t* result = (slack_analysis_result_t*)user_data;
+    slack_file_result_t* file = &result->files[range];
+    const uint64_t at = offset - file->physical_offset;
+    memcpy(file->slack_data + at, data, size);
+    if (at + size > file->slack_data_size) {
+        file->slack_data_size = (size_t)(at + size);
+    }
+    return 0;
+}
+
+// Read the located slack of every file, in device order
+static void read_slack(slack_analysis_result_t* result, size_t read_size) {
+    slack_range_t* ranges = (slack_range_t*)calloc(result->file_count ? result->file_count : 1, sizeof(slack_range_t));
+    if (!ranges) {
+        return;
+    }
+    for (size_t i = 0; i < result->file_count; i++) {
+        slack_file_result_t* file = &result->files[i];
+        if (file->physical_offset > 0 && file->slack_size > 0 && !file->slack_data) {
+            file->slack_data = (uint8_t*)malloc((size_t)file->slack_size);
+            if (file->slack_data) {
+                ranges[i].offset = file->physical_offset;
+                ranges[i].length = file->slack_size;
+            }
+        }
+    }
+    // A failed read leaves the files read so far
+    slack_read_ranges(result->device_path, ranges, result->file_count, read_size, store_slack, result);
+    for (size_t i = 0; i < result->file_count; i++) {
+        slack_file_result_t* file = &result->files[i];
+        if (file->slack_data && file->slack_data_size < file->slack_size) {
+            free(file->slack_data);
+            file->slack_data = NULL;
+            file->slack_data_size = 0;
+        }
+    }
+    free(ranges);
+}
+
+int slack_analyze_directory(const char* path, slack_analysis_result_t* result) {
+    return slack_analyze_directory_with_options(path, NULL, result);
+}
+
+int slack_analyze_directory_with_options(const char* path, const slack_options_t* options,
+                                         slack_analysis_result_t* result) {
+    if (!path || !result) {
+        return -1;
+    }
     
+    slack_analysis_result_init(result);
+    slack_options_t defaults;
+    if (!options) {
+        slack_options_init(&defaults);
+        options = &defaults;
+    }
+    
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return -1;
+    }
+    filesystem_info_t fs_info;
+    uint64_t cluster_size = 4096; // Fallback when the filesystem cannot be queried
+    if (slack_get_filesystem_info(path, &fs_info) == 0) {
+        if (fs_info.cluster_size > 0) {
+            cluster_size = fs_info.cluster_size;
+        }
+        filesystem_info_free(&fs_info);
+    }
+    
+    if (collect_slack(path, st.st_dev, options->recursive, cluster_size, result) != 0) {
+        slack_analysis_result_free(result);
+        return -1;
+    }
+    
+    // The slack is on the device under the filesystem, not in the files
+    if (options->device_path) {
+        result->device_path = strdup_safe(options->device_path);
+    } else {
+#ifdef __linux__
+        char device[64];
+        snprintf(device, sizeof(device), "/dev/block/%u:%u", major(st.st_dev), minor(st.st_dev));
+        result->device_path = strdup_safe(device);
+#endif
+    }
+    if (result->device_path && access(result->device_path, R_OK) == 0) {
+        read_slack(result, options->read_size);
+    }
+    
+    return 0;
+}
+
+typedef struct {
+    unallocated_analysis_result_t* result;
+    uint64_t cluster_size;
+    int failed;
+} free_run_sink_t;
+
+static int add_free_run(uint64_t first_block, uint64_t block_count, void* user_data) {
+    free_run_sink_t* sink = (free_run_sink_t*)user_data;
+    unallocated_cluster_result_t run;
+    memset(&run, 0, sizeof(run));
+    run.cluster_number = first_block;
+    run.cluster_offset = first_block * sink->cluster_size;
+    run.cluster_size = block_count * sink->cluster_size;
+    if (unallocated_analysis_result_add_cluster(sink->result, &run) != 0) {
+        sink->failed = 1;
+        return -1;
+    }
+    sink->result->free_bytes += run.cluster_size;
     return 0;
 }
 
@@ -289,35 +479,196 @@ int slack_analyze_unallocated(const char* device_path, unallocated_analysis_resu
     
     unallocated_analysis_result_init(result);
     
-    // In a real implementation, this would read unallocated clusters from the device
-    // For this example, we'll simulate finding some unallocated clusters
+    slack_fs_t* fs = slack_fs_open(device_path);
+    if (!fs) {
+        return -1;
+    }
+    free_run_sink_t sink;
+    sink.result = result;
+    sink.cluster_size = slack_fs_block_size(fs);
+    sink.failed = 0;
+    result->cluster_size = sink.cluster_size;
+    result->device_path = strdup_safe(device_path);
+    int ret = result->device_path ? slack_fs_free_runs(fs, add_free_run, &sink) : -1;
+    slack_fs_close(fs);
+    
+    if (ret != 0 || sink.failed) {
+        unallocated_analysis_result_free(result);
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    slack_range_t range;
+    size_t index;
+} indexed_range_t;
+
+static int compare_ranges(const void* a, const void* b) {
+    const indexed_range_t* x = (const indexed_range_t*)a;
+    const indexed_range_t* y = (const indexed_range_t*)b;
+    if (x->range.offset != y->range.offset) {
+        return x->range.offset < y->range.offset ? -1 : 1;
+    }
+    return x->index < y->index ? -1 : (x->index > y->index ? 1 : 0);
+}
+
+// Read [begin, end) of fd, short only at the end of the device
+// Returns the bytes read, or -1 on error
+static ssize_t read_span(int fd, uint8_t* buffer, uint64_t begin, uint64_t end) {
+    size_t done = 0;
+    const size_t size = (size_t)(end - begin);
+    while (done < size) {
+        ssize_t n = pread(fd, buffer + done, size - done, (off_t)(begin + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+int slack_read_ranges(const char* device_path, const slack_range_t* ranges, size_t count, size_t read_size,
+                      slack_range_fn callback, void* user_data) {
+    if (!device_path || (!ranges && count > 0) || !callback) {
+        return -1;
+    }
+    const uint64_t align = SLACK_READ_ALIGNMENT;
+    if (read_size == 0) {
+        read_size = SLACK_DEFAULT_READ_SIZE;
+    }
+    read_size = (read_size + align - 1) / align * align;
+    if (read_size < 2 * align) {
+        read_size = 2 * align;
+    }
     
-    printf("Analyzing unallocated space on %s...\n", device_path);
+    // Visit the ranges in device order
+    indexed_range_t* sorted = (indexed_range_t*)malloc((count ? count : 1) * sizeof(indexed_range_t));
+    if (!sorted) {
+        return -1;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (ranges[i].length > 0) {
+            sorted[n].range = ranges[i];
+            sorted[n].index = i;
+            n++;
+        }
+    }
+    qsort(sorted, n, sizeof(indexed_range_t), compare_ranges);
     
-    // Simulate finding 5 unallocated clusters
-    for (int i = 0; i < 5; i++) {
-        unallocated_cluster_result_t cluster_result;
-        cluster_result.cluster_number = 1000 + i;
-        cluster_result.cluster_offset = (1000 + i) * 4096;
-        cluster_result.cluster_size = 4096;
-        cluster_result.cluster_data = (uint8_t*)malloc(4096);
-        cluster_result.cluster_data_size = 4096;
+    int fd = n > 0 ? open(device_path, O_RDONLY) : -1;
+    uint8_t* buffer = NULL;
+    if (n > 0 && (fd < 0 || posix_memalign((void**)&buffer, (size_t)align, read_size) != 0)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(sorted);
+        return -1;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#endif
+    
+    int ret = 0;
+    size_t i = 0;
+    uint64_t position = n > 0 ? sorted[0].range.offset : 0;   // Next byte of range i
+    while (i < n && ret == 0) {
+        const slack_range_t* range = &sorted[i].range;
+        const uint64_t range_end = range->offset + range->length;
+        const uint64_t span_begin = position / align * align;
+        const uint64_t span_limit = span_begin + read_size;
         
-        if (cluster_result.cluster_data) {
-            // Fill with random data for simulation
-            for (int j = 0; j < 4096; j++) {
-                cluster_result.cluster_data[j] = (uint8_t)(rand() % 256);
+        // Later ranges share the read when they fit and are close enough
+        uint64_t last = range_end < span_limit ? range_end : span_limit;
+        size_t k = i + 1;
+        if (range_end <= span_limit) {
+            while (k < n && sorted[k].range.offset >= span_begin &&
+                   sorted[k].range.offset + sorted[k].range.length <= span_limit &&
+                   sorted[k].range.offset <= last + SLACK_COALESCE_GAP) {
+                const uint64_t end = sorted[k].range.offset + sorted[k].range.length;
+                if (end > last) {
+                    last = end;
+                }
+                k++;
             }
-            
-            // Add to results
-            unallocated_analysis_result_add_cluster(result, &cluster_result);
-            free(cluster_result.cluster_data);
+        }
+        uint64_t span_end = (last + align - 1) / align * align;
+        if (span_end > span_limit) {
+            span_end = span_limit;
+        }
+        const ssize_t got = read_span(fd, buffer, span_begin, span_end);
+        if (got < 0 || (uint64_t)got < last - span_begin) {
+            ret = -1;
+            break;
+        }
+        
+        // Range i, whole or up to the end of the span
+        const uint64_t piece_end = range_end < span_limit ? range_end : span_limit;
+        if (callback(sorted[i].index, position, buffer + (position - span_begin), (size_t)(piece_end - position),
+                     user_data) != 0) {
+            break;
+        }
+        if (piece_end < range_end) {
+            position = piece_end;
+            continue;
+        }
+        int stopped = 0;
+        for (size_t j = i + 1; j < k && !stopped; j++) {
+            const slack_range_t* shared = &sorted[j].range;
+            stopped = callback(sorted[j].index, shared->offset, buffer + (shared->offset - span_begin),
+                               (size_t)shared->length, user_data) != 0;
+        }
+        if (stopped) {
+            break;
+        }
+        i = k;
+        if (i < n) {
+            position = sorted[i].range.offset;
         }
     }
     
-    printf("Found %lu unallocated clusters\n", (unsigned long)result->cluster_count);
-    
-    return 0;
+    free(buffer);
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(sorted);
+    return ret;
+}
+
+int slack_carve_unallocated(const unallocated_analysis_result_t* result, carving_result_t* carved) {
+    if (!result || !result->device_path || !carved) {
+        return -1;
+    }
+    carving_range_t* ranges = (carving_range_t*)malloc((result->cluster_count ? result->cluster_count : 1) *
+                                                       sizeof(carving_range_t));
+    if (!ranges) {
+        return -1;
+    }
+    for (size_t i = 0; i < result->cluster_count; i++) {
+        ranges[i].offset = result->clusters[i].cluster_offset;
+        ranges[i].length = result->clusters[i].cluster_size;
+    }
+    int ret = carving_carve_ranges(result->device_path, ranges, result->cluster_count, 0, carved);
+    free(ranges);
+    return ret;
+}
+
+// One keyword as a searcher
+static slack_searcher_t* keyword_searcher(const char* keyword, int case_sensitive) {
+    slack_pattern_t pattern;
+    pattern.text = keyword;
+    pattern.regex = 0;
+    return slack_searcher_create(&pattern, 1, SLACK_SEARCH_ASCII | (case_sensitive ? 0 : SLACK_SEARCH_NOCASE),
+                                 NULL, 0);
 }
 
 int slack_search_slack(const slack_analysis_result_t* result, const char* keyword, int case_sensitive) {
@@ -325,45 +676,24 @@ int slack_search_slack(const slack_analysis_result_t* result, const char* keywor
         return -1;
     }
     
-    int total_matches = 0;
+    slack_searcher_t* searcher = keyword_searcher(keyword, case_sensitive);
+    if (!searcher) {
+        return -1;
+    }
+    slack_hits_t hits;
+    slack_hits_init(&hits);
+    const int ret = slack_search_slack_patterns(searcher, result, 0, &hits);
+    slack_searcher_free(searcher);
     
-    // Search each file's slack space
-    for (size_t i = 0; i < result->file_count; i++) {
+    // Hits are in device order; report them per file
+    for (size_t i = 0; ret == 0 && i < result->file_count; i++) {
         const slack_file_result_t* file = &result->files[i];
-        
-        if (!file->slack_data || file->slack_data_size == 0) {
-            continue;
-        }
-        
-        // Search for keyword in slack data
-        size_t keyword_len = strlen(keyword);
-        if (keyword_len > file->slack_data_size) {
-            continue;
-        }
-        
         int file_matches = 0;
-        for (size_t j = 0; j <= file->slack_data_size - keyword_len; j++) {
-            int match = 1;
-            
-            for (size_t k = 0; k < keyword_len; k++) {
-                if (case_sensitive) {
-                    if (file->slack_data[j + k] != keyword[k]) {
-                        match = 0;
-                        break;
-                    }
-                } else {
-                    if (tolower(file->slack_data[j + k]) != tolower(keyword[k])) {
-                        match = 0;
-                        break;
-                    }
-                }
-            }
-            
-            if (match) {
+        for (size_t h = 0; h < hits.count; h++) {
+            if (hits.hits[h].range == i) {
                 file_matches++;
-                total_matches++;
                 printf("Found keyword '%s' in slack space of file %s at offset %lu\n",
-                       keyword, file->file_path, (unsigned long)j);
+                       keyword, file->file_path, (unsigned long)(hits.hits[h].offset - file->physical_offset));
             }
         }
         
@@ -372,7 +702,9 @@ int slack_search_slack(const slack_analysis_result_t* result, const char* keywor
         }
     }
     
-    return total_matches;
+    const int total_matches = (int)hits.count;
+    slack_hits_free(&hits);
+    return ret == 0 ? total_matches : -1;
 }
 
 int slack_search_unallocated(const unallocated_analysis_result_t* result, const char* keyword, int case_sensitive) {
@@ -380,52 +712,21 @@ int slack_search_unallocated(const unallocated_analysis_result_t* result, const
         return -1;
     }
     
-    int total_matches = 0;
-    
-    // Search each unallocated cluster
-    for (size_t i = 0; i < result->cluster_count; i++) {
-        const unallocated_cluster_result_t* cluster = &result->clusters[i];
-        
-        if (!cluster->cluster_data || cluster->cluster_data_size == 0) {
-            continue;
-        }
-        
-        // Search for keyword in cluster data
-        size_t keyword_len = strlen(keyword);
-        if (keyword_len > cluster->cluster_data_size) {
-            continue;
-        }
-        
-        int cluster_matches = 0;
-        for (size_t j = 0; j <= cluster->cluster_data_size - keyword_len; j++) {
-            int match = 1;
-            
-            for (size_t k = 0; k < keyword_len; k++) {
-                if (case_sensitive) {
-                    if (cluster->cluster_data[j + k] != keyword[k]) {
-                        match = 0;
-                        break;
-                    }
-                } else {
-                    if (tolower(cluster->cluster_data[j + k]) != tolower(keyword[k])) {
-                        match = 0;
-                        break;
-                    }
-                }
-            }
-            
-            if (match) {
-                cluster_matches++;
-                total_matches++;
-                printf("Found keyword '%s' in unallocated cluster %lu at offset %lu\n",
-                       keyword, (unsigned long)cluster->cluster_number, (unsigned long)j);
-            }
-        }
-        
-        if (cluster_matches > 0) {
-            printf("Cluster %lu: %d matches\n", (unsigned long)cluster->cluster_number, cluster_matches);
-        }
+    slack_searcher_t* searcher = keyword_searcher(keyword, case_sensitive);
+    if (!searcher) {
+        return -1;
+    }
+    slack_hits_t hits;
+    slack_hits_init(&hits);
+    const int ret = slack_search_unallocated_patterns(searcher, result, 0, &hits);
+    slack_searcher_free(searcher);
+    
+    for (size_t h = 0; ret == 0 && h < hits.count; h++) {
+        printf("Found keyword '%s' in unallocated space at device offset %llu\n",
+               keyword, (unsigned long long)hits.hits[h].offset);
     }
     
-    return total_matches;
-}
\ No newline at end of file
+    const int total_matches = (int)hits.count;
+    slack_hits_free(&hits);
+    return ret == 0 ? total_matches : -1;
+}
@@ -3,27 +3,36 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "libs/carving/carving.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Slack space analysis result for a file
+// Bytes read from a device at a time when streaming ranges
+#define SLACK_DEFAULT_READ_SIZE (4u * 1024 * 1024)
+
+// Ranges closer than this are read together
+#define SLACK_COALESCE_GAP (64u * 1024)
+
+// Slack space analysis result for a file: the bytes between the end of the
+// file and the end of the block holding its last byte
 typedef struct {
     char* file_path;
     uint64_t file_size;
-    uint64_t allocated_size;
+    uint64_t allocated_size;    // file_size + slack_size
     uint64_t slack_size;
-    uint8_t* slack_data;
+    uint64_t physical_offset;   // Device offset of the first slack byte (0 if unknown)
+    uint8_t* slack_data;        // Read from the device (NULL if it could not be)
     size_t slack_data_size;
 } slack_file_result_t;
 
-// Unallocated space analysis result
+// One run of consecutive unallocated clusters
 typedef struct {
-    uint64_t cluster_number;
-    uint64_t cluster_offset;
-    uint64_t cluster_size;
-    uint8_t* cluster_data;
+    uint64_t cluster_number;    // First cluster of the run
+    uint64_t cluster_offset;    // Device offset of the run
+    uint64_t cluster_size;      // Bytes in the run
+    uint8_t* cluster_data;      // Not read by the analysis (NULL); stream with slack_read_ranges
     size_t cluster_data_size;
 } unallocated_cluster_result_t;
 
@@ -32,6 +41,7 @@ typedef struct {
     slack_file_result_t* files;
     size_t file_count;
     size_t file_capacity;
+    char* device_path;          // Device the slack was read from (NULL if none)
 } slack_analysis_result_t;
 
 // Unallocated space analysis result
@@ -39,8 +49,30 @@ typedef struct {
     unallocated_cluster_result_t* clusters;
     size_t cluster_count;
     size_t cluster_capacity;
+    char* device_path;          // Device the runs are on
+    uint64_t cluster_size;
+    uint64_t free_bytes;        // Sum of the runs
 } unallocated_analysis_result_t;
 
+// Byte range of a device
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+} slack_range_t;
+
+// Slack analysis options
+typedef struct {
+    const char* device_path;    // Raw device or image the files are on; NULL = the
+                                // device of the directory (/dev/block/MAJOR:MINOR)
+    int recursive;              // Descend into subdirectories on the same filesystem
+    size_t read_size;           // Bytes read at a time (0 = SLACK_DEFAULT_READ_SIZE)
+} slack_options_t;
+
+// Called with consecutive pieces of a range: range is its index in the
+// caller's array and offset the device offset of data[0]
+// Returns 0 to go on, non-zero to stop
+typedef int (*slack_range_fn)(size_t range, uint64_t offset, const uint8_t* data, size_t size, void* user_data);
+
 // Filesystem information
 typedef struct {
     char* filesystem_type;
@@ -51,6 +83,9 @@ typedef struct {
     uint64_t used_clusters;
 } filesystem_info_t;
 
+// Initialize slack analysis options with default values
+void slack_options_init(slack_options_t* options);
+
 // Initialize slack analysis result
 void slack_analysis_result_init(slack_analysis_result_t* result);
 
@@ -84,20 +119,48 @@ void filesystem_info_free(filesystem_info_t* info);
 // Returns 0 on success, non-zero on error
 int slack_analyze_directory(const char* path, slack_analysis_result_t* result);
 
-// Analyze unallocated space on a filesystem
-// device_path: path to the device or filesystem
+// Analyze slack space with options. FIEMAP locates the last extent of each
+// file on the device; the slack bytes of all files are then read from the
+// device in offset order, nearby ones in one read. Without FIEMAP (or
+// without access to the device) sizes come from the filesystem block size
+// and slack_data is left NULL.
+// options: NULL = defaults
+// Returns 0 on success, non-zero on error
+int slack_analyze_directory_with_options(const char* path, const slack_options_t* options,
+                                         slack_analysis_result_t* result);
+
+// Analyze unallocated space on a filesystem: read the block bitmaps from the
+// raw device or image and record each run of free clusters (see
+// filesystem.h for the supported filesystems). No cluster data is read.
+// device_path: path to the device or image
 // result: output analysis result (must be freed with unallocated_analysis_result_free)
 // Returns 0 on success, non-zero on error
 int slack_analyze_unallocated(const char* device_path, unallocated_analysis_result_t* result);
 
-// Search for keywords in slack space
+// Stream ranges of a device in large reads aligned to 4 KiB. Ranges are
+// visited in offset order; ranges within SLACK_COALESCE_GAP of each other
+// share one read, and a range longer than read_size arrives in pieces.
+// read_size: bytes read at a time (0 = SLACK_DEFAULT_READ_SIZE)
+// Returns 0 on success (or when stopped by the callback), non-zero on error
+int slack_read_ranges(const char* device_path, const slack_range_t* ranges, size_t count, size_t read_size,
+                      slack_range_fn callback, void* user_data);
+
+// Carve files from the unallocated runs of an analysis, each run on its
+// own; carved files are references into result->device_path
+// carved: output (must be freed with carving_result_free)
+// Returns 0 on success, non-zero on error
+int slack_carve_unallocated(const unallocated_analysis_result_t* result, carving_result_t* carved);
+
+// Search for keywords in slack space (one keyword; see search.h for many
+// keywords and patterns at once). Matches do not overlap.
 // result: slack analysis result to search
 // keyword: keyword to search for
 // case_sensitive: 1 for case sensitive, 0 for case insensitive
 // Returns number of matches found, negative on error
 int slack_search_slack(const slack_analysis_result_t* result, const char* keyword, int case_sensitive);
 
-// Search for keywords in unallocated space
+// Search for keywords in unallocated space; runs without cluster data are
+// streamed from result->device_path. Matches do not overlap.
 // result: unallocated analysis result to search
 // keyword: keyword to search for
 // case_sensitive: 1 for case sensitive, 0 for case insensitive
@@ -0,0 +1,90 @@
+#include "tasks.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    task_fn_t task;
+    void* context;
+    size_t count;
+    int flags;
+    pthread_mutex_t mutex;
+    size_t next;
+    int failed;
+} task_pool_t;
+
+typedef struct {
+    task_pool_t* pool;
+    size_t worker;
+} task_worker_t;
+
+static void* pool_worker(void* arg) {
+    const task_worker_t* self = (const task_worker_t*)arg;
+    task_pool_t* pool = self->pool;
+    const int stop_on_failure = (pool->flags & RUN_TASKS_STOP_ON_FAILURE) != 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        const size_t i = pool->next < pool->count && !(stop_on_failure && pool->failed) ? pool->next++ : pool->count;
+        pthread_mutex_unlock(&pool->mutex);
+        if (i >= pool->count) {
+            break;
+        }
+        if (pool->task(pool->context, self->worker, i) != 0) {
+            pthread_mutex_lock(&pool->mutex);
+            pool->failed = 1;
+            pthread_mutex_unlock(&pool->mutex);
+        }
+    }
+    return NULL;
+}
+
+size_t run_tasks_workers(size_t count, size_t num_threads) {
+    if (num_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (num_threads > count) {
+        num_threads = count;
+    }
+    return num_threads;
+}
+
+int run_tasks(size_t count, size_t num_threads, int flags, task_fn_t task, void* context) {
+    if (!task) {
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    task_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.task = task;
+    pool.context = context;
+    pool.count = count;
+    pool.flags = flags;
+    pthread_mutex_init(&pool.mutex, NULL);
+
+    num_threads = run_tasks_workers(count, num_threads);
+    task_worker_t* workers = (task_worker_t*)calloc(num_threads, sizeof(task_worker_t));
+    pthread_t* threads = num_threads > 1 ? (pthread_t*)calloc(num_threads - 1, sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    for (; workers && threads && started < num_threads - 1; started++) {
+        workers[started + 1].pool = &pool;
+        workers[started + 1].worker = started + 1;
+        if (pthread_create(&threads[started], NULL, pool_worker, &workers[started + 1]) != 0) {
+            break;
+        }
+    }
+    // The calling thread works too
+    task_worker_t self = {&pool, 0};
+    pool_worker(&self);
+    for (size_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    free(threads);
+    free(workers);
+    pthread_mutex_destroy(&pool.mutex);
+    return pool.failed ? -1 : 0;
+}
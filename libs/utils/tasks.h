@@ -0,0 +1,31 @@
+#ifndef LIBS_UTILS_TASKS_H
+#define LIBS_UTILS_TASKS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One task of a batch. worker identifies the thread running it, in
+// [0, run_tasks_workers(count, num_threads)), for per-thread state.
+// Returns 0 on success.
+typedef int (*task_fn_t)(void* context, size_t worker, size_t index);
+
+// Hand out no more tasks once one has failed
+#define RUN_TASKS_STOP_ON_FAILURE 1
+
+// Threads run_tasks uses: num_threads (0 = one per CPU), at most count
+size_t run_tasks_workers(size_t count, size_t num_threads);
+
+// Run task(context, worker, i) for every i in [0, count) on a pool of
+// threads, each taking the next index when it finishes one. The calling
+// thread works too. flags: 0 or RUN_TASKS_STOP_ON_FAILURE
+// Returns 0 if every task succeeded, -1 otherwise
+int run_tasks(size_t count, size_t num_threads, int flags, task_fn_t task, void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBS_UTILS_TASKS_H
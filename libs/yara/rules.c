@@ -1,4 +1,1412 @@
 #include "rules.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-// This is a placeholder for YARA rule management functions
-// In a full implementation, this would contain functions for managing YARA rules
\ No newline at end of file
+// ---------------------------------------------------------------------------
+// Lexer
+
+typedef enum {
+    TOK_EOF,
+    TOK_IDENT,          // Keywords are identifiers too
+    TOK_STRING_ID,      // $name (text = name, may be empty; trailing '*' kept)
+    TOK_COUNT_ID,       // #name
+    TOK_OFFSET_ID,      // @name
+    TOK_LENGTH_ID,      // !name
+    TOK_TEXT,           // "..." (unescaped into buf)
+    TOK_NUMBER,
+    TOK_PUNCT           // Operators and punctuation (text)
+} token_type_t;
+
+typedef struct {
+    token_type_t type;
+    char text[256];
+    uint8_t* buf;       // TOK_TEXT bytes
+    size_t buf_len;
+    int64_t number;
+    int line;
+} token_t;
+
+typedef struct {
+    const char* src;
+    size_t size;
+    size_t pos;
+    int line;
+    token_t tok;        // Current token
+    char* error;
+    size_t error_size;
+    int failed;
+} lexer_t;
+
+static void set_error(lexer_t* lx, const char* fmt, ...) {
+    if (lx->failed) {
+        return;
+    }
+    lx->failed = 1;
+    if (lx->error && lx->error_size > 0) {
+        char msg[256];
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(msg, sizeof(msg), fmt, args);
+        va_end(args);
+        snprintf(lx->error, lx->error_size, "line %d: %s", lx->tok.line, msg);
+    }
+}
+
+static int peek_char(const lexer_t* lx, size_t ahead) {
+    return lx->pos + ahead < lx->size ? (unsigned char)lx->src[lx->pos + ahead] : -1;
+}
+
+static void skip_space(lexer_t* lx) {
+    while (lx->pos < lx->size) {
+        const int c = peek_char(lx, 0);
+        if (c == '\n') {
+            lx->line++;
+            lx->pos++;
+        } else if (isspace(c)) {
+            lx->pos++;
+        } else if (c == '/' && peek_char(lx, 1) == '/') {
+            while (lx->pos < lx->size && lx->src[lx->pos] != '\n') lx->pos++;
+        } else if (c == '/' && peek_char(lx, 1) == '*') {
+            lx->pos += 2;
+            while (lx->pos < lx->size && !(lx->src[lx->pos] == '*' && peek_char(lx, 1) == '/')) {
+                if (lx->src[lx->pos] == '\n') lx->line++;
+                lx->pos++;
+            }
+            lx->pos += 2;
+        } else {
+            break;
+        }
+    }
+}
+
+static int is_ident_char(int c) {
+    return c >= 0 && (isalnum(c) || c == '_');
+}
+
+static int hex_value(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void lex_text(lexer_t* lx) {
+    token_t* t = &lx->tok;
+    t->type = TOK_TEXT;
+    t->buf_len = 0;
+    lx->pos++;  // Opening quote
+    size_t capacity = 64;
+    free(t->buf);
+    t->buf = (uint8_t*)malloc(capacity);
+    while (t->buf) {
+        if (lx->pos >= lx->size || lx->src[lx->pos] == '\n') {
+            set_error(lx, "unterminated string");
+            return;
+        }
+        int c = (unsigned char)lx->src[lx->pos++];
+        if (c == '"') {
+            return;
+        }
+        if (c == '\\') {
+            const int e = peek_char(lx, 0);
+            lx->pos++;
+            switch (e) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case '\\': c = '\\'; break;
+                case '"': c = '"'; break;
+                case 'x': {
+                    const int hi = hex_value(peek_char(lx, 0));
+                    const int lo = hex_value(peek_char(lx, 1));
+                    if (hi < 0 || lo < 0) {
+                        set_error(lx, "invalid \\x escape");
+                        return;
+                    }
+                    c = hi * 16 + lo;
+                    lx->pos += 2;
+                    break;
+                }
+                default:
+                    set_error(lx, "invalid escape sequence");
+                    return;
+            }
+        }
+        if (t->buf_len + 1 > capacity) {
+            capacity *= 2;
+            uint8_t* grown = (uint8_t*)realloc(t->buf, capacity);
+            if (!grown) break;
+            t->buf = grown;
+        }
+        t->buf[t->buf_len++] = (uint8_t)c;
+    }
+    set_error(lx, "out of memory");
+}
+
+static void next_token(lexer_t* lx) {
+    skip_space(lx);
+    token_t* t = &lx->tok;
+    t->line = lx->line;
+    t->text[0] = '\0';
+    if (lx->pos >= lx->size) {
+        t->type = TOK_EOF;
+        return;
+    }
+
+    const int c = peek_char(lx, 0);
+    if (c == '"') {
+        lex_text(lx);
+        return;
+    }
+
+    if (isdigit(c)) {
+        int64_t v = 0;
+        if (c == '0' && (peek_char(lx, 1) == 'x' || peek_char(lx, 1) == 'X')) {
+            lx->pos += 2;
+            while (hex_value(peek_char(lx, 0)) >= 0) {
+                v = v * 16 + hex_value(peek_char(lx, 0));
+                lx->pos++;
+            }
+        } else {
+            while (peek_char(lx, 0) >= 0 && isdigit(peek_char(lx, 0))) {
+                v = v * 10 + (peek_char(lx, 0) - '0');
+                lx->pos++;
+            }
+            if (peek_char(lx, 0) == 'K' && peek_char(lx, 1) == 'B') {
+                v *= 1024;
+                lx->pos += 2;
+            } else if (peek_char(lx, 0) == 'M' && peek_char(lx, 1) == 'B') {
+                v *= 1024 * 1024;
+                lx->pos += 2;
+            }
+        }
+        t->type = TOK_NUMBER;
+        t->number = v;
+        return;
+    }
+
+    // $name, #name, @name and !name (but not !=)
+    if (c == '$' || c == '#' || c == '@' || (c == '!' && is_ident_char(peek_char(lx, 1)))) {
+        t->type = c == '$' ? TOK_STRING_ID : c == '#' ? TOK_COUNT_ID : c == '@' ? TOK_OFFSET_ID : TOK_LENGTH_ID;
+        lx->pos++;
+        size_t n = 0;
+        while ((is_ident_char(peek_char(lx, 0)) || (c == '$' && peek_char(lx, 0) == '*')) && n + 1 < sizeof(t->text)) {
+            const int ch = peek_char(lx, 0);
+            t->text[n++] = (char)ch;
+            lx->pos++;
+            if (ch == '*') break;
+        }
+        t->text[n] = '\0';
+        return;
+    }
+
+    if (isalpha(c) || c == '_') {
+        size_t n = 0;
+        while (is_ident_char(peek_char(lx, 0)) && n + 1 < sizeof(t->text)) {
+            t->text[n++] = (char)peek_char(lx, 0);
+            lx->pos++;
+        }
+        t->text[n] = '\0';
+        t->type = TOK_IDENT;
+        return;
+    }
+
+    static const char* const two_char[] = {"==", "!=", "<=", ">=", "<<", ">>", ".."};
+    for (size_t i = 0; i < sizeof(two_char) / sizeof(two_char[0]); i++) {
+        if (c == two_char[i][0] && peek_char(lx, 1) == two_char[i][1]) {
+            memcpy(t->text, two_char[i], 3);
+            t->type = TOK_PUNCT;
+            lx->pos += 2;
+            return;
+        }
+    }
+    if (c != 0 && strchr("{}()[]:=<>+-*\\%&|^~,", c)) {
+        t->text[0] = (char)c;
+        t->text[1] = '\0';
+        t->type = TOK_PUNCT;
+        lx->pos++;
+        return;
+    }
+    set_error(lx, "unexpected character '%c'", c);
+    t->type = TOK_EOF;
+}
+
+static int is_punct(const lexer_t* lx, const char* p) {
+    return lx->tok.type == TOK_PUNCT && strcmp(lx->tok.text, p) == 0;
+}
+
+static int is_keyword(const lexer_t* lx, const char* k) {
+    return lx->tok.type == TOK_IDENT && strcmp(lx->tok.text, k) == 0;
+}
+
+static int expect_punct(lexer_t* lx, const char* p) {
+    if (!is_punct(lx, p)) {
+        set_error(lx, "expected '%s'", p);
+        return -1;
+    }
+    next_token(lx);
+    return 0;
+}
+
+static char* dup_string(const char* s) {
+    size_t n = strlen(s);
+    char* d = (char*)malloc(n + 1);
+    if (d) memcpy(d, s, n + 1);
+    return d;
+}
+
+// ---------------------------------------------------------------------------
+// Patterns
+
+typedef struct {
+    yara_pattern_byte_t* bytes;
+    size_t length;
+    size_t capacity;
+} byte_buffer_t;
+
+static int buffer_push(byte_buffer_t* b, uint8_t value, uint8_t mask, uint8_t nocase) {
+    if (b->length >= b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 32;
+        yara_pattern_byte_t* grown = (yara_pattern_byte_t*)realloc(b->bytes, capacity * sizeof(yara_pattern_byte_t));
+        if (!grown) return -1;
+        b->bytes = grown;
+        b->capacity = capacity;
+    }
+    yara_pattern_byte_t* pb = &b->bytes[b->length++];
+    pb->value = nocase ? (uint8_t)tolower(value) : (uint8_t)(value & mask);
+    pb->mask = mask;
+    pb->nocase = nocase && isalpha(value);
+    return 0;
+}
+
+static int pattern_add_segment(yara_pattern_t* p, byte_buffer_t* b, uint32_t jump_min, uint32_t jump_max) {
+    yara_segment_t* grown = (yara_segment_t*)realloc(p->segments, (p->segment_count + 1) * sizeof(yara_segment_t));
+    if (!grown) return -1;
+    p->segments = grown;
+    yara_segment_t* s = &p->segments[p->segment_count++];
+    s->bytes = b->bytes;
+    s->length = b->length;
+    s->jump_min = jump_min;
+    s->jump_max = jump_max;
+    memset(b, 0, sizeof(*b));
+    return 0;
+}
+
+static void pattern_free(yara_pattern_t* p) {
+    for (size_t i = 0; i < p->segment_count; i++) {
+        free(p->segments[i].bytes);
+    }
+    free(p->segments);
+    memset(p, 0, sizeof(*p));
+}
+
+// Common bytes make poor atoms: they produce candidates everywhere
+static int byte_quality(uint8_t b) {
+    switch (b) {
+        case 0x00: case 0xFF: case 0x20: case 0xCC: case 0x90:
+            return 1;
+        default:
+            return isalpha(b) ? 3 : 4;
+    }
+}
+
+// Pick the best run of up to YARA_ATOM_MAX exact bytes at a fixed distance
+// from the match start, i.e. before the first variable-length jump
+static void pattern_choose_atom(yara_pattern_t* p) {
+    p->atom_length = 0;
+    int best = 0;
+    size_t base = 0;
+    for (size_t s = 0; s < p->segment_count; s++) {
+        const yara_segment_t* seg = &p->segments[s];
+        for (size_t i = 0; i < seg->length; i++) {
+            int score = 0;
+            size_t n = 0;
+            int nocase = 0;
+            uint8_t seen[YARA_ATOM_MAX];
+            while (n < YARA_ATOM_MAX && i + n < seg->length && seg->bytes[i + n].mask == 0xFF) {
+                const uint8_t b = seg->bytes[i + n].value;
+                int distinct = 1;
+                for (size_t k = 0; k < n; k++) distinct &= seen[k] != b;
+                seen[n] = b;
+                score += distinct ? byte_quality(b) : 1;
+                nocase |= seg->bytes[i + n].nocase;
+                n++;
+            }
+            if (n > 0 && score > best) {
+                best = score;
+                p->atom_offset = base + i;
+                p->atom_length = n;
+                p->atom_nocase = nocase;
+                for (size_t k = 0; k < n; k++) p->atom[k] = seg->bytes[i + k].value;
+            }
+        }
+        if (seg->jump_min != seg->jump_max) {
+            break;
+        }
+        base += seg->length + seg->jump_min;
+    }
+}
+
+static int text_pattern(yara_pattern_t* p, const uint8_t* text, size_t len, int nocase, int wide, int fullword) {
+    memset(p, 0, sizeof(*p));
+    p->chain_count = 1;
+    p->wide = wide;
+    p->fullword = fullword;
+    byte_buffer_t b = {0};
+    for (size_t i = 0; i < len; i++) {
+        if (buffer_push(&b, text[i], 0xFF, (uint8_t)nocase) != 0 ||
+            (wide && buffer_push(&b, 0, 0xFF, 0) != 0)) {
+            free(b.bytes);
+            return -1;
+        }
+    }
+    if (pattern_add_segment(p, &b, 0, 0) != 0) {
+        free(b.bytes);
+        return -1;
+    }
+    pattern_choose_atom(p);
+    return 0;
+}
+
+// Parse "{ 4D 5A ?? [2-4] 0? }" starting at the '{'
+static int parse_hex_string(lexer_t* lx, yara_pattern_t* p) {
+    memset(p, 0, sizeof(*p));
+    p->chain_count = 1;
+    byte_buffer_t b = {0};
+    lx->pos++;  // '{'
+    for (;;) {
+        skip_space(lx);
+        const int c = peek_char(lx, 0);
+        if (c < 0) {
+            set_error(lx, "unterminated hex string");
+            break;
+        }
+        if (c == '}') {
+            lx->pos++;
+            if (b.length == 0) {
+                set_error(lx, p->segment_count ? "hex string cannot end with a jump" : "empty hex string");
+                break;
+            }
+            if (pattern_add_segment(p, &b, 0, 0) != 0) break;
+            pattern_choose_atom(p);
+            return 0;
+        }
+        if (c == '[') {
+            lx->pos++;
+            skip_space(lx);
+            uint32_t lo = 0, hi;
+            int have_lo = 0;
+            while (peek_char(lx, 0) >= 0 && isdigit(peek_char(lx, 0))) {
+                lo = lo * 10 + (uint32_t)(peek_char(lx, 0) - '0');
+                lx->pos++;
+                have_lo = 1;
+            }
+            skip_space(lx);
+            if (peek_char(lx, 0) == '-') {
+                lx->pos++;
+                skip_space(lx);
+                if (peek_char(lx, 0) >= 0 && isdigit(peek_char(lx, 0))) {
+                    hi = 0;
+                    while (peek_char(lx, 0) >= 0 && isdigit(peek_char(lx, 0))) {
+                        hi = hi * 10 + (uint32_t)(peek_char(lx, 0) - '0');
+                        lx->pos++;
+                    }
+                } else {
+                    hi = YARA_JUMP_UNBOUNDED;
+                }
+            } else if (have_lo) {
+                hi = lo;
+            } else {
+                set_error(lx, "invalid jump");
+                break;
+            }
+            skip_space(lx);
+            if (peek_char(lx, 0) != ']' || hi < lo) {
+                set_error(lx, "invalid jump");
+                break;
+            }
+            lx->pos++;
+            if (b.length == 0) {
+                set_error(lx, "jump must follow a byte");
+                break;
+            }
+            if (pattern_add_segment(p, &b, lo, hi) != 0) break;
+            continue;
+        }
+        if (c == '(' || c == '|' || c == '~') {
+            set_error(lx, "hex alternatives and negation are not supported");
+            break;
+        }
+        const int c1 = peek_char(lx, 1);
+        int hi = hex_value(c), lo = hex_value(c1);
+        if ((hi < 0 && c != '?') || (lo < 0 && c1 != '?')) {
+            set_error(lx, "invalid hex byte");
+            break;
+        }
+        const uint8_t mask = (uint8_t)((c == '?' ? 0x00 : 0xF0) | (c1 == '?' ? 0x00 : 0x0F));
+        const uint8_t value = (uint8_t)(((hi < 0 ? 0 : hi) << 4) | (lo < 0 ? 0 : lo));
+        if (buffer_push(&b, value, mask, 0) != 0) break;
+        lx->pos += 2;
+    }
+    free(b.bytes);
+    pattern_free(p);
+    if (!lx->failed) set_error(lx, "out of memory");
+    return -1;
+}
+
+static int is_chain_link(const yara_segment_t* seg) {
+    return seg->jump_max == YARA_JUMP_UNBOUNDED || seg->jump_max > YARA_CHAIN_GAP;
+}
+
+// Split a hex pattern at its long and unbounded jumps into chained
+// fragments. *patterns holds the one parsed pattern and is replaced by the
+// fragments; on error everything is freed and *patterns set to NULL.
+static int pattern_split_chain(yara_pattern_t** patterns, size_t* count) {
+    yara_pattern_t* whole = *patterns;
+    size_t links = 0;
+    for (size_t s = 0; s + 1 < whole->segment_count; s++) {
+        links += is_chain_link(&whole->segments[s]);
+    }
+    *count = 1;
+    if (links == 0) {
+        return 0;
+    }
+
+    yara_pattern_t* fragments = (yara_pattern_t*)calloc(links + 1, sizeof(yara_pattern_t));
+    int ok = fragments != NULL;
+    for (size_t s = 0, first = 0, k = 0; ok && s < whole->segment_count; s++) {
+        if (s + 1 < whole->segment_count && !is_chain_link(&whole->segments[s])) continue;
+        yara_pattern_t* f = &fragments[k++];
+        f->segment_count = s + 1 - first;
+        f->segments = (yara_segment_t*)malloc(f->segment_count * sizeof(yara_segment_t));
+        ok = f->segments != NULL;
+        first = s + 1;
+    }
+    if (!ok) {
+        for (size_t k = 0; fragments && k <= links; k++) free(fragments[k].segments);
+        free(fragments);
+        pattern_free(whole);
+        free(whole);
+        *patterns = NULL;
+        return -1;
+    }
+
+    // The fragments take over the segments' bytes; the jump ending each
+    // fragment becomes its gap to the next
+    size_t first = 0;
+    for (size_t k = 0; k <= links; k++) {
+        yara_pattern_t* f = &fragments[k];
+        memcpy(f->segments, whole->segments + first, f->segment_count * sizeof(yara_segment_t));
+        first += f->segment_count;
+        yara_segment_t* last = &f->segments[f->segment_count - 1];
+        f->chain_index = (uint32_t)k;
+        f->chain_count = (uint32_t)(links + 1);
+        f->chain_gap_min = last->jump_min;
+        f->chain_gap_max = last->jump_max;
+        last->jump_min = 0;
+        last->jump_max = 0;
+        pattern_choose_atom(f);
+    }
+    free(whole->segments);
+    free(whole);
+    *patterns = fragments;
+    *count = links + 1;
+    return 0;
+}
+
+static int byte_matches(const yara_pattern_byte_t* pb, uint8_t b) {
+    return pb->nocase ? tolower(b) == pb->value : (b & pb->mask) == pb->value;
+}
+
+// Match segments[seg..] at pos; returns the end offset, or -1
+static int64_t pattern_match_from(const yara_pattern_t* pattern, size_t seg, const uint8_t* data, size_t size, size_t pos) {
+    const yara_segment_t* s = &pattern->segments[seg];
+    if (s->length > size - pos) {
+        return -1;
+    }
+    for (size_t i = 0; i < s->length; i++) {
+        if (!byte_matches(&s->bytes[i], data[pos + i])) return -1;
+    }
+    pos += s->length;
+    if (seg + 1 == pattern->segment_count) {
+        return (int64_t)pos;
+    }
+    // Shortest gap that lets the rest match; jumps within a fragment are at
+    // most YARA_CHAIN_GAP long
+    const size_t remaining = size - pos;
+    if (s->jump_min >= remaining) {
+        return -1;
+    }
+    const size_t max = s->jump_max >= remaining ? remaining - 1 : s->jump_max;
+    const yara_pattern_byte_t* next = &pattern->segments[seg + 1].bytes[0];
+    for (size_t gap = s->jump_min; gap <= max; gap++) {
+        // Skip straight to the next occurrence of an exact first byte
+        if (next->mask == 0xFF && !next->nocase) {
+            const uint8_t* hit = (const uint8_t*)memchr(data + pos + gap, next->value, max - gap + 1);
+            if (!hit) return -1;
+            gap = (size_t)(hit - (data + pos));
+        }
+        const int64_t end = pattern_match_from(pattern, seg + 1, data, size, pos + gap);
+        if (end >= 0) return end;
+    }
+    return -1;
+}
+
+static int is_word_char(const uint8_t* data, size_t size, size_t at, int wide) {
+    if (at >= size) return 0;
+    if (wide && at + 1 < size && data[at + 1] != 0) return 0;
+    return isalnum(data[at]) != 0;
+}
+
+int64_t yara_pattern_match(const yara_pattern_t* pattern, const uint8_t* data, size_t size, size_t start) {
+    if (!pattern || start >= size) {
+        return -1;
+    }
+    const int64_t end = pattern_match_from(pattern, 0, data, size, start);
+    if (end < 0) {
+        return -1;
+    }
+    if (pattern->fullword) {
+        const size_t step = pattern->wide ? 2 : 1;
+        if ((start >= step && is_word_char(data, size, start - step, pattern->wide)) ||
+            is_word_char(data, size, (size_t)end, pattern->wide)) {
+            return -1;
+        }
+    }
+    return end - (int64_t)start;
+}
+
+// ---------------------------------------------------------------------------
+// Parser
+
+typedef struct {
+    lexer_t lx;
+    yara_rules_t* rules;
+    size_t rule_capacity;
+    size_t string_capacity;
+    size_t current_first;   // First string of the rule being parsed
+} parser_t;
+
+static yara_expr_t* new_expr(parser_t* ps, yara_expr_op_t op) {
+    yara_expr_t* e = (yara_expr_t*)calloc(1, sizeof(yara_expr_t));
+    if (!e) set_error(&ps->lx, "out of memory");
+    else e->op = op;
+    return e;
+}
+
+static void expr_free(yara_expr_t* e) {
+    if (e) {
+        expr_free(e->left);
+        expr_free(e->right);
+        free(e->set);
+        free(e);
+    }
+}
+
+// Strings of the current rule matching an identifier ("a", "a*", "" = all)
+static int collect_strings(parser_t* ps, const char* id, uint32_t** set, size_t* count) {
+    const yara_rules_t* r = ps->rules;
+    const size_t len = strlen(id);
+    const int prefix = len > 0 && id[len - 1] == '*';
+    size_t found = 0;
+    for (size_t s = ps->current_first; s < r->string_count; s++) {
+        const char* name = r->strings[s].identifier;
+        int match = (len == 0) || (prefix ? strncmp(name, id, len - 1) == 0 : strcmp(name, id) == 0);
+        if (!match) continue;
+        uint32_t* grown = (uint32_t*)realloc(*set, (*count + 1) * sizeof(uint32_t));
+        if (!grown) {
+            set_error(&ps->lx, "out of memory");
+            return -1;
+        }
+        *set = grown;
+        (*set)[(*count)++] = (uint32_t)s;
+        found++;
+    }
+    if (found == 0) {
+        set_error(&ps->lx, "undefined string identifier $%s", id);
+        return -1;
+    }
+    return 0;
+}
+
+static int find_string(parser_t* ps, const char* id) {
+    if (id[0] == '\0' || strchr(id, '*')) {
+        set_error(&ps->lx, "a single string identifier is required here");
+        return -1;
+    }
+    for (size_t s = ps->current_first; s < ps->rules->string_count; s++) {
+        if (strcmp(ps->rules->strings[s].identifier, id) == 0) return (int)s;
+    }
+    set_error(&ps->lx, "undefined string identifier $%s", id);
+    return -1;
+}
+
+static yara_expr_t* parse_expr(parser_t* ps);
+static yara_expr_t* parse_arith(parser_t* ps);
+
+static yara_expr_t* binary(parser_t* ps, yara_expr_op_t op, yara_expr_t* left, yara_expr_t* right) {
+    if (!left || !right) {
+        expr_free(left);
+        expr_free(right);
+        return NULL;
+    }
+    yara_expr_t* e = new_expr(ps, op);
+    if (!e) {
+        expr_free(left);
+        expr_free(right);
+        return NULL;
+    }
+    e->left = left;
+    e->right = right;
+    return e;
+}
+
+// "[ expr ]" index after @a / !a; defaults to the first match
+static yara_expr_t* parse_index(parser_t* ps) {
+    if (!is_punct(&ps->lx, "[")) {
+        yara_expr_t* one = new_expr(ps, YARA_EXPR_CONST);
+        if (one) one->value = 1;
+        return one;
+    }
+    next_token(&ps->lx);
+    yara_expr_t* index = parse_arith(ps);
+    if (expect_punct(&ps->lx, "]") != 0) {
+        expr_free(index);
+        return NULL;
+    }
+    return index;
+}
+
+// "of" set after the quantity: "them" or "($a, $b*)"
+static yara_expr_t* parse_of(parser_t* ps, yara_expr_t* quantity) {
+    lexer_t* lx = &ps->lx;
+    next_token(lx);  // 'of'
+    yara_expr_t* e = new_expr(ps, YARA_EXPR_OF);
+    if (!e) {
+        expr_free(quantity);
+        return NULL;
+    }
+    e->left = quantity;
+    if (is_keyword(lx, "them")) {
+        next_token(lx);
+        if (collect_strings(ps, "", &e->set, &e->set_count) != 0) goto fail;
+        return e;
+    }
+    if (expect_punct(lx, "(") != 0) goto fail;
+    for (;;) {
+        if (lx->tok.type != TOK_STRING_ID) {
+            set_error(lx, "expected string identifier");
+            goto fail;
+        }
+        if (collect_strings(ps, lx->tok.text, &e->set, &e->set_count) != 0) goto fail;
+        next_token(lx);
+        if (is_punct(lx, ",")) {
+            next_token(lx);
+            continue;
+        }
+        if (expect_punct(lx, ")") != 0) goto fail;
+        return e;
+    }
+fail:
+    expr_free(e);
+    return NULL;
+}
+
+static const struct {
+    const char* name;
+    int width;
+    int flags;
+} g_reads[] = {
+    {"uint8", 1, 0}, {"uint16", 2, 0}, {"uint32", 4, 0},
+    {"int8", 1, YARA_READ_SIGNED}, {"int16", 2, YARA_READ_SIGNED}, {"int32", 4, YARA_READ_SIGNED},
+    {"uint16be", 2, YARA_READ_BIG_ENDIAN}, {"uint32be", 4, YARA_READ_BIG_ENDIAN},
+    {"int16be", 2, YARA_READ_SIGNED | YARA_READ_BIG_ENDIAN}, {"int32be", 4, YARA_READ_SIGNED | YARA_READ_BIG_ENDIAN},
+};
+
+static yara_expr_t* parse_primary(parser_t* ps) {
+    lexer_t* lx = &ps->lx;
+    token_t* t = &lx->tok;
+    yara_expr_t* e = NULL;
+
+    if (t->type == TOK_NUMBER) {
+        e = new_expr(ps, YARA_EXPR_CONST);
+        if (e) e->value = t->number;
+        next_token(lx);
+        if (e && is_keyword(lx, "of")) return parse_of(ps, e);
+        return e;
+    }
+    if (is_punct(lx, "(")) {
+        next_token(lx);
+        e = parse_expr(ps);
+        if (expect_punct(lx, ")") != 0) {
+            expr_free(e);
+            return NULL;
+        }
+        return e;
+    }
+    if (is_punct(lx, "-") || is_punct(lx, "~")) {
+        const yara_expr_op_t op = is_punct(lx, "-") ? YARA_EXPR_NEG : YARA_EXPR_BIT_NOT;
+        next_token(lx);
+        yara_expr_t* operand = parse_primary(ps);
+        if (!operand) return NULL;
+        e = new_expr(ps, op);
+        if (!e) {
+            expr_free(operand);
+            return NULL;
+        }
+        e->left = operand;
+        return e;
+    }
+    if (t->type == TOK_STRING_ID) {
+        const int s = find_string(ps, t->text);
+        if (s < 0) return NULL;
+        next_token(lx);
+        if (is_keyword(lx, "at")) {
+            next_token(lx);
+            e = new_expr(ps, YARA_EXPR_STRING_AT);
+            if (e && !(e->left = parse_arith(ps))) {
+                expr_free(e);
+                return NULL;
+            }
+        } else if (is_keyword(lx, "in")) {
+            next_token(lx);
+            e = new_expr(ps, YARA_EXPR_STRING_IN);
+            if (!e || expect_punct(lx, "(") != 0 || !(e->left = parse_arith(ps)) ||
+                expect_punct(lx, "..") != 0 || !(e->right = parse_arith(ps)) || expect_punct(lx, ")") != 0) {
+                expr_free(e);
+                return NULL;
+            }
+        } else {
+            e = new_expr(ps, YARA_EXPR_STRING);
+        }
+        if (e) e->value = s;
+        return e;
+    }
+    if (t->type == TOK_COUNT_ID || t->type == TOK_OFFSET_ID || t->type == TOK_LENGTH_ID) {
+        const token_type_t type = t->type;
+        const int s = find_string(ps, t->text);
+        if (s < 0) return NULL;
+        next_token(lx);
+        e = new_expr(ps, type == TOK_COUNT_ID ? YARA_EXPR_STRING_COUNT
+                       : type == TOK_OFFSET_ID ? YARA_EXPR_STRING_OFFSET : YARA_EXPR_STRING_LENGTH);
+        if (!e) return NULL;
+        e->value = s;
+        if (type != TOK_COUNT_ID && !(e->left = parse_index(ps))) {
+            expr_free(e);
+            return NULL;
+        }
+        return e;
+    }
+    if (t->type == TOK_IDENT) {
+        if (strcmp(t->text, "true") == 0 || strcmp(t->text, "false") == 0) {
+            e = new_expr(ps, YARA_EXPR_CONST);
+            if (e) e->value = t->text[0] == 't';
+            next_token(lx);
+            return e;
+        }
+        if (strcmp(t->text, "filesize") == 0) {
+            next_token(lx);
+            return new_expr(ps, YARA_EXPR_FILESIZE);
+        }
+        if (strcmp(t->text, "any") == 0 || strcmp(t->text, "all") == 0 || strcmp(t->text, "none") == 0) {
+            yara_expr_t* quantity = NULL;
+            if (t->text[1] != 'l') {
+                quantity = new_expr(ps, YARA_EXPR_CONST);
+                if (!quantity) return NULL;
+                quantity->value = t->text[0] == 'a' ? YARA_OF_ANY : YARA_OF_NONE;
+            }
+            next_token(lx);
+            if (!is_keyword(lx, "of")) {
+                expr_free(quantity);
+                set_error(lx, "expected 'of'");
+                return NULL;
+            }
+            return parse_of(ps, quantity);
+        }
+        if (strcmp(t->text, "for") == 0 || strcmp(t->text, "entrypoint") == 0) {
+            set_error(lx, "'%s' is not supported", t->text);
+            return NULL;
+        }
+        for (size_t i = 0; i < sizeof(g_reads) / sizeof(g_reads[0]); i++) {
+            if (strcmp(t->text, g_reads[i].name) != 0) continue;
+            next_token(lx);
+            e = new_expr(ps, YARA_EXPR_READ);
+            if (!e) return NULL;
+            e->value = g_reads[i].width;
+            e->flags = g_reads[i].flags;
+            if (expect_punct(lx, "(") != 0 || !(e->left = parse_arith(ps)) || expect_punct(lx, ")") != 0) {
+                expr_free(e);
+                return NULL;
+            }
+            return e;
+        }
+        // Reference to an earlier rule
+        for (size_t r = 0; r < ps->rules->rule_count; r++) {
+            if (strcmp(ps->rules->rules[r].name, t->text) == 0) {
+                e = new_expr(ps, YARA_EXPR_RULE);
+                if (e) e->value = (int64_t)r;
+                next_token(lx);
+                return e;
+            }
+        }
+        set_error(lx, "undefined identifier '%s'", t->text);
+        return NULL;
+    }
+    set_error(lx, "unexpected token in condition");
+    return NULL;
+}
+
+// Binary operator levels, loosest first
+static const struct {
+    const char* ops[3];
+    yara_expr_op_t codes[3];
+} g_arith_levels[] = {
+    {{"|", NULL, NULL}, {YARA_EXPR_BIT_OR}},
+    {{"^", NULL, NULL}, {YARA_EXPR_BIT_XOR}},
+    {{"&", NULL, NULL}, {YARA_EXPR_BIT_AND}},
+    {{"<<", ">>", NULL}, {YARA_EXPR_SHL, YARA_EXPR_SHR}},
+    {{"+", "-", NULL}, {YARA_EXPR_ADD, YARA_EXPR_SUB}},
+    {{"*", "\\", "%"}, {YARA_EXPR_MUL, YARA_EXPR_DIV, YARA_EXPR_MOD}},
+};
+#define ARITH_LEVELS (sizeof(g_arith_levels) / sizeof(g_arith_levels[0]))
+
+static yara_expr_t* parse_level(parser_t* ps, size_t level) {
+    if (level == ARITH_LEVELS) {
+        return parse_primary(ps);
+    }
+    yara_expr_t* left = parse_level(ps, level + 1);
+    while (left) {
+        int matched = -1;
+        for (int k = 0; k < 3 && g_arith_levels[level].ops[k]; k++) {
+            if (is_punct(&ps->lx, g_arith_levels[level].ops[k])) matched = k;
+        }
+        if (matched < 0) break;
+        next_token(&ps->lx);
+        left = binary(ps, g_arith_levels[level].codes[matched], left, parse_level(ps, level + 1));
+    }
+    return left;
+}
+
+static yara_expr_t* parse_arith(parser_t* ps) {
+    return parse_level(ps, 0);
+}
+
+static yara_expr_t* parse_comparison(parser_t* ps) {
+    yara_expr_t* left = parse_arith(ps);
+    static const char* const ops[] = {"==", "!=", "<", "<=", ">", ">="};
+    static const yara_expr_op_t codes[] = {YARA_EXPR_EQ, YARA_EXPR_NE, YARA_EXPR_LT, YARA_EXPR_LE, YARA_EXPR_GT, YARA_EXPR_GE};
+    for (size_t k = 0; left && k < sizeof(ops) / sizeof(ops[0]); k++) {
+        if (is_punct(&ps->lx, ops[k])) {
+            next_token(&ps->lx);
+            return binary(ps, codes[k], left, parse_arith(ps));
+        }
+    }
+    return left;
+}
+
+static yara_expr_t* parse_not(parser_t* ps) {
+    if (is_keyword(&ps->lx, "not")) {
+        next_token(&ps->lx);
+        yara_expr_t* operand = parse_not(ps);
+        if (!operand) return NULL;
+        yara_expr_t* e = new_expr(ps, YARA_EXPR_NOT);
+        if (!e) {
+            expr_free(operand);
+            return NULL;
+        }
+        e->left = operand;
+        return e;
+    }
+    return parse_comparison(ps);
+}
+
+static yara_expr_t* parse_and(parser_t* ps) {
+    yara_expr_t* left = parse_not(ps);
+    while (left && is_keyword(&ps->lx, "and")) {
+        next_token(&ps->lx);
+        left = binary(ps, YARA_EXPR_AND, left, parse_not(ps));
+    }
+    return left;
+}
+
+static yara_expr_t* parse_expr(parser_t* ps) {
+    yara_expr_t* left = parse_and(ps);
+    while (left && is_keyword(&ps->lx, "or")) {
+        next_token(&ps->lx);
+        left = binary(ps, YARA_EXPR_OR, left, parse_and(ps));
+    }
+    return left;
+}
+
+static int add_string(parser_t* ps, const char* identifier, yara_pattern_t* patterns, size_t count) {
+    yara_rules_t* r = ps->rules;
+    if (r->string_count >= ps->string_capacity) {
+        size_t capacity = ps->string_capacity ? ps->string_capacity * 2 : 16;
+        yara_string_t* grown = (yara_string_t*)realloc(r->strings, capacity * sizeof(yara_string_t));
+        if (!grown) return -1;
+        r->strings = grown;
+        ps->string_capacity = capacity;
+    }
+    yara_string_t* s = &r->strings[r->string_count];
+    s->identifier = dup_string(identifier);
+    s->patterns = patterns;
+    s->pattern_count = count;
+    if (!s->identifier) return -1;
+    for (size_t i = 0; i < count; i++) {
+        if (patterns[i].chain_count > 1) patterns[i].chain_slot = (uint32_t)r->chain_slot_count++;
+    }
+    r->string_count++;
+    return 0;
+}
+
+static int parse_strings(parser_t* ps) {
+    lexer_t* lx = &ps->lx;
+    while (lx->tok.type == TOK_STRING_ID) {
+        char identifier[256];
+        snprintf(identifier, sizeof(identifier), "%s", lx->tok.text);
+        if (strchr(identifier, '*')) {
+            set_error(lx, "invalid string identifier");
+            return -1;
+        }
+        if (identifier[0] != '\0') {
+            for (size_t s = ps->current_first; s < ps->rules->string_count; s++) {
+                if (strcmp(ps->rules->strings[s].identifier, identifier) == 0) {
+                    set_error(lx, "duplicate string identifier $%s", identifier);
+                    return -1;
+                }
+            }
+        }
+
+        // The value is lexed by hand: hex strings are not regular tokens
+        skip_space(lx);
+        if (peek_char(lx, 0) != '=') {
+            set_error(lx, "expected '='");
+            return -1;
+        }
+        lx->pos++;
+        skip_space(lx);
+
+        yara_pattern_t* patterns = NULL;
+        size_t count = 0;
+        if (peek_char(lx, 0) == '{') {
+            patterns = (yara_pattern_t*)calloc(1, sizeof(yara_pattern_t));
+            if (!patterns || parse_hex_string(lx, patterns) != 0) {
+                free(patterns);
+                if (!lx->failed) set_error(lx, "out of memory");
+                return -1;
+            }
+            if (pattern_split_chain(&patterns, &count) != 0) {
+                set_error(lx, "out of memory");
+                return -1;
+            }
+            next_token(lx);
+        } else if (peek_char(lx, 0) == '"') {
+            next_token(lx);
+            if (lx->failed) return -1;
+            uint8_t* text = lx->tok.buf;
+            const size_t len = lx->tok.buf_len;
+            lx->tok.buf = NULL;
+            if (len == 0) {
+                free(text);
+                set_error(lx, "empty string");
+                return -1;
+            }
+            int nocase = 0, wide = 0, ascii = 0, fullword = 0;
+            next_token(lx);
+            for (;;) {
+                if (is_keyword(lx, "nocase")) nocase = 1;
+                else if (is_keyword(lx, "wide")) wide = 1;
+                else if (is_keyword(lx, "ascii")) ascii = 1;
+                else if (is_keyword(lx, "fullword")) fullword = 1;
+                else if (is_keyword(lx, "private")) { /* Matches are not reported anyway */ }
+                else if (is_keyword(lx, "xor") || is_keyword(lx, "base64") || is_keyword(lx, "base64wide")) {
+                    free(text);
+                    set_error(lx, "string modifier '%s' is not supported", lx->tok.text);
+                    return -1;
+                } else break;
+                next_token(lx);
+            }
+            if (!wide) ascii = 1;
+            patterns = (yara_pattern_t*)calloc(2, sizeof(yara_pattern_t));
+            int ok = patterns != NULL;
+            if (ok && ascii) ok = text_pattern(&patterns[count++], text, len, nocase, 0, fullword) == 0;
+            if (ok && wide) ok = text_pattern(&patterns[count++], text, len, nocase, 1, fullword) == 0;
+            free(text);
+            if (!ok) {
+                for (size_t i = 0; patterns && i < count; i++) pattern_free(&patterns[i]);
+                free(patterns);
+                set_error(lx, "out of memory");
+                return -1;
+            }
+        } else if (peek_char(lx, 0) == '/') {
+            set_error(lx, "regular expressions are not supported");
+            return -1;
+        } else {
+            set_error(lx, "expected string value");
+            return -1;
+        }
+
+        if (add_string(ps, identifier, patterns, count) != 0) {
+            for (size_t i = 0; i < count; i++) pattern_free(&patterns[i]);
+            free(patterns);
+            set_error(lx, "out of memory");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int parse_meta(parser_t* ps, yara_rule_t* rule) {
+    lexer_t* lx = &ps->lx;
+    while (lx->tok.type == TOK_IDENT && !is_keyword(lx, "strings") && !is_keyword(lx, "condition")) {
+        char key[256];
+        snprintf(key, sizeof(key), "%s", lx->tok.text);
+        next_token(lx);
+        if (expect_punct(lx, "=") != 0) return -1;
+        char** target = strcmp(key, "description") == 0 ? &rule->description
+                      : strcmp(key, "author") == 0 ? &rule->author
+                      : strcmp(key, "version") == 0 ? &rule->version : NULL;
+        if (lx->tok.type == TOK_TEXT) {
+            if (target && !*target) {
+                *target = (char*)malloc(lx->tok.buf_len + 1);
+                if (!*target) return -1;
+                memcpy(*target, lx->tok.buf, lx->tok.buf_len);
+                (*target)[lx->tok.buf_len] = '\0';
+            }
+        } else if (lx->tok.type == TOK_NUMBER || is_punct(lx, "-")) {
+            int negative = is_punct(lx, "-");
+            if (negative) next_token(lx);
+            if (lx->tok.type != TOK_NUMBER) {
+                set_error(lx, "invalid meta value");
+                return -1;
+            }
+            if (strcmp(key, "severity") == 0) {
+                const int64_t v = negative ? -lx->tok.number : lx->tok.number;
+                rule->severity = v < 1 ? 1 : v > 10 ? 10 : (int)v;
+            }
+        } else if (!is_keyword(lx, "true") && !is_keyword(lx, "false")) {
+            set_error(lx, "invalid meta value");
+            return -1;
+        }
+        next_token(lx);
+    }
+    return 0;
+}
+
+static void rule_free(yara_rule_t* rule) {
+    free(rule->name);
+    free(rule->rule_namespace);
+    free(rule->description);
+    free(rule->author);
+    free(rule->version);
+    expr_free(rule->condition);
+}
+
+static int parse_rule(parser_t* ps) {
+    lexer_t* lx = &ps->lx;
+    yara_rule_t rule;
+    memset(&rule, 0, sizeof(rule));
+    rule.severity = 5;
+
+    while (is_keyword(lx, "private") || is_keyword(lx, "global")) {
+        if (lx->tok.text[0] == 'p') rule.is_private = 1;
+        else rule.is_global = 1;
+        next_token(lx);
+    }
+    if (!is_keyword(lx, "rule")) {
+        if (is_keyword(lx, "import") || is_keyword(lx, "include")) {
+            set_error(lx, "'%s' is not supported", lx->tok.text);
+        } else {
+            set_error(lx, "expected 'rule'");
+        }
+        return -1;
+    }
+    next_token(lx);
+    if (lx->tok.type != TOK_IDENT) {
+        set_error(lx, "expected rule name");
+        return -1;
+    }
+    for (size_t r = 0; r < ps->rules->rule_count; r++) {
+        if (strcmp(ps->rules->rules[r].name, lx->tok.text) == 0) {
+            set_error(lx, "duplicate rule '%s'", lx->tok.text);
+            return -1;
+        }
+    }
+    rule.name = dup_string(lx->tok.text);
+    rule.rule_namespace = dup_string("default");
+    next_token(lx);
+
+    // Tags are accepted and ignored
+    if (is_punct(lx, ":")) {
+        next_token(lx);
+        while (lx->tok.type == TOK_IDENT) next_token(lx);
+    }
+    if (expect_punct(lx, "{") != 0) goto fail;
+
+    ps->current_first = ps->rules->string_count;
+    rule.string_first = ps->current_first;
+    if (is_keyword(lx, "meta")) {
+        next_token(lx);
+        if (expect_punct(lx, ":") != 0 || parse_meta(ps, &rule) != 0) goto fail;
+    }
+    if (is_keyword(lx, "strings")) {
+        next_token(lx);
+        if (expect_punct(lx, ":") != 0 || parse_strings(ps) != 0) goto fail;
+    }
+    rule.string_count = ps->rules->string_count - rule.string_first;
+    if (!is_keyword(lx, "condition")) {
+        set_error(lx, "expected 'condition'");
+        goto fail;
+    }
+    next_token(lx);
+    if (expect_punct(lx, ":") != 0) goto fail;
+    rule.condition = parse_expr(ps);
+    if (!rule.condition || expect_punct(lx, "}") != 0) goto fail;
+
+    if (!rule.name || !rule.rule_namespace) {
+        set_error(lx, "out of memory");
+        goto fail;
+    }
+    if (ps->rules->rule_count >= ps->rule_capacity) {
+        size_t capacity = ps->rule_capacity ? ps->rule_capacity * 2 : 16;
+        yara_rule_t* grown = (yara_rule_t*)realloc(ps->rules->rules, capacity * sizeof(yara_rule_t));
+        if (!grown) {
+            set_error(lx, "out of memory");
+            goto fail;
+        }
+        ps->rules->rules = grown;
+        ps->rule_capacity = capacity;
+    }
+    ps->rules->rules[ps->rules->rule_count++] = rule;
+    return 0;
+
+fail:
+    rule_free(&rule);
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Automaton
+
+typedef struct {
+    uint8_t bytes[YARA_ATOM_MAX];
+    size_t length;
+    yara_atom_ref_t ref;
+} atom_entry_t;
+
+// All case variants of a nocase atom
+static size_t atom_variants(const yara_pattern_t* p, uint8_t out[][YARA_ATOM_MAX]) {
+    size_t count = 1;
+    memcpy(out[0], p->atom, p->atom_length);
+    if (!p->atom_nocase) {
+        return 1;
+    }
+    for (size_t i = 0; i < p->atom_length; i++) {
+        const uint8_t b = p->atom[i];
+        if (!isalpha(b)) continue;
+        for (size_t v = 0; v < count; v++) {
+            memcpy(out[count + v], out[v], p->atom_length);
+            out[count + v][i] = (uint8_t)toupper(b);
+        }
+        count *= 2;
+    }
+    return count;
+}
+
+static int build_automaton(yara_rules_t* r) {
+    // Gather atoms
+    size_t atom_count = 0, atom_capacity = 64, total_bytes = 0;
+    atom_entry_t* atoms = (atom_entry_t*)malloc(atom_capacity * sizeof(atom_entry_t));
+    if (!atoms) return -1;
+    for (size_t s = 0; s < r->string_count; s++) {
+        for (size_t p = 0; p < r->strings[s].pattern_count; p++) {
+            const yara_pattern_t* pat = &r->strings[s].patterns[p];
+            yara_atom_ref_t ref = {(uint32_t)s, (uint32_t)p};
+            if (pat->atom_length == 0) {
+                yara_atom_ref_t* grown = (yara_atom_ref_t*)realloc(r->unanchored, (r->unanchored_count + 1) * sizeof(yara_atom_ref_t));
+                if (!grown) goto fail_atoms;
+                r->unanchored = grown;
+                r->unanchored[r->unanchored_count++] = ref;
+                continue;
+            }
+            uint8_t variants[1 << YARA_ATOM_MAX][YARA_ATOM_MAX];
+            const size_t n = atom_variants(pat, variants);
+            for (size_t v = 0; v < n; v++) {
+                if (atom_count >= atom_capacity) {
+                    atom_capacity *= 2;
+                    atom_entry_t* grown = (atom_entry_t*)realloc(atoms, atom_capacity * sizeof(atom_entry_t));
+                    if (!grown) goto fail_atoms;
+                    atoms = grown;
+                }
+                memcpy(atoms[atom_count].bytes, variants[v], pat->atom_length);
+                atoms[atom_count].length = pat->atom_length;
+                atoms[atom_count].ref = ref;
+                atom_count++;
+                total_bytes += pat->atom_length;
+            }
+        }
+    }
+
+    // Trie
+    const size_t max_states = total_bytes + 1;
+    int32_t* next = (int32_t*)malloc(max_states * 256 * sizeof(int32_t));
+    int32_t* first_atom = (int32_t*)malloc(max_states * sizeof(int32_t));
+    int32_t* atom_next = (int32_t*)malloc((atom_count + 1) * sizeof(int32_t));
+    uint32_t* fail = (uint32_t*)malloc(max_states * sizeof(uint32_t));
+    uint32_t* queue = (uint32_t*)malloc(max_states * sizeof(uint32_t));
+    uint32_t* out_count = (uint32_t*)calloc(max_states, sizeof(uint32_t));
+    int ok = next && first_atom && atom_next && fail && queue && out_count;
+    size_t state_count = 1;
+    if (ok) {
+        memset(next, 0xFF, max_states * 256 * sizeof(int32_t));
+        memset(first_atom, 0xFF, max_states * sizeof(int32_t));
+        for (size_t a = 0; a < atom_count; a++) {
+            int32_t node = 0;
+            for (size_t i = 0; i < atoms[a].length; i++) {
+                int32_t* slot = &next[(size_t)node * 256 + atoms[a].bytes[i]];
+                if (*slot < 0) *slot = (int32_t)state_count++;
+                node = *slot;
+            }
+            atom_next[a] = first_atom[node];
+            first_atom[node] = (int32_t)a;
+        }
+        r->state_count = (uint32_t)state_count;
+        r->delta = (uint32_t*)malloc(state_count * 256 * sizeof(uint32_t));
+        r->out_begin = (uint32_t*)malloc((state_count + 1) * sizeof(uint32_t));
+        ok = r->delta && r->out_begin;
+    }
+
+    // Breadth-first fail links, flattened into a full transition table
+    size_t head = 0, tail = 0;
+    if (ok) {
+        fail[0] = 0;
+        for (int c = 0; c < 256; c++) {
+            const int32_t child = next[c];
+            r->delta[c] = child < 0 ? 0 : (uint32_t)child;
+            if (child >= 0) {
+                fail[child] = 0;
+                queue[tail++] = (uint32_t)child;
+                r->is_start[c] = 1;
+            }
+        }
+        while (head < tail) {
+            const uint32_t u = queue[head++];
+            for (int c = 0; c < 256; c++) {
+                const int32_t v = next[(size_t)u * 256 + c];
+                const uint32_t via_fail = r->delta[(size_t)fail[u] * 256 + c];
+                if (v < 0) {
+                    r->delta[(size_t)u * 256 + c] = via_fail;
+                } else {
+                    r->delta[(size_t)u * 256 + c] = (uint32_t)v;
+                    fail[v] = via_fail;
+                    queue[tail++] = (uint32_t)v;
+                }
+            }
+        }
+        for (size_t q = 0; q < tail; q++) {
+            const uint32_t u = queue[q];
+            uint32_t own = 0;
+            for (int32_t a = first_atom[u]; a >= 0; a = atom_next[a]) own++;
+            out_count[u] = own + out_count[fail[u]];
+        }
+        r->out_begin[0] = 0;
+        for (size_t s = 0; s < state_count; s++) {
+            r->out_begin[s + 1] = r->out_begin[s] + out_count[s];
+        }
+        r->outputs = (yara_atom_ref_t*)malloc(((size_t)r->out_begin[state_count] + 1) * sizeof(yara_atom_ref_t));
+        ok = r->outputs != NULL;
+    }
+    if (ok) {
+        for (size_t q = 0; q < tail; q++) {
+            const uint32_t u = queue[q];
+            yara_atom_ref_t* dst = r->outputs + r->out_begin[u];
+            for (int32_t a = first_atom[u]; a >= 0; a = atom_next[a]) *dst++ = atoms[a].ref;
+            memcpy(dst, r->outputs + r->out_begin[fail[u]], out_count[fail[u]] * sizeof(yara_atom_ref_t));
+        }
+    }
+
+    free(next);
+    free(first_atom);
+    free(atom_next);
+    free(fail);
+    free(queue);
+    free(out_count);
+    free(atoms);
+    return ok ? 0 : -1;
+
+fail_atoms:
+    free(atoms);
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+
+yara_rules_t* yara_rules_compile(const char* source, size_t size, char* error, size_t error_size) {
+    if (error && error_size > 0) {
+        error[0] = '\0';
+    }
+    if (!source) {
+        return NULL;
+    }
+
+    parser_t ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.lx.src = source;
+    ps.lx.size = size;
+    ps.lx.line = 1;
+    ps.lx.error = error;
+    ps.lx.error_size = error_size;
+    ps.rules = (yara_rules_t*)calloc(1, sizeof(yara_rules_t));
+    if (!ps.rules) {
+        return NULL;
+    }
+    ps.rules->refcount = 1;
+
+    next_token(&ps.lx);
+    while (!ps.lx.failed && ps.lx.tok.type != TOK_EOF) {
+        if (parse_rule(&ps) != 0) break;
+    }
+    if (!ps.lx.failed && build_automaton(ps.rules) != 0) {
+        set_error(&ps.lx, "out of memory");
+    }
+    free(ps.lx.tok.buf);
+
+    if (ps.lx.failed) {
+        yara_rules_free(ps.rules);
+        return NULL;
+    }
+    return ps.rules;
+}
+
+yara_rules_t* yara_rules_retain(yara_rules_t* rules) {
+    if (rules) {
+        __atomic_add_fetch(&rules->refcount, 1, __ATOMIC_RELAXED);
+    }
+    return rules;
+}
+
+void yara_rules_free(yara_rules_t* rules) {
+    if (!rules || __atomic_sub_fetch(&rules->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    for (size_t r = 0; r < rules->rule_count; r++) {
+        rule_free(&rules->rules[r]);
+    }
+    for (size_t s = 0; s < rules->string_count; s++) {
+        for (size_t p = 0; p < rules->strings[s].pattern_count; p++) {
+            pattern_free(&rules->strings[s].patterns[p]);
+        }
+        free(rules->strings[s].patterns);
+        free(rules->strings[s].identifier);
+    }
+    free(rules->rules);
+    free(rules->strings);
+    free(rules->delta);
+    free(rules->out_begin);
+    free(rules->outputs);
+    free(rules->unanchored);
+    free(rules);
+}
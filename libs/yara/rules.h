@@ -1,15 +1,174 @@
 #ifndef LIBS_YARA_RULES_H
 #define LIBS_YARA_RULES_H
 
+#include <stdint.h>
+#include <stddef.h>
+#include "yara.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// This is a placeholder for YARA rule management functions
-// In a full implementation, this would contain functions for managing YARA rules
+// Native compiler for a practical subset of the YARA rule language:
+//   - rule modifiers private/global, tags and meta (strings, integers, booleans)
+//   - text strings with escapes and the nocase/wide/ascii/fullword modifiers
+//   - hex strings with ?? / nibble wildcards and [n], [n-m], [n-], [-] jumps
+//   - conditions: and/or/not, comparisons, arithmetic and bitwise operators,
+//     $a, $a at x, $a in (x..y), #a, @a[i], !a[i], filesize, "N of" sets
+//     (them, ($a, $b*), any/all/none), uint8/16/32 and int8/16/32 reads
+//     (with be variants), and references to earlier rules
+// Regular expressions, modules, imports and for-loops are rejected with an error.
+
+#define YARA_ATOM_MAX 4
+#define YARA_JUMP_UNBOUNDED UINT32_MAX
+// Hex strings are split into chained fragments at jumps longer than this,
+// as in YARA
+#define YARA_CHAIN_GAP 200
+
+// One pattern byte: matches b when (b & mask) == value, or case-insensitively
+typedef struct {
+    uint8_t value;
+    uint8_t mask;
+    uint8_t nocase;
+} yara_pattern_byte_t;
+
+// Fixed run of pattern bytes followed by a gap before the next run
+typedef struct {
+    yara_pattern_byte_t* bytes;
+    size_t length;
+    uint32_t jump_min;
+    uint32_t jump_max;      // YARA_JUMP_UNBOUNDED for [n-] and [-]
+} yara_segment_t;
+
+// One concrete encoding of a string (ascii or wide)
+typedef struct {
+    yara_segment_t* segments;
+    size_t segment_count;
+    int wide;
+    int fullword;
+    // Atom: exact bytes at a fixed distance from the match start, fed to the
+    // automaton. atom_length == 0 means the pattern has no usable atom and
+    // is tried at every offset.
+    size_t atom_offset;
+    uint8_t atom[YARA_ATOM_MAX];
+    size_t atom_length;
+    int atom_nocase;
+    // Chained fragments: a hex string with unbounded jumps or jumps longer
+    // than YARA_CHAIN_GAP is split there into fragments, stored as
+    // consecutive patterns of the string. Each fragment is found through its
+    // own atom; the scanner joins fragment matches by their gap windows.
+    // chain_count is 1 for patterns that are not chained.
+    uint32_t chain_index;
+    uint32_t chain_count;
+    uint32_t chain_gap_min;  // Gap to the next fragment
+    uint32_t chain_gap_max;  // YARA_JUMP_UNBOUNDED for [n-] and [-]
+    uint32_t chain_slot;     // Fragment match list in the scan state
+} yara_pattern_t;
+
+typedef struct {
+    char* identifier;       // Without the leading '$'; empty for anonymous strings
+    yara_pattern_t* patterns;
+    size_t pattern_count;
+} yara_string_t;
+
+typedef enum {
+    YARA_EXPR_CONST,        // value
+    YARA_EXPR_FILESIZE,
+    YARA_EXPR_STRING,       // value = string index; true if it matched
+    YARA_EXPR_STRING_AT,    // left = offset
+    YARA_EXPR_STRING_IN,    // left..right = range
+    YARA_EXPR_STRING_COUNT, // #a
+    YARA_EXPR_STRING_OFFSET,// @a[left]
+    YARA_EXPR_STRING_LENGTH,// !a[left]
+    YARA_EXPR_RULE,         // value = rule index
+    YARA_EXPR_OF,           // left = quantity (NULL = all, CONST -1 = any), set
+    YARA_EXPR_READ,         // value = width in bytes, flags = signed/big-endian, left = offset
+    YARA_EXPR_NOT,
+    YARA_EXPR_AND,
+    YARA_EXPR_OR,
+    YARA_EXPR_EQ, YARA_EXPR_NE, YARA_EXPR_LT, YARA_EXPR_LE, YARA_EXPR_GT, YARA_EXPR_GE,
+    YARA_EXPR_ADD, YARA_EXPR_SUB, YARA_EXPR_MUL, YARA_EXPR_DIV, YARA_EXPR_MOD,
+    YARA_EXPR_BIT_AND, YARA_EXPR_BIT_OR, YARA_EXPR_BIT_XOR, YARA_EXPR_SHL, YARA_EXPR_SHR,
+    YARA_EXPR_NEG, YARA_EXPR_BIT_NOT
+} yara_expr_op_t;
+
+#define YARA_READ_SIGNED 1
+#define YARA_READ_BIG_ENDIAN 2
+#define YARA_OF_ANY (-1)
+#define YARA_OF_NONE (-2)
+
+typedef struct yara_expr yara_expr_t;
+struct yara_expr {
+    yara_expr_op_t op;
+    int64_t value;
+    int flags;
+    yara_expr_t* left;
+    yara_expr_t* right;
+    uint32_t* set;          // String indexes for YARA_EXPR_OF
+    size_t set_count;
+};
+
+typedef struct {
+    char* name;
+    char* rule_namespace;
+    char* description;
+    char* author;
+    char* version;
+    int severity;           // meta severity (1-10), 5 if absent
+    int is_private;
+    int is_global;
+    size_t string_first;    // Strings of this rule: strings[string_first .. string_first + string_count)
+    size_t string_count;
+    yara_expr_t* condition;
+} yara_rule_t;
+
+// Reference from an automaton output to a pattern
+typedef struct {
+    uint32_t string;
+    uint32_t pattern;
+} yara_atom_ref_t;
+
+// Compiled rule set. Every atom of every rule sits in one Aho-Corasick
+// automaton, so one pass over the data finds all candidate matches no
+// matter how many rules are loaded. Nothing but the reference count changes
+// after compilation, so a rule set can be shared by any number of threads.
+struct yara_rules {
+    yara_rule_t* rules;
+    size_t rule_count;
+    yara_string_t* strings;
+    size_t string_count;
+
+    uint32_t* delta;        // state * 256 + byte -> next state
+    uint32_t state_count;
+    uint32_t* out_begin;    // Outputs of state s: outputs[out_begin[s] .. out_begin[s + 1])
+    yara_atom_ref_t* outputs;
+    uint8_t is_start[256];  // Bytes that leave the root state
+
+    yara_atom_ref_t* unanchored;   // Patterns without an atom
+    size_t unanchored_count;
+    size_t chain_slot_count;       // Chained fragments across all strings
+
+    unsigned long refcount;        // Updated atomically
+};
+
+// Compile rule source
+// error: receives a message with the line number on failure (may be NULL)
+// Returns the compiled rules with one reference (release with yara_rules_free),
+// or NULL on error
+yara_rules_t* yara_rules_compile(const char* source, size_t size, char* error, size_t error_size);
+
+// Take another reference to compiled rules; returns rules
+yara_rules_t* yara_rules_retain(yara_rules_t* rules);
+
+// Release a reference; the rules are freed with the last one
+void yara_rules_free(yara_rules_t* rules);
+
+// Match a pattern anchored at data[start]; returns the match length, or -1.
+// A chained fragment is matched on its own.
+int64_t yara_pattern_match(const yara_pattern_t* pattern, const uint8_t* data, size_t size, size_t start);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif // LIBS_YARA_RULES_H
\ No newline at end of file
+#endif // LIBS_YARA_RULES_H
@@ -1,4 +1,509 @@
 #include "scanner.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-// This is a placeholder for YARA scanning functions
-// In a full implementation, this would contain functions for scanning with YARA
\ No newline at end of file
+// Value of a condition expression that cannot be computed (out-of-range
+// read, missing match, division by zero). It propagates through operators,
+// including comparisons and "not", and counts as false.
+#define UNDEFINED INT64_MIN
+
+typedef struct {
+    uint64_t offset;
+    uint32_t length;
+} string_match_t;
+
+typedef struct {
+    string_match_t* items;
+    size_t count;
+    size_t capacity;
+    int unsorted;
+} match_list_t;
+
+typedef struct {
+    const yara_rules_t* rules;
+    const uint8_t* data;
+    size_t size;
+    match_list_t* lists;    // One per string
+    match_list_t* chain_lists; // One per chained fragment
+    int64_t* rule_values;   // Condition result of each evaluated rule
+    uint32_t* touched;      // Strings with matches in the current scan
+    size_t touched_count;
+} scan_context_t;
+
+// Per-thread scan state, reused across scans so that match lists keep their
+// storage and only the strings that matched need resetting
+struct yara_scratch {
+    scan_context_t ctx;
+};
+
+// Append a match, dropping one already found at the same offset
+static int list_append(match_list_t* list, uint64_t offset, uint32_t length) {
+    if (list->count >= YARA_MAX_STRING_MATCHES) {
+        return 0;
+    }
+    if (list->count > 0) {
+        const string_match_t* last = &list->items[list->count - 1];
+        if (last->offset == offset) return 0;   // Same match found through another atom
+        if (last->offset > offset) list->unsorted = 1;
+    }
+    if (list->count >= list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 8;
+        string_match_t* grown = (string_match_t*)realloc(list->items, capacity * sizeof(string_match_t));
+        if (!grown) return -1;
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count].offset = offset;
+    list->items[list->count].length = length;
+    list->count++;
+    return 0;
+}
+
+static int list_push(scan_context_t* ctx, uint32_t string, uint64_t offset, uint32_t length) {
+    match_list_t* list = &ctx->lists[string];
+    if (list->count == 0) {
+        ctx->touched[ctx->touched_count++] = string;
+    }
+    return list_append(list, offset, length);
+}
+
+static int compare_matches(const void* a, const void* b) {
+    const string_match_t* x = (const string_match_t*)a;
+    const string_match_t* y = (const string_match_t*)b;
+    return x->offset < y->offset ? -1 : x->offset > y->offset ? 1 : 0;
+}
+
+static void list_finish(match_list_t* list) {
+    if (!list->unsorted) {
+        return;
+    }
+    qsort(list->items, list->count, sizeof(string_match_t), compare_matches);
+    size_t kept = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        if (kept == 0 || list->items[kept - 1].offset != list->items[i].offset) {
+            list->items[kept++] = list->items[i];
+        }
+    }
+    list->count = kept;
+    list->unsorted = 0;
+}
+
+// First match at or after offset
+static size_t lower_bound(const match_list_t* list, uint64_t offset) {
+    size_t lo = 0, hi = list->count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (list->items[mid].offset < offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int verify(scan_context_t* ctx, const yara_atom_ref_t* ref, size_t start) {
+    const yara_pattern_t* pattern = &ctx->rules->strings[ref->string].patterns[ref->pattern];
+    const int64_t length = yara_pattern_match(pattern, ctx->data, ctx->size, start);
+    if (length < 0) {
+        return 0;
+    }
+    if (pattern->chain_count > 1) {
+        return list_append(&ctx->chain_lists[pattern->chain_slot], start, (uint32_t)length);
+    }
+    return list_push(ctx, ref->string, start, (uint32_t)length);
+}
+
+// Join the fragment matches of a chained string. Walking back from the last
+// fragment, a match is kept if the next fragment has a kept match starting
+// within its gap window; its length is extended to the end of the chain
+// through the nearest one. Each window is one binary search, so the join
+// is O(n log n) in the fragment matches however long the jumps are.
+static int join_chain(scan_context_t* ctx, uint32_t string) {
+    const yara_string_t* str = &ctx->rules->strings[string];
+    for (size_t k = 0; k < str->pattern_count; k++) {
+        match_list_t* list = &ctx->chain_lists[str->patterns[k].chain_slot];
+        list_finish(list);
+        if (list->count == 0) return 0;
+    }
+    for (size_t k = str->pattern_count - 1; k-- > 0; ) {
+        const yara_pattern_t* fragment = &str->patterns[k];
+        match_list_t* list = &ctx->chain_lists[fragment->chain_slot];
+        const match_list_t* next = &ctx->chain_lists[str->patterns[k + 1].chain_slot];
+        size_t kept = 0;
+        for (size_t i = 0; i < list->count; i++) {
+            string_match_t m = list->items[i];
+            const uint64_t end = m.offset + m.length;
+            const uint64_t lo = end + fragment->chain_gap_min;
+            const uint64_t hi = fragment->chain_gap_max == YARA_JUMP_UNBOUNDED ? UINT64_MAX
+                                                                               : end + fragment->chain_gap_max;
+            const size_t j = lower_bound(next, lo);
+            if (j >= next->count || next->items[j].offset > hi) continue;
+            const uint64_t chain_end = next->items[j].offset + next->items[j].length;
+            m.length = chain_end - m.offset > UINT32_MAX ? UINT32_MAX : (uint32_t)(chain_end - m.offset);
+            list->items[kept++] = m;
+        }
+        list->count = kept;
+        if (kept == 0) return 0;
+    }
+    const match_list_t* first = &ctx->chain_lists[str->patterns[0].chain_slot];
+    for (size_t i = 0; i < first->count; i++) {
+        if (list_push(ctx, string, first->items[i].offset, first->items[i].length) != 0) return -1;
+    }
+    return 0;
+}
+
+// Single pass of the automaton; every atom hit is verified in place
+static int collect_matches(scan_context_t* ctx) {
+    const yara_rules_t* r = ctx->rules;
+    const uint8_t* data = ctx->data;
+    const size_t size = ctx->size;
+    const uint32_t* delta = r->delta;
+    const uint8_t* is_start = r->is_start;
+    uint32_t s = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        if (s == 0) {
+            while (i < size && !is_start[data[i]]) i++;
+            if (i >= size) break;
+        }
+        s = delta[(size_t)s * 256 + data[i]];
+        for (uint32_t o = r->out_begin[s]; o < r->out_begin[s + 1]; o++) {
+            const yara_atom_ref_t* ref = &r->outputs[o];
+            const yara_pattern_t* p = &r->strings[ref->string].patterns[ref->pattern];
+            const size_t back = p->atom_length + p->atom_offset;
+            if (i + 1 >= back && verify(ctx, ref, i + 1 - back) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    // Patterns made only of wildcards have no atom; try every offset
+    for (size_t u = 0; u < r->unanchored_count; u++) {
+        for (size_t start = 0; start < size; start++) {
+            if (verify(ctx, &r->unanchored[u], start) != 0) return -1;
+        }
+    }
+
+    // Chained strings, joined once all their fragments are known
+    for (size_t k = 0; k < r->string_count; k++) {
+        const yara_pattern_t* first = &r->strings[k].patterns[0];
+        if (first->chain_count > 1 && ctx->chain_lists[first->chain_slot].count > 0 &&
+            join_chain(ctx, (uint32_t)k) != 0) {
+            return -1;
+        }
+    }
+
+    for (size_t k = 0; k < ctx->touched_count; k++) {
+        list_finish(&ctx->lists[ctx->touched[k]]);
+    }
+    return 0;
+}
+
+static int truthy(int64_t v) {
+    return v != UNDEFINED && v != 0;
+}
+
+static int64_t eval(const scan_context_t* ctx, const yara_expr_t* e);
+
+static int64_t eval_read(const scan_context_t* ctx, const yara_expr_t* e) {
+    const int64_t offset = eval(ctx, e->left);
+    const int width = (int)e->value;
+    if (offset == UNDEFINED || offset < 0 || (uint64_t)offset + (uint64_t)width > ctx->size) {
+        return UNDEFINED;
+    }
+    const uint8_t* p = ctx->data + offset;
+    uint64_t v = 0;
+    for (int k = 0; k < width; k++) {
+        const int shift = (e->flags & YARA_READ_BIG_ENDIAN) ? 8 * (width - 1 - k) : 8 * k;
+        v |= (uint64_t)p[k] << shift;
+    }
+    if ((e->flags & YARA_READ_SIGNED) && width < 8 && (v >> (8 * width - 1)) & 1) {
+        v |= ~0ULL << (8 * width);
+    }
+    return (int64_t)v;
+}
+
+static int64_t eval(const scan_context_t* ctx, const yara_expr_t* e) {
+    const match_list_t* list = NULL;
+    if (e->op >= YARA_EXPR_STRING && e->op <= YARA_EXPR_STRING_LENGTH) {
+        list = &ctx->lists[e->value];
+    }
+
+    switch (e->op) {
+        case YARA_EXPR_CONST:
+            return e->value;
+        case YARA_EXPR_FILESIZE:
+            return (int64_t)ctx->size;
+        case YARA_EXPR_STRING:
+            return list->count > 0;
+        case YARA_EXPR_STRING_AT: {
+            const int64_t at = eval(ctx, e->left);
+            if (at == UNDEFINED || at < 0) return 0;
+            const size_t i = lower_bound(list, (uint64_t)at);
+            return i < list->count && list->items[i].offset == (uint64_t)at;
+        }
+        case YARA_EXPR_STRING_IN: {
+            const int64_t lo = eval(ctx, e->left), hi = eval(ctx, e->right);
+            if (lo == UNDEFINED || hi == UNDEFINED || hi < 0 || hi < lo) return 0;
+            const size_t i = lower_bound(list, lo < 0 ? 0 : (uint64_t)lo);
+            return i < list->count && list->items[i].offset <= (uint64_t)hi;
+        }
+        case YARA_EXPR_STRING_COUNT:
+            return (int64_t)list->count;
+        case YARA_EXPR_STRING_OFFSET:
+        case YARA_EXPR_STRING_LENGTH: {
+            const int64_t index = eval(ctx, e->left);
+            if (index == UNDEFINED || index < 1 || (uint64_t)index > list->count) return UNDEFINED;
+            const string_match_t* m = &list->items[index - 1];
+            return e->op == YARA_EXPR_STRING_OFFSET ? (int64_t)m->offset : (int64_t)m->length;
+        }
+        case YARA_EXPR_RULE:
+            return ctx->rule_values[e->value];
+        case YARA_EXPR_OF: {
+            size_t matched = 0;
+            for (size_t k = 0; k < e->set_count; k++) {
+                matched += ctx->lists[e->set[k]].count > 0;
+            }
+            if (!e->left) return matched == e->set_count;
+            const int64_t quantity = eval(ctx, e->left);
+            if (quantity == YARA_OF_ANY) return matched > 0;
+            if (quantity == YARA_OF_NONE) return matched == 0;
+            return quantity != UNDEFINED && (int64_t)matched >= quantity;
+        }
+        case YARA_EXPR_READ:
+            return eval_read(ctx, e);
+        case YARA_EXPR_NOT: {
+            const int64_t v = eval(ctx, e->left);
+            return v == UNDEFINED ? UNDEFINED : !v;
+        }
+        case YARA_EXPR_AND:
+            return truthy(eval(ctx, e->left)) && truthy(eval(ctx, e->right));
+        case YARA_EXPR_OR:
+            return truthy(eval(ctx, e->left)) || truthy(eval(ctx, e->right));
+        case YARA_EXPR_NEG:
+        case YARA_EXPR_BIT_NOT: {
+            const int64_t v = eval(ctx, e->left);
+            if (v == UNDEFINED) return UNDEFINED;
+            return e->op == YARA_EXPR_NEG ? (int64_t)(0 - (uint64_t)v) : ~v;
+        }
+        default:
+            break;
+    }
+
+    // Binary operators
+    const int64_t a = eval(ctx, e->left);
+    const int64_t b = eval(ctx, e->right);
+    if (a == UNDEFINED || b == UNDEFINED) {
+        return UNDEFINED;
+    }
+    switch (e->op) {
+        case YARA_EXPR_EQ: return a == b;
+        case YARA_EXPR_NE: return a != b;
+        case YARA_EXPR_LT: return a < b;
+        case YARA_EXPR_LE: return a <= b;
+        case YARA_EXPR_GT: return a > b;
+        case YARA_EXPR_GE: return a >= b;
+        case YARA_EXPR_ADD: return (int64_t)((uint64_t)a + (uint64_t)b);
+        case YARA_EXPR_SUB: return (int64_t)((uint64_t)a - (uint64_t)b);
+        case YARA_EXPR_MUL: return (int64_t)((uint64_t)a * (uint64_t)b);
+        case YARA_EXPR_DIV: return (b == 0 || (a == INT64_MIN + 1 && b == -1)) ? UNDEFINED : a / b;
+        case YARA_EXPR_MOD: return b == 0 ? UNDEFINED : a % b;
+        case YARA_EXPR_BIT_AND: return a & b;
+        case YARA_EXPR_BIT_OR: return a | b;
+        case YARA_EXPR_BIT_XOR: return a ^ b;
+        case YARA_EXPR_SHL: return (b < 0 || b >= 64) ? 0 : (int64_t)((uint64_t)a << b);
+        case YARA_EXPR_SHR: return (b < 0 || b >= 64) ? 0 : (int64_t)((uint64_t)a >> b);
+        default: return UNDEFINED;
+    }
+}
+
+static int report_rule(const scan_context_t* ctx, const yara_rule_t* rule, const char* file_path,
+                       yara_match_callback_t callback, void* user_data) {
+    // Names point into the rules; the callback copies what it keeps
+    yara_match_t match;
+    match.rule_name = rule->name;
+    match.rule_namespace = rule->rule_namespace;
+    match.severity = rule->severity;
+
+    int reported = 0;
+    char id[258];
+    for (size_t s = rule->string_first; s < rule->string_first + rule->string_count; s++) {
+        const match_list_t* list = &ctx->lists[s];
+        if (list->count == 0) continue;
+        id[0] = '$';
+        strncpy(id + 1, ctx->rules->strings[s].identifier, sizeof(id) - 2);
+        id[sizeof(id) - 1] = '\0';
+        match.matched_string = id;
+        match.offset = (size_t)list->items[0].offset;
+        match.length = list->items[0].length;
+        if (callback(file_path, &match, user_data) != 0) return 1;
+        reported = 1;
+    }
+    if (!reported) {
+        match.matched_string = (char*)"";
+        match.offset = 0;
+        match.length = 0;
+        if (callback(file_path, &match, user_data) != 0) return 1;
+    }
+    return 0;
+}
+
+yara_scratch_t* yara_scratch_create(const yara_rules_t* rules) {
+    if (!rules) {
+        return NULL;
+    }
+    yara_scratch_t* scratch = (yara_scratch_t*)calloc(1, sizeof(yara_scratch_t));
+    if (!scratch) {
+        return NULL;
+    }
+    scratch->ctx.rules = rules;
+    scratch->ctx.lists = (match_list_t*)calloc(rules->string_count + 1, sizeof(match_list_t));
+    scratch->ctx.chain_lists = (match_list_t*)calloc(rules->chain_slot_count + 1, sizeof(match_list_t));
+    scratch->ctx.rule_values = (int64_t*)calloc(rules->rule_count + 1, sizeof(int64_t));
+    scratch->ctx.touched = (uint32_t*)malloc((rules->string_count + 1) * sizeof(uint32_t));
+    if (!scratch->ctx.lists || !scratch->ctx.chain_lists || !scratch->ctx.rule_values || !scratch->ctx.touched) {
+        yara_scratch_free(scratch);
+        return NULL;
+    }
+    return scratch;
+}
+
+void yara_scratch_free(yara_scratch_t* scratch) {
+    if (scratch) {
+        if (scratch->ctx.lists) {
+            for (size_t k = 0; k < scratch->ctx.rules->string_count; k++) free(scratch->ctx.lists[k].items);
+        }
+        free(scratch->ctx.lists);
+        if (scratch->ctx.chain_lists) {
+            for (size_t k = 0; k < scratch->ctx.rules->chain_slot_count; k++) free(scratch->ctx.chain_lists[k].items);
+        }
+        free(scratch->ctx.chain_lists);
+        free(scratch->ctx.rule_values);
+        free(scratch->ctx.touched);
+        free(scratch);
+    }
+}
+
+int yara_scratch_scan_data(yara_scratch_t* scratch, const uint8_t* data, size_t size, const char* file_path,
+                           yara_match_callback_t callback, void* user_data) {
+    if (!scratch || (!data && size > 0) || !callback) {
+        return -1;
+    }
+
+    scan_context_t* ctx = &scratch->ctx;
+    const yara_rules_t* rules = ctx->rules;
+    ctx->data = data;
+    ctx->size = size;
+    int ret = collect_matches(ctx);
+
+    // Rules in declaration order, so references see earlier results; a
+    // failing global rule suppresses every rule
+    int globals_ok = 1;
+    for (size_t r = 0; ret == 0 && r < rules->rule_count; r++) {
+        ctx->rule_values[r] = truthy(eval(ctx, rules->rules[r].condition));
+        if (rules->rules[r].is_global && !ctx->rule_values[r]) globals_ok = 0;
+    }
+    for (size_t r = 0; ret == 0 && globals_ok && r < rules->rule_count; r++) {
+        const yara_rule_t* rule = &rules->rules[r];
+        if (ctx->rule_values[r] && !rule->is_private) {
+            ret = report_rule(ctx, rule, file_path, callback, user_data);
+        }
+    }
+
+    // Ready for the next scan
+    for (size_t k = 0; k < ctx->touched_count; k++) {
+        match_list_t* list = &ctx->lists[ctx->touched[k]];
+        list->count = 0;
+        list->unsorted = 0;
+    }
+    ctx->touched_count = 0;
+    for (size_t k = 0; k < rules->chain_slot_count; k++) {
+        ctx->chain_lists[k].count = 0;
+        ctx->chain_lists[k].unsorted = 0;
+    }
+    ctx->data = NULL;
+    ctx->size = 0;
+    return ret;
+}
+
+int yara_scratch_scan_file(yara_scratch_t* scratch, const char* path,
+                           yara_match_callback_t callback, void* user_data) {
+    if (!scratch || !path || !callback) {
+        return -1;
+    }
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    const size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        return yara_scratch_scan_data(scratch, NULL, 0, path, callback, user_data);
+    }
+
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+        close(fd);
+        posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+        const int ret = yara_scratch_scan_data(scratch, (const uint8_t*)map, size, path, callback, user_data);
+        munmap(map, size);
+        return ret;
+    }
+
+    // Not mappable (e.g. some special files): read it whole
+    uint8_t* buffer = (uint8_t*)malloc(size);
+    size_t done = 0;
+    while (buffer && done < size) {
+        const ssize_t n = read(fd, buffer + done, size - done);
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    close(fd);
+    const int ret = buffer ? yara_scratch_scan_data(scratch, buffer, done, path, callback, user_data) : -1;
+    free(buffer);
+    return ret;
+}
+
+// Collects matches into a yara_result_t for the one-shot entry points
+static int add_to_result(const char* file_path, const yara_match_t* match, void* user_data) {
+    (void)file_path;
+    return yara_result_add_match((yara_result_t*)user_data, match) != 0 ? -1 : 0;
+}
+
+// A stop from add_to_result means an allocation failed
+static int result_status(int ret) {
+    return ret == 0 ? 0 : -1;
+}
+
+int yara_rules_scan_data(const yara_rules_t* rules, const uint8_t* data, size_t size, yara_result_t* result) {
+    if (!rules || (!data && size > 0) || !result) {
+        return -1;
+    }
+    yara_scratch_t* scratch = yara_scratch_create(rules);
+    if (!scratch) {
+        return -1;
+    }
+    const int ret = yara_scratch_scan_data(scratch, data, size, NULL, add_to_result, result);
+    yara_scratch_free(scratch);
+    return result_status(ret);
+}
+
+int yara_rules_scan_file(const yara_rules_t* rules, const char* path, yara_result_t* result) {
+    if (!rules || !path || !result) {
+        return -1;
+    }
+    yara_scratch_t* scratch = yara_scratch_create(rules);
+    if (!scratch) {
+        return -1;
+    }
+    const int ret = yara_scratch_scan_file(scratch, path, add_to_result, result);
+    yara_scratch_free(scratch);
+    return result_status(ret);
+}
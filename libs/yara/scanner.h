@@ -1,15 +1,53 @@
 #ifndef LIBS_YARA_SCANNER_H
 #define LIBS_YARA_SCANNER_H
 
+#include "rules.h"
+#include "yara.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// This is a placeholder for YARA scanning functions
-// In a full implementation, this would contain functions for scanning with YARA
+// Cap on recorded occurrences of one string, as in YARA
+#define YARA_MAX_STRING_MATCHES 1000000
+
+// Per-thread scan state for one compiled rule set. The rules are only read
+// while scanning, so any number of threads may scan with the same rules,
+// each through its own scratch.
+typedef struct yara_scratch yara_scratch_t;
+
+// Create scratch for scanning with rules (which must outlive it)
+// Returns the scratch (free with yara_scratch_free), or NULL on error
+yara_scratch_t* yara_scratch_create(const yara_rules_t* rules);
+
+// Free scratch
+void yara_scratch_free(yara_scratch_t* scratch);
+
+// Scan a buffer. The automaton makes one pass over the data collecting
+// verified string matches; conditions are evaluated after. Each matching
+// non-private rule is reported once per string that was found
+// (matched_string = "$id", offset and length of its first occurrence), or
+// once with an empty matched_string if its condition needed none.
+// file_path: passed through to the callback (may be NULL)
+// callback: receives each match; returning non-zero stops the scan
+// Returns 0 on success, -1 on error, or 1 if the callback stopped the scan
+int yara_scratch_scan_data(yara_scratch_t* scratch, const uint8_t* data, size_t size, const char* file_path,
+                           yara_match_callback_t callback, void* user_data);
+
+// Scan a file (memory-mapped when possible); as yara_scratch_scan_data
+int yara_scratch_scan_file(yara_scratch_t* scratch, const char* path,
+                           yara_match_callback_t callback, void* user_data);
+
+// One-shot scan of a buffer, appending the matches to result
+// Returns 0 on success, non-zero on error
+int yara_rules_scan_data(const yara_rules_t* rules, const uint8_t* data, size_t size, yara_result_t* result);
+
+// One-shot scan of a file, appending the matches to result
+// Returns 0 on success, non-zero on error
+int yara_rules_scan_file(const yara_rules_t* rules, const char* path, yara_result_t* result);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif // LIBS_YARA_SCANNER_H
\ No newline at end of file
+#endif // LIBS_YARA_SCANNER_H
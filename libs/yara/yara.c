@@ -9,9 +9,14 @@
 #include <dirent.h>
 #include <errno.h>
 #include <ctype.h>
+#include <pthread.h>
 
-// Global flag to track if rules are loaded
-static int g_rules_loaded = 0;
+// Currently loaded rules; scans hold their own reference
+static yara_rules_t* g_rules = NULL;
+static pthread_mutex_t g_rules_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Files queued per directory scan thread
+#define YARA_QUEUE_PER_THREAD 64
 
 // Helper function to duplicate string
 static char* strdup_safe(const char* str) {
@@ -126,7 +131,7 @@ void yara_rule_info_init(yara_rule_info_t* info) {
 void yara_rule_info_free(yara_rule_info_t* info) {
     if (info) {
         free(info->name);
-        free(info->namespace);
+        free(info->rule_namespace);
         free(info->description);
         free(info->author);
         free(info->version);
@@ -139,17 +144,41 @@ int yara_load_rules(const char* rules_path) {
         return -1;
     }
     
-    // Check if file exists
-    if (access(rules_path, R_OK) != 0) {
+    FILE* file = fopen(rules_path, "rb");
+    if (!file) {
         return -1;
     }
     
-    // In a real implementation, this would load YARA rules using the YARA library
-    // For this example, we'll just set a flag
-    g_rules_loaded = 1;
+    // Read the whole rules file
+    size_t size = 0, capacity = 64 * 1024;
+    char* source = (char*)malloc(capacity);
+    while (source) {
+        size += fread(source + size, 1, capacity - size, file);
+        if (size < capacity) {
+            break;
+        }
+        capacity *= 2;
+        char* grown = (char*)realloc(source, capacity);
+        if (!grown) {
+            free(source);
+            source = NULL;
+            break;
+        }
+        source = grown;
+    }
+    int read_error = ferror(file);
+    fclose(file);
+    if (!source || read_error) {
+        free(source);
+        return -1;
+    }
     
-    printf("Loaded YARA rules from %s\n", rules_path);
-    return 0;
+    int ret = yara_load_rules_from_memory(source, size);
+    free(source);
+    if (ret == 0) {
+        printf("Loaded YARA rules from %s\n", rules_path);
+    }
+    return ret;
 }
 
 int yara_load_rules_from_memory(const void* data, size_t size) {
@@ -157,78 +186,45 @@ int yara_load_rules_from_memory(const void* data, size_t size) {
         return -1;
     }
     
-    // In a real implementation, this would load YARA rules from memory using the YARA library
-    // For this example, we'll just set a flag
-    g_rules_loaded = 1;
+    char error[256];
+    yara_rules_t* rules = yara_rules_compile((const char*)data, size, error, sizeof(error));
+    if (!rules) {
+        fprintf(stderr, "YARA rule error: %s\n", error);
+        return -1;
+    }
     
-    printf("Loaded YARA rules from memory (%lu bytes)\n", (unsigned long)size);
+    pthread_mutex_lock(&g_rules_mutex);
+    yara_rules_t* old = g_rules;
+    g_rules = rules;
+    pthread_mutex_unlock(&g_rules_mutex);
+    yara_rules_free(old);
     return 0;
 }
 
-// Simulate YARA scanning
-static int simulate_yara_scan(const char* file_path, yara_result_t* result) {
-    if (!file_path || !result) {
-        return -1;
+yara_rules_t* yara_get_rules(void) {
+    pthread_mutex_lock(&g_rules_mutex);
+    yara_rules_t* rules = yara_rules_retain(g_rules);
+    pthread_mutex_unlock(&g_rules_mutex);
+    return rules;
+}
+
+// Check exclude patterns against the file name
+static int is_excluded(const char* file_path, const yara_options_t* options) {
+    if (!options || !options->exclude_patterns || options->exclude_count == 0) {
+        return 0;
     }
-    
-    yara_result_init(result);
-    
-    // Simulate finding some matches based on file content
-    FILE* file = fopen(file_path, "rb");
-    if (!file) {
-        return -1;
+    const char* filename = strrchr(file_path, '/');
+    if (filename) {
+        filename++; // Skip the '/'
+    } else {
+        filename = file_path;
     }
     
-    // Read first 1024 bytes to check for suspicious patterns
-    char buffer[1024];
-    size_t bytes_read = fread(buffer, 1, sizeof(buffer), file);
-    fclose(file);
-    
-    if (bytes_read > 0) {
-        // Check for suspicious patterns
-        if (memmem(buffer, bytes_read, "virus", 5) != NULL) {
-            yara_match_t match;
-            match.rule_name = strdup("VirusSignature");
-            match.rule_namespace = strdup("malware");
-            match.matched_string = strdup("virus");
-            match.offset = 0;
-            match.length = 5;
-            match.severity = 9;
-            yara_result_add_match(result, &match);
-            free(match.rule_name);
-            free(match.rule_namespace);
-            free(match.matched_string);
-        }
-        
-        if (memmem(buffer, bytes_read, "malware", 7) != NULL) {
-            yara_match_t match;
-            match.rule_name = strdup("MalwareSignature");
-            match.rule_namespace = strdup("malware");
-            match.matched_string = strdup("malware");
-            match.offset = 0;
-            match.length = 7;
-            match.severity = 8;
-            yara_result_add_match(result, &match);
-            free(match.rule_name);
-            free(match.rule_namespace);
-            free(match.matched_string);
-        }
-        
-        if (memmem(buffer, bytes_read, "trojan", 6) != NULL) {
-            yara_match_t match;
-            match.rule_name = strdup("TrojanSignature");
-            match.rule_namespace = strdup("malware");
-            match.matched_string = strdup("trojan");
-            match.offset = 0;
-            match.length = 6;
-            match.severity = 7;
-            yara_result_add_match(result, &match);
-            free(match.rule_name);
-            free(match.rule_namespace);
-            free(match.matched_string);
+    for (size_t i = 0; i < options->exclude_count; i++) {
+        if (strstr(filename, options->exclude_patterns[i]) != NULL) {
+            return 1;
         }
     }
-    
     return 0;
 }
 
@@ -237,130 +233,316 @@ int yara_scan_file(const char* file_path, const yara_options_t* options, yara_re
         return -1;
     }
     
-    // Check if rules are loaded
-    if (!g_rules_loaded) {
-        return -1;
-    }
+    yara_result_init(result);
     
-    // Check if file exists
-    if (access(file_path, R_OK) != 0) {
+    // Check if rules are loaded
+    yara_rules_t* rules = yara_get_rules();
+    if (!rules) {
         return -1;
     }
     
-    // Check exclude patterns
-    if (options && options->exclude_patterns && options->exclude_count > 0) {
-        const char* filename = strrchr(file_path, '/');
-        if (filename) {
-            filename++; // Skip the '/'
-        } else {
-            filename = file_path;
-        }
-        
-        for (size_t i = 0; i < options->exclude_count; i++) {
-            if (strstr(filename, options->exclude_patterns[i]) != NULL) {
-                // File matches exclude pattern, skip scanning
-                yara_result_init(result);
-                return 0;
-            }
-        }
+    // File matches exclude pattern, skip scanning
+    int ret = 0;
+    if (!is_excluded(file_path, options)) {
+        ret = yara_rules_scan_file(rules, file_path, result);
     }
-    
-    // In a real implementation, this would scan the file using YARA
-    // For this example, we'll simulate the scanning
-    return simulate_yara_scan(file_path, result);
+    yara_rules_free(rules);
+    return ret;
 }
 
 int yara_scan_data(const void* data, size_t size, const yara_options_t* options, yara_result_t* result) {
+    (void)options;
     if (!data || !result) {
         return -1;
     }
     
-    // Check if rules are loaded
-    if (!g_rules_loaded) {
-        return -1;
-    }
-    
-    // Create a temporary file to simulate scanning data
-    char temp_path[] = "/tmp/yara_scan_XXXXXX";
-    int fd = mkstemp(temp_path);
-    if (fd < 0) {
-        return -1;
-    }
-    
-    // Write data to temporary file
-    ssize_t written = write(fd, data, size);
-    close(fd);
+    yara_result_init(result);
     
-    if (written != (ssize_t)size) {
-        unlink(temp_path);
+    // Check if rules are loaded
+    yara_rules_t* rules = yara_get_rules();
+    if (!rules) {
         return -1;
     }
-    
-    // Scan the temporary file
-    int ret = yara_scan_file(temp_path, options, result);
-    
-    // Clean up temporary file
-    unlink(temp_path);
-    
+    int ret = yara_rules_scan_data(rules, (const uint8_t*)data, size, result);
+    yara_rules_free(rules);
     return ret;
 }
 
-int yara_scan_directory(const char* directory_path, const yara_options_t* options, yara_result_t* result) {
-    if (!directory_path || !result) {
-        return -1;
+// Bounded queue of file paths between the directory walker and the workers
+typedef struct {
+    const yara_rules_t* rules;
+    yara_match_callback_t callback;
+    void* user_data;
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    char** paths;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    int closed;                 // Walk finished: workers drain and exit
+    int stop;                   // Callback asked to stop, or a worker failed
+    int failed;
+    
+    pthread_mutex_t callback_mutex;
+    int callback_stopped;       // Under callback_mutex: no further callbacks
+} scan_pool_t;
+
+typedef struct {
+    scan_pool_t* pool;
+    int holds_callback;         // Current file holds callback_mutex
+} scan_worker_t;
+
+// Keeps each file's matches together: the first match of a file takes the
+// callback lock and the worker drops it when the file is done
+static int worker_callback(const char* file_path, const yara_match_t* match, void* user_data) {
+    scan_worker_t* worker = (scan_worker_t*)user_data;
+    if (!worker->holds_callback) {
+        pthread_mutex_lock(&worker->pool->callback_mutex);
+        worker->holds_callback = 1;
+    }
+    if (worker->pool->callback_stopped ||
+        worker->pool->callback(file_path, match, worker->pool->user_data) != 0) {
+        worker->pool->callback_stopped = 1;
+        return 1;
     }
-    
-    yara_result_init(result);
-    
-    // Check if rules are loaded
-    if (!g_rules_loaded) {
-        return -1;
+    return 0;
+}
+
+static void* scan_worker(void* arg) {
+    scan_pool_t* pool = (scan_pool_t*)arg;
+    scan_worker_t worker = {pool, 0};
+    yara_scratch_t* scratch = yara_scratch_create(pool->rules);
+    
+    pthread_mutex_lock(&pool->mutex);
+    if (!scratch) {
+        pool->failed = 1;
+        pool->stop = 1;
+        pthread_cond_broadcast(&pool->not_full);
+    }
+    for (;;) {
+        while (!pool->stop && !pool->closed && pool->count == 0) {
+            pthread_cond_wait(&pool->not_empty, &pool->mutex);
+        }
+        if (pool->stop || pool->count == 0) {
+            break;
+        }
+        char* path = pool->paths[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->mutex);
+        
+        // Unreadable files are skipped, as in a serial walk
+        int ret = yara_scratch_scan_file(scratch, path, worker_callback, &worker);
+        if (worker.holds_callback) {
+            pthread_mutex_unlock(&pool->callback_mutex);
+            worker.holds_callback = 0;
+        }
+        free(path);
+        
+        pthread_mutex_lock(&pool->mutex);
+        if (ret == 1) {
+            pool->stop = 1;
+            pthread_cond_broadcast(&pool->not_empty);
+            pthread_cond_broadcast(&pool->not_full);
+        }
     }
+    pthread_mutex_unlock(&pool->mutex);
     
-    // Open directory
+    yara_scratch_free(scratch);
+    return NULL;
+}
+
+// Hand a path to the workers; takes ownership. Returns non-zero once the
+// scan is stopping.
+static int queue_path(scan_pool_t* pool, char* path) {
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->stop && pool->count == pool->capacity) {
+        pthread_cond_wait(&pool->not_full, &pool->mutex);
+    }
+    int stop = pool->stop;
+    if (!stop) {
+        pool->paths[(pool->head + pool->count) % pool->capacity] = path;
+        pool->count++;
+        pthread_cond_signal(&pool->not_empty);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    if (stop) {
+        free(path);
+    }
+    return stop;
+}
+
+// Queue the regular files of a directory, and of its subdirectories when
+// recursive. Symbolic links to directories are never followed, so the walk
+// cannot loop. Returns non-zero once the scan is stopping.
+static int walk_directory(scan_pool_t* pool, const char* directory_path, const yara_options_t* options) {
     DIR* dir = opendir(directory_path);
     if (!dir) {
-        return -1;
+        return 0;
     }
     
-    // Process directory entries
+    const int follow_symlinks = options ? options->follow_symlinks : 1;
+    const int recursive = options ? options->recursive : 0;
+    const size_t path_len = strlen(directory_path);
+    int stop = 0;
     struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
+    while (!stop && (entry = readdir(dir)) != NULL) {
         // Skip current and parent directory
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
             continue;
         }
         
         // Build full path
-        size_t path_len = strlen(directory_path);
         size_t name_len = strlen(entry->d_name);
         char* full_path = (char*)malloc(path_len + name_len + 2);
         if (!full_path) {
             continue;
         }
+        memcpy(full_path, directory_path, path_len);
+        full_path[path_len] = '/';
+        memcpy(full_path + path_len + 1, entry->d_name, name_len + 1);
         
-        sprintf(full_path, "%s/%s", directory_path, entry->d_name);
-        
-        // Check if it's a regular file
+        // d_type saves a stat per entry on most file systems
+        int is_file = 0, is_dir = 0;
         struct stat st;
-        if (stat(full_path, &st) == 0 && S_ISREG(st.st_mode)) {
-            // Scan the file
-            yara_result_t file_result;
-            if (yara_scan_file(full_path, options, &file_result) == 0) {
-                // Add matches to overall result
-                for (size_t i = 0; i < file_result.count; i++) {
-                    yara_result_add_match(result, &file_result.matches[i]);
+        switch (entry->d_type) {
+            case DT_REG:
+                is_file = 1;
+                break;
+            case DT_DIR:
+                is_dir = 1;
+                break;
+            case DT_LNK:
+                is_file = follow_symlinks && stat(full_path, &st) == 0 && S_ISREG(st.st_mode);
+                break;
+            case DT_UNKNOWN:
+                if (lstat(full_path, &st) == 0) {
+                    is_dir = S_ISDIR(st.st_mode);
+                    is_file = S_ISREG(st.st_mode) ||
+                              (follow_symlinks && S_ISLNK(st.st_mode) &&
+                               stat(full_path, &st) == 0 && S_ISREG(st.st_mode));
                 }
-                yara_result_free(&file_result);
-            }
+                break;
+            default:
+                break;
         }
         
+        if (is_file && !is_excluded(full_path, options)) {
+            stop = queue_path(pool, full_path);
+            continue;
+        }
+        if (is_dir && recursive) {
+            stop = walk_directory(pool, full_path, options);
+        }
         free(full_path);
     }
     
     closedir(dir);
+    return stop;
+}
+
+int yara_scan_directory_stream(const yara_rules_t* rules, const char* directory_path, const yara_options_t* options,
+                               yara_match_callback_t callback, void* user_data) {
+    if (!directory_path || !callback) {
+        return -1;
+    }
     
-    return 0;
+    yara_rules_t* loaded = NULL;
+    if (!rules) {
+        loaded = yara_get_rules();
+        if (!loaded) {
+            return -1;
+        }
+        rules = loaded;
+    }
+    
+    // Open directory
+    DIR* dir = opendir(directory_path);
+    if (!dir) {
+        yara_rules_free(loaded);
+        return -1;
+    }
+    closedir(dir);
+    
+    size_t num_threads = options ? options->thread_count : 0;
+    if (num_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    
+    scan_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.rules = rules;
+    pool.callback = callback;
+    pool.user_data = user_data;
+    pool.capacity = num_threads * YARA_QUEUE_PER_THREAD;
+    pool.paths = (char**)malloc(pool.capacity * sizeof(char*));
+    pthread_t* threads = (pthread_t*)calloc(num_threads, sizeof(pthread_t));
+    if (!pool.paths || !threads) {
+        free(pool.paths);
+        free(threads);
+        yara_rules_free(loaded);
+        return -1;
+    }
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.not_empty, NULL);
+    pthread_cond_init(&pool.not_full, NULL);
+    pthread_mutex_init(&pool.callback_mutex, NULL);
+    
+    size_t started = 0;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&threads[started], NULL, scan_worker, &pool) != 0) {
+            break;
+        }
+    }
+    
+    if (started > 0) {
+        walk_directory(&pool, directory_path, options);
+    }
+    
+    pthread_mutex_lock(&pool.mutex);
+    pool.closed = 1;
+    pthread_cond_broadcast(&pool.not_empty);
+    pthread_mutex_unlock(&pool.mutex);
+    for (size_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    
+    // Paths left behind by a stopped scan
+    for (size_t i = 0; i < pool.count; i++) {
+        free(pool.paths[(pool.head + i) % pool.capacity]);
+    }
+    int ret = (started == 0 || pool.failed) ? -1 : pool.stop ? 1 : 0;
+    
+    pthread_mutex_destroy(&pool.callback_mutex);
+    pthread_cond_destroy(&pool.not_full);
+    pthread_cond_destroy(&pool.not_empty);
+    pthread_mutex_destroy(&pool.mutex);
+    free(pool.paths);
+    free(threads);
+    yara_rules_free(loaded);
+    return ret;
+}
+
+// Collects a directory scan into a yara_result_t
+static int add_to_result(const char* file_path, const yara_match_t* match, void* user_data) {
+    (void)file_path;
+    return yara_result_add_match((yara_result_t*)user_data, match) != 0 ? -1 : 0;
+}
+
+int yara_scan_directory(const char* directory_path, const yara_options_t* options, yara_result_t* result) {
+    if (!directory_path || !result) {
+        return -1;
+    }
+    
+    yara_result_init(result);
+    
+    // A stop can only come from a failed allocation in add_to_result
+    int ret = yara_scan_directory_stream(NULL, directory_path, options, add_to_result, result);
+    return ret == 0 ? 0 : -1;
 }
 
 int yara_get_rule_info(yara_rule_info_t** rules, size_t* count) {
@@ -369,44 +551,31 @@ int yara_get_rule_info(yara_rule_info_t** rules, size_t* count) {
     }
     
     // Check if rules are loaded
-    if (!g_rules_loaded) {
+    yara_rules_t* loaded = yara_get_rules();
+    if (!loaded) {
         return -1;
     }
     
-    // For this example, we'll return some sample rule information
-    *count = 3;
-    *rules = (yara_rule_info_t*)malloc(*count * sizeof(yara_rule_info_t));
+    *count = loaded->rule_count;
+    *rules = (yara_rule_info_t*)calloc(*count ? *count : 1, sizeof(yara_rule_info_t));
     if (!*rules) {
+        yara_rules_free(loaded);
         return -1;
     }
     
-    // Rule 1
-    yara_rule_info_init(&(*rules)[0]);
-    (*rules)[0].name = strdup("VirusSignature");
-    (*rules)[0].namespace = strdup("malware");
-    (*rules)[0].description = strdup("Detects common virus signatures");
-    (*rules)[0].author = strdup("Security Team");
-    (*rules)[0].version = strdup("1.0");
-    (*rules)[0].severity = 9;
-    
-    // Rule 2
-    yara_rule_info_init(&(*rules)[1]);
-    (*rules)[1].name = strdup("MalwareSignature");
-    (*rules)[1].namespace = strdup("malware");
-    (*rules)[1].description = strdup("Detects common malware signatures");
-    (*rules)[1].author = strdup("Security Team");
-    (*rules)[1].version = strdup("1.0");
-    (*rules)[1].severity = 8;
-    
-    // Rule 3
-    yara_rule_info_init(&(*rules)[2]);
-    (*rules)[2].name = strdup("TrojanSignature");
-    (*rules)[2].namespace = strdup("malware");
-    (*rules)[2].description = strdup("Detects common trojan signatures");
-    (*rules)[2].author = strdup("Security Team");
-    (*rules)[2].version = strdup("1.0");
-    (*rules)[2].severity = 7;
+    for (size_t i = 0; i < *count; i++) {
+        const yara_rule_t* rule = &loaded->rules[i];
+        yara_rule_info_t* info = &(*rules)[i];
+        yara_rule_info_init(info);
+        info->name = strdup_safe(rule->name);
+        info->rule_namespace = strdup_safe(rule->rule_namespace);
+        info->description = strdup_safe(rule->description);
+        info->author = strdup_safe(rule->author);
+        info->version = strdup_safe(rule->version);
+        info->severity = rule->severity;
+    }
     
+    yara_rules_free(loaded);
     return 0;
 }
 
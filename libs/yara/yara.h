@@ -28,7 +28,7 @@ typedef struct {
 // YARA rule information
 typedef struct {
     char* name;
-    char* namespace;
+    char* rule_namespace;
     char* description;
     char* author;
     char* version;
@@ -43,8 +43,20 @@ typedef struct {
     int scan_archives;        // Scan archive files
     char** exclude_patterns;  // File patterns to exclude
     size_t exclude_count;     // Number of exclude patterns
+    size_t thread_count;      // Directory scan threads (0 = hardware threads)
+    int recursive;            // Descend into subdirectories
 } yara_options_t;
 
+// Compiled rule set (see rules.h). Immutable once compiled and reference
+// counted, so scans on many threads can share one while new rules load.
+typedef struct yara_rules yara_rules_t;
+
+// Receives each match as it is found. The match strings belong to the
+// scanner and are valid only during the call.
+// file_path: file the match is in (NULL when scanning memory)
+// Returns 0 to continue, non-zero to stop the scan
+typedef int (*yara_match_callback_t)(const char* file_path, const yara_match_t* match, void* user_data);
+
 // Initialize YARA result
 void yara_result_init(yara_result_t* result);
 
@@ -66,9 +78,10 @@ void yara_rule_info_init(yara_rule_info_t* info);
 // Free YARA rule info
 void yara_rule_info_free(yara_rule_info_t* info);
 
-// Load YARA rules from file
+// Load YARA rules from file, replacing the loaded rules. The supported
+// language subset is described in rules.h.
 // rules_path: path to the YARA rules file
-// Returns 0 on success, non-zero on error
+// Returns 0 on success, non-zero on error (read or compile failure)
 int yara_load_rules(const char* rules_path);
 
 // Load YARA rules from memory
@@ -77,6 +90,11 @@ int yara_load_rules(const char* rules_path);
 // Returns 0 on success, non-zero on error
 int yara_load_rules_from_memory(const void* data, size_t size);
 
+// Get a reference to the loaded rules. It stays valid when
+// yara_load_rules replaces them; release it with yara_rules_free.
+// Returns the rules, or NULL if none are loaded
+yara_rules_t* yara_get_rules(void);
+
 // Scan file for malware using YARA rules
 // file_path: path to the file to scan
 // options: scanner options
@@ -84,7 +102,7 @@ int yara_load_rules_from_memory(const void* data, size_t size);
 // Returns 0 on success, non-zero on error
 int yara_scan_file(const char* file_path, const yara_options_t* options, yara_result_t* result);
 
-// Scan data in memory for malware using YARA rules
+// Scan data in memory for malware using YARA rules (scanned in place)
 // data: pointer to data to scan
 // size: size of data in bytes
 // options: scanner options
@@ -92,13 +110,24 @@ int yara_scan_file(const char* file_path, const yara_options_t* options, yara_re
 // Returns 0 on success, non-zero on error
 int yara_scan_data(const void* data, size_t size, const yara_options_t* options, yara_result_t* result);
 
-// Scan directory for malware using YARA rules
+// Scan directory for malware using YARA rules (yara_scan_directory_stream
+// collecting into result; matches are grouped by file in no fixed order)
 // directory_path: path to the directory to scan
 // options: scanner options
 // result: output scan result (must be freed with yara_result_free)
 // Returns 0 on success, non-zero on error
 int yara_scan_directory(const char* directory_path, const yara_options_t* options, yara_result_t* result);
 
+// Scan directory on a pool of threads, streaming matches to a callback.
+// The calling thread walks the directory and queues regular files; each
+// worker scans them with its own scratch state. Callbacks are serialized
+// but arrive from the workers, in no particular file order.
+// rules: compiled rules (NULL = the loaded rules)
+// options: scanner options (may be NULL); thread_count and recursive apply
+// Returns 0 on success, -1 on error, or 1 if the callback stopped the scan
+int yara_scan_directory_stream(const yara_rules_t* rules, const char* directory_path, const yara_options_t* options,
+                               yara_match_callback_t callback, void* user_data);
+
 // Get information about loaded YARA rules
 // rules: array of rule information (must be freed with yara_rule_info_free for each element)
 // count: output number of rules
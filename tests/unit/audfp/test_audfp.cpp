@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "libs/audfp/audfp.h"
+#include "libs/audfp/audfp_decode.h"
+
+// Deterministic "music": a new decaying three-note chord every 250 ms plus noise
+static std::vector<int16_t> synthesize(uint32_t seed, double seconds, uint32_t rate, double start = 0.0,
+                                       double noise = 0.01) {
+    std::mt19937 rng(seed);
+    std::vector<std::vector<double>> chords;
+    for (int i = 0; i < static_cast<int>(std::ceil((seconds + start) * 4)) + 1; ++i) {
+        std::vector<double> chord;
+        for (int k = 0; k < 3; ++k) chord.push_back(220.0 * std::pow(2.0, (rng() % 36) / 12.0));
+        chords.push_back(chord);
+    }
+    std::mt19937 noise_rng(seed * 7919 + rate + static_cast<uint32_t>(start * 1000)); // Independent noise per rendering
+    std::normal_distribution<double> gauss(0.0, noise);
+    const size_t count = static_cast<size_t>(seconds * rate);
+    std::vector<int16_t> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+        const double t = start + static_cast<double>(i) / rate;
+        const size_t index = static_cast<size_t>(t * 4);
+        const double envelope = std::exp(-8.0 * (t - index / 4.0)); // Plucked notes decay
+        double v = gauss(noise_rng);
+        for (double f : chords[index]) v += 0.25 * envelope * std::sin(2.0 * M_PI * f * t);
+        samples[i] = static_cast<int16_t>(std::clamp(v, -1.0, 1.0) * 32767.0);
+    }
+    return samples;
+}
+
+static void put_le(std::string& out, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+// 16-bit PCM WAV; stereo duplicates the mono signal with a small gain change
+static void write_wav(const std::string& path, const std::vector<int16_t>& mono, uint32_t rate, int channels) {
+    std::string data;
+    for (int16_t s : mono) {
+        put_le(data, static_cast<uint16_t>(s), 2);
+        if (channels == 2) put_le(data, static_cast<uint16_t>(static_cast<int16_t>(s / 2)), 2);
+    }
+    std::string wav = "RIFF";
+    put_le(wav, static_cast<uint32_t>(36 + data.size()), 4);
+    wav += "WAVEfmt ";
+    put_le(wav, 16, 4);
+    put_le(wav, 1, 2);
+    put_le(wav, static_cast<uint32_t>(channels), 2);
+    put_le(wav, rate, 4);
+    put_le(wav, rate * 2 * channels, 4);
+    put_le(wav, static_cast<uint32_t>(2 * channels), 2);
+    put_le(wav, 16, 2);
+    wav += "LIST";              // Unrelated chunk the parser must skip
+    put_le(wav, 3, 4);
+    wav += "abc";
+    wav.push_back('\0');        // Pad byte for the odd-sized chunk
+    wav += "data";
+    put_le(wav, static_cast<uint32_t>(data.size()), 4);
+    wav += data;
+    FILE* f = std::fopen(path.c_str(), "wb");
+    assert(f);
+    std::fwrite(wav.data(), 1, wav.size(), f);
+    std::fclose(f);
+}
+
+// Minimal FLAC writer covering the decoder's fixed, LPC and stereo paths
+class BitWriter {
+public:
+    void put(uint64_t value, int bits) {
+        for (int i = bits - 1; i >= 0; --i) {
+            m_acc = static_cast<uint8_t>((m_acc << 1) | ((value >> i) & 1));
+            if (++m_bits == 8) flush_byte();
+        }
+    }
+    void put_signed(int64_t value, int bits) { put(static_cast<uint64_t>(value) & ((1ULL << bits) - 1), bits); }
+    void put_rice(int64_t value, int k) {
+        uint64_t u = value >= 0 ? static_cast<uint64_t>(value) << 1 : (static_cast<uint64_t>(-value) << 1) - 1;
+        for (uint64_t q = u >> k; q > 0; --q) put(0, 1);
+        put(1, 1);
+        put(u & ((1ULL << k) - 1), k);
+    }
+    void align() { while (m_bits) put(0, 1); }
+    std::string& bytes() { return m_out; }
+
+private:
+    void flush_byte() { m_out.push_back(static_cast<char>(m_acc)); m_acc = 0; m_bits = 0; }
+    std::string m_out;
+    uint8_t m_acc = 0;
+    int m_bits = 0;
+};
+
+static void write_subframe(BitWriter& bw, const std::vector<int64_t>& x, int bps, bool lpc) {
+    const size_t order = 2;
+    bw.put(0, 1);
+    bw.put(lpc ? 33 : 10, 6);   // LPC order 2 / FIXED order 2
+    bw.put(0, 1);
+    for (size_t i = 0; i < order; ++i) bw.put_signed(x[i], bps);
+    if (lpc) {
+        bw.put(2, 4);           // Precision 3 bits
+        bw.put_signed(0, 5);    // Shift
+        bw.put_signed(2, 3);
+        bw.put_signed(-1, 3);
+    }
+    std::vector<int64_t> residual;
+    double mean = 0.0;
+    for (size_t i = order; i < x.size(); ++i) {
+        residual.push_back(x[i] - (2 * x[i - 1] - x[i - 2]));
+        mean += std::fabs(static_cast<double>(residual.back()));
+    }
+    mean /= std::max<size_t>(1, residual.size());
+    int k = 0;
+    while (k < 14 && (1 << (k + 1)) < mean) ++k;
+    bw.put(0, 2);               // Rice, 4-bit parameters
+    bw.put(0, 4);               // Partition order 0
+    bw.put(static_cast<uint64_t>(k), 4);
+    for (int64_t r : residual) bw.put_rice(r, k);
+}
+
+static uint8_t crc8(const std::string& bytes, size_t from) {
+    uint8_t crc = 0;
+    for (size_t i = from; i < bytes.size(); ++i) {
+        crc ^= static_cast<uint8_t>(bytes[i]);
+        for (int b = 0; b < 8; ++b) crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1));
+    }
+    return crc;
+}
+
+static void write_flac(const std::string& path, const std::vector<int16_t>& mono, uint32_t rate) {
+    const size_t block = 4096;
+    BitWriter bw;
+    bw.put(0x664C6143, 32);     // "fLaC"
+    bw.put(0x80, 8);            // Last metadata block, STREAMINFO
+    bw.put(34, 24);
+    bw.put(block, 16);
+    bw.put(block, 16);
+    bw.put(0, 24);
+    bw.put(0, 24);
+    bw.put(rate, 20);
+    bw.put(1, 3);               // 2 channels
+    bw.put(15, 5);              // 16 bits
+    bw.put(mono.size(), 36);
+    for (int i = 0; i < 16; ++i) bw.put(0, 8);
+
+    const int assignments[3] = {1, 10, 8}; // Independent, mid/side, left/side
+    for (size_t start = 0, frame = 0; start < mono.size(); start += block, ++frame) {
+        const size_t n = std::min(block, mono.size() - start);
+        std::vector<int64_t> left(n), right(n);
+        for (size_t i = 0; i < n; ++i) {
+            left[i] = mono[start + i];
+            right[i] = static_cast<int16_t>(mono[start + i] / 2);
+        }
+        const int assignment = assignments[frame % 3];
+
+        const size_t header_start = bw.bytes().size();
+        bw.put(0xFFF8, 16);
+        bw.put(n == block ? 12 : 7, 4);
+        bw.put(9, 4);           // 44.1 kHz
+        bw.put(static_cast<uint64_t>(assignment), 4);
+        bw.put(4, 3);           // 16 bits
+        bw.put(0, 1);
+        bw.put(frame, 8);       // Frame number (< 128)
+        if (n != block) bw.put(n - 1, 16);
+        bw.put(crc8(bw.bytes(), header_start), 8);
+
+        std::vector<int64_t> a = left, b = right;
+        int bps_a = 16, bps_b = 16;
+        if (assignment == 10) {
+            for (size_t i = 0; i < n; ++i) {
+                a[i] = (left[i] + right[i]) >> 1;
+                b[i] = left[i] - right[i];
+            }
+            bps_b = 17;
+        } else if (assignment == 8) {
+            for (size_t i = 0; i < n; ++i) b[i] = left[i] - right[i];
+            bps_b = 17;
+        }
+        write_subframe(bw, a, bps_a, frame % 2 == 0);
+        write_subframe(bw, b, bps_b, frame % 2 == 1);
+        bw.align();
+        bw.put(0, 16);          // CRC-16 (not verified by the decoder)
+    }
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    assert(f);
+    std::fwrite(bw.bytes().data(), 1, bw.bytes().size(), f);
+    std::fclose(f);
+}
+
+static std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static void test_flac_decodes_like_wav() {
+    auto samples = synthesize(1, 3.0, 44100);
+    auto wav = temp_path("ds_test_audfp.wav");
+    auto flac = temp_path("ds_test_audfp.flac");
+    write_wav(wav, samples, 44100, 2);
+    write_flac(flac, samples, 44100);
+
+    auto a = AudioDecoder::open(wav);
+    auto b = AudioDecoder::open(flac);
+    assert(a && b);
+    assert(a->format().channels == 2 && b->format().channels == 2);
+    assert(a->format().total_frames == samples.size() && b->format().total_frames == samples.size());
+    assert(a->format().duration_ms() == 3000);
+
+    std::vector<float> ba(1000), bb(1000);
+    size_t total = 0;
+    for (;;) {
+        size_t na = a->read_mono(ba.data(), ba.size());
+        size_t nb = b->read_mono(bb.data(), bb.size());
+        assert(na == nb);
+        if (na == 0) break;
+        for (size_t i = 0; i < na; ++i) assert(std::fabs(ba[i] - bb[i]) < 1e-6f);
+        total += na;
+    }
+    assert(total == samples.size());
+    assert(!a->failed() && !b->failed());
+
+    std::error_code ec;
+    std::filesystem::remove(wav, ec);
+    std::filesystem::remove(flac, ec);
+}
+
+static void test_fingerprint_matching() {
+    AudioFingerprinter fingerprinter;
+    const double offset = 5.0;
+
+    auto original_path = temp_path("ds_test_audfp_a.wav");
+    auto excerpt_path = temp_path("ds_test_audfp_b.wav");
+    auto other_path = temp_path("ds_test_audfp_c.flac");
+    write_wav(original_path, synthesize(7, 20.0, 44100), 44100, 2);
+    // Same music from 5 s on, different rate and channel count, more noise
+    write_wav(excerpt_path, synthesize(7, 8.0, 22050, offset, 0.05), 22050, 1);
+    write_flac(other_path, synthesize(99, 20.0, 44100), 44100);
+
+    std::vector<std::string> paths = {original_path, excerpt_path, other_path};
+    std::vector<AudioFingerprinter::Fingerprint> fps(paths.size());
+    bool ok[3] = {false, false, false};
+    size_t fingerprinted = fingerprinter.fingerprint_files(paths.data(), paths.size(), fps.data(), ok, 3);
+    assert(fingerprinted == 3);
+    assert(ok[0] && ok[1] && ok[2]);
+    assert(fps[0].duration_ms == 20000 && fps[1].source_rate == 22050);
+    std::printf("landmarks: %zu / %zu / %zu\n", fps[0].landmarks.size(), fps[1].landmarks.size(),
+                fps[2].landmarks.size());
+
+    AudioFingerprintIndex index;
+    index.add(paths[0], fps[0]);
+    index.add(paths[2], fps[2]);
+
+    auto matches = index.query(fps[1], 10);
+    assert(!matches.empty());
+    assert(matches[0].track == 0 && matches[0].score >= 50);
+    const double frames_per_second = 11025.0 / 256.0;
+    std::printf("excerpt: score %u, offset %d (expected %.0f)\n", matches[0].score, matches[0].offset,
+                -offset * frames_per_second);
+    assert(std::fabs(matches[0].offset + offset * frames_per_second) <= 2.0);
+    for (const auto& m : matches) assert(m.track != 1 || m.score < matches[0].score / 4);
+
+    index.add(paths[1], fps[1]);
+    auto pairs = index.find_similar_pairs(10, 0.0, 2);
+    assert(pairs.size() == 1 && pairs[0].a == 0 && pairs[0].b == 2);
+    assert(index.find_similar_pairs(10, 0.0, 1).size() == 1);
+
+    // Serialization and persistence round trips
+    auto bytes = AudioFingerprinter::serialize(fps[1]);
+    AudioFingerprinter::Fingerprint decoded;
+    bool decoded_ok = AudioFingerprinter::deserialize(bytes.data(), bytes.size(), decoded);
+    assert(decoded_ok);
+    assert(decoded.landmarks.size() == fps[1].landmarks.size());
+    assert(decoded.duration_ms == fps[1].duration_ms);
+    for (size_t i = 0; i < decoded.landmarks.size(); ++i) {
+        assert(decoded.landmarks[i].hash == fps[1].landmarks[i].hash);
+        assert(decoded.landmarks[i].time == fps[1].landmarks[i].time);
+    }
+
+    auto index_path = temp_path("ds_test_audfp.afi");
+    bool saved = index.save(index_path);
+    assert(saved);
+    AudioFingerprintIndex loaded;
+    bool loaded_ok = loaded.load(index_path);
+    assert(loaded_ok);
+    assert(loaded.size() == 3 && loaded.get_key(2) == paths[1]);
+    assert(loaded.find_similar_pairs(10).size() == 1);
+
+    std::error_code ec;
+    for (const auto& p : paths) std::filesystem::remove(p, ec);
+    std::filesystem::remove(index_path, ec);
+}
+
+int main() {
+    test_flac_decodes_like_wav();
+    test_fingerprint_matching();
+    std::printf("Audio fingerprint tests passed!\n");
+    return 0;
+}
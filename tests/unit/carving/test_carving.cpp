@@ -1,10 +1,13 @@
 #include "libs/carving/carving.h"
+#include "libs/carving/matcher.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <random>
+#include <vector>
 
 // Create test data with embedded files
 static uint8_t* create_test_data(size_t* size) {
@@ -186,6 +189,229 @@ int test_signatures() {
     return 0;
 }
 
+// Reference: every header and footer occurrence by direct comparison
+static std::vector<carving_hit_t> brute_force_hits(const uint8_t* data, size_t size,
+                                                   const file_signature_t* sigs, size_t count) {
+    std::vector<carving_hit_t> hits;
+    for (size_t i = 0; i < size; i++) {
+        for (size_t s = 0; s < count; s++) {
+            const uint8_t* pats[2] = {sigs[s].header_signature, sigs[s].footer_signature};
+            size_t lens[2] = {sigs[s].header_signature_length, sigs[s].footer_signature_length};
+            for (uint32_t f = 0; f < 2; f++) {
+                if (pats[f] && lens[f] > 0 && i + lens[f] <= size && memcmp(data + i, pats[f], lens[f]) == 0) {
+                    hits.push_back({i, (uint32_t)s, f});
+                }
+            }
+        }
+    }
+    return hits;
+}
+
+static bool same_hits(const carving_hits_t& got, const std::vector<carving_hit_t>& expected) {
+    if (got.count != expected.size()) return false;
+    for (size_t i = 0; i < got.count; i++) {
+        if (got.hits[i].offset != expected[i].offset || got.hits[i].signature != expected[i].signature ||
+            got.hits[i].is_footer != expected[i].is_footer) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int test_matcher() {
+    printf("Testing multi-pattern matcher...\n");
+    
+    size_t count;
+    const file_signature_t* signatures = carving_get_signatures(&count);
+    carving_matcher_t* matcher = carving_matcher_create(signatures, count);
+    if (!matcher || carving_matcher_max_pattern_length(matcher) != 8) {
+        printf("Failed to compile matcher\n");
+        return 1;
+    }
+    
+    // Random bytes biased towards signature bytes, with every pattern planted
+    // (including overlapping and back-to-back copies)
+    std::mt19937 rng(7);
+    const uint8_t alphabet[] = {0xFF, 0xD8, 0xD9, 0x25, 0x50, 0x4B, 0x03, 0x04, 0x05, 0x06, 0x00, 0x41};
+    std::vector<uint8_t> data(200000);
+    for (auto& b : data) b = (rng() % 4 == 0) ? (uint8_t)rng() : alphabet[rng() % sizeof(alphabet)];
+    for (size_t s = 0; s < count; s++) {
+        for (int copy = 0; copy < 3; copy++) {
+            size_t at = rng() % (data.size() - 16);
+            memcpy(data.data() + at, signatures[s].header_signature, signatures[s].header_signature_length);
+            if (signatures[s].footer_signature) {
+                memcpy(data.data() + at + 3, signatures[s].footer_signature, signatures[s].footer_signature_length);
+            }
+        }
+    }
+    std::vector<carving_hit_t> expected = brute_force_hits(data.data(), data.size(), signatures, count);
+    
+    carving_hits_t hits;
+    carving_hits_init(&hits);
+    carving_scan_state_t state;
+    carving_scan_state_init(&state, 0);
+    if (carving_matcher_scan(matcher, &state, data.data(), data.size(), &hits) != 0) {
+        printf("Scan failed\n");
+        return 1;
+    }
+    carving_hits_sort(&hits);
+    if (!same_hits(hits, expected) || state.position != data.size()) {
+        printf("One-pass hits differ from brute force (%lu vs %lu)\n",
+               (unsigned long)hits.count, (unsigned long)expected.size());
+        return 1;
+    }
+    
+    // Arbitrary buffer splits find patterns that straddle a boundary
+    for (size_t chunk : {1, 7, 16, 4093}) {
+        carving_hits_free(&hits);
+        carving_scan_state_init(&state, 0);
+        for (size_t off = 0; off < data.size(); off += chunk) {
+            size_t len = (off + chunk <= data.size()) ? chunk : data.size() - off;
+            carving_matcher_scan(matcher, &state, data.data() + off, len, &hits);
+        }
+        carving_hits_sort(&hits);
+        if (!same_hits(hits, expected)) {
+            printf("Chunked scan (%lu bytes) differs from one pass\n", (unsigned long)chunk);
+            return 1;
+        }
+    }
+    carving_hits_free(&hits);
+    carving_matcher_free(matcher);
+    
+    // The embedded files of the fixture are all carved
+    size_t data_size;
+    uint8_t* test_data = create_test_data(&data_size);
+    carving_result_t result;
+    if (carving_carve_data(test_data, data_size, &result) != 0 || result.count != 3 ||
+        result.files[0].offset != 1000 || result.files[0].size != 5005 ||
+        result.files[1].offset != 10000 || result.files[1].size != 8016 ||
+        result.files[2].offset != 20000 || result.files[2].size != 12009 ||
+        memcmp(result.files[1].data, test_data + 10000, 8016) != 0) {
+        printf("Carved files do not match the embedded ones\n");
+        return 1;
+    }
+    carving_result_free(&result);
+    free(test_data);
+    
+    printf("Multi-pattern matcher test passed!\n");
+    return 0;
+}
+
+// Lowercase noise (no signature starts with one) with planted files whose
+// footers fall inside their size limits, then a header without a footer
+static std::vector<uint8_t> make_image(uint32_t seed, size_t size) {
+    size_t count;
+    const file_signature_t* signatures = carving_get_signatures(&count);
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (auto& b : data) b = (uint8_t)('a' + rng() % 26);
+    size_t at = 5000;
+    for (; at + 70000 < size; at += 20000 + rng() % 50000) {
+        const file_signature_t* sig = &signatures[rng() % count];
+        if (!sig->footer_signature) continue;
+        memcpy(data.data() + at, sig->header_signature, sig->header_signature_length);
+        memcpy(data.data() + at + 200 + rng() % 60000, sig->footer_signature, sig->footer_signature_length);
+    }
+    memcpy(data.data() + at, "GIF89a", 6);
+    return data;
+}
+
+int test_carving_streaming() {
+    printf("Testing streaming and parallel carving...\n");
+    
+    const char* test_file = "/tmp/carving_stream_image.dat";
+    std::vector<uint8_t> image = make_image(11, 3 * 1024 * 1024 + 123);
+    if (create_test_file(test_file, image.data(), image.size()) != 0) {
+        printf("Failed to create test image\n");
+        return 1;
+    }
+    
+    carving_result_t expected;
+    if (carving_carve_data(image.data(), image.size(), &expected) != 0 || expected.count < 10) {
+        printf("In-memory carving failed\n");
+        unlink(test_file);
+        return 1;
+    }
+    
+    // Window sizes that split signatures and files in many places
+    for (size_t window : {(size_t)4096, (size_t)65536, (size_t)CARVING_DEFAULT_WINDOW}) {
+        carving_result_t result;
+        if (carving_carve_file_windowed(test_file, window, &result) != 0 || result.count != expected.count) {
+            printf("Streaming carve (window %lu) found a different number of files\n", (unsigned long)window);
+            unlink(test_file);
+            return 1;
+        }
+        for (size_t i = 0; i < result.count; i++) {
+            const carved_file_t* a = &expected.files[i];
+            const carved_file_t* b = &result.files[i];
+            if (a->offset != b->offset || a->size != b->size || strcmp(a->extension, b->extension) != 0 ||
+                b->data != NULL || strcmp(b->path, test_file) != 0) {
+                printf("Streaming carve (window %lu) differs at file %lu\n", (unsigned long)window,
+                       (unsigned long)i);
+                unlink(test_file);
+                return 1;
+            }
+        }
+        carving_result_free(&result);
+    }
+    
+    // Parallel segments, including segments smaller than a file and ones
+    // that split headers and footers, give the serial result in order
+    const size_t threads[] = {1, 2, 4, 8};
+    const size_t segments[] = {4096, 12288, 65536, 0};
+    for (size_t t : threads) {
+        for (size_t segment : segments) {
+            carving_result_t result;
+            int ret = carving_carve_file_parallel(test_file, t, segment, &result);
+            bool same = ret == 0 && result.count == expected.count;
+            for (size_t i = 0; same && i < result.count; i++) {
+                same = result.files[i].offset == expected.files[i].offset &&
+                       result.files[i].size == expected.files[i].size &&
+                       strcmp(result.files[i].extension, expected.files[i].extension) == 0;
+            }
+            carving_result_free(&result);
+            if (!same) {
+                printf("Parallel carve (%lu threads, %lu byte segments) differs from serial\n",
+                       (unsigned long)t, (unsigned long)segment);
+                unlink(test_file);
+                return 1;
+            }
+        }
+    }
+    
+    // References are copied straight from the image
+    carving_result_t refs;
+    carving_carve_file(test_file, &refs);
+    const char* output_dir = "/tmp/carving_stream_output";
+    if (carving_save_files(&refs, output_dir) != 0) {
+        printf("Failed to save referenced files\n");
+        unlink(test_file);
+        return 1;
+    }
+    for (size_t i = 0; i < refs.count; i++) {
+        const carved_file_t* file = &refs.files[i];
+        char filename[1024];
+        snprintf(filename, sizeof(filename), "%s/carved_%08llx_%08lx.%s", output_dir,
+                 (unsigned long long)file->offset, (unsigned long)file->size, file->extension);
+        FILE* f = fopen(filename, "rb");
+        std::vector<uint8_t> saved(file->size + 1);
+        size_t got = f ? fread(saved.data(), 1, saved.size(), f) : 0;
+        if (f) fclose(f);
+        unlink(filename);
+        if (got != file->size || memcmp(saved.data(), image.data() + file->offset, file->size) != 0) {
+            printf("Saved file %s does not match the image\n", filename);
+            unlink(test_file);
+            return 1;
+        }
+    }
+    carving_result_free(&refs);
+    carving_result_free(&expected);
+    unlink(test_file);
+    
+    printf("Streaming and parallel carving test passed!\n");
+    return 0;
+}
+
 int main() {
     printf("Running file carving tests...\n");
     
@@ -204,6 +430,16 @@ int main() {
         return result3;
     }
     
+    int result4 = test_matcher();
+    if (result4 != 0) {
+        return result4;
+    }
+    
+    int result5 = test_carving_streaming();
+    if (result5 != 0) {
+        return result5;
+    }
+    
     printf("All file carving tests passed!\n");
     return 0;
 }
\ No newline at end of file
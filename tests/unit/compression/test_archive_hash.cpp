@@ -0,0 +1,194 @@
+#include <archive.h>
+#include <archive_entry.h>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "libs/compression/archive_hash.h"
+#include "libs/fuzzyhash/ssdeep.h"
+
+static std::string make_data(uint32_t seed, size_t size) {
+    std::mt19937 rng(seed);
+    std::string data(size, '\0');
+    for (auto& c : data) c = static_cast<char>('a' + rng() % 26);
+    return data;
+}
+
+static std::vector<uint8_t> blake3_of(const std::string& data) {
+    BLAKE3_HASH_STATE st;
+    blake3_hash_init(&st);
+    blake3_hash_update(&st, data.data(), data.size());
+    std::vector<uint8_t> out(BLAKE3_OUT_LEN);
+    blake3_hash_finalize(&st, out.data(), BLAKE3_OUT_LEN);
+    return out;
+}
+
+// The scanner's head/tail signature of a loose file with these contents
+static std::vector<uint8_t> head_tail_of(const std::string& data) {
+    const size_t chunk = ARCHIVE_HASH_HEAD_TAIL_SIZE;
+    std::string signed_part;
+    if (data.size() >= chunk) signed_part += data.substr(0, chunk);
+    if (data.size() > 2 * chunk) signed_part += data.substr(data.size() - chunk);
+    return blake3_of(signed_part);
+}
+
+// Write an archive of (name, contents) pairs in memory
+static std::string make_archive(bool zip, const std::vector<std::pair<std::string, std::string>>& files) {
+    struct archive* a = archive_write_new();
+    if (zip) {
+        archive_write_set_format_zip(a);
+    } else {
+        archive_write_set_format_pax_restricted(a);
+        archive_write_add_filter_gzip(a);
+    }
+    std::vector<char> buffer(1 << 22);
+    size_t used = 0;
+    int opened = archive_write_open_memory(a, buffer.data(), buffer.size(), &used);
+    assert(opened == ARCHIVE_OK);
+    for (const auto& [name, contents] : files) {
+        struct archive_entry* entry = archive_entry_new();
+        archive_entry_set_pathname(entry, name.c_str());
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        archive_entry_set_size(entry, static_cast<la_int64_t>(contents.size()));
+        archive_entry_set_mtime(entry, 1700000000, 0);
+        int header = archive_write_header(a, entry);
+        la_ssize_t written = archive_write_data(a, contents.data(), contents.size());
+        assert(header == ARCHIVE_OK && written == static_cast<la_ssize_t>(contents.size()));
+        archive_entry_free(entry);
+    }
+    archive_write_close(a);
+    archive_write_free(a);
+    return std::string(buffer.data(), used);
+}
+
+static void write_file(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+static const archive_member_hash_t* find(const archive_hash_result_t& result, const std::string& path) {
+    for (size_t i = 0; i < result.count; ++i) {
+        if (path == result.members[i].path) return &result.members[i];
+    }
+    return nullptr;
+}
+
+static bool same(const uint8_t* digest, const std::vector<uint8_t>& expect) {
+    return std::memcmp(digest, expect.data(), BLAKE3_OUT_LEN) == 0;
+}
+
+int main() {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / ("test_archive_hash_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+
+    // Sizes on both sides of the head/tail thresholds
+    const std::string big = make_data(1, 70000);
+    const std::string mid = make_data(2, 20000);
+    const std::string small = make_data(3, 100);
+
+    const std::string inner_tgz = make_archive(false, {{"b.bin", mid}, {"c.txt", small}});
+    const std::string inner_zip = make_archive(true, {{"deep/d.txt", big}});
+    const std::string outer = dir.string() + "/outer.zip";
+    write_file(outer, make_archive(true, {{"a.txt", big}, {"dir/inner.tar.gz", inner_tgz}, {"inner.zip", inner_zip}}));
+    const std::string loose_tgz = dir.string() + "/copy.tar.gz";
+    write_file(loose_tgz, make_archive(false, {{"copy.txt", big}}));
+    const std::string plain = dir.string() + "/plain.txt";
+    write_file(plain, small);
+
+    assert(archive_hash_is_archive_file(outer.c_str()) == 1);
+    assert(archive_hash_is_archive_file(loose_tgz.c_str()) == 1);
+    assert(archive_hash_is_archive_file(plain.c_str()) == 0);
+    assert(archive_hash_is_archive(inner_tgz.data(), inner_tgz.size()) == 1);
+
+    // Every level, with fuzzy hashes
+    archive_hash_options_t options;
+    archive_hash_options_init(&options);
+    options.fuzzy = ARCHIVE_HASH_SSDEEP | ARCHIVE_HASH_TLSH;
+    archive_hash_result_t result;
+    archive_hash_result_init(&result);
+    int ret = archive_hash_file(outer.c_str(), &options, &result);
+    assert(ret == 0 && result.count == 6);
+
+    const std::string tgz_path = outer + "!/dir/inner.tar.gz";
+    const archive_member_hash_t* a = find(result, outer + "!/a.txt");
+    const archive_member_hash_t* b = find(result, tgz_path + "!/b.bin");
+    const archive_member_hash_t* c = find(result, tgz_path + "!/c.txt");
+    const archive_member_hash_t* tgz = find(result, tgz_path);
+    const archive_member_hash_t* d = find(result, outer + "!/inner.zip!/deep/d.txt");
+    assert(a && b && c && tgz && d);
+    assert(a->depth == 1 && b->depth == 2 && tgz->depth == 1 && d->depth == 2);
+    assert(tgz->is_archive && !a->is_archive);
+    assert(a->size == big.size() && b->size == mid.size() && tgz->size == inner_tgz.size());
+    assert(a->mtime == 1700000000);
+    assert(same(a->blake3, blake3_of(big)) && same(d->blake3, blake3_of(big)));
+    assert(same(b->blake3, blake3_of(mid)) && same(c->blake3, blake3_of(small)));
+    // The nested archive's own bytes are hashed while its members are read
+    assert(same(tgz->blake3, blake3_of(inner_tgz)));
+    assert(same(a->head_tail, head_tail_of(big)) && same(b->head_tail, head_tail_of(mid)) &&
+           same(c->head_tail, head_tail_of(small)));
+    // A nested archive's record follows its members'
+    assert(tgz > b && tgz > c);
+
+    char* ss = nullptr;
+    int ss_ret = ssdeep_hash_data(mid.data(), mid.size(), &ss);
+    assert(ss_ret == 0);
+    assert(b->ssdeep && std::strcmp(b->ssdeep, ss) == 0);
+    std::free(ss);
+    assert(a->tlsh && c->tlsh);
+    archive_hash_result_free(&result);
+
+    // No nesting: nested archives are plain members
+    options.max_depth = 0;
+    options.fuzzy = 0;
+    ret = archive_hash_file(outer.c_str(), &options, &result);
+    assert(ret == 0 && result.count == 3);
+    tgz = find(result, tgz_path);
+    assert(tgz && !tgz->is_archive && same(tgz->blake3, blake3_of(inner_tgz)));
+    assert(!result.members[0].ssdeep && !result.members[0].tlsh);
+    archive_hash_result_free(&result);
+
+    // Several archives in parallel, grouped in the given order; the
+    // unreadable one fails without losing the others
+    options.max_depth = ARCHIVE_HASH_DEFAULT_MAX_DEPTH;
+    options.num_threads = 3;
+    const std::string missing = dir.string() + "/missing.zip";
+    const char* paths[] = {loose_tgz.c_str(), missing.c_str(), outer.c_str(), plain.c_str()};
+    ret = archive_hash_files(paths, 4, &options, &result);
+    assert(ret == -1 && result.count == 7);
+    assert(std::string(result.members[0].path) == loose_tgz + "!/copy.txt");
+    for (size_t i = 1; i < result.count; ++i) {
+        assert(std::string(result.members[i].path).rfind(outer, 0) == 0);
+    }
+    // The copies of big are found in both archives
+    size_t copies = 0;
+    for (size_t i = 0; i < result.count; ++i) {
+        copies += same(result.members[i].blake3, blake3_of(big));
+    }
+    assert(copies == 3);
+    archive_hash_result_free(&result);
+
+    // A truncated archive keeps the members read before the damage
+    const std::string first = make_data(4, 200000);
+    const std::string whole = make_archive(false, {{"first.txt", first}, {"second.txt", make_data(5, 200000)}});
+    const std::string cut = dir.string() + "/cut.tar.gz";
+    write_file(cut, whole.substr(0, whole.size() * 3 / 4));
+    archive_hash_result_init(&result);
+    ret = archive_hash_file(cut.c_str(), &options, &result);
+    assert(ret == -1);
+    assert(result.count == 1 && same(result.members[0].blake3, blake3_of(first)));
+    archive_hash_result_free(&result);
+
+    fs::remove_all(dir);
+    std::printf("archive hash tests passed\n");
+    return 0;
+}
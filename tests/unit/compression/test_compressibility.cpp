@@ -0,0 +1,138 @@
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "libs/compression/compressibility.h"
+
+static std::string make_random(uint32_t seed, size_t size) {
+    std::mt19937 rng(seed);
+    std::string data(size, '\0');
+    for (auto& c : data) c = static_cast<char>(rng());
+    return data;
+}
+
+// Lines of words from a small vocabulary: compresses like source or logs
+static std::string make_text(uint32_t seed, size_t size) {
+    static const char* words[] = {"disk", "scan", "file", "index", "error", "size", "path", "block",
+                                  "entry", "cache", "read", "write", "volume", "time", "user", "root"};
+    std::mt19937 rng(seed);
+    std::string text;
+    while (text.size() < size) {
+        text += words[rng() % 16];
+        text += rng() % 8 == 0 ? '\n' : ' ';
+    }
+    text.resize(size);
+    return text;
+}
+
+static void write_file(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+int main() {
+    namespace fs = std::filesystem;
+    compressibility_context_t* context = compressibility_context_new();
+    assert(context);
+
+    // LZ4 block sizes: a short input is all literals; a run of one byte is
+    // one match with its length extension bytes
+    size_t literals = 0;
+    size_t sequences = 0;
+    const uint8_t abc[] = {'a', 'b', 'c'};
+    const size_t abc_size = compressibility_lz4_size(context, abc, 3, &literals, &sequences);
+    assert(abc_size == 4);
+    assert(literals == 3 && sequences == 0);
+    const std::vector<uint8_t> zeros(100000, 0);
+    const size_t zero_size = compressibility_lz4_size(context, zeros.data(), zeros.size(), &literals, &sequences);
+    assert(sequences == 1 && literals == 1 + 5);
+    // token, literal, offset, length bytes; then the last five literals
+    assert(zero_size == 1 + 1 + 2 + ((100000 - 1 - 5 - 4 - 15) / 255 + 1) + 1 + 5);
+
+    compressibility_options_t options;
+    compressibility_options_init(&options);
+    compressibility_result_t result;
+    int ret = 0;
+
+    // Random data is skipped on entropy, text compresses in between, and
+    // the entropy-coded estimate is never worse than LZ4
+    const std::string noise = make_random(1, 300000);
+    ret = compressibility_estimate_data(context, noise.data(), noise.size(), &options, &result);
+    assert(ret == 0);
+    assert(result.skipped && result.lz4_ratio == 1.0 && result.reclaimable == 0);
+    const std::string text = make_text(2, 300000);
+    ret = compressibility_estimate_data(context, text.data(), text.size(), &options, &result);
+    assert(ret == 0);
+    assert(!result.skipped);
+    assert(result.lz4_ratio > 0.2 && result.lz4_ratio < 0.9);
+    assert(result.strong_ratio < result.lz4_ratio);
+    assert(result.reclaimable == static_cast<uint64_t>(300000 * (1.0 - result.strong_ratio)));
+    ret = compressibility_estimate_data(context, zeros.data(), zeros.size(), &options, &result);
+    assert(ret == 0);
+    assert(result.strong_ratio < 0.01);
+
+    // Known compressed formats are recognized from their first bytes
+    assert(compressibility_is_compressed_format("\xFF\xD8\xFF\xE0", 4));
+    assert(compressibility_is_compressed_format("\x1F\x8B\x08\x00", 4));
+    assert(compressibility_is_compressed_format("\x00\x00\x00\x18" "ftypisom", 12));
+    assert(!compressibility_is_compressed_format("!<arch>\n", 8));
+    assert(!compressibility_is_compressed_format(text.data(), 4096));
+    std::string jpeg = "\xFF\xD8\xFF\xE0" + text;
+    ret = compressibility_estimate_data(context, jpeg.data(), jpeg.size(), &options, &result);
+    assert(ret == 0);
+    assert(result.lz4_ratio == 1.0);
+
+    const fs::path dir = fs::temp_directory_path() / ("test_compressibility_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+
+    // A large file reads at most 1% of itself, in evenly spaced blocks;
+    // the samples of a uniform file predict the whole
+    const std::string big_text = make_text(3, 20 * 1024 * 1024);
+    const std::string big = dir.string() + "/big.log";
+    write_file(big, big_text);
+    ret = compressibility_estimate_file(context, big.c_str(), &options, &result);
+    assert(ret == 0);
+    assert(result.size == big_text.size());
+    assert(result.sampled > 0 && result.sampled <= big_text.size() / 100);
+    const compressibility_result_t big_result = result;
+    compressibility_result_t whole;
+    ret = compressibility_estimate_data(context, big_text.data(), big_text.size(), &options, &whole);
+    assert(ret == 0);
+    assert(result.lz4_ratio > whole.lz4_ratio - 0.05 && result.lz4_ratio < whole.lz4_ratio + 0.05);
+
+    // Small files are read whole
+    const std::string small = dir.string() + "/small.txt";
+    write_file(small, text.substr(0, 3000));
+    ret = compressibility_estimate_file(context, small.c_str(), &options, &result);
+    assert(ret == 0);
+    assert(result.size == 3000 && result.sampled == 3000);
+
+    const std::string random_file = dir.string() + "/random.bin";
+    write_file(random_file, noise);
+    const std::string empty = dir.string() + "/empty";
+    write_file(empty, "");
+    const std::string missing = dir.string() + "/missing";
+
+    // In parallel, each thread with its own context; the missing file
+    // fails without losing the others
+    const char* paths[] = {big.c_str(), small.c_str(), missing.c_str(), random_file.c_str(), empty.c_str()};
+    compressibility_result_t results[5];
+    ret = compressibility_estimate_files(paths, 5, &options, 3, results);
+    assert(ret == -1);
+    assert(results[0].size == big_text.size() && results[0].lz4_ratio == big_result.lz4_ratio);
+    assert(results[1].sampled == 3000);
+    assert(results[2].size == 0 && results[2].sampled == 0);
+    assert(results[3].skipped && results[3].reclaimable == 0);
+    assert(results[4].size == 0 && results[4].lz4_ratio == 1.0);
+
+    compressibility_context_free(context);
+    fs::remove_all(dir);
+    std::printf("compressibility tests passed\n");
+    return 0;
+}
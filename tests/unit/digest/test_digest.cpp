@@ -0,0 +1,162 @@
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include "libs/digest/digest.h"
+#include "libs/chash/blake3.h"
+#include "libs/chash/sha256.h"
+#include "libs/fuzzyhash/ssdeep.h"
+#include "libs/fuzzyhash/tlsh.h"
+
+static std::string write_temp_file(const char* name, const std::vector<uint8_t>& content) {
+    auto tmp = std::filesystem::temp_directory_path() / name;
+    FILE* f = std::fopen(tmp.string().c_str(), "wb"); assert(f);
+    if (!content.empty()) std::fwrite(content.data(), 1, content.size(), f);
+    std::fclose(f);
+    return tmp.string();
+}
+
+// Counts bytes and checks they arrive in order
+class CountingConsumer : public DigestConsumer {
+public:
+    explicit CountingConsumer(std::atomic<int>* created) : m_sum(0), m_bytes(0), m_begin_size(0) {
+        created->fetch_add(1);
+    }
+    void begin(uint64_t size) override { m_begin_size = size; }
+    void update(const uint8_t* data, size_t len) override {
+        for (size_t i = 0; i < len; ++i) m_sum = m_sum * 31 + data[i];
+        m_bytes += len;
+    }
+    void finish(DigestRecord& record) override {
+        assert(m_begin_size == 0 || m_begin_size == m_bytes);
+        record.extra["count"] = std::to_string(m_bytes) + ":" + std::to_string(m_sum);
+    }
+
+private:
+    uint64_t m_sum;
+    uint64_t m_bytes;
+    uint64_t m_begin_size;
+};
+
+int main() {
+    // Odd size so the last buffer is partial; small buffers force many updates
+    std::mt19937 rng(42);
+    std::vector<uint8_t> data(1000003);
+    for (auto& b : data) b = static_cast<uint8_t>(rng());
+    const uint8_t png[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    std::copy(png, png + sizeof(png), data.begin());
+
+    uint8_t expected_blake3[BLAKE3_OUT_LEN];
+    BLAKE3_HASH_STATE b3; blake3_hash_init(&b3);
+    blake3_hash_update(&b3, data.data(), data.size());
+    blake3_hash_finalize(&b3, expected_blake3, BLAKE3_OUT_LEN);
+
+    uint8_t expected_sha[SHA256_BLOCK_SIZE];
+    SHA256_CTX sha; sha256_init(&sha);
+    sha256_update(&sha, data.data(), data.size());
+    sha256_final(&sha, expected_sha);
+
+    uint64_t sum = 0;
+    for (uint8_t b : data) sum = sum * 31 + b;
+    const std::string expected_count = std::to_string(data.size()) + ":" + std::to_string(sum);
+
+    DigestEngine::Parameters params;
+    params.buffer_size = 4096;
+    DigestEngine engine(params);
+    std::atomic<int> created{0};
+    engine.add_consumer([&]() { return std::make_unique<CountingConsumer>(&created); });
+
+    // One pass over a file produces every digest
+    std::string path = write_temp_file("ds_digest_a.bin", data);
+    DigestRecord rec;
+    bool digested = engine.digest_file(path, rec);
+    assert(digested);
+    assert(rec.size == data.size());
+    assert(rec.blake3 == std::vector<uint8_t>(expected_blake3, expected_blake3 + BLAKE3_OUT_LEN));
+    assert(rec.sha256 == std::vector<uint8_t>(expected_sha, expected_sha + SHA256_BLOCK_SIZE));
+    assert(rec.magic == "png");
+    assert(rec.extra["count"] == expected_count);
+    uint64_t total = 0;
+    for (uint64_t c : rec.histogram) total += c;
+    assert(total == data.size());
+    assert(rec.entropy > 7.99 && rec.entropy <= 8.0);
+
+    // Fuzzy hashes fed buffer by buffer match the one-shot digests
+    char* ss = nullptr;
+    char* th = nullptr;
+    int ss_ret = ssdeep_hash_data(data.data(), data.size(), &ss);
+    int th_ret = tlsh_hash_data(data.data(), data.size(), &th);
+    assert(ss_ret == 0 && th_ret == 0);
+    assert(rec.ssdeep == ss && rec.tlsh == th);
+    std::free(ss);
+    std::free(th);
+
+    // In-memory input gives the same record
+    DigestRecord mem;
+    engine.digest_data(data.data(), data.size(), mem);
+    assert(mem.blake3 == rec.blake3 && mem.sha256 == rec.sha256);
+    assert(mem.histogram == rec.histogram && mem.extra == rec.extra);
+
+    // Entropy map blocks straddle the read buffers
+    assert(rec.entropy_map.size() == (data.size() + 4095) / 4096);
+    assert(mem.entropy_map == rec.entropy_map);
+
+    // Entropy of a two-symbol uniform source is exactly one bit
+    std::vector<uint8_t> two(8192);
+    for (size_t i = 0; i < two.size(); ++i) two[i] = (i & 1) ? 'a' : 'b';
+    DigestRecord tr;
+    engine.digest_data(two.data(), two.size(), tr);
+    assert(std::fabs(tr.entropy - 1.0) < 1e-12);
+    assert(tr.entropy_map.size() == 2 && tr.entropy_map[0] == 32 && tr.entropy_map[1] == 32);
+    assert(tr.magic.empty());
+
+    // Selecting digests leaves the others empty
+    DigestEngine::Parameters only;
+    only.digests = DigestEngine::SHA256;
+    DigestEngine sha_only(only);
+    DigestRecord so;
+    bool sha_digested = sha_only.digest_file(path, so);
+    assert(sha_digested);
+    assert(so.blake3.empty() && so.magic.empty() && so.entropy == 0.0 && so.entropy_map.empty());
+    assert(so.sha256 == rec.sha256);
+
+    // Magic sniffing
+    const uint8_t elf[] = {0x7F, 'E', 'L', 'F', 2, 1, 1};
+    assert(DigestEngine::sniff_magic(elf, sizeof(elf)) == "elf");
+    const char wav[] = "RIFF\x24\x00\x00\x00WAVEfmt ";
+    assert(DigestEngine::sniff_magic(reinterpret_cast<const uint8_t*>(wav), sizeof(wav) - 1) == "wav");
+    std::vector<uint8_t> tar(512, 0);
+    std::copy_n("ustar", 5, tar.begin() + 257);
+    assert(DigestEngine::sniff_magic(tar.data(), tar.size()) == "tar");
+
+    // Empty file: valid record with known empty-input digests
+    std::string empty = write_temp_file("ds_digest_empty.bin", {});
+    DigestRecord er;
+    bool empty_digested = engine.digest_file(empty, er);
+    assert(empty_digested);
+    assert(er.size == 0 && er.blake3.size() == BLAKE3_OUT_LEN);
+    assert(er.ssdeep.empty() && er.tlsh.empty());
+    assert(DigestEngine::to_hex(er.sha256) ==
+           "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    // Batch across threads, including a missing file
+    std::vector<std::string> paths = {path, empty, path + ".missing", path};
+    std::vector<DigestRecord> out(paths.size());
+    bool ok[4];
+    created = 0;
+    size_t batch_digested = engine.digest_files(paths.data(), paths.size(), out.data(), ok, 3);
+    assert(batch_digested == 3);
+    assert(ok[0] && ok[1] && !ok[2] && ok[3]);
+    assert(out[0].blake3 == rec.blake3 && out[3].sha256 == rec.sha256);
+    assert(out[3].extra["count"] == expected_count);
+    assert(created == 3); // Consumers are created only for files that open
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(empty);
+    return 0;
+}
@@ -1,5 +1,8 @@
 #include "libs/encryption/encryption.h"
+#include "libs/encryption/entropy.h"
+#include "libs/encryption/repeats.h"
 #include <cassert>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -66,7 +69,225 @@ void test_encryption_analysis() {
     unlink("test_tdef.tdef");
 }
 
+// Straightforward single-histogram entropy, normalized to 0-1
+static double reference_entropy(const uint8_t* data, size_t size) {
+    size_t counts[256] = {0};
+    for (size_t i = 0; i < size; i++) counts[data[i]]++;
+    double h = 0.0;
+    for (int b = 0; b < 256; b++) {
+        if (counts[b] == 0) continue;
+        double p = (double)counts[b] / (double)size;
+        h -= p * log2(p);
+    }
+    return h / 8.0;
+}
+
+void test_entropy_map() {
+    printf("--- Testing Entropy Map ---\n");
+
+    // Half zeros, half pseudo-random, with a partial last block
+    const size_t size = 64 * 4096 + 1234;
+    uint8_t* data = (uint8_t*)malloc(size);
+    uint32_t x = 12345;
+    for (size_t i = 0; i < size; i++) {
+        x = x * 1103515245u + 12345u;
+        data[i] = (i < size / 2) ? 0 : (uint8_t)(x >> 24);
+    }
+
+    // Whole-buffer entropy matches the reference
+    assert(fabs(encryption_calculate_entropy_internal(data, size) - reference_entropy(data, size)) < 1e-9);
+    assert(encryption_calculate_entropy_internal(data, 4096) == 0.0);
+
+    encryption_entropy_map_t map;
+    int ret = encryption_entropy_map_compute(data, size, ENCRYPTION_ENTROPY_BLOCK_SIZE, &map);
+    assert(ret == 0);
+    assert(map.count == 65);
+    for (size_t b = 0; b < map.count; b++) {
+        size_t off = b * 4096;
+        size_t len = (size - off < 4096) ? size - off : 4096;
+        long expected = lround(reference_entropy(data + off, len) * 255.0);
+        assert(labs((long)map.values[b] - expected) <= 1);
+    }
+
+    // Feeding odd-sized pieces gives the same map
+    encryption_entropy_map_t chunked;
+    ret = encryption_entropy_map_init(&chunked, ENCRYPTION_ENTROPY_BLOCK_SIZE);
+    assert(ret == 0);
+    for (size_t off = 0, step = 1; off < size; off += step, step = step * 3 % 9973 + 1) {
+        size_t len = (size - off < step) ? size - off : step;
+        ret = encryption_entropy_map_update(&chunked, data + off, len);
+        assert(ret == 0);
+    }
+    ret = encryption_entropy_map_finish(&chunked);
+    assert(ret == 0);
+    assert(chunked.count == map.count && memcmp(chunked.values, map.values, map.count) == 0);
+    encryption_entropy_map_free(&chunked);
+
+    // Sketch: about half the blocks are high entropy, first cells low, last high
+    uint8_t sketch[ENCRYPTION_ENTROPY_SKETCH_SIZE];
+    encryption_entropy_sketch(map.values, map.count, sketch);
+    double high = encryption_entropy_sketch_high_fraction(sketch);
+    printf("High-entropy fraction: %.3f\n", high);
+    assert(high > 0.45 && high < 0.55);
+    assert(sketch[1] == 0);
+    assert(sketch[ENCRYPTION_ENTROPY_SKETCH_SIZE - 1] >= ENCRYPTION_HIGH_ENTROPY_LEVEL);
+    encryption_entropy_map_free(&map);
+
+    ret = encryption_entropy_map_init(&map, 0);
+    assert(ret != 0);
+    ret = encryption_entropy_map_init(&map, ENCRYPTION_ENTROPY_MAX_BLOCK_SIZE + 1);
+    assert(ret != 0);
+
+    free(data);
+    printf("Entropy map tests passed!\n");
+}
+
+static uint64_t g_rng = 88172645463325252ULL;
+static uint64_t next_random() {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static size_t g_cmp_block;
+static const uint8_t* g_cmp_data;
+static int compare_blocks(const void* a, const void* b) {
+    return memcmp(g_cmp_data + *(const size_t*)a, g_cmp_data + *(const size_t*)b, g_cmp_block);
+}
+
+// Repeated aligned blocks by sorting, as a reference
+static uint64_t reference_repeats(const uint8_t* data, size_t size, size_t block) {
+    size_t n = size / block;
+    size_t* offsets = (size_t*)malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) offsets[i] = i * block;
+    g_cmp_block = block;
+    g_cmp_data = data;
+    qsort(offsets, n, sizeof(size_t), compare_blocks);
+    uint64_t repeats = 0;
+    for (size_t i = 1; i < n; i++) {
+        if (memcmp(data + offsets[i - 1], data + offsets[i], block) == 0) repeats++;
+    }
+    free(offsets);
+    return repeats;
+}
+
+void test_block_repeats() {
+    printf("--- Testing Repeated Block Analysis ---\n");
+
+    // Random data with a quarter of the 16-byte blocks copied from earlier ones
+    const size_t size = 1 << 20;
+    uint8_t* data = (uint8_t*)malloc(size + 5);
+    for (size_t i = 0; i < size + 5; i += 8) {
+        uint64_t r = next_random();
+        memcpy(data + i, &r, (size + 5 - i < 8) ? size + 5 - i : 8);
+    }
+    for (size_t off = 4096; off < size; off += 64) {
+        size_t src = (next_random() % (off / 16)) * 16;
+        memcpy(data + off, data + src, 16);
+    }
+
+    encryption_repeat_report_t report;
+    int ret = encryption_repeat_analyze(data, size + 5, NULL, &report);
+    assert(ret == 0);
+    assert(report.size == size + 5);
+    for (uint32_t bs = 8; bs <= 32; bs *= 2) {
+        const encryption_block_repeats_t* r = encryption_repeat_report_get(&report, bs);
+        assert(r && r->sample_shift == 0);
+        assert(r->total_blocks == (size + 5) / bs && r->examined_blocks == r->total_blocks);
+        assert(r->repeated_blocks == reference_repeats(data, size + 5, bs));
+        printf("%u-byte blocks: %llu repeated (%.3f)\n", bs,
+               (unsigned long long)r->repeated_blocks, r->duplicate_ratio);
+    }
+    const encryption_block_repeats_t* b16 = encryption_repeat_report_get(&report, 16);
+    assert(b16->duplicate_ratio > 0.2 && b16->duplicate_ratio < 0.26);
+    assert(b16->position_count == ENCRYPTION_REPEAT_DEFAULT_POSITIONS);
+    for (size_t i = 0; i < b16->position_count; i++) {
+        const encryption_repeat_position_t* p = &b16->positions[i];
+        assert(p->first_offset < p->offset && memcmp(data + p->first_offset, data + p->offset, 16) == 0);
+        assert(i == 0 || p->offset > b16->positions[i - 1].offset);
+    }
+    assert(encryption_repeat_report_get(&report, 12) == NULL);
+
+    // Feeding odd-sized pieces gives the same report
+    encryption_repeat_analyzer_t* analyzer = encryption_repeat_analyzer_create(NULL);
+    assert(analyzer);
+    for (size_t off = 0, step = 1; off < size + 5; off += step, step = step * 7 % 4099 + 1) {
+        size_t len = (size + 5 - off < step) ? size + 5 - off : step;
+        ret = encryption_repeat_analyzer_update(analyzer, data + off, len);
+        assert(ret == 0);
+    }
+    encryption_repeat_report_t chunked;
+    ret = encryption_repeat_analyzer_report(analyzer, &chunked);
+    assert(ret == 0);
+    encryption_repeat_analyzer_free(analyzer);
+    for (int k = 0; k < ENCRYPTION_REPEAT_SIZE_COUNT; k++) {
+        assert(chunked.sizes[k].repeated_blocks == report.sizes[k].repeated_blocks);
+        assert(chunked.sizes[k].position_count == report.sizes[k].position_count);
+        assert(memcmp(chunked.sizes[k].positions, report.sizes[k].positions,
+                      report.sizes[k].position_count * sizeof(encryption_repeat_position_t)) == 0);
+    }
+    encryption_repeat_report_free(&chunked);
+
+    // Bounded table: content sampling keeps the ratio estimate close
+    encryption_repeat_options_t options;
+    encryption_repeat_options_init(&options);
+    options.max_entries = 4096;
+    encryption_repeat_report_t sampled;
+    ret = encryption_repeat_analyze(data, size, &options, &sampled);
+    assert(ret == 0);
+    const encryption_block_repeats_t* s16 = encryption_repeat_report_get(&sampled, 16);
+    printf("Sampled 1/%u: ratio %.3f over %llu blocks\n", 1u << s16->sample_shift, s16->duplicate_ratio,
+           (unsigned long long)s16->examined_blocks);
+    assert(s16->sample_shift > 0 && s16->distinct_blocks < 4096);
+    assert(fabs(s16->duplicate_ratio - b16->duplicate_ratio) < 0.05);
+    for (size_t i = 0; i < s16->position_count; i++) {
+        assert(memcmp(data + s16->positions[i].first_offset, data + s16->positions[i].offset, 16) == 0);
+    }
+    encryption_repeat_report_free(&sampled);
+    encryption_repeat_report_free(&report);
+
+    // Cipher detection: repeated blocks in high-entropy data read as ECB
+    char* cipher = NULL;
+    double confidence = 0.0;
+    ret = encryption_detect_cipher(data, size, &cipher, &confidence);
+    assert(ret == 0);
+    assert(strcmp(cipher, "ECB") == 0);
+    free(cipher);
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t r = next_random();
+        memcpy(data + i, &r, 8);
+    }
+    ret = encryption_detect_cipher(data, size, &cipher, &confidence);
+    assert(ret == 0);
+    assert(strcmp(cipher, "ECB") != 0);
+    free(cipher);
+
+    // Deep analysis reads the whole file once
+    for (size_t off = size / 2; off < size; off += 32) {
+        memcpy(data + off, data, 16);
+    }
+    create_test_file("test_ecb.bin", (const char*)data, size);
+    encryption_options_t deep;
+    encryption_options_init(&deep);
+    deep.deep_analysis = 1;
+    encryption_result_t result;
+    ret = encryption_analyze_file("test_ecb.bin", &deep, &result);
+    assert(ret == 0);
+    printf("Deep analysis: entropy %.3f, duplicate ratio %.3f, mode %s\n", result.entropy,
+           result.duplicate_block_ratio, result.mode_of_operation ? result.mode_of_operation : "-");
+    assert(result.duplicate_block_ratio > 0.2 && result.mode_of_operation);
+    assert(strcmp(result.mode_of_operation, "ECB") == 0);
+    encryption_result_free(&result);
+    unlink("test_ecb.bin");
+
+    free(data);
+    printf("Repeated block tests passed!\n");
+}
+
 int main() {
     test_encryption_analysis();
+    test_entropy_map();
+    test_block_repeats();
     return 0;
 }
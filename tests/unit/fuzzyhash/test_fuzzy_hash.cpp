@@ -1,7 +1,12 @@
 #include "libs/fuzzyhash/fuzzy_hash.h"
+#include "libs/fuzzyhash/ssdeep.h"
+#include "libs/fuzzyhash/tlsh.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
 
 // Test data
 static const char* test_data1 = "This is a test file for fuzzy hashing. It contains some sample text that we can use to test our implementation.";
@@ -114,6 +119,128 @@ int test_fuzzy_hash_tlsh_basic() {
     return 0;
 }
 
+// Deterministic pseudo-random bytes; varied enough that chunk boundaries
+// occur at the expected rate for every blocksize
+static std::vector<uint8_t> make_data(size_t size, uint32_t seed) {
+    std::vector<uint8_t> out(size);
+    uint32_t x = seed;
+    for (size_t i = 0; i < size; i++) {
+        x = x * 1103515245u + 12345u;
+        out[i] = (uint8_t)(x >> 16);
+    }
+    return out;
+}
+
+// Length of the signatures' common prefix (crude closeness check)
+static size_t common_prefix(const char* a, const char* b) {
+    size_t n = 0;
+    while (a[n] && a[n] == b[n]) n++;
+    return n;
+}
+
+int test_fuzzy_hash_streaming() {
+    // Sizes straddle several blocksize doublings
+    const size_t sizes[] = {60, 5000, 200000, 3000000};
+    for (size_t size : sizes) {
+        std::vector<uint8_t> data = make_data(size, 7);
+
+        char* one_shot = NULL;
+        char* tlsh_one_shot = NULL;
+        if (ssdeep_hash_data(data.data(), data.size(), &one_shot) != 0 ||
+            tlsh_hash_data(data.data(), data.size(), &tlsh_one_shot) != 0) {
+            printf("One-shot fuzzy hash failed for %zu bytes\n", size);
+            return 1;
+        }
+
+        // Irregular chunking must not change either digest
+        ssdeep_state_t* ss = ssdeep_new();
+        tlsh_state_t* ts = tlsh_new();
+        size_t chunk = 1;
+        for (size_t off = 0; off < data.size(); off += chunk, chunk = chunk * 3 % 8191 + 1) {
+            size_t n = (chunk < data.size() - off) ? chunk : data.size() - off;
+            ssdeep_update(ss, data.data() + off, n);
+            tlsh_update(ts, data.data() + off, n);
+        }
+        char* streamed = NULL;
+        char* tlsh_streamed = NULL;
+        int ok = ssdeep_digest(ss, &streamed) == 0 && tlsh_digest(ts, &tlsh_streamed) == 0 &&
+                 strcmp(one_shot, streamed) == 0 && strcmp(tlsh_one_shot, tlsh_streamed) == 0;
+
+        // Blocksize adapts to the length: 64 chunks or fewer in the first signature
+        unsigned blocksize = 0;
+        sscanf(one_shot, "%u:", &blocksize);
+        const char* sig1 = strchr(one_shot, ':') + 1;
+        const char* sig2 = strchr(sig1, ':') + 1;
+        ok = ok && (uint64_t)blocksize * 64 >= size / 2 && (sig2 - sig1 - 1) <= 64 && strlen(sig2) <= 32;
+        ok = ok && strlen(tlsh_one_shot) == 72 && strncmp(tlsh_one_shot, "T1", 2) == 0;
+
+        printf("%zu bytes: %s | %s\n", size, one_shot, tlsh_one_shot);
+        free(streamed);
+        free(tlsh_streamed);
+        ssdeep_free(ss);
+        tlsh_free(ts);
+        if (!ok) {
+            printf("Streaming digest mismatch for %zu bytes\n", size);
+            free(one_shot);
+            free(tlsh_one_shot);
+            return 1;
+        }
+
+        // A small local edit leaves most of the ssdeep signature intact
+        if (size >= 200000) {
+            std::vector<uint8_t> edited = data;
+            memcpy(&edited[size / 2], "EDITED", 6);
+            char* edited_hash = NULL;
+            ssdeep_hash_data(edited.data(), edited.size(), &edited_hash);
+            if (!edited_hash || common_prefix(one_shot, edited_hash) < strlen(one_shot) / 4) {
+                printf("Edited data lost its ssdeep signature\n");
+                free(one_shot);
+                free(tlsh_one_shot);
+                free(edited_hash);
+                return 1;
+            }
+            free(edited_hash);
+        }
+        free(one_shot);
+        free(tlsh_one_shot);
+    }
+
+    // File path streams too, with the same result as in memory
+    std::vector<uint8_t> data = make_data(1 << 20, 11);
+    const char* path = "ds_fuzzy_stream.bin";
+    FILE* f = fopen(path, "wb");
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+    fuzzy_hash_result_t from_file, from_data;
+    int ok = fuzzy_hash_file(path, FUZZY_HASH_SSDEEP, &from_file) == 0 &&
+             fuzzy_hash_data(data.data(), data.size(), FUZZY_HASH_SSDEEP, &from_data) == 0 &&
+             strcmp(from_file.hash_value, from_data.hash_value) == 0;
+    fuzzy_hash_free(&from_file);
+    fuzzy_hash_free(&from_data);
+    ok = ok && fuzzy_hash_file(path, FUZZY_HASH_TLSH, &from_file) == 0 &&
+         fuzzy_hash_data(data.data(), data.size(), FUZZY_HASH_TLSH, &from_data) == 0 &&
+         strcmp(from_file.hash_value, from_data.hash_value) == 0;
+    fuzzy_hash_free(&from_file);
+    fuzzy_hash_free(&from_data);
+    remove(path);
+    if (!ok) {
+        printf("File and memory fuzzy hashes differ\n");
+        return 1;
+    }
+
+    // TLSH rejects inputs that are too short or too uniform
+    char* h = NULL;
+    std::vector<uint8_t> zeros(4096, 0);
+    if (tlsh_hash_data(data.data(), 40, &h) == 0 || tlsh_hash_data(zeros.data(), zeros.size(), &h) == 0) {
+        printf("TLSH accepted degenerate input\n");
+        free(h);
+        return 1;
+    }
+
+    printf("Fuzzy hash streaming tests passed!\n");
+    return 0;
+}
+
 int main() {
     printf("Running fuzzy hashing tests...\n");
     
@@ -127,6 +254,11 @@ int main() {
         return result2;
     }
     
+    int result3 = test_fuzzy_hash_streaming();
+    if (result3 != 0) {
+        return result3;
+    }
+    
     printf("All fuzzy hashing tests passed!\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "libs/fuzzyhash/fuzzy_index.h"
+#include "libs/fuzzyhash/ssdeep.h"
+#include "libs/fuzzyhash/tlsh.h"
+
+// Word salad over a vocabulary drawn from the seed, so unrelated texts differ
+// in their byte statistics and not just in word order
+static std::string make_text(uint32_t seed, size_t words) {
+    std::mt19937 rng(seed);
+    std::vector<std::string> vocab(48);
+    for (auto& word : vocab) {
+        const size_t len = 2 + rng() % 8;
+        for (size_t i = 0; i < len; ++i) word += static_cast<char>('a' + rng() % 26);
+    }
+    std::string text;
+    for (size_t i = 0; i < words; ++i) {
+        text += vocab[rng() % vocab.size()];
+        text += (rng() % 9 == 0) ? ".\n" : " ";
+    }
+    return text;
+}
+
+// Overwrite a few short runs of a copy
+static std::string mutate(std::string text, uint32_t seed, int edits) {
+    std::mt19937 rng(seed);
+    for (int e = 0; e < edits; ++e) {
+        size_t pos = rng() % (text.size() - 16);
+        for (size_t i = 0; i < 8; ++i) text[pos + i] = static_cast<char>('A' + rng() % 26);
+    }
+    return text;
+}
+
+static std::pair<std::string, std::string> hashes(const std::string& text) {
+    char* ss = nullptr;
+    char* th = nullptr;
+    int ss_ret = ssdeep_hash_data(text.data(), text.size(), &ss);
+    int th_ret = tlsh_hash_data(text.data(), text.size(), &th);
+    assert(ss_ret == 0 && th_ret == 0);
+    std::pair<std::string, std::string> result(ss, th);
+    std::free(ss);
+    std::free(th);
+    return result;
+}
+
+int main() {
+    // Parse round trip and comparison properties
+    const std::string base = make_text(1, 8000);
+    const std::string edited = mutate(base, 2, 6);
+    const std::string other = make_text(3, 8000);
+    auto hb = hashes(base), he = hashes(edited), ho = hashes(other);
+
+    ssdeep_digest_t sd;
+    int sd_ret = ssdeep_parse(hb.first.c_str(), &sd);
+    assert(sd_ret == 0);
+    assert(sd.len1 > 0 && sd.len1 <= 64);
+    assert(ssdeep_parse("garbage", &sd) != 0);
+    assert(ssdeep_compare(hb.first.c_str(), hb.first.c_str()) == 100);
+    const int ss_near = ssdeep_compare(hb.first.c_str(), he.first.c_str());
+    const int ss_far = ssdeep_compare(hb.first.c_str(), ho.first.c_str());
+    assert(ss_near >= 50 && ss_far < ss_near);
+    assert(ssdeep_compare(hb.first.c_str(), "bad") == 0);
+
+    tlsh_digest_t td;
+    int td_ret = tlsh_parse(hb.second.c_str(), &td);
+    assert(td_ret == 0);
+    assert(tlsh_parse("T1XYZ", &td) != 0);
+    assert(tlsh_distance(hb.second.c_str(), hb.second.c_str()) == 0);
+    const int t_near = tlsh_distance(hb.second.c_str(), he.second.c_str());
+    const int t_far = tlsh_distance(hb.second.c_str(), ho.second.c_str());
+    assert(t_near >= 0 && t_near < 50 && t_near < t_far);
+    assert(tlsh_distance(he.second.c_str(), hb.second.c_str()) == t_near);
+    assert(tlsh_compare(hb.second.c_str(), hb.second.c_str()) == 100);
+    assert(tlsh_distance(hb.second.c_str(), "bad") < 0);
+
+    // Families of variants around distinct bases, plus an item without TLSH
+    FuzzyHashIndex index;
+    std::vector<std::pair<std::string, std::string>> digests;
+    for (uint32_t family = 0; family < 12; ++family) {
+        const std::string root = make_text(100 + family, 3000 + family * 500);
+        for (uint32_t v = 0; v < 5; ++v) {
+            auto h = hashes(v == 0 ? root : mutate(root, family * 10 + v, 2 + v));
+            index.add("f" + std::to_string(family) + "v" + std::to_string(v), h.first, h.second);
+            digests.push_back(h);
+        }
+    }
+    char* short_ss = nullptr;
+    int short_ret = ssdeep_hash_data("short", 5, &short_ss);
+    assert(short_ret == 0);
+    index.add("short", short_ss, "");
+    digests.emplace_back(short_ss, "");
+    std::free(short_ss);
+    assert(index.size() == digests.size());
+
+    FuzzyHashIndex::Stats stats = index.get_stats();
+    assert(stats.ssdeep_items == digests.size() && stats.tlsh_items == digests.size() - 1);
+    assert(stats.distinct_grams > 0);
+
+    // Pairs equal a brute-force scan
+    std::set<std::tuple<uint32_t, uint32_t, int>> expect_ss, expect_tlsh;
+    for (uint32_t i = 0; i < digests.size(); ++i) {
+        for (uint32_t j = i + 1; j < digests.size(); ++j) {
+            int s = ssdeep_compare(digests[i].first.c_str(), digests[j].first.c_str());
+            if (s >= 40) expect_ss.insert({i, j, s});
+            if (digests[i].second.empty() || digests[j].second.empty()) continue;
+            int d = tlsh_distance(digests[i].second.c_str(), digests[j].second.c_str());
+            if (d <= 60) expect_tlsh.insert({i, j, d});
+        }
+    }
+    std::set<std::tuple<uint32_t, uint32_t, int>> got_ss, got_tlsh;
+    for (const auto& p : index.ssdeep_pairs(40, 3)) got_ss.insert({p.a, p.b, p.score});
+    for (const auto& p : index.tlsh_pairs(60, 3)) got_tlsh.insert({p.a, p.b, p.score});
+    assert(got_ss == expect_ss);
+    assert(got_tlsh == expect_tlsh);
+    assert(!got_ss.empty() && !got_tlsh.empty());
+
+    // Top-k queries equal brute force, best first
+    const std::string probe_text = mutate(make_text(105, 5500), 77, 3);
+    auto probe = hashes(probe_text);
+    std::vector<std::pair<int, uint32_t>> brute;
+    for (uint32_t i = 0; i < digests.size(); ++i) {
+        if (digests[i].second.empty()) continue;
+        int d = tlsh_distance(probe.second.c_str(), digests[i].second.c_str());
+        if (d <= 100) brute.push_back({d, i});
+    }
+    std::sort(brute.begin(), brute.end());
+    auto top = index.query_tlsh(probe.second, 100, 3);
+    assert(top.size() == std::min<size_t>(3, brute.size()));
+    for (size_t i = 0; i < top.size(); ++i) {
+        assert(top[i].score == brute[i].first);
+    }
+    assert(index.get_key(top[0].id).rfind("f5v", 0) == 0);
+
+    auto ss_top = index.query_ssdeep(probe.first, 1, 5);
+    assert(!ss_top.empty());
+    assert(index.get_key(ss_top[0].id).rfind("f5v", 0) == 0);
+    for (size_t i = 1; i < ss_top.size(); ++i) assert(ss_top[i - 1].score >= ss_top[i].score);
+
+    // Clusters follow the families
+    auto clusters = FuzzyHashIndex::cluster(index.tlsh_pairs(60), index.size());
+    assert(!clusters.empty());
+    for (const auto& group : clusters) {
+        assert(group.size() >= 2);
+        for (auto id : group) {
+            assert(index.get_key(id).substr(0, 3) == index.get_key(group[0]).substr(0, 3));
+        }
+    }
+    assert(index.get_stats().comparisons > 0);
+
+    // Save / load keeps items and answers
+    auto path = (std::filesystem::temp_directory_path() / "ds_fuzzy_index.fhi").string();
+    bool saved = index.save(path);
+    assert(saved);
+    FuzzyHashIndex loaded;
+    bool loaded_ok = loaded.load(path);
+    assert(loaded_ok);
+    assert(loaded.size() == index.size());
+    assert(loaded.get_key(7) == index.get_key(7) && loaded.get_tlsh(7) == index.get_tlsh(7));
+    auto again = loaded.query_tlsh(probe.second, 100, 3);
+    assert(again.size() == top.size() && again[0].id == top[0].id);
+    std::filesystem::remove(path);
+    bool reloaded = loaded.load(path);
+    assert(!reloaded);
+
+    index.clear();
+    assert(index.size() == 0 && index.query_tlsh(probe.second).empty());
+
+    printf("All fuzzy index tests passed\n");
+    return 0;
+}
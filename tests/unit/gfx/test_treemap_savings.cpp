@@ -0,0 +1,64 @@
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "core/gfx/treemap.h"
+
+static FileEntry file(const std::string& path, uint64_t size, int permille = -1) {
+    FileEntry e;
+    e.fullPath = path;
+    e.sizeLogical = size;
+    if (permille >= 0) e.compressedPermille = static_cast<uint16_t>(permille);
+    return e;
+}
+
+int main() {
+    // Reclaimable bytes of one file, exact for sizes that overflow size*permille
+    assert(TreemapLayout::reclaimableBytes(file("/a/x", 1000)) == 0);
+    assert(TreemapLayout::reclaimableBytes(file("/a/x", 1000, 250)) == 750);
+    assert(TreemapLayout::reclaimableBytes(file("/a/x", 1001, 0)) == 1001);
+    assert(TreemapLayout::reclaimableBytes(file("/a/x", 1000, 1000)) == 0);
+    assert(TreemapLayout::reclaimableBytes(file("/a/x", 1000, 1200)) == 0);
+    const uint64_t huge = UINT64_MAX / 2;
+    assert(TreemapLayout::reclaimableBytes(file("/a/x", huge, 500)) == huge / 2);
+
+    std::vector<FileEntry> files = {
+        file("/logs/a.log", 4000, 100),      // 3600 reclaimable
+        file("/logs/b.log", 1000, 200),      //  800
+        file("/logs/c.log", 9000),           // Not estimated: left out
+        file("/media/v.mp4", 100000, 1000),  // Incompressible
+        file("/src/main.c", 5000, 300),      // 3500
+        file("/src/util.c", 1000, 600),      //  400
+        file("C:\\data\\db.bin", 2000, 0),   // 2000, Windows separators
+        file("top.txt", 800, 500),           //  400, no directory
+        file("/tmp/t", 400, 0),              //  400
+    };
+    FileEntry dir = file("/logs", 100000, 0);
+    dir.attributes.directory = true;         // Directories are not files to compress
+    files.push_back(dir);
+
+    auto ranked = TreemapLayout::rankDirectoriesBySavings(files);
+    assert(ranked.size() == 6);
+    assert(ranked[0].path == "/logs" && ranked[0].reclaimable == 4400);
+    assert(ranked[0].files == 2 && ranked[0].totalSize == 5000);
+    assert(std::fabs(ranked[0].ratio - 0.12) < 1e-9);
+    assert(ranked[1].path == "/src" && ranked[1].reclaimable == 3900 && ranked[1].files == 2);
+    assert(ranked[2].path == "C:\\data" && ranked[2].reclaimable == 2000 && ranked[2].ratio == 0.0);
+    // Equal savings fall back to path order
+    assert(ranked[3].path == "" && ranked[3].reclaimable == 400);
+    assert(ranked[4].path == "/tmp" && ranked[4].reclaimable == 400);
+    assert(ranked[5].path == "/media" && ranked[5].reclaimable == 0 && ranked[5].ratio == 1.0);
+    for (size_t i = 1; i < ranked.size(); i++) {
+        assert(ranked[i - 1].reclaimable >= ranked[i].reclaimable);
+    }
+
+    auto top = TreemapLayout::rankDirectoriesBySavings(files, 2);
+    assert(top.size() == 2 && top[0].path == "/logs" && top[1].path == "/src");
+
+    assert(TreemapLayout::rankDirectoriesBySavings({}).empty());
+    assert(TreemapLayout::rankDirectoriesBySavings({file("/a/b", 10)}).empty());
+
+    std::printf("Treemap savings ranking test passed\n");
+    return 0;
+}
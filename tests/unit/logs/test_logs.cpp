@@ -1,9 +1,18 @@
 #include "libs/logs/logs.h"
+#include "libs/logs/parsers.h"
+#include "libs/logs/arena.h"
+#include "libs/logs/store.h"
+#include "libs/logs/follow.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
 
 // Create test log data
 static int create_test_logs(const char* log_path) {
@@ -294,6 +303,635 @@ int test_format_detection() {
     return 0;
 }
 
+static int slice_equals(const log_slice_t* slice, const char* str) {
+    if (!slice->ptr || !str) return !slice->ptr && !str;
+    return slice->length == strlen(str) && memcmp(slice->ptr, str, slice->length) == 0;
+}
+
+int test_zero_copy_parsing() {
+    printf("Testing zero-copy log parsing...\n");
+
+    // Lines of every length around the scanner's 64-byte blocks, empty
+    // lines, and a last line without a newline
+    size_t capacity = 1 << 20, size = 0;
+    char* text = (char*)malloc(capacity);
+    if (!text) return 1;
+    size_t lines = 0;
+    for (int n = 0; n < 300; n++) {
+        size += (size_t)snprintf(text + size, capacity - size, "Oct 18 09:00:00 host%d proc%d[%d]: ", n % 7, n % 5, n);
+        for (int k = 0; k < n % 150; k++) text[size++] = (char)('a' + k % 26);
+        text[size++] = '\n';
+        lines++;
+        if (n % 17 == 0) text[size++] = '\n';
+    }
+    size += (size_t)snprintf(text + size, capacity - size, "Oct 18 09:00:01 last tail[9]: no newline");
+    lines++;
+
+    // Line scanner against memchr
+    log_line_scanner_t scanner;
+    log_line_scanner_init(&scanner, text, size);
+    log_slice_t line;
+    const char* p = text;
+    const char* end = text + size;
+    while (log_line_scanner_next(&scanner, &line)) {
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+        const size_t expected = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        if (line.ptr != p || line.length != expected) {
+            printf("Line scanner mismatch at offset %ld\n", (long)(p - text));
+            free(text);
+            return 1;
+        }
+        p = nl ? nl + 1 : end;
+    }
+    if (p != end) {
+        printf("Line scanner stopped early\n");
+        free(text);
+        return 1;
+    }
+
+    // Views borrow the text and agree with the owned result
+    log_view_t view;
+    log_result_t result;
+    if (log_view_parse_data(text, size, LOG_FORMAT_SYSLOG, &view) != 0 ||
+        log_parse_data(text, size, LOG_FORMAT_SYSLOG, &result) != 0) {
+        printf("Failed to parse log data\n");
+        free(text);
+        return 1;
+    }
+    int ok = view.count == lines && result.count == lines;
+    for (size_t i = 0; ok && i < view.count; i++) {
+        const log_entry_view_t* v = &view.entries[i];
+        const log_entry_t* e = &result.entries[i];
+        ok = v->message.ptr >= text && v->message.ptr + v->message.length <= text + size &&
+             slice_equals(&v->message, e->message) && slice_equals(&v->host, e->host) &&
+             slice_equals(&v->process, e->process) && slice_equals(&v->source, e->source) &&
+             v->pid == e->pid;
+    }
+    if (ok) {
+        const log_entry_view_t* last = &view.entries[view.count - 1];
+        ok = slice_equals(&last->message, "no newline") && slice_equals(&last->process, "tail") && last->pid == 9;
+    }
+    log_view_free(&view);
+    log_result_free(&result);
+    if (!ok) {
+        printf("View entries differ from parsed entries\n");
+        free(text);
+        return 1;
+    }
+
+    // Memory-mapped file
+    const char* test_log = "/tmp/test_zero_copy.log";
+    FILE* file = fopen(test_log, "w");
+    if (!file || fwrite(text, 1, size, file) != size) {
+        if (file) fclose(file);
+        free(text);
+        return 1;
+    }
+    fclose(file);
+    free(text);
+    ok = log_view_parse_file(test_log, LOG_FORMAT_SYSLOG, &view) == 0 && view.count == lines;
+    log_view_free(&view);
+    cleanup_test_environment(test_log);
+    if (!ok) {
+        printf("Failed to parse mapped log file\n");
+        return 1;
+    }
+
+    // Arena: aligned blocks, strings packed, oversized requests
+    log_arena_t arena;
+    log_arena_init(&arena);
+    for (int i = 0; i < 100000 && ok; i++) {
+        char* str = log_arena_strndup(&arena, "abc", (size_t)(i % 4));
+        void* block = log_arena_alloc(&arena, (size_t)(i % 5 == 0 ? LOG_ARENA_BLOCK_SIZE : 24));
+        ok = str && block && strlen(str) == (size_t)(i % 4) && ((uintptr_t)block % 16) == 0;
+        if (ok && i % 5 == 0) memset(block, 0xab, LOG_ARENA_BLOCK_SIZE);
+        if (i % 5000 == 4999) log_arena_free(&arena);
+    }
+    log_arena_free(&arena);
+    if (!ok) {
+        printf("Arena allocation failed\n");
+        return 1;
+    }
+
+    printf("Zero-copy log parsing test passed!\n");
+    return 0;
+}
+
+static int same_entry(const log_entry_t* a, const log_entry_t* b) {
+    const char* fa[] = {a->source, a->level, a->message, a->host, a->process};
+    const char* fb[] = {b->source, b->level, b->message, b->host, b->process};
+    for (int k = 0; k < 5; k++) {
+        if (!fa[k] || !fb[k] ? fa[k] != fb[k] : strcmp(fa[k], fb[k]) != 0) return 0;
+    }
+    return a->timestamp == b->timestamp && a->pid == b->pid;
+}
+
+static int write_file(const char* path, const char* data, size_t size) {
+    FILE* file = fopen(path, "w");
+    if (!file) return -1;
+    const int ok = fwrite(data, 1, size, file) == size;
+    fclose(file);
+    return ok ? 0 : -1;
+}
+
+int test_parallel_parsing() {
+    printf("Testing parallel log parsing...\n");
+
+    // About 6 MB of syslog over several hours, lines of varying length
+    size_t capacity = 8 << 20, size = 0;
+    char* text = (char*)malloc(capacity);
+    if (!text) return 1;
+    for (int n = 0; size < (6u << 20); n++) {
+        size += (size_t)snprintf(text + size, capacity - size, "Oct %2d %02d:%02d:%02d host%d proc%d[%d]: event %d %.*s\n",
+                                 1 + n / 40000, (n / 3600) % 24, (n / 60) % 60, n % 60, n % 7, n % 5, n, n,
+                                 n % 90, "................................................................................................");
+    }
+
+    // Chunked parse gives the serial entries, for CSV too (one header)
+    const log_format_t formats[] = {LOG_FORMAT_SYSLOG, LOG_FORMAT_CSV};
+    for (int f = 0; f < 2; f++) {
+        log_result_t serial, parallel;
+        if (log_parse_data(text, size, formats[f], &serial) != 0 ||
+            log_parse_data_parallel(text, size, formats[f], 4, &parallel) != 0) {
+            printf("Failed to parse log data\n");
+            free(text);
+            return 1;
+        }
+        int ok = serial.count == parallel.count && serial.count > 50000;
+        for (size_t i = 0; ok && i < serial.count; i++) {
+            // Timestamps of CSV entries are the parse time
+            if (formats[f] == LOG_FORMAT_CSV) parallel.entries[i].timestamp = serial.entries[i].timestamp;
+            ok = same_entry(&serial.entries[i], &parallel.entries[i]);
+        }
+        log_result_free(&serial);
+        log_result_free(&parallel);
+        if (!ok) {
+            printf("Parallel parse differs from serial parse (format %d)\n", (int)formats[f]);
+            free(text);
+            return 1;
+        }
+    }
+
+    // Syslog and Apache timestamps
+    log_result_t stamped;
+    const char* apache = "10.0.0.1 - - [10/Oct/2000:13:55:36 -0700] \"GET / HTTP/1.0\" 200 2326\n";
+    if (log_parse_data(apache, strlen(apache), LOG_FORMAT_APACHE, &stamped) != 0 || stamped.count != 1 ||
+        stamped.entries[0].timestamp != 971211336) {
+        printf("Apache timestamp not parsed\n");
+        free(text);
+        return 1;
+    }
+    log_result_free(&stamped);
+    const char* syslog = "Jan  2 03:04:05 host proc[1]: message\n";
+    struct tm tm_now;
+    time_t now = time(NULL);
+    localtime_r(&now, &tm_now);
+    struct tm tm_expected;
+    memset(&tm_expected, 0, sizeof(tm_expected));
+    tm_expected.tm_year = tm_now.tm_year;
+    tm_expected.tm_mday = 2;
+    tm_expected.tm_hour = 3;
+    tm_expected.tm_min = 4;
+    tm_expected.tm_sec = 5;
+    tm_expected.tm_isdst = -1;
+    const time_t expected = mktime(&tm_expected);
+    if (log_parse_data(syslog, strlen(syslog), LOG_FORMAT_SYSLOG, &stamped) != 0 || stamped.count != 1 ||
+        stamped.entries[0].timestamp != expected) {
+        printf("Syslog timestamp not parsed\n");
+        free(text);
+        return 1;
+    }
+    log_result_free(&stamped);
+
+    // Merging files: the second file is out of order and interleaves with the first
+    const char* paths[] = {"/tmp/test_merge_a.log", "/tmp/test_merge_b.log"};
+    const char* second = "Oct  1 00:00:30 b p[1]: b1\nOct  1 00:00:00 b p[2]: b0\nOct  1 00:00:02 b p[3]: b2\n";
+    if (write_file(paths[0], text, size) != 0 || write_file(paths[1], second, strlen(second)) != 0) {
+        free(text);
+        return 1;
+    }
+    free(text);
+    log_result_t merged;
+    int ok = log_parse_files(paths, 2, LOG_FORMAT_SYSLOG, 4, &merged) == 0 && merged.count > 3;
+    size_t from_b = 0;
+    for (size_t i = 0; ok && i < merged.count; i++) {
+        const int is_b = strcmp(merged.entries[i].host, "b") == 0;
+        from_b += is_b;
+        if (i > 0) {
+            const log_entry_t* prev = &merged.entries[i - 1];
+            // Ties go to the first file
+            ok = prev->timestamp < merged.entries[i].timestamp ||
+                 (prev->timestamp == merged.entries[i].timestamp && (strcmp(prev->host, "b") != 0 || is_b));
+        }
+    }
+    ok = ok && from_b == 3;
+    log_result_free(&merged);
+    unlink(paths[0]);
+    unlink(paths[1]);
+    if (!ok) {
+        printf("Merged files are not in time order\n");
+        return 1;
+    }
+
+    // Statistics: parallel partials reduce to the serial values
+    log_result_t mixed;
+    log_result_init(&mixed);
+    const char* levels[] = {"ERROR", "warning", "Info", "debug", "notice", "FATAL"};
+    for (int i = 0; i < 100000; i++) {
+        char source[16];
+        // Sources appear in an order the ranges do not share
+        snprintf(source, sizeof(source), "src%d", (i * 7919) % 1000 < 30 ? i % 15 : i % 3);
+        log_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.timestamp = 1000000 + (i * 31) % 5000;
+        entry.source = source;
+        entry.level = (char*)levels[i % 6];
+        ok = ok && log_result_add_entry(&mixed, &entry) == 0;
+    }
+    log_statistics_t one, many;
+    ok = ok && log_get_statistics_parallel(&mixed, 1, &one) == 0 && log_get_statistics_parallel(&mixed, 7, &many) == 0;
+    ok = ok && one.error_count == many.error_count && one.warning_count == many.warning_count &&
+         one.info_count == many.info_count && one.debug_count == many.debug_count &&
+         one.first_timestamp == many.first_timestamp && one.last_timestamp == many.last_timestamp &&
+         one.source_count == many.source_count && one.error_count == 100000 / 3;
+    for (size_t j = 0; ok && j < one.source_count; j++) {
+        ok = strcmp(one.top_sources[j], many.top_sources[j]) == 0;
+    }
+    log_statistics_free(&one);
+    log_statistics_free(&many);
+    log_result_free(&mixed);
+    if (!ok) {
+        printf("Parallel statistics differ\n");
+        return 1;
+    }
+
+    printf("Parallel log parsing test passed!\n");
+    return 0;
+}
+
+// Filtered entries in time order, as the store returns them
+static void sort_filtered(log_result_t* result) {
+    std::stable_sort(result->entries, result->entries + result->count,
+                     [](const log_entry_t& a, const log_entry_t& b) { return a.timestamp < b.timestamp; });
+}
+
+static long count_keyword(const log_result_t* result, const char* keyword) {
+    long count = 0;
+    for (size_t i = 0; i < result->count; i++) {
+        const char* message = result->entries[i].message;
+        for (const char* p = message; p && (p = strstr(p, keyword)) != NULL; p++) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int test_log_store() {
+    printf("Testing columnar log store...\n");
+    
+    // Shuffled timestamps, a few hosts and processes, some missing fields
+    const char* levels[] = {"ERROR", "warning", "Info", "DEBUG", "notice", NULL};
+    const char* hosts[] = {"web01", "web02", "db01", NULL};
+    const char* processes[] = {"sshd", "apache2", "cron", "kernel"};
+    const char* words[] = {"connection", "refused", "timeout", "user", "login", "failed", "disk", "Full", "eth0", "up"};
+    log_result_t result;
+    log_result_init(&result);
+    uint32_t seed = 12345;
+    for (int i = 0; i < 5000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        char message[128];
+        snprintf(message, sizeof(message), "%s %s: %s id=%u", words[(seed >> 8) % 10], words[(seed >> 12) % 10],
+                 words[(seed >> 16) % 10], (seed >> 20) % 97);
+        log_entry_t entry;
+        entry.timestamp = 1700000000 + (time_t)((seed >> 4) % 3000);
+        entry.source = (char*)((seed >> 3) % 5 == 0 ? NULL : "syslog");
+        entry.level = (char*)levels[(seed >> 10) % 6];
+        entry.message = (char*)((seed >> 6) % 50 == 0 ? NULL : message);
+        entry.host = (char*)hosts[(seed >> 14) % 4];
+        entry.process = (char*)processes[(seed >> 18) % 4];
+        entry.pid = (int)(seed % 1000);
+        if (log_result_add_entry(&result, &entry) != 0) {
+            log_result_free(&result);
+            return 1;
+        }
+    }
+    
+    log_store_t* store = log_store_create(&result);
+    if (!store || log_store_count(store) != result.count) {
+        printf("Failed to build log store\n");
+        log_store_free(store);
+        log_result_free(&result);
+        return 1;
+    }
+    
+    // Every query must keep exactly what log_filter_entries keeps
+    struct {
+        time_t start, end;
+        const char* process;
+        const char* host;
+        const char* level;
+        const char* keyword;
+        int errors, warnings;
+    } queries[] = {
+        {0, 0, NULL, NULL, NULL, NULL, 1, 1},
+        {1700000500, 1700001000, NULL, NULL, NULL, NULL, 1, 1},
+        {0, 0, "APACHE", "web", NULL, NULL, 1, 1},
+        {0, 0, NULL, NULL, NULL, NULL, 0, 1},
+        {1700001000, 0, NULL, NULL, "o", NULL, 1, 0},
+        {0, 0, NULL, NULL, NULL, "refused", 1, 1},
+        {0, 0, NULL, NULL, NULL, "ed tim", 1, 1},
+        {0, 0, NULL, NULL, NULL, "IN ", 1, 1},
+        {0, 1700002000, "ssh", NULL, NULL, "connection refused: disk", 1, 1},
+        {0, 0, NULL, NULL, NULL, "id=4", 1, 1},
+        {0, 0, NULL, NULL, NULL, ": ", 1, 1},
+        {0, 0, NULL, NULL, NULL, "nomatch", 1, 1},
+        {0, 0, "nope", NULL, NULL, NULL, 1, 1},
+        {1800000000, 0, NULL, NULL, NULL, NULL, 1, 1},
+    };
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+        log_filter_t filter;
+        log_filter_init(&filter);
+        filter.start_time = queries[q].start;
+        filter.end_time = queries[q].end;
+        filter.process_filter = queries[q].process ? strdup(queries[q].process) : NULL;
+        filter.host_filter = queries[q].host ? strdup(queries[q].host) : NULL;
+        filter.level_filter = queries[q].level ? strdup(queries[q].level) : NULL;
+        filter.keyword_filter = queries[q].keyword ? strdup(queries[q].keyword) : NULL;
+        filter.include_errors = queries[q].errors;
+        filter.include_warnings = queries[q].warnings;
+        
+        log_result_t expected, actual;
+        int ok = log_filter_entries(&result, &filter, &expected) == 0;
+        ok = ok && log_store_query(store, &filter, &actual) == 0;
+        log_filter_free(&filter);
+        if (ok) {
+            sort_filtered(&expected);
+            ok = expected.count == actual.count;
+            for (size_t i = 0; ok && i < actual.count; i++) {
+                ok = same_entry(&expected.entries[i], &actual.entries[i]);
+            }
+            printf("  Query %lu: %lu entries\n", (unsigned long)q, (unsigned long)actual.count);
+            log_result_free(&actual);
+        }
+        log_result_free(&expected);
+        if (!ok) {
+            printf("Log store query %lu differs from log_filter_entries\n", (unsigned long)q);
+            log_store_free(store);
+            log_result_free(&result);
+            return 1;
+        }
+    }
+    
+    // Rows map back to the original entries
+    for (size_t row = 0; row < log_store_count(store); row += 97) {
+        log_entry_t entry;
+        if (log_store_get_entry(store, row, &entry) != 0 ||
+            !same_entry(&entry, &result.entries[log_store_source_index(store, row)])) {
+            printf("Log store row %lu does not match its entry\n", (unsigned long)row);
+            log_store_free(store);
+            log_result_free(&result);
+            return 1;
+        }
+    }
+    
+    // Case-sensitive search only counts the exact spelling
+    const long full = log_store_search(store, "Full", 1);
+    const long any_case = log_store_search(store, "full", 0);
+    if (full != count_keyword(&result, "Full") || any_case != full + count_keyword(&result, "full") ||
+        log_store_search(store, "full", 1) != count_keyword(&result, "full") ||
+        log_store_search(store, "d=1", 1) != count_keyword(&result, "d=1")) {
+        printf("Log store search counts are wrong\n");
+        log_store_free(store);
+        log_result_free(&result);
+        return 1;
+    }
+    
+    log_store_free(store);
+    log_result_free(&result);
+    
+    printf("Log store test passed!\n");
+    return 0;
+}
+
+int test_json_parsing() {
+    printf("Testing JSON-lines parsing...\n");
+    
+    const char* data =
+        "{\"timestamp\":\"2023-11-14T22:13:20Z\",\"level\":\"error\",\"msg\":\"disk \\\"sda\\\" full\\\\n\",\"host\":\"web01\",\"pid\":42}\n"
+        "{\"severity\":\"WARNING\",\"timestamp\":\"2023-11-14T23:13:20.5+01:00\",\"jsonPayload\":{\"other\":{\"x\":[1,{\"y\":\"}\"}]},"
+        "\"message\":\"quota \\u00e9 \\ud83d\\ude00\"},\"resource\":{\"labels\":{\"instance_id\":\"i-123\"}}}\n"
+        "{\"level\":50,\"time\":1700000000123,\"pid\":7,\"hostname\":\"h\",\"msg\":\"boom\"}\n"
+        "plain text line\n"
+        "{\"message\": \"unterminated\n"
+        "{ \"msg\" : \"second\" , \"message\" : \"first\" , \"ts\" : null }\r\n";
+    
+    log_result_t result;
+    if (log_parse_json_data(data, strlen(data), NULL, 1, &result) != 0 || result.count != 6) {
+        printf("Failed to parse JSON lines\n");
+        log_result_free(&result);
+        return 1;
+    }
+    const log_entry_t* e = result.entries;
+    int ok = e[0].timestamp == 1700000000 && strcmp(e[0].level, "error") == 0 &&
+             strcmp(e[0].message, "disk \"sda\" full\\n") == 0 && strcmp(e[0].host, "web01") == 0 && e[0].pid == 42;
+    ok = ok && e[1].timestamp == 1700000000 && strcmp(e[1].level, "WARNING") == 0 &&
+         strcmp(e[1].message, "quota \xc3\xa9 \xf0\x9f\x98\x80") == 0 && strcmp(e[1].host, "i-123") == 0;
+    ok = ok && e[2].timestamp == 1700000000 && strcmp(e[2].level, "error") == 0 && e[2].pid == 7 &&
+         strcmp(e[2].host, "h") == 0 && strcmp(e[2].message, "boom") == 0;
+    ok = ok && strcmp(e[3].message, "plain text line") == 0 && strcmp(e[3].level, "info") == 0;
+    ok = ok && strcmp(e[4].message, "{\"message\": \"unterminated") == 0;
+    ok = ok && strcmp(e[5].message, "first") == 0 && strcmp(e[5].source, "json") == 0;
+    log_result_free(&result);
+    if (!ok) {
+        printf("JSON fields were not extracted correctly\n");
+        return 1;
+    }
+    
+    // Custom schema
+    log_json_mapping_t mapping;
+    memset(&mapping, 0, sizeof(mapping));
+    mapping.message = "event.text";
+    mapping.level = "sev, event.sev";
+    mapping.process = "svc";
+    const char* custom = "{\"event\":{\"sev\":\"debug\",\"text\":\"custom\"},\"svc\":\"api\",\"message\":\"ignored\"}\n";
+    if (log_parse_json_data(custom, strlen(custom), &mapping, 1, &result) != 0 || result.count != 1 ||
+        strcmp(result.entries[0].message, "custom") != 0 || strcmp(result.entries[0].level, "debug") != 0 ||
+        strcmp(result.entries[0].process, "api") != 0 || strcmp(result.entries[0].host, "localhost") != 0) {
+        printf("Custom JSON mapping failed\n");
+        log_result_free(&result);
+        return 1;
+    }
+    log_result_free(&result);
+    
+    // Views keep the escaped text and flag it
+    log_view_t view;
+    if (log_view_parse_data(data, strlen(data), LOG_FORMAT_JSON, &view) != 0 || view.count != 6 ||
+        !(view.entries[0].escaped & LOG_ESCAPED_MESSAGE) || (view.entries[2].escaped & LOG_ESCAPED_MESSAGE) ||
+        !slice_equals(&view.entries[0].message, "disk \\\"sda\\\" full\\\\n")) {
+        printf("JSON view parsing failed\n");
+        log_view_free(&view);
+        return 1;
+    }
+    log_view_free(&view);
+    
+    // Parallel chunks give the same entries as a serial parse
+    std::string big;
+    char line[256];
+    for (int i = 0; i < 40000; i++) {
+        snprintf(line, sizeof(line),
+                 "{\"ts\":%d,\"level\":\"%s\",\"message\":\"request %d took \\\"%dms\\\"\",\"host\":\"node%d\",\"pid\":%d}\n",
+                 1700000000 + i, i % 7 == 0 ? "warn" : "info", i, i % 100, i % 5, 1000 + i % 13);
+        big += line;
+    }
+    log_result_t serial, parallel;
+    ok = log_parse_json_data(big.data(), big.size(), NULL, 1, &serial) == 0 &&
+         log_parse_json_data(big.data(), big.size(), NULL, 4, &parallel) == 0 &&
+         serial.count == 40000 && parallel.count == serial.count;
+    for (size_t i = 0; ok && i < serial.count; i++) {
+        ok = same_entry(&serial.entries[i], &parallel.entries[i]);
+    }
+    ok = ok && serial.entries[123].timestamp == 1700000123 && strcmp(serial.entries[123].message, "request 123 took \"23ms\"") == 0;
+    log_result_free(&serial);
+    log_result_free(&parallel);
+    if (!ok) {
+        printf("Parallel JSON parsing differs from serial parsing\n");
+        return 1;
+    }
+    
+    printf("JSON-lines parsing test passed!\n");
+    return 0;
+}
+
+static int append_file(const char* path, const char* text) {
+    FILE* file = fopen(path, "a");
+    if (!file) return -1;
+    const int ok = fputs(text, file) >= 0;
+    fclose(file);
+    return ok ? 0 : -1;
+}
+
+static void collect_message(const log_entry_t* entry, void* user_data) {
+    ((std::vector<std::string>*)user_data)->push_back(entry->message ? entry->message : "");
+}
+
+static double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int test_log_follow() {
+    printf("Testing log follow mode...\n");
+    
+    const char* path = "/tmp/test_follow.log";
+    const char* rotated = "/tmp/test_follow.log.1";
+    unlink(path);
+    unlink(rotated);
+    if (write_file(path, "", 0) != 0 ||
+        append_file(path, "Oct 18 09:00:00 host sshd[1]: first\nOct 18 09:00:01 host cron[2]: second\n") != 0) {
+        printf("Failed to create followed log\n");
+        return 1;
+    }
+    
+    log_filter_t filter;
+    log_filter_init(&filter);
+    filter.process_filter = strdup("sshd");
+    std::vector<std::string> seen;
+    log_follow_options_t options;
+    log_follow_options_init(&options);
+    options.filter = &filter;
+    options.callback = collect_message;
+    options.user_data = &seen;
+    options.from_start = 1;
+    options.poll_interval_ms = 50;
+    log_follower_t* follower = log_follower_open(path, &options);
+    
+    // Existing lines, then a line written in two parts
+    int ok = follower && log_follower_poll(follower, 0) == 2 && seen.size() == 1 && seen[0] == "first";
+    ok = ok && append_file(path, "Oct 18 09:00:02 host sshd[3]: thi") == 0 && log_follower_poll(follower, 0) == 0;
+    ok = ok && append_file(path, "rd\n") == 0 && log_follower_poll(follower, 0) == 1 && seen.back() == "third";
+    
+    // Rotation: the rest of the old file, then the new one from its start
+    ok = ok && rename(path, rotated) == 0 && append_file(rotated, "Oct 18 09:00:03 host sshd[4]: fourth\n") == 0;
+    ok = ok && append_file(path, "Oct 18 09:00:04 host sshd[5]: fifth, with a longer message\n") == 0;
+    ok = ok && log_follower_poll(follower, 0) == 2 && seen.size() == 4 && seen[2] == "fourth" &&
+         seen[3] == "fifth, with a longer message";
+    
+    // Truncation starts over
+    ok = ok && write_file(path, "Oct 18 09:00:05 host sshd[6]: sixth\n", 36) == 0;
+    ok = ok && log_follower_poll(follower, 0) == 1 && seen.back() == "sixth";
+    
+    // Nothing new: the poll waits out its timeout
+    double start = monotonic_seconds();
+    ok = ok && log_follower_poll(follower, 150) == 0 && monotonic_seconds() - start >= 0.14;
+    
+    // A line written while waiting ends the wait
+    options.poll_interval_ms = 5000;
+    log_follower_t* waiting = ok ? log_follower_open(path, &options) : NULL;
+    ok = ok && waiting && log_follower_poll(waiting, 0) == 1;
+    pid_t child = ok ? fork() : -1;
+    if (child == 0) {
+        usleep(100000);
+        _exit(append_file(path, "Oct 18 09:00:06 host sshd[7]: seventh\n") == 0 ? 0 : 1);
+    }
+    start = monotonic_seconds();
+    ok = ok && child > 0 && log_follower_poll(waiting, 10000) == 1 && monotonic_seconds() - start < 2.0 &&
+         seen.back() == "seventh";
+    if (child > 0) {
+        waitpid(child, NULL, 0);
+    }
+    log_follower_close(waiting);
+    
+    // Statistics count every entry, filtered or not
+    log_statistics_t stats;
+    ok = ok && log_follower_get_statistics(follower, &stats) == 0;
+    if (ok) {
+        ok = stats.total_entries == 6 && stats.info_count == 6 && stats.source_count == 1 &&
+             strcmp(stats.top_sources[0], "syslog") == 0;
+        log_statistics_free(&stats);
+    }
+    log_follower_close(follower);
+    
+    // Following from the end skips what is there
+    options.from_start = 0;
+    follower = ok ? log_follower_open(path, &options) : NULL;
+    ok = ok && follower && log_follower_poll(follower, 0) == 0 &&
+         append_file(path, "Oct 18 09:00:07 host sshd[8]: eighth\n") == 0 && log_follower_poll(follower, 0) == 1 &&
+         seen.back() == "eighth";
+    log_follower_close(follower);
+    
+    log_filter_free(&filter);
+    unlink(path);
+    unlink(rotated);
+    if (!ok) {
+        printf("Log follow mode failed\n");
+        return 1;
+    }
+    
+    // Incremental statistics agree with a full computation
+    const char* data = "Oct 18 09:00:00 a sshd[1]: x\nOct 18 09:00:01 b kernel: y\n";
+    log_result_t result;
+    log_statistics_t full, incremental;
+    log_statistics_init(&incremental);
+    ok = log_parse_data(data, strlen(data), LOG_FORMAT_SYSLOG, &result) == 0 && log_get_statistics(&result, &full) == 0;
+    for (size_t i = 0; ok && i < result.count; i++) {
+        ok = log_statistics_add_entry(&incremental, &result.entries[i]) == 0;
+    }
+    ok = ok && full.total_entries == incremental.total_entries && full.info_count == incremental.info_count &&
+         full.first_timestamp == incremental.first_timestamp && full.last_timestamp == incremental.last_timestamp &&
+         full.source_count == incremental.source_count;
+    log_statistics_free(&full);
+    log_statistics_free(&incremental);
+    log_result_free(&result);
+    if (!ok) {
+        printf("Incremental statistics differ\n");
+        return 1;
+    }
+    
+    printf("Log follow mode test passed!\n");
+    return 0;
+}
+
 int main() {
     printf("Running system logs analysis tests...\n");
     
@@ -327,6 +965,31 @@ int main() {
         return result6;
     }
     
+    int result7 = test_zero_copy_parsing();
+    if (result7 != 0) {
+        return result7;
+    }
+    
+    int result8 = test_parallel_parsing();
+    if (result8 != 0) {
+        return result8;
+    }
+    
+    int result9 = test_log_store();
+    if (result9 != 0) {
+        return result9;
+    }
+    
+    int result10 = test_json_parsing();
+    if (result10 != 0) {
+        return result10;
+    }
+    
+    int result11 = test_log_follow();
+    if (result11 != 0) {
+        return result11;
+    }
+    
     printf("All system logs analysis tests passed!\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "libs/lsh/lsh.h"
+
+// Deterministic pseudo-random document content
+static std::string make_content(size_t len, uint32_t seed) {
+    std::string s(len, '\0');
+    uint32_t x = seed;
+    for (size_t i = 0; i < len; ++i) {
+        x = x * 1103515245u + 12345u;
+        s[i] = static_cast<char>(x >> 16);
+    }
+    return s;
+}
+
+static void test_minhash_estimate() {
+    MinHasher hasher(256);
+    std::vector<uint64_t> a, b, c;
+    for (uint64_t i = 0; i < 1000; ++i) a.push_back(i);
+    for (uint64_t i = 200; i < 1200; ++i) b.push_back(i);     // Jaccard = 800/1200
+    for (uint64_t i = 5000; i < 6000; ++i) c.push_back(i);    // Disjoint
+
+    auto sa = hasher.compute(a.data(), a.size());
+    auto sb = hasher.compute(b.data(), b.size());
+    auto sc = hasher.compute(c.data(), c.size());
+
+    double ab = MinHasher::estimate_similarity(sa, sb);
+    double ac = MinHasher::estimate_similarity(sa, sc);
+    std::printf("MinHash estimate: %.3f (expected 0.667), disjoint %.3f\n", ab, ac);
+    assert(ab > 0.55 && ab < 0.78);
+    assert(ac < 0.05);
+    assert(MinHasher::estimate_similarity(sa, sa) == 1.0);
+}
+
+static void test_sketch_edit_stability() {
+    MinHasher hasher(128);
+    ContentSketcher sketcher(hasher);
+
+    std::string base = make_content(512 * 1024, 7);
+    std::string edited = base;
+    edited.insert(100 * 1024, "inserted paragraph that shifts every later byte");
+    std::string other = make_content(512 * 1024, 99);
+
+    auto s1 = sketcher.sketch_data(base.data(), base.size());
+    auto s2 = sketcher.sketch_data(edited.data(), edited.size());
+    auto s3 = sketcher.sketch_data(other.data(), other.size());
+    assert(s1.chunk_count > 1 && s1.bytes_processed == base.size());
+
+    double sim12 = MinHasher::estimate_similarity(s1.signature, s2.signature);
+    double sim13 = MinHasher::estimate_similarity(s1.signature, s3.signature);
+    std::printf("Sketch similarity: edited %.3f, unrelated %.3f\n", sim12, sim13);
+    assert(sim12 > 0.8);
+    assert(sim13 < 0.1);
+}
+
+static void test_index_query_and_persistence() {
+    LshIndex::Parameters params;
+    MinHasher hasher(params.signature_length());
+    ContentSketcher sketcher(hasher);
+    LshIndex index(params);
+
+    std::string base = make_content(256 * 1024, 1);
+    std::string edited = base;
+    edited.replace(50 * 1024, 64, std::string(64, 'x'));
+
+    auto sig_base = sketcher.sketch_data(base.data(), base.size()).signature;
+    auto sig_edit = sketcher.sketch_data(edited.data(), edited.size()).signature;
+    uint32_t base_id = index.insert("base", sig_base);
+    uint32_t edit_id = index.insert("edited", sig_edit);
+    assert(base_id == 0 && edit_id == 1);
+    for (uint32_t i = 0; i < 50; ++i) {
+        std::string other = make_content(64 * 1024, 1000 + i);
+        index.insert("other" + std::to_string(i), sketcher.sketch_data(other.data(), other.size()).signature);
+    }
+    uint32_t bad_id = index.insert("bad", std::vector<uint64_t>(3));
+    assert(bad_id == UINT32_MAX);
+
+    auto matches = index.query(sig_base, 0.5);
+    assert(matches.size() == 2);
+    assert(matches[0].id == 0 && matches[0].similarity == 1.0);
+    assert(index.get_key(matches[1].id) == "edited");
+
+    auto pairs = index.find_similar_pairs(0.5);
+    assert(pairs.size() == 1 && pairs[0].a == 0 && pairs[0].b == 1);
+
+    auto path = (std::filesystem::temp_directory_path() / "ds_test_content.lsh").string();
+    bool saved = index.save(path);
+    assert(saved);
+    LshIndex loaded;
+    bool loaded_ok = loaded.load(path);
+    assert(loaded_ok);
+    assert(loaded.size() == index.size());
+    assert(loaded.get_signature(1) == sig_edit);
+    auto reloaded = loaded.query(sig_edit, 0.5);
+    assert(reloaded.size() == 2 && reloaded[0].id == 1);
+    std::error_code ec; std::filesystem::remove(path, ec);
+
+    double t = LshIndex::threshold_estimate(params.bands, params.rows);
+    assert(t > 0.3 && t < 0.5);
+}
+
+int main() {
+    test_minhash_estimate();
+    test_sketch_edit_stability();
+    test_index_query_and_persistence();
+    std::printf("LSH tests passed!\n");
+    return 0;
+}
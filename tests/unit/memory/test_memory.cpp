@@ -1,4 +1,6 @@
 #include "libs/memory/memory.h"
+#include "libs/memory/analysis.h"
+#include "libs/memory/memstrings.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -315,7 +317,7 @@ int test_connection_extraction() {
     for (size_t i = 0; i < connection_count; i++) {
         memory_connection_free(&connections[i]);
     }
-    free(connectiones);
+    free(connections);
     memory_options_free(&options);
     unlink(dump_path);
     
@@ -385,6 +387,137 @@ int test_string_extraction() {
     return 0;
 }
 
+static void put_utf16(uint8_t* at, const char* text) {
+    for (size_t i = 0; text[i]; i++) {
+        at[2 * i] = (uint8_t)text[i];
+        at[2 * i + 1] = 0;
+    }
+}
+
+static int same_strings(const memory_strings_t* a, const memory_strings_t* b) {
+    if (a->count != b->count) {
+        return 0;
+    }
+    for (size_t i = 0; i < a->count; i++) {
+        if (a->entries[i].address != b->entries[i].address || a->entries[i].length != b->entries[i].length ||
+            a->entries[i].encoding != b->entries[i].encoding || a->entries[i].keyword != b->entries[i].keyword ||
+            strcmp(memory_strings_text(a, i), memory_strings_text(b, i)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int test_string_arena() {
+    printf("\n=== Testing Arena String Extraction ===\n");
+    
+    // ASCII and UTF-16LE strings, some across the 4 KiB read boundaries
+    const size_t size = 5 * 4096;
+    uint8_t* data = (uint8_t*)calloc(size, 1);
+    memcpy(data + 10, "hello world", 11);
+    memcpy(data + 40, "abc", 3);                      // Too short
+    put_utf16(data + 101, "Backdoor.exe");           // Odd address
+    memcpy(data + 4096 - 6, "crossing the boundary", 21);
+    put_utf16(data + 2 * 4096 - 9, "wide KEYLOGGER text");
+    memset(data + 3 * 4096 - 100, 'A', 4096 + 300);  // Longer than a read
+    
+    memory_strings_t direct;
+    memory_strings_init(&direct);
+    int failed = memory_strings_extract_data(data, size, 0, NULL, &direct) != 0;
+    const struct {
+        uint64_t address;
+        const char* text;
+        uint32_t encoding;
+        int32_t keyword;
+    } expected[] = {
+        {10, "hello world", MEMORY_STRING_ASCII, -1},
+        {101, "Backdoor.exe", MEMORY_STRING_UTF16LE, 3},
+        {4096 - 6, "crossing the boundary", MEMORY_STRING_ASCII, -1},
+        {2 * 4096 - 9, "wide KEYLOGGER text", MEMORY_STRING_UTF16LE, 4},
+        {3 * 4096 - 100, NULL, MEMORY_STRING_ASCII, -1},
+    };
+    const size_t expected_count = sizeof(expected) / sizeof(expected[0]);
+    failed |= direct.count != expected_count || direct.suspicious_count != 2;
+    for (size_t i = 0; !failed && i < expected_count; i++) {
+        const memory_string_entry_t* entry = &direct.entries[i];
+        const char* text = memory_strings_text(&direct, i);
+        printf("  0x%08llX %s %s\n", (unsigned long long)entry->address,
+               entry->encoding == MEMORY_STRING_UTF16LE ? "UTF-16LE" : "ASCII   ",
+               entry->length > 40 ? "(long run)" : text);
+        failed |= entry->address != expected[i].address || entry->encoding != expected[i].encoding ||
+                  entry->keyword != expected[i].keyword || strlen(text) != entry->length;
+        if (expected[i].text) {
+            failed |= strcmp(text, expected[i].text) != 0;
+        } else {
+            failed |= entry->length != 4096 + 300;
+        }
+    }
+    if (failed) {
+        printf("Unexpected strings in buffer\n");
+    }
+    
+    // The same strings read from a file 4 KiB at a time
+    const char* raw_path = "/tmp/test_string_arena.raw";
+    FILE* file = fopen(raw_path, "wb");
+    if (file) {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    }
+    memory_strings_options_t options;
+    memory_strings_options_init(&options);
+    options.read_size = 4096;
+    memory_strings_t streamed;
+    if (!failed && (memory_strings_extract_file(raw_path, &options, &streamed) != 0 ||
+                    !same_strings(&direct, &streamed))) {
+        printf("Strings read in blocks differ\n");
+        failed = 1;
+    } else if (!failed) {
+        memory_strings_free(&streamed);
+    }
+    
+    // LiME: physical addresses, and no string across two ranges
+    const char* lime_path = "/tmp/test_string_arena.lime";
+    file = fopen(lime_path, "wb");
+    if (file) {
+        const uint64_t ranges[2][2] = {{0x100000, 0x100000 + 63}, {0x200000, 0x200000 + 63}};
+        const char* texts[2] = {"end of first", "start of second"};
+        for (int r = 0; r < 2; r++) {
+            uint8_t header[32] = {'E', 'M', 'i', 'L', 1, 0, 0, 0};
+            memcpy(header + 8, &ranges[r][0], 8);
+            memcpy(header + 16, &ranges[r][1], 8);
+            uint8_t body[64];
+            memset(body, 0, sizeof(body));
+            const size_t len = strlen(texts[r]);
+            memcpy(r == 0 ? body + 64 - len : body, texts[r], len);
+            fwrite(header, 1, sizeof(header), file);
+            fwrite(body, 1, sizeof(body), file);
+        }
+        fclose(file);
+    }
+    memory_strings_t lime;
+    if (!failed && (memory_strings_extract_file(lime_path, NULL, &lime) != 0 || lime.count != 2 ||
+                    lime.entries[0].address != 0x100000 + 64 - 12 ||
+                    strcmp(memory_strings_text(&lime, 0), "end of first") != 0 ||
+                    lime.entries[1].address != 0x200000 ||
+                    strcmp(memory_strings_text(&lime, 1), "start of second") != 0)) {
+        printf("Unexpected strings in LiME dump\n");
+        failed = 1;
+    } else if (!failed) {
+        memory_strings_free(&lime);
+    }
+    
+    memory_strings_free(&direct);
+    free(data);
+    unlink(raw_path);
+    unlink(lime_path);
+    
+    if (failed) {
+        return 1;
+    }
+    printf("Arena string extraction test passed!\n");
+    return 0;
+}
+
 int test_suspicious_detection() {
     printf("\n=== Testing Suspicious Activity Detection ===\n");
     
@@ -551,6 +684,11 @@ int main() {
         return result7;
     }
     
+    int result8 = test_string_arena();
+    if (result8 != 0) {
+        return result8;
+    }
+    
     printf("\n=== All Memory Analysis Tests Passed! ===\n");
     return 0;
 }
\ No newline at end of file
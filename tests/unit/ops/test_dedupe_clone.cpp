@@ -0,0 +1,247 @@
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <filesystem>
+#include <vector>
+#include <linux/fs.h>
+#include "core/ops/dedupe.h"
+
+static std::string write_temp_file(const char* name, const std::string& content) {
+    auto tmp = std::filesystem::temp_directory_path() / name;
+    FILE* f = std::fopen(tmp.string().c_str(), "wb"); assert(f);
+    std::fwrite(content.data(), 1, content.size(), f);
+    std::fclose(f);
+    return tmp.string();
+}
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static FileEntry entry(const std::string& path, uint64_t size) {
+    FileEntry e; e.fullPath = path; e.sizeLogical = size;
+    return e;
+}
+
+// dedupeBatch against a fake FIDEDUPERANGE: requests hold at most
+// kMaxDedupeDests destinations and kDedupeChunk bytes, every range of the
+// file is submitted once per matching destination, and a destination drops
+// out at its first differing or failed range
+static void test_batching() {
+    using namespace dedupe_detail;
+    const size_t destCount = 2 * kMaxDedupeDests + 3;
+    const uint64_t size = 2 * kDedupeChunk + 4096 + 123;
+    std::vector<int> destFds;
+    for (size_t i = 0; i < destCount; i++) destFds.push_back(static_cast<int>(1000 + i));
+
+    const int differing = 1000 + 5;                           // Differs from the second range on
+    const int unsupported = 1000 + static_cast<int>(kMaxDedupeDests) + 1; // Fails its first range
+    const int rejectedBatch = 2;                              // Third request batch fails outright
+
+    struct Call { uint64_t offset; uint64_t length; uint16_t count; int firstFd; };
+    std::vector<Call> calls;
+    std::vector<uint64_t> submitted(destCount, 0);
+    auto submit = [&](int srcFd, file_dedupe_range* req) {
+        assert(srcFd == 7);
+        calls.push_back({req->src_offset, req->src_length, req->dest_count, static_cast<int>(req->info[0].dest_fd)});
+        if (static_cast<size_t>(req->info[0].dest_fd - 1000) / kMaxDedupeDests == rejectedBatch) {
+            errno = EINVAL;
+            return -1;
+        }
+        for (uint16_t k = 0; k < req->dest_count; k++) {
+            file_dedupe_range_info& info = req->info[k];
+            assert(info.dest_offset == req->src_offset);
+            if (info.dest_fd == differing && req->src_offset > 0) {
+                info.status = FILE_DEDUPE_RANGE_DIFFERS;
+            } else if (info.dest_fd == unsupported) {
+                info.status = -EOPNOTSUPP;
+            } else {
+                info.status = FILE_DEDUPE_RANGE_SAME;
+                info.bytes_deduped = req->src_length;
+                submitted[info.dest_fd - 1000] += req->src_length;
+            }
+        }
+        return 0;
+    };
+
+    std::vector<ClonePairResult> results(destCount);
+    dedupeBatch(7, size, destFds, submit, results.data());
+
+    // Two full batches of three ranges each, then one rejected request
+    assert(calls.size() == 7);
+    for (const auto& call : calls) {
+        assert(call.count >= 1 && call.count <= kMaxDedupeDests);
+        assert(call.length >= 1 && call.length <= kDedupeChunk);
+    }
+    const uint64_t offsets[3] = {0, kDedupeChunk, 2 * kDedupeChunk};
+    for (size_t b = 0; b < 2; b++) {
+        for (size_t r = 0; r < 3; r++) {
+            const Call& call = calls[b * 3 + r];
+            assert(call.offset == offsets[r]);
+            assert(call.length == (r < 2 ? kDedupeChunk : 4096 + 123));
+            assert(call.firstFd == static_cast<int>(1000 + b * kMaxDedupeDests));
+        }
+    }
+    assert(calls[0].count == kMaxDedupeDests && calls[1].count == kMaxDedupeDests);
+    assert(calls[2].count == kMaxDedupeDests - 1);           // The differing destination dropped out
+    assert(calls[3].count == kMaxDedupeDests);
+    assert(calls[4].count == kMaxDedupeDests - 1);           // The unsupported destination dropped out
+    assert(calls[6].count == 3 && calls[6].offset == 0);
+
+    for (size_t i = 0; i < destCount; i++) {
+        const ClonePairResult& r = results[i];
+        assert(r.bytesShared == submitted[i]);
+        if (static_cast<int>(1000 + i) == differing) {
+            assert(!r.shared && r.differs && r.error == 0 && r.bytesShared == kDedupeChunk);
+        } else if (static_cast<int>(1000 + i) == unsupported) {
+            assert(!r.shared && !r.differs && r.error == EOPNOTSUPP && r.bytesShared == 0);
+        } else if (i / kMaxDedupeDests == rejectedBatch) {
+            assert(!r.shared && !r.differs && r.error == EINVAL && r.bytesShared == 0);
+        } else {
+            assert(r.shared && !r.differs && r.error == 0 && r.bytesShared == size);
+        }
+    }
+
+    // A filesystem sharing less than asked: the next range starts where the
+    // shortest result ended
+    calls.clear();
+    std::vector<int> two = {1000, 1001};
+    auto shortSubmit = [&](int, file_dedupe_range* req) {
+        calls.push_back({req->src_offset, req->src_length, req->dest_count, static_cast<int>(req->info[0].dest_fd)});
+        for (uint16_t k = 0; k < req->dest_count; k++) {
+            req->info[k].status = FILE_DEDUPE_RANGE_SAME;
+            req->info[k].bytes_deduped = k == 0 ? req->src_length : std::min<uint64_t>(req->src_length, 1 << 20);
+        }
+        return 0;
+    };
+    std::vector<ClonePairResult> pair(2);
+    dedupeBatch(7, 3ull << 20, two, shortSubmit, pair.data());
+    assert(calls.size() == 3 && calls[1].offset == (1u << 20) && calls[2].offset == (2u << 20));
+    assert(pair[0].shared && pair[1].shared);
+    assert(pair[0].bytesShared == (3ull << 20) && pair[1].bytesShared == (3ull << 20));
+    std::printf("Dedupe batching test passed\n");
+}
+
+// sharedBytes counts only ranges mapped to the same physical blocks at the
+// same file offset, up to the limit; encoded extents count only when whole
+static void test_shared_bytes() {
+    using namespace dedupe_detail;
+    const std::vector<Extent> src = {{0, 1 << 20, 8192, false}, {8192, 4 << 20, 8192, false},
+                                     {16384, 9 << 20, 4096, true}};
+    // First extent split in two, second moved elsewhere, encoded one identical
+    const std::vector<Extent> dest = {{0, 1 << 20, 4096, false}, {4096, (1 << 20) + 4096, 4096, false},
+                                      {8192, 6 << 20, 8192, false}, {16384, 9 << 20, 4096, true}};
+    assert(sharedBytes(src, dest, 20480) == 8192 + 4096);
+    assert(sharedBytes(src, dest, 6000) == 6000);
+    assert(sharedBytes(src, dest, 0) == 0);
+    assert(sharedBytes(src, {}, 20480) == 0);
+
+    // The same blocks at another file offset are not shared by this pair
+    const std::vector<Extent> shifted = {{4096, 1 << 20, 8192, false}};
+    assert(sharedBytes(src, shifted, 20480) == 0);
+    // Part of an encoded extent is never counted
+    const std::vector<Extent> partial = {{16384, 9 << 20, 2048, true}};
+    assert(sharedBytes(src, partial, 20480) == 0);
+    std::printf("Shared extent test passed\n");
+}
+
+static void test_clone_files() {
+    // Block-aligned content larger than one page, plus an unaligned tail
+    const size_t size = 3 * 65536 + 123;
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; i++) data[i] = static_cast<char>((i * 2654435761u) >> 13);
+    std::string other = data;
+    other[size / 2] ^= 0x5A;
+
+    std::string src = write_temp_file("ds_clone_src.bin", data);
+    std::string dup1 = write_temp_file("ds_clone_dup1.bin", data);
+    std::string dup2 = write_temp_file("ds_clone_dup2.bin", data);
+    std::string diff = write_temp_file("ds_clone_diff.bin", other);
+
+    DuplicateGroup same;
+    same.files = {entry(src, size), entry(dup1, size), entry(dup2, size)};
+    same.potentialSavings = 2 * size;
+
+    // A group that wrongly claims identical content: the kernel compares the
+    // ranges itself, so nothing may be shared past the first differing block
+    DuplicateGroup wrong;
+    wrong.files = {entry(src, size), entry(diff, size)};
+    wrong.potentialSavings = size;
+
+    LSMIndex index("test_index");
+    Deduplicator d(index);
+
+    // Simulation never touches the files
+    DedupeOptions opt;
+    opt.useClone = true;
+    opt.simulateOnly = true;
+    auto stats = d.deduplicate({same}, opt);
+    assert(stats.bytesCloned == 0 && stats.clonesCreated == 0 && stats.clonePairs.empty());
+
+    // Real run: every pair is reported, in group order
+    opt.simulateOnly = false;
+    opt.cloneThreads = 2;
+    stats = d.deduplicate({same, wrong}, opt);
+    assert(stats.clonePairs.size() == 3);
+    assert(stats.clonePairs[0].source == src && stats.clonePairs[0].destination == dup1);
+    assert(stats.clonePairs[1].source == src && stats.clonePairs[1].destination == dup2);
+    assert(stats.clonePairs[2].source == src && stats.clonePairs[2].destination == diff);
+    assert(stats.actualSavings == stats.bytesCloned);
+
+    // Files are never rewritten or replaced
+    assert(read_file(src) == data);
+    assert(read_file(dup1) == data);
+    assert(read_file(dup2) == data);
+    assert(read_file(diff) == other);
+
+    const int error = stats.clonePairs[0].error;
+    if (error == EOPNOTSUPP || error == EINVAL) {
+        // No extent sharing here (ext4, tmpfs): each pair reports why
+        for (const auto& pair : stats.clonePairs) {
+            assert(pair.error == EOPNOTSUPP || pair.error == EINVAL);
+            assert(!pair.shared && !pair.differs && pair.bytesShared == 0);
+        }
+        assert(stats.clonesCreated == 0 && stats.bytesCloned == 0);
+        std::printf("SKIP: %s does not support extent sharing (%s); set TMPDIR to a btrfs or XFS "
+                    "directory to test cloning\n",
+                    std::filesystem::temp_directory_path().string().c_str(), std::strerror(error));
+    } else {
+        // btrfs/XFS share both duplicates in full and stop at the differing block
+        assert(error == 0);
+        assert(stats.clonesCreated == 2);
+        for (size_t i = 0; i < 2; i++) {
+            assert(stats.clonePairs[i].shared && stats.clonePairs[i].error == 0);
+            assert(stats.clonePairs[i].bytesShared >= size);
+        }
+        const ClonePairResult& mismatch = stats.clonePairs[2];
+        assert(!mismatch.shared && mismatch.differs && mismatch.error == 0);
+        assert(mismatch.bytesShared < size);
+        assert(stats.bytesCloned < 2 * size + size / 2);
+        assert(stats.clonesAlreadyShared == 0);
+
+        // A second run finds the duplicates already sharing and saves nothing more
+        stats = d.deduplicate({same}, opt);
+        assert(stats.clonePairs.size() == 2);
+        assert(stats.clonesCreated == 0 && stats.clonesAlreadyShared == 2);
+        assert(stats.bytesCloned == 0 && stats.actualSavings == 0);
+        for (const auto& pair : stats.clonePairs) {
+            assert(pair.shared && pair.bytesAlreadyShared == pair.bytesShared);
+        }
+        assert(read_file(dup1) == data && read_file(dup2) == data);
+        std::printf("Dedupe clone test passed\n");
+    }
+
+    for (const auto& p : {src, dup1, dup2, diff}) std::filesystem::remove(p);
+}
+
+int main() {
+    test_batching();
+    test_shared_bytes();
+    test_clone_files();
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <filesystem>
 #include <vector>
 #include "core/ops/dedupe.h"
+#include "libs/chash/blake3.h"
 
 static std::string write_temp_file(const char* name, const std::string& content) {
     auto tmp = std::filesystem::temp_directory_path() / name;
@@ -13,6 +14,47 @@ static std::string write_temp_file(const char* name, const std::string& content)
     return tmp.string();
 }
 
+// A loose file and its copy inside an archive are grouped even without
+// computeFullHash: members carry their BLAKE3, so the loose file is hashed too
+static void test_loose_and_archived() {
+    const std::string content(2048, 'M');
+    std::string other(2048, 'M');
+    other[1024] = 'X';   // Same head and tail, different middle
+    std::string loose = write_temp_file("ds_hash_loose.bin", content);
+    std::string near = write_temp_file("ds_hash_near.bin", other);
+
+    const std::vector<uint8_t> headTail(BLAKE3_OUT_LEN, 0x42);
+    std::vector<uint8_t> digest(BLAKE3_OUT_LEN);
+    BLAKE3_HASH_STATE st; blake3_hash_init(&st);
+    blake3_hash_update(&st, content.data(), content.size());
+    blake3_hash_finalize(&st, digest.data(), BLAKE3_OUT_LEN);
+
+    FileEntry l; l.fullPath = loose; l.sizeLogical = content.size(); l.headTail16 = headTail;
+    FileEntry n; n.fullPath = near; n.sizeLogical = other.size(); n.headTail16 = headTail;
+    FileEntry m; m.fullPath = "/archives/backup.zip/ds_hash_loose.bin"; m.sizeLogical = content.size();
+    m.attributes.virtualFile = true; m.headTail16 = headTail; m.sha256 = digest;
+
+    LSMIndex dummy("test_index");
+    Deduplicator d(dummy);
+    DedupeOptions opt;
+    opt.computeFullHash = false;
+    opt.minFileSize = 1;
+    auto groups = d.findDuplicatesForTesting({l, n, m}, opt);
+    assert(groups.size() == 1);
+    assert(groups[0].files.size() == 2);
+    bool hasLoose = false, hasMember = false;
+    for (const auto& fe : groups[0].files) {
+        hasLoose |= fe.fullPath == loose;
+        hasMember |= fe.fullPath == m.fullPath;
+    }
+    assert(hasLoose && hasMember);
+    // Only one loose copy: nothing to reclaim, the member is reported as a copy
+    assert(groups[0].potentialSavings == 0);
+    assert(d.getStats().archivedCopies == 1);
+
+    std::error_code ec; std::filesystem::remove(loose, ec); std::filesystem::remove(near, ec);
+}
+
 int main() {
     // Prepare two identical files and one different
     std::string p1 = write_temp_file("ds_hash_a.bin", std::string(1024, 'A'));
@@ -46,5 +88,7 @@ int main() {
     assert(ha != hc);
     // cleanup
     std::error_code ec; std::filesystem::remove(p1, ec); std::filesystem::remove(p2, ec); std::filesystem::remove(p3, ec);
+
+    test_loose_and_archived();
     return 0;
 }
@@ -0,0 +1,183 @@
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <bit>
+#include <random>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "libs/phash/phash_optimized.h"
+#include "libs/phash/phash_dct.h"
+
+// Brute-force reference for the self-join
+static size_t brute_force_pairs(const std::vector<uint64_t>& hashes, int radius) {
+    size_t count = 0;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        for (size_t j = i + 1; j < hashes.size(); ++j) {
+            if (std::popcount(hashes[i] ^ hashes[j]) <= radius) count++;
+        }
+    }
+    return count;
+}
+
+static void test_radius_query_matches_brute_force() {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < 5000; ++i) {
+        uint64_t h = rng();
+        hashes.push_back(h);
+        // Plant a near-duplicate with a few flipped bits
+        if (i % 10 == 0) {
+            uint64_t flips = 0;
+            for (int k = 0; k < static_cast<int>(i % 7); ++k) flips |= 1ULL << (rng() % 64);
+            hashes.push_back(h ^ flips);
+        }
+    }
+
+    PHashMultiIndex index;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        bool added = index.add_hash(i, hashes[i]);
+        assert(added);
+    }
+
+    for (int radius : {0, 3, 6, 10}) {
+        size_t expected = brute_force_pairs(hashes, radius);
+        auto pairs = index.find_similar_pairs(radius, 4);
+        std::printf("radius %d: %zu pairs (brute force %zu)\n", radius, pairs.size(), expected);
+        assert(pairs.size() == expected);
+        for (size_t k = 1; k < pairs.size(); ++k) {
+            assert(pairs[k - 1].image_id_a < pairs[k].image_id_a ||
+                   (pairs[k - 1].image_id_a == pairs[k].image_id_a && pairs[k - 1].image_id_b < pairs[k].image_id_b));
+        }
+        // Same answer single-threaded
+        assert(index.find_similar_pairs(radius, 1).size() == expected);
+    }
+
+    PHashMultiIndex::Candidate out[16];
+    size_t n = index.query_similar_with_threshold(hashes[0], 6, out, 16);
+    assert(n >= 1 && out[0].image_id == 0 && out[0].distance == 0);
+    for (size_t k = 1; k < n; ++k) assert(out[k - 1].distance <= out[k].distance);
+}
+
+static void test_remove_and_persistence() {
+    PHashMultiIndex index;
+    index.add_hash(10, 0x0123456789ABCDEFULL);
+    index.add_hash(11, 0x0123456789ABCDEEULL);
+    index.add_hash(12, ~0x0123456789ABCDEFULL);
+
+    PHashMultiIndex::Candidate out[4];
+    assert(index.query_similar(0x0123456789ABCDEFULL, out, 4) == 2);
+    bool removed = index.remove_hash(11);
+    bool removed_again = index.remove_hash(11);
+    assert(removed && !removed_again);
+    assert(index.query_similar(0x0123456789ABCDEFULL, out, 4) == 1);
+
+    auto path = (std::filesystem::temp_directory_path() / "ds_test_phash.idx").string();
+    bool saved = index.save_to_file(path.c_str());
+    assert(saved);
+    PHashMultiIndex loaded;
+    bool loaded_ok = loaded.load_from_file(path.c_str());
+    assert(loaded_ok);
+    assert(loaded.get_statistics().total_images == 2);
+    assert(loaded.query_similar_with_threshold(~0x0123456789ABCDEFULL, 0, out, 4) == 1 && out[0].image_id == 12);
+    std::error_code ec; std::filesystem::remove(path, ec);
+}
+
+static void test_phash_file_pgm() {
+    const size_t w = 64, h = 48;
+    std::string header = "P5\n# test\n" + std::to_string(w) + " " + std::to_string(h) + "\n255\n";
+    std::string pixels(w * h, '\0');
+    for (size_t y = 0; y < h; ++y)
+        for (size_t x = 0; x < w; ++x) pixels[y * w + x] = static_cast<char>((x * 4 + y * 2) & 0xFF);
+
+    auto path = (std::filesystem::temp_directory_path() / "ds_test_phash.pgm").string();
+    FILE* f = std::fopen(path.c_str(), "wb"); assert(f);
+    std::fwrite(header.data(), 1, header.size(), f);
+    std::fwrite(pixels.data(), 1, pixels.size(), f);
+    std::fclose(f);
+
+    PHashOptimized hasher;
+    uint64_t from_file = 0, from_memory = 0;
+    bool file_ok = hasher.compute_phash_file(path.c_str(), from_file);
+    bool memory_ok = hasher.compute_phash(reinterpret_cast<const uint8_t*>(pixels.data()), w, h, from_memory);
+    assert(file_ok && memory_ok);
+    assert(from_file == from_memory);
+    std::error_code ec; std::filesystem::remove(path, ec);
+}
+
+static void test_low_freq_dct_matches_reference() {
+    const size_t n = 32, low = 8;
+    std::mt19937 rng(7);
+    std::vector<float> block(n * n);
+    for (auto& v : block) v = static_cast<float>(rng() % 256) - 128.0f;
+
+    // Naive orthonormal 2D DCT-II in double precision
+    const double pi = 3.14159265358979323846;
+    auto alpha = [&](size_t k) { return k == 0 ? std::sqrt(1.0 / n) : std::sqrt(2.0 / n); };
+    std::vector<double> expected(low * low);
+    for (size_t v = 0; v < low; ++v)
+        for (size_t u = 0; u < low; ++u) {
+            double sum = 0.0;
+            for (size_t y = 0; y < n; ++y)
+                for (size_t x = 0; x < n; ++x)
+                    sum += block[y * n + x] * std::cos(pi * v * (2.0 * y + 1) / (2.0 * n)) *
+                           std::cos(pi * u * (2.0 * x + 1) / (2.0 * n));
+            expected[v * low + u] = alpha(u) * alpha(v) * sum;
+        }
+
+    phash_detail::LowFreqDct dct;
+    dct.init(n, low);
+    std::vector<float> tmp(dct.scratch_size()), out(low * low);
+    PHashOptimized hasher;
+    std::vector<phash_detail::Kernel> kernels = {phash_detail::Kernel::SCALAR};
+    if (hasher.get_simd_level() != PHashOptimized::SimdLevel::NONE) kernels.push_back(phash_detail::Kernel::SSE2);
+    if (hasher.get_simd_level() >= PHashOptimized::SimdLevel::AVX2) kernels.push_back(phash_detail::Kernel::AVX2);
+    for (auto kernel : kernels) {
+        dct.compute(block.data(), out.data(), tmp.data(), kernel);
+        for (size_t i = 0; i < low * low; ++i) {
+            assert(std::fabs(out[i] - expected[i]) < 1e-2);
+        }
+    }
+}
+
+static void test_batch_matches_single() {
+    const size_t count = 16;
+    std::vector<std::vector<uint8_t>> images(count);
+    std::vector<size_t> widths(count), heights(count);
+    std::vector<uint64_t> batch_hashes(count), single_hashes(count);
+    std::vector<PHashOptimized::ImageBatch> batch(count);
+    std::mt19937 rng(3);
+    PHashOptimized hasher;
+    for (size_t i = 0; i < count; ++i) {
+        widths[i] = 40 + i * 13;
+        heights[i] = 30 + i * 7;
+        images[i].resize(widths[i] * heights[i] * 3);
+        for (auto& p : images[i]) p = static_cast<uint8_t>(rng());
+        batch[i] = {images[i].data(), widths[i], heights[i], &batch_hashes[i], 3};
+
+        // Reference: same pixels converted to luma up front
+        std::vector<uint8_t> gray(widths[i] * heights[i]);
+        for (size_t k = 0; k < gray.size(); ++k) {
+            const uint8_t* px = &images[i][k * 3];
+            gray[k] = static_cast<uint8_t>((77u * px[0] + 150u * px[1] + 29u * px[2]) >> 8);
+        }
+        bool hashed = hasher.compute_phash(gray.data(), widths[i], heights[i], single_hashes[i]);
+        assert(hashed);
+    }
+
+    size_t batch_done = hasher.compute_phash_batch(batch.data(), count, 4);
+    assert(batch_done == count);
+    for (size_t i = 0; i < count; ++i) {
+        assert(batch_hashes[i] == single_hashes[i]);
+    }
+}
+
+int main() {
+    test_radius_query_matches_brute_force();
+    test_remove_and_persistence();
+    test_phash_file_pgm();
+    test_low_freq_dct_matches_reference();
+    test_batch_matches_single();
+    std::printf("pHash index tests passed!\n");
+    return 0;
+}
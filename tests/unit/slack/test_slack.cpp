@@ -1,4 +1,6 @@
 #include "libs/slack/slack.h"
+#include "libs/slack/search.h"
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -123,6 +125,15 @@ int test_slack_analysis() {
         return 1;
     }
     
+    filesystem_info_t info;
+    if (slack_get_filesystem_info(test_dir, &info) != 0) {
+        printf("Failed to get filesystem information\n");
+        cleanup_test_environment(test_dir);
+        return 1;
+    }
+    const uint64_t cluster_size = info.cluster_size;
+    filesystem_info_free(&info);
+    
     // Analyze slack space
     slack_analysis_result_t result;
     int ret = slack_analyze_directory(test_dir, &result);
@@ -141,7 +152,29 @@ int test_slack_analysis() {
         printf("    File size: %lu bytes\n", (unsigned long)file->file_size);
         printf("    Allocated size: %lu bytes\n", (unsigned long)file->allocated_size);
         printf("    Slack size: %lu bytes\n", (unsigned long)file->slack_size);
+        printf("    Device offset: %llu\n", (unsigned long long)file->physical_offset);
         printf("    Slack data size: %lu bytes\n", (unsigned long)file->slack_data_size);
+        
+        // The slack runs to the end of the last cluster
+        if (file->allocated_size != file->file_size + file->slack_size ||
+            file->allocated_size % cluster_size != 0 || file->slack_size >= cluster_size) {
+            printf("Unexpected slack size\n");
+            slack_analysis_result_free(&result);
+            cleanup_test_environment(test_dir);
+            return 1;
+        }
+        if (file->slack_data && file->slack_data_size != file->slack_size) {
+            printf("Partial slack data\n");
+            slack_analysis_result_free(&result);
+            cleanup_test_environment(test_dir);
+            return 1;
+        }
+    }
+    if (result.file_count != 3) {
+        printf("Expected 3 files with slack space\n");
+        slack_analysis_result_free(&result);
+        cleanup_test_environment(test_dir);
+        return 1;
     }
     
     // Test searching in slack space
@@ -157,47 +190,310 @@ int test_slack_analysis() {
     return 0;
 }
 
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+// A one-group ext2 image of 256 1 KiB blocks. Blocks 1-10 (metadata) and
+// 100-119 are allocated; 11-99 and 120-255 are free.
+#define IMAGE_BLOCK 1024
+#define IMAGE_BLOCKS 256
+
+static int create_test_image(const char* path, uint8_t* image) {
+    memset(image, 0, IMAGE_BLOCK * IMAGE_BLOCKS);
+    
+    uint8_t* sb = image + 1024;
+    put32(sb + 0x00, 16);               // Inodes
+    put32(sb + 0x04, IMAGE_BLOCKS);     // Blocks
+    put32(sb + 0x0C, 89 + 136);         // Free blocks
+    put32(sb + 0x14, 1);                // First data block
+    put32(sb + 0x18, 0);                // 1 KiB blocks
+    put32(sb + 0x20, 8192);             // Blocks per group
+    put32(sb + 0x28, 16);               // Inodes per group
+    put16(sb + 0x38, 0xEF53);
+    put32(sb + 0x4C, 1);                // Dynamic revision
+    put16(sb + 0x58, 128);              // Inode size
+    
+    uint8_t* desc = image + 2 * IMAGE_BLOCK;
+    put32(desc + 0x00, 3);              // Block bitmap
+    put32(desc + 0x04, 4);              // Inode bitmap
+    put32(desc + 0x08, 5);              // Inode table
+    
+    // Bit i is block i + 1; bits past the last block are set
+    uint8_t* bitmap = image + 3 * IMAGE_BLOCK;
+    for (int block = 1; block < IMAGE_BLOCKS + 8 * IMAGE_BLOCK; block++) {
+        int used = block <= 10 || (block >= 100 && block <= 119) || block >= IMAGE_BLOCKS;
+        int bit = block - 1;
+        if (used && bit < 8 * IMAGE_BLOCK) {
+            bitmap[bit / 8] |= (uint8_t)(1u << (bit % 8));
+        }
+    }
+    
+    // A deleted JPEG and a keyword in free blocks; the same in used blocks
+    const uint8_t jpeg_head[] = {0xFF, 0xD8, 0xFF, 0xE0};
+    const uint8_t jpeg_tail[] = {0xFF, 0xD9};
+    memcpy(image + 50 * IMAGE_BLOCK, jpeg_head, sizeof(jpeg_head));
+    memset(image + 50 * IMAGE_BLOCK + 4, 'J', 400);
+    memcpy(image + 50 * IMAGE_BLOCK + 404, jpeg_tail, sizeof(jpeg_tail));
+    memcpy(image + 105 * IMAGE_BLOCK, jpeg_head, sizeof(jpeg_head));
+    memcpy(image + 60 * IMAGE_BLOCK + 7, "Password", 8);
+    memcpy(image + 110 * IMAGE_BLOCK, "password", 8);
+    // Across two free blocks, and across the end of a run
+    memcpy(image + 131 * IMAGE_BLOCK - 3, "password", 8);
+    memcpy(image + 100 * IMAGE_BLOCK - 4, "password", 8);
+    
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return -1;
+    }
+    size_t written = fwrite(image, 1, IMAGE_BLOCK * IMAGE_BLOCKS, file);
+    fclose(file);
+    return written == IMAGE_BLOCK * IMAGE_BLOCKS ? 0 : -1;
+}
+
+typedef struct {
+    const uint8_t* image;
+    uint64_t bytes;
+    int mismatches;
+} read_check_t;
+
+static int check_piece(size_t range, uint64_t offset, const uint8_t* data, size_t size, void* user_data) {
+    (void)range;
+    read_check_t* check = (read_check_t*)user_data;
+    if (memcmp(check->image + offset, data, size) != 0) {
+        check->mismatches++;
+    }
+    check->bytes += size;
+    return 0;
+}
+
 int test_unallocated_analysis() {
     printf("Testing unallocated space analysis...\n");
     
-    // Analyze unallocated space (simulated)
+    const char* image_path = "/tmp/slack_test_image.ext2";
+    uint8_t* image = (uint8_t*)malloc(IMAGE_BLOCK * IMAGE_BLOCKS);
+    if (!image || create_test_image(image_path, image) != 0) {
+        printf("Failed to create test image\n");
+        free(image);
+        return 1;
+    }
+    
+    // Analyze unallocated space
     unallocated_analysis_result_t result;
-    int ret = slack_analyze_unallocated("/dev/sda1", &result); // Using a common device path for testing
+    int ret = slack_analyze_unallocated(image_path, &result);
     
     if (ret != 0) {
         printf("Failed to analyze unallocated space\n");
+        free(image);
+        unlink(image_path);
         return 1;
     }
     
-    printf("Found %lu unallocated clusters:\n", (unsigned long)result.cluster_count);
+    printf("Found %lu unallocated runs:\n", (unsigned long)result.cluster_count);
     
-    for (size_t i = 0; i < result.cluster_count && i < 3; i++) { // Show first 3
+    for (size_t i = 0; i < result.cluster_count; i++) {
         unallocated_cluster_result_t* cluster = &result.clusters[i];
-        printf("  Cluster %lu:\n", (unsigned long)cluster->cluster_number);
+        printf("  Run at cluster %lu:\n", (unsigned long)cluster->cluster_number);
         printf("    Offset: %lu\n", (unsigned long)cluster->cluster_offset);
         printf("    Size: %lu bytes\n", (unsigned long)cluster->cluster_size);
-        printf("    Data size: %lu bytes\n", (unsigned long)cluster->cluster_data_size);
     }
     
-    if (result.cluster_count > 3) {
-        printf("  ... and %lu more clusters\n", (unsigned long)(result.cluster_count - 3));
+    int failed = result.cluster_count != 2 || result.cluster_size != IMAGE_BLOCK ||
+                 result.clusters[0].cluster_number != 11 || result.clusters[0].cluster_size != 89 * IMAGE_BLOCK ||
+                 result.clusters[1].cluster_number != 120 || result.clusters[1].cluster_size != 136 * IMAGE_BLOCK ||
+                 result.free_bytes != (89 + 136) * IMAGE_BLOCK;
+    if (failed) {
+        printf("Unexpected free runs\n");
+    }
+    
+    // Small reads: the pieces are exactly the free bytes
+    slack_range_t ranges[2];
+    for (size_t i = 0; i < 2 && !failed; i++) {
+        ranges[i].offset = result.clusters[i].cluster_offset;
+        ranges[i].length = result.clusters[i].cluster_size;
+    }
+    read_check_t check = {image, 0, 0};
+    if (!failed && (slack_read_ranges(image_path, ranges, 2, 8192, check_piece, &check) != 0 ||
+                    check.mismatches != 0 || check.bytes != result.free_bytes)) {
+        printf("Streamed ranges do not match the image\n");
+        failed = 1;
+    }
+    
+    // Carving sees only the free runs
+    carving_result_t carved;
+    if (!failed && slack_carve_unallocated(&result, &carved) == 0) {
+        printf("Carved %lu files from unallocated space\n", (unsigned long)carved.count);
+        if (carved.count != 1 || carved.files[0].offset != 50 * IMAGE_BLOCK || carved.files[0].size != 406) {
+            printf("Unexpected carved files\n");
+            failed = 1;
+        }
+        carving_result_free(&carved);
+    } else if (!failed) {
+        printf("Failed to carve unallocated space\n");
+        failed = 1;
     }
     
     // Test searching in unallocated space
     printf("\nSearching for keywords in unallocated space...\n");
     int matches = slack_search_unallocated(&result, "password", 0); // Case insensitive
     printf("Found %d matches for 'password'\n", matches);
+    if (!failed && matches != 2) {
+        printf("Expected 2 matches\n");
+        failed = 1;
+    }
     
     // Clean up
     unallocated_analysis_result_free(&result);
+    free(image);
+    unlink(image_path);
     
+    if (failed) {
+        return 1;
+    }
     printf("Unallocated space analysis test passed!\n");
     return 0;
 }
 
-int main() {
-    srand(time(NULL)); // Initialize random seed
+static void put_utf16(uint8_t* at, const char* text) {
+    for (size_t i = 0; text[i]; i++) {
+        at[2 * i] = (uint8_t)text[i];
+        at[2 * i + 1] = 0;
+    }
+}
+
+static int same_hits(const slack_hits_t* a, const slack_hits_t* b) {
+    if (a->count != b->count) {
+        return 0;
+    }
+    for (size_t i = 0; i < a->count; i++) {
+        if (a->hits[i].offset != b->hits[i].offset || a->hits[i].length != b->hits[i].length ||
+            a->hits[i].pattern != b->hits[i].pattern || a->hits[i].encoding != b->hits[i].encoding ||
+            a->hits[i].range != b->hits[i].range) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int test_pattern_search() {
+    printf("Testing multi-pattern search...\n");
+    
+    const slack_pattern_t patterns[] = {
+        {"password", 0},
+        {"\\d{3}-\\d{2}-\\d{4}", 1},          // Social security number
+        {"[a-z0-9._]+@example\\.com", 1},
+        {"[a-z]{2}\\d\\d#", 1},                  // No usable atom
+    };
+    char error[256];
+    slack_searcher_t* bad = slack_searcher_create(patterns, 1, 0, NULL, 0);
+    const slack_pattern_t unsupported = {"(a|b)", 1};
+    if (!bad || slack_searcher_create(&unsupported, 1, 0, error, sizeof(error)) != NULL || error[0] == '\0') {
+        printf("Unexpected compile result\n");
+        slack_searcher_free(bad);
+        return 1;
+    }
+    slack_searcher_free(bad);
+    
+    slack_searcher_t* searcher = slack_searcher_create(patterns, 4, SLACK_SEARCH_ASCII | SLACK_SEARCH_UTF16LE |
+                                                       SLACK_SEARCH_NOCASE, error, sizeof(error));
+    if (!searcher) {
+        printf("Failed to compile patterns: %s\n", error);
+        return 1;
+    }
+    
+    // Indicators in both encodings, some across the 8 KiB read boundaries
+    const size_t size = 64 * 1024;
+    uint8_t* data = (uint8_t*)malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (uint8_t)("xy z\n"[i % 5]);
+    }
+    memcpy(data + 100, "PassWord", 8);
+    memcpy(data + 8192 - 5, "123-45-6789", 11);
+    memcpy(data + 20000, "john.doe@example.com", 20);
+    put_utf16(data + 3 * 8192 - 7, "password");
+    put_utf16(data + 40000, "jane@example.com");
+    memcpy(data + 50000, "ab12#", 5);
+    memcpy(data + 4 * 8192 - 2, "cd34#", 5);
+    
+    slack_hits_t hits;
+    slack_hits_init(&hits);
+    int failed = slack_search_buffer(searcher, data, size, 0, 0, &hits) != 0;
+    slack_hits_sort(&hits);
+    const struct {
+        uint64_t offset;
+        uint32_t length;
+        uint32_t pattern;
+        uint32_t encoding;
+    } expected[] = {
+        {100, 8, 0, SLACK_ENCODING_ASCII},
+        {8192 - 5, 11, 1, SLACK_ENCODING_ASCII},
+        {20000, 20, 2, SLACK_ENCODING_ASCII},
+        {3 * 8192 - 7, 16, 0, SLACK_ENCODING_UTF16LE},
+        {4 * 8192 - 2, 5, 3, SLACK_ENCODING_ASCII},
+        {40000, 32, 2, SLACK_ENCODING_UTF16LE},
+        {50000, 5, 3, SLACK_ENCODING_ASCII},
+    };
+    const size_t expected_count = sizeof(expected) / sizeof(expected[0]);
+    failed |= hits.count != expected_count;
+    for (size_t i = 0; !failed && i < expected_count; i++) {
+        const slack_hit_t* hit = &hits.hits[i];
+        failed |= hit->offset != expected[i].offset || hit->length != expected[i].length ||
+                  hit->pattern != expected[i].pattern || hit->encoding != expected[i].encoding;
+    }
+    for (size_t i = 0; i < hits.count; i++) {
+        printf("  Pattern %u (%s) at offset %llu, %u bytes\n", hits.hits[i].pattern,
+               hits.hits[i].encoding == SLACK_ENCODING_UTF16LE ? "UTF-16LE" : "ASCII",
+               (unsigned long long)hits.hits[i].offset, hits.hits[i].length);
+    }
+    if (failed) {
+        printf("Unexpected hits in buffer\n");
+    }
+    
+    // Streamed in 8 KiB reads from a file, the same hits
+    const char* path = "/tmp/slack_test_search.bin";
+    FILE* file = fopen(path, "wb");
+    if (file) {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    }
+    slack_range_t range = {0, size};
+    slack_hits_t streamed;
+    slack_hits_init(&streamed);
+    if (!failed && (slack_search_ranges(searcher, path, &range, 1, 8192, &streamed) != 0 ||
+                    (slack_hits_sort(&streamed), !same_hits(&hits, &streamed)))) {
+        printf("Streamed hits differ\n");
+        failed = 1;
+    }
+    
+    // Ranges are searched on their own: a match across two does not count
+    slack_range_t split[2] = {{0, 8192 - 1}, {8192 - 1, size - 8192 + 1}};
+    slack_hits_free(&streamed);
+    if (!failed && (slack_search_ranges(searcher, path, split, 2, 8192, &streamed) != 0 ||
+                    streamed.count != expected_count - 1)) {
+        printf("Unexpected hits across ranges\n");
+        failed = 1;
+    }
     
+    slack_hits_free(&streamed);
+    slack_hits_free(&hits);
+    slack_searcher_free(searcher);
+    free(data);
+    unlink(path);
+    
+    if (failed) {
+        return 1;
+    }
+    printf("Multi-pattern search test passed!\n");
+    return 0;
+}
+
+int main() {
     printf("Running slack space and unallocated space analysis tests...\n");
     
     int result1 = test_filesystem_info();
@@ -215,6 +511,11 @@ int main() {
         return result3;
     }
     
+    int result4 = test_pattern_search();
+    if (result4 != 0) {
+        return result4;
+    }
+    
     printf("All slack space and unallocated space analysis tests passed!\n");
     return 0;
 }
\ No newline at end of file
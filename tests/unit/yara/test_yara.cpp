@@ -1,4 +1,6 @@
 #include "libs/yara/yara.h"
+#include "libs/yara/rules.h"
+#include "libs/yara/scanner.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,6 +8,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <dirent.h>
+#include <errno.h>
 
 // Create test files with suspicious content
 static int create_test_files(const char* test_dir) {
@@ -382,7 +385,7 @@ int test_rule_information() {
         yara_rule_info_t* rule = &rules[i];
         printf("  Rule %lu:\n", (unsigned long)i);
         printf("    Name: %s\n", rule->name ? rule->name : "unknown");
-        printf("    Namespace: %s\n", rule->namespace ? rule->namespace : "unknown");
+        printf("    Namespace: %s\n", rule->rule_namespace ? rule->rule_namespace : "unknown");
         printf("    Description: %s\n", rule->description ? rule->description : "unknown");
         printf("    Author: %s\n", rule->author ? rule->author : "unknown");
         printf("    Version: %s\n", rule->version ? rule->version : "unknown");
@@ -470,6 +473,301 @@ int test_severity_descriptions() {
     return 0;
 }
 
+static int has_rule(const yara_result_t* result, const char* name) {
+    for (size_t i = 0; i < result->count; i++) {
+        if (strcmp(result->matches[i].rule_name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+#define CHECK(cond) do { if (!(cond)) { printf("Check failed: %s (line %d)\n", #cond, __LINE__); return 1; } } while (0)
+
+int test_rule_engine() {
+    printf("Testing YARA rule engine...\n");
+
+    const char* source =
+        "// Language subset\n"
+        "rule MZ { condition: uint16(0) == 0x5A4D and uint32be(2) == 0x90000300 }\n"
+        "rule Hex { strings: $h = { 6A 40 ?? 68 [2-4] 00 3? } condition: $h }\n"
+        "rule HexMiss { strings: $h = { 6A 40 ?? 68 [0-1] 00 3? } condition: $h }\n"
+        "rule NoCase { strings: $a = \"EvilString\" nocase condition: #a == 2 and @a[2] > @a[1] }\n"
+        "rule Wide { meta: severity = 9 author = \"t\" strings: $w = \"wide\" wide condition: $w }\n"
+        "rule FullWord { strings: $f = \"cmd\" fullword condition: #f == 1 }\n"
+        "rule At { strings: $a = \"MZ\" condition: $a at 0 and not $a at 1 }\n"
+        "rule In { strings: $a = \"tail\" condition: $a in (filesize - 16..filesize) }\n"
+        "rule TwoOf { strings: $a = \"alpha\" $b = \"beta\" $c = \"gamma\" condition: 2 of ($a, $b*) and none of ($c) }\n"
+        "rule Size { condition: filesize > 1KB and filesize < 1MB and filesize % 2 == 0 }\n"
+        "private rule Hidden { strings: $a = \"alpha\" condition: $a }\n"
+        "rule UsesHidden { condition: Hidden and not HexMiss }\n"
+        "rule Undefined { strings: $a = \"absent\" condition: @a[1] == 0 or uint32(filesize) == 0 or not (1 \\ 0 == 0) }\n";
+
+    // Data: MZ header, the hex pattern, text and a tail
+    uint8_t data[2048];
+    memset(data, '.', sizeof(data));
+    const uint8_t mz[] = {'M', 'Z', 0x90, 0x00, 0x03, 0x00};
+    memcpy(data, mz, sizeof(mz));
+    const uint8_t hex[] = {0x6A, 0x40, 0x11, 0x68, 0xAA, 0xBB, 0xCC, 0x00, 0x35};
+    memcpy(data + 100, hex, sizeof(hex));
+    memcpy(data + 200, "eViLsTrInG and EVILSTRING", 25);
+    memcpy(data + 300, "w\0i\0d\0e\0", 8);
+    memcpy(data + 400, "xcmd cmd. cmdx", 14);
+    memcpy(data + 500, "alpha beta", 10);
+    memcpy(data + sizeof(data) - 8, "tail", 4);
+
+    CHECK(yara_load_rules_from_memory(source, strlen(source)) == 0);
+    yara_result_t result;
+    CHECK(yara_scan_data(data, sizeof(data), NULL, &result) == 0);
+    const char* expected[] = {"MZ", "Hex", "NoCase", "Wide", "FullWord", "At", "In", "TwoOf", "Size", "UsesHidden"};
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        if (!has_rule(&result, expected[i])) printf("Missing rule %s\n", expected[i]);
+        CHECK(has_rule(&result, expected[i]));
+    }
+    CHECK(!has_rule(&result, "HexMiss") && !has_rule(&result, "Hidden") && !has_rule(&result, "Undefined"));
+    for (size_t i = 0; i < result.count; i++) {
+        const yara_match_t* m = &result.matches[i];
+        if (strcmp(m->rule_name, "Hex") == 0) CHECK(m->offset == 100 && m->length == 9);
+        if (strcmp(m->rule_name, "Wide") == 0) CHECK(m->severity == 9 && m->offset == 300 && strcmp(m->matched_string, "$w") == 0);
+        if (strcmp(m->rule_name, "FullWord") == 0) CHECK(m->offset == 405);
+        if (strcmp(m->rule_name, "MZ") == 0) CHECK(m->matched_string[0] == '\0');
+    }
+    yara_result_free(&result);
+
+    // Unsupported or invalid rules are rejected with a line number
+    const char* bad[] = {
+        "rule A { strings: $r = /abc/ condition: $r }",
+        "rule A { condition: $missing }",
+        "rule A { strings: $a = \"x\" condition: $a }\nrule A { condition: true }",
+        "import \"pe\"\nrule A { condition: true }",
+        "rule A { strings: $h = { 4D [2] } condition: $h }",
+        "rule A { condition: B }",
+        "rule A {\n strings: $a = \"unterminated\n condition: $a }",
+    };
+    char error[256];
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        yara_rules_t* rules = yara_rules_compile(bad[i], strlen(bad[i]), error, sizeof(error));
+        CHECK(rules == NULL && strncmp(error, "line ", 5) == 0);
+        printf("  Rejected: %s\n", error);
+    }
+
+    // Many rules: every rule's atoms share one automaton; results match a
+    // brute-force search
+    const size_t rule_count = 2000;
+    char* big = (char*)malloc(rule_count * 96);
+    char (*words)[8] = (char (*)[8])malloc(rule_count * 8);
+    CHECK(big && words);
+    size_t len = 0;
+    uint32_t seed = 7;
+    for (size_t r = 0; r < rule_count; r++) {
+        for (int k = 0; k < 5; k++) {
+            seed = seed * 1103515245u + 12345u;
+            words[r][k] = (char)('a' + (seed >> 16) % 8);
+        }
+        words[r][5] = '\0';
+        len += (size_t)sprintf(big + len, "rule R%zu { strings: $a = \"%s\" condition: $a }\n", r, words[r]);
+    }
+    yara_rules_t* rules = yara_rules_compile(big, len, error, sizeof(error));
+    CHECK(rules != NULL);
+    const size_t text_size = 1 << 20;
+    uint8_t* text = (uint8_t*)malloc(text_size);
+    CHECK(text);
+    for (size_t i = 0; i < text_size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        text[i] = (uint8_t)('a' + (seed >> 16) % 11);
+    }
+    yara_result_t many;
+    yara_result_init(&many);
+    CHECK(yara_rules_scan_data(rules, text, text_size, &many) == 0);
+    size_t expected_count = 0;
+    for (size_t r = 0; r < rule_count; r++) {
+        const void* hit = memmem(text, text_size, words[r], 5);
+        if (hit) expected_count++;
+        char name[16];
+        snprintf(name, sizeof(name), "R%zu", r);
+        CHECK(has_rule(&many, name) == (hit != NULL));
+    }
+    CHECK(many.count == expected_count);
+    for (size_t i = 0; i < many.count; i++) {
+        const size_t r = (size_t)atoi(many.matches[i].rule_name + 1);
+        const uint8_t* first = (const uint8_t*)memmem(text, text_size, words[r], 5);
+        CHECK(many.matches[i].offset == (size_t)(first - text));
+    }
+    printf("  %zu of %zu rules matched\n", expected_count, rule_count);
+    yara_result_free(&many);
+    yara_rules_free(rules);
+    free(text);
+    free(words);
+    free(big);
+
+    printf("YARA rule engine test passed!\n");
+    return 0;
+}
+
+int test_chained_strings() {
+    printf("Testing chained hex strings...\n");
+
+    // Long and unbounded jumps split a hex string into fragments found
+    // through their own atoms and joined by offset window
+    const char* source =
+        "rule Open { strings: $h = { 41 41 [-] 42 } condition: #h == 199999 and @h[1] == 0 and !h[1] == 200001 }\n"
+        "rule Window { strings: $h = { 4D 5A [300-400] 50 45 } condition: #h == 1 and @h[1] == 1000 and !h[1] == 354 }\n"
+        "rule Three { strings: $h = { 01 02 [1000-] 03 [201-300] 04 } condition: #h == 1 and @h[1] == 5000 }\n"
+        "rule Miss { strings: $h = { 01 02 [-] 4D 5A } condition: $h }\n";
+    char error[256];
+    yara_rules_t* rules = yara_rules_compile(source, strlen(source), error, sizeof(error));
+    CHECK(rules != NULL);
+
+    // A run of 'A' ending in 'B': every start of "AA" reaches the 'B'
+    const size_t size = 200000;
+    uint8_t* data = (uint8_t*)malloc(size + 1);
+    CHECK(data);
+    memset(data, 'A', size);
+    data[size] = 'B';
+    yara_result_t result;
+    yara_result_init(&result);
+    CHECK(yara_rules_scan_data(rules, data, size + 1, &result) == 0);
+    CHECK(has_rule(&result, "Open") && result.count == 1);
+    yara_result_free(&result);
+
+    // Without the 'B' nothing matches, and the scan stays linear
+    yara_result_init(&result);
+    CHECK(yara_rules_scan_data(rules, data, size, &result) == 0);
+    CHECK(result.count == 0);
+    yara_result_free(&result);
+
+    // Gaps inside and outside the windows, and fragments out of order
+    memset(data, 0, size);
+    memcpy(data + 1000, "MZ", 2);
+    memcpy(data + 1352, "PE", 2);       // Gap 350: inside [300-400]
+    memcpy(data + 3000, "MZ", 2);
+    memcpy(data + 3252, "PE", 2);       // Gap 250: too short
+    memcpy(data + 3900, "PE", 2);       // Gap 898: too long
+    const uint8_t three[] = {0x01, 0x02, 0x03, 0x04};
+    memcpy(data + 5000, three, 2);
+    data[6500] = three[2];              // Gap 1498
+    data[6750] = three[3];              // Gap 249
+    yara_result_init(&result);
+    CHECK(yara_rules_scan_data(rules, data, size, &result) == 0);
+    CHECK(has_rule(&result, "Window") && has_rule(&result, "Three") && !has_rule(&result, "Miss"));
+    for (size_t i = 0; i < result.count; i++) {
+        const yara_match_t* m = &result.matches[i];
+        if (strcmp(m->rule_name, "Three") == 0) CHECK(m->offset == 5000 && m->length == 1751);
+    }
+    yara_result_free(&result);
+
+    yara_rules_free(rules);
+    free(data);
+    printf("Chained hex string test passed!\n");
+    return 0;
+}
+
+typedef struct {
+    size_t needle;
+    size_t marker;
+    size_t file_runs;       // Runs of consecutive matches from one file
+    size_t stop_after;      // Stop once this many matches arrived (0 = never)
+    char last_path[1024];
+} directory_counts_t;
+
+static int count_directory_match(const char* file_path, const yara_match_t* match, void* user_data) {
+    directory_counts_t* counts = (directory_counts_t*)user_data;
+    if (strcmp(match->rule_name, "Needle") == 0) counts->needle++;
+    if (strcmp(match->rule_name, "Marker") == 0) counts->marker++;
+    if (strcmp(counts->last_path, file_path) != 0) {
+        counts->file_runs++;
+        snprintf(counts->last_path, sizeof(counts->last_path), "%s", file_path);
+    }
+    return counts->stop_after > 0 && counts->needle + counts->marker >= counts->stop_after;
+}
+
+int test_parallel_directory() {
+    printf("Testing parallel YARA directory scanning...\n");
+
+    const char* root = "/tmp/yara_parallel_test";
+    const size_t per_dir = 40, dirs = 3;
+    char path[1024];
+    CHECK(mkdir(root, 0755) == 0 || errno == EEXIST);
+    size_t needles = 0, top_needles = 0;
+    for (size_t d = 0; d <= dirs; d++) {
+        // d == 0 is the top level
+        if (d > 0) {
+            snprintf(path, sizeof(path), "%s/sub%zu", root, d);
+            CHECK(mkdir(path, 0755) == 0 || errno == EEXIST);
+        }
+        for (size_t i = 0; i < per_dir; i++) {
+            if (d == 0) snprintf(path, sizeof(path), "%s/f%zu.bin", root, i);
+            else snprintf(path, sizeof(path), "%s/sub%zu/f%zu.bin", root, d, i);
+            FILE* f = fopen(path, "wb");
+            CHECK(f);
+            fprintf(f, "marker %zu %s\n", i, i % 3 == 0 ? "needle" : "hay");
+            fclose(f);
+            if (i % 3 == 0) {
+                needles++;
+                if (d == 0) top_needles++;
+            }
+        }
+    }
+
+    const char* source =
+        "rule Needle { strings: $a = \"needle\" condition: $a }\n"
+        "rule Marker { strings: $a = \"marker\" condition: $a }\n";
+    CHECK(yara_load_rules_from_memory(source, strlen(source)) == 0);
+    yara_rules_t* rules = yara_get_rules();
+    CHECK(rules != NULL);
+
+    // Replacing the loaded rules leaves the held reference usable
+    const char* other = "rule Other { condition: true }\n";
+    CHECK(yara_load_rules_from_memory(other, strlen(other)) == 0);
+
+    yara_options_t options;
+    yara_options_init(&options);
+    options.thread_count = 4;
+    options.recursive = 1;
+    directory_counts_t counts;
+    memset(&counts, 0, sizeof(counts));
+    CHECK(yara_scan_directory_stream(rules, root, &options, count_directory_match, &counts) == 0);
+    CHECK(counts.needle == needles);
+    CHECK(counts.marker == per_dir * (dirs + 1));
+    CHECK(counts.file_runs == per_dir * (dirs + 1));
+
+    // Top level only
+    options.recursive = 0;
+    memset(&counts, 0, sizeof(counts));
+    CHECK(yara_scan_directory_stream(rules, root, &options, count_directory_match, &counts) == 0);
+    CHECK(counts.needle == top_needles);
+    CHECK(counts.marker == per_dir);
+
+    // The callback stops the scan
+    options.recursive = 1;
+    memset(&counts, 0, sizeof(counts));
+    counts.stop_after = 5;
+    CHECK(yara_scan_directory_stream(rules, root, &options, count_directory_match, &counts) == 1);
+    CHECK(counts.needle + counts.marker == 5);
+
+    // Excluded files are not queued
+    CHECK(yara_add_exclude_pattern(&options, ".bin") == 0);
+    memset(&counts, 0, sizeof(counts));
+    CHECK(yara_scan_directory_stream(rules, root, &options, count_directory_match, &counts) == 0);
+    CHECK(counts.marker == 0);
+    yara_options_free(&options);
+    yara_rules_free(rules);
+
+    for (size_t d = 0; d <= dirs; d++) {
+        for (size_t i = 0; i < per_dir; i++) {
+            if (d == 0) snprintf(path, sizeof(path), "%s/f%zu.bin", root, i);
+            else snprintf(path, sizeof(path), "%s/sub%zu/f%zu.bin", root, d, i);
+            unlink(path);
+        }
+        if (d > 0) {
+            snprintf(path, sizeof(path), "%s/sub%zu", root, d);
+            rmdir(path);
+        }
+    }
+    rmdir(root);
+
+    printf("Parallel YARA directory scanning test passed!\n");
+    return 0;
+}
+
 int main() {
     printf("Running YARA malware detection tests...\n");
     
@@ -508,6 +806,21 @@ int main() {
         return result7;
     }
     
+    int result8 = test_rule_engine();
+    if (result8 != 0) {
+        return result8;
+    }
+    
+    int result9 = test_parallel_directory();
+    if (result9 != 0) {
+        return result9;
+    }
+    
+    int result10 = test_chained_strings();
+    if (result10 != 0) {
+        return result10;
+    }
+    
     printf("All YARA malware detection tests passed!\n");
     return 0;
 }
\ No newline at end of file